@@ -0,0 +1,870 @@
+/*
+ * Copyright (c)2019 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2025-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/*
+ * End-to-end wire-speed benchmark.
+ *
+ * This spins up two in-process Node instances joined to a throwaway public
+ * network. The first node also acts as the network controller and as the
+ * planet root for the second, so the whole control plane (HELLO, WHOIS,
+ * network config request) runs over the same in-memory "wire" as the data
+ * plane. Frames injected with processVirtualNetworkFrame() traverse the
+ * full path: filter -> armor/encrypt -> wire -> processWirePacket ->
+ * dearmor/verify -> filter -> virtual network frame callback (the tap).
+ *
+ * Output is CSV on stdout (progress chatter goes to stderr) so runs can be
+ * diffed between releases:
+ *
+ *   direction,frame_bytes,frames,seconds,pps,mbps,latency_avg_usec,latency_max_usec
+ *
+ * Numbers are single-threaded and in-process: no real sockets, no tap
+ * device, both endpoints sharing one core. They are not line-rate numbers;
+ * they are stable relative numbers for catching datapath regressions.
+ *
+ * A third mode, "zerotier-bench ds", microbenchmarks the core data
+ * structures in isolation: Hashtable and FlatHashtable insert/lookup/erase
+ * from 1k to 1M entries, the Topology-style sharded peer map under lookup
+ * plus churn, and Switch-style TX queue enqueue/drain. Per-operation cost
+ * is measured with the CPU cycle counter where available and reported as
+ * ops/sec with p50/p99 latencies, so data-structure changes come with
+ * before/after numbers.
+ *
+ * A second mode, "zerotier-bench rules [rules.json ...]", microbenchmarks
+ * the rules engine alone. Each rule set (the controller's JSON rule array
+ * format, or a whole network object with a "rules" member; two built-in
+ * sets if no files are given) is evaluated against a small synthetic
+ * traffic mix and ns/frame is reported per (rule set, traffic class), both
+ * with and without the compiled jump-threading table, so rule budgets can
+ * be planned and evaluator changes validated offline.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "node/Constants.hpp"
+#include "node/Node.hpp"
+#include "node/Identity.hpp"
+#include "node/InetAddress.hpp"
+#include "node/MAC.hpp"
+#include "node/World.hpp"
+#include "node/C25519.hpp"
+#include "node/Buffer.hpp"
+#include "node/Mutex.hpp"
+#include "node/Address.hpp"
+#include "node/NetworkConfig.hpp"
+#include "node/Network.hpp"
+#include "node/Hashtable.hpp"
+#include "node/FlatHashtable.hpp"
+
+#include "osdep/OSUtils.hpp"
+
+#include "controller/EmbeddedNetworkController.hpp"
+
+using namespace ZeroTier;
+
+#define ZT_BENCH_DEFAULT_PHASE_SECONDS 2
+#define ZT_BENCH_SEND_BATCH 32
+#define ZT_BENCH_FRAME_MAGIC 0x7a74626e63680000ULL // "ztbnch"
+#define ZT_BENCH_ETHERTYPE 0x0800
+#define ZT_BENCH_SETUP_TIMEOUT_MS 120000
+
+namespace {
+
+static inline int64_t nowNs()
+{
+	return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct BenchNode
+{
+	BenchNode() : node((Node *)0),framesReceived(0),bytesReceived(0),latencyTotalNs(0),latencyMaxNs(0),latencySamples(0) {}
+
+	Node *node;
+	const char *tag;
+	InetAddress wireAddr;
+	std::map<std::string,std::string> state; // state object store (also carries the minted planet)
+	uint64_t framesReceived;
+	uint64_t bytesReceived;
+	uint64_t latencyTotalNs;
+	uint64_t latencyMaxNs;
+	uint64_t latencySamples;
+};
+
+static BenchNode s_a; // root + controller
+static BenchNode s_b;
+
+struct WirePkt
+{
+	BenchNode *dst;
+	InetAddress from;
+	std::vector<uint8_t> data;
+};
+static std::deque<WirePkt> s_wireQ;
+static Mutex s_wireQ_m; // controller worker threads also send
+
+static inline std::string _stateKey(enum ZT_StateObjectType type,const uint64_t id[2])
+{
+	char tmp[64];
+	OSUtils::ztsnprintf(tmp,sizeof(tmp),"%d-%.16llx-%.16llx",(int)type,(unsigned long long)(id ? id[0] : 0),(unsigned long long)(id ? id[1] : 0));
+	return std::string(tmp);
+}
+
+static void SbenchStatePut(ZT_Node *n,void *uptr,void *tptr,enum ZT_StateObjectType type,const uint64_t id[2],const void *data,int len)
+{
+	BenchNode *const bn = reinterpret_cast<BenchNode *>(uptr);
+	if (len >= 0) {
+		bn->state[_stateKey(type,id)] = std::string(reinterpret_cast<const char *>(data),(unsigned long)len);
+	} else {
+		bn->state.erase(_stateKey(type,id));
+	}
+}
+
+static int SbenchStateGet(ZT_Node *n,void *uptr,void *tptr,enum ZT_StateObjectType type,const uint64_t id[2],void *data,unsigned int maxlen)
+{
+	BenchNode *const bn = reinterpret_cast<BenchNode *>(uptr);
+	std::map<std::string,std::string>::const_iterator s(bn->state.find(_stateKey(type,id)));
+	if (s == bn->state.end())
+		return -1;
+	if (s->second.length() > (unsigned long)maxlen)
+		return -1;
+	memcpy(data,s->second.data(),s->second.length());
+	return (int)s->second.length();
+}
+
+static int SbenchWireSend(ZT_Node *n,void *uptr,void *tptr,int64_t localSocket,const struct sockaddr_storage *remoteAddr,const void *data,unsigned int len,unsigned int ttl)
+{
+	BenchNode *const src = reinterpret_cast<BenchNode *>(uptr);
+	const InetAddress dest(remoteAddr);
+
+	BenchNode *dst = (BenchNode *)0;
+	if (dest == s_a.wireAddr) {
+		dst = &s_a;
+	} else if (dest == s_b.wireAddr) {
+		dst = &s_b;
+	} else {
+		return 0; // e.g. the root node trying to reach default planet roots; silently drop
+	}
+
+	WirePkt pkt;
+	pkt.dst = dst;
+	pkt.from = src->wireAddr;
+	pkt.data.assign(reinterpret_cast<const uint8_t *>(data),reinterpret_cast<const uint8_t *>(data) + len);
+	{
+		Mutex::Lock l(s_wireQ_m);
+		s_wireQ.push_back(pkt);
+	}
+	return 0;
+}
+
+static void SbenchVirtualNetworkFrame(ZT_Node *n,void *uptr,void *tptr,uint64_t nwid,void **nuptr,uint64_t sourceMac,uint64_t destMac,unsigned int etherType,unsigned int vlanId,const void *data,unsigned int len)
+{
+	BenchNode *const bn = reinterpret_cast<BenchNode *>(uptr);
+	++bn->framesReceived;
+	bn->bytesReceived += len;
+	if (len >= 16) {
+		uint64_t magic,sentNs;
+		memcpy(&magic,data,8);
+		memcpy(&sentNs,reinterpret_cast<const uint8_t *>(data) + 8,8);
+		if (magic == ZT_BENCH_FRAME_MAGIC) {
+			const uint64_t lat = (uint64_t)(nowNs() - (int64_t)sentNs);
+			bn->latencyTotalNs += lat;
+			if (lat > bn->latencyMaxNs)
+				bn->latencyMaxNs = lat;
+			++bn->latencySamples;
+		}
+	}
+}
+
+static int SbenchVirtualNetworkConfig(ZT_Node *n,void *uptr,void *tptr,uint64_t nwid,void **nuptr,enum ZT_VirtualNetworkConfigOperation op,const ZT_VirtualNetworkConfig *cfg)
+{
+	return 0;
+}
+
+static void SbenchEvent(ZT_Node *n,void *uptr,void *tptr,enum ZT_Event event,const void *payload)
+{
+}
+
+static int SbenchPathCheck(ZT_Node *n,void *uptr,void *tptr,uint64_t ztaddr,int64_t localSocket,const struct sockaddr_storage *remoteAddr)
+{
+	return 1;
+}
+
+static int SbenchPathLookup(ZT_Node *n,void *uptr,void *tptr,uint64_t ztaddr,int family,struct sockaddr_storage *result)
+{
+	return 0;
+}
+
+// Deliver all queued wire packets (which may queue more; keep going until drained)
+static void pumpWire()
+{
+	for(;;) {
+		WirePkt pkt;
+		{
+			Mutex::Lock l(s_wireQ_m);
+			if (s_wireQ.empty())
+				break;
+			pkt = s_wireQ.front();
+			s_wireQ.pop_front();
+		}
+		volatile int64_t dl = 0;
+		pkt.dst->node->processWirePacket((void *)0,OSUtils::now(),-1,reinterpret_cast<const struct sockaddr_storage *>(&pkt.from),pkt.data.data(),(unsigned int)pkt.data.size(),&dl);
+	}
+}
+
+static void runBackgroundTasks(BenchNode &bn)
+{
+	volatile int64_t dl = 0;
+	bn.node->processBackgroundTasks((void *)0,OSUtils::now(),&dl);
+}
+
+static bool networkIsUp(BenchNode &bn,uint64_t nwid)
+{
+	ZT_VirtualNetworkConfig *const nc = bn.node->networkConfig(nwid);
+	if (!nc)
+		return false;
+	const bool ok = (nc->status == ZT_NETWORK_STATUS_OK);
+	bn.node->freeQueryResult((void *)nc);
+	return ok;
+}
+
+static void runPhase(BenchNode &src,BenchNode &dst,uint64_t nwid,unsigned int frameSize,unsigned int seconds)
+{
+	std::vector<uint8_t> payload(frameSize,0x5a);
+
+	const uint64_t srcMac = MAC(Address(src.node->address()),nwid).toInt();
+	const uint64_t dstMac = MAC(Address(dst.node->address()),nwid).toInt();
+
+	dst.framesReceived = 0;
+	dst.bytesReceived = 0;
+	dst.latencyTotalNs = 0;
+	dst.latencyMaxNs = 0;
+	dst.latencySamples = 0;
+
+	const int64_t startNs = nowNs();
+	const int64_t endNs = startNs + ((int64_t)seconds * 1000000000LL);
+	int64_t lastBg = OSUtils::now();
+	uint64_t framesSent = 0;
+	const uint64_t magic = ZT_BENCH_FRAME_MAGIC;
+
+	while (nowNs() < endNs) {
+		for(int i=0;i<ZT_BENCH_SEND_BATCH;++i) {
+			const uint64_t sentNs = (uint64_t)nowNs();
+			memcpy(payload.data(),&magic,8);
+			memcpy(payload.data() + 8,&sentNs,8);
+			volatile int64_t dl = 0;
+			src.node->processVirtualNetworkFrame((void *)0,OSUtils::now(),nwid,srcMac,dstMac,ZT_BENCH_ETHERTYPE,0,payload.data(),frameSize,&dl);
+			++framesSent;
+		}
+		pumpWire();
+		const int64_t now = OSUtils::now();
+		if ((now - lastBg) >= 100) {
+			lastBg = now;
+			runBackgroundTasks(src);
+			runBackgroundTasks(dst);
+			pumpWire();
+		}
+	}
+	pumpWire();
+	const double elapsed = (double)(nowNs() - startNs) / 1000000000.0;
+
+	const double pps = (double)dst.framesReceived / elapsed;
+	const double mbps = (((double)dst.bytesReceived * 8.0) / elapsed) / 1000000.0;
+	const double latAvgUs = (dst.latencySamples > 0) ? (((double)dst.latencyTotalNs / (double)dst.latencySamples) / 1000.0) : 0.0;
+	const double latMaxUs = (double)dst.latencyMaxNs / 1000.0;
+
+	fprintf(stderr,"  %s -> %s %u byte frames: sent %llu, received %llu (%.1f%% delivered)" ZT_EOL_S,
+		src.tag,dst.tag,frameSize,
+		(unsigned long long)framesSent,(unsigned long long)dst.framesReceived,
+		(framesSent > 0) ? (100.0 * (double)dst.framesReceived / (double)framesSent) : 0.0);
+	printf("%s_to_%s,%u,%llu,%.3f,%.0f,%.2f,%.1f,%.1f" ZT_EOL_S,
+		src.tag,dst.tag,frameSize,
+		(unsigned long long)dst.framesReceived,elapsed,pps,mbps,latAvgUs,latMaxUs);
+	fflush(stdout);
+}
+
+// ---------------------------------------------------------------------------
+// Rules engine microbenchmark ("zerotier-bench rules")
+// ---------------------------------------------------------------------------
+
+#define ZT_BENCH_RULES_MIN_NS 250000000LL
+#define ZT_BENCH_RULES_BATCH 8192
+
+struct RulesBenchFrame
+{
+	const char *name;
+	unsigned int etherType;
+	unsigned int len;
+	uint8_t data[128];
+};
+
+static inline void _putU16(uint8_t *p,uint16_t v) { p[0] = (uint8_t)(v >> 8); p[1] = (uint8_t)v; }
+
+// A small synthetic traffic mix. Frames are the Ethernet payload only (the
+// rules engine never sees the Ethernet header; MACs and ethertype travel
+// beside it), with plausible headers so IP/port matchers exercise their
+// real parsing paths.
+static unsigned int makeRulesBenchFrames(RulesBenchFrame *f)
+{
+	unsigned int n = 0;
+	{
+		RulesBenchFrame &x = f[n++];
+		x.name = "ipv4_tcp_443";
+		x.etherType = 0x0800;
+		x.len = 40;
+		memset(x.data,0,sizeof(x.data));
+		x.data[0] = 0x45; // v4, 20 byte header
+		_putU16(x.data + 2,(uint16_t)x.len);
+		x.data[8] = 64; // TTL
+		x.data[9] = 6; // TCP
+		x.data[12] = 10; x.data[13] = 1; x.data[14] = 2; x.data[15] = 3; // 10.1.2.3
+		x.data[16] = 10; x.data[17] = 4; x.data[18] = 5; x.data[19] = 6; // 10.4.5.6
+		_putU16(x.data + 20,33000); // source port
+		_putU16(x.data + 22,443); // dest port
+		x.data[32] = 0x50; // data offset
+		x.data[33] = 0x02; // SYN
+	}
+	{
+		RulesBenchFrame &x = f[n++];
+		x.name = "ipv4_udp_53";
+		x.etherType = 0x0800;
+		x.len = 36;
+		memset(x.data,0,sizeof(x.data));
+		x.data[0] = 0x45;
+		_putU16(x.data + 2,(uint16_t)x.len);
+		x.data[8] = 64;
+		x.data[9] = 17; // UDP
+		x.data[12] = 10; x.data[13] = 1; x.data[14] = 2; x.data[15] = 3;
+		x.data[16] = 10; x.data[17] = 4; x.data[18] = 5; x.data[19] = 6;
+		_putU16(x.data + 20,33000);
+		_putU16(x.data + 22,53);
+		_putU16(x.data + 24,16); // UDP length
+	}
+	{
+		RulesBenchFrame &x = f[n++];
+		x.name = "ipv6_tcp_443";
+		x.etherType = 0x86dd;
+		x.len = 60;
+		memset(x.data,0,sizeof(x.data));
+		x.data[0] = 0x60; // v6
+		_putU16(x.data + 4,20); // payload length
+		x.data[6] = 6; // next header: TCP
+		x.data[7] = 64; // hop limit
+		x.data[8] = 0xfd; x.data[23] = 1; // fd00::1
+		x.data[24] = 0xfd; x.data[39] = 2; // fd00::2
+		_putU16(x.data + 40,33000);
+		_putU16(x.data + 42,443);
+		x.data[52] = 0x50;
+		x.data[53] = 0x02;
+	}
+	{
+		RulesBenchFrame &x = f[n++];
+		x.name = "arp_request";
+		x.etherType = 0x0806;
+		x.len = 28;
+		memset(x.data,0,sizeof(x.data));
+		x.data[1] = 1; // Ethernet
+		_putU16(x.data + 2,0x0800); // IPv4
+		x.data[4] = 6; // hardware address length
+		x.data[5] = 4; // protocol address length
+		x.data[7] = 1; // request
+		x.data[14] = 10; x.data[15] = 1; x.data[16] = 2; x.data[17] = 3;
+		x.data[24] = 10; x.data[25] = 4; x.data[26] = 5; x.data[27] = 6;
+	}
+	return n;
+}
+
+static int runRulesBench(int argc,char **argv)
+{
+	std::vector< std::pair<std::string,std::string> > ruleSets; // (name, JSON text)
+	if (argc <= 0) {
+		// No fixtures given: two built-in sets so the benchmark always runs,
+		// one trivial and one shaped like a typical ethertype whitelist with
+		// a port block.
+		ruleSets.push_back(std::pair<std::string,std::string>("builtin_accept",
+			"[{\"type\":\"ACTION_ACCEPT\"}]"));
+		ruleSets.push_back(std::pair<std::string,std::string>("builtin_typical",
+			"["
+			"{\"type\":\"MATCH_ETHERTYPE\",\"etherType\":2048,\"not\":true,\"or\":false},"
+			"{\"type\":\"MATCH_ETHERTYPE\",\"etherType\":2054,\"not\":true,\"or\":false},"
+			"{\"type\":\"MATCH_ETHERTYPE\",\"etherType\":34525,\"not\":true,\"or\":false},"
+			"{\"type\":\"ACTION_DROP\"},"
+			"{\"type\":\"MATCH_IP_DEST_PORT_RANGE\",\"start\":22,\"end\":22,\"not\":false,\"or\":false},"
+			"{\"type\":\"ACTION_DROP\"},"
+			"{\"type\":\"ACTION_ACCEPT\"}"
+			"]"));
+	} else {
+		for(int i=0;i<argc;++i) {
+			std::string js;
+			if (!OSUtils::readFile(argv[i],js)) {
+				fprintf(stderr,"[bench] FATAL: cannot read %s" ZT_EOL_S,argv[i]);
+				return 1;
+			}
+			ruleSets.push_back(std::pair<std::string,std::string>(std::string(argv[i]),js));
+		}
+	}
+
+	RulesBenchFrame frames[8];
+	const unsigned int frameCount = makeRulesBenchFrames(frames);
+
+	const uint64_t nwid = 0x8056c2e21c000001ULL;
+	const Address ztSource((uint64_t)0x1122334455ULL);
+	const Address ztDest((uint64_t)0x66778899aaULL);
+	const MAC macSource(ztSource,nwid);
+	const MAC macDest(ztDest,nwid);
+
+	printf("ruleset,rules,frame_class,mode,frames,ns_per_frame,accept" ZT_EOL_S);
+
+	for(std::vector< std::pair<std::string,std::string> >::const_iterator rs(ruleSets.begin());rs!=ruleSets.end();++rs) {
+		nlohmann::json j;
+		try {
+			j = OSUtils::jsonParse(rs->second);
+		} catch ( ... ) {
+			fprintf(stderr,"[bench] skipping %s: invalid JSON" ZT_EOL_S,rs->first.c_str());
+			continue;
+		}
+		nlohmann::json &jr = (j.is_array()) ? j : j["rules"];
+		if (!jr.is_array()) {
+			fprintf(stderr,"[bench] skipping %s: expected a rule array or an object with a \"rules\" array" ZT_EOL_S,rs->first.c_str());
+			continue;
+		}
+
+		NetworkConfig *const nc = new NetworkConfig(); // too large for the stack
+		for(unsigned long i=0;i<jr.size();++i) {
+			if (nc->ruleCount >= ZT_MAX_NETWORK_RULES)
+				break;
+			if (EmbeddedNetworkController::parseRuleJson(jr[i],nc->rules[nc->ruleCount])) {
+				++nc->ruleCount;
+			} else {
+				fprintf(stderr,"[bench] %s: unrecognized rule at index %lu (skipped)" ZT_EOL_S,rs->first.c_str(),i);
+			}
+		}
+		nc->compileRuleResumeTable();
+
+		if (Network::runRulesEngine(*nc,false,false,ztSource,ztDest,macSource,macDest,frames[0].data,frames[0].len,frames[0].etherType,0) < 0) {
+			fprintf(stderr,"[bench] skipping %s: REDIRECT/FORWARD/RANDOM rules cannot be evaluated offline" ZT_EOL_S,rs->first.c_str());
+			delete nc;
+			continue;
+		}
+
+		for(int mode=0;mode<2;++mode) {
+			const bool useRuleResume = (mode == 1);
+			for(unsigned int fi=0;fi<frameCount;++fi) {
+				const RulesBenchFrame &fr = frames[fi];
+				int accept = 0;
+				uint64_t total = 0;
+				const int64_t t0 = nowNs();
+				int64_t elapsed = 0;
+				do {
+					for(unsigned int k=0;k<ZT_BENCH_RULES_BATCH;++k) {
+						accept = Network::runRulesEngine(*nc,useRuleResume,false,ztSource,ztDest,macSource,macDest,fr.data,fr.len,fr.etherType,0);
+					}
+					total += ZT_BENCH_RULES_BATCH;
+					elapsed = nowNs() - t0;
+				} while (elapsed < ZT_BENCH_RULES_MIN_NS);
+				printf("%s,%u,%s,%s,%llu,%.1f,%d" ZT_EOL_S,
+					rs->first.c_str(),
+					nc->ruleCount,
+					fr.name,
+					(useRuleResume) ? "jump_threaded" : "interpreted",
+					(unsigned long long)total,
+					(double)elapsed / (double)total,
+					accept);
+			}
+		}
+
+		delete nc;
+	}
+	return 0;
+}
+
+/****************************************************************************/
+// Core data-structure microbenchmark ("zerotier-bench ds")
+/****************************************************************************/
+
+#define ZT_BENCH_DS_CHURN_RESIDENT 50000
+#define ZT_BENCH_DS_CHURN_OPS 2000000
+#define ZT_BENCH_DS_TXQ_DESTS 64
+#define ZT_BENCH_DS_TXQ_OPS 2000000
+
+// Cycle counter where we have one (x86 TSC); falls back to the monotonic
+// clock elsewhere. Calibrated against nowNs() so results always print in ns.
+static inline uint64_t cycleNow()
+{
+#if defined(__GNUC__)&&(defined(__x86_64__)||defined(__i386__))
+	uint32_t lo,hi;
+	__asm__ __volatile__("rdtsc" : "=a"(lo),"=d"(hi));
+	return (((uint64_t)hi << 32) | (uint64_t)lo);
+#else
+	return (uint64_t)nowNs();
+#endif
+}
+
+static double s_nsPerCycle = 1.0;
+
+static void calibrateCycles()
+{
+	const int64_t t0 = nowNs();
+	const uint64_t c0 = cycleNow();
+	while ((nowNs() - t0) < 50000000LL) {} // 50ms spin
+	const int64_t t1 = nowNs();
+	const uint64_t c1 = cycleNow();
+	if (c1 > c0) {
+		s_nsPerCycle = (double)(t1 - t0) / (double)(c1 - c0);
+	}
+	fprintf(stderr,"[bench] cycle counter: %.4f ns/cycle" ZT_EOL_S,s_nsPerCycle);
+}
+
+// splitmix64: deterministic key stream so runs are byte-for-byte comparable
+static inline uint64_t dsRand(uint64_t &state)
+{
+	uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static void dsShuffle(std::vector<uint64_t> &v,uint64_t &rs)
+{
+	for(unsigned long i=(unsigned long)v.size()-1;i>0;--i) {
+		std::swap(v[i],v[dsRand(rs) % (i + 1)]);
+	}
+}
+
+static void dsReport(const char *structure,const char *op,unsigned long entries,std::vector<uint32_t> &samples,uint64_t totalCycles)
+{
+	const double totalNs = (double)totalCycles * s_nsPerCycle;
+	std::vector<uint32_t>::iterator p50(samples.begin() + (samples.size() / 2));
+	std::vector<uint32_t>::iterator p99(samples.begin() + ((samples.size() * 99) / 100));
+	std::nth_element(samples.begin(),p50,samples.end());
+	const uint32_t p50c = *p50;
+	std::nth_element(samples.begin(),p99,samples.end());
+	printf("%s,%s,%lu,%lu,%.0f,%.1f,%.1f" ZT_EOL_S,
+		structure,
+		op,
+		entries,
+		(unsigned long)samples.size(),
+		(double)samples.size() / (totalNs / 1000000000.0),
+		(double)p50c * s_nsPerCycle,
+		(double)*p99 * s_nsPerCycle);
+	fflush(stdout);
+}
+
+// Insert/lookup/erase over a uniformly random 64-bit key set. The same
+// timed loop body serves Hashtable and FlatHashtable so the comparison
+// between the two is apples to apples.
+template<typename HT>
+static void runDsHashtableBench(const char *structure,unsigned long entries,uint64_t seed)
+{
+	uint64_t rs = seed;
+	std::vector<uint64_t> keys(entries);
+	for(unsigned long i=0;i<entries;++i) {
+		keys[i] = dsRand(rs);
+	}
+
+	HT ht;
+	std::vector<uint32_t> samples(entries);
+	uint64_t total = 0;
+
+	for(unsigned long i=0;i<entries;++i) {
+		const uint64_t c0 = cycleNow();
+		ht.set(keys[i],i);
+		const uint64_t c = cycleNow() - c0;
+		samples[i] = (uint32_t)((c > 0xffffffffULL) ? 0xffffffffULL : c);
+		total += c;
+	}
+	dsReport(structure,"insert",entries,samples,total);
+
+	dsShuffle(keys,rs);
+	total = 0;
+	volatile uint64_t sink = 0;
+	for(unsigned long i=0;i<entries;++i) {
+		const uint64_t c0 = cycleNow();
+		const uint64_t *const v = ht.get(keys[i]);
+		const uint64_t c = cycleNow() - c0;
+		if (v) {
+			sink += *v;
+		}
+		samples[i] = (uint32_t)((c > 0xffffffffULL) ? 0xffffffffULL : c);
+		total += c;
+	}
+	dsReport(structure,"lookup",entries,samples,total);
+
+	dsShuffle(keys,rs);
+	total = 0;
+	for(unsigned long i=0;i<entries;++i) {
+		const uint64_t c0 = cycleNow();
+		ht.erase(keys[i]);
+		const uint64_t c = cycleNow() - c0;
+		samples[i] = (uint32_t)((c > 0xffffffffULL) ? 0xffffffffULL : c);
+		total += c;
+	}
+	dsReport(structure,"erase",entries,samples,total);
+	(void)sink;
+}
+
+// Topology::getPeer() reduces to a get() against one shard of the peer
+// table, with inserts and dead-peer erasures mixed in; this reproduces that
+// access pattern (90% lookups of resident addresses, 10% replace-one churn)
+// against the same table type without needing a whole node around it.
+static void runDsPeerChurnBench()
+{
+	uint64_t rs = 0x746f706f6c6f6779ULL;
+	std::vector<uint64_t> resident(ZT_BENCH_DS_CHURN_RESIDENT);
+	FlatHashtable<Address,uint64_t> peers;
+	for(unsigned long i=0;i<ZT_BENCH_DS_CHURN_RESIDENT;++i) {
+		resident[i] = dsRand(rs) & 0xffffffffffULL;
+		peers.set(Address(resident[i]),i);
+	}
+
+	std::vector<uint32_t> samples(ZT_BENCH_DS_CHURN_OPS);
+	uint64_t total = 0;
+	volatile uint64_t sink = 0;
+	for(unsigned long i=0;i<ZT_BENCH_DS_CHURN_OPS;++i) {
+		const uint64_t r = dsRand(rs);
+		const unsigned long slot = (unsigned long)(r % ZT_BENCH_DS_CHURN_RESIDENT);
+		if ((r % 10) != 0) {
+			const Address a(resident[slot]);
+			const uint64_t c0 = cycleNow();
+			const uint64_t *const v = peers.get(a);
+			const uint64_t c = cycleNow() - c0;
+			if (v) {
+				sink += *v;
+			}
+			samples[i] = (uint32_t)((c > 0xffffffffULL) ? 0xffffffffULL : c);
+			total += c;
+		} else {
+			const Address dead(resident[slot]);
+			resident[slot] = dsRand(rs) & 0xffffffffffULL;
+			const Address fresh(resident[slot]);
+			const uint64_t c0 = cycleNow();
+			peers.erase(dead);
+			peers.set(fresh,i);
+			const uint64_t c = cycleNow() - c0;
+			samples[i] = (uint32_t)((c > 0xffffffffULL) ? 0xffffffffULL : c);
+			total += c;
+		}
+	}
+	dsReport("peer_map_churn","mixed_90r_10w",ZT_BENCH_DS_CHURN_RESIDENT,samples,total);
+	(void)sink;
+}
+
+// Switch's WHOIS-pending TX queue: per-destination FIFOs hanging off a
+// Hashtable keyed by address, entries appended on defer and drained in
+// order when the identity arrives. Enqueue and drain are timed separately.
+static void runDsTxQueueBench()
+{
+	uint64_t rs = 0x7478717565756573ULL;
+	Address dests[ZT_BENCH_DS_TXQ_DESTS];
+	for(unsigned int i=0;i<ZT_BENCH_DS_TXQ_DESTS;++i) {
+		dests[i] = Address(dsRand(rs) & 0xffffffffffULL);
+	}
+
+	Hashtable< Address,std::list<uint64_t> > txq;
+	std::vector<uint32_t> samples(ZT_BENCH_DS_TXQ_OPS);
+	uint64_t total = 0;
+
+	for(unsigned long i=0;i<ZT_BENCH_DS_TXQ_OPS;++i) {
+		const Address &dest = dests[dsRand(rs) % ZT_BENCH_DS_TXQ_DESTS];
+		const uint64_t c0 = cycleNow();
+		std::list<uint64_t> *q = txq.get(dest);
+		if (!q) {
+			q = &txq.set(dest,std::list<uint64_t>());
+		}
+		q->push_back(i);
+		const uint64_t c = cycleNow() - c0;
+		samples[i] = (uint32_t)((c > 0xffffffffULL) ? 0xffffffffULL : c);
+		total += c;
+	}
+	dsReport("tx_queue","enqueue",ZT_BENCH_DS_TXQ_DESTS,samples,total);
+
+	total = 0;
+	unsigned long drained = 0;
+	volatile uint64_t sink = 0;
+	for(unsigned int i=0;i<ZT_BENCH_DS_TXQ_DESTS;++i) {
+		std::list<uint64_t> *const q = txq.get(dests[i]);
+		if (!q) {
+			continue;
+		}
+		while (!q->empty()) {
+			const uint64_t c0 = cycleNow();
+			sink += q->front();
+			q->pop_front();
+			const uint64_t c = cycleNow() - c0;
+			samples[drained++] = (uint32_t)((c > 0xffffffffULL) ? 0xffffffffULL : c);
+			total += c;
+		}
+	}
+	samples.resize(drained);
+	dsReport("tx_queue","drain",ZT_BENCH_DS_TXQ_DESTS,samples,total);
+	(void)sink;
+}
+
+static int runDsBench()
+{
+	calibrateCycles();
+	printf("structure,operation,entries,ops,ops_per_sec,p50_ns,p99_ns" ZT_EOL_S);
+	static const unsigned long SIZES[4] = { 1000,10000,100000,1000000 };
+	for(int i=0;i<4;++i) {
+		runDsHashtableBench< Hashtable<uint64_t,uint64_t> >("Hashtable",SIZES[i],0x68617368ULL);
+		runDsHashtableBench< FlatHashtable<uint64_t,uint64_t> >("FlatHashtable",SIZES[i],0x68617368ULL);
+	}
+	runDsPeerChurnBench();
+	runDsTxQueueBench();
+	return 0;
+}
+
+} // anonymous namespace
+
+#ifdef __WINDOWS__
+int _tmain(int argc,_TCHAR* argv[])
+#else
+int main(int argc,char **argv)
+#endif
+{
+	if ((argc > 1)&&(!strcmp(argv[1],"rules"))) {
+		return runRulesBench(argc - 2,argv + 2);
+	}
+	if ((argc > 1)&&(!strcmp(argv[1],"ds"))) {
+		return runDsBench();
+	}
+
+	unsigned int phaseSeconds = ZT_BENCH_DEFAULT_PHASE_SECONDS;
+	if (argc > 1) {
+		const int s = atoi(argv[1]);
+		if (s > 0)
+			phaseSeconds = (unsigned int)s;
+	}
+
+	s_a.tag = "a";
+	s_b.tag = "b";
+	s_a.wireAddr.fromString("10.250.250.1/19931");
+	s_b.wireAddr.fromString("10.250.250.2/19932");
+
+	struct ZT_Node_Callbacks cb;
+	memset(&cb,0,sizeof(cb));
+	cb.version = 0;
+	cb.statePutFunction = SbenchStatePut;
+	cb.stateGetFunction = SbenchStateGet;
+	cb.wirePacketSendFunction = SbenchWireSend;
+	cb.virtualNetworkFrameFunction = SbenchVirtualNetworkFrame;
+	cb.virtualNetworkConfigFunction = SbenchVirtualNetworkConfig;
+	cb.eventCallback = SbenchEvent;
+	cb.pathCheckFunction = SbenchPathCheck;
+	cb.pathLookupFunction = SbenchPathLookup;
+
+	fprintf(stderr,"[bench] creating nodes (identity generation can take several seconds)..." ZT_EOL_S);
+	s_a.node = new Node((void *)&s_a,(void *)0,&cb,OSUtils::now());
+	fprintf(stderr,"[bench] node a (root/controller): %.10llx" ZT_EOL_S,(unsigned long long)s_a.node->address());
+
+	// Mint a throwaway planet with node a as the sole root so node b finds it
+	// on its own over the in-memory wire.
+	{
+		std::vector<World::Root> roots(1);
+		roots[0].identity = s_a.node->identity();
+		roots[0].stableEndpoints.push_back(s_a.wireAddr);
+		const C25519::Pair worldKey(C25519::generate());
+		World planet(World::make(World::TYPE_PLANET,0x62656e6368ULL,(uint64_t)OSUtils::now(),worldKey.pub,roots,worldKey));
+		Buffer<ZT_WORLD_MAX_SERIALIZED_LENGTH> wbuf;
+		planet.serialize(wbuf,false);
+		const uint64_t nullId[2] = { 0,0 };
+		s_b.state[_stateKey(ZT_STATE_OBJECT_PLANET,nullId)] = std::string(reinterpret_cast<const char *>(wbuf.data()),wbuf.size());
+	}
+
+	s_b.node = new Node((void *)&s_b,(void *)0,&cb,OSUtils::now());
+	fprintf(stderr,"[bench] node b: %.10llx" ZT_EOL_S,(unsigned long long)s_b.node->address());
+
+	// Node a is also the controller; seed its database with one public
+	// accept-everything network before the controller reads it.
+	const uint64_t nwid = (s_a.node->address() << 24) | 0x000001ULL;
+	char homePath[256],dbPath[256];
+	OSUtils::ztsnprintf(homePath,sizeof(homePath),"%szt-bench-%ld",ZT_PATH_SEPARATOR_S "tmp" ZT_PATH_SEPARATOR_S,(long)OSUtils::now());
+	OSUtils::ztsnprintf(dbPath,sizeof(dbPath),"%s%scontroller.d",homePath,ZT_PATH_SEPARATOR_S);
+	OSUtils::mkdir(homePath);
+	OSUtils::mkdir(dbPath);
+	{
+		char networkDir[256],networkPath[256],networkJson[1024];
+		OSUtils::ztsnprintf(networkDir,sizeof(networkDir),"%s%snetwork",dbPath,ZT_PATH_SEPARATOR_S);
+		OSUtils::mkdir(networkDir);
+		OSUtils::ztsnprintf(networkPath,sizeof(networkPath),"%s%s%.16llx.json",networkDir,ZT_PATH_SEPARATOR_S,(unsigned long long)nwid);
+		OSUtils::ztsnprintf(networkJson,sizeof(networkJson),
+			"{\"id\":\"%.16llx\",\"objtype\":\"network\",\"name\":\"bench\",\"private\":false,"
+			"\"enableBroadcast\":true,\"mtu\":%d,\"multicastLimit\":32,\"revision\":1,"
+			"\"rules\":[{\"not\":false,\"or\":false,\"type\":\"ACTION_ACCEPT\"}]}",
+			(unsigned long long)nwid,ZT_DEFAULT_MTU);
+		if (!OSUtils::writeFile(networkPath,std::string(networkJson))) {
+			fprintf(stderr,"[bench] FATAL: cannot write %s" ZT_EOL_S,networkPath);
+			return 1;
+		}
+	}
+	EmbeddedNetworkController *const controller = new EmbeddedNetworkController(s_a.node,homePath,dbPath,0,(RedisConfig *)0);
+	s_a.node->setNetconfMaster((void *)controller);
+
+	fprintf(stderr,"[bench] network %.16llx, establishing..." ZT_EOL_S,(unsigned long long)nwid);
+	s_a.node->join(nwid,(void *)0,(void *)0);
+	s_b.node->join(nwid,(void *)0,(void *)0);
+
+	// Pump until both sides hold a network config and frames actually pass
+	// in both directions (paths and peer keys established).
+	{
+		const uint64_t srcMacA = MAC(Address(s_a.node->address()),nwid).toInt();
+		const uint64_t srcMacB = MAC(Address(s_b.node->address()),nwid).toInt();
+		const int64_t give = OSUtils::now() + ZT_BENCH_SETUP_TIMEOUT_MS;
+		uint8_t probe[64];
+		memset(probe,0,sizeof(probe));
+		bool up = false;
+		while (OSUtils::now() < give) {
+			runBackgroundTasks(s_a);
+			runBackgroundTasks(s_b);
+			pumpWire();
+			if ((networkIsUp(s_a,nwid))&&(networkIsUp(s_b,nwid))) {
+				volatile int64_t dl = 0;
+				s_b.node->processVirtualNetworkFrame((void *)0,OSUtils::now(),nwid,srcMacB,srcMacA,ZT_BENCH_ETHERTYPE,0,probe,sizeof(probe),&dl);
+				s_a.node->processVirtualNetworkFrame((void *)0,OSUtils::now(),nwid,srcMacA,srcMacB,ZT_BENCH_ETHERTYPE,0,probe,sizeof(probe),&dl);
+				pumpWire();
+				if ((s_a.framesReceived > 0)&&(s_b.framesReceived > 0)) {
+					up = true;
+					break;
+				}
+			}
+			Thread::sleep(50);
+		}
+		if (!up) {
+			fprintf(stderr,"[bench] FATAL: network did not come up within %d ms" ZT_EOL_S,(int)ZT_BENCH_SETUP_TIMEOUT_MS);
+			return 1;
+		}
+	}
+	fprintf(stderr,"[bench] established, running %u second phases..." ZT_EOL_S,phaseSeconds);
+
+	printf("direction,frame_bytes,frames,seconds,pps,mbps,latency_avg_usec,latency_max_usec" ZT_EOL_S);
+	static const unsigned int FRAME_SIZES[4] = { 64,256,1024,2400 };
+	for(int i=0;i<4;++i) {
+		runPhase(s_b,s_a,nwid,FRAME_SIZES[i],phaseSeconds);
+		runPhase(s_a,s_b,nwid,FRAME_SIZES[i],phaseSeconds);
+	}
+
+	delete s_b.node;
+	delete s_a.node;
+	delete controller;
+	fprintf(stderr,"[bench] done (scratch state left in %s)" ZT_EOL_S,homePath);
+	return 0;
+}
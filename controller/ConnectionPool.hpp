@@ -25,6 +25,10 @@
 #include <set>
 #include <memory>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <exception>
 #include <string>
 
@@ -40,6 +44,11 @@ struct ConnectionUnavailable : std::exception {
 class Connection {
 public:
     virtual ~Connection() {};
+
+    /**
+     * Health check; return false if the connection should be discarded and replaced
+     */
+    virtual bool validate() { return true; };
 };
 
 class ConnectionFactory {
@@ -56,17 +65,73 @@ struct ConnectionPoolStats {
 template<class T>
 class ConnectionPool {
 public:
-    ConnectionPool(size_t max_pool_size, size_t min_pool_size, std::shared_ptr<ConnectionFactory> factory)
+    /**
+     * @param prewarm If true, fill the pool to max_pool_size up front so peak demand right after start never pays connection setup latency
+     * @param borrow_timeout_ms How long borrow() waits for a returned connection when the pool is exhausted before failing
+     * @param keepalive_period_ms How often idle connections are health checked and replaced (0 to disable)
+     */
+    ConnectionPool(size_t max_pool_size, size_t min_pool_size, std::shared_ptr<ConnectionFactory> factory, bool prewarm = false, unsigned long borrow_timeout_ms = 5000, unsigned long keepalive_period_ms = 60000)
         : m_maxPoolSize(max_pool_size)
         , m_minPoolSize(min_pool_size)
+        , m_borrowTimeoutMs(borrow_timeout_ms)
         , m_factory(factory)
+        , m_run(true)
     {
         Metrics::max_pool_size += max_pool_size;
         Metrics::min_pool_size += min_pool_size;
-        while(m_pool.size() < m_minPoolSize){
+        const size_t target = prewarm ? m_maxPoolSize : m_minPoolSize;
+        while(m_pool.size() < target){
             m_pool.push_back(m_factory->create());
             Metrics::pool_avail++;
         }
+        if (keepalive_period_ms > 0) {
+            m_keepaliveThread = std::thread([this,keepalive_period_ms]() {
+                unsigned long waited = 0;
+                while (m_run) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                    waited += 100;
+                    if (waited < keepalive_period_ms)
+                        continue;
+                    waited = 0;
+                    // Validate idle connections one at a time so borrowers
+                    // never wait behind a health check round trip.
+                    size_t n;
+                    {
+                        std::unique_lock<std::mutex> l(m_poolMutex);
+                        n = m_pool.size();
+                    }
+                    while ((n-- > 0)&&(m_run)) {
+                        std::shared_ptr<Connection> conn;
+                        {
+                            std::unique_lock<std::mutex> l(m_poolMutex);
+                            if (m_pool.empty())
+                                break;
+                            conn = m_pool.front();
+                            m_pool.pop_front();
+                            Metrics::pool_avail--;
+                        }
+                        bool ok = false;
+                        try {
+                            ok = conn->validate();
+                        } catch (std::exception &e) {}
+                        if (!ok) {
+                            conn.reset();
+                            try {
+                                conn = m_factory->create();
+                            } catch (std::exception &e) {
+                                Metrics::pool_errors++;
+                            }
+                        }
+                        if (conn) {
+                            std::unique_lock<std::mutex> l(m_poolMutex);
+                            m_pool.push_back(conn);
+                            Metrics::pool_avail++;
+                            m_poolCond.notify_one();
+                        }
+                    }
+                }
+            });
+        }
     };
 
     ConnectionPoolStats get_stats() {
@@ -80,6 +145,10 @@ public:
     };
 
     ~ConnectionPool() {
+        m_run = false;
+        if (m_keepaliveThread.joinable()) {
+            m_keepaliveThread.join();
+        }
     };
 
     /**
@@ -92,15 +161,17 @@ public:
      */
     std::shared_ptr<T> borrow() {
         std::unique_lock<std::mutex> l(m_poolMutex);
-        
+        const std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(m_borrowTimeoutMs);
+
         while((m_pool.size() + m_borrowed.size()) < m_minPoolSize) {
             std::shared_ptr<Connection> conn = m_factory->create();
             m_pool.push_back(conn);
             Metrics::pool_avail++;
         }
 
-        if(m_pool.size()==0){
-            
+        while(m_pool.size()==0){
+
             if ((m_pool.size() + m_borrowed.size()) < m_maxPoolSize) {
                 try {
                     std::shared_ptr<Connection> conn = m_factory->create();
@@ -129,9 +200,13 @@ public:
                         }
                     }
                 }
-                // Nothing available
-                Metrics::pool_errors++;
-                throw ConnectionUnavailable();
+                // Nothing available: wait for an unborrow (or the keepalive
+                // thread returning a validated connection) instead of failing
+                // immediately.
+                if (m_poolCond.wait_until(l,deadline) == std::cv_status::timeout) {
+                    Metrics::pool_errors++;
+                    throw ConnectionUnavailable();
+                }
             }
         }
 
@@ -159,15 +234,20 @@ public:
         if ((m_pool.size() + m_borrowed.size()) < m_maxPoolSize) {
             Metrics::pool_avail++;
             m_pool.push_back(conn);
+            m_poolCond.notify_one();
         }
     };
 protected:
     size_t m_maxPoolSize;
     size_t m_minPoolSize;
+    unsigned long m_borrowTimeoutMs;
     std::shared_ptr<ConnectionFactory> m_factory;
     std::deque<std::shared_ptr<Connection> > m_pool;
     std::set<std::shared_ptr<Connection> > m_borrowed;
     std::mutex m_poolMutex;
+    std::condition_variable m_poolCond;
+    std::thread m_keepaliveThread;
+    std::atomic<bool> m_run;
 };
 
 }
@@ -30,6 +30,8 @@ void DB::initNetwork(nlohmann::json &network)
 	if (!network.count("name")) network["name"] = "";
 	if (!network.count("multicastLimit")) network["multicastLimit"] = (uint64_t)32;
 	if (!network.count("enableBroadcast")) network["enableBroadcast"] = true;
+	if (!network.count("compressUnicast")) network["compressUnicast"] = false;
+	if (!network.count("enableQos")) network["enableQos"] = false;
 	if (!network.count("v4AssignMode")) network["v4AssignMode"] = {{"zt",false}};
 	if (!network.count("v6AssignMode")) network["v6AssignMode"] = {{"rfc4193",false},{"zt",false},{"6plane",false}};
 	if (!network.count("authTokens")) network["authTokens"] = {{}};
@@ -142,7 +144,7 @@ bool DB::get(const uint64_t networkId,nlohmann::json &network,const uint64_t mem
 		auto m = nw->members.find(memberId);
 		if (m == nw->members.end())
 			return false;
-		member = m->second;
+		member = nlohmann::json::from_msgpack(m->second);
 	}
 	return true;
 }
@@ -159,15 +161,26 @@ bool DB::get(const uint64_t networkId,nlohmann::json &network,const uint64_t mem
 			return false;
 		nw = nwi->second;
 	}
+	std::shared_ptr<const NetworkSummaryInfo> si;
 	{
 		std::shared_lock<std::shared_mutex> l2(nw->lock);
 		network = nw->config;
-		_fillSummaryInfo(nw,info);
+		si = nw->summaryInfo;
 		auto m = nw->members.find(memberId);
 		if (m == nw->members.end())
 			return false;
-		member = m->second;
+		member = nlohmann::json::from_msgpack(m->second);
 	}
+	if (!si) {
+		// Rebuild the memoized summary at most once per member change; repeat
+		// readers just copy the snapshot above without scanning members.
+		std::unique_lock<std::shared_mutex> l2(nw->lock);
+		if (!nw->summaryInfo)
+			_fillSummaryInfo(nw,info);
+		si = nw->summaryInfo;
+	}
+	if (si)
+		info = *si;
 	return true;
 }
 
@@ -187,7 +200,28 @@ bool DB::get(const uint64_t networkId,nlohmann::json &network,std::vector<nlohma
 		std::shared_lock<std::shared_mutex> l2(nw->lock);
 		network = nw->config;
 		for(auto m=nw->members.begin();m!=nw->members.end();++m) {
-			members.push_back(m->second);
+			members.push_back(nlohmann::json::from_msgpack(m->second));
+		}
+	}
+	return true;
+}
+
+bool DB::memberRevisions(const uint64_t networkId,std::vector< std::pair<uint64_t,uint64_t> > &revisions)
+{
+	waitForReady();
+	std::shared_ptr<_Network> nw;
+	{
+		std::shared_lock<std::shared_mutex> l(_networks_l);
+		auto nwi = _networks.find(networkId);
+		if (nwi == _networks.end())
+			return false;
+		nw = nwi->second;
+	}
+	{
+		std::shared_lock<std::shared_mutex> l2(nw->lock);
+		revisions.reserve(revisions.size() + nw->memberRevisions.size());
+		for(auto m=nw->memberRevisions.begin();m!=nw->memberRevisions.end();++m) {
+			revisions.push_back(*m);
 		}
 	}
 	return true;
@@ -211,6 +245,19 @@ void DB::_memberChanged(nlohmann::json &old,nlohmann::json &memberConfig,bool no
 	bool wasAuth = false;
 	std::shared_ptr<_Network> nw;
 
+	// Compare the summary-relevant fields of the old and new records up front
+	// so an update that only touches e.g. lastSeen does not invalidate the
+	// memoized summary, churn the index sets, or re-parse every assigned IP.
+	const bool isUpdate = ((old.is_object())&&(memberConfig.is_object()));
+	bool bridgeChanged = true;
+	bool authChanged = true;
+	bool ipsChanged = true;
+	if (isUpdate) {
+		bridgeChanged = (OSUtils::jsonBool(old["activeBridge"],false) != OSUtils::jsonBool(memberConfig["activeBridge"],false));
+		authChanged = (OSUtils::jsonBool(old["authorized"],false) != OSUtils::jsonBool(memberConfig["authorized"],false));
+		ipsChanged = (old["ipAssignments"] != memberConfig["ipAssignments"]);
+	}
+
 	if (old.is_object()) {
 		memberId = OSUtils::jsonIntHex(old["id"],0ULL);
 		networkId = OSUtils::jsonIntHex(old["nwid"],0ULL);
@@ -224,22 +271,24 @@ void DB::_memberChanged(nlohmann::json &old,nlohmann::json &memberConfig,bool no
 			}
 			if (nw) {
 				std::unique_lock<std::shared_mutex> l(nw->lock);
-				if (OSUtils::jsonBool(old["activeBridge"],false)) {
+				if ((bridgeChanged)&&(OSUtils::jsonBool(old["activeBridge"],false))) {
 					nw->activeBridgeMembers.erase(memberId);
 				}
 				wasAuth = OSUtils::jsonBool(old["authorized"],false);
-				if (wasAuth) {
+				if ((authChanged)&&(wasAuth)) {
 					nw->authorizedMembers.erase(memberId);
 				}
-				json &ips = old["ipAssignments"];
-				if (ips.is_array()) {
-					for(unsigned long i=0;i<ips.size();++i) {
-						json &ipj = ips[i];
-						if (ipj.is_string()) {
-							const std::string ips = ipj;
-							InetAddress ipa(ips.c_str());
-							ipa.setPort(0);
-							nw->allocatedIps.erase(ipa);
+				if (ipsChanged) {
+					json &ips = old["ipAssignments"];
+					if (ips.is_array()) {
+						for(unsigned long i=0;i<ips.size();++i) {
+							json &ipj = ips[i];
+							if (ipj.is_string()) {
+								const std::string ips = ipj;
+								InetAddress ipa(ips.c_str());
+								ipa.setPort(0);
+								nw->allocatedIps.erase(ipa);
+							}
 						}
 					}
 				}
@@ -263,34 +312,46 @@ void DB::_memberChanged(nlohmann::json &old,nlohmann::json &memberConfig,bool no
 		{
 			std::unique_lock<std::shared_mutex> l(nw->lock);
 
-			nw->members[memberId] = memberConfig;
+			// Replace the packed record wholesale; unlike the JSON DOM this
+			// is a single contiguous allocation, so there is no win in
+			// patching it field by field.
+			nw->members[memberId] = nlohmann::json::to_msgpack(memberConfig);
+			nw->memberRevisions[memberId] = OSUtils::jsonInt(memberConfig["revision"],0ULL);
 
-			if (OSUtils::jsonBool(memberConfig["activeBridge"],false)) {
+			if ((bridgeChanged)&&(OSUtils::jsonBool(memberConfig["activeBridge"],false))) {
 				nw->activeBridgeMembers.insert(memberId);
 			}
 			isAuth = OSUtils::jsonBool(memberConfig["authorized"],false);
 			if (isAuth) {
 				Metrics::member_auths++;
-				nw->authorizedMembers.insert(memberId);
+				if (authChanged)
+					nw->authorizedMembers.insert(memberId);
 			}
-			json &ips = memberConfig["ipAssignments"];
-			if (ips.is_array()) {
-				for(unsigned long i=0;i<ips.size();++i) {
-					json &ipj = ips[i];
-					if (ipj.is_string()) {
-						const std::string ips = ipj;
-						InetAddress ipa(ips.c_str());
-						ipa.setPort(0);
-						nw->allocatedIps.insert(ipa);
+			if (ipsChanged) {
+				json &ips = memberConfig["ipAssignments"];
+				if (ips.is_array()) {
+					for(unsigned long i=0;i<ips.size();++i) {
+						json &ipj = ips[i];
+						if (ipj.is_string()) {
+							const std::string ips = ipj;
+							InetAddress ipa(ips.c_str());
+							ipa.setPort(0);
+							nw->allocatedIps.insert(ipa);
+						}
 					}
 				}
 			}
 
+			bool summaryChanged = ((!isUpdate)||(bridgeChanged)||(authChanged)||(ipsChanged));
 			if (!isAuth) {
 				const int64_t ldt = (int64_t)OSUtils::jsonInt(memberConfig["lastDeauthorizedTime"],0ULL);
-				if (ldt > nw->mostRecentDeauthTime)
+				if (ldt > nw->mostRecentDeauthTime) {
 					nw->mostRecentDeauthTime = ldt;
+					summaryChanged = true;
+				}
 			}
+			if (summaryChanged)
+				nw->summaryInfo.reset();
 		}
 
 		if (notifyListeners) {
@@ -303,6 +364,8 @@ void DB::_memberChanged(nlohmann::json &old,nlohmann::json &memberConfig,bool no
 		if (nw) {
 			std::unique_lock<std::shared_mutex> l(nw->lock);
 			nw->members.erase(memberId);
+			nw->memberRevisions.erase(memberId);
+			nw->summaryInfo.reset();
 		}
 		if (networkId) {
 			std::unique_lock<std::shared_mutex> l(_networks_l);
@@ -390,15 +453,18 @@ void DB::_networkChanged(nlohmann::json &old,nlohmann::json &networkConfig,bool
 
 void DB::_fillSummaryInfo(const std::shared_ptr<_Network> &nw,NetworkSummaryInfo &info)
 {
+	std::shared_ptr<NetworkSummaryInfo> si(new NetworkSummaryInfo());
 	for(auto ab=nw->activeBridgeMembers.begin();ab!=nw->activeBridgeMembers.end();++ab)
-		info.activeBridges.push_back(Address(*ab));
-	std::sort(info.activeBridges.begin(),info.activeBridges.end());
+		si->activeBridges.push_back(Address(*ab));
+	std::sort(si->activeBridges.begin(),si->activeBridges.end());
 	for(auto ip=nw->allocatedIps.begin();ip!=nw->allocatedIps.end();++ip)
-		info.allocatedIps.push_back(*ip);
-	std::sort(info.allocatedIps.begin(),info.allocatedIps.end());
-	info.authorizedMemberCount = (unsigned long)nw->authorizedMembers.size();
-	info.totalMemberCount = (unsigned long)nw->members.size();
-	info.mostRecentDeauthTime = nw->mostRecentDeauthTime;
+		si->allocatedIps.push_back(*ip);
+	std::sort(si->allocatedIps.begin(),si->allocatedIps.end());
+	si->authorizedMemberCount = (unsigned long)nw->authorizedMembers.size();
+	si->totalMemberCount = (unsigned long)nw->members.size();
+	si->mostRecentDeauthTime = nw->mostRecentDeauthTime;
+	nw->summaryInfo = si;
+	info = *si;
 }
 
 } // namespace ZeroTier
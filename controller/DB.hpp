@@ -118,6 +118,12 @@ public:
 	bool get(const uint64_t networkId,nlohmann::json &network,const uint64_t memberId,nlohmann::json &member,NetworkSummaryInfo &info);
 	bool get(const uint64_t networkId,nlohmann::json &network,std::vector<nlohmann::json> &members);
 
+	/**
+	 * Get (member ID, revision) pairs for all members of a network without
+	 * copying any member JSON. Maintained incrementally on member change.
+	 */
+	bool memberRevisions(const uint64_t networkId,std::vector< std::pair<uint64_t,uint64_t> > &revisions);
+
 	void networks(std::set<uint64_t> &networks);
 
 	template<typename F>
@@ -128,7 +134,8 @@ public:
 		for(auto nw=_networks.begin();nw!=_networks.end();++nw) {
 			f(nw->first,nw->second->config,0,nullJson); // first provide network with 0 for member ID
 			for(auto m=nw->second->members.begin();m!=nw->second->members.end();++m) {
-				f(nw->first,nw->second->config,m->first,m->second);
+				nlohmann::json member(nlohmann::json::from_msgpack(m->second));
+				f(nw->first,nw->second->config,m->first,member);
 			}
 		}
 	}
@@ -173,17 +180,24 @@ protected:
 	{
 		_Network() : mostRecentDeauthTime(0) {}
 		nlohmann::json config;
-		std::unordered_map<uint64_t,nlohmann::json> members;
+		// Member records are held packed (MessagePack) rather than as live
+		// JSON DOMs: one contiguous allocation of a few hundred bytes per
+		// member instead of several KB spread across many small nodes, which
+		// is what keeps a large controller's resident set reasonable. JSON is
+		// materialized on demand at the API boundaries that need it.
+		std::unordered_map< uint64_t,std::vector<uint8_t> > members;
+		std::unordered_map<uint64_t,uint64_t> memberRevisions; // compact member ID -> revision index for list endpoints
 		std::unordered_set<uint64_t> activeBridgeMembers;
 		std::unordered_set<uint64_t> authorizedMembers;
 		std::unordered_set<InetAddress,InetAddress::Hasher> allocatedIps;
 		int64_t mostRecentDeauthTime;
+		std::shared_ptr<const NetworkSummaryInfo> summaryInfo; // memoized summary, cleared whenever a member changes
 		std::shared_mutex lock;
 	};
 
 	virtual void _memberChanged(nlohmann::json &old,nlohmann::json &memberConfig,bool notifyListeners);
 	virtual void _networkChanged(nlohmann::json &old,nlohmann::json &networkConfig,bool notifyListeners);
-	void _fillSummaryInfo(const std::shared_ptr<_Network> &nw,NetworkSummaryInfo &info);
+	void _fillSummaryInfo(const std::shared_ptr<_Network> &nw,NetworkSummaryInfo &info); // caller must hold nw->lock exclusively
 
 	std::vector<DB::ChangeListener *> _changeListeners;
 	std::unordered_map< uint64_t,std::shared_ptr<_Network> > _networks;
@@ -75,6 +75,23 @@ DBMirrorSet::~DBMirrorSet()
 {
 	_running = false;
 	_syncCheckerThread.join();
+	std::vector< std::shared_ptr<_MirrorWriter> > writers;
+	{
+		std::unique_lock<std::shared_mutex> l(_dbs_l);
+		writers.swap(_writers);
+	}
+	for(auto w=writers.begin();w!=writers.end();++w) {
+		(*w)->queue.stop();
+		(*w)->thread.join();
+		// Flush anything still queued so a clean shutdown loses no mirror writes.
+		std::vector<nlohmann::json *> unwritten((*w)->queue.drain());
+		for(auto r=unwritten.begin();r!=unwritten.end();++r) {
+			try {
+				(*w)->db->save(**r,false);
+			} catch ( ... ) {}
+			delete *r;
+		}
+	}
 }
 
 bool DBMirrorSet::hasNetwork(const uint64_t networkId) const
@@ -128,6 +145,16 @@ bool DBMirrorSet::get(const uint64_t networkId,nlohmann::json &network,std::vect
 	return false;
 }
 
+bool DBMirrorSet::memberRevisions(const uint64_t networkId,std::vector< std::pair<uint64_t,uint64_t> > &revisions)
+{
+	std::shared_lock<std::shared_mutex> l(_dbs_l);
+	for(auto d=_dbs.begin();d!=_dbs.end();++d) {
+		if ((*d)->memberRevisions(networkId,revisions))
+			return true;
+	}
+	return false;
+}
+
 AuthInfo DBMirrorSet::getSSOAuthInfo(const nlohmann::json &member, const std::string &redirectURL) 
 {
 	std::shared_lock<std::shared_mutex> l(_dbs_l);
@@ -216,11 +243,15 @@ void DBMirrorSet::nodeIsOnline(const uint64_t networkId,const uint64_t memberId,
 
 void DBMirrorSet::onNetworkUpdate(const void *db,uint64_t networkId,const nlohmann::json &network)
 {
-	nlohmann::json record(network);
-	std::unique_lock<std::shared_mutex> l(_dbs_l);
-	for(auto d=_dbs.begin();d!=_dbs.end();++d) {
-		if (d->get() != db) {
-			(*d)->save(record,false);
+	// Mirror copies go through per-backend writer queues so the backend that
+	// accepted the change (and the config request behind it) never waits on
+	// a slower mirror.
+	{
+		std::shared_lock<std::shared_mutex> l(_dbs_l);
+		for(auto w=_writers.begin();w!=_writers.end();++w) {
+			if ((*w)->db.get() != db) {
+				(*w)->queue.post(new nlohmann::json(network));
+			}
 		}
 	}
 	_listener->onNetworkUpdate(this,networkId,network);
@@ -228,11 +259,12 @@ void DBMirrorSet::onNetworkUpdate(const void *db,uint64_t networkId,const nlohma
 
 void DBMirrorSet::onNetworkMemberUpdate(const void *db,uint64_t networkId,uint64_t memberId,const nlohmann::json &member)
 {
-	nlohmann::json record(member);
-	std::unique_lock<std::shared_mutex> l(_dbs_l);
-	for(auto d=_dbs.begin();d!=_dbs.end();++d) {
-		if (d->get() != db) {
-			(*d)->save(record,false);
+	{
+		std::shared_lock<std::shared_mutex> l(_dbs_l);
+		for(auto w=_writers.begin();w!=_writers.end();++w) {
+			if ((*w)->db.get() != db) {
+				(*w)->queue.post(new nlohmann::json(member));
+			}
 		}
 	}
 	_listener->onNetworkMemberUpdate(this,networkId,memberId,member);
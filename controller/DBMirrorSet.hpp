@@ -15,6 +15,7 @@
 #define ZT_DBMIRRORSET_HPP
 
 #include "DB.hpp"
+#include "../osdep/BlockingQueue.hpp"
 
 #include <vector>
 #include <memory>
@@ -36,6 +37,7 @@ public:
 	bool get(const uint64_t networkId,nlohmann::json &network,const uint64_t memberId,nlohmann::json &member);
 	bool get(const uint64_t networkId,nlohmann::json &network,const uint64_t memberId,nlohmann::json &member,DB::NetworkSummaryInfo &info);
 	bool get(const uint64_t networkId,nlohmann::json &network,std::vector<nlohmann::json> &members);
+	bool memberRevisions(const uint64_t networkId,std::vector< std::pair<uint64_t,uint64_t> > &revisions);
 
 	void networks(std::set<uint64_t> &networks);
 
@@ -56,15 +58,39 @@ public:
 	inline void addDB(const std::shared_ptr<DB> &db)
 	{
 		db->addListener(this);
+		// Each backend gets its own writer thread so mirror copies of a
+		// change never wait on a slow backend in the caller's thread.
+		std::shared_ptr<_MirrorWriter> w(new _MirrorWriter);
+		w->db = db;
+		w->thread = std::thread([w]() {
+			nlohmann::json *record = (nlohmann::json *)0;
+			while (w->queue.get(record)) {
+				if (record) {
+					try {
+						w->db->save(*record,false);
+					} catch ( ... ) {} // skip records that fail to apply, sync checker will retry
+					delete record;
+				}
+			}
+		});
 		std::unique_lock<std::shared_mutex> l(_dbs_l);
 		_dbs.push_back(db);
+		_writers.push_back(w);
 	}
 
 private:
+	struct _MirrorWriter
+	{
+		std::shared_ptr<DB> db;
+		BlockingQueue< nlohmann::json * > queue;
+		std::thread thread;
+	};
+
 	DB::ChangeListener *const _listener;
 	std::atomic_bool _running;
 	std::thread _syncCheckerThread;
 	std::vector< std::shared_ptr< DB > > _dbs;
+	std::vector< std::shared_ptr<_MirrorWriter> > _writers;
 	mutable std::shared_mutex _dbs_l;
 };
 
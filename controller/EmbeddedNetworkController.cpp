@@ -57,9 +57,31 @@ using json = nlohmann::json;
 // Min duration between requests for an address/nwid combo to prevent floods
 #define ZT_NETCONF_MIN_REQUEST_PERIOD 1000
 
+// Burst allowance of the per (network, member) config request token bucket;
+// tokens replenish at one per ZT_NETCONF_MIN_REQUEST_PERIOD
+#define ZT_NETCONF_REQUEST_GATE_BURST 4
+
+// Upper bound on how long a queued request suppresses duplicates, in case an
+// entry is ever dropped without being processed
+#define ZT_NETCONF_REQUEST_INFLIGHT_TTL 5000
+
+// How long a cached built config blob may be reused; bounds the staleness
+// of the signed credential timestamps embedded in a reused blob
+#define ZT_NETCONF_CACHE_TTL 60000
+
+// Cap on built-config cache entries; when hit the cache is simply cleared
+#define ZT_NETCONF_CACHE_MAX_ENTRIES 65536
+
 // Global maximum size of arrays in JSON objects
 #define ZT_CONTROLLER_MAX_ARRAY_SIZE 16384
 
+// Number of events retained in the HTTP change feed ring
+#define ZT_CONTROLLER_CHANGE_FEED_CAPACITY 4096
+
+// Default and maximum long-poll wait for GET /controller/changes (seconds)
+#define ZT_CONTROLLER_CHANGE_FEED_DEFAULT_TIMEOUT 25
+#define ZT_CONTROLLER_CHANGE_FEED_MAX_TIMEOUT 55
+
 namespace ZeroTier {
 
 namespace {
@@ -460,6 +482,11 @@ static bool _parseRule(json &r,ZT_VirtualNetworkRule &rule)
 
 } // anonymous namespace
 
+bool EmbeddedNetworkController::parseRuleJson(nlohmann::json &r,ZT_VirtualNetworkRule &rule)
+{
+	return _parseRule(r,rule);
+}
+
 EmbeddedNetworkController::EmbeddedNetworkController(Node *node,const char *ztPath,const char *dbPath, int listenPort, RedisConfig *rc) 
 	: _startTime(OSUtils::now())
 	, _listenPort(listenPort)
@@ -470,13 +497,15 @@ EmbeddedNetworkController::EmbeddedNetworkController(Node *node,const char *ztPa
 	, _signingIdAddressString()
 	, _sender((NetworkController::Sender *)0)
 	, _db(this)
-	, _queue()
+	, _queues()
 	, _threads()
 	, _threads_l()
 	, _memberStatus()
 	, _memberStatus_l()
 	, _expiringSoon()
 	, _expiringSoon_l()
+	, _changeFeed()
+	, _changeFeedNextSeq(1)
 	, _rc(rc)
 	, _ssoExpiryRunning(true)
 	, _ssoExpiry(std::thread(&EmbeddedNetworkController::_ssoExpiryThread, this))
@@ -511,7 +540,9 @@ EmbeddedNetworkController::EmbeddedNetworkController(Node *node,const char *ztPa
 EmbeddedNetworkController::~EmbeddedNetworkController()
 {
 	std::lock_guard<std::mutex> l(_threads_l);
-	_queue.stop();
+	for(auto q=_queues.begin();q!=_queues.end();++q) {
+		(*q)->stop();
+	}
 	for(auto t=_threads.begin();t!=_threads.end();++t) {
 		t->join();
 	}
@@ -587,12 +618,11 @@ void EmbeddedNetworkController::request(
 	const int64_t now = OSUtils::now();
 
 	if (requestPacketId) {
-		std::lock_guard<std::mutex> l(_memberStatus_l);
-		_MemberStatus &ms = _memberStatus[_MemberStatusKey(nwid,identity.address().toInt())];
-		if ((now - ms.lastRequestTime) <= ZT_NETCONF_MIN_REQUEST_PERIOD) {
-			return;
+		if (!_checkRequestGate(now,nwid,identity.address().toInt())) {
+			return; // rate limited, or a config build for this member is already queued
 		}
-		ms.lastRequestTime = now;
+		std::lock_guard<std::mutex> l(_memberStatus_l);
+		_memberStatus[_MemberStatusKey(nwid,identity.address().toInt())].lastRequestTime = now;
 	}
 
 	_RQEntry *qe = new _RQEntry;
@@ -602,7 +632,49 @@ void EmbeddedNetworkController::request(
 	qe->identity = identity;
 	qe->metaData = metaData;
 	qe->type = _RQEntry::RQENTRY_TYPE_REQUEST;
-	_queue.post(qe);
+	qe->enqueuedAt = std::chrono::steady_clock::now();
+	// Only the low 24 bits of a network ID vary on a given controller, so
+	// they alone pick the shard.
+	_queues[(unsigned long)(nwid & 0xffffffULL) % _queues.size()]->post(qe);
+}
+
+bool EmbeddedNetworkController::_checkRequestGate(const int64_t now,const uint64_t nwid,const uint64_t nodeId)
+{
+	const _MemberStatusKey key(nwid,nodeId);
+	std::lock_guard<std::mutex> l(_requestGate_l);
+	_RequestGateBucket &b = _requestGate[(unsigned long)(nwid + nodeId) & (ZT_NETCONF_REQUEST_GATE_SIZE - 1)];
+	if (!(b.key == key)) {
+		// Another pair owned this bucket (or it was never used); take it over
+		b.key = key;
+		b.tokens = ZT_NETCONF_REQUEST_GATE_BURST;
+		b.lastRefill = now;
+		b.inFlightUntil = 0;
+	} else if (now > b.lastRefill) {
+		const int64_t refills = (now - b.lastRefill) / ZT_NETCONF_MIN_REQUEST_PERIOD;
+		if (refills > 0) {
+			const int64_t replenished = (int64_t)b.tokens + refills;
+			b.tokens = (replenished > (int64_t)ZT_NETCONF_REQUEST_GATE_BURST) ? (int32_t)ZT_NETCONF_REQUEST_GATE_BURST : (int32_t)replenished;
+			b.lastRefill += refills * ZT_NETCONF_MIN_REQUEST_PERIOD;
+		}
+	}
+	if (b.inFlightUntil > now) {
+		return false; // a config build for this member is already queued
+	}
+	if (b.tokens <= 0) {
+		return false;
+	}
+	--b.tokens;
+	b.inFlightUntil = now + ZT_NETCONF_REQUEST_INFLIGHT_TTL;
+	return true;
+}
+
+void EmbeddedNetworkController::_releaseRequestGate(const uint64_t nwid,const uint64_t nodeId)
+{
+	std::lock_guard<std::mutex> l(_requestGate_l);
+	_RequestGateBucket &b = _requestGate[(unsigned long)(nwid + nodeId) & (ZT_NETCONF_REQUEST_GATE_SIZE - 1)];
+	if (b.key == _MemberStatusKey(nwid,nodeId)) {
+		b.inFlightUntil = 0;
+	}
 }
 
 std::string EmbeddedNetworkController::networkUpdateFromPostData(uint64_t networkID, const std::string &body)
@@ -618,6 +690,9 @@ std::string EmbeddedNetworkController::networkUpdateFromPostData(uint64_t networ
 	if (b.count("name")) network["name"] = OSUtils::jsonString(b["name"],"");
 	if (b.count("private")) network["private"] = OSUtils::jsonBool(b["private"],true);
 	if (b.count("enableBroadcast")) network["enableBroadcast"] = OSUtils::jsonBool(b["enableBroadcast"],false);
+	if (b.count("compressUnicast")) network["compressUnicast"] = OSUtils::jsonBool(b["compressUnicast"],false);
+	if (b.count("enableQos")) network["enableQos"] = OSUtils::jsonBool(b["enableQos"],false);
+	if (b.count("groupKeyedMulticast")) network["groupKeyedMulticast"] = OSUtils::jsonBool(b["groupKeyedMulticast"],false);
 	if (b.count("multicastLimit")) network["multicastLimit"] = OSUtils::jsonInt(b["multicastLimit"],32ULL);
 	if (b.count("mtu")) network["mtu"] = std::max(std::min((unsigned int)OSUtils::jsonInt(b["mtu"],ZT_DEFAULT_MTU),(unsigned int)ZT_MAX_MTU),(unsigned int)ZT_MIN_MTU);
 
@@ -704,6 +779,37 @@ std::string EmbeddedNetworkController::networkUpdateFromPostData(uint64_t networ
 		}
 	}
 
+	if (b.count("trustedPaths")) {
+		json &tps = b["trustedPaths"];
+		if (tps.is_array()) {
+			json ntps = json::array();
+			for(unsigned long i=0;i<tps.size();++i) {
+				json &tp = tps[i];
+				if (tp.is_object()) {
+					json &target = tp["network"];
+					const uint64_t tpid = OSUtils::jsonInt(tp["id"],0ULL);
+					if ((target.is_string())&&(tpid != 0)) {
+						InetAddress t(target.get<std::string>().c_str());
+						const InetAddress::IpScope sc = t.ipScope();
+						// Only private/shared scope subnets may be designated trusted:
+						// members refuse anything else too, but reject it here so the
+						// API surfaces the mistake instead of silently ignoring it
+						if ( ((t.ss_family == AF_INET)||(t.ss_family == AF_INET6)) && (t.netmaskBitsValid()) && ((sc == InetAddress::IP_SCOPE_PRIVATE)||(sc == InetAddress::IP_SCOPE_SHARED)) ) {
+							json tmp;
+							char tmp2[64];
+							tmp["network"] = t.toString(tmp2);
+							tmp["id"] = tpid;
+							ntps.push_back(tmp);
+							if (ntps.size() >= ZT_MAX_NETWORK_TRUSTED_PATHS)
+								break;
+						}
+					}
+				}
+			}
+			network["trustedPaths"] = ntps;
+		}
+	}
+
 	if (b.count("ipAssignmentPools")) {
 		json &ipp = b["ipAssignmentPools"];
 		if (ipp.is_array()) {
@@ -861,6 +967,109 @@ std::string EmbeddedNetworkController::networkUpdateFromPostData(uint64_t networ
 	return network.dump();
 }
 
+nlohmann::json EmbeddedNetworkController::memberUpdateFromPostData(uint64_t nwid, uint64_t memberId, nlohmann::json &b)
+{
+	char networkID[24],memberID[24];
+	OSUtils::ztsnprintf(networkID, sizeof(networkID), "%.16llx", (unsigned long long)nwid);
+	OSUtils::ztsnprintf(memberID, sizeof(memberID), "%.10llx", (unsigned long long)memberId);
+
+	json network;
+	json member;
+	_db.get(nwid, network, memberId, member);
+	DB::initMember(member);
+
+	if (b.count("activeBridge")) member["activeBridge"] = OSUtils::jsonBool(b["activeBridge"], false);
+	if (b.count("noAutoAssignIps")) member["noAutoAssignIps"] = OSUtils::jsonBool(b["noAutoAssignIps"], false);
+	if (b.count("authenticationExpiryTime")) member["authenticationExpiryTime"] = (uint64_t)OSUtils::jsonInt(b["authenticationExpiryTime"], 0ULL);
+	if (b.count("authenticationURL")) member["authenticationURL"] = OSUtils::jsonString(b["authenticationURL"], "");
+
+	if (b.count("remoteTraceTarget")) {
+		const std::string rtt(OSUtils::jsonString(b["remoteTraceTarget"],""));
+		if (rtt.length() == 10) {
+			member["remoteTraceTarget"] = rtt;
+		} else {
+			member["remoteTraceTarget"] = json();
+		}
+	}
+	if (b.count("remoteTraceLevel")) member["remoteTraceLevel"] = OSUtils::jsonInt(b["remoteTraceLevel"],0ULL);
+
+	if (b.count("authorized")) {
+		const bool newAuth = OSUtils::jsonBool(b["authorized"],false);
+		if (newAuth != OSUtils::jsonBool(member["authorized"],false)) {
+			member["authorized"] = newAuth;
+			member[((newAuth) ? "lastAuthorizedTime" : "lastDeauthorizedTime")] = OSUtils::now();
+			if (newAuth) {
+				member["lastAuthorizedCredentialType"] = "api";
+				member["lastAuthorizedCredential"] = json();
+			}
+		}
+	}
+
+	if (b.count("ipAssignments")) {
+		json &ipa = b["ipAssignments"];
+		if (ipa.is_array()) {
+			json mipa(json::array());
+			for(unsigned long i=0;i<ipa.size();++i) {
+				std::string ips = ipa[i];
+				InetAddress ip(ips.c_str());
+				if ((ip.ss_family == AF_INET)||(ip.ss_family == AF_INET6)) {
+					char tmpip[64];
+					mipa.push_back(ip.toIpString(tmpip));
+					if (mipa.size() >= ZT_CONTROLLER_MAX_ARRAY_SIZE)
+						break;
+				}
+			}
+			member["ipAssignments"] = mipa;
+		}
+	}
+
+	if (b.count("tags")) {
+		json &tags = b["tags"];
+		if (tags.is_array()) {
+			std::map<uint64_t,uint64_t> mtags;
+			for(unsigned long i=0;i<tags.size();++i) {
+				json &tag = tags[i];
+				if ((tag.is_array())&&(tag.size() == 2))
+					mtags[OSUtils::jsonInt(tag[0],0ULL) & 0xffffffffULL] = OSUtils::jsonInt(tag[1],0ULL) & 0xffffffffULL;
+			}
+			json mtagsa = json::array();
+			for(std::map<uint64_t,uint64_t>::iterator t(mtags.begin());t!=mtags.end();++t) {
+				json ta = json::array();
+				ta.push_back(t->first);
+				ta.push_back(t->second);
+				mtagsa.push_back(ta);
+				if (mtagsa.size() >= ZT_CONTROLLER_MAX_ARRAY_SIZE)
+					break;
+			}
+			member["tags"] = mtagsa;
+		}
+	}
+
+	if (b.count("capabilities")) {
+		json &capabilities = b["capabilities"];
+		if (capabilities.is_array()) {
+			json mcaps = json::array();
+			for(unsigned long i=0;i<capabilities.size();++i) {
+				mcaps.push_back(OSUtils::jsonInt(capabilities[i],0ULL));
+				if (mcaps.size() >= ZT_CONTROLLER_MAX_ARRAY_SIZE)
+					break;
+			}
+			std::sort(mcaps.begin(),mcaps.end());
+			mcaps.erase(std::unique(mcaps.begin(),mcaps.end()),mcaps.end());
+			member["capabilities"] = mcaps;
+		}
+	}
+
+	member["id"] = memberID;
+	member["address"] = memberID;
+	member["nwid"] = networkID;
+
+	DB::cleanMember(member);
+	_db.save(member, true);
+
+	return member;
+}
+
 void EmbeddedNetworkController::configureHTTPControlPlane(
 	httplib::Server &s,
 	const std::function<void(const httplib::Request&, httplib::Response&, std::string)> setContent)
@@ -967,20 +1176,85 @@ void EmbeddedNetworkController::configureHTTPControlPlane(
 			return;
 		}
 
+		// Use the compact (id, revision) index instead of copying every
+		// member's full JSON just to emit this summary.
 		json out = json::array();
-		std::vector<json> memTmp;
-		if (_db.get(nwid, network, memTmp)) {
-			for (auto m = memTmp.begin(); m != memTmp.end(); ++m) {
-				int revision = OSUtils::jsonInt((*m)["revision"], 0);
-				std::string id = OSUtils::jsonString((*m)["id"], "");
-				if (id.length() == 10) {
-					json tmp = json::object();
-					tmp[id] = revision;
-					out.push_back(tmp);
+		std::vector< std::pair<uint64_t,uint64_t> > revs;
+		if (_db.memberRevisions(nwid, revs)) {
+			char memTmp[64];
+			for (auto m = revs.begin(); m != revs.end(); ++m) {
+				OSUtils::ztsnprintf(memTmp, sizeof(memTmp), "%.10llx", (unsigned long long)m->first);
+				json tmp = json::object();
+				tmp[memTmp] = m->second;
+				out.push_back(tmp);
+			}
+		}
+
+		setContent(req, res, out.dump());
+	});
+
+	// Long-poll change feed: pass the "cursor" from the previous response to
+	// receive only networks/members changed since then. cursor=0 (or absent)
+	// returns the current head immediately so a consumer can start tailing;
+	// "resync": true means the cursor fell off the ring and full lists should
+	// be re-fetched before tailing again.
+	s.Get("/controller/changes", [&, setContent](const httplib::Request &req, httplib::Response &res) {
+		uint64_t cursor = 0;
+		if (req.has_param("cursor"))
+			cursor = (uint64_t)strtoull(req.get_param_value("cursor").c_str(),(char **)0,10);
+		long timeoutSec = ZT_CONTROLLER_CHANGE_FEED_DEFAULT_TIMEOUT;
+		if (req.has_param("timeout"))
+			timeoutSec = strtol(req.get_param_value("timeout").c_str(),(char **)0,10);
+		if (timeoutSec < 0)
+			timeoutSec = 0;
+		if (timeoutSec > ZT_CONTROLLER_CHANGE_FEED_MAX_TIMEOUT)
+			timeoutSec = ZT_CONTROLLER_CHANGE_FEED_MAX_TIMEOUT;
+
+		char tmp[64];
+		json events = json::array();
+		bool resync = false;
+		uint64_t head;
+
+		{
+			std::unique_lock<std::mutex> l(_changeFeed_l);
+			head = _changeFeedNextSeq - 1;
+			if (cursor == 0) {
+				// Bootstrap: hand back the current head without waiting
+				cursor = head;
+			} else {
+				if (head <= cursor) {
+					const std::chrono::steady_clock::time_point deadline(std::chrono::steady_clock::now() + std::chrono::seconds(timeoutSec));
+					_changeFeed_c.wait_until(l,deadline,[this,cursor] { return ((_changeFeedNextSeq - 1) > cursor); });
+					head = _changeFeedNextSeq - 1;
+				}
+				if (head > cursor) {
+					if ((_changeFeed.empty())||(_changeFeed.front().seq > (cursor + 1))) {
+						resync = true; // events between the cursor and the ring tail were dropped
+					}
+					for(std::deque<_ChangeFeedEvent>::const_iterator ev(_changeFeed.begin());ev!=_changeFeed.end();++ev) {
+						if (ev->seq > cursor) {
+							json e = json::object();
+							e["seq"] = ev->seq;
+							e["ts"] = ev->ts;
+							OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.16llx",(unsigned long long)ev->networkId);
+							e["network"] = tmp;
+							if (ev->memberId) {
+								OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.10llx",(unsigned long long)ev->memberId);
+								e["member"] = tmp;
+							}
+							events.push_back(e);
+						}
+					}
+					cursor = head;
 				}
 			}
 		}
 
+		json out = json::object();
+		out["cursor"] = cursor;
+		out["events"] = events;
+		if (resync)
+			out["resync"] = true;
 		setContent(req, res, out.dump());
 	});
 
@@ -1004,106 +1278,50 @@ void EmbeddedNetworkController::configureHTTPControlPlane(
 		auto memberID = req.matches[2].str();
 		uint64_t nwid = Utils::hexStrToU64(networkID.c_str());
 		uint64_t memid = Utils::hexStrToU64(memberID.c_str());
-		json network;
-		json member;
-		_db.get(nwid, network, memid, member);
-		DB::initMember(member);
 
 		json b = OSUtils::jsonParse(req.body);
+		json member = memberUpdateFromPostData(nwid, memid, b);
 
-		if (b.count("activeBridge")) member["activeBridge"] = OSUtils::jsonBool(b["activeBridge"], false);
-		if (b.count("noAutoAssignIps")) member["noAutoAssignIps"] = OSUtils::jsonBool(b["noAutoAssignIps"], false);
-		if (b.count("authenticationExpiryTime")) member["authenticationExpiryTime"] = (uint64_t)OSUtils::jsonInt(b["authenticationExpiryTime"], 0ULL);
-		if (b.count("authenticationURL")) member["authenticationURL"] = OSUtils::jsonString(b["authenticationURL"], "");
-
-		if (b.count("remoteTraceTarget")) {
-			const std::string rtt(OSUtils::jsonString(b["remoteTraceTarget"],""));
-			if (rtt.length() == 10) {
-				member["remoteTraceTarget"] = rtt;
-			} else {
-				member["remoteTraceTarget"] = json();
-			}
-		}
-		if (b.count("remoteTraceLevel")) member["remoteTraceLevel"] = OSUtils::jsonInt(b["remoteTraceLevel"],0ULL);
+		setContent(req, res, member.dump());
+	};
+	s.Put("/controller/network/([0-9a-fA-F]{16})/member/([0-9a-fA-F]{10})", memberPost);
+	s.Post("/controller/network/([0-9a-fA-F]{16})/member/([0-9a-fA-F]{10})", memberPost);
 
-		if (b.count("authorized")) {
-			const bool newAuth = OSUtils::jsonBool(b["authorized"],false);
-			if (newAuth != OSUtils::jsonBool(member["authorized"],false)) {
-				member["authorized"] = newAuth;
-				member[((newAuth) ? "lastAuthorizedTime" : "lastDeauthorizedTime")] = OSUtils::now();
-				if (newAuth) {
-					member["lastAuthorizedCredentialType"] = "api";
-					member["lastAuthorizedCredential"] = json();
-				}
-			}
-		}
+	// Bulk member provisioning: accepts a JSON array of member objects, each
+	// carrying its own "id" (or "address"), so onboarding thousands of
+	// members is one request body parsed once instead of one HTTP round trip
+	// and body parse per member. Saves go through the DB layer's normal
+	// queued persistence, which batches them on backends that support it.
+	s.Post("/controller/network/([0-9a-fA-F]{16})/member", [&, setContent](const httplib::Request &req, httplib::Response &res) {
+		auto networkID = req.matches[1].str();
+		uint64_t nwid = Utils::hexStrToU64(networkID.c_str());
 
-		if (b.count("ipAssignments")) {
-			json &ipa = b["ipAssignments"];
-			if (ipa.is_array()) {
-				json mipa(json::array());
-				for(unsigned long i=0;i<ipa.size();++i) {
-					std::string ips = ipa[i];
-					InetAddress ip(ips.c_str());
-					if ((ip.ss_family == AF_INET)||(ip.ss_family == AF_INET6)) {
-						char tmpip[64];
-						mipa.push_back(ip.toIpString(tmpip));
-						if (mipa.size() >= ZT_CONTROLLER_MAX_ARRAY_SIZE)
-							break;
-					}
-				}
-				member["ipAssignments"] = mipa;
-			}
+		json network;
+		if (!_db.get(nwid, network)) {
+			res.status = 404;
+			return;
 		}
 
-		if (b.count("tags")) {
-			json &tags = b["tags"];
-			if (tags.is_array()) {
-				std::map<uint64_t,uint64_t> mtags;
-				for(unsigned long i=0;i<tags.size();++i) {
-					json &tag = tags[i];
-					if ((tag.is_array())&&(tag.size() == 2))
-						mtags[OSUtils::jsonInt(tag[0],0ULL) & 0xffffffffULL] = OSUtils::jsonInt(tag[1],0ULL) & 0xffffffffULL;
-				}
-				json mtagsa = json::array();
-				for(std::map<uint64_t,uint64_t>::iterator t(mtags.begin());t!=mtags.end();++t) {
-					json ta = json::array();
-					ta.push_back(t->first);
-					ta.push_back(t->second);
-					mtagsa.push_back(ta);
-					if (mtagsa.size() >= ZT_CONTROLLER_MAX_ARRAY_SIZE)
-						break;
-				}
-				member["tags"] = mtagsa;
-			}
+		json b = OSUtils::jsonParse(req.body);
+		if (!b.is_array()) {
+			res.status = 400;
+			return;
 		}
 
-		if (b.count("capabilities")) {
-			json &capabilities = b["capabilities"];
-			if (capabilities.is_array()) {
-				json mcaps = json::array();
-				for(unsigned long i=0;i<capabilities.size();++i) {
-					mcaps.push_back(OSUtils::jsonInt(capabilities[i],0ULL));
-					if (mcaps.size() >= ZT_CONTROLLER_MAX_ARRAY_SIZE)
-						break;
-				}
-				std::sort(mcaps.begin(),mcaps.end());
-				mcaps.erase(std::unique(mcaps.begin(),mcaps.end()),mcaps.end());
-				member["capabilities"] = mcaps;
-			}
+		json out = json::array();
+		for(unsigned long i=0;i<b.size();++i) {
+			json &mb = b[i];
+			if (!mb.is_object())
+				continue;
+			const std::string memberID(OSUtils::jsonString(mb.count("id") ? mb["id"] : mb["address"], ""));
+			const uint64_t memid = Utils::hexStrToU64(memberID.c_str());
+			if (!memid)
+				continue;
+			out.push_back(memberUpdateFromPostData(nwid, memid, mb));
 		}
 
-		member["id"] = memberID;
-		member["address"] = memberID;
-		member["nwid"] = networkID;
-
-		DB::cleanMember(member);
-		_db.save(member, true);
-
-		setContent(req, res, member.dump());
-	};
-	s.Put("/controller/network/([0-9a-fA-F]{16})/member/([0-9a-fA-F]{10})", memberPost);
-	s.Post("/controller/network/([0-9a-fA-F]{16})/member/([0-9a-fA-F]{10})", memberPost);
+		setContent(req, res, out.dump());
+	});
 
 	s.Delete("/controller/network/([0-9a-fA-F]{16})/member/([0-9a-fA-F]{10})", [&, setContent](const httplib::Request &req, httplib::Response &res) {
 		auto networkID = req.matches[1].str();
@@ -1179,8 +1397,26 @@ void EmbeddedNetworkController::handleRemoteTrace(const ZT_RemoteTrace &rt)
 	}
 }
 
+void EmbeddedNetworkController::_changeFeedAppend(const uint64_t networkId,const uint64_t memberId)
+{
+	{
+		std::lock_guard<std::mutex> l(_changeFeed_l);
+		_ChangeFeedEvent ev;
+		ev.seq = _changeFeedNextSeq++;
+		ev.ts = OSUtils::now();
+		ev.networkId = networkId;
+		ev.memberId = memberId;
+		_changeFeed.push_back(ev);
+		while (_changeFeed.size() > ZT_CONTROLLER_CHANGE_FEED_CAPACITY)
+			_changeFeed.pop_front();
+	}
+	_changeFeed_c.notify_all();
+}
+
 void EmbeddedNetworkController::onNetworkUpdate(const void *db,uint64_t networkId,const nlohmann::json &network)
 {
+	_changeFeedAppend(networkId,0);
+
 	// Send an update to all members of the network that are online
 	const int64_t now = OSUtils::now();
 	std::lock_guard<std::mutex> l(_memberStatus_l);
@@ -1192,6 +1428,8 @@ void EmbeddedNetworkController::onNetworkUpdate(const void *db,uint64_t networkI
 
 void EmbeddedNetworkController::onNetworkMemberUpdate(const void *db,uint64_t networkId,uint64_t memberId,const nlohmann::json &member)
 {
+	_changeFeedAppend(networkId,memberId);
+
 	// Push update to member if online
 	try {
 		std::lock_guard<std::mutex> l(_memberStatus_l);
@@ -1223,6 +1461,9 @@ void EmbeddedNetworkController::_request(
 	const Dictionary<ZT_NETWORKCONFIG_METADATA_DICT_CAPACITY> &metaData)
 {
 	Metrics::network_config_request++;
+	const std::chrono::steady_clock::time_point rqStart(std::chrono::steady_clock::now());
+	int64_t dbUs = 0;
+	int64_t signUs = 0;
 	auto tid = std::this_thread::get_id();
 	std::stringstream ss; ss << tid;
 	std::string threadID = ss.str();
@@ -1260,7 +1501,10 @@ void EmbeddedNetworkController::_request(
 	b3.start();
 #endif
 	Utils::hex(nwid,nwids);
-	_db.get(nwid,network,identity.address().toInt(),member,ns);
+	{
+		Metrics::PhaseAccumulator _dbt(dbUs);
+		_db.get(nwid,network,identity.address().toInt(),member,ns);
+	}
 	if ((!network.is_object())||(network.empty())) {
 		_sender->ncSendError(nwid,requestPacketId,identity.address(),NetworkController::NC_ERROR_OBJECT_NOT_FOUND, nullptr, 0);
 #ifdef CENTRAL_CONTROLLER_REQUEST_BENCHMARK
@@ -1465,6 +1709,37 @@ void EmbeddedNetworkController::_request(
 	// If we made it this far, they are authorized (and authenticated).
 	// -------------------------------------------------------------------------
 
+	// A repeat request from an unchanged member on an unchanged network can
+	// be answered with the blob built for the previous request. SSO networks
+	// are excluded because their configs embed time-dependent authentication
+	// state, and the controller's own member is excluded because the local
+	// config path consumes the NetworkConfig object itself.
+	const uint64_t networkRevision = OSUtils::jsonInt(network["revision"],0ULL);
+	const uint64_t memberRevision = OSUtils::jsonInt(member["revision"],0ULL);
+	const uint64_t senderVersion = metaData.getUI(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_VERSION,0);
+	const bool ncCacheable = ((!networkSSOEnabled)&&(identity.address() != _signingId.address()));
+	if (ncCacheable) {
+		std::string cachedDict;
+		{
+			std::lock_guard<std::mutex> l(_ncCache_l);
+			std::unordered_map< _MemberStatusKey,_NCCacheEntry,_MemberStatusHash >::const_iterator ce(_ncCache.find(_MemberStatusKey(nwid,identity.address().toInt())));
+			if ( (ce != _ncCache.end()) &&
+			     (ce->second.networkRevision == networkRevision) &&
+			     (ce->second.memberRevision == memberRevision) &&
+			     (ce->second.senderVersion == senderVersion) &&
+			     ((now - ce->second.buildTime) < ZT_NETCONF_CACHE_TTL) ) {
+				cachedDict = ce->second.dict;
+			}
+		}
+		if (!cachedDict.empty()) {
+			Metrics::network_config_cache_hit++;
+			DB::cleanMember(member);
+			_db.save(member,true);
+			_sender->ncSendConfigBlob(nwid,requestPacketId,identity.address(),cachedDict.data(),(unsigned int)cachedDict.length());
+			return;
+		}
+	}
+
 	// Default timeout: 15 minutes. Maximum: two hours. Can be specified by an optional field in the network config
 	// if something longer than 15 minutes is desired. Minimum is 5 minutes since shorter than that would be flaky.
 #ifdef CENTRAL_CONTROLLER_REQUEST_BENCHMARK
@@ -1488,6 +1763,9 @@ void EmbeddedNetworkController::_request(
 	nc->revision = OSUtils::jsonInt(network["revision"],0ULL);
 	nc->issuedTo = identity.address();
 	if (OSUtils::jsonBool(network["enableBroadcast"],true)) nc->flags |= ZT_NETWORKCONFIG_FLAG_ENABLE_BROADCAST;
+	if (OSUtils::jsonBool(network["compressUnicast"],false)) nc->flags |= ZT_NETWORKCONFIG_FLAG_ENABLE_UNICAST_COMPRESSION;
+	if (OSUtils::jsonBool(network["enableQos"],false)) nc->flags |= ZT_NETWORKCONFIG_FLAG_ENABLE_QOS;
+	if (OSUtils::jsonBool(network["groupKeyedMulticast"],false)) nc->flags |= ZT_NETWORKCONFIG_FLAG_ENABLE_GROUP_KEYED_MULTICAST;
 	Utils::scopy(nc->name,sizeof(nc->name),OSUtils::jsonString(network["name"],"").c_str());
 	nc->mtu = std::max(std::min((unsigned int)OSUtils::jsonInt(network["mtu"],ZT_DEFAULT_MTU),(unsigned int)ZT_MAX_MTU),(unsigned int)ZT_MIN_MTU);
 	nc->multicastLimit = (unsigned int)OSUtils::jsonInt(network["multicastLimit"],32ULL);
@@ -1548,6 +1826,7 @@ void EmbeddedNetworkController::_request(
 	json &v6AssignMode = network["v6AssignMode"];
 	json &ipAssignmentPools = network["ipAssignmentPools"];
 	json &routes = network["routes"];
+	json &trustedPaths = network["trustedPaths"];
 	json &rules = network["rules"];
 	json &capabilities = network["capabilities"];
 	json &tags = network["tags"];
@@ -1614,7 +1893,12 @@ void EmbeddedNetworkController::_request(
 						}
 					}
 					nc->capabilities[nc->capabilityCount] = Capability((uint32_t)capId,nwid,now,1,capr,caprc);
-					if (nc->capabilities[nc->capabilityCount].sign(_signingId,identity.address()))
+					bool capSigned;
+					{
+						Metrics::PhaseAccumulator _st(signUs);
+						capSigned = nc->capabilities[nc->capabilityCount].sign(_signingId,identity.address());
+					}
+					if (capSigned)
 						++nc->capabilityCount;
 					if (nc->capabilityCount >= ZT_MAX_NETWORK_CAPABILITIES)
 						break;
@@ -1650,11 +1934,37 @@ void EmbeddedNetworkController::_request(
 			if (nc->tagCount >= ZT_MAX_NETWORK_TAGS)
 				break;
 			nc->tags[nc->tagCount] = Tag(nwid,now,identity.address(),t->first,t->second);
-			if (nc->tags[nc->tagCount].sign(_signingId))
+			bool tagSigned;
+			{
+				Metrics::PhaseAccumulator _st(signUs);
+				tagSigned = nc->tags[nc->tagCount].sign(_signingId);
+			}
+			if (tagSigned)
 				++nc->tagCount;
 		}
 	}
 
+	if (trustedPaths.is_array()) {
+		for(unsigned long i=0;i<trustedPaths.size();++i) {
+			if (nc->trustedPathCount >= ZT_MAX_NETWORK_TRUSTED_PATHS)
+				break;
+			json &tp = trustedPaths[i];
+			if (tp.is_object()) {
+				json &target = tp["network"];
+				const uint64_t tpid = OSUtils::jsonInt(tp["id"],0ULL);
+				if ((target.is_string())&&(tpid != 0)) {
+					const InetAddress t(target.get<std::string>().c_str());
+					const InetAddress::IpScope sc = t.ipScope();
+					if ( ((t.ss_family == AF_INET)||(t.ss_family == AF_INET6)) && ((sc == InetAddress::IP_SCOPE_PRIVATE)||(sc == InetAddress::IP_SCOPE_SHARED)) ) {
+						nc->trustedPathNetworks[nc->trustedPathCount] = t;
+						nc->trustedPathIds[nc->trustedPathCount] = tpid;
+						++nc->trustedPathCount;
+					}
+				}
+			}
+		}
+	}
+
 	if (routes.is_array()) {
 		for(unsigned long i=0;i<routes.size();++i) {
 			if (nc->routeCount >= ZT_MAX_NETWORK_ROUTES)
@@ -1878,12 +2188,20 @@ void EmbeddedNetworkController::_request(
 		for(unsigned int i=0;i<nc->staticIpCount;++i) {
 			nc->certificatesOfOwnership[0].addThing(nc->staticIps[i]);
 		}
-		nc->certificatesOfOwnership[0].sign(_signingId);
+		{
+			Metrics::PhaseAccumulator _st(signUs);
+			nc->certificatesOfOwnership[0].sign(_signingId);
+		}
 		nc->certificateOfOwnershipCount = 1;
 	}
 
 	CertificateOfMembership com(now,credentialtmd,nwid,identity);
-	if (com.sign(_signingId)) {
+	bool comSigned;
+	{
+		Metrics::PhaseAccumulator _st(signUs);
+		comSigned = com.sign(_signingId);
+	}
+	if (comSigned) {
 		nc->com = com;
 	} else {
 		_sender->ncSendError(nwid,requestPacketId,identity.address(),NetworkController::NC_ERROR_INTERNAL_SERVER_ERROR, nullptr, 0);
@@ -1910,7 +2228,39 @@ void EmbeddedNetworkController::_request(
 	c11++;
 	b11.start();
 #endif
-	_sender->ncSendConfig(nwid,requestPacketId,identity.address(),*(nc.get()),metaData.getUI(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_VERSION,0) < 6);
+	if (ncCacheable) {
+		Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *dconf = new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>();
+		try {
+			if (nc->toDictionary(*dconf,(senderVersion < 6))) {
+				_sender->ncSendConfigBlob(nwid,requestPacketId,identity.address(),dconf->data(),dconf->sizeBytes());
+				std::lock_guard<std::mutex> l(_ncCache_l);
+				if (_ncCache.size() >= ZT_NETCONF_CACHE_MAX_ENTRIES) {
+					_ncCache.clear();
+				}
+				_NCCacheEntry &ce = _ncCache[_MemberStatusKey(nwid,identity.address().toInt())];
+				ce.networkRevision = networkRevision;
+				ce.memberRevision = memberRevision;
+				ce.senderVersion = senderVersion;
+				ce.buildTime = now;
+				ce.dict.assign(dconf->data(),dconf->sizeBytes());
+			}
+			delete dconf;
+		} catch ( ... ) {
+			delete dconf;
+			throw;
+		}
+	} else {
+		_sender->ncSendConfig(nwid,requestPacketId,identity.address(),*(nc.get()),(senderVersion < 6));
+	}
+
+	// Phase histograms for the completed build; "build" is everything not
+	// attributable to the DB read or a signature operation
+	const int64_t totalUs = (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - rqStart).count();
+	const int64_t buildUs = totalUs - dbUs - signUs;
+	Metrics::ctrl_request_db_us.Observe((uint64_t)dbUs);
+	Metrics::ctrl_request_sign_us.Observe((uint64_t)signUs);
+	Metrics::ctrl_request_build_us.Observe((uint64_t)((buildUs > 0) ? buildUs : 0));
+	Metrics::ctrl_request_total_us.Observe((uint64_t)totalUs);
 #ifdef CENTRAL_CONTROLLER_REQUEST_BENCHMARK
 	b11.stop();
 #endif
@@ -1924,25 +2274,42 @@ void EmbeddedNetworkController::_startThreads()
 	}
 	const long hwc = std::max((long)std::thread::hardware_concurrency(),(long)1);
 	for(long t=0;t<hwc;++t) {
-		_threads.emplace_back([this]() {
+		_queues.push_back(std::unique_ptr< BlockingQueue<_RQEntry *> >(new BlockingQueue<_RQEntry *>()));
+	}
+	for(long t=0;t<hwc;++t) {
+		_threads.emplace_back([this,t]() {
+			BlockingQueue<_RQEntry *> &queue = *(_queues[t]);
 			Metrics::network_config_request_threads++;
+			std::vector<_RQEntry *> batch;
 			for(;;) {
-				_RQEntry *qe = (_RQEntry *)0;
-				Metrics::network_config_request_queue_size = _queue.size();
-				auto timedWaitResult = _queue.get(qe, 1000);
+				if (t == 0) {
+					unsigned long qs = 0;
+					for(auto q=_queues.begin();q!=_queues.end();++q)
+						qs += (unsigned long)(*q)->size();
+					Metrics::network_config_request_queue_size = qs;
+				}
+				// Pull everything pending (up to a bound) in one lock cycle so
+				// a backlogged queue costs one wakeup per batch, not per entry.
+				batch.clear();
+				auto timedWaitResult = queue.get(batch, 16, 1000);
 				if (timedWaitResult == BlockingQueue<_RQEntry *>::STOP) {
 					break;
 				} else if (timedWaitResult == BlockingQueue<_RQEntry *>::OK) {
-					if (qe) {
-						try {
-							_request(qe->nwid,qe->fromAddr,qe->requestPacketId,qe->identity,qe->metaData);
-						} catch (std::exception &e) {
-							fprintf(stderr,"ERROR: exception in controller request handling thread: %s" ZT_EOL_S,e.what());
-						} catch ( ... ) {
-							fprintf(stderr,"ERROR: exception in controller request handling thread: unknown exception" ZT_EOL_S);
+					for(auto qe=batch.begin();qe!=batch.end();++qe) {
+						if (*qe) {
+							Metrics::ctrl_request_queue_wait_us.Observe((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - (*qe)->enqueuedAt).count());
+							try {
+								_request((*qe)->nwid,(*qe)->fromAddr,(*qe)->requestPacketId,(*qe)->identity,(*qe)->metaData);
+							} catch (std::exception &e) {
+								fprintf(stderr,"ERROR: exception in controller request handling thread: %s" ZT_EOL_S,e.what());
+							} catch ( ... ) {
+								fprintf(stderr,"ERROR: exception in controller request handling thread: unknown exception" ZT_EOL_S);
+							}
+							if ((*qe)->requestPacketId) {
+								_releaseRequestGate((*qe)->nwid,(*qe)->identity.address().toInt());
+							}
+							delete *qe;
 						}
-						delete qe;
-						qe = nullptr;
 					}
 				}
 			}
@@ -22,8 +22,13 @@
 #include <set>
 #include <list>
 #include <thread>
+#include <chrono>
 #include <unordered_map>
 #include <atomic>
+#include <memory>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 
 #include "../node/Constants.hpp"
 #include "../node/NetworkController.hpp"
@@ -42,6 +47,9 @@
 #include "DB.hpp"
 #include "DBMirrorSet.hpp"
 
+// Size of the per (network, member) config request gate table (power of two)
+#define ZT_NETCONF_REQUEST_GATE_SIZE 16384
+
 namespace ZeroTier {
 
 class Node;
@@ -78,12 +86,25 @@ public:
 	virtual void onNetworkMemberUpdate(const void *db,uint64_t networkId,uint64_t memberId,const nlohmann::json &member);
 	virtual void onNetworkMemberDeauthorize(const void *db,uint64_t networkId,uint64_t memberId);
 
+	/**
+	 * Parse one rule from its JSON representation (exposed for the offline rules benchmark)
+	 *
+	 * @param r Rule in the controller's JSON rule format
+	 * @param rule Filled with the parsed rule on success
+	 * @return True if the rule was recognized and parsed
+	 */
+	static bool parseRuleJson(nlohmann::json &r,ZT_VirtualNetworkRule &rule);
+
 private:
 	void _request(uint64_t nwid,const InetAddress &fromAddr,uint64_t requestPacketId,const Identity &identity,const Dictionary<ZT_NETWORKCONFIG_METADATA_DICT_CAPACITY> &metaData);
 	void _startThreads();
 	void _ssoExpiryThread();
 
+	bool _checkRequestGate(const int64_t now,const uint64_t nwid,const uint64_t nodeId);
+	void _releaseRequestGate(const uint64_t nwid,const uint64_t nodeId);
+
 	std::string networkUpdateFromPostData(uint64_t networkID, const std::string &body);
+	nlohmann::json memberUpdateFromPostData(uint64_t nwid, uint64_t memberId, nlohmann::json &b);
 
 	struct _RQEntry
 	{
@@ -92,6 +113,7 @@ private:
 		InetAddress fromAddr;
 		Identity identity;
 		Dictionary<ZT_NETWORKCONFIG_METADATA_DICT_CAPACITY> metaData;
+		std::chrono::steady_clock::time_point enqueuedAt; // for the queue_wait phase histogram
 		enum {
 			RQENTRY_TYPE_REQUEST = 0
 		} type;
@@ -134,7 +156,13 @@ private:
 	NetworkController::Sender *_sender;
 
 	DBMirrorSet _db;
-	BlockingQueue< _RQEntry * > _queue;
+
+	// Config requests are sharded by network ID across one queue per worker
+	// thread. All requests for a given network land on the same shard, which
+	// keeps that network's state warm in one core's cache and prevents a
+	// request storm on one busy network from stalling config builds for every
+	// other network behind a single queue lock.
+	std::vector< std::unique_ptr< BlockingQueue< _RQEntry * > > > _queues;
 
 	std::vector<std::thread> _threads;
 	std::mutex _threads_l;
@@ -142,9 +170,63 @@ private:
 	std::unordered_map< _MemberStatusKey,_MemberStatus,_MemberStatusHash > _memberStatus;
 	std::mutex _memberStatus_l;
 
+	// Cache of built and serialized network config dictionaries, keyed by
+	// (network, member) with the record revisions and sender version the
+	// blob was built against. Revisions only advance when a save actually
+	// changes a record, so a revision mismatch is an exact invalidation
+	// signal; no explicit change hooks are needed.
+	struct _NCCacheEntry
+	{
+		_NCCacheEntry() : networkRevision(0),memberRevision(0),senderVersion(0),buildTime(0) {}
+		uint64_t networkRevision;
+		uint64_t memberRevision;
+		uint64_t senderVersion;
+		int64_t buildTime;
+		std::string dict;
+	};
+	std::unordered_map< _MemberStatusKey,_NCCacheEntry,_MemberStatusHash > _ncCache;
+	std::mutex _ncCache_l;
+
+	// Per (network, member) config request gate: a token bucket plus
+	// deduplication of requests whose config build is still queued, in a
+	// fixed-size table so a storm of requests from junk identities cannot
+	// grow any state. A colliding pair takes over the bucket, so a
+	// collision only weakens rate limiting and never blocks the wrong
+	// member.
+	struct _RequestGateBucket
+	{
+		_RequestGateBucket() : key(),tokens(0),lastRefill(0),inFlightUntil(0) {}
+		_MemberStatusKey key;
+		int32_t tokens;
+		int64_t lastRefill;
+		int64_t inFlightUntil; // nonzero while a config build for this member is queued
+	};
+	_RequestGateBucket _requestGate[ZT_NETCONF_REQUEST_GATE_SIZE];
+	std::mutex _requestGate_l;
+
 	std::set< std::pair<int64_t, _MemberStatusKey> > _expiringSoon;
 	std::mutex _expiringSoon_l;
 
+	// Monotonic change feed for the HTTP control plane: every network or
+	// member update from the DB change hooks appends an event here, and
+	// GET /controller/changes long-polls against a cursor so provisioning
+	// systems receive deltas instead of re-polling full member lists. The
+	// ring is bounded; a consumer whose cursor falls off the tail is told
+	// to resync from the full lists.
+	struct _ChangeFeedEvent
+	{
+		uint64_t seq;
+		int64_t ts;
+		uint64_t networkId;
+		uint64_t memberId; // 0 for network-level events
+	};
+	std::deque<_ChangeFeedEvent> _changeFeed;
+	uint64_t _changeFeedNextSeq;
+	std::mutex _changeFeed_l;
+	std::condition_variable _changeFeed_c;
+
+	void _changeFeedAppend(const uint64_t networkId,const uint64_t memberId);
+
 	RedisConfig *_rc;
 	std::string _ssoRedirectURL;
 
@@ -15,6 +15,40 @@
 
 #include "../node/Metrics.hpp"
 
+#ifdef __WINDOWS__
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
+/**
+ * How often journaled writes are made durable with a single fsync (ms)
+ */
+#define ZT_CONTROLLER_FILEDB_JOURNAL_SYNC_PERIOD 1000
+
+/**
+ * How often the journal is folded into per-object files and truncated (ms)
+ */
+#define ZT_CONTROLLER_FILEDB_COMPACTION_PERIOD 300000
+
+/**
+ * Magic + format version at the start of a binary snapshot file
+ */
+#define ZT_CONTROLLER_FILEDB_SNAPSHOT_MAGIC "ZTFDBSN1"
+
+// Member JSON files are fanned out into 256 subdirectories keyed on the low
+// byte of the member ID (member/<xx>/<id>.json) so per-save opens and
+// directory listings stay cheap on filesystems that degrade with tens of
+// thousands of entries per directory (ext4 without dir_index tuning, NFS).
+// ZeroTier addresses are effectively random in their low bits, so the shards
+// stay balanced. Files in the old flat layout are still read at startup and
+// are migrated to their shard the next time the member is written. Bulk
+// startup itself is served by the sequential snapshot above, not the tree.
+#define ZT_CONTROLLER_FILEDB_MEMBER_SHARD(memberId) ((unsigned int)((memberId) & 0xffU))
+
 namespace ZeroTier
 {
 
@@ -23,6 +57,10 @@ FileDB::FileDB(const char *path) :
 	_path(path),
 	_networksPath(_path + ZT_PATH_SEPARATOR_S + "network"),
 	_tracePath(_path + ZT_PATH_SEPARATOR_S + "trace"),
+	_journalPath(_path + ZT_PATH_SEPARATOR_S + "journal.log"),
+	_snapshotPath(_path + ZT_PATH_SEPARATOR_S + "snapshot.bin"),
+	_journal((FILE *)0),
+	_journalNeedsSync(false),
 	_running(true)
 {
 	OSUtils::mkdir(_path.c_str());
@@ -30,38 +68,197 @@ FileDB::FileDB(const char *path) :
 	OSUtils::mkdir(_networksPath.c_str());
 	OSUtils::mkdir(_tracePath.c_str());
 
-	std::vector<std::string> networks(OSUtils::listDirectory(_networksPath.c_str(),false));
+	// Bulk-load state from the binary snapshot if present, then walk the JSON
+	// tree parsing only files modified since the snapshot was taken (e.g.
+	// hand edits made while the controller was down). With no snapshot this
+	// degenerates to the old full walk.
+	const int64_t snapshotTime = _loadSnapshot();
+
+	std::set<uint64_t> seenNetworks;
+	std::set< std::pair<uint64_t,uint64_t> > seenMembers;
 	std::string buf;
-	for(auto n=networks.begin();n!=networks.end();++n) {
-		buf.clear();
-		if ((n->length() == 21)&&(OSUtils::readFile((_networksPath + ZT_PATH_SEPARATOR_S + *n).c_str(),buf))) {
+	OSUtils::eachFileInDirectory(_networksPath.c_str(),[&,this](const char *fn,bool isDirectory) {
+		if (isDirectory)
+			return true;
+		const std::string n(fn);
+		if (n.length() != 21)
+			return true;
+		const std::string nwids(n.substr(0,16));
+		const uint64_t nwid = Utils::hexStrToU64(nwids.c_str());
+		if (!nwid)
+			return true;
+		seenNetworks.insert(nwid);
+		const std::string networkPath(_networksPath + ZT_PATH_SEPARATOR_S + n);
+		if ((snapshotTime <= 0)||((int64_t)OSUtils::getLastModified(networkPath.c_str()) >= snapshotTime)) {
+			buf.clear();
+			if (OSUtils::readFile(networkPath.c_str(),buf)) {
+				try {
+					nlohmann::json network(OSUtils::jsonParse(buf));
+					if (OSUtils::jsonString(network["id"],"").length() == 16) {
+						nlohmann::json old;
+						get(nwid,old);
+						if (!old.is_object())
+							Metrics::network_count++;
+						_networkChanged(old,network,false);
+					}
+				} catch ( ... ) {}
+			}
+		}
+		if (!hasNetwork(nwid))
+			return true;
+		std::string membersPath(_networksPath + ZT_PATH_SEPARATOR_S + nwids + ZT_PATH_SEPARATOR_S "member");
+		auto loadMemberFile = [&,this](const std::string &dir,const char *mfn) {
+			const std::string m(mfn);
+			if (m.length() != 15)
+				return;
+			const uint64_t memberId = Utils::hexStrToU64(m.substr(0,10).c_str());
+			if (!memberId)
+				return;
+			seenMembers.insert(std::pair<uint64_t,uint64_t>(nwid,memberId));
+			const std::string memberPath(dir + ZT_PATH_SEPARATOR_S + m);
+			if ((snapshotTime > 0)&&((int64_t)OSUtils::getLastModified(memberPath.c_str()) < snapshotTime))
+				return;
+			buf.clear();
+			if (OSUtils::readFile(memberPath.c_str(),buf)) {
+				try {
+					nlohmann::json member(OSUtils::jsonParse(buf));
+					if (OSUtils::jsonString(member["id"],"").length() == 10) {
+						nlohmann::json network,old;
+						get(nwid,network,memberId,old);
+						if (!old.is_object())
+							Metrics::member_count++;
+						_memberChanged(old,member,false);
+					}
+				} catch ( ... ) {}
+			}
+		};
+		OSUtils::eachFileInDirectory(membersPath.c_str(),[&,this](const char *mfn,bool mIsDirectory) {
+			if (mIsDirectory) {
+				// Two-hex-digit subdirectories are member shards; anything else
+				// (including the legacy flat files alongside them) is ignored
+				const std::string sh(mfn);
+				if ((sh.length() == 2)&&(strspn(sh.c_str(),"0123456789abcdef") == 2)) {
+					const std::string shardPath(membersPath + ZT_PATH_SEPARATOR_S + sh);
+					OSUtils::eachFileInDirectory(shardPath.c_str(),[&,this](const char *sfn,bool sIsDirectory) {
+						if (!sIsDirectory)
+							loadMemberFile(shardPath,sfn);
+						return true;
+					});
+				}
+				return true;
+			}
+			loadMemberFile(membersPath,mfn);
+			return true;
+		});
+		return true;
+	});
+
+	if (snapshotTime > 0) {
+		// The JSON tree stays authoritative: drop snapshot records whose
+		// files were deleted while the controller was down.
+		std::vector< std::pair<uint64_t,uint64_t> > gone;
+		each([&seenNetworks,&seenMembers,&gone](uint64_t networkId,const nlohmann::json &network,uint64_t memberId,const nlohmann::json &member) {
+			if (memberId == 0) {
+				if (seenNetworks.count(networkId) == 0)
+					gone.push_back(std::pair<uint64_t,uint64_t>(networkId,0ULL));
+			} else if (seenMembers.count(std::pair<uint64_t,uint64_t>(networkId,memberId)) == 0) {
+				gone.push_back(std::pair<uint64_t,uint64_t>(networkId,memberId));
+			}
+		});
+		for(auto g=gone.begin();g!=gone.end();++g) {
 			try {
-				nlohmann::json network(OSUtils::jsonParse(buf));
-				const std::string nwids = network["id"];
-				if (nwids.length() == 16) {
-					nlohmann::json nullJson;
-					_networkChanged(nullJson,network,false);
-					Metrics::network_count++;
-					std::string membersPath(_networksPath + ZT_PATH_SEPARATOR_S + nwids + ZT_PATH_SEPARATOR_S "member");
-					std::vector<std::string> members(OSUtils::listDirectory(membersPath.c_str(),false));
-					for(auto m=members.begin();m!=members.end();++m) {
-						buf.clear();
-						if ((m->length() == 15)&&(OSUtils::readFile((membersPath + ZT_PATH_SEPARATOR_S + *m).c_str(),buf))) {
-							try {
-								nlohmann::json member(OSUtils::jsonParse(buf));
-								const std::string addrs = member["id"];
-								if (addrs.length() == 10) {
-									nlohmann::json nullJson2;
-									_memberChanged(nullJson2,member,false);
-									Metrics::member_count++;
-								}
-							} catch ( ... ) {}
-						}
+				nlohmann::json nullJson;
+				if (g->second == 0) {
+					nlohmann::json network;
+					if (get(g->first,network)) {
+						_networkChanged(network,nullJson,false);
+						Metrics::network_count--;
+					}
+				} else {
+					nlohmann::json network,member;
+					if (get(g->first,network,g->second,member)) {
+						_memberChanged(member,nullJson,false);
+						Metrics::member_count--;
 					}
 				}
 			} catch ( ... ) {}
 		}
 	}
+
+	// Replay any journal left over from an unclean shutdown. Journaled
+	// records are at least as new as the per-object files, so a record only
+	// loses to what was loaded above if its revision is older.
+	std::string jbuf;
+	const bool hadJournal = ((OSUtils::readFile(_journalPath.c_str(),jbuf))&&(!jbuf.empty()));
+	if (hadJournal) {
+		std::size_t lineStart = 0;
+		while (lineStart < jbuf.length()) {
+			std::size_t lineEnd = jbuf.find('\n',lineStart);
+			if (lineEnd == std::string::npos)
+				lineEnd = jbuf.length();
+			if (lineEnd > lineStart) {
+				try {
+					nlohmann::json record(OSUtils::jsonParse(jbuf.substr(lineStart,lineEnd - lineStart)));
+					const std::string objtype = OSUtils::jsonString(record["objtype"],"");
+					if (objtype == "network") {
+						const uint64_t nwid = OSUtils::jsonIntHex(record["id"],0ULL);
+						if (nwid) {
+							nlohmann::json old;
+							get(nwid,old);
+							if (OSUtils::jsonInt(record["revision"],0ULL) >= OSUtils::jsonInt(old["revision"],0ULL)) {
+								if (!old.is_object())
+									Metrics::network_count++;
+								_networkChanged(old,record,false);
+								_dirty.insert(std::pair<uint64_t,uint64_t>(nwid,0ULL));
+							}
+						}
+					} else if (objtype == "member") {
+						const uint64_t id = OSUtils::jsonIntHex(record["id"],0ULL);
+						const uint64_t nwid = OSUtils::jsonIntHex(record["nwid"],0ULL);
+						if ((id)&&(nwid)) {
+							nlohmann::json network,old;
+							get(nwid,network,id,old);
+							if (OSUtils::jsonInt(record["revision"],0ULL) >= OSUtils::jsonInt(old["revision"],0ULL)) {
+								if (!old.is_object())
+									Metrics::member_count++;
+								_memberChanged(old,record,false);
+								_dirty.insert(std::pair<uint64_t,uint64_t>(nwid,id));
+							}
+						}
+					}
+				} catch ( ... ) {} // skip corrupt or truncated journal lines
+			}
+			lineStart = lineEnd + 1;
+		}
+	}
+
+	_journal = fopen(_journalPath.c_str(),"ab");
+	if (!_journal)
+		fprintf(stderr,"WARNING: controller unable to open journal at %s, falling back to synchronous per-object writes" ZT_EOL_S,_journalPath.c_str());
+	if (hadJournal)
+		_compactJournal(); // fold replayed records into per-object files and start empty
+
+	_journalThread = std::thread([this]() {
+		int64_t lastSync = OSUtils::now();
+		int64_t lastCompaction = OSUtils::now();
+		for(;;) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			{
+				std::lock_guard<std::mutex> l(_online_l);
+				if (!_running)
+					return;
+			}
+			const int64_t now = OSUtils::now();
+			if ((now - lastSync) >= ZT_CONTROLLER_FILEDB_JOURNAL_SYNC_PERIOD) {
+				lastSync = now;
+				_syncJournal();
+			}
+			if ((now - lastCompaction) >= ZT_CONTROLLER_FILEDB_COMPACTION_PERIOD) {
+				lastCompaction = now;
+				_compactJournal();
+			}
+		}
+	});
 }
 
 FileDB::~FileDB()
@@ -70,6 +267,16 @@ FileDB::~FileDB()
 		_online_l.lock();
 		_running = false;
 		_online_l.unlock();
+		if (_journalThread.joinable())
+			_journalThread.join();
+		_compactJournal(); // final fold so the next start needs no replay
+		{
+			std::lock_guard<std::mutex> l(_journal_l);
+			if (_journal) {
+				fclose(_journal);
+				_journal = (FILE *)0;
+			}
+		}
 		_onlineUpdateThread.join();
 	} catch ( ... ) {}
 }
@@ -91,9 +298,11 @@ bool FileDB::save(nlohmann::json &record,bool notifyListeners)
 				get(nwid,old);
 				if ((!old.is_object())||(!_compareRecords(old,record))) {
 					record["revision"] = OSUtils::jsonInt(record["revision"],0ULL) + 1ULL;
-					OSUtils::ztsnprintf(p1,sizeof(p1),"%s" ZT_PATH_SEPARATOR_S "%.16llx.json",_networksPath.c_str(),nwid);
-					if (!OSUtils::writeFile(p1,OSUtils::jsonDump(record,-1))) {
-						fprintf(stderr,"WARNING: controller unable to write to path: %s" ZT_EOL_S,p1);
+					if (!_journalAppend(record,nwid,0ULL)) {
+						OSUtils::ztsnprintf(p1,sizeof(p1),"%s" ZT_PATH_SEPARATOR_S "%.16llx.json",_networksPath.c_str(),nwid);
+						if (!OSUtils::writeFile(p1,OSUtils::jsonDump(record,-1))) {
+							fprintf(stderr,"WARNING: controller unable to write to path: %s" ZT_EOL_S,p1);
+						}
 					}
 					_networkChanged(old,record,notifyListeners);
 					modified = true;
@@ -109,15 +318,22 @@ bool FileDB::save(nlohmann::json &record,bool notifyListeners)
 				get(nwid,network,id,old);
 				if ((!old.is_object())||(!_compareRecords(old,record))) {
 					record["revision"] = OSUtils::jsonInt(record["revision"],0ULL) + 1ULL;
-					OSUtils::ztsnprintf(pb,sizeof(pb),"%s" ZT_PATH_SEPARATOR_S "%.16llx" ZT_PATH_SEPARATOR_S "member",_networksPath.c_str(),(unsigned long long)nwid);
-					OSUtils::ztsnprintf(p1,sizeof(p1),"%s" ZT_PATH_SEPARATOR_S "%.10llx.json",pb,(unsigned long long)id);
-					if (!OSUtils::writeFile(p1,OSUtils::jsonDump(record,-1))) {
-						OSUtils::ztsnprintf(p2,sizeof(p2),"%s" ZT_PATH_SEPARATOR_S "%.16llx",_networksPath.c_str(),(unsigned long long)nwid);
-						OSUtils::mkdir(p2);
-						OSUtils::mkdir(pb);
+					if (!_journalAppend(record,nwid,id)) {
+						OSUtils::ztsnprintf(pb,sizeof(pb),"%s" ZT_PATH_SEPARATOR_S "%.16llx" ZT_PATH_SEPARATOR_S "member" ZT_PATH_SEPARATOR_S "%.2x",_networksPath.c_str(),(unsigned long long)nwid,ZT_CONTROLLER_FILEDB_MEMBER_SHARD(id));
+						OSUtils::ztsnprintf(p1,sizeof(p1),"%s" ZT_PATH_SEPARATOR_S "%.10llx.json",pb,(unsigned long long)id);
 						if (!OSUtils::writeFile(p1,OSUtils::jsonDump(record,-1))) {
-							fprintf(stderr,"WARNING: controller unable to write to path: %s" ZT_EOL_S,p1);
+							OSUtils::ztsnprintf(p2,sizeof(p2),"%s" ZT_PATH_SEPARATOR_S "%.16llx",_networksPath.c_str(),(unsigned long long)nwid);
+							OSUtils::mkdir(p2);
+							OSUtils::ztsnprintf(p2,sizeof(p2),"%s" ZT_PATH_SEPARATOR_S "%.16llx" ZT_PATH_SEPARATOR_S "member",_networksPath.c_str(),(unsigned long long)nwid);
+							OSUtils::mkdir(p2);
+							OSUtils::mkdir(pb);
+							if (!OSUtils::writeFile(p1,OSUtils::jsonDump(record,-1))) {
+								fprintf(stderr,"WARNING: controller unable to write to path: %s" ZT_EOL_S,p1);
+							}
 						}
+						// Migrate on write: drop any copy left in the legacy flat layout
+						OSUtils::ztsnprintf(p2,sizeof(p2),"%s" ZT_PATH_SEPARATOR_S "%.16llx" ZT_PATH_SEPARATOR_S "member" ZT_PATH_SEPARATOR_S "%.10llx.json",_networksPath.c_str(),(unsigned long long)nwid,(unsigned long long)id);
+						OSUtils::rm(p2);
 					}
 					_memberChanged(old,record,notifyListeners);
 					modified = true;
@@ -129,6 +345,195 @@ bool FileDB::save(nlohmann::json &record,bool notifyListeners)
 	return modified;
 }
 
+bool FileDB::_journalAppend(const nlohmann::json &record,const uint64_t networkId,const uint64_t memberId)
+{
+	std::lock_guard<std::mutex> l(_journal_l);
+	if (!_journal)
+		return false;
+	std::string line(OSUtils::jsonDump(record,-1));
+	line.push_back('\n');
+	if (fwrite(line.data(),1,line.length(),_journal) != line.length())
+		return false;
+	fflush(_journal); // hand off to the OS now; the group fsync below makes it durable
+	_dirty.insert(std::pair<uint64_t,uint64_t>(networkId,memberId));
+	_journalNeedsSync = true;
+	return true;
+}
+
+void FileDB::_syncJournal()
+{
+	std::lock_guard<std::mutex> l(_journal_l);
+	if ((_journal)&&(_journalNeedsSync)) {
+		fflush(_journal);
+#ifdef __WINDOWS__
+		_commit(_fileno(_journal));
+#else
+		fsync(fileno(_journal));
+#endif
+		_journalNeedsSync = false;
+	}
+}
+
+void FileDB::_writeObjectFile(const uint64_t networkId,const uint64_t memberId)
+{
+	char p1[4096],p2[4096],pb[4096];
+	try {
+		if (memberId == 0) {
+			nlohmann::json network;
+			if (get(networkId,network)) {
+				OSUtils::ztsnprintf(p1,sizeof(p1),"%s" ZT_PATH_SEPARATOR_S "%.16llx.json",_networksPath.c_str(),(unsigned long long)networkId);
+				if (!OSUtils::writeFile(p1,OSUtils::jsonDump(network,-1)))
+					fprintf(stderr,"WARNING: controller unable to write to path: %s" ZT_EOL_S,p1);
+			}
+		} else {
+			nlohmann::json network,member;
+			if (get(networkId,network,memberId,member)) {
+				OSUtils::ztsnprintf(pb,sizeof(pb),"%s" ZT_PATH_SEPARATOR_S "%.16llx" ZT_PATH_SEPARATOR_S "member" ZT_PATH_SEPARATOR_S "%.2x",_networksPath.c_str(),(unsigned long long)networkId,ZT_CONTROLLER_FILEDB_MEMBER_SHARD(memberId));
+				OSUtils::ztsnprintf(p1,sizeof(p1),"%s" ZT_PATH_SEPARATOR_S "%.10llx.json",pb,(unsigned long long)memberId);
+				if (!OSUtils::writeFile(p1,OSUtils::jsonDump(member,-1))) {
+					OSUtils::ztsnprintf(p2,sizeof(p2),"%s" ZT_PATH_SEPARATOR_S "%.16llx",_networksPath.c_str(),(unsigned long long)networkId);
+					OSUtils::mkdir(p2);
+					OSUtils::ztsnprintf(p2,sizeof(p2),"%s" ZT_PATH_SEPARATOR_S "%.16llx" ZT_PATH_SEPARATOR_S "member",_networksPath.c_str(),(unsigned long long)networkId);
+					OSUtils::mkdir(p2);
+					OSUtils::mkdir(pb);
+					if (!OSUtils::writeFile(p1,OSUtils::jsonDump(member,-1)))
+						fprintf(stderr,"WARNING: controller unable to write to path: %s" ZT_EOL_S,p1);
+				}
+				// Migrate on write: drop any copy left in the legacy flat layout
+				OSUtils::ztsnprintf(p2,sizeof(p2),"%s" ZT_PATH_SEPARATOR_S "%.16llx" ZT_PATH_SEPARATOR_S "member" ZT_PATH_SEPARATOR_S "%.10llx.json",_networksPath.c_str(),(unsigned long long)networkId,(unsigned long long)memberId);
+				OSUtils::rm(p2);
+			}
+		}
+	} catch ( ... ) {}
+}
+
+void FileDB::_writeSnapshot()
+{
+	const std::string tmp(_snapshotPath + ".tmp");
+	FILE *f = fopen(tmp.c_str(),"wb");
+	if (!f) {
+		fprintf(stderr,"WARNING: controller unable to write snapshot at %s" ZT_EOL_S,tmp.c_str());
+		return;
+	}
+	bool ok = (fwrite(ZT_CONTROLLER_FILEDB_SNAPSHOT_MAGIC,1,8,f) == 8);
+	const int64_t now = OSUtils::now();
+	ok = ok && (fwrite(&now,1,8,f) == 8);
+	each([&f,&ok](uint64_t networkId,const nlohmann::json &network,uint64_t memberId,const nlohmann::json &member) {
+		if (!ok)
+			return;
+		try {
+			const std::vector<uint8_t> cbor(nlohmann::json::to_cbor((memberId == 0) ? network : member));
+			const uint32_t rl = (uint32_t)cbor.size();
+			ok = ok && (fwrite(&rl,1,4,f) == 4) && (fwrite(cbor.data(),1,rl,f) == rl);
+		} catch ( ... ) {}
+	});
+	fflush(f);
+#ifdef __WINDOWS__
+	_commit(_fileno(f));
+#else
+	fsync(fileno(f));
+#endif
+	fclose(f);
+	if (ok) {
+		if (!OSUtils::rename(tmp.c_str(),_snapshotPath.c_str()))
+			fprintf(stderr,"WARNING: controller unable to move snapshot into place at %s" ZT_EOL_S,_snapshotPath.c_str());
+	} else {
+		fprintf(stderr,"WARNING: controller snapshot write failed, keeping previous snapshot" ZT_EOL_S);
+		OSUtils::rm(tmp.c_str());
+	}
+}
+
+int64_t FileDB::_loadSnapshot()
+{
+	int64_t ts = 0;
+	const uint8_t *b = (const uint8_t *)0;
+	std::size_t len = 0;
+	std::string fileBuf;
+#ifdef __WINDOWS__
+	if (!OSUtils::readFile(_snapshotPath.c_str(),fileBuf))
+		return 0;
+	b = (const uint8_t *)fileBuf.data();
+	len = fileBuf.length();
+#else
+	const int fd = open(_snapshotPath.c_str(),O_RDONLY);
+	if (fd < 0)
+		return 0;
+	struct stat st;
+	if ((fstat(fd,&st) != 0)||(st.st_size < 16)) {
+		close(fd);
+		return 0;
+	}
+	len = (std::size_t)st.st_size;
+	void *const mapped = mmap((void *)0,len,PROT_READ,MAP_PRIVATE,fd,0);
+	if (mapped == MAP_FAILED) {
+		close(fd);
+		return 0;
+	}
+	b = (const uint8_t *)mapped;
+#endif
+
+	if ((len >= 16)&&(!memcmp(b,ZT_CONTROLLER_FILEDB_SNAPSHOT_MAGIC,8))) {
+		memcpy(&ts,b + 8,8);
+		std::size_t p = 16;
+		while ((p + 4) <= len) {
+			uint32_t rl = 0;
+			memcpy(&rl,b + p,4);
+			p += 4;
+			if ((rl == 0)||((p + rl) > len)) {
+				break; // truncated snapshot, keep what loaded so far; the tree walk fills the rest
+			}
+			try {
+				nlohmann::json record(nlohmann::json::from_cbor(std::vector<uint8_t>(b + p,b + p + rl)));
+				const std::string objtype = OSUtils::jsonString(record["objtype"],"");
+				nlohmann::json nullJson;
+				if (objtype == "network") {
+					if (OSUtils::jsonString(record["id"],"").length() == 16) {
+						_networkChanged(nullJson,record,false);
+						Metrics::network_count++;
+					}
+				} else if (objtype == "member") {
+					if (OSUtils::jsonString(record["id"],"").length() == 10) {
+						_memberChanged(nullJson,record,false);
+						Metrics::member_count++;
+					}
+				}
+			} catch ( ... ) {}
+			p += rl;
+		}
+	}
+
+#ifndef __WINDOWS__
+	munmap((void *)b,len);
+	close(fd);
+#endif
+	return ts;
+}
+
+void FileDB::_compactJournal()
+{
+	// Holds _journal_l across the fold and truncate so no record appended
+	// during compaction can be dropped from the journal before its object
+	// file is current. Compaction is periodic and bounded by the number of
+	// objects touched since the last one.
+	std::lock_guard<std::mutex> l(_journal_l);
+	const bool changed = (!_dirty.empty());
+	for(auto d=_dirty.begin();d!=_dirty.end();++d)
+		_writeObjectFile(d->first,d->second);
+	_dirty.clear();
+	if ((changed)||(!OSUtils::fileExists(_snapshotPath.c_str())))
+		_writeSnapshot();
+	if (_journal) {
+		fflush(_journal);
+#ifdef __WINDOWS__
+		_chsize(_fileno(_journal),0);
+#else
+		if (ftruncate(fileno(_journal),0) != 0)
+			fprintf(stderr,"WARNING: controller unable to truncate journal at %s" ZT_EOL_S,_journalPath.c_str());
+#endif
+		_journalNeedsSync = false;
+	}
+}
+
 void FileDB::eraseNetwork(const uint64_t networkId)
 {
 	nlohmann::json network,nullJson;
@@ -139,6 +544,12 @@ void FileDB::eraseNetwork(const uint64_t networkId)
 	OSUtils::ztsnprintf(p,sizeof(p),"%s" ZT_PATH_SEPARATOR_S "%.16llx" ZT_PATH_SEPARATOR_S "member",_networksPath.c_str(),(unsigned long long)networkId);
 	OSUtils::rmDashRf(p);
 	_networkChanged(network,nullJson,true);
+	_compactJournal();
+	{
+		// Neither the journal nor the snapshot may keep the erased objects.
+		std::lock_guard<std::mutex> l(_journal_l);
+		_writeSnapshot();
+	}
 	std::lock_guard<std::mutex> l(this->_online_l);
 	this->_online.erase(networkId);
 }
@@ -148,9 +559,17 @@ void FileDB::eraseMember(const uint64_t networkId,const uint64_t memberId)
 	nlohmann::json network,member,nullJson;
 	get(networkId,network,memberId,member);
 	char p[4096];
+	OSUtils::ztsnprintf(p,sizeof(p),"%s" ZT_PATH_SEPARATOR_S "%.16llx" ZT_PATH_SEPARATOR_S "member" ZT_PATH_SEPARATOR_S "%.2x" ZT_PATH_SEPARATOR_S "%.10llx.json",_networksPath.c_str(),networkId,ZT_CONTROLLER_FILEDB_MEMBER_SHARD(memberId),memberId);
+	OSUtils::rm(p);
 	OSUtils::ztsnprintf(p,sizeof(p),"%s" ZT_PATH_SEPARATOR_S "%.16llx" ZT_PATH_SEPARATOR_S "member" ZT_PATH_SEPARATOR_S "%.10llx.json",_networksPath.c_str(),networkId,memberId);
 	OSUtils::rm(p);
 	_memberChanged(member,nullJson,true);
+	_compactJournal();
+	{
+		// Neither the journal nor the snapshot may keep the erased member.
+		std::lock_guard<std::mutex> l(_journal_l);
+		_writeSnapshot();
+	}
 	std::lock_guard<std::mutex> l(this->_online_l);
 	this->_online[networkId].erase(memberId);
 }
@@ -16,6 +16,9 @@
 
 #include "DB.hpp"
 
+#include <stdio.h>
+#include <set>
+
 namespace ZeroTier
 {
 
@@ -33,9 +36,23 @@ public:
 	virtual void nodeIsOnline(const uint64_t networkId,const uint64_t memberId,const InetAddress &physicalAddress);
 
 protected:
+	bool _journalAppend(const nlohmann::json &record,const uint64_t networkId,const uint64_t memberId);
+	void _syncJournal();
+	void _compactJournal();
+	void _writeObjectFile(const uint64_t networkId,const uint64_t memberId); // caller must hold _journal_l
+	void _writeSnapshot(); // caller must hold _journal_l
+	int64_t _loadSnapshot(); // returns snapshot timestamp or 0 if absent/invalid
+
 	std::string _path;
 	std::string _networksPath;
 	std::string _tracePath;
+	std::string _journalPath;
+	std::string _snapshotPath;
+	FILE *_journal;
+	bool _journalNeedsSync;
+	std::set< std::pair<uint64_t,uint64_t> > _dirty; // (networkId, memberId or 0) journaled since last compaction
+	std::mutex _journal_l;
+	std::thread _journalThread;
 	std::thread _onlineUpdateThread;
 	std::map< uint64_t,std::map<uint64_t,std::map<int64_t,InetAddress> > > _online;
 	std::mutex _online_l;
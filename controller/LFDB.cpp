@@ -21,6 +21,10 @@
 #include "../osdep/OSUtils.hpp"
 #include "../ext/cpp-httplib/httplib.h"
 
+// Maximum number of member online-state (telemetry) records submitted to the
+// LF node per sync pass; anything beyond this stays dirty for the next pass
+#define ZT_LFDB_MAX_ONLINE_UPDATES_PER_PASS 1000
+
 namespace ZeroTier
 {
 
@@ -49,8 +53,27 @@ LFDB::LFDB(const Identity &myId,const char *path,const char *lfOwnerPrivate,cons
 		Utils::hex(sha512pk,32,maskingKey);
 
 		httplib::Client htcli(_lfNodeHost.c_str(),_lfNodePort);
+		htcli.set_keep_alive(true); // stream batched submissions over one connection instead of reconnecting per record
+
+		// A pass's worth of dirty objects, assembled under the state lock and
+		// submitted after it is released so save() and nodeIsOnline() never
+		// block behind LF node round trips. Network and member config records
+		// are submitted first; online-state telemetry rides in a second,
+		// per-pass-capped lane so a flood of status updates cannot starve
+		// config changes.
+		struct _PendingRecord
+		{
+			enum { NETWORK,MEMBER,MEMBER_ONLINE } type;
+			uint64_t nwid;
+			uint64_t memberId;
+			std::string body;
+		};
+		std::vector<_PendingRecord> configLane,telemetryLane;
+
 		int64_t timeRangeStart = 0;
 		while (_running.load()) {
+			configLane.clear();
+			telemetryLane.clear();
 			{
 				std::lock_guard<std::mutex> sl(_state_l);
 				for(auto ns=_state.begin();ns!=_state.end();++ns) {
@@ -65,28 +88,13 @@ LFDB::LFDB(const Identity &myId,const char *path,const char *lfOwnerPrivate,cons
 							newrec["OwnerPrivate"] = _lfOwnerPrivate;
 							newrec["MaskingKey"] = maskingKey;
 							newrec["PulseIfUnchanged"] = true;
-							try {
-								auto resp = htcli.Post("/makerecord",newrec.dump(),"application/json");
-								if (resp) {
-									if (resp->status == 200) {
-										ns->second.dirty = false;
-										//printf("SET network %.16llx %s\n",ns->first,resp->body.c_str());
-									} else {
-										fprintf(stderr,"ERROR: LFDB: %d from node (create/update network): %s" ZT_EOL_S,resp->status,resp->body.c_str());
-									}
-								} else {
-									fprintf(stderr,"ERROR: LFDB: node is offline" ZT_EOL_S);
-								}
-							} catch (std::exception &e) {
-								fprintf(stderr,"ERROR: LFDB: unexpected exception querying node (create/update network): %s" ZT_EOL_S,e.what());
-							} catch ( ... ) {
-								fprintf(stderr,"ERROR: LFDB: unexpected exception querying node (create/update network): unknown exception" ZT_EOL_S);
-							}
+							configLane.push_back({_PendingRecord::NETWORK,ns->first,0,newrec.dump()});
+							ns->second.dirty = false; // re-marked on submission failure
 						}
 					}
 
 					for(auto ms=ns->second.members.begin();ms!=ns->second.members.end();++ms) {
-						if ((_storeOnlineState)&&(ms->second.lastOnlineDirty)&&(ms->second.lastOnlineAddress)) {
+						if ((_storeOnlineState)&&(ms->second.lastOnlineDirty)&&(ms->second.lastOnlineAddress)&&(telemetryLane.size() < ZT_LFDB_MAX_ONLINE_UPDATES_PER_PASS)) {
 							nlohmann::json newrec,selector0,selector1,selectors,ip;
 							char tmp[1024],tmp2[128];
 							OSUtils::ztsnprintf(tmp,sizeof(tmp),"com.zerotier.controller.lfdb:%s/network/%.16llx/online",controllerAddress,(unsigned long long)ns->first);
@@ -117,23 +125,8 @@ LFDB::LFDB(const Identity &myId,const char *path,const char *lfOwnerPrivate,cons
 							newrec["MaskingKey"] = maskingKey;
 							newrec["Timestamp"] = ms->second.lastOnlineTime;
 							newrec["PulseIfUnchanged"] = true;
-							try {
-								auto resp = htcli.Post("/makerecord",newrec.dump(),"application/json");
-								if (resp) {
-									if (resp->status == 200) {
-										ms->second.lastOnlineDirty = false;
-										//printf("SET member online %.16llx %.10llx %s\n",ns->first,ms->first,resp->body.c_str());
-									} else {
-										fprintf(stderr,"ERROR: LFDB: %d from node (create/update member online status): %s" ZT_EOL_S,resp->status,resp->body.c_str());
-									}
-								} else {
-									fprintf(stderr,"ERROR: LFDB: node is offline" ZT_EOL_S);
-								}
-							} catch (std::exception &e) {
-								fprintf(stderr,"ERROR: LFDB: unexpected exception querying node (create/update member online status): %s" ZT_EOL_S,e.what());
-							} catch ( ... ) {
-								fprintf(stderr,"ERROR: LFDB: unexpected exception querying node (create/update member online status): unknown exception" ZT_EOL_S);
-							}
+							telemetryLane.push_back({_PendingRecord::MEMBER_ONLINE,ns->first,ms->first,newrec.dump()});
+							ms->second.lastOnlineDirty = false; // re-marked on submission failure
 						}
 
 						if (ms->second.dirty) {
@@ -151,23 +144,51 @@ LFDB::LFDB(const Identity &myId,const char *path,const char *lfOwnerPrivate,cons
 								newrec["OwnerPrivate"] = _lfOwnerPrivate;
 								newrec["MaskingKey"] = maskingKey;
 								newrec["PulseIfUnchanged"] = true;
-								try {
-									auto resp = htcli.Post("/makerecord",newrec.dump(),"application/json");
-									if (resp) {
-										if (resp->status == 200) {
-											ms->second.dirty = false;
-											//printf("SET member %.16llx %.10llx %s\n",ns->first,ms->first,resp->body.c_str());
-										} else {
-											fprintf(stderr,"ERROR: LFDB: %d from node (create/update member): %s" ZT_EOL_S,resp->status,resp->body.c_str());
-										}
+								configLane.push_back({_PendingRecord::MEMBER,ns->first,ms->first,newrec.dump()});
+								ms->second.dirty = false; // re-marked on submission failure
+							}
+						}
+					}
+				}
+			}
+
+			if ((!configLane.empty())||(!telemetryLane.empty())) {
+				bool nodeOffline = false;
+				for(int lane=0;lane<2;++lane) {
+					std::vector<_PendingRecord> &batch = (lane == 0) ? configLane : telemetryLane;
+					for(auto pr=batch.begin();pr!=batch.end();++pr) {
+						bool submitted = false;
+						if (!nodeOffline) {
+							try {
+								auto resp = htcli.Post("/makerecord",pr->body,"application/json");
+								if (resp) {
+									if (resp->status == 200) {
+										submitted = true;
 									} else {
-										fprintf(stderr,"ERROR: LFDB: node is offline" ZT_EOL_S);
+										fprintf(stderr,"ERROR: LFDB: %d from node (create/update record): %s" ZT_EOL_S,resp->status,resp->body.c_str());
 									}
-								} catch (std::exception &e) {
-									fprintf(stderr,"ERROR: LFDB: unexpected exception querying node (create/update member): %s" ZT_EOL_S,e.what());
-								} catch ( ... ) {
-									fprintf(stderr,"ERROR: LFDB: unexpected exception querying node (create/update member): unknown exception" ZT_EOL_S);
+								} else {
+									fprintf(stderr,"ERROR: LFDB: node is offline" ZT_EOL_S);
+									nodeOffline = true; // everything not yet submitted stays dirty for the next pass
 								}
+							} catch (std::exception &e) {
+								fprintf(stderr,"ERROR: LFDB: unexpected exception querying node (create/update record): %s" ZT_EOL_S,e.what());
+							} catch ( ... ) {
+								fprintf(stderr,"ERROR: LFDB: unexpected exception querying node (create/update record): unknown exception" ZT_EOL_S);
+							}
+						}
+						if (!submitted) {
+							std::lock_guard<std::mutex> sl(_state_l);
+							switch(pr->type) {
+								case _PendingRecord::NETWORK:
+									_state[pr->nwid].dirty = true;
+									break;
+								case _PendingRecord::MEMBER:
+									_state[pr->nwid].members[pr->memberId].dirty = true;
+									break;
+								case _PendingRecord::MEMBER_ONLINE:
+									_state[pr->nwid].members[pr->memberId].lastOnlineDirty = true;
+									break;
 							}
 						}
 					}
@@ -162,6 +162,9 @@ using ItemStream = std::vector<Item>;
 PostgreSQL::PostgreSQL(const Identity &myId, const char *path, int listenPort, RedisConfig *rc)
 	: DB()
 	, _pool()
+	, _replicaPool()
+	, _replicaHealthy(false)
+	, _replicaMaxLagMs(0)
 	, _myId(myId)
 	, _myAddress(myId.address())
 	, _ready(0)
@@ -179,7 +182,33 @@ PostgreSQL::PostgreSQL(const Identity &myId, const char *path, int listenPort, R
 	_connString = std::string(path);
 	auto f = std::make_shared<PostgresConnFactory>(_connString);
 	_pool = std::make_shared<ConnectionPool<PostgresConnection> >(
-		15, 5, std::static_pointer_cast<ConnectionFactory>(f));
+		15, 5, std::static_pointer_cast<ConnectionFactory>(f), true);
+
+	// Optional PostgreSQL read replica: when configured, bulk loads and other
+	// read-only queries are routed there so read throughput can be scaled out
+	// without touching the primary. The value may itself be a multi-host
+	// libpq connection string for client-side balancing across several
+	// replicas. The heartbeat thread demotes reads back to the primary
+	// whenever replay lag exceeds ZT_DB_REPLICA_MAX_LAG_MS (default 5000) or
+	// the replica is unreachable.
+	const char *const replicaConnString = getenv("ZT_DB_REPLICA_CONN_STRING");
+	if ((replicaConnString)&&(replicaConnString[0])) {
+		_replicaConnString = std::string(replicaConnString);
+		auto rf = std::make_shared<PostgresConnFactory>(_replicaConnString);
+		_replicaPool = std::make_shared<ConnectionPool<PostgresConnection> >(
+			15, 5, std::static_pointer_cast<ConnectionFactory>(rf), true);
+		const char *const maxLag = getenv("ZT_DB_REPLICA_MAX_LAG_MS");
+		if (maxLag) {
+			_replicaMaxLagMs = (int64_t)strtoll(maxLag, (char **)0, 10);
+		}
+		if (_replicaMaxLagMs <= 0) {
+			_replicaMaxLagMs = 5000;
+		}
+		_checkReplicaHealth(); // initial probe so the startup loads can already use it
+		fprintf(stderr, "Using read replica for database reads (max lag %lldms, currently %s)\n",
+			(long long)_replicaMaxLagMs, _replicaHealthy.load() ? "healthy" : "unavailable");
+	}
+
 	
 	memset(_ssoPsk, 0, sizeof(_ssoPsk));
 	char *const ssoPskHex = getenv("ZT_SSO_PSK");
@@ -247,6 +276,9 @@ PostgreSQL::PostgreSQL(const Identity &myId, const char *path, int listenPort, R
 	for (int i = 0; i < ZT_CENTRAL_CONTROLLER_COMMIT_THREADS; ++i) {
 		_commitThread[i] = std::thread(&PostgreSQL::commitThread, this);
 	}
+	if (_redisMemberStatus) {
+		_redisOpThread = std::thread(&PostgreSQL::redisOpThread, this);
+	}
 	_onlineNotificationThread = std::thread(&PostgreSQL::onlineNotificationThread, this);
 }
 
@@ -262,6 +294,10 @@ PostgreSQL::~PostgreSQL()
 	for (int i = 0; i < ZT_CENTRAL_CONTROLLER_COMMIT_THREADS; ++i) {
 		_commitThread[i].join();
 	}
+	_redisOpQueue.stop();
+	if (_redisOpThread.joinable()) {
+		_redisOpThread.join();
+	}
 	_onlineNotificationThread.join();
 }
 
@@ -574,7 +610,8 @@ void PostgreSQL::initializeNetworks()
 			"LEFT OUTER JOIN ztc_network_dns d "
 			"	ON d.network_id = n.id "
 			"WHERE deleted = false AND controller_id = '%s'", _myAddressStr.c_str());
-		auto c = _pool->borrow();
+		auto rp = _readPool();
+		auto c = rp->borrow();
 		auto c2 = _pool->borrow();
 		pqxx::work w{*c->c};
 
@@ -735,7 +772,7 @@ void PostgreSQL::initializeNetworks()
 
 		w.commit();
 		_pool->unborrow(c2);
-		_pool->unborrow(c);
+		rp->unborrow(c);
 		fprintf(stderr, "done.\n");
 
 		if (!networkSet.empty()) {
@@ -840,7 +877,8 @@ void PostgreSQL::initializeMembers()
 			"INNER JOIN ztc_network n "
 			"	ON n.id = m.network_id "
 			"WHERE n.controller_id = '%s' AND n.deleted = FALSE AND m.deleted = FALSE", _myAddressStr.c_str());
-		auto c = _pool->borrow();
+		auto rp = _readPool();
+		auto c = rp->borrow();
 		auto c2 = _pool->borrow();
 		pqxx::work w{*c->c};
 
@@ -960,7 +998,7 @@ void PostgreSQL::initializeMembers()
 
 		w.commit();
 		_pool->unborrow(c2);
-		_pool->unborrow(c);
+		rp->unborrow(c);
 		fprintf(stderr, "done.\n");
 
 		if (!networkMembers.empty()) {
@@ -1000,6 +1038,35 @@ void PostgreSQL::initializeMembers()
 	}
 }
 
+void PostgreSQL::_checkReplicaHealth()
+{
+	if (!_replicaPool) {
+		return;
+	}
+	bool healthy = false;
+	try {
+		auto c = _replicaPool->borrow();
+		pqxx::work w(*c->c);
+		// Replay lag in milliseconds; NULL (not in recovery, i.e. the
+		// "replica" is actually a primary) counts as zero lag
+		pqxx::row r = w.exec1("SELECT COALESCE((EXTRACT(EPOCH FROM (now() - pg_last_xact_replay_timestamp())) * 1000.0)::bigint, 0)");
+		w.commit();
+		const int64_t lagMs = r[0].as<int64_t>();
+		healthy = (lagMs <= _replicaMaxLagMs);
+		if (!healthy) {
+			fprintf(stderr, "%s: replica replay lag %lldms exceeds limit of %lldms, routing reads to primary\n",
+				_myAddressStr.c_str(), (long long)lagMs, (long long)_replicaMaxLagMs);
+		}
+		_replicaPool->unborrow(c);
+	} catch (std::exception &e) {
+		fprintf(stderr, "%s: replica health check failed (%s), routing reads to primary\n", _myAddressStr.c_str(), e.what());
+	}
+	if ((healthy)&&(!_replicaHealthy.load())) {
+		fprintf(stderr, "%s: replica healthy, routing reads to replica\n", _myAddressStr.c_str());
+	}
+	_replicaHealthy.store(healthy);
+}
+
 void PostgreSQL::heartbeat()
 {
 	char publicId[1024];
@@ -1019,6 +1086,8 @@ void PostgreSQL::heartbeat()
 	const char *publicIdentity = publicId;
 	const char *hostname = hostnameTmp;
 
+	int64_t lastReplicaCheck = 0;
+
 	while (_run == 1) {
 		// fprintf(stderr, "%s: heartbeat\n", controllerId);
 		auto c = _pool->borrow();
@@ -1055,6 +1124,11 @@ void PostgreSQL::heartbeat()
 		}
 		_pool->unborrow(c);
 
+		if ((_replicaPool)&&((ts - lastReplicaCheck) > 15000)) {
+			lastReplicaCheck = ts;
+			_checkReplicaHealth();
+		}
+
 		try {
 			if (_redisMemberStatus) {
 				if (_rc->clusterMode) {
@@ -1522,13 +1596,8 @@ void PostgreSQL::commitThread()
 					try {
 						std::string id = config["id"];
 						std::string controllerId = _myAddressStr.c_str();
-						std::string key = "networks:{" + controllerId + "}";
-						if (_rc->clusterMode) {
-							_cluster->sadd(key, id);
-						} else {
-							_redis->sadd(key, id);
-						}
-					} catch (sw::redis::Error &e) {
+						_queueRedisOp(_RedisOp::SADD,"networks:{" + controllerId + "}",id);
+					} catch (std::exception &e) {
 						fprintf(stderr, "ERROR: Error adding network to Redis: %s\n", e.what());
 					}
 				}
@@ -1550,16 +1619,10 @@ void PostgreSQL::commitThread()
 					try {
 						std::string id = config["id"];
 						std::string controllerId = _myAddressStr.c_str();
-						std::string key = "networks:{" + controllerId + "}";
-						if (_rc->clusterMode) {
-							_cluster->srem(key, id);
-							_cluster->del("network-nodes-online:{"+controllerId+"}:"+id);
-						} else {
-							_redis->srem(key, id);
-							_redis->del("network-nodes-online:{"+controllerId+"}:"+id);
-						}
-					} catch (sw::redis::Error &e) {
-						fprintf(stderr, "ERROR: Error adding network to Redis: %s\n", e.what());
+						_queueRedisOp(_RedisOp::SREM,"networks:{" + controllerId + "}",id);
+						_queueRedisOp(_RedisOp::DEL,"network-nodes-online:{"+controllerId+"}:"+id,"");
+					} catch (std::exception &e) {
+						fprintf(stderr, "ERROR: Error removing network from Redis: %s\n", e.what());
 					}
 				}
 
@@ -1584,15 +1647,9 @@ void PostgreSQL::commitThread()
 						std::string memberId = config["id"];
 						std::string networkId = config["nwid"];
 						std::string controllerId = _myAddressStr.c_str();
-						std::string key = "network-nodes-all:{" + controllerId + "}:" + networkId;
-						if (_rc->clusterMode) {
-							_cluster->srem(key, memberId);
-							_cluster->del("member:{"+controllerId+"}:"+networkId+":"+memberId);
-						} else {
-							_redis->srem(key, memberId);
-							_redis->del("member:{"+controllerId+"}:"+networkId+":"+memberId);
-						}
-					} catch (sw::redis::Error &e) {
+						_queueRedisOp(_RedisOp::SREM,"network-nodes-all:{" + controllerId + "}:" + networkId,memberId);
+						_queueRedisOp(_RedisOp::DEL,"member:{"+controllerId+"}:"+networkId+":"+memberId,"");
+					} catch (std::exception &e) {
 						fprintf(stderr, "ERROR: Error deleting member from Redis: %s\n", e.what());
 					}
 				}
@@ -1609,6 +1666,77 @@ void PostgreSQL::commitThread()
 	fprintf(stderr, "%s commitThread finished\n", _myAddressStr.c_str());
 }
 
+void PostgreSQL::_queueRedisOp(_RedisOp::Op op,const std::string &key,const std::string &arg)
+{
+	_RedisOp *o = new _RedisOp;
+	o->op = op;
+	o->key = key;
+	o->arg = arg;
+	_redisOpQueue.postLimit(o,ZT_CENTRAL_CONTROLLER_REDIS_OP_QUEUE_MAX); // blocks briefly if Redis falls far behind
+}
+
+void PostgreSQL::redisOpThread()
+{
+	fprintf(stderr, "%s: redisOpThread start\n", _myAddressStr.c_str());
+	std::vector<_RedisOp *> batch;
+	batch.reserve(ZT_CENTRAL_CONTROLLER_REDIS_OP_BATCH);
+	bool stop = false;
+	while (!stop) {
+		_RedisOp *op = (_RedisOp *)0;
+		switch (_redisOpQueue.get(op,250)) {
+			case BlockingQueue<_RedisOp *>::STOP:
+				stop = true;
+				break;
+			case BlockingQueue<_RedisOp *>::OK:
+				if (op)
+					batch.push_back(op);
+				// Opportunistically drain whatever else is already queued so
+				// one MULTI/EXEC round trip covers the whole burst.
+				while ((batch.size() < ZT_CENTRAL_CONTROLLER_REDIS_OP_BATCH)&&(_redisOpQueue.size() > 0)) {
+					op = (_RedisOp *)0;
+					if (_redisOpQueue.get(op,1) != BlockingQueue<_RedisOp *>::OK)
+						break;
+					if (op)
+						batch.push_back(op);
+				}
+				break;
+			default:
+				break;
+		}
+		if (!batch.empty()) {
+			try {
+				if (_rc->clusterMode) {
+					auto tx = _cluster->transaction(_myAddressStr, true, false);
+					for(auto o=batch.begin();o!=batch.end();++o) {
+						switch ((*o)->op) {
+							case _RedisOp::SADD: tx.sadd((*o)->key,(*o)->arg); break;
+							case _RedisOp::SREM: tx.srem((*o)->key,(*o)->arg); break;
+							case _RedisOp::DEL: tx.del((*o)->key); break;
+						}
+					}
+					tx.exec();
+				} else {
+					auto tx = _redis->transaction(true, false);
+					for(auto o=batch.begin();o!=batch.end();++o) {
+						switch ((*o)->op) {
+							case _RedisOp::SADD: tx.sadd((*o)->key,(*o)->arg); break;
+							case _RedisOp::SREM: tx.srem((*o)->key,(*o)->arg); break;
+							case _RedisOp::DEL: tx.del((*o)->key); break;
+						}
+					}
+					tx.exec();
+				}
+			} catch (sw::redis::Error &e) {
+				fprintf(stderr, "ERROR: error applying batched Redis ops: %s\n", e.what());
+			}
+			for(auto o=batch.begin();o!=batch.end();++o)
+				delete *o;
+			batch.clear();
+		}
+	}
+	fprintf(stderr, "%s redisOpThread finished\n", _myAddressStr.c_str());
+}
+
 void PostgreSQL::onlineNotificationThread()
 {
  	waitForReady();
@@ -1635,7 +1763,6 @@ void PostgreSQL::onlineNotification_Postgres()
 	nlohmann::json jtmp1, jtmp2;
 	while (_run == 1) {
 		auto c = _pool->borrow();
-		auto c2 = _pool->borrow();
 		try {
 			fprintf(stderr, "%s onlineNotification_Postgres\n", _myAddressStr.c_str());
 			std::unordered_map< std::pair<uint64_t,uint64_t>,std::pair<int64_t,InetAddress>,_PairHasher > lastOnline;
@@ -1646,69 +1773,55 @@ void PostgreSQL::onlineNotification_Postgres()
 
 #ifndef DISABLE_MEMBER_STATUS
 			pqxx::work w(*c->c);
-			pqxx::work w2(*c2->c);
 
 			fprintf(stderr, "online notification tick\n");
-			
-			bool firstRun = true;
-			bool memberAdded = false;
-			int updateCount = 0;
-
-			pqxx::pipeline pipe(w);
 
-			for (auto i=lastOnline.begin(); i != lastOnline.end(); ++i) {
-				updateCount += 1;
-				uint64_t nwid_i = i->first.first;
-				char nwidTmp[64];
-				char memTmp[64];
-				char ipTmp[64];
-				OSUtils::ztsnprintf(nwidTmp,sizeof(nwidTmp), "%.16llx", nwid_i);
-				OSUtils::ztsnprintf(memTmp,sizeof(memTmp), "%.10llx", i->first.second);
-
-				if(!get(nwid_i, jtmp1, i->first.second, jtmp2)) {
-					continue; // skip non existent networks/members
-				}
-
-				std::string networkId(nwidTmp);
-				std::string memberId(memTmp);
-
-				try {
-					pqxx::row r = w2.exec_params1("SELECT id, network_id FROM ztc_member WHERE network_id = $1 AND id = $2",
-						networkId, memberId);		
-				} catch (pqxx::unexpected_rows &e) {
-					continue;
-				}
+			int updateCount = 0;
 
-				int64_t ts = i->second.first;
-				std::string ipAddr = i->second.second.toIpString(ipTmp);
-				std::string timestamp = std::to_string(ts);
+			// Stage the whole cycle's checkins into a temp table with a single
+			// COPY, then fold the member-existence check into one upsert. The
+			// old path issued a SELECT round trip plus a pipelined INSERT per
+			// member, which monopolized two pool connections for the duration
+			// of a reconnect storm.
+			w.exec0("CREATE TEMP TABLE temp_member_status_batch "
+				"(network_id TEXT, member_id TEXT, address TEXT, last_updated BIGINT) ON COMMIT DROP");
+			{
+				auto stream = pqxx::stream_to::table(w, {"temp_member_status_batch"},
+					{"network_id", "member_id", "address", "last_updated"});
+				for (auto i=lastOnline.begin(); i != lastOnline.end(); ++i) {
+					uint64_t nwid_i = i->first.first;
+					char nwidTmp[64];
+					char memTmp[64];
+					char ipTmp[64];
+					OSUtils::ztsnprintf(nwidTmp,sizeof(nwidTmp), "%.16llx", nwid_i);
+					OSUtils::ztsnprintf(memTmp,sizeof(memTmp), "%.10llx", i->first.second);
+
+					if(!get(nwid_i, jtmp1, i->first.second, jtmp2)) {
+						continue; // skip non existent networks/members
+					}
 
-				std::stringstream memberUpdate;
-				memberUpdate << "INSERT INTO ztc_member_status (network_id, member_id, address, last_updated) VALUES "
-					<< "('" << networkId << "', '" << memberId << "', ";
-				if (ipAddr.empty()) {
-					memberUpdate << "NULL, ";
-				} else {
-					memberUpdate << "'" << ipAddr << "', ";
+					updateCount += 1;
+					std::string ipAddr = i->second.second.toIpString(ipTmp);
+					stream << std::make_tuple(
+						std::string(nwidTmp),
+						std::string(memTmp),
+						(ipAddr.empty() ? std::optional<std::string>() : std::optional<std::string>(ipAddr)),
+						i->second.first);
+					Metrics::pgsql_node_checkin++;
 				}
-				memberUpdate << "TO_TIMESTAMP(" << timestamp << "::double precision/1000)) "
-					<< " ON CONFLICT (network_id, member_id) DO UPDATE SET address = EXCLUDED.address, last_updated = EXCLUDED.last_updated";
-
-				pipe.insert(memberUpdate.str());
-				Metrics::pgsql_node_checkin++;
-			}
-			while(!pipe.empty()) {
-				pipe.retrieve();
+				stream.complete();
 			}
-
-			pipe.complete();
+			w.exec0("INSERT INTO ztc_member_status (network_id, member_id, address, last_updated) "
+				"SELECT s.network_id, s.member_id, s.address, TO_TIMESTAMP(s.last_updated::double precision/1000) "
+				"FROM temp_member_status_batch s "
+				"WHERE EXISTS (SELECT 1 FROM ztc_member m WHERE m.network_id = s.network_id AND m.id = s.member_id) "
+				"ON CONFLICT (network_id, member_id) DO UPDATE SET address = EXCLUDED.address, last_updated = EXCLUDED.last_updated");
 			w.commit();
 			fprintf(stderr, "%s: Updated online status of %d members\n", _myAddressStr.c_str(), updateCount);
 #endif
 		} catch (std::exception &e) {
 			fprintf(stderr, "%s: error in onlinenotification thread: %s\n", _myAddressStr.c_str(), e.what());
-		} 
-		_pool->unborrow(c2);
+		}
 		_pool->unborrow(c);
 
 		ConnectionPoolStats stats = _pool->get_stats();
@@ -20,6 +20,16 @@
 
 #define ZT_CENTRAL_CONTROLLER_COMMIT_THREADS 4
 
+/**
+ * Bound on queued Redis side-effect operations; posters block when full
+ */
+#define ZT_CENTRAL_CONTROLLER_REDIS_OP_QUEUE_MAX 16384
+
+/**
+ * Max Redis operations applied per MULTI/EXEC batch
+ */
+#define ZT_CENTRAL_CONTROLLER_REDIS_OP_BATCH 512
+
 #include "ConnectionPool.hpp"
 #include <pqxx/pqxx>
 
@@ -42,6 +52,19 @@ public:
 	virtual ~PostgresConnection() {
 	}
 
+	virtual bool validate() {
+		if ((!c)||(!c->is_open()))
+			return false;
+		try {
+			pqxx::work w(*c);
+			w.exec1("SELECT 1");
+			w.commit();
+			return true;
+		} catch (std::exception &e) {
+			return false;
+		}
+	}
+
 	std::shared_ptr<pqxx::connection> c;
 	int a;
 };
@@ -138,6 +161,7 @@ private:
 	void _networksWatcher_Redis();
 
 	void commitThread();
+	void redisOpThread();
 	void onlineNotificationThread();
 	void onlineNotification_Postgres();
 	void onlineNotification_Redis();
@@ -149,19 +173,51 @@ private:
 		NO_OVERRIDE = 1
 	};
 
+	// A deferred Redis side effect of a config change; these are queued and
+	// applied in MULTI/EXEC batches so Redis round trips amortize across
+	// many changes instead of riding on each commit.
+	struct _RedisOp
+	{
+		enum Op {
+			SADD = 0,
+			SREM = 1,
+			DEL = 2
+		} op;
+		std::string key;
+		std::string arg;
+	};
+	void _queueRedisOp(_RedisOp::Op op,const std::string &key,const std::string &arg);
+
 	std::shared_ptr<ConnectionPool<PostgresConnection> > _pool;
 
+	// Optional read-replica pool (ZT_DB_REPLICA_CONN_STRING). Read-only
+	// queries borrow from _readPool(), which falls back to the primary when
+	// no replica is configured or the replica is lagging or unreachable; the
+	// heartbeat thread keeps _replicaHealthy current via _checkReplicaHealth().
+	std::shared_ptr<ConnectionPool<PostgresConnection> > _replicaPool;
+	std::atomic<bool> _replicaHealthy;
+	int64_t _replicaMaxLagMs;
+
+	inline std::shared_ptr<ConnectionPool<PostgresConnection> > _readPool()
+	{
+		return ((_replicaPool)&&(_replicaHealthy.load(std::memory_order_relaxed))) ? _replicaPool : _pool;
+	}
+	void _checkReplicaHealth();
+
 	const Identity _myId;
 	const Address _myAddress;
 	std::string _myAddressStr;
 	std::string _connString;
+	std::string _replicaConnString;
 
 	BlockingQueue< std::pair<nlohmann::json,bool> > _commitQueue;
+	BlockingQueue< _RedisOp * > _redisOpQueue;
 
 	std::thread _heartbeatThread;
 	std::thread _membersDbWatcher;
 	std::thread _networksDbWatcher;
 	std::thread _commitThread[ZT_CENTRAL_CONTROLLER_COMMIT_THREADS];
+	std::thread _redisOpThread;
 	std::thread _onlineNotificationThread;
 
 	std::unordered_map< std::pair<uint64_t,uint64_t>,std::pair<int64_t,InetAddress>,_PairHasher > _lastOnline;
@@ -94,6 +94,10 @@
 #define CPPHTTPLIB_COMPRESSION_BUFSIZ size_t(16384u)
 #endif
 
+#ifndef CPPHTTPLIB_COMPRESSION_MIN_SIZE
+#define CPPHTTPLIB_COMPRESSION_MIN_SIZE size_t(0u)
+#endif
+
 #ifndef CPPHTTPLIB_THREAD_POOL_COUNT
 #define CPPHTTPLIB_THREAD_POOL_COUNT                                           \
   ((std::max)(8u, std::thread::hardware_concurrency() > 0                      \
@@ -753,6 +757,8 @@ protected:
                        bool &connection_closed,
                        const std::function<void(Request &)> &setup_request);
 
+  virtual bool process_and_close_socket(socket_t sock);
+
   std::atomic<socket_t> svr_sock_{INVALID_SOCKET};
   size_t keep_alive_max_count_ = CPPHTTPLIB_KEEPALIVE_MAX_COUNT;
   time_t keep_alive_timeout_sec_ = CPPHTTPLIB_KEEPALIVE_TIMEOUT_SECOND;
@@ -808,8 +814,6 @@ private:
                          MultipartContentHeader multipart_header,
                          ContentReceiver multipart_receiver);
 
-  virtual bool process_and_close_socket(socket_t sock);
-
   struct MountPointEntry {
     std::string mount_point;
     std::string base_dir;
@@ -5989,7 +5993,8 @@ inline void Server::apply_ranges(const Request &req, Response &res,
       }
     }
 
-    if (type != detail::EncodingType::None) {
+    if (type != detail::EncodingType::None &&
+        res.body.size() >= CPPHTTPLIB_COMPRESSION_MIN_SIZE) {
       std::unique_ptr<detail::compressor> compressor;
       std::string content_encoding;
 
@@ -1368,6 +1368,26 @@ typedef struct
 	 * Is path preferred?
 	 */
 	int preferred;
+
+	/**
+	 * Total bytes received on this path
+	 */
+	uint64_t bytesIn;
+
+	/**
+	 * Total bytes sent on this path
+	 */
+	uint64_t bytesOut;
+
+	/**
+	 * Smoothed receive rate in bytes per second
+	 */
+	uint64_t rateIn;
+
+	/**
+	 * Smoothed send rate in bytes per second
+	 */
+	uint64_t rateOut;
 } ZT_PeerPhysicalPath;
 
 /**
@@ -1512,7 +1532,26 @@ enum ZT_StateObjectType
 	 * Canonical path: <HOME>/networks.d/<NETWORKID>.conf (16-digit hex ID)
 	 * Persistence: required if network memberships should persist
 	 */
-	ZT_STATE_OBJECT_NETWORK_CONFIG = 6
+	ZT_STATE_OBJECT_NETWORK_CONFIG = 6,
+
+	/**
+	 * Network membership credential state (1.10.7+)
+	 *
+	 * Object ID: [0] network ID, [1] member peer address
+	 * Canonical path: <HOME>/membership.d/<NETWORKID>-<ADDRESS>.mem
+	 * Persistence: optional, can be cleared at any time
+	 */
+	ZT_STATE_OBJECT_MEMBERSHIP = 7,
+
+	/**
+	 * Cached result of local identity self-validation (1.10.7+)
+	 *
+	 * Object ID: this node's address
+	 * Canonical path: <HOME>/identity.validated
+	 * Persistence: optional, can be cleared at any time; should be stored
+	 * with the same restricted permissions as the secret identity
+	 */
+	ZT_STATE_OBJECT_IDENTITY_VALIDATION = 8
 };
 
 /**
@@ -1815,6 +1854,52 @@ ZT_SDK_API enum ZT_ResultCode ZT_Node_processWirePacket(
 	unsigned int packetLength,
 	volatile int64_t *nextBackgroundTaskDeadline);
 
+/**
+ * Function to dispose of a buffer previously lent to the core
+ *
+ * The first argument is the arbitrary pointer supplied alongside the
+ * function and the second is the buffer being returned.
+ */
+typedef void (*ZT_BufferFreeFunction)(void *,void *);
+
+/**
+ * Process a wire packet from a buffer lent to the core (zero-copy variant)
+ *
+ * This behaves like ZT_Node_processWirePacket() except that the core
+ * borrows the caller's buffer instead of copying out of it, which avoids
+ * one full memcpy per packet when incoming packets are staged for worker
+ * threads (see ZT_Node_setRxWorkerThreads equivalent in the C++ API). The
+ * buffer remains owned by the core until freeFunction is called with it,
+ * which may happen on another thread and after this call has returned.
+ * Callers feeding from a receive buffer pool should recycle buffers there.
+ *
+ * If freeFunction is NULL this is exactly equivalent to
+ * ZT_Node_processWirePacket().
+ *
+ * @param node Node instance
+ * @param tptr Thread pointer to pass to functions/callbacks resulting from this call
+ * @param now Current clock in milliseconds
+ * @param localSocket Local socket (you can use 0 if only one local socket is bound and ignore this)
+ * @param remoteAddress Origin of packet
+ * @param packetData Packet data (lent to the core until freeFunction is called)
+ * @param packetLength Packet length
+ * @param freeFunction Function the core calls exactly once to return the buffer, or NULL to copy as usual
+ * @param freeFunctionArg Arbitrary pointer passed as first argument to freeFunction
+ * @param nextBackgroundTaskDeadline Value/result: set to deadline for next call to processBackgroundTasks()
+ * @return OK (0) or error code if a fatal error condition has occurred
+ */
+ZT_SDK_API enum ZT_ResultCode ZT_Node_processWirePacketLended(
+	ZT_Node *node,
+	void *tptr,
+	int64_t now,
+	int64_t localSocket,
+	const struct sockaddr_storage *remoteAddress,
+	void *packetData,
+	unsigned int packetLength,
+	ZT_BufferFreeFunction freeFunction,
+	void *freeFunctionArg,
+	volatile int64_t *nextBackgroundTaskDeadline);
+
 /**
  * Process a frame from a virtual network port (tap)
  *
@@ -1844,6 +1929,71 @@ ZT_SDK_API enum ZT_ResultCode ZT_Node_processVirtualNetworkFrame(
 	unsigned int frameLength,
 	volatile int64_t *nextBackgroundTaskDeadline);
 
+/**
+ * A single Ethernet frame within a batch passed to ZT_Node_processVirtualNetworkFrames()
+ */
+typedef struct
+{
+	/**
+	 * Source MAC address (least significant 48 bits)
+	 */
+	uint64_t sourceMac;
+
+	/**
+	 * Destination MAC address (least significant 48 bits)
+	 */
+	uint64_t destMac;
+
+	/**
+	 * 16-bit Ethernet frame type
+	 */
+	unsigned int etherType;
+
+	/**
+	 * 10-bit VLAN ID or 0 if none
+	 */
+	unsigned int vlanId;
+
+	/**
+	 * Frame payload data
+	 */
+	const void *frameData;
+
+	/**
+	 * Frame payload length
+	 */
+	unsigned int frameLength;
+} ZT_VirtualNetworkFrame;
+
+/**
+ * Process a batch of frames from one virtual network port (tap)
+ *
+ * This behaves like calling ZT_Node_processVirtualNetworkFrame() once per
+ * entry of frames[], but the core resolves the network and takes its
+ * internal locks once for the whole batch instead of once per frame.
+ * Taps that drain several frames from the OS per wakeup (multi-queue or
+ * otherwise) should prefer this entry point.
+ *
+ * All frames in one batch must belong to the same network.
+ *
+ * @param node Node instance
+ * @param tptr Thread pointer to pass to functions/callbacks resulting from this call
+ * @param now Current clock in milliseconds
+ * @param nwid ZeroTier 64-bit virtual network ID of every frame in the batch
+ * @param frames Frames to process, in order
+ * @param frameCount Number of entries in frames[]
+ * @param nextBackgroundTaskDeadline Value/result: set to deadline for next call to processBackgroundTasks()
+ * @return OK (0) or error code if a fatal error condition has occurred
+ */
+ZT_SDK_API enum ZT_ResultCode ZT_Node_processVirtualNetworkFrames(
+	ZT_Node *node,
+	void *tptr,
+	int64_t now,
+	uint64_t nwid,
+	const ZT_VirtualNetworkFrame *frames,
+	unsigned int frameCount,
+	volatile int64_t *nextBackgroundTaskDeadline);
+
 /**
  * Perform periodic background operations
  *
@@ -65,6 +65,7 @@ jclass VirtualNetworkConfigListener_class;
 jclass VirtualNetworkConfigOperation_class;
 jclass VirtualNetworkConfig_class;
 jclass VirtualNetworkDNS_class;
+jclass VirtualNetworkFrameBatchListener_class;
 jclass VirtualNetworkFrameListener_class;
 jclass VirtualNetworkRoute_class;
 jclass VirtualNetworkStatus_class;
@@ -95,6 +96,7 @@ jmethodID Version_ctor;
 jmethodID VirtualNetworkConfigListener_onNetworkConfigurationUpdated_method;
 jmethodID VirtualNetworkConfig_ctor;
 jmethodID VirtualNetworkDNS_ctor;
+jmethodID VirtualNetworkFrameBatchListener_onVirtualNetworkFrameBatch_method;
 jmethodID VirtualNetworkFrameListener_onVirtualNetworkFrame_method;
 jmethodID VirtualNetworkRoute_ctor;
 
@@ -148,6 +150,7 @@ void setupJNICache(JavaVM *vm) {
     SETCLASS(VirtualNetworkConfigOperation_class, "com/zerotier/sdk/VirtualNetworkConfigOperation");
     SETCLASS(VirtualNetworkConfig_class, "com/zerotier/sdk/VirtualNetworkConfig");
     SETCLASS(VirtualNetworkDNS_class, "com/zerotier/sdk/VirtualNetworkDNS");
+    SETCLASS(VirtualNetworkFrameBatchListener_class, "com/zerotier/sdk/VirtualNetworkFrameBatchListener");
     SETCLASS(VirtualNetworkFrameListener_class, "com/zerotier/sdk/VirtualNetworkFrameListener");
     SETCLASS(VirtualNetworkRoute_class, "com/zerotier/sdk/VirtualNetworkRoute");
     SETCLASS(VirtualNetworkStatus_class, "com/zerotier/sdk/VirtualNetworkStatus");
@@ -178,6 +181,7 @@ void setupJNICache(JavaVM *vm) {
     EXCEPTIONANDNULLCHECK(VirtualNetworkConfigListener_onNetworkConfigurationUpdated_method = env->GetMethodID(VirtualNetworkConfigListener_class, "onNetworkConfigurationUpdated", "(JLcom/zerotier/sdk/VirtualNetworkConfigOperation;Lcom/zerotier/sdk/VirtualNetworkConfig;)I"));
     EXCEPTIONANDNULLCHECK(VirtualNetworkConfig_ctor = env->GetMethodID(VirtualNetworkConfig_class, "<init>", "(JJLjava/lang/String;Lcom/zerotier/sdk/VirtualNetworkStatus;Lcom/zerotier/sdk/VirtualNetworkType;IZZZIJ[Ljava/net/InetSocketAddress;[Lcom/zerotier/sdk/VirtualNetworkRoute;Lcom/zerotier/sdk/VirtualNetworkDNS;)V"));
     EXCEPTIONANDNULLCHECK(VirtualNetworkDNS_ctor = env->GetMethodID(VirtualNetworkDNS_class, "<init>", "(Ljava/lang/String;Ljava/util/ArrayList;)V"));
+    EXCEPTIONANDNULLCHECK(VirtualNetworkFrameBatchListener_onVirtualNetworkFrameBatch_method = env->GetMethodID(VirtualNetworkFrameBatchListener_class, "onVirtualNetworkFrameBatch", "(Ljava/nio/ByteBuffer;I)V"));
     EXCEPTIONANDNULLCHECK(VirtualNetworkFrameListener_onVirtualNetworkFrame_method = env->GetMethodID(VirtualNetworkFrameListener_class, "onVirtualNetworkFrame", "(JJJJJ[B)V"));
     EXCEPTIONANDNULLCHECK(VirtualNetworkRoute_ctor = env->GetMethodID(VirtualNetworkRoute_class, "<init>", "(Ljava/net/InetSocketAddress;Ljava/net/InetSocketAddress;II)V"));
 
@@ -226,6 +230,7 @@ void teardownJNICache(JavaVM *vm) {
     env->DeleteGlobalRef(VirtualNetworkConfigOperation_class);
     env->DeleteGlobalRef(VirtualNetworkConfig_class);
     env->DeleteGlobalRef(VirtualNetworkDNS_class);
+    env->DeleteGlobalRef(VirtualNetworkFrameBatchListener_class);
     env->DeleteGlobalRef(VirtualNetworkFrameListener_class);
     env->DeleteGlobalRef(VirtualNetworkRoute_class);
     env->DeleteGlobalRef(VirtualNetworkStatus_class);
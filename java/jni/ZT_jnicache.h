@@ -34,6 +34,7 @@ extern jclass VirtualNetworkConfigListener_class;
 extern jclass VirtualNetworkConfigOperation_class;
 extern jclass VirtualNetworkConfig_class;
 extern jclass VirtualNetworkDNS_class;
+extern jclass VirtualNetworkFrameBatchListener_class;
 extern jclass VirtualNetworkFrameListener_class;
 extern jclass VirtualNetworkRoute_class;
 extern jclass VirtualNetworkStatus_class;
@@ -64,6 +65,7 @@ extern jmethodID Version_ctor;
 extern jmethodID VirtualNetworkConfigListener_onNetworkConfigurationUpdated_method;
 extern jmethodID VirtualNetworkConfig_ctor;
 extern jmethodID VirtualNetworkDNS_ctor;
+extern jmethodID VirtualNetworkFrameBatchListener_onVirtualNetworkFrameBatch_method;
 extern jmethodID VirtualNetworkFrameListener_onVirtualNetworkFrame_method;
 extern jmethodID VirtualNetworkRoute_ctor;
 
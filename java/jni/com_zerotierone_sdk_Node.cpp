@@ -74,6 +74,10 @@ namespace {
             packetSender = env->NewGlobalRef(packetSenderLocalIn);
             eventListener = env->NewGlobalRef(eventListenerLocalIn);
             frameListener = env->NewGlobalRef(frameListenerLocalIn);
+            frameBatchListener = NULL;
+            if ((frameListenerLocalIn != NULL) && (env->IsInstanceOf(frameListenerLocalIn, VirtualNetworkFrameBatchListener_class))) {
+                frameBatchListener = env->NewGlobalRef(frameListenerLocalIn);
+            }
             configListener = env->NewGlobalRef(configListenerLocalIn);
             pathChecker = env->NewGlobalRef(pathCheckerLocalIn);
         };
@@ -88,6 +92,9 @@ namespace {
             env->DeleteGlobalRef(packetSender);
             env->DeleteGlobalRef(eventListener);
             env->DeleteGlobalRef(frameListener);
+            if (frameBatchListener != NULL) {
+                env->DeleteGlobalRef(frameBatchListener);
+            }
             env->DeleteGlobalRef(configListener);
             env->DeleteGlobalRef(pathChecker);
         }
@@ -103,6 +110,7 @@ namespace {
         jobject packetSender;
         jobject eventListener;
         jobject frameListener;
+        jobject frameBatchListener; // same object as frameListener if it implements the batch interface, otherwise NULL
         jobject configListener;
         jobject pathChecker;
 
@@ -171,6 +179,61 @@ namespace {
         return ret;
     }
 
+    // Accumulation buffer for batched frame delivery. A batch window is
+    // opened around each call into the node; frames emitted while it is open
+    // are packed into this native buffer and handed to Java in one upcall
+    // wrapping it in a direct ByteBuffer, instead of one upcall (and one
+    // byte[] allocation) per frame.
+    #define ZT_JNI_FRAME_BATCH_CAPACITY 131072
+    #define ZT_JNI_FRAME_RECORD_HEADER_SIZE 36
+
+    struct FrameBatch
+    {
+        FrameBatch() : ref(NULL), open(false), count(0), len(0) {}
+        JniRef *ref;
+        bool open;
+        unsigned int count;
+        unsigned int len;
+        uint8_t buf[ZT_JNI_FRAME_BATCH_CAPACITY];
+    };
+    static thread_local FrameBatch s_frameBatch;
+
+    void flushFrameBatch(JNIEnv *env)
+    {
+        if (s_frameBatch.count == 0) {
+            return;
+        }
+        JniRef *ref = s_frameBatch.ref;
+        jobject frames = env->NewDirectByteBuffer(s_frameBatch.buf, (jlong)s_frameBatch.len);
+        if (env->ExceptionCheck() || frames == NULL) {
+            LOGE("Error creating direct ByteBuffer for frame batch");
+        } else {
+            env->CallVoidMethod(ref->frameBatchListener, VirtualNetworkFrameBatchListener_onVirtualNetworkFrameBatch_method, frames, (jint)s_frameBatch.count);
+            if (env->ExceptionCheck()) {
+                LOGE("Exception calling onVirtualNetworkFrameBatch");
+            }
+            env->DeleteLocalRef(frames);
+        }
+        s_frameBatch.count = 0;
+        s_frameBatch.len = 0;
+    }
+
+    inline void appendBE64(uint8_t *p, uint64_t v)
+    {
+        for (int i = 7; i >= 0; --i) {
+            p[i] = (uint8_t)v;
+            v >>= 8;
+        }
+    }
+
+    inline void appendBE32(uint8_t *p, uint32_t v)
+    {
+        p[0] = (uint8_t)(v >> 24);
+        p[1] = (uint8_t)(v >> 16);
+        p[2] = (uint8_t)(v >> 8);
+        p[3] = (uint8_t)v;
+    }
+
     void VirtualNetworkFrameFunctionCallback(ZT_Node *node,
         void *userData,
         void *threadData,
@@ -206,6 +269,30 @@ namespace {
             return;
         }
 
+        if (s_frameBatch.open && ref->frameBatchListener != NULL) {
+            const unsigned int recordLen = ZT_JNI_FRAME_RECORD_HEADER_SIZE + frameLength;
+            if (recordLen <= ZT_JNI_FRAME_BATCH_CAPACITY) {
+                if ((s_frameBatch.count != 0) && ((s_frameBatch.len + recordLen) > ZT_JNI_FRAME_BATCH_CAPACITY)) {
+                    flushFrameBatch(env);
+                    if (env->ExceptionCheck()) {
+                        return;
+                    }
+                }
+                s_frameBatch.ref = ref;
+                uint8_t *p = s_frameBatch.buf + s_frameBatch.len;
+                appendBE64(p, nwid);
+                appendBE64(p + 8, sourceMac);
+                appendBE64(p + 16, destMac);
+                appendBE32(p + 24, (uint32_t)etherType);
+                appendBE32(p + 28, (uint32_t)vlanid);
+                appendBE32(p + 32, (uint32_t)frameLength);
+                memcpy(p + ZT_JNI_FRAME_RECORD_HEADER_SIZE, frameData, frameLength);
+                s_frameBatch.len += recordLen;
+                s_frameBatch.count++;
+                return;
+            }
+        }
+
         const unsigned char *bytes = static_cast<const unsigned char*>(frameData);
         jbyteArray dataArray = newByteArray(env, bytes, frameLength);
         if(env->ExceptionCheck() || dataArray == NULL)
@@ -951,6 +1038,8 @@ JNIEXPORT jobject JNICALL Java_com_zerotier_sdk_Node_processVirtualNetworkFrame(
 
     int64_t nextBackgroundTaskDeadline = 0;
 
+    s_frameBatch.open = true;
+
     ZT_ResultCode rc = ZT_Node_processVirtualNetworkFrame(
         node,
         NULL,
@@ -963,11 +1052,15 @@ JNIEXPORT jobject JNICALL Java_com_zerotier_sdk_Node_processVirtualNetworkFrame(
         (const void*)localData,
         frameLength,
         &nextBackgroundTaskDeadline);
+    s_frameBatch.open = false;
     if (env->ExceptionCheck()) {
         LOGE("Exception calling ZT_Node_processVirtualNetworkFrame");
+        s_frameBatch.count = 0; // cannot deliver with an exception pending
+        s_frameBatch.len = 0;
         free(localData);
         return ResultCode_RESULT_FATAL_ERROR_INTERNAL_enum;
     }
+    flushFrameBatch(env);
     if (rc != ZT_RESULT_OK) {
         LOGE("ZT_Node_processVirtualNetworkFrame returned: %d", rc);
     }
@@ -1028,6 +1121,8 @@ JNIEXPORT jobject JNICALL Java_com_zerotier_sdk_Node_processWirePacket(
 
     int64_t nextBackgroundTaskDeadline = 0;
 
+    s_frameBatch.open = true;
+
     ZT_ResultCode rc = ZT_Node_processWirePacket(
         node,
         NULL,
@@ -1037,11 +1132,15 @@ JNIEXPORT jobject JNICALL Java_com_zerotier_sdk_Node_processWirePacket(
         localData,
         packetLength,
         &nextBackgroundTaskDeadline);
+    s_frameBatch.open = false;
     if (env->ExceptionCheck()) {
         LOGE("Exception calling ZT_Node_processWirePacket");
+        s_frameBatch.count = 0; // cannot deliver with an exception pending
+        s_frameBatch.len = 0;
         free(localData);
         return ResultCode_RESULT_FATAL_ERROR_INTERNAL_enum;
     }
+    flushFrameBatch(env);
     if(rc != ZT_RESULT_OK)
     {
         LOGE("ZT_Node_processWirePacket returned: %d", rc);
@@ -1079,11 +1178,16 @@ JNIEXPORT jobject JNICALL Java_com_zerotier_sdk_Node_processBackgroundTasks(
     int64_t now = (int64_t)in_now;
     int64_t nextBackgroundTaskDeadline = 0;
 
+    s_frameBatch.open = true;
     ZT_ResultCode rc = ZT_Node_processBackgroundTasks(node, NULL, now, &nextBackgroundTaskDeadline);
+    s_frameBatch.open = false;
     if (env->ExceptionCheck()) {
         LOGE("Exception calling ZT_Node_processBackgroundTasks");
+        s_frameBatch.count = 0; // cannot deliver with an exception pending
+        s_frameBatch.len = 0;
         return ResultCode_RESULT_FATAL_ERROR_INTERNAL_enum;
     }
+    flushFrameBatch(env);
     if (rc != ZT_RESULT_OK) {
         LOGE("ZT_Node_processBackgroundTasks returned: %d", rc);
     }
@@ -0,0 +1,60 @@
+/*
+ * ZeroTier One - Network Virtualization Everywhere
+ * Copyright (C) 2011-2015  ZeroTier, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * --
+ *
+ * ZeroTier may be used and distributed under the terms of the GPLv3, which
+ * are available at: http://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * If you would like to embed ZeroTier into a commercial application or
+ * redistribute it in a modified binary form, please contact ZeroTier Networks
+ * LLC. Start here: http://www.zerotier.com/
+ */
+
+package com.zerotier.sdk;
+
+import java.nio.ByteBuffer;
+
+/**
+ * Batched variant of {@link VirtualNetworkFrameListener}
+ *
+ * If the frame listener passed to {@link Node} also implements this
+ * interface, frames emitted during a single call into the node (for example
+ * one processWirePacket() call decrypting a burst of packets) are accumulated
+ * natively and delivered with one call to onVirtualNetworkFrameBatch()
+ * instead of one JNI upcall per frame.
+ */
+public interface VirtualNetworkFrameBatchListener extends VirtualNetworkFrameListener {
+
+    /**
+     * Called with a batch of one or more virtual network frames
+     *
+     * The buffer contains frameCount records, each laid out big-endian as:
+     *
+     *   network ID (8 bytes), source MAC (8), destination MAC (8),
+     *   EtherType (4), VLAN ID (4), frame length (4), frame data
+     *
+     * The buffer wraps native memory owned by the caller and is only valid
+     * until this method returns; copy anything that must be retained.
+     *
+     * @param frames direct buffer of packed frame records
+     * @param frameCount number of records in the buffer
+     */
+    void onVirtualNetworkFrameBatch(
+                ByteBuffer frames,
+                int frameCount);
+}
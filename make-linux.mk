@@ -41,10 +41,25 @@ else
 	override DEFS+=-DZT_USE_SYSTEM_NATPMP
 endif
 
+# Deployment profile: re-size queues and table capacities for a role
+# (see node/Constants.hpp). Leave unset for the default general build.
+ifeq ($(ZT_PROFILE),relay)
+	override DEFS+=-DZT_DEPLOYMENT_PROFILE_RELAY
+endif
+ifeq ($(ZT_PROFILE),embedded)
+	override DEFS+=-DZT_DEPLOYMENT_PROFILE_EMBEDDED
+endif
+
 # Use bundled http-parser since distribution versions are NOT API-stable or compatible!
 # Trying to use dynamically linked libhttp-parser causes tons of compatibility problems.
 ONE_OBJS+=ext/http-parser/http_parser.o
 
+# Gzip large control plane (JSON API) responses when the client sends
+# Accept-Encoding: gzip. Responses smaller than about one MTU go out
+# uncompressed since they fit in a single packet anyway.
+override DEFS+=-DCPPHTTPLIB_ZLIB_SUPPORT -DCPPHTTPLIB_COMPRESSION_MIN_SIZE=1400
+override LDLIBS+=-lz
+
 ifeq ($(ZT_RULES_ENGINE_DEBUGGING),1)
 	override DEFS+=-DZT_RULES_ENGINE_DEBUGGING
 endif
@@ -109,6 +124,12 @@ ifeq ($(ZT_VAULT_SUPPORT),1)
 	override LDLIBS+=-lcurl
 endif
 
+# Opt-in io_uring UDP datapath (requires liburing; enable at runtime with "ioUring": true in local.conf)
+ifeq ($(ZT_USE_IO_URING),1)
+	override DEFS+=-DZT_USE_IO_URING
+	override LDLIBS+=-luring
+endif
+
 # Determine system build architecture from compiler target
 CC_MACH=$(shell $(CC) -dumpmachine | cut -d '-' -f 1)
 ZT_ARCHITECTURE=999
@@ -390,13 +411,18 @@ selftest:	$(CORE_OBJS) $(ONE_OBJS) selftest.o
 
 zerotier-selftest: selftest
 
+bench:	$(CORE_OBJS) $(ONE_OBJS) bench.o
+	$(CXX) $(CXXFLAGS) $(LDFLAGS) -o zerotier-bench bench.o $(CORE_OBJS) $(ONE_OBJS) $(LDLIBS)
+
+zerotier-bench: bench
+
 manpages:	FORCE
 	cd doc ; ./build.sh
 
 doc:	manpages
 
 clean: FORCE
-	rm -rf *.a *.so *.o node/*.o controller/*.o osdep/*.o service/*.o ext/http-parser/*.o ext/miniupnpc/*.o ext/libnatpmp/*.o $(CORE_OBJS) $(ONE_OBJS) zerotier-one zerotier-idtool zerotier-cli zerotier-selftest build-* ZeroTierOneInstaller-* *.deb *.rpm .depend debian/files debian/zerotier-one*.debhelper debian/zerotier-one.substvars debian/*.log debian/zerotier-one doc/node_modules ext/misc/*.o debian/.debhelper debian/debhelper-build-stamp docker/zerotier-one zeroidc/target
+	rm -rf *.a *.so *.o node/*.o controller/*.o osdep/*.o service/*.o ext/http-parser/*.o ext/miniupnpc/*.o ext/libnatpmp/*.o $(CORE_OBJS) $(ONE_OBJS) zerotier-one zerotier-idtool zerotier-cli zerotier-selftest zerotier-bench build-* ZeroTierOneInstaller-* *.deb *.rpm .depend debian/files debian/zerotier-one*.debhelper debian/zerotier-one.substvars debian/*.log debian/zerotier-one doc/node_modules ext/misc/*.o debian/.debhelper debian/debhelper-build-stamp docker/zerotier-one zeroidc/target
 
 distclean:	clean
 
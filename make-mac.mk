@@ -30,6 +30,21 @@ include objects.mk
 ONE_OBJS+=osdep/MacEthernetTap.o osdep/MacKextEthernetTap.o osdep/MacDNSHelper.o ext/http-parser/http_parser.o
 LIBS+=-framework CoreServices -framework SystemConfiguration -framework CoreFoundation -framework Security
 
+# Deployment profile: re-size queues and table capacities for a role
+# (see node/Constants.hpp). Leave unset for the default general build.
+ifeq ($(ZT_PROFILE),relay)
+	DEFS+=-DZT_DEPLOYMENT_PROFILE_RELAY
+endif
+ifeq ($(ZT_PROFILE),embedded)
+	DEFS+=-DZT_DEPLOYMENT_PROFILE_EMBEDDED
+endif
+
+# Gzip large control plane (JSON API) responses when the client sends
+# Accept-Encoding: gzip. Responses smaller than about one MTU go out
+# uncompressed since they fit in a single packet anyway.
+DEFS+=-DCPPHTTPLIB_ZLIB_SUPPORT -DCPPHTTPLIB_COMPRESSION_MIN_SIZE=1400
+LIBS+=-lz
+
 # Official releases are signed with our Apple cert and apply software updates by default
 ifeq ($(ZT_OFFICIAL_RELEASE),1)
 	DEFS+=-DZT_SOFTWARE_UPDATE_DEFAULT="\"apply\""
@@ -25,6 +25,20 @@
 #define Td2_r(x) ZT_ROR32(Td0[x], 16U)
 #define Td3_r(x) ZT_ROR32(Td0[x], 24U)
 
+// One full and one final software AES round (a -> b), used where rounds are
+// interleaved across multiple blocks and writing them all out longhand would
+// be unreadable. Expects m8/m8_8/m8_16/m8_24 masks and rk in scope.
+#define ZT_AES_SW_ROUND(b0, b1, b2, b3, a0, a1, a2, a3, k) \
+	b0 = Te0[a0 >> 24U] ^ Te1_r((a1 >> 16U) & m8) ^ Te2_r((a2 >> 8U) & m8) ^ Te3_r(a3 & m8) ^ rk[k]; \
+	b1 = Te0[a1 >> 24U] ^ Te1_r((a2 >> 16U) & m8) ^ Te2_r((a3 >> 8U) & m8) ^ Te3_r(a0 & m8) ^ rk[(k) + 1]; \
+	b2 = Te0[a2 >> 24U] ^ Te1_r((a3 >> 16U) & m8) ^ Te2_r((a0 >> 8U) & m8) ^ Te3_r(a1 & m8) ^ rk[(k) + 2]; \
+	b3 = Te0[a3 >> 24U] ^ Te1_r((a0 >> 16U) & m8) ^ Te2_r((a1 >> 8U) & m8) ^ Te3_r(a2 & m8) ^ rk[(k) + 3];
+#define ZT_AES_SW_LASTROUND(b0, b1, b2, b3, a0, a1, a2, a3, k) \
+	b0 = (Te2_r(a0 >> 24U) & m8_24) ^ (Te3_r((a1 >> 16U) & m8) & m8_16) ^ (Te0[(a2 >> 8U) & m8] & m8_8) ^ (Te1_r(a3 & m8) & m8) ^ rk[k]; \
+	b1 = (Te2_r(a1 >> 24U) & m8_24) ^ (Te3_r((a2 >> 16U) & m8) & m8_16) ^ (Te0[(a3 >> 8U) & m8] & m8_8) ^ (Te1_r(a0 & m8) & m8) ^ rk[(k) + 1]; \
+	b2 = (Te2_r(a2 >> 24U) & m8_24) ^ (Te3_r((a3 >> 16U) & m8) & m8_16) ^ (Te0[(a0 >> 8U) & m8] & m8_8) ^ (Te1_r(a1 & m8) & m8) ^ rk[(k) + 2]; \
+	b3 = (Te2_r(a3 >> 24U) & m8_24) ^ (Te3_r((a0 >> 16U) & m8) & m8_16) ^ (Te0[(a1 >> 8U) & m8] & m8_8) ^ (Te1_r(a2 & m8) & m8) ^ rk[(k) + 3];
+
 namespace ZeroTier {
 
 // GMAC ---------------------------------------------------------------------------------------------------------------
@@ -271,7 +285,65 @@ void AES::CTR::crypt(const void *const input, unsigned int len) noexcept
 		const uint32_t m8_16 = 0x00ff0000;
 		const uint32_t m8_24 = 0xff000000;
 		if (likely((((uintptr_t)out & 7U) == 0U) && (((uintptr_t)in & 7U) == 0U))) {
-			do {
+			// Compute two independent keystream blocks per iteration. Without AES
+			// instructions the table lookups of a single block form one long
+			// dependency chain, so a second chain roughly doubles the work a
+			// superscalar core can keep in flight.
+			while (len >= 32) {
+				uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
+				uint32_t u0, u1, u2, u3, v0, v1, v2, v3;
+				s0 = ctr0rk0;
+				s1 = ctr1rk1;
+				s2 = ctr2rk2;
+				s3 = ctr++ ^ rk[3];
+				u0 = ctr0rk0;
+				u1 = ctr1rk1;
+				u2 = ctr2rk2;
+				u3 = ctr++ ^ rk[3];
+
+				const uint64_t in0 = *reinterpret_cast<const uint64_t *>(in);
+				const uint64_t in1 = *reinterpret_cast<const uint64_t *>(in + 8);
+				const uint64_t in2 = *reinterpret_cast<const uint64_t *>(in + 16);
+				const uint64_t in3 = *reinterpret_cast<const uint64_t *>(in + 24);
+				in += 32;
+
+				ZT_AES_SW_ROUND(t0, t1, t2, t3, s0, s1, s2, s3, 4)
+				ZT_AES_SW_ROUND(v0, v1, v2, v3, u0, u1, u2, u3, 4)
+				ZT_AES_SW_ROUND(s0, s1, s2, s3, t0, t1, t2, t3, 8)
+				ZT_AES_SW_ROUND(u0, u1, u2, u3, v0, v1, v2, v3, 8)
+				ZT_AES_SW_ROUND(t0, t1, t2, t3, s0, s1, s2, s3, 12)
+				ZT_AES_SW_ROUND(v0, v1, v2, v3, u0, u1, u2, u3, 12)
+				ZT_AES_SW_ROUND(s0, s1, s2, s3, t0, t1, t2, t3, 16)
+				ZT_AES_SW_ROUND(u0, u1, u2, u3, v0, v1, v2, v3, 16)
+				ZT_AES_SW_ROUND(t0, t1, t2, t3, s0, s1, s2, s3, 20)
+				ZT_AES_SW_ROUND(v0, v1, v2, v3, u0, u1, u2, u3, 20)
+				ZT_AES_SW_ROUND(s0, s1, s2, s3, t0, t1, t2, t3, 24)
+				ZT_AES_SW_ROUND(u0, u1, u2, u3, v0, v1, v2, v3, 24)
+				ZT_AES_SW_ROUND(t0, t1, t2, t3, s0, s1, s2, s3, 28)
+				ZT_AES_SW_ROUND(v0, v1, v2, v3, u0, u1, u2, u3, 28)
+				ZT_AES_SW_ROUND(s0, s1, s2, s3, t0, t1, t2, t3, 32)
+				ZT_AES_SW_ROUND(u0, u1, u2, u3, v0, v1, v2, v3, 32)
+				ZT_AES_SW_ROUND(t0, t1, t2, t3, s0, s1, s2, s3, 36)
+				ZT_AES_SW_ROUND(v0, v1, v2, v3, u0, u1, u2, u3, 36)
+				ZT_AES_SW_ROUND(s0, s1, s2, s3, t0, t1, t2, t3, 40)
+				ZT_AES_SW_ROUND(u0, u1, u2, u3, v0, v1, v2, v3, 40)
+				ZT_AES_SW_ROUND(t0, t1, t2, t3, s0, s1, s2, s3, 44)
+				ZT_AES_SW_ROUND(v0, v1, v2, v3, u0, u1, u2, u3, 44)
+				ZT_AES_SW_ROUND(s0, s1, s2, s3, t0, t1, t2, t3, 48)
+				ZT_AES_SW_ROUND(u0, u1, u2, u3, v0, v1, v2, v3, 48)
+				ZT_AES_SW_ROUND(t0, t1, t2, t3, s0, s1, s2, s3, 52)
+				ZT_AES_SW_ROUND(v0, v1, v2, v3, u0, u1, u2, u3, 52)
+				ZT_AES_SW_LASTROUND(s0, s1, s2, s3, t0, t1, t2, t3, 56)
+				ZT_AES_SW_LASTROUND(u0, u1, u2, u3, v0, v1, v2, v3, 56)
+
+				*reinterpret_cast<uint64_t *>(out) = in0 ^ Utils::hton(((uint64_t)s0 << 32U) | (uint64_t)s1);
+				*reinterpret_cast<uint64_t *>(out + 8) = in1 ^ Utils::hton(((uint64_t)s2 << 32U) | (uint64_t)s3);
+				*reinterpret_cast<uint64_t *>(out + 16) = in2 ^ Utils::hton(((uint64_t)u0 << 32U) | (uint64_t)u1);
+				*reinterpret_cast<uint64_t *>(out + 24) = in3 ^ Utils::hton(((uint64_t)u2 << 32U) | (uint64_t)u3);
+				out += 32;
+				len -= 32;
+			}
+			if (len >= 16) {
 				uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
 				s0 = ctr0rk0;
 				s1 = ctr1rk1;
@@ -342,7 +414,8 @@ void AES::CTR::crypt(const void *const input, unsigned int len) noexcept
 				*reinterpret_cast<uint64_t *>(out) = in0 ^ Utils::hton(((uint64_t)s0 << 32U) | (uint64_t)s1);
 				*reinterpret_cast<uint64_t *>(out + 8) = in1 ^ Utils::hton(((uint64_t)s2 << 32U) | (uint64_t)s3);
 				out += 16;
-			} while ((len -= 16) >= 16);
+				len -= 16;
+			}
 		} else {
 			do {
 				uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
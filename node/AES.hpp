@@ -455,6 +455,13 @@ public:
 	 * Decryptor for AES-GMAC-SIV.
 	 *
 	 * GMAC-SIV decryption is single-pass. AAD (if any) must be processed first.
+	 *
+	 * Decryption and authentication are interleaved: GMAC consumes each chunk
+	 * of plaintext immediately after AES-CTR writes it, so the message is
+	 * swept once instead of being decrypted in full and then re-read to
+	 * authenticate. (The encrypt side cannot be fused this way: SIV derives
+	 * the CTR IV from the GMAC of the entire plaintext, so encryption is
+	 * two-pass by construction.)
 	 */
 	class GMACSIVDecryptor
 	{
@@ -485,6 +492,7 @@ public:
 
 			_output = output;
 			_decryptedLen = 0;
+			_authedLen = 0;
 		}
 
 		/**
@@ -512,7 +520,25 @@ public:
 		 */
 		ZT_INLINE void update(const void *const input, const unsigned int len) noexcept
 		{
-			_ctr.crypt(input, len);
+			// Decrypt and authenticate in interleaved cache-sized chunks: GMAC
+			// consumes each chunk of plaintext while it is still hot from the
+			// CTR pass rather than re-reading the whole message in finish().
+			// CTR holds back a trailing partial block until finish(), so only
+			// whole decrypted blocks are authenticated here; finish() feeds
+			// GMAC the remainder.
+			const uint8_t *in = reinterpret_cast<const uint8_t *>(input);
+			unsigned int remaining = len;
+			while (remaining != 0) {
+				const unsigned int chunk = (remaining > 1024) ? 1024 : remaining;
+				_ctr.crypt(in, chunk);
+				const unsigned int decrypted = _ctr._len & ~15U;
+				if (decrypted > _authedLen) {
+					_gmac.update(reinterpret_cast<const uint8_t *>(_output) + _authedLen, decrypted - _authedLen);
+					_authedLen = decrypted;
+				}
+				in += chunk;
+				remaining -= chunk;
+			}
 			_decryptedLen += len;
 		}
 
@@ -526,7 +552,10 @@ public:
 			_ctr.finish();
 
 			uint64_t gmacTag[2];
-			_gmac.update(_output, _decryptedLen);
+			if (_decryptedLen > _authedLen) {
+				// The trailing partial block was only just decrypted by _ctr.finish()
+				_gmac.update(reinterpret_cast<const uint8_t *>(_output) + _authedLen, _decryptedLen - _authedLen);
+			}
 			_gmac.finish(reinterpret_cast<uint8_t *>(gmacTag));
 			return (gmacTag[0] ^ gmacTag[1]) == _ivMac[1];
 		}
@@ -537,6 +566,7 @@ public:
 		AES::GMAC _gmac;
 		void *_output;
 		unsigned int _decryptedLen;
+		unsigned int _authedLen; // whole-block plaintext bytes already fed to GMAC
 	};
 
 private:
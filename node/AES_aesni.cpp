@@ -179,6 +179,54 @@ void p_aesCtrInnerVAES256(unsigned int &len, const uint64_t c0, uint64_t &c1, co
 	} while (likely(len >= 64));
 }
 
+#define ZT_AES_VPCLMUL 1
+
+#ifdef __GNUC__
+__attribute__((__target__("ssse3,sse4,sse4.1,sse4.2,pclmul,avx,avx2,vpclmulqdq")))
+#endif
+__m128i p_gmacInnerVPCLMUL(unsigned int &len, const uint8_t *&in, __m128i y, const __m128i *const h, const __m128i *const h2) noexcept
+{
+	const __m128i sb = s_sseSwapBytes;
+	const __m256i sb2 = _mm256_broadcastsi128_si256(sb);
+
+	// Pair the powers of H so each 256-bit VPCLMULQDQ computes two of the
+	// four per-block products of the 4-wide GHASH at once: lane 0 of the "A"
+	// vectors covers block 1 (x H^4) and lane 1 covers block 2 (x H^3), while
+	// the "B" vectors cover blocks 3 (x H^2) and 4 (x H).
+	const __m256i hA = _mm256_set_m128i(h[2], h[3]);
+	const __m256i hB = _mm256_set_m128i(h[0], h[1]);
+	const __m256i h2A = _mm256_set_m128i(h2[2], h2[3]);
+	const __m256i h2B = _mm256_set_m128i(h2[0], h2[1]);
+
+	do {
+		const __m256i ya = _mm256_inserti128_si256(_mm256_setzero_si256(), y, 0);
+		const __m256i dA = _mm256_shuffle_epi8(_mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(in)), ya), sb2);
+		const __m256i dB = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + 32)), sb2);
+		in += 64;
+		len -= 64;
+		const __m256i t00 = _mm256_xor_si256(_mm256_clmulepi64_epi128(hA, dA, 0x00), _mm256_clmulepi64_epi128(hB, dB, 0x00));
+		const __m256i t11 = _mm256_xor_si256(_mm256_clmulepi64_epi128(hA, dA, 0x11), _mm256_clmulepi64_epi128(hB, dB, 0x11));
+		const __m256i dxA = _mm256_xor_si256(_mm256_shuffle_epi32(dA, 78), dA);
+		const __m256i dxB = _mm256_xor_si256(_mm256_shuffle_epi32(dB, 78), dB);
+		const __m256i tcc = _mm256_xor_si256(_mm256_clmulepi64_epi128(h2A, dxA, 0x00), _mm256_clmulepi64_epi128(h2B, dxB, 0x00));
+		__m128i a = _mm_xor_si128(_mm256_castsi256_si128(t00), _mm256_extracti128_si256(t00, 1));
+		__m128i b = _mm_xor_si128(_mm256_castsi256_si128(t11), _mm256_extracti128_si256(t11, 1));
+		__m128i c = _mm_xor_si128(_mm_xor_si128(_mm256_castsi256_si128(tcc), _mm256_extracti128_si256(tcc, 1)), _mm_xor_si128(a, b));
+		// Same shift-based reduction as the 128-bit path below
+		a = _mm_xor_si128(_mm_slli_si128(c, 8), a);
+		b = _mm_xor_si128(_mm_srli_si128(c, 8), b);
+		c = _mm_srli_epi32(a, 31);
+		a = _mm_or_si128(_mm_slli_epi32(a, 1), _mm_slli_si128(c, 4));
+		b = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(b, 1), _mm_slli_si128(_mm_srli_epi32(b, 31), 4)), _mm_srli_si128(c, 12));
+		c = _mm_xor_si128(_mm_slli_epi32(a, 31), _mm_xor_si128(_mm_slli_epi32(a, 30), _mm_slli_epi32(a, 25)));
+		a = _mm_xor_si128(a, _mm_slli_si128(c, 12));
+		b = _mm_xor_si128(b, _mm_xor_si128(a, _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(a, 1), _mm_srli_si128(c, 4)), _mm_xor_si128(_mm_srli_epi32(a, 2), _mm_srli_epi32(a, 7)))));
+		y = _mm_shuffle_epi8(b, sb);
+	} while (likely(len >= 64));
+
+	return y;
+}
+
 #endif // does compiler support AVX2 and AVX512 AES intrinsics?
 
 #ifdef __GNUC__
@@ -241,6 +289,14 @@ void AES::GMAC::p_aesNIUpdate(const uint8_t *in, unsigned int len) noexcept
 	}
 
 	if (likely(len >= 64)) {
+
+#ifdef ZT_AES_VPCLMUL
+		if ((Utils::CPUID.vpclmulqdq)&&(Utils::CPUID.avx2)) {
+			y = p_gmacInnerVPCLMUL(len, in, y, _aes.p_k.ni.h, _aes.p_k.ni.h2);
+			goto skip_conventional_ghash_64;
+		}
+#endif
+
 		const __m128i sb = s_sseSwapBytes;
 		const __m128i h = _aes.p_k.ni.h[0];
 		const __m128i hh = _aes.p_k.ni.h[1];
@@ -273,6 +329,9 @@ void AES::GMAC::p_aesNIUpdate(const uint8_t *in, unsigned int len) noexcept
 		} while (likely(in != end64));
 	}
 
+#ifdef ZT_AES_VPCLMUL
+skip_conventional_ghash_64:
+#endif
 	while (len >= 16) {
 		y = p_gmacPCLMUL128(_aes.p_k.ni.h[0], _mm_xor_si128(y, _mm_loadu_si128(reinterpret_cast<const __m128i *>(in))));
 		in += 16;
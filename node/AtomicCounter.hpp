@@ -30,30 +30,35 @@ class AtomicCounter
 public:
 	AtomicCounter() { _v = 0; }
 
+	// Reference count orderings: an increment only needs atomicity, since the
+	// thread taking a reference already has one (or holds a lock protecting the
+	// object). The decrement must release prior writes to the object and
+	// acquire them in whichever thread observes zero and deletes it.
+
 	inline int load() const
 	{
 #ifdef __GNUC__
-		return __sync_or_and_fetch(const_cast<int *>(&_v),0);
+		return __atomic_load_n(&_v,__ATOMIC_RELAXED);
 #else
-		return _v.load();
+		return _v.load(std::memory_order_relaxed);
 #endif
 	}
 
 	inline int operator++()
 	{
 #ifdef __GNUC__
-		return __sync_add_and_fetch(&_v,1);
+		return __atomic_add_fetch(&_v,1,__ATOMIC_RELAXED);
 #else
-		return ++_v;
+		return _v.fetch_add(1,std::memory_order_relaxed) + 1;
 #endif
 	}
 
 	inline int operator--()
 	{
 #ifdef __GNUC__
-		return __sync_sub_and_fetch(&_v,1);
+		return __atomic_sub_fetch(&_v,1,__ATOMIC_ACQ_REL);
 #else
-		return --_v;
+		return _v.fetch_sub(1,std::memory_order_acq_rel) - 1;
 #endif
 	}
 
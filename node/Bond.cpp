@@ -381,15 +381,14 @@ SharedPtr<Path> Bond::getAppropriatePath(int64_t now, int32_t flowId)
 			return _paths[m_idx].p;
 		}
 		Mutex::Lock _l(_flows_m);
-		std::map<int16_t, SharedPtr<Flow> >::iterator it = _flows.find(flowId);
-		if (likely(it != _flows.end())) {
-			it->second->lastActivity = now;
-			return _paths[it->second->assignedPath].p;
+		SharedPtr<Flow>* f = _flows.get(flowId);
+		if (likely(f != (SharedPtr<Flow>*)0)) {
+			(*f)->lastActivity = now;
+			return _paths[(*f)->assignedPath].p;
 		} else {
 			unsigned char entropy;
 			Utils::getSecureRandom(&entropy, 1);
 			SharedPtr<Flow> flow = createFlow(ZT_MAX_PEER_NETWORK_PATHS, flowId, entropy, now);
-			_flows[flowId] = flow;
 			return _paths[flow->assignedPath].p;
 		}
 	}
@@ -432,8 +431,9 @@ void Bond::recordOutgoingPacket(const SharedPtr<Path>& path, uint64_t packetId,
 	}
 	if (flowId != ZT_QOS_NO_FLOW) {
 		Mutex::Lock _l(_flows_m);
-		if (_flows.count(flowId)) {
-			_flows[flowId]->bytesOut += payloadLength;
+		SharedPtr<Flow>* f = _flows.get(flowId);
+		if (f) {
+			(*f)->bytesOut += payloadLength;
 		}
 	}
 }
@@ -488,10 +488,11 @@ void Bond::recordIncomingPacket(const SharedPtr<Path>& path, uint64_t packetId,
 	if ((flowId != ZT_QOS_NO_FLOW) && (_policy == ZT_BOND_POLICY_BALANCE_RR || _policy == ZT_BOND_POLICY_BALANCE_XOR || _policy == ZT_BOND_POLICY_BALANCE_AWARE)) {
 		Mutex::Lock _l(_flows_m);
 		SharedPtr<Flow> flow;
-		if (! _flows.count(flowId)) {
+		SharedPtr<Flow>* f = _flows.get(flowId);
+		if (! f) {
 			flow = createFlow(pathIdx, flowId, 0, now);
 		} else {
-			flow = _flows[flowId];
+			flow = *f;
 		}
 		if (flow) {
 			flow->bytesIn += payloadLength;
@@ -523,6 +524,16 @@ void Bond::receivedQoS(const SharedPtr<Path>& path, int64_t now, int count, uint
 	_paths[pathIdx].qosRecordSize.push(count);
 }
 
+void Bond::recordLatencySample(const SharedPtr<Path>& path, unsigned int latency)
+{
+	Mutex::Lock _l(_paths_m);
+	int pathIdx = getNominatedPathIdx(path);
+	if (pathIdx == ZT_MAX_PEER_NETWORK_PATHS) {
+		return;
+	}
+	_paths[pathIdx].latencySamples.push((uint16_t)latency);
+}
+
 void Bond::receivedAck(int pathIdx, int64_t now, int32_t ackedBytes)
 {
 	/*
@@ -664,32 +675,34 @@ SharedPtr<Bond::Flow> Bond::createFlow(int pathIdx, int32_t flowId, unsigned cha
 
 void Bond::forgetFlowsWhenNecessary(uint64_t age, bool oldest, int64_t now)
 {
-	std::map<int16_t, SharedPtr<Flow> >::iterator it = _flows.begin();
-	std::map<int16_t, SharedPtr<Flow> >::iterator oldestFlow = _flows.end();
-	SharedPtr<Flow> expiredFlow;
+	int32_t* flowId = (int32_t*)0;
+	SharedPtr<Flow>* flow = (SharedPtr<Flow>*)0;
 	if (age) {	 // Remove by specific age
-		while (it != _flows.end()) {
-			if (it->second->age(now) > age) {
-				debug("forget flow %04x (age %" PRId64 ") (%u / %zu)", it->first, it->second->age(now), _paths[it->second->assignedPath].assignedFlowCount, (_flows.size() - 1));
-				_paths[it->second->assignedPath].assignedFlowCount--;
-				it = _flows.erase(it);
-			} else {
-				++it;
+		Hashtable<int32_t, SharedPtr<Flow> >::Iterator i(_flows);
+		while (i.next(flowId, flow)) {
+			if ((*flow)->age(now) > (int64_t)age) {
+				debug("forget flow %04x (age %" PRId64 ") (%u / %zu)", *flowId, (*flow)->age(now), _paths[(*flow)->assignedPath].assignedFlowCount, (_flows.size() - 1));
+				_paths[(*flow)->assignedPath].assignedFlowCount--;
+				_flows.erase(*flowId);
 			}
 		}
 	} else if (oldest) {	 // Remove single oldest by natural expiration
-		uint64_t maxAge = 0;
-		while (it != _flows.end()) {
-			if (it->second->age(now) > maxAge) {
-				maxAge = (now - it->second->age(now));
-				oldestFlow = it;
+		int64_t maxAge = -1;
+		int32_t oldestFlowId = 0;
+		Hashtable<int32_t, SharedPtr<Flow> >::Iterator i(_flows);
+		while (i.next(flowId, flow)) {
+			if ((*flow)->age(now) > maxAge) {
+				maxAge = (*flow)->age(now);
+				oldestFlowId = *flowId;
 			}
-			++it;
 		}
-		if (oldestFlow != _flows.end()) {
-			debug("forget oldest flow %04x (age %" PRId64 ") (total flows: %zu)", oldestFlow->first, oldestFlow->second->age(now), _flows.size() - 1);
-			_paths[oldestFlow->second->assignedPath].assignedFlowCount--;
-			_flows.erase(oldestFlow);
+		if (maxAge >= 0) {
+			SharedPtr<Flow>* oldestFlow = _flows.get(oldestFlowId);
+			if (oldestFlow) {
+				debug("forget oldest flow %04x (age %" PRId64 ") (total flows: %zu)", oldestFlowId, (*oldestFlow)->age(now), _flows.size() - 1);
+				_paths[(*oldestFlow)->assignedPath].assignedFlowCount--;
+				_flows.erase(oldestFlowId);
+			}
 		}
 	}
 }
@@ -854,7 +867,7 @@ void Bond::processBackgroundBondTasks(void* tPtr, int64_t now)
 	if (! _run) {
 		return;
 	}
-	if (! _peer->_localMultipathSupported || (now - _lastBackgroundTaskCheck) < ZT_BOND_BACKGROUND_TASK_MIN_INTERVAL) {
+	if (! _peer->_cold->_localMultipathSupported || (now - _lastBackgroundTaskCheck) < ZT_BOND_BACKGROUND_TASK_MIN_INTERVAL) {
 		return;
 	}
 	_lastBackgroundTaskCheck = now;
@@ -1285,10 +1298,10 @@ void Bond::estimatePathQuality(int64_t now)
 		}
 		// Compute/Smooth average of real-world observations
 		if (_paths[i].latencySamples.count() == ZT_QOS_SHORTTERM_SAMPLE_WIN_SIZE) {
-			_paths[i].latency = _paths[i].latencySamples.mean();
+			_paths[i].latency = _paths[i].latencySamples.runningMean();
 		}
 		if (_paths[i].latencySamples.count() == ZT_QOS_SHORTTERM_SAMPLE_WIN_SIZE) {
-			_paths[i].latencyVariance = _paths[i].latencySamples.stddev();
+			_paths[i].latencyVariance = _paths[i].latencySamples.runningStddev();
 		}
 
 		// Write values to external path object so that it can be propagated to the user
@@ -1347,10 +1360,11 @@ void Bond::processBalanceTasks(int64_t now)
 	if ((now - _lastFlowExpirationCheck) > ZT_PEER_PATH_EXPIRATION) {
 		Mutex::Lock _l(_flows_m);
 		forgetFlowsWhenNecessary(ZT_PEER_PATH_EXPIRATION, false, now);
-		std::map<int16_t, SharedPtr<Flow> >::iterator it = _flows.begin();
-		while (it != _flows.end()) {
-			it->second->resetByteCounts();
-			++it;
+		Hashtable<int32_t, SharedPtr<Flow> >::Iterator i(_flows);
+		int32_t* flowId = (int32_t*)0;
+		SharedPtr<Flow>* flow = (SharedPtr<Flow>*)0;
+		while (i.next(flowId, flow)) {
+			(*flow)->resetByteCounts();
 		}
 		_lastFlowExpirationCheck = now;
 	}
@@ -1359,37 +1373,44 @@ void Bond::processBalanceTasks(int64_t now)
 	 */
 	if (_policy == ZT_BOND_POLICY_BALANCE_XOR || _policy == ZT_BOND_POLICY_BALANCE_AWARE) {
 		Mutex::Lock _l(_flows_m);
-		std::map<int16_t, SharedPtr<Flow> >::iterator flow_it = _flows.begin();
-		while (flow_it != _flows.end()) {
-			if (_paths[flow_it->second->assignedPath].p) {
-				int originalPathIdx = flow_it->second->assignedPath;
+		Hashtable<int32_t, SharedPtr<Flow> >::Iterator i(_flows);
+		int32_t* flowId = (int32_t*)0;
+		SharedPtr<Flow>* flow = (SharedPtr<Flow>*)0;
+		while (i.next(flowId, flow)) {
+			if (_paths[(*flow)->assignedPath].p) {
+				int originalPathIdx = (*flow)->assignedPath;
 				if (! _paths[originalPathIdx].eligible) {
 					log("moving all flows from dead link %s", pathToStr(_paths[originalPathIdx].p).c_str());
-					if (assignFlowToBondedPath(flow_it->second, now, true)) {
+					if (assignFlowToBondedPath(*flow, now, true)) {
 						_paths[originalPathIdx].assignedFlowCount--;
 					}
 				}
 			}
-			++flow_it;
 		}
 	}
 	/**
-	 * Move (some) flows from low quality paths
+	 * Move (some) flows from low quality paths. Moves are budgeted per tick so
+	 * a large flow table drains a bad path incrementally instead of either
+	 * stalling (one flow per tick) or reassigning everything in one burst.
 	 */
 	if (_policy == ZT_BOND_POLICY_BALANCE_AWARE) {
 		Mutex::Lock _l(_flows_m);
-		std::map<int16_t, SharedPtr<Flow> >::iterator flow_it = _flows.begin();
-		while (flow_it != _flows.end()) {
-			if (_paths[flow_it->second->assignedPath].p) {
-				int originalPathIdx = flow_it->second->assignedPath;
+		unsigned int moved = 0;
+		Hashtable<int32_t, SharedPtr<Flow> >::Iterator i(_flows);
+		int32_t* flowId = (int32_t*)0;
+		SharedPtr<Flow>* flow = (SharedPtr<Flow>*)0;
+		while (i.next(flowId, flow)) {
+			if (_paths[(*flow)->assignedPath].p) {
+				int originalPathIdx = (*flow)->assignedPath;
 				if (_paths[originalPathIdx].shouldAvoid) {
-					if (assignFlowToBondedPath(flow_it->second, now, true)) {
+					if (assignFlowToBondedPath(*flow, now, true)) {
 						_paths[originalPathIdx].assignedFlowCount--;
-						return;	  // Only move one flow at a time
+						if (++moved >= ZT_FLOW_REBALANCE_PER_TICK) {
+							return;
+						}
 					}
 				}
 			}
-			++flow_it;
 		}
 	}
 }
@@ -16,6 +16,7 @@
 
 #include "../osdep/Binder.hpp"
 #include "../osdep/Phy.hpp"
+#include "Hashtable.hpp"
 #include "Packet.hpp"
 #include "Path.hpp"
 #include "RuntimeEnvironment.hpp"
@@ -673,6 +674,19 @@ class Bond {
 	 */
 	void receivedQoS(const SharedPtr<Path>& path, int64_t now, int count, uint64_t* rx_id, uint16_t* rx_ts);
 
+	/**
+	 * Record a latency measurement derived from ordinary two-way traffic
+	 *
+	 * This feeds the RTT observed on regular request/reply exchanges (e.g.
+	 * HELLO and its OK) into the same per-path estimator the QoS machinery
+	 * fills, so paths carrying normal traffic keep their latency estimates
+	 * fresh without any additional measurement packets.
+	 *
+	 * @param path Path on which the reply arrived
+	 * @param latency One-way latency estimate (RTT / 2) in milliseconds
+	 */
+	void recordLatencySample(const SharedPtr<Path>& path, unsigned int latency);
+
 	/**
 	 * Process the contents of an inbound VERB_ACK to gather path quality observations.
 	 *
@@ -1273,7 +1287,21 @@ class Bond {
 		inline bool needsToSendQoS(int64_t now, uint64_t qosSendInterval)
 		{
 			// fprintf(stderr, "QOS table (%d / %d)\n", packetsReceivedSinceLastQoS, ZT_QOS_TABLE_SIZE);
-			return ((packetsReceivedSinceLastQoS >= ZT_QOS_TABLE_SIZE) || ((now - lastQoSMeasurement) > qosSendInterval)) && packetsReceivedSinceLastQoS;
+			// A busy link fills the record table many times per interval, and
+			// sending on every fill makes measurement overhead proportional to
+			// the data rate. Pacing the full-table sends keeps that overhead
+			// roughly constant: heavy traffic is sampled rather than
+			// exhaustively reported, which is plenty for quality estimation.
+			// Records that arrive while the table is full are simply not
+			// recorded. Lightly loaded and idle links behave as before,
+			// reporting whatever accumulated once per interval.
+			if (packetsReceivedSinceLastQoS <= 0) {
+				return false;
+			}
+			if ((packetsReceivedSinceLastQoS >= ZT_QOS_TABLE_SIZE) && ((now - (int64_t)lastQoSMeasurement) > (int64_t)(qosSendInterval / ZT_QOS_BUSY_SEND_INTERVAL_DIVISOR))) {
+				return true;
+			}
+			return ((now - (int64_t)lastQoSMeasurement) > (int64_t)qosSendInterval);
 		}
 
 		/**
@@ -1377,7 +1405,7 @@ class Bond {
 		 * @param flowId Given flow ID
 		 * @param now Current time
 		 */
-		Flow(int32_t flowId, int64_t now) : id(flowId), bytesIn(0), bytesOut(0), lastActivity(now), lastPathReassignment(0), assignedPath(ZT_MAX_PEER_NETWORK_PATHS)
+		Flow(int32_t flowId, int64_t now) : assignedPath(ZT_MAX_PEER_NETWORK_PATHS), lastActivity(now), bytesIn(0), bytesOut(0), lastPathReassignment(0), id(flowId)
 		{
 		}
 
@@ -1412,12 +1440,13 @@ class Bond {
 
 		AtomicCounter __refCount;
 
-		int32_t id;						// Flow ID used for hashing and path selection
+		// Hot per-packet fields first; the whole struct fits in one cache line
+		int assignedPath;				// Index of path to which this flow is assigned
+		int64_t lastActivity;			// The last time that this flow handled traffic
 		uint64_t bytesIn;				// Used for tracking flow size
 		uint64_t bytesOut;				// Used for tracking flow size
-		int64_t lastActivity;			// The last time that this flow handled traffic
 		int64_t lastPathReassignment;	// Time of last path assignment. Used for anti-flapping
-		int assignedPath;				// Index of path to which this flow is assigned
+		int32_t id;						// Flow ID used for hashing and path selection
 	};
 
 	const RuntimeEnvironment* RR;
@@ -1434,7 +1463,7 @@ class Bond {
 	 */
 	int _realIdxMap[ZT_MAX_PEER_NETWORK_PATHS] = { ZT_MAX_PEER_NETWORK_PATHS };
 	int _numBondedPaths;						  // Number of paths currently included in the _realIdxMap set.
-	std::map<int16_t, SharedPtr<Flow> > _flows;	  // Flows hashed according to port and protocol
+	Hashtable<int32_t, SharedPtr<Flow> > _flows;   // Flows looked up by flow ID (hashed from port and protocol)
 	float _qw[ZT_QOS_PARAMETER_SIZE];			  // Link quality specification (can be customized by user)
 
 	bool _run;
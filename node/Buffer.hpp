@@ -87,6 +87,13 @@ public:
 		_l = l;
 	}
 
+	Buffer(const Buffer &b)
+	{
+		// Copy only the live bytes: for large buffers (e.g. max-size Packets)
+		// the capacity is an order of magnitude bigger than typical contents
+		memcpy(_b,b._b,_l = b._l);
+	}
+
 	template<unsigned int C2>
 	Buffer(const Buffer<C2> &b)
 	{
@@ -98,17 +105,21 @@ public:
 		copyFrom(b,l);
 	}
 
+	inline Buffer &operator=(const Buffer &b)
+	{
+		if (&b != this) {
+			memcpy(_b,b._b,_l = b._l);
+		}
+		return *this;
+	}
+
 	template<unsigned int C2>
 	inline Buffer &operator=(const Buffer<C2> &b)
 	{
 		if (unlikely(b._l > C)) {
 			throw ZT_EXCEPTION_OUT_OF_BOUNDS;
 		}
-		if (C2 == C) {
-			memcpy(this,&b,sizeof(Buffer<C>));
-		} else {
-			memcpy(_b,b._b,_l = b._l);
-		}
+		memcpy(_b,b._b,_l = b._l);
 		return *this;
 	}
 
@@ -2611,6 +2611,140 @@ bool C25519::verify(const C25519::Public &their,const void *msg,unsigned int len
 	return Utils::secureEq(sig,t2,32);
 }
 
+// Maximum signatures checked per linear combination; the per-signature
+// precomputation tables are sizable so larger batches are done in chunks.
+#define ZT_C25519_BATCH_VERIFY_CHUNK 8
+
+// Check sum( z[i] * (s[i]*B - R[i] - hram[i]*A[i]) ) == 0 for random 128-bit
+// z[i], which with overwhelming probability holds only if every signature
+// satisfies its own equation. One doubling chain is shared across the whole
+// batch so each additional signature costs only its table setup and adds.
+static bool _verifyBatchChunk(const C25519::Public *const *their,const void *const *msgs,const unsigned int *lens,const void *const *signatures,const unsigned int count)
+{
+	ge25519 negA[ZT_C25519_BATCH_VERIFY_CHUNK],negR[ZT_C25519_BATCH_VERIFY_CHUNK];
+	sc25519 z[ZT_C25519_BATCH_VERIFY_CHUNK],zh[ZT_C25519_BATCH_VERIFY_CHUNK],zsSum;
+	unsigned char b[ZT_C25519_BATCH_VERIFY_CHUNK][127];
+	ge25519_p1p1 tp1p1;
+
+	for(unsigned int i=0;i<count;++i) {
+		const unsigned char *const sig = (const unsigned char *)signatures[i];
+		unsigned char digest[64]; // we sign the first 32 bytes of SHA-512(msg)
+		SHA512(digest,msgs[i],lens[i]);
+		if (!Utils::secureEq(sig + 64,digest,32)) {
+			return false;
+		}
+
+		if (ge25519_unpackneg_vartime(&negA[i],their[i]->data + 32)) {
+			return false;
+		}
+		if (ge25519_unpackneg_vartime(&negR[i],sig)) {
+			return false;
+		}
+
+		unsigned char hram[crypto_hash_sha512_BYTES];
+		unsigned char m[96];
+		get_hram(hram,sig,their[i]->data + 32,m,96);
+
+		unsigned char zb[32];
+		memset(zb,0,sizeof(zb));
+		Utils::getSecureRandom(zb,16);
+		zb[0] |= 1; // zero would void the check for this signature
+		sc25519_from32bytes(&z[i],zb);
+
+		sc25519 schram,scs,zs;
+		sc25519_from64bytes(&schram,hram);
+		sc25519_from32bytes(&scs,sig + 32);
+		sc25519_mul(&zh[i],&z[i],&schram);
+		sc25519_mul(&zs,&z[i],&scs);
+		if (i) {
+			sc25519_add(&zsSum,&zsSum,&zs);
+		} else {
+			zsSum = zs;
+		}
+	}
+
+	// Same precomputation as ge25519_double_scalarmult_vartime, one table
+	// over (-A[i],-R[i]) per signature
+	ge25519 *const pre = new ge25519[count * 16];
+	for(unsigned int i=0;i<count;++i) {
+		ge25519 *const pi = pre + (i * 16);
+		char *pre5 = (char *)(&(pi[5])); // eliminate type punning warning
+		setneutral(pi);                                                        /* 00 00 */
+		pi[1] = negA[i];                                                       /* 00 01 */
+		dbl_p1p1(&tp1p1,(ge25519_p2 *)&negA[i]); p1p1_to_p3( &pi[2], &tp1p1);  /* 00 10 */
+		add_p1p1(&tp1p1,&pi[1], &pi[2]);         p1p1_to_p3( &pi[3], &tp1p1);  /* 00 11 */
+		pi[4] = negR[i];                                                       /* 01 00 */
+		add_p1p1(&tp1p1,&pi[1], &pi[4]);         p1p1_to_p3( &pi[5], &tp1p1);  /* 01 01 */
+		add_p1p1(&tp1p1,&pi[2], &pi[4]);         p1p1_to_p3( &pi[6], &tp1p1);  /* 01 10 */
+		add_p1p1(&tp1p1,&pi[3], &pi[4]);         p1p1_to_p3( &pi[7], &tp1p1);  /* 01 11 */
+		dbl_p1p1(&tp1p1,(ge25519_p2 *)&negR[i]); p1p1_to_p3( &pi[8], &tp1p1);  /* 10 00 */
+		add_p1p1(&tp1p1,&pi[1], &pi[8]);         p1p1_to_p3( &pi[9], &tp1p1);  /* 10 01 */
+		dbl_p1p1(&tp1p1,(ge25519_p2 *)pre5);     p1p1_to_p3(&pi[10], &tp1p1);  /* 10 10 */
+		add_p1p1(&tp1p1,&pi[3], &pi[8]);         p1p1_to_p3(&pi[11], &tp1p1);  /* 10 11 */
+		add_p1p1(&tp1p1,&pi[4], &pi[8]);         p1p1_to_p3(&pi[12], &tp1p1);  /* 11 00 */
+		add_p1p1(&tp1p1,&pi[1],&pi[12]);         p1p1_to_p3(&pi[13], &tp1p1);  /* 11 01 */
+		add_p1p1(&tp1p1,&pi[2],&pi[12]);         p1p1_to_p3(&pi[14], &tp1p1);  /* 11 10 */
+		add_p1p1(&tp1p1,&pi[3],&pi[12]);         p1p1_to_p3(&pi[15], &tp1p1);  /* 11 11 */
+		sc25519_2interleave2(b[i],&zh[i],&z[i]);
+	}
+
+	// Shared doubling chain over all signatures
+	ge25519 racc;
+	setneutral(&racc);
+	for(int i=126;i>=0;--i) {
+		dbl_p1p1(&tp1p1,(ge25519_p2 *)&racc);
+		p1p1_to_p2((ge25519_p2 *)&racc,&tp1p1);
+		dbl_p1p1(&tp1p1,(ge25519_p2 *)&racc);
+		p1p1_to_p3(&racc,&tp1p1);
+		for(unsigned int j=0;j<count;++j) {
+			const unsigned char bj = b[j][i];
+			if (bj) {
+				add_p1p1(&tp1p1,&racc,&pre[(j * 16) + bj]);
+				p1p1_to_p3(&racc,&tp1p1);
+			}
+		}
+	}
+	delete [] pre;
+
+	// Add sum( z[i]*s[i] ) * B; everything must cancel to the neutral element
+	ge25519 sB;
+	ge25519_scalarmult_base(&sB,&zsSum);
+	add_p1p1(&tp1p1,&racc,&sB);
+	p1p1_to_p3(&racc,&tp1p1);
+
+	unsigned char packed[32];
+	ge25519_pack(packed,&racc);
+	if (packed[0] != 0x01) {
+		return false;
+	}
+	for(unsigned int i=1;i<32;++i) {
+		if (packed[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool C25519::verifyBatch(const C25519::Public *const *their,const void *const *msgs,const unsigned int *lens,const void *const *signatures,unsigned int count)
+{
+	unsigned int i = 0;
+	while (i < count) {
+		unsigned int n = count - i;
+		if (n > ZT_C25519_BATCH_VERIFY_CHUNK) {
+			n = ZT_C25519_BATCH_VERIFY_CHUNK;
+		}
+		if (n == 1) {
+			if (!verify(*their[i],msgs[i],lens[i],signatures[i])) {
+				return false;
+			}
+		} else if (!_verifyBatchChunk(their + i,msgs + i,lens + i,signatures + i,n)) {
+			return false;
+		}
+		i += n;
+	}
+	return true;
+}
+
 void C25519::_calcPubDH(C25519::Pair &kp)
 {
 	// First 32 bytes of pub and priv are the keys for ECDH key
@@ -156,6 +156,25 @@ public:
 		return verify(their,msg,len,signature.data);
 	}
 
+	/**
+	 * Verify a batch of signatures together
+	 *
+	 * This checks a random linear combination of all the signatures in the
+	 * batch, sharing one doubling chain across them, which is considerably
+	 * cheaper than calling verify() once per signature. True means every
+	 * signature in the batch is valid. False means at least one is invalid
+	 * but does not say which; callers that need to know can fall back to
+	 * verifying individually.
+	 *
+	 * @param their Public keys, one per signature
+	 * @param msgs Signed messages, one per signature
+	 * @param lens Message lengths in bytes
+	 * @param signatures 96-byte signatures
+	 * @param count Number of signatures in the batch
+	 * @return True if every signature is valid
+	 */
+	static bool verifyBatch(const Public *const *their,const void *const *msgs,const unsigned int *lens,const void *const *signatures,unsigned int count);
+
 private:
 	// derive first 32 bytes of kp.pub from first 32 bytes of kp.priv
 	// this is the ECDH key
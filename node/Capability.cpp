@@ -29,9 +29,18 @@ int Capability::verify(const RuntimeEnvironment *RR,void *tPtr) const
 			return -1;
 		}
 
-		// Validate all entries in chain of custody
+		// Validate the structure of the chain of custody and resolve all signer
+		// identities, then check the collected signatures at the end so a
+		// multi-link chain can be batch verified.
 		Buffer<(sizeof(Capability) * 2)> tmp;
 		this->serialize(tmp,true);
+
+		Identity ids[ZT_MAX_CAPABILITY_CUSTODY_CHAIN_LENGTH];
+		const C25519::Public *pubs[ZT_MAX_CAPABILITY_CUSTODY_CHAIN_LENGTH];
+		const void *msgs[ZT_MAX_CAPABILITY_CUSTODY_CHAIN_LENGTH];
+		unsigned int lens[ZT_MAX_CAPABILITY_CUSTODY_CHAIN_LENGTH];
+		const void *sigs[ZT_MAX_CAPABILITY_CUSTODY_CHAIN_LENGTH];
+		unsigned int nsigs = 0;
 		for(unsigned int c=0;c<_maxCustodyChainLength;++c) {
 			if (c == 0) {
 				if ((!_custody[c].to)||(!_custody[c].from)||(_custody[c].from != Network::controllerFor(_nwid))) {
@@ -39,24 +48,33 @@ int Capability::verify(const RuntimeEnvironment *RR,void *tPtr) const
 				}
 			} else {
 				if (!_custody[c].to) {
-					return 0; // all previous entries were valid, so we are valid
+					break; // no more entries in the chain
 				} else if ((!_custody[c].from)||(_custody[c].from != _custody[c-1].to)) {
 					return -1; // otherwise if we have another entry it must be from the previous holder in the chain
 				}
 			}
 
-			const Identity id(RR->topology->getIdentity(tPtr,_custody[c].from));
-			if (id) {
-				if (!id.verify(tmp.data(),tmp.size(),_custody[c].signature)) {
-					return -1;
-				}
-			} else {
+			ids[nsigs] = RR->topology->getIdentity(tPtr,_custody[c].from);
+			if (!ids[nsigs]) {
 				RR->sw->requestWhois(tPtr,RR->node->now(),_custody[c].from);
 				return 1;
 			}
+			pubs[nsigs] = &(ids[nsigs].publicKey());
+			msgs[nsigs] = tmp.data();
+			lens[nsigs] = tmp.size();
+			sigs[nsigs] = _custody[c].signature.data;
+			++nsigs;
+		}
+
+		if (nsigs == 1) {
+			if (!ids[0].verify(tmp.data(),tmp.size(),_custody[0].signature)) {
+				return -1;
+			}
+		} else if (!C25519::verifyBatch(pubs,msgs,lens,sigs,nsigs)) {
+			return -1;
 		}
 
-		// We reached max custody chain length and everything was valid
+		// Everything in the chain was valid
 		return 0;
 	} catch ( ... ) {}
 	return -1;
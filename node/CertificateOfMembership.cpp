@@ -52,9 +52,17 @@ bool CertificateOfMembership::agreesWith(const CertificateOfMembership &other, c
 		return false;
 	}
 
-	std::map< uint64_t, uint64_t > otherFields;
-	for(unsigned int i=0;i<other._qualifierCount;++i) {
-		otherFields[other._qualifiers[i].id] = other._qualifiers[i].value;
+	// Structure-of-arrays copy of the other cert's qualifiers. With at most
+	// ZT_NETWORK_COM_MAX_QUALIFIERS entries the two arrays fit in two cache
+	// lines and the id-match scans below compile to straight-line compares
+	// (vectorized where the target supports it) instead of the heap-backed
+	// map this used to build on every evaluation.
+	uint64_t otherIds[ZT_NETWORK_COM_MAX_QUALIFIERS];
+	uint64_t otherValues[ZT_NETWORK_COM_MAX_QUALIFIERS];
+	const unsigned int otherCount = other._qualifierCount;
+	for(unsigned int i=0;i<otherCount;++i) {
+		otherIds[i] = other._qualifiers[i].id;
+		otherValues[i] = other._qualifiers[i].value;
 	}
 
 	bool fullIdentityVerification = false;
@@ -63,12 +71,15 @@ bool CertificateOfMembership::agreesWith(const CertificateOfMembership &other, c
 		if ((qid >= 3)&&(qid <= 6)) {
 			fullIdentityVerification = true;
 		}
-		std::map< uint64_t, uint64_t >::iterator otherQ(otherFields.find(qid));
-		if (otherQ == otherFields.end()) {
+		unsigned int j = 0;
+		while ((j < otherCount)&&(otherIds[j] != qid)) {
+			++j;
+		}
+		if (j == otherCount) {
 			return false;
 		}
 		const uint64_t a = _qualifiers[i].value;
-		const uint64_t b = otherQ->second;
+		const uint64_t b = otherValues[j];
 		if (((a >= b) ? (a - b) : (b - a)) > _qualifiers[i].maxDelta) {
 			return false;
 		}
@@ -80,11 +91,14 @@ bool CertificateOfMembership::agreesWith(const CertificateOfMembership &other, c
 		uint64_t idHash[6];
 		otherIdentity.publicKeyHash(idHash);
 		for(unsigned long i=0;i<4;++i) {
-			std::map< uint64_t, uint64_t >::iterator otherQ(otherFields.find((uint64_t)(i + 3)));
-			if (otherQ == otherFields.end()) {
+			unsigned int j = 0;
+			while ((j < otherCount)&&(otherIds[j] != (uint64_t)(i + 3))) {
+				++j;
+			}
+			if (j == otherCount) {
 				return false;
 			}
-			if (otherQ->second != Utils::ntoh(idHash[i])) {
+			if (otherValues[j] != Utils::ntoh(idHash[i])) {
 				return false;
 			}
 		}
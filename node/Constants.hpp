@@ -222,6 +222,71 @@
  */
 #define ZT_ADDRESS_RESERVED_PREFIX 0xff
 
+/**
+ * Deployment profiles (1.10.7+)
+ *
+ * The same source ships to very different roles: relays and roots that
+ * forward traffic for thousands of peers, and embedded members that join
+ * one network and talk to a handful. Defining ZT_DEPLOYMENT_PROFILE_RELAY
+ * or ZT_DEPLOYMENT_PROFILE_EMBEDDED at build time (make ZT_PROFILE=relay
+ * or ZT_PROFILE=embedded) re-sizes the queue and table capacities below
+ * for that role. The default, with no profile defined, keeps the
+ * historical middle-of-the-road values. Every constant a profile touches
+ * is #ifndef-guarded, so any of them can still be overridden individually
+ * on the compiler command line.
+ */
+#if defined(ZT_DEPLOYMENT_PROFILE_RELAY) && defined(ZT_DEPLOYMENT_PROFILE_EMBEDDED)
+#error Only one of ZT_DEPLOYMENT_PROFILE_RELAY and ZT_DEPLOYMENT_PROFILE_EMBEDDED may be defined
+#endif
+
+#ifdef ZT_DEPLOYMENT_PROFILE_RELAY
+#ifndef ZT_RX_QUEUE_SIZE
+#define ZT_RX_QUEUE_SIZE 128
+#endif
+#ifndef ZT_TX_QUEUE_SIZE
+#define ZT_TX_QUEUE_SIZE 64
+#endif
+#ifndef ZT_RX_WORKER_MAX_QUEUE_SIZE
+#define ZT_RX_WORKER_MAX_QUEUE_SIZE 4096
+#endif
+#ifndef ZT_NETWORK_FLOW_CACHE_SIZE
+#define ZT_NETWORK_FLOW_CACHE_SIZE 4096
+#endif
+#ifndef ZT_TOPOLOGY_PEER_SHARD_INITIAL_CAPACITY
+#define ZT_TOPOLOGY_PEER_SHARD_INITIAL_CAPACITY 512
+#endif
+#ifndef ZT_MULTICASTER_GROUPS_INITIAL_CAPACITY
+#define ZT_MULTICASTER_GROUPS_INITIAL_CAPACITY 128
+#endif
+#ifndef ZT_SELFAWARENESS_PHY_INITIAL_CAPACITY
+#define ZT_SELFAWARENESS_PHY_INITIAL_CAPACITY 1024
+#endif
+#endif // ZT_DEPLOYMENT_PROFILE_RELAY
+
+#ifdef ZT_DEPLOYMENT_PROFILE_EMBEDDED
+#ifndef ZT_RX_QUEUE_SIZE
+#define ZT_RX_QUEUE_SIZE 16
+#endif
+#ifndef ZT_TX_QUEUE_SIZE
+#define ZT_TX_QUEUE_SIZE 16
+#endif
+#ifndef ZT_RX_WORKER_MAX_QUEUE_SIZE
+#define ZT_RX_WORKER_MAX_QUEUE_SIZE 256
+#endif
+#ifndef ZT_NETWORK_FLOW_CACHE_SIZE
+#define ZT_NETWORK_FLOW_CACHE_SIZE 128
+#endif
+#ifndef ZT_TOPOLOGY_PEER_SHARD_INITIAL_CAPACITY
+#define ZT_TOPOLOGY_PEER_SHARD_INITIAL_CAPACITY 8
+#endif
+#ifndef ZT_MULTICASTER_GROUPS_INITIAL_CAPACITY
+#define ZT_MULTICASTER_GROUPS_INITIAL_CAPACITY 8
+#endif
+#ifndef ZT_SELFAWARENESS_PHY_INITIAL_CAPACITY
+#define ZT_SELFAWARENESS_PHY_INITIAL_CAPACITY 16
+#endif
+#endif // ZT_DEPLOYMENT_PROFILE_EMBEDDED
+
 /**
  * Default MTU used for Ethernet tap device
  */
@@ -235,12 +300,72 @@
 /**
  * Size of RX queue
  */
+#ifndef ZT_RX_QUEUE_SIZE
 #define ZT_RX_QUEUE_SIZE 32
+#endif
+
+/**
+ * Maximum wire bytes one peer may hold in the RX queue for fragment reassembly
+ * and decode-info waits, so a single lossy or hostile peer cannot monopolize it
+ */
+#define ZT_RX_MAX_REASSEMBLY_BYTES_PER_PEER 65536
+
+/**
+ * Maximum number of packets queued per RX worker thread before new ones are dropped
+ */
+#ifndef ZT_RX_WORKER_MAX_QUEUE_SIZE
+#define ZT_RX_WORKER_MAX_QUEUE_SIZE 1024
+#endif
+
+/**
+ * Sustained per-source ingress rate allowed by the front-line policer, in packets per second
+ *
+ * Sources are bucketed by InetAddress::rateGateHash(), so this is per /24
+ * (IPv4) or /48 (IPv6). It must sit far above any plausible legitimate rate
+ * since it is applied before decryption: its job is to keep junk floods from
+ * saturating the CPU on MAC failures, not to shape real traffic.
+ */
+#define ZT_INGRESS_POLICER_RATE 50000
+
+/**
+ * Maximum token balance (burst size) of an ingress policer bucket, in packets
+ */
+#define ZT_INGRESS_POLICER_BURST 100000
+
+/**
+ * Maximum number of entries in a network's outgoing flow verdict cache
+ */
+#ifndef ZT_NETWORK_FLOW_CACHE_SIZE
+#define ZT_NETWORK_FLOW_CACHE_SIZE 1024
+#endif
 
 /**
  * Size of TX queue
  */
+#ifndef ZT_TX_QUEUE_SIZE
 #define ZT_TX_QUEUE_SIZE 32
+#endif
+
+/**
+ * Initial capacity of each Topology peer table shard
+ */
+#ifndef ZT_TOPOLOGY_PEER_SHARD_INITIAL_CAPACITY
+#define ZT_TOPOLOGY_PEER_SHARD_INITIAL_CAPACITY 64
+#endif
+
+/**
+ * Initial capacity of the multicast group table
+ */
+#ifndef ZT_MULTICASTER_GROUPS_INITIAL_CAPACITY
+#define ZT_MULTICASTER_GROUPS_INITIAL_CAPACITY 32
+#endif
+
+/**
+ * Initial capacity of the SelfAwareness physical surface table
+ */
+#ifndef ZT_SELFAWARENESS_PHY_INITIAL_CAPACITY
+#define ZT_SELFAWARENESS_PHY_INITIAL_CAPACITY 128
+#endif
 
 /**
  * Minimum delay between timer task checks to prevent thrashing
@@ -257,6 +382,21 @@
  */
 #define ZT_WHOIS_RETRY_DELAY 500
 
+/**
+ * Maximum WHOIS retries before an address is negatively cached
+ */
+#define ZT_WHOIS_MAX_RETRIES 5
+
+/**
+ * How long an unanswered WHOIS address stays negatively cached, in ms
+ */
+#define ZT_WHOIS_NEGATIVE_CACHE_TTL 30000
+
+/**
+ * Maximum bytes parked in the TX queue awaiting WHOIS for any one destination
+ */
+#define ZT_TX_QUEUE_MAX_BYTES_PER_DEST 16384
+
 /**
  * Transmit queue entry timeout
  */
@@ -284,6 +424,16 @@
  */
 #define ZT_MULTICAST_ANNOUNCE_PERIOD 60000
 
+/**
+ * Maximum number of network members to send MULTICAST_LIKE announcements to per pass
+ *
+ * Announcement passes run on the periodic task cadence, so on large networks
+ * this spreads the member loop across several ticks instead of freezing the
+ * tick thread announcing to thousands of members at once. Members skipped by
+ * the budget remain due and are picked up by the next pass.
+ */
+#define ZT_MULTICAST_ANNOUNCE_MAX_PER_PASS 128
+
 /**
  * Delay between explicit MULTICAST_GATHER requests for a given multicast channel
  */
@@ -311,11 +461,36 @@
  */
 #define ZT_PATH_HEARTBEAT_PERIOD 14000
 
+/**
+ * Longest keepalive interval the per-path NAT binding lifetime probe will try
+ *
+ * See Path::updateKeepaliveInterval(). Stretching further saves little
+ * traffic and makes a wrong guess (a dead binding going unnoticed) costly.
+ */
+#define ZT_PATH_KEEPALIVE_MAX_PERIOD 120000
+
+/**
+ * Stop refining the probed keepalive interval when known-good and next
+ * candidate are within this many milliseconds of one another
+ */
+#define ZT_PATH_KEEPALIVE_PROBE_QUANTUM 2000
+
+/**
+ * Forget a learned NAT binding timeout after this long and re-probe past it,
+ * since devices move between networks and NAT behavior changes
+ */
+#define ZT_PATH_KEEPALIVE_RELEARN_PERIOD 1800000
+
 /**
  * Do not accept HELLOs over a given path more often than this
  */
 #define ZT_PATH_HELLO_RATE_LIMIT 1000
 
+/**
+ * How often to probe a direct path for a larger usable physical MTU
+ */
+#define ZT_PATH_MTU_PROBE_INTERVAL 60000
+
 /**
  * Delay between full-fledge pings of directly connected peers
  */
@@ -326,6 +501,11 @@
  */
 #define ZT_PEER_PATH_EXPIRATION ((ZT_PEER_PING_PERIOD * 4) + 3000)
 
+/**
+ * How long a cached best-path selection stays valid before full re-evaluation
+ */
+#define ZT_PEER_PATH_SELECTION_CACHE_PERIOD 1000
+
 /**
  * How often to retry expired paths that we're still remembering
  */
@@ -389,6 +569,13 @@
  */
 #define ZT_QOS_MAX_PENDING_RECORDS (ZT_QOS_TABLE_SIZE * 3)
 
+/**
+ * Minimum spacing between full-table QoS sends on a busy link, as a fraction
+ * of the QoS send interval. This caps measurement overhead on links carrying
+ * heavy data traffic; see Bond::needsToSendQoS().
+ */
+#define ZT_QOS_BUSY_SEND_INTERVAL_DIVISOR 8
+
 /**
  * Interval used for rate-limiting the computation of path quality estimates.
  */
@@ -486,6 +673,15 @@
  */
 #define ZT_MAX_BRIDGE_ROUTES 67108864
 
+/**
+ * Maximum number of bridge routes learned behind any single bridge
+ *
+ * Fairness quota: one misbehaving or spammed bridge exhausts only its own
+ * allotment and evicts only its own least recently seen MACs, instead of
+ * pushing other bridges' routes out of the table.
+ */
+#define ZT_MAX_BRIDGE_ROUTES_PER_BRIDGE 16384
+
 /**
  * If there is no known L2 bridging route, spam to up to this many active bridges
  */
@@ -551,6 +747,16 @@
  */
 #define ZT_PEER_CREDENTIALS_REQUEST_RATE_LIMIT 1000
 
+/**
+ * Length of a spontaneous credential push pacing window, in ms
+ */
+#define ZT_CREDENTIAL_PUSH_WINDOW 100
+
+/**
+ * Maximum spontaneous credential pushes per pacing window per network
+ */
+#define ZT_CREDENTIAL_PUSH_MAX_PER_WINDOW 16
+
 /**
  * WHOIS rate limit (we allow these to be pretty fast)
  */
@@ -572,6 +778,11 @@
  */
 #define ZT_FLOW_MAX_COUNT (1024 * 64)
 
+/**
+ * Maximum number of flows moved off an avoided path per background tick
+ */
+#define ZT_FLOW_REBALANCE_PER_TICK 8
+
 /**
  * How often we emit a bond summary for each bond
  */
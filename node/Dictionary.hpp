@@ -21,6 +21,14 @@
 
 #include <stdint.h>
 
+/**
+ * Maximum number of entries a Dictionary::Index can hold
+ *
+ * Lookups for keys past this fall back to a full buffer scan, so this is a
+ * performance bound and not a correctness bound.
+ */
+#define ZT_DICTIONARY_INDEX_MAX_ENTRIES 128
+
 namespace ZeroTier {
 
 /**
@@ -462,6 +470,388 @@ public:
 		return (this->get(key,tmp,2) >= 0);
 	}
 
+	/**
+	 * A read-only offset index over a Dictionary for repeated lookups
+	 *
+	 * Dictionary::get() scans the whole buffer per key, which makes parsers
+	 * that fetch dozens of fields (like NetworkConfig::fromDictionary())
+	 * quadratic in the config size. This builds a key/value offset table in
+	 * one scan so each subsequent lookup only compares against entry keys.
+	 *
+	 * The Dictionary must outlive the index and must not be modified while
+	 * the index is in use. If the Dictionary somehow contains more entries
+	 * than the index can hold, lookups that miss the index fall back to a
+	 * full scan, so results are always identical to Dictionary::get().
+	 */
+	class Index
+	{
+	public:
+		Index(const Dictionary &d) :
+			_dict(&d),
+			_n(0),
+			_overflowed(false)
+		{
+			const char *const base = d._d;
+			const char *p = base;
+			const char *const eof = base + C;
+			while ((p < eof)&&(*p)) {
+				const char *const k = p;
+				while ((p < eof)&&(*p)&&(*p != '=')&&(*p != 13)&&(*p != 10)) {
+					++p;
+				}
+				if ((p < eof)&&(*p == '=')) {
+					if (_n < ZT_DICTIONARY_INDEX_MAX_ENTRIES) {
+						_e[_n].ko = (uint32_t)(k - base);
+						_e[_n].kl = (uint32_t)(p - k);
+						_e[_n].vo = (uint32_t)((p - base) + 1);
+						++_n;
+					} else {
+						_overflowed = true;
+					}
+					++p;
+				}
+				while ((p < eof)&&(*p)&&(*p != 13)&&(*p != 10)) { // skip to end of line
+					++p;
+				}
+				while ((p < eof)&&((*p == 13)||(*p == 10))) {
+					++p;
+				}
+			}
+		}
+
+		/**
+		 * Get an entry (same semantics as Dictionary::get())
+		 *
+		 * @param key Key to look up
+		 * @param dest Destination buffer
+		 * @param destlen Size of destination buffer
+		 * @return -1 if not found, or actual number of bytes stored in dest[] minus trailing 0
+		 */
+		inline int get(const char *key,char *dest,unsigned int destlen) const
+		{
+			if (!destlen) { // sanity check
+				return -1;
+			}
+			unsigned int kl = 0;
+			while (key[kl]) {
+				++kl;
+			}
+			for(unsigned int i=0;i<_n;++i) {
+				if (_e[i].kl == kl) {
+					const char *k = _dict->_d + _e[i].ko;
+					unsigned int j = 0;
+					while ((j < kl)&&(k[j] == key[j])) {
+						++j;
+					}
+					if (j == kl) {
+						return _unescape(_dict->_d + _e[i].vo,_dict->_d + C,dest,destlen);
+					}
+				}
+			}
+			if (_overflowed) {
+				return _dict->get(key,dest,destlen); // never in practice; see above
+			}
+			dest[0] = (char)0;
+			return -1;
+		}
+
+		/**
+		 * Get the contents of a key into a buffer (same semantics as Dictionary::get())
+		 */
+		template<unsigned int BC>
+		inline bool get(const char *key,Buffer<BC> &dest) const
+		{
+			const int r = this->get(key,const_cast<char *>(reinterpret_cast<const char *>(dest.data())),BC);
+			if (r >= 0) {
+				dest.setSize((unsigned int)r);
+				return true;
+			} else {
+				dest.clear();
+				return false;
+			}
+		}
+
+		/**
+		 * Get a boolean value (same semantics as Dictionary::getB())
+		 */
+		inline bool getB(const char *key,bool dfl = false) const
+		{
+			char tmp[4];
+			if (this->get(key,tmp,sizeof(tmp)) >= 0) {
+				return ((*tmp == '1')||(*tmp == 't')||(*tmp == 'T'));
+			}
+			return dfl;
+		}
+
+		/**
+		 * Get an unsigned int64 stored as hex (same semantics as Dictionary::getUI())
+		 */
+		inline uint64_t getUI(const char *key,uint64_t dfl = 0) const
+		{
+			char tmp[128];
+			if (this->get(key,tmp,sizeof(tmp)) >= 1) {
+				return Utils::hexStrToU64(tmp);
+			}
+			return dfl;
+		}
+
+		/**
+		 * Get a signed int64 stored as hex (same semantics as Dictionary::getI())
+		 */
+		inline int64_t getI(const char *key,int64_t dfl = 0) const
+		{
+			char tmp[128];
+			if (this->get(key,tmp,sizeof(tmp)) >= 1) {
+				return Utils::hexStrTo64(tmp);
+			}
+			return dfl;
+		}
+
+		/**
+		 * @param key Key to check
+		 * @return True if key is present
+		 */
+		inline bool contains(const char *key) const
+		{
+			char tmp[2];
+			return (this->get(key,tmp,2) >= 0);
+		}
+
+	private:
+		// Unescape a value in place starting at p; identical to the value half of Dictionary::get()
+		static inline int _unescape(const char *p,const char *const eof,char *dest,unsigned int destlen)
+		{
+			if (p >= eof) { // sanity check, should not be possible
+				dest[0] = (char)0;
+				return -1;
+			}
+			int j = 0;
+			bool esc = false;
+			while ((*p != 0)&&(*p != 13)&&(*p != 10)) {
+				if (esc) {
+					esc = false;
+					switch(*p) {
+						case 'r':
+							dest[j++] = 13;
+							break;
+						case 'n':
+							dest[j++] = 10;
+							break;
+						case '0':
+							dest[j++] = (char)0;
+							break;
+						case 'e':
+							dest[j++] = '=';
+							break;
+						default:
+							dest[j++] = *p;
+							break;
+					}
+					if (j == (int)destlen) {
+						dest[j-1] = (char)0;
+						return j-1;
+					}
+				} else if (*p == '\\') {
+					esc = true;
+				} else {
+					dest[j++] = *p;
+					if (j == (int)destlen) {
+						dest[j-1] = (char)0;
+						return j-1;
+					}
+				}
+				if (++p == eof) {
+					dest[0] = (char)0;
+					return -1;
+				}
+			}
+			dest[j] = (char)0;
+			return j;
+		}
+
+		struct _IndexEntry
+		{
+			uint32_t ko; // offset of key
+			uint32_t kl; // length of key
+			uint32_t vo; // offset of value (first byte after '=')
+		};
+
+		const Dictionary *_dict;
+		unsigned int _n;
+		bool _overflowed;
+		_IndexEntry _e[ZT_DICTIONARY_INDEX_MAX_ENTRIES];
+	};
+
+	/**
+	 * An append-only builder that tracks the write cursor across add() calls
+	 *
+	 * Dictionary::add() rescans the buffer for the terminating null on every
+	 * call, which makes large assemblies like NetworkConfig::toDictionary()
+	 * quadratic in the config size. This remembers where the last append
+	 * ended so each add() costs only the entry it writes. The result is
+	 * byte-identical to the same sequence of Dictionary::add() calls; the
+	 * Dictionary must not be modified behind the builder's back while it is
+	 * in use. This is the write-side counterpart of Index above.
+	 */
+	class Appender
+	{
+	public:
+		Appender(Dictionary &d) :
+			_dict(&d),
+			_end(0)
+		{
+			while ((_end < C)&&(d._d[_end])) {
+				++_end;
+			}
+		}
+
+		/**
+		 * Append a new key=value pair (same semantics as Dictionary::add())
+		 *
+		 * @param key Key -- nulls, CR/LF, and equals (=) are illegal characters
+		 * @param value Value to set
+		 * @param vlen Length of value in bytes or -1 to treat value[] as a C-string and look for terminating 0
+		 * @return True if there was enough room to add this key=value pair
+		 */
+		inline bool add(const char *key,const char *value,int vlen = -1)
+		{
+			char *const d = _dict->_d;
+			const unsigned int i = _end;
+			unsigned int j = i;
+
+			if (j > 0) {
+				d[j++] = (char)10;
+				if (j == C) {
+					d[i] = (char)0;
+					return false;
+				}
+			}
+
+			const char *p = key;
+			while (*p) {
+				d[j++] = *(p++);
+				if (j == C) {
+					d[i] = (char)0;
+					return false;
+				}
+			}
+
+			d[j++] = '=';
+			if (j == C) {
+				d[i] = (char)0;
+				return false;
+			}
+
+			p = value;
+			int k = 0;
+			while ( ((vlen < 0)&&(*p)) || (k < vlen) ) {
+				switch(*p) {
+					case 0:
+					case 13:
+					case 10:
+					case '\\':
+					case '=':
+						d[j++] = '\\';
+						if (j == C) {
+							d[i] = (char)0;
+							return false;
+						}
+						switch(*p) {
+							case 0:
+								d[j++] = '0';
+								break;
+							case 13:
+								d[j++] = 'r';
+								break;
+							case 10:
+								d[j++] = 'n';
+								break;
+							case '\\':
+								d[j++] = '\\';
+								break;
+							case '=':
+								d[j++] = 'e';
+								break;
+						}
+						if (j == C) {
+							d[i] = (char)0;
+							return false;
+						}
+						break;
+					default:
+						d[j++] = *p;
+						if (j == C) {
+							d[i] = (char)0;
+							return false;
+						}
+						break;
+				}
+				++p;
+				++k;
+			}
+
+			d[j] = (char)0;
+			_end = j;
+
+			return true;
+		}
+
+		/**
+		 * Append a boolean as a '1' or a '0'
+		 */
+		inline bool add(const char *key,bool value)
+		{
+			return this->add(key,(value) ? "1" : "0",1);
+		}
+
+		/**
+		 * Append a 64-bit integer (unsigned) as a hex value
+		 */
+		inline bool add(const char *key,uint64_t value)
+		{
+			char tmp[32];
+			return this->add(key,Utils::hex(value,tmp),-1);
+		}
+
+		/**
+		 * Append a 64-bit integer (signed) as a hex value
+		 */
+		inline bool add(const char *key,int64_t value)
+		{
+			char tmp[32];
+			if (value >= 0) {
+				return this->add(key,Utils::hex((uint64_t)value,tmp),-1);
+			} else {
+				tmp[0] = '-';
+				return this->add(key,Utils::hex((uint64_t)(value * -1),tmp+1),-1);
+			}
+		}
+
+		/**
+		 * Append an address as a hex value
+		 */
+		inline bool add(const char *key,const Address &a)
+		{
+			char tmp[32];
+			return this->add(key,Utils::hex(a.toInt(),tmp),-1);
+		}
+
+		/**
+		 * Append a binary buffer's contents as a value
+		 *
+		 * @tparam BC Buffer capacity (usually inferred)
+		 */
+		template<unsigned int BC>
+		inline bool add(const char *key,const Buffer<BC> &value)
+		{
+			return this->add(key,(const char *)value.data(),(int)value.size());
+		}
+
+	private:
+		Dictionary *_dict;
+		unsigned int _end;
+	};
+
 	/**
 	 * @return Value of C template parameter
 	 */
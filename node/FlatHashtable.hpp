@@ -0,0 +1,584 @@
+/*
+ * Copyright (c)2019 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2025-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+#ifndef ZT_FLATHASHTABLE_HPP
+#define ZT_FLATHASHTABLE_HPP
+
+#include "Constants.hpp"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <stdexcept>
+#include <vector>
+#include <utility>
+#include <new>
+
+#if (defined(__SSE2__) || defined(__x86_64__) || defined(_M_X64))
+#include <emmintrin.h>
+#define ZT_FLATHASHTABLE_SSE2 1
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define ZT_FLATHASHTABLE_NEON 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace ZeroTier {
+
+/**
+ * Open addressing hash table with SIMD-probed control bytes
+ *
+ * This is an alternative to Hashtable for hot per-packet maps. Entries live
+ * in a flat slot array and each slot has a one-byte control word holding
+ * seven bits of the key's hash; lookups compare sixteen control bytes at a
+ * time (SSE2 or NEON where available), so a probe usually touches one cache
+ * line of metadata instead of chasing a bucket chain through the heap.
+ *
+ * The API mirrors Hashtable, including its Iterator semantics: it is safe to
+ * erase the key most recently returned by next() (erasure leaves a tombstone
+ * and moves nothing), but set()/operator[] may rehash and invalidate the
+ * iterator. Unlike Hashtable, pointers and references into the table are
+ * only valid until the next insert: growth moves entries. Call sites holding
+ * a value reference across an insert need Hashtable instead.
+ */
+template<typename K,typename V>
+class FlatHashtable
+{
+private:
+	enum {
+		_CTRL_EMPTY = (int8_t)-128, // 0x80
+		_CTRL_DELETED = (int8_t)-2  // 0xfe; occupied slots hold 0..127
+	};
+
+	struct _Slot
+	{
+		K k;
+		V v;
+	};
+
+public:
+	/**
+	 * A simple forward iterator (different from STL)
+	 *
+	 * It's safe to erase the last key, but not others. Don't use set() since
+	 * that may rehash and invalidate the iterator.
+	 */
+	class Iterator
+	{
+	public:
+		/**
+		 * @param ht Hash table to iterate over
+		 */
+		Iterator(FlatHashtable &ht) :
+			_idx(0),
+			_ht(&ht)
+		{
+		}
+
+		/**
+		 * @param kptr Pointer to set to point to next key
+		 * @param vptr Pointer to set to point to next value
+		 * @return True if kptr and vptr are set, false if no more entries
+		 */
+		inline bool next(K *&kptr,V *&vptr)
+		{
+			while (_idx < _ht->_cap) {
+				if (_ht->_ctrl[_idx] >= 0) {
+					_Slot *const s = _ht->_slot(_idx);
+					kptr = &(s->k);
+					vptr = &(s->v);
+					++_idx;
+					return true;
+				}
+				++_idx;
+			}
+			return false;
+		}
+
+	private:
+		unsigned long _idx;
+		FlatHashtable *_ht;
+	};
+
+	/**
+	 * @param bc Initial capacity in entries (rounded up to a power of two, minimum 16)
+	 */
+	FlatHashtable(unsigned long bc = 64)
+	{
+		_init(_roundCapacity(bc));
+	}
+
+	FlatHashtable(const FlatHashtable<K,V> &ht)
+	{
+		_init(ht._cap);
+		for(unsigned long i=0;i<ht._cap;++i) {
+			if (ht._ctrl[i] >= 0) {
+				const _Slot *const s = ht._slot(i);
+				this->set(s->k,s->v);
+			}
+		}
+	}
+
+	~FlatHashtable()
+	{
+		this->clear();
+		::free(_mem);
+	}
+
+	inline FlatHashtable &operator=(const FlatHashtable<K,V> &ht)
+	{
+		if (&ht != this) {
+			this->clear();
+			for(unsigned long i=0;i<ht._cap;++i) {
+				if (ht._ctrl[i] >= 0) {
+					const _Slot *const s = ht._slot(i);
+					this->set(s->k,s->v);
+				}
+			}
+		}
+		return *this;
+	}
+
+	/**
+	 * Erase all entries
+	 */
+	inline void clear()
+	{
+		if (_size) {
+			for(unsigned long i=0;i<_cap;++i) {
+				if (_ctrl[i] >= 0) {
+					_slot(i)->~_Slot();
+				}
+			}
+		}
+		memset(_ctrl,(int)(int8_t)_CTRL_EMPTY,_cap);
+		_size = 0;
+		_deleted = 0;
+	}
+
+	/**
+	 * @return Vector of all keys
+	 */
+	inline typename std::vector<K> keys() const
+	{
+		typename std::vector<K> k;
+		k.reserve(_size);
+		this->appendKeys(k);
+		return k;
+	}
+
+	/**
+	 * Append all keys (in unspecified order) to the supplied vector or list
+	 *
+	 * @param v Vector, list, or other compliant container
+	 * @tparam Type of V (generally inferred)
+	 */
+	template<typename C>
+	inline void appendKeys(C &v) const
+	{
+		if (_size) {
+			for(unsigned long i=0;i<_cap;++i) {
+				if (_ctrl[i] >= 0) {
+					v.push_back(_slot(i)->k);
+				}
+			}
+		}
+	}
+
+	/**
+	 * @return Vector of all entries (pairs of K,V)
+	 */
+	inline typename std::vector< std::pair<K,V> > entries() const
+	{
+		typename std::vector< std::pair<K,V> > k;
+		if (_size) {
+			k.reserve(_size);
+			for(unsigned long i=0;i<_cap;++i) {
+				if (_ctrl[i] >= 0) {
+					const _Slot *const s = _slot(i);
+					k.push_back(std::pair<K,V>(s->k,s->v));
+				}
+			}
+		}
+		return k;
+	}
+
+	/**
+	 * @param k Key
+	 * @return Pointer to value or NULL if not found
+	 */
+	inline V *get(const K &k)
+	{
+		const unsigned long i = _find(k);
+		return (i != _NOT_FOUND) ? &(_slot(i)->v) : (V *)0;
+	}
+	inline const V *get(const K &k) const { return const_cast<FlatHashtable *>(this)->get(k); }
+
+	/**
+	 * @param k Key
+	 * @param v Value to fill with result
+	 * @return True if value was found and set (if false, v is not modified)
+	 */
+	inline bool get(const K &k,V &v) const
+	{
+		const V *const vp = this->get(k);
+		if (vp) {
+			v = *vp;
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	 * @param k Key to check
+	 * @return True if key is present
+	 */
+	inline bool contains(const K &k) const
+	{
+		return (this->get(k) != (const V *)0);
+	}
+
+	/**
+	 * @param k Key
+	 * @return True if value was present
+	 */
+	inline bool erase(const K &k)
+	{
+		const unsigned long i = _find(k);
+		if (i == _NOT_FOUND) {
+			return false;
+		}
+		_slot(i)->~_Slot();
+		_ctrl[i] = _CTRL_DELETED;
+		--_size;
+		++_deleted;
+		return true;
+	}
+
+	/**
+	 * @param k Key
+	 * @param v Value
+	 * @return Reference to value in table
+	 */
+	inline V &set(const K &k,const V &v)
+	{
+		const unsigned long i = _find(k);
+		if (i != _NOT_FOUND) {
+			_Slot *const s = _slot(i);
+			s->v = v;
+			return s->v;
+		}
+		_Slot *const s = _insert(k);
+		s->v = v;
+		return s->v;
+	}
+
+	/**
+	 * @param k Key
+	 * @return Value, possibly newly created
+	 */
+	inline V &operator[](const K &k)
+	{
+		const unsigned long i = _find(k);
+		if (i != _NOT_FOUND) {
+			return _slot(i)->v;
+		}
+		return _insert(k)->v;
+	}
+
+	/**
+	 * Pre-size the table for an expected number of entries
+	 *
+	 * @param expectedSize Expected number of entries
+	 */
+	inline void reserve(const unsigned long expectedSize)
+	{
+		const unsigned long nc = _roundCapacity((expectedSize * 8) / 7);
+		if (nc > _cap) {
+			_rehash(nc);
+		}
+	}
+
+	/**
+	 * @return Number of entries
+	 */
+	inline unsigned long size() const { return _size; }
+
+	/**
+	 * @return True if table is empty
+	 */
+	inline bool empty() const { return (_size == 0); }
+
+private:
+	static const unsigned long _NOT_FOUND = ~((unsigned long)0);
+
+	template<typename O>
+	static inline unsigned long _hc(const O &obj)
+	{
+		return (unsigned long)obj.hashCode();
+	}
+	static inline unsigned long _hc(const uint64_t i)
+	{
+		return (unsigned long)(i ^ (i >> 32)); // good for network IDs and addresses
+	}
+	static inline unsigned long _hc(const uint32_t i)
+	{
+		return ((unsigned long)i * (unsigned long)0x9e3779b1);
+	}
+	static inline unsigned long _hc(const uint16_t i)
+	{
+		return ((unsigned long)i * (unsigned long)0x9e3779b1);
+	}
+	static inline unsigned long _hc(const int i)
+	{
+		return ((unsigned long)i * (unsigned long)0x9e3779b1);
+	}
+
+	// Finalizing mix: open addressing needs well-distributed low bits even
+	// when the raw hash is weak (e.g. sequential integer keys)
+	static inline uint64_t _mix(uint64_t h)
+	{
+		h *= 0x9e3779b97f4a7c15ULL;
+		h ^= (h >> 32);
+		return h;
+	}
+
+	static inline unsigned long _roundCapacity(unsigned long bc)
+	{
+		unsigned long c = 16;
+		while (c < bc) {
+			c <<= 1U;
+		}
+		return c;
+	}
+
+	static inline unsigned int _ctz64(const uint64_t v)
+	{
+#ifdef _MSC_VER
+		unsigned long r = 0;
+		_BitScanForward64(&r,v);
+		return (unsigned int)r;
+#else
+		return (unsigned int)__builtin_ctzll(v);
+#endif
+	}
+
+	// Group scans return a 64-bit mask with one set bit per matching slot;
+	// _firstSlot()/_clearFirst() iterate it uniformly across backends.
+#ifdef ZT_FLATHASHTABLE_SSE2
+
+	static inline unsigned int _firstSlot(const uint64_t m) { return _ctz64(m); }
+	static inline uint64_t _clearFirst(const uint64_t m) { return (m & (m - 1)); }
+	static inline uint64_t _matchByte(const int8_t *const g,const uint8_t h2)
+	{
+		const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(g));
+		return (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(c,_mm_set1_epi8((char)h2)));
+	}
+	static inline uint64_t _matchEmpty(const int8_t *const g)
+	{
+		const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(g));
+		return (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(c,_mm_set1_epi8((char)_CTRL_EMPTY)));
+	}
+	static inline uint64_t _matchEmptyOrDeleted(const int8_t *const g)
+	{
+		// Empty (0x80) and deleted (0xfe) are the only values with the high bit set
+		const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(g));
+		return (uint64_t)(unsigned int)_mm_movemask_epi8(c);
+	}
+
+#elif defined(ZT_FLATHASHTABLE_NEON)
+
+	// NEON has no movemask; vshrn packs each lane's compare result into a
+	// nibble, masked down to one bit per nibble so _clearFirst() still works
+	static inline unsigned int _firstSlot(const uint64_t m) { return (_ctz64(m) >> 2); }
+	static inline uint64_t _clearFirst(const uint64_t m) { return (m & (m - 1)); }
+	static inline uint64_t _nibbleMask(const uint8x16_t eq)
+	{
+		return (vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq),4)),0) & 0x1111111111111111ULL);
+	}
+	static inline uint64_t _matchByte(const int8_t *const g,const uint8_t h2)
+	{
+		return _nibbleMask(vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(g)),vdupq_n_u8(h2)));
+	}
+	static inline uint64_t _matchEmpty(const int8_t *const g)
+	{
+		return _nibbleMask(vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(g)),vdupq_n_u8((uint8_t)_CTRL_EMPTY)));
+	}
+	static inline uint64_t _matchEmptyOrDeleted(const int8_t *const g)
+	{
+		return _nibbleMask(vreinterpretq_u8_s8(vshrq_n_s8(vld1q_s8(g),7)));
+	}
+
+#else
+
+	static inline unsigned int _firstSlot(const uint64_t m) { return _ctz64(m); }
+	static inline uint64_t _clearFirst(const uint64_t m) { return (m & (m - 1)); }
+	static inline uint64_t _matchByte(const int8_t *const g,const uint8_t h2)
+	{
+		uint64_t m = 0;
+		for(unsigned int i=0;i<16;++i) {
+			if (g[i] == (int8_t)h2) {
+				m |= ((uint64_t)1 << i);
+			}
+		}
+		return m;
+	}
+	static inline uint64_t _matchEmpty(const int8_t *const g)
+	{
+		uint64_t m = 0;
+		for(unsigned int i=0;i<16;++i) {
+			if (g[i] == _CTRL_EMPTY) {
+				m |= ((uint64_t)1 << i);
+			}
+		}
+		return m;
+	}
+	static inline uint64_t _matchEmptyOrDeleted(const int8_t *const g)
+	{
+		uint64_t m = 0;
+		for(unsigned int i=0;i<16;++i) {
+			if (g[i] < 0) {
+				m |= ((uint64_t)1 << i);
+			}
+		}
+		return m;
+	}
+
+#endif
+
+	inline _Slot *_slot(const unsigned long i) const { return (reinterpret_cast<_Slot *>(_slots) + i); }
+
+	inline void _init(const unsigned long cap)
+	{
+		_mem = reinterpret_cast<char *>(::malloc(cap + (cap * sizeof(_Slot))));
+		if (!_mem) {
+			throw ZT_EXCEPTION_OUT_OF_MEMORY;
+		}
+		_ctrl = reinterpret_cast<int8_t *>(_mem);
+		_slots = _mem + cap;
+		_cap = cap;
+		_size = 0;
+		_deleted = 0;
+		memset(_ctrl,(int)(int8_t)_CTRL_EMPTY,_cap);
+	}
+
+	inline unsigned long _find(const K &k) const
+	{
+		const uint64_t h = _mix((uint64_t)_hc(k));
+		const uint8_t h2 = (uint8_t)(h & 0x7f);
+		const unsigned long groupMask = (_cap >> 4) - 1;
+		unsigned long g = (unsigned long)(h >> 7) & groupMask;
+		for(unsigned long probes=0;probes<=groupMask;++probes) {
+			const int8_t *const ctrlGroup = _ctrl + (g << 4);
+			for(uint64_t m=_matchByte(ctrlGroup,h2);m;m=_clearFirst(m)) {
+				const unsigned long i = (g << 4) + _firstSlot(m);
+				if (_slot(i)->k == k) {
+					return i;
+				}
+			}
+			if (_matchEmpty(ctrlGroup)) {
+				return _NOT_FOUND;
+			}
+			g = (g + 1) & groupMask;
+		}
+		return _NOT_FOUND;
+	}
+
+	// Insert a key known to be absent, growing or scrubbing tombstones first
+	// if the load factor would pass 7/8
+	inline _Slot *_insert(const K &k)
+	{
+		if (((_size + _deleted + 1) << 3) > (_cap * 7)) {
+			if (((_size + 1) << 3) > ((_cap * 7) >> 1)) {
+				_rehash(_cap << 1);
+			} else {
+				_rehash(_cap); // mostly tombstones; rehash in place
+			}
+		}
+
+		const uint64_t h = _mix((uint64_t)_hc(k));
+		const unsigned long groupMask = (_cap >> 4) - 1;
+		unsigned long g = (unsigned long)(h >> 7) & groupMask;
+		for(;;) {
+			const uint64_t m = _matchEmptyOrDeleted(_ctrl + (g << 4));
+			if (m) {
+				const unsigned long i = (g << 4) + _firstSlot(m);
+				if (_ctrl[i] == _CTRL_DELETED) {
+					--_deleted;
+				}
+				_Slot *const s = _slot(i);
+				new (&(s->k)) K(k);
+				new (&(s->v)) V();
+				_ctrl[i] = (int8_t)(h & 0x7f);
+				++_size;
+				return s;
+			}
+			g = (g + 1) & groupMask;
+		}
+	}
+
+	inline void _rehash(const unsigned long nc)
+	{
+		char *const om = _mem;
+		int8_t *const octrl = _ctrl;
+		char *const oslots = _slots;
+		const unsigned long ocap = _cap;
+
+		_init(nc);
+
+		const unsigned long groupMask = (_cap >> 4) - 1;
+		for(unsigned long i=0;i<ocap;++i) {
+			if (octrl[i] >= 0) {
+				_Slot *const os = reinterpret_cast<_Slot *>(oslots) + i;
+				const uint64_t h = _mix((uint64_t)_hc(os->k));
+				unsigned long g = (unsigned long)(h >> 7) & groupMask;
+				for(;;) {
+					const uint64_t m = _matchEmptyOrDeleted(_ctrl + (g << 4));
+					if (m) {
+						const unsigned long ni = (g << 4) + _firstSlot(m);
+						_Slot *const s = _slot(ni);
+						new (&(s->k)) K(os->k);
+						new (&(s->v)) V(os->v);
+						_ctrl[ni] = (int8_t)(h & 0x7f);
+						break;
+					}
+					g = (g + 1) & groupMask;
+				}
+				os->~_Slot();
+			}
+		}
+		_size = (unsigned long)0;
+		for(unsigned long i=0;i<_cap;++i) {
+			if (_ctrl[i] >= 0) {
+				++_size;
+			}
+		}
+		::free(om);
+	}
+
+	char *_mem; // single allocation: control bytes followed by slots
+	int8_t *_ctrl;
+	char *_slots;
+	unsigned long _cap; // always a power of two and a multiple of 16
+	unsigned long _size;
+	unsigned long _deleted; // tombstone count
+};
+
+} // namespace ZeroTier
+
+#endif
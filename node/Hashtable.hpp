@@ -29,6 +29,13 @@ namespace ZeroTier {
 
 /**
  * A minimal hash table implementation for the ZeroTier core
+ *
+ * Growth is incremental: when the table doubles, old entries are not rehashed
+ * in one pass but are instead migrated a few buckets at a time by subsequent
+ * inserts. This bounds the cost of any single insert, which matters because
+ * callers hold datapath mutexes while inserting. Lookups transparently check
+ * the old bucket array until migration completes. Pointers to values remain
+ * valid across migration since buckets are relinked, never copied.
  */
 template<typename K,typename V>
 class Hashtable
@@ -60,9 +67,10 @@ public:
 		 * @param ht Hash table to iterate over
 		 */
 		Iterator(Hashtable &ht) :
-			_idx(0),
+			_idx((ht._ot) ? ht._oi : 0),
+			_inOld(ht._ot != (_Bucket **)0),
 			_ht(&ht),
-			_b(ht._t[0])
+			_b((ht._ot) ? ht._ot[ht._oi] : ht._t[0])
 		{
 		}
 
@@ -81,15 +89,27 @@ public:
 					return true;
 				}
 				++_idx;
-				if (_idx >= _ht->_bc) {
-					return false;
+				if (_inOld) {
+					// Not-yet-migrated entries come first, then the current table
+					if (_idx >= _ht->_obc) {
+						_inOld = false;
+						_idx = 0;
+						_b = _ht->_t[0];
+						continue;
+					}
+					_b = _ht->_ot[_idx];
+				} else {
+					if (_idx >= _ht->_bc) {
+						return false;
+					}
+					_b = _ht->_t[_idx];
 				}
-				_b = _ht->_t[_idx];
 			}
 		}
 
 	private:
 		unsigned long _idx;
+		bool _inOld;
 		Hashtable *_ht;
 		_Bucket *_b;
 	};
@@ -101,6 +121,9 @@ public:
 	Hashtable(unsigned long bc = 64) :
 		_t(reinterpret_cast<_Bucket **>(::malloc(sizeof(_Bucket *) * bc))),
 		_bc(bc),
+		_ot((_Bucket **)0),
+		_obc(0),
+		_oi(0),
 		_s(0)
 	{
 		if (!_t) {
@@ -114,6 +137,9 @@ public:
 	Hashtable(const Hashtable<K,V> &ht) :
 		_t(reinterpret_cast<_Bucket **>(::malloc(sizeof(_Bucket *) * ht._bc))),
 		_bc(ht._bc),
+		_ot((_Bucket **)0),
+		_obc(0),
+		_oi(0),
 		_s(ht._s)
 	{
 		if (!_t) {
@@ -122,7 +148,19 @@ public:
 		for(unsigned long i=0;i<_bc;++i) {
 			_t[i] = (_Bucket *)0;
 		}
-		for(unsigned long i=0;i<_bc;++i) {
+		if (ht._ot) {
+			for(unsigned long i=ht._oi;i<ht._obc;++i) {
+				const _Bucket *b = ht._ot[i];
+				while (b) {
+					_Bucket *nb = new _Bucket(*b);
+					const unsigned long nidx = _hc(nb->k) % _bc;
+					nb->next = _t[nidx];
+					_t[nidx] = nb;
+					b = b->next;
+				}
+			}
+		}
+		for(unsigned long i=0;i<ht._bc;++i) {
 			const _Bucket *b = ht._t[i];
 			while (b) {
 				_Bucket *nb = new _Bucket(*b);
@@ -143,6 +181,15 @@ public:
 	{
 		this->clear();
 		if (ht._s) {
+			if (ht._ot) {
+				for(unsigned long i=ht._oi;i<ht._obc;++i) {
+					const _Bucket *b = ht._ot[i];
+					while (b) {
+						this->set(b->k,b->v);
+						b = b->next;
+					}
+				}
+			}
 			for(unsigned long i=0;i<ht._bc;++i) {
 				const _Bucket *b = ht._t[i];
 				while (b) {
@@ -159,6 +206,20 @@ public:
 	 */
 	inline void clear()
 	{
+		if (_ot) {
+			for(unsigned long i=_oi;i<_obc;++i) {
+					_Bucket *b = _ot[i];
+				while (b) {
+					_Bucket *const nb = b->next;
+					delete b;
+					b = nb;
+				}
+			}
+			::free(_ot);
+			_ot = (_Bucket **)0;
+			_obc = 0;
+			_oi = 0;
+		}
 		if (_s) {
 			for(unsigned long i=0;i<_bc;++i) {
 				_Bucket *b = _t[i];
@@ -181,6 +242,15 @@ public:
 		typename std::vector<K> k;
 		if (_s) {
 			k.reserve(_s);
+			if (_ot) {
+				for(unsigned long i=_oi;i<_obc;++i) {
+					_Bucket *b = _ot[i];
+					while (b) {
+						k.push_back(b->k);
+						b = b->next;
+					}
+				}
+			}
 			for(unsigned long i=0;i<_bc;++i) {
 				_Bucket *b = _t[i];
 				while (b) {
@@ -202,6 +272,15 @@ public:
 	inline void appendKeys(C &v) const
 	{
 		if (_s) {
+			if (_ot) {
+				for(unsigned long i=_oi;i<_obc;++i) {
+					_Bucket *b = _ot[i];
+					while (b) {
+						v.push_back(b->k);
+						b = b->next;
+					}
+				}
+			}
 			for(unsigned long i=0;i<_bc;++i) {
 				_Bucket *b = _t[i];
 				while (b) {
@@ -220,6 +299,15 @@ public:
 		typename std::vector< std::pair<K,V> > k;
 		if (_s) {
 			k.reserve(_s);
+			if (_ot) {
+				for(unsigned long i=_oi;i<_obc;++i) {
+					_Bucket *b = _ot[i];
+					while (b) {
+						k.push_back(std::pair<K,V>(b->k,b->v));
+						b = b->next;
+					}
+				}
+			}
 			for(unsigned long i=0;i<_bc;++i) {
 				_Bucket *b = _t[i];
 				while (b) {
@@ -237,13 +325,23 @@ public:
 	 */
 	inline V *get(const K &k)
 	{
-		_Bucket *b = _t[_hc(k) % _bc];
+		const unsigned long h = _hc(k);
+		_Bucket *b = _t[h % _bc];
 		while (b) {
 			if (b->k == k) {
 				return &(b->v);
 			}
 			b = b->next;
 		}
+		if (_ot) {
+			b = _ot[h % _obc];
+			while (b) {
+				if (b->k == k) {
+					return &(b->v);
+				}
+				b = b->next;
+			}
+		}
 		return (V *)0;
 	}
 	inline const V *get(const K &k) const { return const_cast<Hashtable *>(this)->get(k); }
@@ -255,13 +353,10 @@ public:
 	 */
 	inline bool get(const K &k,V &v) const
 	{
-		_Bucket *b = _t[_hc(k) % _bc];
-		while (b) {
-			if (b->k == k) {
-				v = b->v;
-				return true;
-			}
-			b = b->next;
+		const V *const vp = this->get(k);
+		if (vp) {
+			v = *vp;
+			return true;
 		}
 		return false;
 	}
@@ -272,14 +367,7 @@ public:
 	 */
 	inline bool contains(const K &k) const
 	{
-		_Bucket *b = _t[_hc(k) % _bc];
-		while (b) {
-			if (b->k == k) {
-				return true;
-			}
-			b = b->next;
-		}
-		return false;
+		return (this->get(k) != (const V *)0);
 	}
 
 	/**
@@ -288,22 +376,44 @@ public:
 	 */
 	inline bool erase(const K &k)
 	{
-		const unsigned long bidx = _hc(k) % _bc;
-		_Bucket *lastb = (_Bucket *)0;
-		_Bucket *b = _t[bidx];
-		while (b) {
-			if (b->k == k) {
-				if (lastb) {
-					lastb->next = b->next;
-				} else {
-					_t[bidx] = b->next;
+		const unsigned long h = _hc(k);
+		{
+			const unsigned long bidx = h % _bc;
+			_Bucket *lastb = (_Bucket *)0;
+			_Bucket *b = _t[bidx];
+			while (b) {
+				if (b->k == k) {
+					if (lastb) {
+						lastb->next = b->next;
+					} else {
+						_t[bidx] = b->next;
+					}
+					delete b;
+					--_s;
+					return true;
 				}
-				delete b;
-				--_s;
-				return true;
+				lastb = b;
+				b = b->next;
+			}
+		}
+		if (_ot) {
+			const unsigned long bidx = h % _obc;
+			_Bucket *lastb = (_Bucket *)0;
+			_Bucket *b = _ot[bidx];
+			while (b) {
+				if (b->k == k) {
+					if (lastb) {
+						lastb->next = b->next;
+					} else {
+						_ot[bidx] = b->next;
+					}
+					delete b;
+					--_s;
+					return true;
+				}
+				lastb = b;
+				b = b->next;
 			}
-			lastb = b;
-			b = b->next;
 		}
 		return false;
 	}
@@ -326,6 +436,16 @@ public:
 			}
 			b = b->next;
 		}
+		if (_ot) {
+			b = _ot[h % _obc];
+			while (b) {
+				if (b->k == k) {
+					b->v = v;
+					return b->v;
+				}
+				b = b->next;
+			}
+		}
 
 		if (_s >= _bc) {
 			_grow();
@@ -336,6 +456,9 @@ public:
 		b->next = _t[bidx];
 		_t[bidx] = b;
 		++_s;
+		if (_ot) {
+			_migrate(2);
+		}
 		return b->v;
 	}
 
@@ -355,6 +478,15 @@ public:
 			}
 			b = b->next;
 		}
+		if (_ot) {
+			b = _ot[h % _obc];
+			while (b) {
+				if (b->k == k) {
+					return b->v;
+				}
+				b = b->next;
+			}
+		}
 
 		if (_s >= _bc) {
 			_grow();
@@ -365,9 +497,55 @@ public:
 		b->next = _t[bidx];
 		_t[bidx] = b;
 		++_s;
+		if (_ot) {
+			_migrate(2);
+		}
 		return b->v;
 	}
 
+	/**
+	 * Pre-size the bucket array for an expected number of entries
+	 *
+	 * This rehashes any existing entries in one pass (including finishing any
+	 * in-progress incremental migration), so it should be called before bulk
+	 * insertion rather than during it. Shrinking is not supported.
+	 *
+	 * @param expectedSize Expected number of entries
+	 */
+	inline void reserve(const unsigned long expectedSize)
+	{
+		if (expectedSize <= _bc) {
+			return;
+		}
+		unsigned long nc = _bc;
+		while (nc < expectedSize) {
+			nc <<= 1U;
+		}
+		if (_ot) {
+			_migrate(_obc);
+		}
+		_Bucket **nt = reinterpret_cast<_Bucket **>(::malloc(sizeof(_Bucket *) * nc));
+		if (!nt) {
+			return;
+		}
+		for(unsigned long i=0;i<nc;++i) {
+			nt[i] = (_Bucket *)0;
+		}
+		for(unsigned long i=0;i<_bc;++i) {
+			_Bucket *b = _t[i];
+			while (b) {
+				_Bucket *const nb = b->next;
+				const unsigned long nidx = _hc(b->k) % nc;
+				b->next = nt[nidx];
+				nt[nidx] = b;
+				b = nb;
+			}
+		}
+		::free(_t);
+		_t = nt;
+		_bc = nc;
+	}
+
 	/**
 	 * @return Number of entries
 	 */
@@ -403,30 +581,54 @@ private:
 
 	inline void _grow()
 	{
+		if (_ot) {
+			// Normally migration finishes long before the table needs to double
+			// again; if not, finish it now so there are never more than two tables.
+			_migrate(_obc);
+		}
 		const unsigned long nc = _bc * 2;
 		_Bucket **nt = reinterpret_cast<_Bucket **>(::malloc(sizeof(_Bucket *) * nc));
 		if (nt) {
 			for(unsigned long i=0;i<nc;++i) {
 				nt[i] = (_Bucket *)0;
 			}
-			for(unsigned long i=0;i<_bc;++i) {
-				_Bucket *b = _t[i];
-				while (b) {
-					_Bucket *const nb = b->next;
-					const unsigned long nidx = _hc(b->k) % nc;
-					b->next = nt[nidx];
-					nt[nidx] = b;
-					b = nb;
-				}
-			}
-			::free(_t);
+			_ot = _t;
+			_obc = _bc;
+			_oi = 0;
 			_t = nt;
 			_bc = nc;
 		}
 	}
 
-	_Bucket **_t;
+	// Relink up to maxBuckets old bucket chains into the current table; called
+	// from inserts so migration cost is amortized a constant amount at a time
+	inline void _migrate(unsigned long maxBuckets)
+	{
+		while ((_oi < _obc)&&(maxBuckets != 0)) {
+			_Bucket *b = _ot[_oi];
+			while (b) {
+				_Bucket *const nb = b->next;
+				const unsigned long nidx = _hc(b->k) % _bc;
+				b->next = _t[nidx];
+				_t[nidx] = b;
+				b = nb;
+			}
+			_ot[_oi++] = (_Bucket *)0;
+			--maxBuckets;
+		}
+		if (_oi >= _obc) {
+			::free(_ot);
+			_ot = (_Bucket **)0;
+			_obc = 0;
+			_oi = 0;
+		}
+	}
+
+	_Bucket **_t; // current bucket array
 	unsigned long _bc;
+	_Bucket **_ot; // old bucket array while an incremental resize is in progress, otherwise NULL
+	unsigned long _obc;
+	unsigned long _oi; // next old bucket index to migrate; buckets below this are empty
 	unsigned long _s;
 };
 
@@ -16,8 +16,17 @@
 #include <string.h>
 #include <stdint.h>
 
+#ifndef __WINDOWS__
+#include <sys/mman.h>
+#endif
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include "Constants.hpp"
 #include "Identity.hpp"
+#include "Mutex.hpp"
 #include "SHA512.hpp"
 #include "Salsa20.hpp"
 #include "Utils.hpp"
@@ -30,6 +39,50 @@
 
 namespace ZeroTier {
 
+// Reusable per-thread scratch for the ~2MB genmem buffer used by identity
+// validation. Relays and roots validate identities continuously (every WHOIS
+// response, every HELLO from an unknown peer), and a fresh new[] per call
+// means the kernel hands back fresh zero pages that immediately fault in
+// again under the memset — most of that cost is page faults, not hashing.
+// Each validating thread keeps one buffer for its lifetime; where available
+// it is mapped with transparent huge page advice so the lookup-table phase
+// takes one TLB entry instead of five hundred.
+struct _GenmemScratch
+{
+	_GenmemScratch() :
+		ptr((char *)0),
+		mapped(false)
+	{
+#ifndef __WINDOWS__
+		void *const m = mmap((void *)0,ZT_IDENTITY_GEN_MEMORY,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+		if (m != MAP_FAILED) {
+#ifdef MADV_HUGEPAGE
+			madvise(m,ZT_IDENTITY_GEN_MEMORY,MADV_HUGEPAGE);
+#endif
+			ptr = (char *)m;
+			mapped = true;
+		}
+#endif
+		if (!ptr) {
+			ptr = new char[ZT_IDENTITY_GEN_MEMORY];
+		}
+	}
+
+	~_GenmemScratch()
+	{
+#ifndef __WINDOWS__
+		if (mapped) {
+			munmap((void *)ptr,ZT_IDENTITY_GEN_MEMORY);
+			return;
+		}
+#endif
+		delete [] ptr;
+	}
+
+	char *ptr;
+	bool mapped;
+};
+
 // A memory-hard composition of SHA-512 and Salsa20 for hashcash hashing
 static inline void _computeMemoryHardHash(const void *publicKey,unsigned int publicKeyBytes,void *digest,void *genmem)
 {
@@ -81,24 +134,100 @@ struct _Identity_generate_cond
 	char *genmem;
 };
 
-void Identity::generate()
+// Cancellable variant of the halting condition used by parallel generation:
+// gives up (returning true) once another worker has already found a result.
+struct _Identity_generate_cond_cancel
 {
-	unsigned char digest[64];
-	char *genmem = new char[ZT_IDENTITY_GEN_MEMORY];
+	_Identity_generate_cond_cancel() {}
+	_Identity_generate_cond_cancel(unsigned char *sb,char *gm,const std::atomic<bool> *d) : digest(sb),genmem(gm),done(d) {}
+	inline bool operator()(const C25519::Pair &kp) const
+	{
+		if (done->load(std::memory_order_relaxed)) {
+			return true;
+		}
+		_computeMemoryHardHash(kp.pub.data,ZT_C25519_PUBLIC_KEY_LEN,digest,genmem);
+		return (digest[0] < ZT_IDENTITY_GEN_HASHCASH_FIRST_BYTE_LESS_THAN);
+	}
+	unsigned char *digest;
+	char *genmem;
+	const std::atomic<bool> *done;
+};
 
-	C25519::Pair kp;
-	do {
-		kp = C25519::generateSatisfying(_Identity_generate_cond(digest,genmem));
-		_address.setTo(digest + 59,ZT_ADDRESS_LENGTH); // last 5 bytes are address
-	} while (_address.isReserved());
+void Identity::generate(unsigned int concurrency)
+{
+	if (concurrency == 0) {
+		concurrency = std::thread::hardware_concurrency();
+		if (concurrency == 0) {
+			concurrency = 1;
+		}
+	}
 
-	_publicKey = kp.pub;
+	if (concurrency <= 1) {
+		unsigned char digest[64];
+		char *genmem = new char[ZT_IDENTITY_GEN_MEMORY];
+
+		C25519::Pair kp;
+		do {
+			kp = C25519::generateSatisfying(_Identity_generate_cond(digest,genmem));
+			_address.setTo(digest + 59,ZT_ADDRESS_LENGTH); // last 5 bytes are address
+		} while (_address.isReserved());
+
+		_publicKey = kp.pub;
+		if (!_privateKey) {
+			_privateKey = new C25519::Private();
+		}
+		*_privateKey = kp.priv;
+
+		delete [] genmem;
+		return;
+	}
+
+	// Parallel search: each worker probes independent candidate keypairs with
+	// its own scratch memory and the first valid result wins. Since each probe
+	// is an independent memory-hard trial this cuts expected latency roughly
+	// by the worker count.
+	std::atomic<bool> done(false);
+	Mutex resultLock;
+	C25519::Pair resultKp;
+	Address resultAddr;
+
+	std::vector<std::thread> workers;
+	workers.reserve(concurrency);
+	for(unsigned int t=0;t<concurrency;++t) {
+		workers.push_back(std::thread([&done,&resultLock,&resultKp,&resultAddr]() {
+			unsigned char digest[64];
+			char *genmem = new char[ZT_IDENTITY_GEN_MEMORY];
+			while (!done.load(std::memory_order_relaxed)) {
+				const C25519::Pair kp(C25519::generateSatisfying(_Identity_generate_cond_cancel(digest,genmem,&done)));
+				if (done.load(std::memory_order_relaxed)) {
+					break; // canceled mid-search, digest is not a valid result
+				}
+				Address addr;
+				addr.setTo(digest + 59,ZT_ADDRESS_LENGTH); // last 5 bytes are address
+				if (addr.isReserved()) {
+					continue;
+				}
+				Mutex::Lock _l(resultLock);
+				if (!done.load(std::memory_order_relaxed)) {
+					resultKp = kp;
+					resultAddr = addr;
+					done.store(true,std::memory_order_release);
+				}
+				break;
+			}
+			delete [] genmem;
+		}));
+	}
+	for(std::vector<std::thread>::iterator w(workers.begin());w!=workers.end();++w) {
+		w->join();
+	}
+
+	_address = resultAddr;
+	_publicKey = resultKp.pub;
 	if (!_privateKey) {
 		_privateKey = new C25519::Private();
 	}
-	*_privateKey = kp.priv;
-
-	delete [] genmem;
+	*_privateKey = resultKp.priv;
 }
 
 bool Identity::locallyValidate() const
@@ -108,9 +237,8 @@ bool Identity::locallyValidate() const
 	}
 
 	unsigned char digest[64];
-	char *genmem = new char[ZT_IDENTITY_GEN_MEMORY];
-	_computeMemoryHardHash(_publicKey.data,ZT_C25519_PUBLIC_KEY_LEN,digest,genmem);
-	delete [] genmem;
+	static thread_local _GenmemScratch scratch;
+	_computeMemoryHardHash(_publicKey.data,ZT_C25519_PUBLIC_KEY_LEN,digest,scratch.ptr);
 
 	unsigned char addrb[5];
 	_address.copyTo(addrb,5);
@@ -95,9 +95,13 @@ public:
 	/**
 	 * Generate a new identity (address, key pair)
 	 *
-	 * This is a time consuming operation.
+	 * This is a time consuming operation. The search can be run on multiple
+	 * threads, each probing independent candidate keypairs, which divides
+	 * expected latency by roughly the thread count.
+	 *
+	 * @param concurrency Number of search threads (1 for the classic single-threaded search, 0 to use all hardware cores)
 	 */
-	void generate();
+	void generate(unsigned int concurrency = 1);
 
 	/**
 	 * Check the validity of this identity's pairing of key to address
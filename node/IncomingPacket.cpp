@@ -41,9 +41,46 @@
 
 namespace ZeroTier {
 
+// The verb field is five bits, so this table covers every possible value.
+// Null entries (NOP, unassigned verbs) fall through to the "received but
+// ignored" path in tryDecode(). HELLO is special cased before dispatch since
+// it is the only verb that may arrive unauthenticated.
+const IncomingPacket::_VerbHandler IncomingPacket::_VERB_HANDLERS[32] = {
+	0,                                            // 0x00 VERB_NOP
+	0,                                            // 0x01 VERB_HELLO (special cased)
+	&IncomingPacket::_doERROR,                    // 0x02
+	&IncomingPacket::_doOK,                       // 0x03
+	&IncomingPacket::_doWHOIS,                    // 0x04
+	&IncomingPacket::_doRENDEZVOUS,               // 0x05
+	&IncomingPacket::_doFRAME,                    // 0x06
+	&IncomingPacket::_doEXT_FRAME,                // 0x07
+	&IncomingPacket::_doECHO,                     // 0x08
+	&IncomingPacket::_doMULTICAST_LIKE,           // 0x09
+	&IncomingPacket::_doNETWORK_CREDENTIALS,      // 0x0a
+	&IncomingPacket::_doNETWORK_CONFIG_REQUEST,   // 0x0b
+	&IncomingPacket::_doNETWORK_CONFIG,           // 0x0c
+	&IncomingPacket::_doMULTICAST_GATHER,         // 0x0d
+	&IncomingPacket::_doMULTICAST_FRAME,          // 0x0e
+	0,                                            // 0x0f (unassigned)
+	&IncomingPacket::_doPUSH_DIRECT_PATHS,        // 0x10
+	0,                                            // 0x11 (unassigned)
+	&IncomingPacket::_doACK,                      // 0x12
+	&IncomingPacket::_doQOS_MEASUREMENT,          // 0x13
+	&IncomingPacket::_doUSER_MESSAGE,             // 0x14
+	&IncomingPacket::_doREMOTE_TRACE,             // 0x15
+	&IncomingPacket::_doPATH_NEGOTIATION_REQUEST, // 0x16
+	&IncomingPacket::_doFRAME_BUNDLE,             // 0x17
+	&IncomingPacket::_doGROUP_KEY,                // 0x18
+	0,0,0,0,0,0,0                                 // 0x19-0x1f (unassigned)
+};
+
 bool IncomingPacket::tryDecode(const RuntimeEnvironment *RR,void *tPtr,int32_t flowId)
 {
+	// Decode the cleartext header fields once up front; they get reused at
+	// several points below.
 	const Address sourceAddress(source());
+	const uint64_t pid = packetId();
+	const unsigned int h = hops();
 
 	try {
 		// Check for trusted paths or unencrypted HELLOs (HELLO is the only packet sent in the clear)
@@ -56,8 +93,26 @@ bool IncomingPacket::tryDecode(const RuntimeEnvironment *RR,void *tPtr,int32_t f
 			if (RR->topology->shouldInboundPathBeTrusted(_path->address(),tpid)) {
 				_authenticated = true;
 			} else {
-				RR->t->incomingPacketMessageAuthenticationFailure(tPtr,_path,packetId(),sourceAddress,hops(),"path not trusted");
-				return true;
+				// Controller-designated trusted paths are honored per peer,
+				// not globally like local.conf entries: the claimed source
+				// must be a verified authorized member of the designating
+				// network, so joining a third-party network never disables
+				// authentication for unrelated traffic.
+				bool networkTrusted = false;
+				const uint64_t tpNwid = RR->topology->networkTrustedPathNetworkId(_path->address(),tpid);
+				if (tpNwid) {
+					const SharedPtr<Network> network(RR->node->network(tpNwid));
+					const SharedPtr<Peer> sourcePeer(RR->topology->getPeer(tPtr,sourceAddress));
+					if ((network)&&(sourcePeer)&&(network->gate(tPtr,sourcePeer))) {
+						networkTrusted = true;
+					}
+				}
+				if (networkTrusted) {
+					_authenticated = true;
+				} else {
+					RR->t->incomingPacketMessageAuthenticationFailure(tPtr,_path,pid,sourceAddress,h,"path not trusted");
+					return true;
+				}
 			}
 		} else if ((c == ZT_PROTO_CIPHER_SUITE__C25519_POLY1305_NONE)&&(verb() == Packet::VERB_HELLO)) {
 			// Only HELLO is allowed in the clear, but will still have a MAC
@@ -67,15 +122,21 @@ bool IncomingPacket::tryDecode(const RuntimeEnvironment *RR,void *tPtr,int32_t f
 		const SharedPtr<Peer> peer(RR->topology->getPeer(tPtr,sourceAddress));
 		if (peer) {
 			if (!_authenticated) {
-				if (!dearmor(peer->key(), peer->aesKeys())) {
-					RR->t->incomingPacketMessageAuthenticationFailure(tPtr,_path,packetId(),sourceAddress,hops(),"invalid MAC");
+				if (c == ZT_PROTO_CIPHER_SUITE__POLY1305_SALSA2012_GROUP) {
+					if (!peer->dearmorWithRemoteGroupKey(*this)) {
+						RR->t->incomingPacketMessageAuthenticationFailure(tPtr,_path,pid,sourceAddress,h,"no matching group key");
+						peer->recordIncomingInvalidPacket(_path);
+						return true;
+					}
+				} else if (!dearmor(peer->key(), peer->aesKeys())) {
+					RR->t->incomingPacketMessageAuthenticationFailure(tPtr,_path,pid,sourceAddress,h,"invalid MAC");
 					peer->recordIncomingInvalidPacket(_path);
 					return true;
 				}
 			}
 
 			if (!uncompress()) {
-				RR->t->incomingPacketInvalid(tPtr,_path,packetId(),sourceAddress,hops(),Packet::VERB_NOP,"LZ4 decompression failed");
+				RR->t->incomingPacketInvalid(tPtr,_path,pid,sourceAddress,h,Packet::VERB_NOP,"LZ4 decompression failed");
 				return true;
 			}
 
@@ -83,72 +144,17 @@ bool IncomingPacket::tryDecode(const RuntimeEnvironment *RR,void *tPtr,int32_t f
 			const Packet::Verb v = verb();
 
 			bool r = true;
-			switch(v) {
-				//case Packet::VERB_NOP:
-				default: // ignore unknown verbs, but if they pass auth check they are "received"
+			if (v == Packet::VERB_HELLO) {
+				r = _doHELLO(RR, tPtr, true);
+			} else {
+				const _VerbHandler handler = _VERB_HANDLERS[(unsigned int)v & 0x1f];
+				if (handler) {
+					r = (this->*handler)(RR, tPtr, peer, flowId);
+				} else {
+					// ignore NOP and unknown verbs, but if they pass auth check they are "received"
 					Metrics::pkt_nop_in++;
-					peer->received(tPtr,_path,hops(),packetId(),payloadLength(),v,0,Packet::VERB_NOP,false,0,ZT_QOS_NO_FLOW);
-					break;
-				case Packet::VERB_HELLO:
-					r = _doHELLO(RR, tPtr, true);
-					break;
-				case Packet::VERB_ACK:
-					r = _doACK(RR, tPtr, peer);
-					break;
-				case Packet::VERB_QOS_MEASUREMENT:
-					r = _doQOS_MEASUREMENT(RR, tPtr, peer);
-					break;
-				case Packet::VERB_ERROR:
-					r = _doERROR(RR, tPtr, peer);
-					break;
-				case Packet::VERB_OK:
-					r = _doOK(RR, tPtr, peer);
-					break;
-				case Packet::VERB_WHOIS:
-					r = _doWHOIS(RR, tPtr, peer);
-					break;
-				case Packet::VERB_RENDEZVOUS:
-					r = _doRENDEZVOUS(RR, tPtr, peer);
-					break;
-				case Packet::VERB_FRAME:
-					r = _doFRAME(RR, tPtr, peer, flowId);
-					break;
-				case Packet::VERB_EXT_FRAME:
-					r = _doEXT_FRAME(RR, tPtr, peer, flowId);
-					break;
-				case Packet::VERB_ECHO:
-					r = _doECHO(RR, tPtr, peer);
-					break;
-				case Packet::VERB_MULTICAST_LIKE:
-					r = _doMULTICAST_LIKE(RR, tPtr, peer);
-					break;
-				case Packet::VERB_NETWORK_CREDENTIALS:
-					r = _doNETWORK_CREDENTIALS(RR, tPtr, peer);
-					break;
-				case Packet::VERB_NETWORK_CONFIG_REQUEST:
-					r = _doNETWORK_CONFIG_REQUEST(RR, tPtr, peer);
-					break;
-				case Packet::VERB_NETWORK_CONFIG:
-					r = _doNETWORK_CONFIG(RR, tPtr, peer);
-					break;
-				case Packet::VERB_MULTICAST_GATHER:
-					r = _doMULTICAST_GATHER(RR, tPtr, peer);
-					break;
-				case Packet::VERB_MULTICAST_FRAME:
-					r = _doMULTICAST_FRAME(RR, tPtr, peer);
-					break;
-				case Packet::VERB_PUSH_DIRECT_PATHS:
-					r = _doPUSH_DIRECT_PATHS(RR, tPtr, peer);
-					break;
-				case Packet::VERB_USER_MESSAGE:
-					r = _doUSER_MESSAGE(RR, tPtr, peer);
-					break;
-				case Packet::VERB_REMOTE_TRACE:
-					r = _doREMOTE_TRACE(RR, tPtr, peer);
-					break;
-				case Packet::VERB_PATH_NEGOTIATION_REQUEST:
-					r = _doPATH_NEGOTIATION_REQUEST(RR, tPtr, peer);
-					break;
+					peer->received(tPtr,_path,h,pid,payloadLength(),v,0,Packet::VERB_NOP,false,0,ZT_QOS_NO_FLOW);
+				}
 			}
 			if (r) {
 				RR->node->statsLogVerb((unsigned int)v,(unsigned int)size());
@@ -160,12 +166,12 @@ bool IncomingPacket::tryDecode(const RuntimeEnvironment *RR,void *tPtr,int32_t f
 			return false;
 		}
 	} catch ( ... ) {
-		RR->t->incomingPacketInvalid(tPtr,_path,packetId(),sourceAddress,hops(),verb(),"unexpected exception in tryDecode()");
+		RR->t->incomingPacketInvalid(tPtr,_path,pid,sourceAddress,h,verb(),"unexpected exception in tryDecode()");
 		return true;
 	}
 }
 
-bool IncomingPacket::_doERROR(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer)
+bool IncomingPacket::_doERROR(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
 {
 	const Packet::Verb inReVerb = (Packet::Verb)(*this)[ZT_PROTO_VERB_ERROR_IDX_IN_RE_VERB];
 	const uint64_t inRePacketId = at<uint64_t>(ZT_PROTO_VERB_ERROR_IDX_IN_RE_PACKET_ID);
@@ -314,7 +320,7 @@ bool IncomingPacket::_doERROR(const RuntimeEnvironment *RR,void *tPtr,const Shar
 	return true;
 }
 
-bool IncomingPacket::_doACK(const RuntimeEnvironment* RR, void* tPtr, const SharedPtr<Peer>& peer)
+bool IncomingPacket::_doACK(const RuntimeEnvironment* RR, void* tPtr, const SharedPtr<Peer>& peer, int32_t flowId)
 {
 	/*
 	SharedPtr<Bond> bond = peer->bond();
@@ -334,7 +340,7 @@ bool IncomingPacket::_doACK(const RuntimeEnvironment* RR, void* tPtr, const Shar
 	return true;
 }
 
-bool IncomingPacket::_doQOS_MEASUREMENT(const RuntimeEnvironment* RR, void* tPtr, const SharedPtr<Peer>& peer)
+bool IncomingPacket::_doQOS_MEASUREMENT(const RuntimeEnvironment* RR, void* tPtr, const SharedPtr<Peer>& peer, int32_t flowId)
 {
 	Metrics::pkt_qos_in++;
 	SharedPtr<Bond> bond = peer->bond();
@@ -455,7 +461,8 @@ bool IncomingPacket::_doHELLO(const RuntimeEnvironment *RR,void *tPtr,const bool
 		}
 
 		// Check that identity's address is valid as per the derivation function
-		if (!id.locallyValidate()) {
+		// (cached in Topology, so known identities skip the memory-hard work)
+		if (!RR->topology->validateIdentity(id)) {
 			RR->t->incomingPacketDroppedHELLO(tPtr,_path,pid,fromAddress,"invalid identity");
 			return true;
 		}
@@ -487,6 +494,7 @@ bool IncomingPacket::_doHELLO(const RuntimeEnvironment *RR,void *tPtr,const bool
 	}
 
 	std::vector< std::pair<uint64_t,uint64_t> > moonIdsAndTimestamps;
+	unsigned int resumptionTicketAt = 0;
 	if (ptr < size()) {
 		// Remainder of packet, if present, is encrypted
 		cryptField(peer->key(),ptr,size() - ptr);
@@ -502,6 +510,31 @@ bool IncomingPacket::_doHELLO(const RuntimeEnvironment *RR,void *tPtr,const bool
 				ptr += 16;
 			}
 		}
+
+		// Get extension flags if present (1.10.7+): bit 0 = session resumption
+		// ticket follows, bit 1 = sender accepts VERB_FRAME_BUNDLE, bit 2 =
+		// sender accepts VERB_GROUP_KEY and group-keyed packets
+		if (ptr < size()) {
+			const uint8_t extFlags = (*this)[ptr++];
+			if (((extFlags & 0x01) != 0)&&((ptr + ZT_PEER_RESUMPTION_TICKET_SIZE) <= size())) {
+				resumptionTicketAt = ptr;
+				ptr += ZT_PEER_RESUMPTION_TICKET_SIZE;
+			}
+			peer->setRemoteFrameBundleSupport((extFlags & 0x02) != 0);
+			peer->setRemoteGroupKeySupport((extFlags & 0x04) != 0);
+		}
+	}
+
+	// A valid resumption ticket means the peer restarted after an authenticated
+	// session with us recently and has lost the credentials we pushed during
+	// that session. Re-push spontaneously on shared networks so it does not
+	// have to discover the loss through ERROR_NEED_MEMBERSHIP_CERTIFICATE
+	// round trips before traffic flows again.
+	if ((resumptionTicketAt > 0)&&(peer->checkResumptionTicket(field(resumptionTicketAt,ZT_PEER_RESUMPTION_TICKET_SIZE),now))) {
+		const std::vector< SharedPtr<Network> > nws(RR->node->allNetworks());
+		for(std::vector< SharedPtr<Network> >::const_iterator n(nws.begin());n!=nws.end();++n) {
+			(*n)->peerSessionResumed(tPtr,id.address(),now);
+		}
 	}
 
 	// Send OK(HELLO) with an echo of the packet's timestamp and some of the same
@@ -567,6 +600,17 @@ bool IncomingPacket::_doHELLO(const RuntimeEnvironment *RR,void *tPtr,const bool
 	}
 	outp.setAt<uint16_t>(worldUpdateSizeAt,(uint16_t)(outp.size() - (worldUpdateSizeAt + 2)));
 
+	{
+		// Extension flags (1.10.7+): bit 0 = session resumption ticket follows,
+		// bit 1 = we accept VERB_FRAME_BUNDLE, bit 2 = we accept
+		// VERB_GROUP_KEY and group-keyed packets. Older versions ignore
+		// trailing fields and the payload of OK(HELLO) is encrypted in transit.
+		uint8_t resumptionTicket[ZT_PEER_RESUMPTION_TICKET_SIZE];
+		peer->issueResumptionTicket(now,resumptionTicket);
+		outp.append((uint8_t)0x07);
+		outp.append(resumptionTicket,ZT_PEER_RESUMPTION_TICKET_SIZE);
+	}
+
 	outp.armor(peer->key(),true,peer->aesKeysIfSupported());
 	peer->recordOutgoingPacket(_path,outp.packetId(),outp.payloadLength(),outp.verb(),ZT_QOS_NO_FLOW,now);
 	Metrics::pkt_ok_out++;
@@ -578,7 +622,7 @@ bool IncomingPacket::_doHELLO(const RuntimeEnvironment *RR,void *tPtr,const bool
 	return true;
 }
 
-bool IncomingPacket::_doOK(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer)
+bool IncomingPacket::_doOK(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
 {
 	Metrics::pkt_ok_in++;
 	const Packet::Verb inReVerb = (Packet::Verb)(*this)[ZT_PROTO_VERB_OK_IDX_IN_RE_VERB];
@@ -625,10 +669,27 @@ bool IncomingPacket::_doOK(const RuntimeEnvironment *RR,void *tPtr,const SharedP
 				}
 			}
 
+			// Get extension flags if present (1.10.7+): bit 0 = session
+			// resumption ticket follows, bit 1 = sender accepts VERB_FRAME_BUNDLE
+			if (ptr < size()) {
+				const uint8_t extFlags = (*this)[ptr++];
+				if (((extFlags & 0x01) != 0)&&((ptr + ZT_PEER_RESUMPTION_TICKET_SIZE) <= size())) {
+					peer->setResumptionTicket(field(ptr,ZT_PEER_RESUMPTION_TICKET_SIZE),RR->node->now());
+					ptr += ZT_PEER_RESUMPTION_TICKET_SIZE;
+				}
+				peer->setRemoteFrameBundleSupport((extFlags & 0x02) != 0);
+			peer->setRemoteGroupKeySupport((extFlags & 0x04) != 0);
+			}
+
 			if (!hops()) {
 				SharedPtr<Bond> bond = peer->bond();
 				if (!bond) {
 					_path->updateLatency((unsigned int)latency,RR->node->now());
+				} else {
+					// Bonded paths estimate latency through the QoS machinery;
+					// folding in the RTT of this ordinary exchange keeps those
+					// estimates fresh without extra measurement traffic.
+					bond->recordLatencySample(_path,(unsigned int)(latency / 2));
 				}
 			}
 
@@ -639,6 +700,14 @@ bool IncomingPacket::_doOK(const RuntimeEnvironment *RR,void *tPtr,const SharedP
 			}
 		}	break;
 
+		case Packet::VERB_ECHO:
+			// An OK(ECHO) echoes the probe payload, so an unfragmented arrival at
+			// this size proves the path carries packets this large both ways.
+			if (!hops()) {
+				_path->updateProbedMtu(size());
+			}
+			break;
+
 		case Packet::VERB_WHOIS:
 			if (RR->topology->isUpstream(peer->identity())) {
 				const Identity id(*this,ZT_PROTO_VERB_WHOIS__OK__IDX_IDENTITY);
@@ -702,7 +771,7 @@ bool IncomingPacket::_doOK(const RuntimeEnvironment *RR,void *tPtr,const SharedP
 	return true;
 }
 
-bool IncomingPacket::_doWHOIS(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer)
+bool IncomingPacket::_doWHOIS(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
 {
 	if ((!RR->topology->amUpstream())&&(!peer->rateGateInboundWhoisRequest(RR->node->now()))) {
 		return true;
@@ -720,9 +789,7 @@ bool IncomingPacket::_doWHOIS(const RuntimeEnvironment *RR,void *tPtr,const Shar
 		const Address addr(field(ptr,ZT_ADDRESS_LENGTH),ZT_ADDRESS_LENGTH);
 		ptr += ZT_ADDRESS_LENGTH;
 
-		const Identity id(RR->topology->getIdentity(tPtr,addr));
-		if (id) {
-			id.serialize(outp,false);
+		if (RR->topology->appendWhoisIdentity(tPtr,addr,outp)) {
 			++count;
 		} else {
 			// Request unknown WHOIS from upstream from us (if we have one)
@@ -741,7 +808,7 @@ bool IncomingPacket::_doWHOIS(const RuntimeEnvironment *RR,void *tPtr,const Shar
 	return true;
 }
 
-bool IncomingPacket::_doRENDEZVOUS(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer)
+bool IncomingPacket::_doRENDEZVOUS(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
 {
 	Metrics::pkt_rendezvous_in++;
 	if (RR->topology->isUpstream(peer->identity())) {
@@ -753,9 +820,24 @@ bool IncomingPacket::_doRENDEZVOUS(const RuntimeEnvironment *RR,void *tPtr,const
 			if ((port > 0)&&((addrlen == 4)||(addrlen == 16))) {
 				InetAddress atAddr(field(ZT_PROTO_VERB_RENDEZVOUS_IDX_ADDRESS,addrlen),addrlen,port);
 				if (RR->node->shouldUsePathForZeroTierTraffic(tPtr,with,_path->localSocket(),atAddr)) {
+					const int64_t now = RR->node->now();
+					rendezvousWith->noteRendezvous(atAddr,now);
 					const uint64_t junk = RR->node->prng();
 					RR->node->putPacket(tPtr,_path->localSocket(),atAddr,&junk,4,2); // send low-TTL junk packet to 'open' local NAT(s) and stateful firewalls
-					rendezvousWith->attemptToContactAt(tPtr,_path->localSocket(),atAddr,RR->node->now(),false);
+					rendezvousWith->attemptToContactAt(tPtr,_path->localSocket(),atAddr,now,false);
+
+					// If this peer's NAT has remapped ports by a stable offset
+					// before, probe the remapped port in the same volley so
+					// traversal through such NATs succeeds on the first try
+					// instead of waiting for another advertised-port cycle.
+					const int delta = rendezvousWith->natPortDelta();
+					const int deltaPort = (int)port + delta;
+					if ((delta != 0)&&(deltaPort > 0)&&(deltaPort <= 0xffff)) {
+						InetAddress deltaAddr(atAddr);
+						deltaAddr.setPort((unsigned int)deltaPort);
+						RR->node->putPacket(tPtr,_path->localSocket(),deltaAddr,&junk,4,2);
+						rendezvousWith->attemptToContactAt(tPtr,_path->localSocket(),deltaAddr,now,false);
+					}
 				}
 			}
 		}
@@ -976,7 +1058,92 @@ bool IncomingPacket::_doEXT_FRAME(const RuntimeEnvironment *RR,void *tPtr,const
 	return true;
 }
 
-bool IncomingPacket::_doECHO(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer)
+bool IncomingPacket::_doFRAME_BUNDLE(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
+{
+	Metrics::pkt_frame_bundle_in++;
+
+	unsigned int ptr = ZT_PROTO_VERB_FRAME_BUNDLE_IDX_FRAME_COUNT;
+	const unsigned int frameCount = (*this)[ptr++];
+
+	uint64_t lastNwid = 0;
+	uint64_t deniedNwid = 0;
+	SharedPtr<Network> network;
+	bool trustEstablished = false;
+
+	for(unsigned int f=0;f<frameCount;++f) {
+		if ((ptr + 25) > size()) {
+			break; // truncated bundle
+		}
+		const uint64_t nwid = at<uint64_t>(ptr);
+		ptr += 9; // network ID plus reserved flags byte
+		const MAC to(field(ptr,6),6);
+		ptr += 6;
+		const MAC from(field(ptr,6),6);
+		ptr += 6;
+		const unsigned int etherType = at<uint16_t>(ptr);
+		ptr += 2;
+		const unsigned int frameLen = at<uint16_t>(ptr);
+		ptr += 2;
+		if ((ptr + frameLen) > size()) {
+			break; // truncated bundle
+		}
+		const uint8_t *const frameData = (const uint8_t *)field(ptr,frameLen);
+		ptr += frameLen;
+
+		if (nwid != lastNwid) {
+			network = RR->node->network(nwid);
+			lastNwid = nwid;
+		}
+		if (!network) {
+			continue;
+		}
+		if (!network->gate(tPtr,peer)) {
+			if (nwid != deniedNwid) { // request credentials only once per network per bundle
+				RR->t->incomingNetworkAccessDenied(tPtr,network,_path,packetId(),size(),peer->address(),Packet::VERB_FRAME_BUNDLE,true);
+				_sendErrorNeedCredentials(RR,tPtr,peer,nwid);
+				deniedNwid = nwid;
+			}
+			continue;
+		}
+		trustEstablished = true;
+
+		if ((!from)||(from == network->mac())) {
+			continue;
+		}
+
+		switch (network->filterIncomingPacket(tPtr,peer,RR->identity.address(),from,to,frameData,frameLen,etherType,0)) {
+			case 1:
+				if (from != MAC(peer->address(),nwid)) {
+					if (network->config().permitsBridging(peer->address())) {
+						network->learnBridgeRoute(from,peer->address());
+					} else {
+						RR->t->incomingNetworkFrameDropped(tPtr,network,_path,packetId(),size(),peer->address(),Packet::VERB_FRAME_BUNDLE,from,to,"bridging not allowed (remote)");
+						break;
+					}
+				} else if (to != network->mac()) {
+					if (to.isMulticast()) {
+						if (network->config().multicastLimit == 0) {
+							RR->t->incomingNetworkFrameDropped(tPtr,network,_path,packetId(),size(),peer->address(),Packet::VERB_FRAME_BUNDLE,from,to,"multicast disabled");
+							break;
+						}
+					} else if (!network->config().permitsBridging(RR->identity.address())) {
+						RR->t->incomingNetworkFrameDropped(tPtr,network,_path,packetId(),size(),peer->address(),Packet::VERB_FRAME_BUNDLE,from,to,"bridging not allowed (local)");
+						break;
+					}
+				}
+				// fall through -- 2 means accept regardless of bridging checks or other restrictions
+			case 2:
+				RR->node->putFrame(tPtr,nwid,network->userPtr(),from,to,etherType,0,(const void *)frameData,frameLen);
+				break;
+		}
+	}
+
+	peer->received(tPtr,_path,hops(),packetId(),payloadLength(),Packet::VERB_FRAME_BUNDLE,0,Packet::VERB_NOP,trustEstablished,lastNwid,flowId);
+
+	return true;
+}
+
+bool IncomingPacket::_doECHO(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
 {
 	Metrics::pkt_echo_in++;
 	uint64_t now = RR->node->now();
@@ -1001,14 +1168,18 @@ bool IncomingPacket::_doECHO(const RuntimeEnvironment *RR,void *tPtr,const Share
 	return true;
 }
 
-bool IncomingPacket::_doMULTICAST_LIKE(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer)
+bool IncomingPacket::_doMULTICAST_LIKE(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
 {
 	Metrics::pkt_multicast_like_in++;
 	const int64_t now = RR->node->now();
 	bool authorized = false;
 	uint64_t lastNwid = 0;
 
-	// Packet contains a series of 18-byte network,MAC,ADI tuples
+	// Packet contains a series of 18-byte network,MAC,ADI tuples; collect the
+	// authorized ones and apply them in one batch so the multicaster's lock is
+	// taken once per packet rather than once per tuple
+	std::vector< std::pair<uint64_t,MulticastGroup> > likes;
+	likes.reserve((size() - ZT_PACKET_IDX_PAYLOAD) / 18);
 	for(unsigned int ptr=ZT_PACKET_IDX_PAYLOAD;ptr<size();ptr+=18) {
 		const uint64_t nwid = at<uint64_t>(ptr);
 		if (nwid != lastNwid) {
@@ -1022,15 +1193,18 @@ bool IncomingPacket::_doMULTICAST_LIKE(const RuntimeEnvironment *RR,void *tPtr,c
 			}
 		}
 		if (authorized) {
-			RR->mc->add(tPtr,now,nwid,MulticastGroup(MAC(field(ptr + 8,6),6),at<uint32_t>(ptr + 14)),peer->address());
+			likes.push_back(std::pair<uint64_t,MulticastGroup>(nwid,MulticastGroup(MAC(field(ptr + 8,6),6),at<uint32_t>(ptr + 14))));
 		}
 	}
+	if (!likes.empty()) {
+		RR->mc->likeMultiple(tPtr,now,likes.data(),(unsigned int)likes.size(),peer->address());
+	}
 
 	peer->received(tPtr,_path,hops(),packetId(),payloadLength(),Packet::VERB_MULTICAST_LIKE,0,Packet::VERB_NOP,false,0,ZT_QOS_NO_FLOW);
 	return true;
 }
 
-bool IncomingPacket::_doNETWORK_CREDENTIALS(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer)
+bool IncomingPacket::_doNETWORK_CREDENTIALS(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
 {
 	Metrics::pkt_network_credentials_in++;
 	if (!peer->rateGateCredentialsReceived(RR->node->now())) {
@@ -1169,7 +1343,7 @@ bool IncomingPacket::_doNETWORK_CREDENTIALS(const RuntimeEnvironment *RR,void *t
 	return true;
 }
 
-bool IncomingPacket::_doNETWORK_CONFIG_REQUEST(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer)
+bool IncomingPacket::_doNETWORK_CONFIG_REQUEST(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
 {
 	Metrics::pkt_network_config_request_in++;
 	const uint64_t nwid = at<uint64_t>(ZT_PROTO_VERB_NETWORK_CONFIG_REQUEST_IDX_NETWORK_ID);
@@ -1198,7 +1372,7 @@ bool IncomingPacket::_doNETWORK_CONFIG_REQUEST(const RuntimeEnvironment *RR,void
 	return true;
 }
 
-bool IncomingPacket::_doNETWORK_CONFIG(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer)
+bool IncomingPacket::_doNETWORK_CONFIG(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
 {
 	Metrics::pkt_network_config_in++;
 	const SharedPtr<Network> network(RR->node->network(at<uint64_t>(ZT_PACKET_IDX_PAYLOAD)));
@@ -1223,7 +1397,7 @@ bool IncomingPacket::_doNETWORK_CONFIG(const RuntimeEnvironment *RR,void *tPtr,c
 	return true;
 }
 
-bool IncomingPacket::_doMULTICAST_GATHER(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer)
+bool IncomingPacket::_doMULTICAST_GATHER(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
 {
 	Metrics::pkt_multicast_gather_in++;
 	const uint64_t nwid = at<uint64_t>(ZT_PROTO_VERB_MULTICAST_GATHER_IDX_NETWORK_ID);
@@ -1266,7 +1440,7 @@ bool IncomingPacket::_doMULTICAST_GATHER(const RuntimeEnvironment *RR,void *tPtr
 	return true;
 }
 
-bool IncomingPacket::_doMULTICAST_FRAME(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer)
+bool IncomingPacket::_doMULTICAST_FRAME(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
 {
 	Metrics::pkt_multicast_frame_in++;
 	const uint64_t nwid = at<uint64_t>(ZT_PROTO_VERB_MULTICAST_FRAME_IDX_NETWORK_ID);
@@ -1371,7 +1545,7 @@ bool IncomingPacket::_doMULTICAST_FRAME(const RuntimeEnvironment *RR,void *tPtr,
 	return true;
 }
 
-bool IncomingPacket::_doPUSH_DIRECT_PATHS(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer)
+bool IncomingPacket::_doPUSH_DIRECT_PATHS(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
 {
 	Metrics::pkt_push_direct_paths_in++;
 	const int64_t now = RR->node->now();
@@ -1435,7 +1609,7 @@ bool IncomingPacket::_doPUSH_DIRECT_PATHS(const RuntimeEnvironment *RR,void *tPt
 	return true;
 }
 
-bool IncomingPacket::_doUSER_MESSAGE(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer)
+bool IncomingPacket::_doUSER_MESSAGE(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
 {
 	Metrics::pkt_user_message_in++;
 	if (likely(size() >= (ZT_PACKET_IDX_PAYLOAD + 8))) {
@@ -1452,7 +1626,7 @@ bool IncomingPacket::_doUSER_MESSAGE(const RuntimeEnvironment *RR,void *tPtr,con
 	return true;
 }
 
-bool IncomingPacket::_doREMOTE_TRACE(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer)
+bool IncomingPacket::_doREMOTE_TRACE(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
 {
 	Metrics::pkt_remote_trace_in++;
 	ZT_RemoteTrace rt;
@@ -1477,7 +1651,7 @@ bool IncomingPacket::_doREMOTE_TRACE(const RuntimeEnvironment *RR,void *tPtr,con
 	return true;
 }
 
-bool IncomingPacket::_doPATH_NEGOTIATION_REQUEST(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer)
+bool IncomingPacket::_doPATH_NEGOTIATION_REQUEST(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
 {
 	Metrics::pkt_path_negotiation_request_in++;
 	uint64_t now = RR->node->now();
@@ -1509,4 +1683,23 @@ void IncomingPacket::_sendErrorNeedCredentials(const RuntimeEnvironment *RR,void
 	_path->send(RR,tPtr,outp.data(),outp.size(),RR->node->now());
 }
 
+bool IncomingPacket::_doGROUP_KEY(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Peer> &peer,int32_t flowId)
+{
+	Metrics::pkt_group_key_in++;
+	const uint64_t nwid = at<uint64_t>(ZT_PACKET_IDX_PAYLOAD);
+	// flags byte at +8 is currently unused
+	const uint64_t keyId = at<uint64_t>(ZT_PACKET_IDX_PAYLOAD + 9);
+
+	// Only accept group keys from authorized members of a network we have
+	// joined; the key only authenticates transport, and the per-network
+	// credential checks on each decoded frame still apply unchanged.
+	const SharedPtr<Network> network(RR->node->network(nwid));
+	if ((network)&&(network->gate(tPtr,peer))) {
+		peer->receiveRemoteGroupKey(keyId,reinterpret_cast<const uint8_t *>(field(ZT_PACKET_IDX_PAYLOAD + 17,32)));
+	}
+
+	peer->received(tPtr,_path,hops(),packetId(),payloadLength(),Packet::VERB_GROUP_KEY,0,Packet::VERB_NOP,false,nwid,ZT_QOS_NO_FLOW);
+	return true;
+}
+
 } // namespace ZeroTier
@@ -77,6 +77,60 @@ struct InetAddress : public sockaddr_storage
 		inline std::size_t operator()(const InetAddress &a) const { return (std::size_t)a.hashCode(); }
 	};
 
+	/**
+	 * Compact canonical key form of an IP/port for keying hash maps
+	 *
+	 * InetAddress must stay layout-compatible with sockaddr_storage (code
+	 * casts freely between the two), so a key cannot be cached inside the
+	 * address itself. Computing this once where an address keys a map makes
+	 * hashing and equality three-word operations instead of scans over a
+	 * 128-byte structure. The mapping is exact (no folding of the port into
+	 * v6 address bits), so Key equality matches address/port/family equality
+	 * for IP addresses.
+	 */
+	class Key
+	{
+	public:
+		Key() { _k[0] = 0; _k[1] = 0; _k[2] = 0; }
+
+		explicit Key(const InetAddress &a)
+		{
+			if (a.ss_family == AF_INET) {
+				_k[0] = (uint64_t)reinterpret_cast<const struct sockaddr_in *>(&a)->sin_addr.s_addr;
+				_k[1] = 0;
+				_k[2] = ((uint64_t)reinterpret_cast<const struct sockaddr_in *>(&a)->sin_port << 16) | (uint64_t)AF_INET;
+			} else if (a.ss_family == AF_INET6) {
+				memcpy(_k,reinterpret_cast<const struct sockaddr_in6 *>(&a)->sin6_addr.s6_addr,16);
+				_k[2] = ((uint64_t)reinterpret_cast<const struct sockaddr_in6 *>(&a)->sin6_port << 16) | (uint64_t)AF_INET6;
+			} else {
+				_k[0] = (uint64_t)a.hashCode();
+				_k[1] = 0;
+				_k[2] = (uint64_t)a.ss_family;
+			}
+		}
+
+		inline unsigned long hashCode() const { return (unsigned long)(_k[0] + _k[1] + _k[2]); }
+
+		inline bool operator==(const Key &k) const { return ((_k[0] == k._k[0])&&(_k[1] == k._k[1])&&(_k[2] == k._k[2])); }
+		inline bool operator!=(const Key &k) const { return (!(*this == k)); }
+		inline bool operator<(const Key &k) const
+		{
+			if (_k[0] < k._k[0]) {
+				return true;
+			} else if (_k[0] == k._k[0]) {
+				if (_k[1] < k._k[1]) {
+					return true;
+				} else if (_k[1] == k._k[1]) {
+					return (_k[2] < k._k[2]);
+				}
+			}
+			return false;
+		}
+
+	private:
+		uint64_t _k[3];
+	};
+
 	InetAddress() { memset(this,0,sizeof(InetAddress)); }
 	InetAddress(const InetAddress &a) { memcpy(this,&a,sizeof(InetAddress)); }
 	InetAddress(const InetAddress *a) { memcpy(this,a,sizeof(InetAddress)); }
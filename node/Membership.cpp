@@ -28,6 +28,15 @@ Membership::Membership() :
 	_lastUpdatedMulticast(0),
 	_comRevocationThreshold(0),
 	_lastPushedCredentials(0),
+	_lastPushedCredentialsConfigTimestamp(0),
+	_pushedGroupKeyId(0),
+	_credMinTs(0),
+	_credMaxTs(0),
+	_credSweepNeeded(false),
+	_comAgreeLocalTs(-1),
+	_comAgreeRemoteTs(-1),
+	_comAgreeResult(false),
+	_revocationBloom(0),
 	_revocations(4),
 	_remoteTags(4),
 	_remoteCaps(4),
@@ -35,75 +44,118 @@ Membership::Membership() :
 {
 }
 
-void Membership::pushCredentials(const RuntimeEnvironment *RR,void *tPtr,const int64_t now,const Address &peerAddress,const NetworkConfig &nconf)
+void Membership::pushCredentials(const RuntimeEnvironment *RR,void *tPtr,const int64_t now,const Address &peerAddress,const NetworkConfig &nconf,CredentialPushCache &cache,const uint64_t groupKeyId,const uint8_t groupKey[32])
 {
-	const Capability *sendCaps[ZT_MAX_NETWORK_CAPABILITIES];
-	unsigned int sendCapCount = 0;
-	for(unsigned int c=0;c<nconf.capabilityCount;++c) {
-		sendCaps[sendCapCount++] = &(nconf.capabilities[c]);
-	}
-
-	const Tag *sendTags[ZT_MAX_NETWORK_TAGS];
-	unsigned int sendTagCount = 0;
-	for(unsigned int t=0;t<nconf.tagCount;++t) {
-		sendTags[sendTagCount++] = &(nconf.tags[t]);
-	}
-
-	const CertificateOfOwnership *sendCoos[ZT_MAX_CERTIFICATES_OF_OWNERSHIP];
-	unsigned int sendCooCount = 0;
-	for(unsigned int c=0;c<nconf.certificateOfOwnershipCount;++c) {
-		sendCoos[sendCooCount++] = &(nconf.certificatesOfOwnership[c]);
-	}
+	// The credential payload is destination-independent, so it is serialized,
+	// split into packets, and compressed once per config and replayed from the
+	// cache for every member after that.
+	if (cache.configTimestamp != nconf.timestamp) {
+		cache.chunks.clear();
 
-	unsigned int capPtr = 0;
-	unsigned int tagPtr = 0;
-	unsigned int cooPtr = 0;
-	bool sendCom = (bool)(nconf.com);
-	while ((capPtr < sendCapCount)||(tagPtr < sendTagCount)||(cooPtr < sendCooCount)||(sendCom)) {
-		Packet outp(peerAddress,RR->identity.address(),Packet::VERB_NETWORK_CREDENTIALS);
-
-		if (sendCom) {
-			sendCom = false;
-			nconf.com.serialize(outp);
+		const Capability *sendCaps[ZT_MAX_NETWORK_CAPABILITIES];
+		unsigned int sendCapCount = 0;
+		for(unsigned int c=0;c<nconf.capabilityCount;++c) {
+			sendCaps[sendCapCount++] = &(nconf.capabilities[c]);
 		}
-		outp.append((uint8_t)0x00);
-
-		const unsigned int capCountAt = outp.size();
-		outp.addSize(2);
-		unsigned int thisPacketCapCount = 0;
-		while ((capPtr < sendCapCount)&&((outp.size() + sizeof(Capability) + 16) < ZT_PROTO_MAX_PACKET_LENGTH)) {
-			sendCaps[capPtr++]->serialize(outp);
-			++thisPacketCapCount;
+
+		const Tag *sendTags[ZT_MAX_NETWORK_TAGS];
+		unsigned int sendTagCount = 0;
+		for(unsigned int t=0;t<nconf.tagCount;++t) {
+			sendTags[sendTagCount++] = &(nconf.tags[t]);
 		}
-		outp.setAt(capCountAt,(uint16_t)thisPacketCapCount);
-
-		const unsigned int tagCountAt = outp.size();
-		outp.addSize(2);
-		unsigned int thisPacketTagCount = 0;
-		while ((tagPtr < sendTagCount)&&((outp.size() + sizeof(Tag) + 16) < ZT_PROTO_MAX_PACKET_LENGTH)) {
-			sendTags[tagPtr++]->serialize(outp);
-			++thisPacketTagCount;
+
+		const CertificateOfOwnership *sendCoos[ZT_MAX_CERTIFICATES_OF_OWNERSHIP];
+		unsigned int sendCooCount = 0;
+		for(unsigned int c=0;c<nconf.certificateOfOwnershipCount;++c) {
+			sendCoos[sendCooCount++] = &(nconf.certificatesOfOwnership[c]);
 		}
-		outp.setAt(tagCountAt,(uint16_t)thisPacketTagCount);
 
-		// No revocations, these propagate differently
-		outp.append((uint16_t)0);
+		unsigned int capPtr = 0;
+		unsigned int tagPtr = 0;
+		unsigned int cooPtr = 0;
+		bool sendCom = (bool)(nconf.com);
+		while ((capPtr < sendCapCount)||(tagPtr < sendTagCount)||(cooPtr < sendCooCount)||(sendCom)) {
+			Packet outp(peerAddress,RR->identity.address(),Packet::VERB_NETWORK_CREDENTIALS);
 
-		const unsigned int cooCountAt = outp.size();
-		outp.addSize(2);
-		unsigned int thisPacketCooCount = 0;
-		while ((cooPtr < sendCooCount)&&((outp.size() + sizeof(CertificateOfOwnership) + 16) < ZT_PROTO_MAX_PACKET_LENGTH)) {
-			sendCoos[cooPtr++]->serialize(outp);
-			++thisPacketCooCount;
+			if (sendCom) {
+				sendCom = false;
+				nconf.com.serialize(outp);
+			}
+			outp.append((uint8_t)0x00);
+
+			const unsigned int capCountAt = outp.size();
+			outp.addSize(2);
+			unsigned int thisPacketCapCount = 0;
+			while ((capPtr < sendCapCount)&&((outp.size() + sizeof(Capability) + 16) < ZT_PROTO_MAX_PACKET_LENGTH)) {
+				sendCaps[capPtr++]->serialize(outp);
+				++thisPacketCapCount;
+			}
+			outp.setAt(capCountAt,(uint16_t)thisPacketCapCount);
+
+			const unsigned int tagCountAt = outp.size();
+			outp.addSize(2);
+			unsigned int thisPacketTagCount = 0;
+			while ((tagPtr < sendTagCount)&&((outp.size() + sizeof(Tag) + 16) < ZT_PROTO_MAX_PACKET_LENGTH)) {
+				sendTags[tagPtr++]->serialize(outp);
+				++thisPacketTagCount;
+			}
+			outp.setAt(tagCountAt,(uint16_t)thisPacketTagCount);
+
+			// No revocations, these propagate differently
+			outp.append((uint16_t)0);
+
+			const unsigned int cooCountAt = outp.size();
+			outp.addSize(2);
+			unsigned int thisPacketCooCount = 0;
+			while ((cooPtr < sendCooCount)&&((outp.size() + sizeof(CertificateOfOwnership) + 16) < ZT_PROTO_MAX_PACKET_LENGTH)) {
+				sendCoos[cooPtr++]->serialize(outp);
+				++thisPacketCooCount;
+			}
+			outp.setAt(cooCountAt,(uint16_t)thisPacketCooCount);
+
+			cache.chunks.push_back(CredentialPushCache::Chunk());
+			CredentialPushCache::Chunk &chunk = cache.chunks.back();
+			chunk.compressed = outp.compress();
+			chunk.payload.append(reinterpret_cast<const uint8_t *>(outp.data()) + ZT_PACKET_IDX_PAYLOAD,outp.size() - ZT_PACKET_IDX_PAYLOAD);
 		}
-		outp.setAt(cooCountAt,(uint16_t)thisPacketCooCount);
 
-		outp.compress();
+		cache.configTimestamp = nconf.timestamp;
+	}
+
+	for(std::vector<CredentialPushCache::Chunk>::const_iterator c(cache.chunks.begin());c!=cache.chunks.end();++c) {
+		Packet outp(peerAddress,RR->identity.address(),Packet::VERB_NETWORK_CREDENTIALS);
+		outp.append(c->payload.data(),c->payload.size());
+		if (c->compressed) {
+			reinterpret_cast<uint8_t *>(outp.unsafeData())[ZT_PACKET_IDX_VERB] |= (uint8_t)ZT_PROTO_VERB_FLAG_COMPRESSED;
+		}
 		RR->sw->send(tPtr,outp,true);
 		Metrics::pkt_network_credentials_out++;
 	}
 
+	// Piggyback the multicast group key on the credential push: the key
+	// travels under the normal pairwise encryption and no extra round trip or
+	// timer is needed. Credentials themselves may be pushed to peers that have
+	// not yet proven membership (e.g. in response to NEED_MEMBERSHIP_CERTIFICATE),
+	// so the key is withheld until this peer's COM agrees with ours; holders of
+	// the key can decrypt our group-keyed multicast and forge cipher-suite-4
+	// packets as us, so possession must imply verified membership. Peers that
+	// never advertised support simply keep getting per-destination armoring.
+	if ((nconf.groupKeyedMulticastEnabled())&&(_pushedGroupKeyId != groupKeyId)) {
+		const SharedPtr<Peer> peer(RR->topology->getPeerNoCache(peerAddress));
+		if ((peer)&&(peer->remoteSupportsGroupKeys())&&(isAllowedOnNetwork(nconf,peer->identity()))) {
+			Packet outp(peerAddress,RR->identity.address(),Packet::VERB_GROUP_KEY);
+			outp.append((uint64_t)nconf.networkId);
+			outp.append((uint8_t)0); // flags, currently unused
+			outp.append(groupKeyId);
+			outp.append(groupKey,32);
+			RR->sw->send(tPtr,outp,true);
+			Metrics::pkt_group_key_out++;
+			_pushedGroupKeyId = groupKeyId;
+		}
+	}
+
 	_lastPushedCredentials = now;
+	_lastPushedCredentialsConfigTimestamp = nconf.timestamp;
 }
 
 Membership::AddCredentialResult Membership::addCredential(const RuntimeEnvironment *RR,void *tPtr,const NetworkConfig &nconf,const CertificateOfMembership &com)
@@ -172,9 +224,30 @@ static Membership::AddCredentialResult _addCredImpl(Hashtable<uint32_t,C> &remot
 	}
 }
 
-Membership::AddCredentialResult Membership::addCredential(const RuntimeEnvironment *RR,void *tPtr,const NetworkConfig &nconf,const Tag &tag) { return _addCredImpl<Tag>(_remoteTags,_revocations,RR,tPtr,nconf,tag); }
-Membership::AddCredentialResult Membership::addCredential(const RuntimeEnvironment *RR,void *tPtr,const NetworkConfig &nconf,const Capability &cap) { return _addCredImpl<Capability>(_remoteCaps,_revocations,RR,tPtr,nconf,cap); }
-Membership::AddCredentialResult Membership::addCredential(const RuntimeEnvironment *RR,void *tPtr,const NetworkConfig &nconf,const CertificateOfOwnership &coo) { return _addCredImpl<CertificateOfOwnership>(_remoteCoos,_revocations,RR,tPtr,nconf,coo); }
+Membership::AddCredentialResult Membership::addCredential(const RuntimeEnvironment *RR,void *tPtr,const NetworkConfig &nconf,const Tag &tag)
+{
+	const AddCredentialResult r = _addCredImpl<Tag>(_remoteTags,_revocations,RR,tPtr,nconf,tag);
+	if (r == ADD_ACCEPTED_NEW) {
+		_credTsLearned(tag.timestamp());
+	}
+	return r;
+}
+Membership::AddCredentialResult Membership::addCredential(const RuntimeEnvironment *RR,void *tPtr,const NetworkConfig &nconf,const Capability &cap)
+{
+	const AddCredentialResult r = _addCredImpl<Capability>(_remoteCaps,_revocations,RR,tPtr,nconf,cap);
+	if (r == ADD_ACCEPTED_NEW) {
+		_credTsLearned(cap.timestamp());
+	}
+	return r;
+}
+Membership::AddCredentialResult Membership::addCredential(const RuntimeEnvironment *RR,void *tPtr,const NetworkConfig &nconf,const CertificateOfOwnership &coo)
+{
+	const AddCredentialResult r = _addCredImpl<CertificateOfOwnership>(_remoteCoos,_revocations,RR,tPtr,nconf,coo);
+	if (r == ADD_ACCEPTED_NEW) {
+		_credTsLearned(coo.timestamp());
+	}
+	return r;
+}
 
 Membership::AddCredentialResult Membership::addCredential(const RuntimeEnvironment *RR,void *tPtr,const NetworkConfig &nconf,const Revocation &rev)
 {
@@ -196,9 +269,11 @@ Membership::AddCredentialResult Membership::addCredential(const RuntimeEnvironme
 				case Credential::CREDENTIAL_TYPE_TAG:
 				case Credential::CREDENTIAL_TYPE_COO:
 					rt = &(_revocations[credentialKey(ct,rev.credentialId())]);
+					_revocationBloom |= _revocationBloomBits(credentialKey(ct,rev.credentialId()));
 					if (*rt < rev.threshold()) {
 						*rt = rev.threshold();
 						_comRevocationThreshold = rev.threshold();
+						_credSweepNeeded = true; // a stored credential may now be revoked
 						return ADD_ACCEPTED_NEW;
 					}
 					return ADD_ACCEPTED_REDUNDANT;
@@ -214,9 +289,28 @@ Membership::AddCredentialResult Membership::addCredential(const RuntimeEnvironme
 
 void Membership::clean(const int64_t now,const NetworkConfig &nconf)
 {
+	// Sweeping every credential of every member on each periodic cleanup is
+	// O(total credentials). A stored credential only becomes invalid when the
+	// network config timestamp moves past its validity window or a revocation
+	// arrives, so members whose timestamp bounds are still comfortably inside
+	// the window (and with no new revocations) are skipped in O(1). A timer
+	// wheel keyed on absolute expiry times does not fit here: validity is
+	// relative to nconf.timestamp, so every config update would re-key every
+	// credential in the wheel.
+	if (!_credSweepNeeded) {
+		if ((_credMinTs == 0)||(
+		     (((_credMinTs >= nconf.timestamp) ? (_credMinTs - nconf.timestamp) : (nconf.timestamp - _credMinTs)) <= nconf.credentialTimeMaxDelta)&&
+		     (((_credMaxTs >= nconf.timestamp) ? (_credMaxTs - nconf.timestamp) : (nconf.timestamp - _credMaxTs)) <= nconf.credentialTimeMaxDelta) )) {
+			return;
+		}
+	}
+
+	_credMinTs = 0;
+	_credMaxTs = 0;
 	_cleanCredImpl<Tag>(nconf,_remoteTags);
 	_cleanCredImpl<Capability>(nconf,_remoteCaps);
 	_cleanCredImpl<CertificateOfOwnership>(nconf,_remoteCoos);
+	_credSweepNeeded = false;
 }
 
 } // namespace ZeroTier
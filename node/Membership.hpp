@@ -16,18 +16,27 @@
 
 #include <stdint.h>
 
+#include <vector>
+
 #include "Constants.hpp"
 #include "../include/ZeroTierOne.h"
 #include "Credential.hpp"
+#include "Buffer.hpp"
 #include "Hashtable.hpp"
 #include "CertificateOfMembership.hpp"
 #include "Capability.hpp"
 #include "Tag.hpp"
 #include "Revocation.hpp"
 #include "NetworkConfig.hpp"
+#include "Packet.hpp"
 
 #define ZT_MEMBERSHIP_CRED_ID_UNUSED 0xffffffffffffffffULL
 
+/**
+ * Maximum size of a Membership credential state blob as serialized for local cache
+ */
+#define ZT_MEMBERSHIP_MAX_SERIALIZED_STATE_SIZE 16384
+
 namespace ZeroTier {
 
 class RuntimeEnvironment;
@@ -53,6 +62,30 @@ public:
 
 	Membership();
 
+	/**
+	 * Cached wire form of this node's credential push
+	 *
+	 * The payload of the VERB_NETWORK_CREDENTIALS packets built by
+	 * pushCredentials() carries our own COM, capabilities, tags, and
+	 * certificates of ownership, split across packets and compressed the
+	 * same way regardless of the destination. The owning Network keeps one
+	 * of these and passes it in, so a config refresh on a large network
+	 * serializes and compresses the set once; every subsequent push is a
+	 * payload copy plus armoring.
+	 */
+	struct CredentialPushCache
+	{
+		CredentialPushCache() : configTimestamp(-1) {}
+		struct Chunk
+		{
+			Chunk() : compressed(false) {}
+			Buffer<ZT_PROTO_MAX_PACKET_LENGTH> payload;
+			bool compressed;
+		};
+		int64_t configTimestamp; // config timestamp the chunks were built from
+		std::vector<Chunk> chunks; // one entry per credential packet
+	};
+
 	/**
 	 * Send COM and other credentials to this peer
 	 *
@@ -61,10 +94,20 @@ public:
 	 * @param now Current time
 	 * @param peerAddress Address of member peer (the one that this Membership describes)
 	 * @param nconf My network config
+	 * @param cache Serialized credential packet cache shared by all members of this network
+	 * @param groupKeyId ID of this network's current multicast group key
+	 * @param groupKey 32-byte multicast group key (pushed alongside credentials if the network and peer support it)
+	 */
+	void pushCredentials(const RuntimeEnvironment *RR,void *tPtr,const int64_t now,const Address &peerAddress,const NetworkConfig &nconf,CredentialPushCache &cache,const uint64_t groupKeyId,const uint8_t groupKey[32]);
+
+	/**
+	 * @param id Group key ID to check
+	 * @return True if the given multicast group key has been pushed to this member
 	 */
-	void pushCredentials(const RuntimeEnvironment *RR,void *tPtr,const int64_t now,const Address &peerAddress,const NetworkConfig &nconf);
+	inline bool groupKeyPushed(const uint64_t id) const { return (_pushedGroupKeyId == id); }
 
 	inline int64_t lastPushedCredentials() { return _lastPushedCredentials; }
+	inline int64_t lastPushedCredentialsConfigTimestamp() { return _lastPushedCredentialsConfigTimestamp; }
 	inline int64_t comTimestamp() { return _com.timestamp(); }
 	inline int64_t comRevocationThreshold() { return _comRevocationThreshold; }
 
@@ -83,6 +126,11 @@ public:
 		return false;
 	}
 
+	/**
+	 * Mark this member as due for a multicast LIKE announcement on the next pass
+	 */
+	inline void resetMulticastLikeGate() { _lastUpdatedMulticast = 0; }
+
 	/**
 	 * Check whether the peer represented by this Membership should be allowed on this network at all
 	 *
@@ -92,7 +140,26 @@ public:
 	 */
 	inline bool isAllowedOnNetwork(const NetworkConfig &thisNodeNetworkConfig, const Identity &otherNodeIdentity) const
 	{
-		return thisNodeNetworkConfig.isPublic() || (((_com.timestamp() > _comRevocationThreshold) && (thisNodeNetworkConfig.com.agreesWith(_com, otherNodeIdentity))));
+		if (thisNodeNetworkConfig.isPublic()) {
+			return true;
+		}
+		if (_com.timestamp() <= _comRevocationThreshold) {
+			return false;
+		}
+		// Agreement depends only on the two COMs (and the peer's fixed
+		// identity), and any COM update changes its timestamp, so a pair of
+		// timestamps keys a one-entry result cache. Callers hold the
+		// network's exclusive lock, which makes the mutable fields safe.
+		const int64_t localComTs = thisNodeNetworkConfig.com.timestamp();
+		const int64_t remoteComTs = _com.timestamp();
+		if ((localComTs == _comAgreeLocalTs)&&(remoteComTs == _comAgreeRemoteTs)) {
+			return _comAgreeResult;
+		}
+		const bool agree = thisNodeNetworkConfig.com.agreesWith(_com, otherNodeIdentity);
+		_comAgreeResult = agree;
+		_comAgreeLocalTs = localComTs;
+		_comAgreeRemoteTs = remoteComTs;
+		return agree;
 	}
 
 	inline bool recentlyAssociated(const int64_t now) const
@@ -168,6 +235,98 @@ public:
 	 */
 	void clean(const int64_t now,const NetworkConfig &nconf);
 
+	/**
+	 * Serialize this member's credential state for storage in local cache
+	 *
+	 * This stores received credentials, revocations and push state, not
+	 * ephemeral gates like the multicast LIKE timer.
+	 */
+	template<unsigned int C>
+	inline void serializeForCache(Buffer<C> &b) const
+	{
+		b.append((uint8_t)1);
+
+		b.append((uint64_t)_comRevocationThreshold);
+		b.append((uint64_t)_lastPushedCredentials);
+		b.append((uint64_t)_lastPushedCredentialsConfigTimestamp);
+
+		_com.serialize(b);
+
+		{
+			b.append((uint16_t)_revocations.size());
+			uint64_t *k = (uint64_t *)0;
+			int64_t *v = (int64_t *)0;
+			Hashtable< uint64_t,int64_t >::Iterator i(*(const_cast< Hashtable< uint64_t,int64_t > *>(&_revocations)));
+			while (i.next(k,v)) {
+				b.append(*k);
+				b.append((uint64_t)*v);
+			}
+		}
+
+		_serializeCredsForCache(b,_remoteTags);
+		_serializeCredsForCache(b,_remoteCaps);
+		_serializeCredsForCache(b,_remoteCoos);
+	}
+
+	/**
+	 * Restore credential state saved by serializeForCache()
+	 *
+	 * Everything restored here was signature-checked when first received, and
+	 * every use re-checks timestamps and revocations against the current
+	 * network config, so a stale cache entry degrades to the same behavior as
+	 * an empty Membership rather than granting anything.
+	 *
+	 * @return True if the cached state was understood and restored
+	 */
+	template<unsigned int C>
+	inline bool deserializeFromCache(const Buffer<C> &b)
+	{
+		try {
+			unsigned int ptr = 0;
+			const uint8_t cacheVersion = b[ptr++];
+			if (cacheVersion != 1) {
+				return false;
+			}
+
+			_comRevocationThreshold = (int64_t)b.template at<uint64_t>(ptr);
+			ptr += 8;
+			_lastPushedCredentials = (int64_t)b.template at<uint64_t>(ptr);
+			ptr += 8;
+			_lastPushedCredentialsConfigTimestamp = (int64_t)b.template at<uint64_t>(ptr);
+			ptr += 8;
+
+			ptr += _com.deserialize(b,ptr);
+			if (_com) {
+				_credTsLearned(_com.timestamp());
+			}
+
+			const unsigned int revCount = b.template at<uint16_t>(ptr);
+			ptr += 2;
+			for(unsigned int i=0;i<revCount;++i) {
+				const uint64_t ck = b.template at<uint64_t>(ptr);
+				ptr += 8;
+				const int64_t rt = (int64_t)b.template at<uint64_t>(ptr);
+				ptr += 8;
+				_revocations.set(ck,rt);
+				_revocationBloom |= _revocationBloomBits(ck);
+			}
+
+			ptr = _deserializeCredsFromCache(b,ptr,_remoteTags);
+			ptr = _deserializeCredsFromCache(b,ptr,_remoteCaps);
+			ptr = _deserializeCredsFromCache(b,ptr,_remoteCoos);
+
+			_credSweepNeeded = true; // first clean() re-checks everything against the current config
+
+			return true;
+		} catch ( ... ) {
+			// An unreadable entry would otherwise leave a partially restored
+			// member, so fall back to the fresh state the caller would have
+			// had with no cache at all.
+			*this = Membership();
+			return false;
+		}
+	}
+
 	/**
 	 * Generates a key for the internal use in indexing credentials by type and credential ID
 	 */
@@ -220,12 +379,28 @@ private:
 	{
 		const int64_t ts = remoteCredential.timestamp();
 		if (((ts >= nconf.timestamp) ? (ts - nconf.timestamp) : (nconf.timestamp - ts)) <= nconf.credentialTimeMaxDelta) {
-			const int64_t *threshold = _revocations.get(credentialKey(C::credentialType(),remoteCredential.id()));
+			const uint64_t ck = credentialKey(C::credentialType(),remoteCredential.id());
+			const uint64_t bloomBits = _revocationBloomBits(ck);
+			if ((_revocationBloom & bloomBits) != bloomBits) {
+				return true; // no revocation has ever been recorded for this credential
+			}
+			const int64_t *threshold = _revocations.get(ck);
 			return ((!threshold)||(ts > *threshold));
 		}
 		return false;
 	}
 
+	// Two-bit Bloom signature of a revocation's credentialKey(). The common
+	// case is a member with no applicable revocations, which the filter
+	// resolves with one AND instead of a map probe; false positives just fall
+	// through to the exact lookup. Revocations are never removed from
+	// _revocations, so the filter never needs rebuilding.
+	static inline uint64_t _revocationBloomBits(const uint64_t ck)
+	{
+		const uint64_t h = ck * 0x9e3779b97f4a7c15ULL;
+		return (((uint64_t)1 << (h >> 58)) | ((uint64_t)1 << ((h >> 52) & 63)));
+	}
+
 	template<typename C>
 	inline void _cleanCredImpl(const NetworkConfig &nconf,Hashtable<uint32_t,C> &remoteCreds)
 	{
@@ -235,10 +410,49 @@ private:
 		while (i.next(k,v)) {
 			if (!_isCredentialTimestampValid(nconf,*v)) {
 				remoteCreds.erase(*k);
+			} else {
+				_credTsLearned(v->timestamp());
 			}
 		}
 	}
 
+	template<unsigned int C,typename CT>
+	static inline void _serializeCredsForCache(Buffer<C> &b,const Hashtable<uint32_t,CT> &remoteCreds)
+	{
+		b.append((uint16_t)remoteCreds.size());
+		uint32_t *k = (uint32_t *)0;
+		CT *v = (CT *)0;
+		typename Hashtable<uint32_t,CT>::Iterator i(*(const_cast< Hashtable<uint32_t,CT> *>(&remoteCreds)));
+		while (i.next(k,v)) {
+			v->serialize(b);
+		}
+	}
+
+	template<unsigned int C,typename CT>
+	inline unsigned int _deserializeCredsFromCache(const Buffer<C> &b,unsigned int ptr,Hashtable<uint32_t,CT> &remoteCreds)
+	{
+		const unsigned int credCount = b.template at<uint16_t>(ptr);
+		ptr += 2;
+		for(unsigned int i=0;i<credCount;++i) {
+			CT cred;
+			ptr += cred.deserialize(b,ptr);
+			remoteCreds.set(cred.id(),cred);
+			_credTsLearned(cred.timestamp());
+		}
+		return ptr;
+	}
+
+	// Fold a stored credential's timestamp into the expiry bounds clean() uses
+	inline void _credTsLearned(const int64_t ts)
+	{
+		if ((_credMinTs == 0)||(ts < _credMinTs)) {
+			_credMinTs = ts;
+		}
+		if (ts > _credMaxTs) {
+			_credMaxTs = ts;
+		}
+	}
+
 	// Last time we pushed MULTICAST_LIKE(s)
 	int64_t _lastUpdatedMulticast;
 
@@ -248,6 +462,30 @@ private:
 	// Time we last pushed credentials
 	int64_t _lastPushedCredentials;
 
+	// Timestamp of the network config whose credentials we last pushed. This
+	// is persisted with the credential cache so a restart only re-pushes when
+	// the config (and thus the credential set) has actually changed.
+	int64_t _lastPushedCredentialsConfigTimestamp;
+
+	// ID of the multicast group key last pushed to this member (0 == none)
+	uint64_t _pushedGroupKeyId;
+
+	// Inclusive bounds on the timestamps of stored remote credentials (0 if
+	// none) and a flag raised when a revocation arrives, so clean() can skip
+	// this member in O(1) when nothing can have expired
+	int64_t _credMinTs;
+	int64_t _credMaxTs;
+	bool _credSweepNeeded;
+
+	// One-entry COM agreement cache for isAllowedOnNetwork(), keyed on the
+	// timestamps of the local and remote COMs when last evaluated
+	mutable int64_t _comAgreeLocalTs;
+	mutable int64_t _comAgreeRemoteTs;
+	mutable bool _comAgreeResult;
+
+	// Bloom filter over the credentialKey()s present in _revocations
+	uint64_t _revocationBloom;
+
 	// Remote member's latest network COM
 	CertificateOfMembership _com;
 
@@ -13,6 +13,8 @@
 #include <prometheus/simpleapi.h>
 #include <prometheus/histogram.h>
 
+#include "Metrics.hpp"
+
 namespace prometheus {
     namespace simpleapi {
         std::shared_ptr<Registry> registry_ptr = std::make_shared<Registry>();
@@ -24,95 +26,106 @@ namespace prometheus {
 namespace ZeroTier {
     namespace Metrics {
         // Packet Type Counts
-        prometheus::simpleapi::counter_family_t packets
-        { "zt_packet", "ZeroTier packet type counts"};
+        ShardedCounter::Family &packets =
+        prometheus::Builder<ShardedCounter>()
+            .Name("zt_packet")
+            .Help("ZeroTier packet type counts")
+            .Register(prometheus::simpleapi::registry);
 
         // Incoming packets
-        prometheus::simpleapi::counter_metric_t pkt_nop_in
+        ShardedCounter &pkt_nop_in
         { packets.Add({{"packet_type", "nop"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_error_in
+        ShardedCounter &pkt_error_in
         { packets.Add({{"packet_type", "error"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_ack_in
+        ShardedCounter &pkt_ack_in
         { packets.Add({{"packet_type", "ack"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_qos_in
+        ShardedCounter &pkt_qos_in
         { packets.Add({{"packet_type", "qos"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_hello_in
+        ShardedCounter &pkt_hello_in
         { packets.Add({{"packet_type", "hello"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_ok_in
+        ShardedCounter &pkt_ok_in
         { packets.Add({{"packet_type", "ok"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_whois_in
+        ShardedCounter &pkt_whois_in
         { packets.Add({{"packet_type", "whois"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_rendezvous_in
+        ShardedCounter &pkt_rendezvous_in
         { packets.Add({{"packet_type", "rendezvous"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_frame_in
+        ShardedCounter &pkt_frame_in
         { packets.Add({{"packet_type", "frame"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_ext_frame_in
+        ShardedCounter &pkt_ext_frame_in
         { packets.Add({{"packet_type", "ext_frame"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_echo_in
+        ShardedCounter &pkt_frame_bundle_in
+        { packets.Add({{"packet_type", "frame_bundle"}, {"direction", "rx"}}) };
+        ShardedCounter &pkt_group_key_in
+        { packets.Add({{"packet_type", "group_key"}, {"direction", "rx"}}) };
+        ShardedCounter &pkt_echo_in
         { packets.Add({{"packet_type", "echo"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_multicast_like_in
+        ShardedCounter &pkt_multicast_like_in
         { packets.Add({{"packet_type", "multicast_like"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_network_credentials_in
+        ShardedCounter &pkt_network_credentials_in
         { packets.Add({{"packet_type", "network_credentials"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_network_config_request_in
+        ShardedCounter &pkt_network_config_request_in
         { packets.Add({{"packet_type", "network_config_request"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_network_config_in
+        ShardedCounter &pkt_network_config_in
         { packets.Add({{"packet_type", "network_config"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_multicast_gather_in
+        ShardedCounter &pkt_multicast_gather_in
         { packets.Add({{"packet_type", "multicast_gather"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_multicast_frame_in
+        ShardedCounter &pkt_multicast_frame_in
         { packets.Add({{"packet_type", "multicast_frame"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_push_direct_paths_in
+        ShardedCounter &pkt_push_direct_paths_in
         { packets.Add({{"packet_type", "push_direct_paths"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_user_message_in
+        ShardedCounter &pkt_user_message_in
         { packets.Add({{"packet_type", "user_message"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_remote_trace_in
+        ShardedCounter &pkt_remote_trace_in
         { packets.Add({{"packet_type", "remote_trace"}, {"direction", "rx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_path_negotiation_request_in
+        ShardedCounter &pkt_path_negotiation_request_in
         { packets.Add({{"packet_type", "path_negotiation_request"}, {"direction", "rx"}}) };
 
         // Outgoing packets
-        prometheus::simpleapi::counter_metric_t pkt_nop_out
+        ShardedCounter &pkt_nop_out
         { packets.Add({{"packet_type", "nop"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_error_out
+        ShardedCounter &pkt_error_out
         { packets.Add({{"packet_type", "error"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_ack_out
+        ShardedCounter &pkt_ack_out
         { packets.Add({{"packet_type", "ack"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_qos_out
+        ShardedCounter &pkt_qos_out
         { packets.Add({{"packet_type", "qos"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_hello_out
+        ShardedCounter &pkt_hello_out
         { packets.Add({{"packet_type", "hello"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_ok_out
+        ShardedCounter &pkt_ok_out
         { packets.Add({{"packet_type", "ok"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_whois_out
+        ShardedCounter &pkt_whois_out
         { packets.Add({{"packet_type", "whois"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_rendezvous_out
+        ShardedCounter &pkt_rendezvous_out
         { packets.Add({{"packet_type", "rendezvous"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_frame_out
+        ShardedCounter &pkt_frame_out
         { packets.Add({{"packet_type", "frame"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_ext_frame_out
+        ShardedCounter &pkt_ext_frame_out
         { packets.Add({{"packet_type", "ext_frame"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_echo_out
+        ShardedCounter &pkt_frame_bundle_out
+        { packets.Add({{"packet_type", "frame_bundle"}, {"direction", "tx"}}) };
+        ShardedCounter &pkt_group_key_out
+        { packets.Add({{"packet_type", "group_key"}, {"direction", "tx"}}) };
+        ShardedCounter &pkt_echo_out
         { packets.Add({{"packet_type", "echo"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_multicast_like_out
+        ShardedCounter &pkt_multicast_like_out
         { packets.Add({{"packet_type", "multicast_like"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_network_credentials_out
+        ShardedCounter &pkt_network_credentials_out
         { packets.Add({{"packet_type", "network_credentials"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_network_config_request_out
+        ShardedCounter &pkt_network_config_request_out
         { packets.Add({{"packet_type", "network_config_request"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_network_config_out
+        ShardedCounter &pkt_network_config_out
         { packets.Add({{"packet_type", "network_config"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_multicast_gather_out
+        ShardedCounter &pkt_multicast_gather_out
         { packets.Add({{"packet_type", "multicast_gather"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_multicast_frame_out
+        ShardedCounter &pkt_multicast_frame_out
         { packets.Add({{"packet_type", "multicast_frame"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_push_direct_paths_out
+        ShardedCounter &pkt_push_direct_paths_out
         { packets.Add({{"packet_type", "push_direct_paths"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_user_message_out
+        ShardedCounter &pkt_user_message_out
         { packets.Add({{"packet_type", "user_message"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_remote_trace_out
+        ShardedCounter &pkt_remote_trace_out
         { packets.Add({{"packet_type", "remote_trace"}, {"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t pkt_path_negotiation_request_out
+        ShardedCounter &pkt_path_negotiation_request_out
         { packets.Add({{"packet_type", "path_negotiation_request"}, {"direction", "tx"}}) };
 
 
@@ -157,17 +170,33 @@ namespace ZeroTier {
         { packet_errors.Add({{"error_type", "internal_server_error"}, {"direction", "tx"}}) };
 
         // Data Sent/Received Metrics
-        prometheus::simpleapi::counter_family_t data
-        { "zt_data", "number of bytes ZeroTier has transmitted or received" };
-        prometheus::simpleapi::counter_metric_t udp_recv
+        ShardedCounter::Family &data =
+        prometheus::Builder<ShardedCounter>()
+            .Name("zt_data")
+            .Help("number of bytes ZeroTier has transmitted or received")
+            .Register(prometheus::simpleapi::registry);
+        ShardedCounter &udp_recv
         { data.Add({{"protocol","udp"},{"direction","rx"}}) };
-        prometheus::simpleapi::counter_metric_t udp_send
+        ShardedCounter &udp_send
         { data.Add({{"protocol","udp"},{"direction","tx"}}) };
-        prometheus::simpleapi::counter_metric_t tcp_send
+        ShardedCounter &tcp_send
         { data.Add({{"protocol","tcp"},{"direction", "tx"}}) };
-        prometheus::simpleapi::counter_metric_t tcp_recv
+        ShardedCounter &tcp_recv
         { data.Add({{"protocol","tcp"},{"direction", "rx"}}) };
 
+        prometheus::simpleapi::counter_metric_t udp_egress_queued
+        { "zt_udp_egress_queued", "outbound UDP packets queued because the kernel send buffer was full" };
+        prometheus::simpleapi::counter_metric_t udp_egress_queue_drop
+        { "zt_udp_egress_queue_drop", "outbound UDP packets dropped because a socket's egress overflow queue was full" };
+
+        prometheus::simpleapi::counter_metric_t rx_policer_dropped
+        { "zt_rx_policer_dropped", "packets dropped by the per-source ingress policer" };
+
+        prometheus::simpleapi::counter_metric_t rx_queue_evicted
+        { "zt_rx_queue_evicted", "live RX queue entries evicted to make room for new packets" };
+        prometheus::simpleapi::counter_metric_t rx_reassembly_over_budget
+        { "zt_rx_reassembly_over_budget", "packets dropped because their source exceeded its reassembly byte budget" };
+
         // Network Metrics
         prometheus::simpleapi::gauge_metric_t network_num_joined
         { "zt_num_networks", "number of networks this instance is joined to" };
@@ -192,6 +221,37 @@ namespace ZeroTier {
         { "zt_peer_packet_errors" , "number of incoming packet errors from a peer" };
 #endif
 
+        // Datapath stage timing (sampled)
+        prometheus::simpleapi::gauge_metric_t tx_queue_lock_contended
+        { "zt_tx_queue_lock_contended_acquires", "cumulative contended acquisitions of the transmit queue lock" };
+        prometheus::simpleapi::gauge_metric_t peer_table_lock_contended
+        { "zt_peer_table_lock_contended_acquires", "cumulative contended acquisitions of the peer table shard locks" };
+
+        prometheus::CustomFamily<prometheus::Histogram<uint64_t>> &datapath_us =
+        prometheus::Builder<prometheus::Histogram<uint64_t>>()
+            .Name("zt_datapath_time_us")
+            .Help("sampled datapath stage time (microseconds)")
+            .Register(prometheus::simpleapi::registry);
+
+        static const std::vector<uint64_t> datapath_us_buckets{1,2,5,10,25,50,100,250,500,1000,2500,5000,10000,25000,50000,100000};
+        prometheus::Histogram<uint64_t> &rx_packet_us { datapath_us.Add({{"stage","rx_packet"}}, datapath_us_buckets) };
+        prometheus::Histogram<uint64_t> &rx_dearmor_us { datapath_us.Add({{"stage","dearmor"}}, datapath_us_buckets) };
+        prometheus::Histogram<uint64_t> &filter_us { datapath_us.Add({{"stage","filter"}}, datapath_us_buckets) };
+        prometheus::Histogram<uint64_t> &tap_write_us { datapath_us.Add({{"stage","tap_write"}}, datapath_us_buckets) };
+
+        prometheus::CustomFamily<prometheus::Histogram<uint64_t>> &event_loop_us =
+        prometheus::Builder<prometheus::Histogram<uint64_t>>()
+            .Name("zt_event_loop_time_us")
+            .Help("service event loop timing (microseconds)")
+            .Register(prometheus::simpleapi::registry);
+
+        static const std::vector<uint64_t> event_loop_us_buckets{50,100,250,500,1000,2500,5000,10000,25000,50000,100000,250000,500000,1000000,5000000};
+        prometheus::Histogram<uint64_t> &loop_iteration_us { event_loop_us.Add({{"stage","loop_iteration"}}, event_loop_us_buckets) };
+        prometheus::Histogram<uint64_t> &tick_overrun_us { event_loop_us.Add({{"stage","tick_overrun"}}, event_loop_us_buckets) };
+        prometheus::Histogram<uint64_t> &tick_us { event_loop_us.Add({{"stage","tick"}}, event_loop_us_buckets) };
+
+        std::atomic<uint32_t> SampledTimer::_sampleCtr(0);
+
         // General Controller Metrics
         prometheus::simpleapi::gauge_metric_t   network_count
         {"controller_network_count", "number of networks the controller is serving"};
@@ -217,8 +277,23 @@ namespace ZeroTier {
 
         prometheus::simpleapi::counter_metric_t network_config_request
         { "controller_network_config_request", "count of config requests handled" };
+        prometheus::simpleapi::counter_metric_t network_config_cache_hit
+        { "controller_network_config_cache_hit", "count of config requests served from the built-config cache" };
         prometheus::simpleapi::gauge_metric_t network_config_request_threads
         { "controller_network_config_request_threads", "number of active network config handling threads" };
+
+        prometheus::CustomFamily<prometheus::Histogram<uint64_t>> &controller_request_us =
+        prometheus::Builder<prometheus::Histogram<uint64_t>>()
+            .Name("controller_network_config_request_time_us")
+            .Help("config request pipeline phase time (microseconds)")
+            .Register(prometheus::simpleapi::registry);
+
+        static const std::vector<uint64_t> controller_request_us_buckets{10,25,50,100,250,500,1000,2500,5000,10000,25000,50000,100000,250000,500000,1000000,5000000};
+        prometheus::Histogram<uint64_t> &ctrl_request_queue_wait_us { controller_request_us.Add({{"phase","queue_wait"}}, controller_request_us_buckets) };
+        prometheus::Histogram<uint64_t> &ctrl_request_db_us { controller_request_us.Add({{"phase","db"}}, controller_request_us_buckets) };
+        prometheus::Histogram<uint64_t> &ctrl_request_build_us { controller_request_us.Add({{"phase","build"}}, controller_request_us_buckets) };
+        prometheus::Histogram<uint64_t> &ctrl_request_sign_us { controller_request_us.Add({{"phase","sign"}}, controller_request_us_buckets) };
+        prometheus::Histogram<uint64_t> &ctrl_request_total_us { controller_request_us.Add({{"phase","total"}}, controller_request_us_buckets) };
         prometheus::simpleapi::counter_metric_t db_get_network
         { "controller_db_get_network", "counter" };
         prometheus::simpleapi::counter_metric_t db_get_network_and_member
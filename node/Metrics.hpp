@@ -12,9 +12,25 @@
 #ifndef METRICS_H_
 #define METRICS_H_
 
+#include <atomic>
+#include <chrono>
+
 #include <prometheus/simpleapi.h>
 #include <prometheus/histogram.h>
 
+/**
+ * One in this many SampledTimer scopes is actually timed (must be a power of two)
+ */
+#define ZT_METRICS_TIMING_SAMPLE_EVERY 256
+
+/**
+ * Number of per-thread shards in a ShardedCounter (may be defined to 1 to
+ * trade the packet-path speedup back for memory on small targets)
+ */
+#ifndef ZT_METRICS_COUNTER_SHARDS
+#define ZT_METRICS_COUNTER_SHARDS 16
+#endif
+
 namespace prometheus {
     namespace simpleapi {
         extern std::shared_ptr<Registry> registry_ptr;
@@ -23,54 +39,116 @@ namespace prometheus {
 
 namespace ZeroTier {
     namespace Metrics {
+        /**
+         * Monotonic counter sharded across cache-line-padded slots
+         *
+         * Packet-path counters are bumped concurrently by the I/O thread and
+         * any RX workers, so a single atomic is a contended cache line at high
+         * packet rates. Each thread gets its own slot and increments are plain
+         * relaxed adds to thread-private cache lines; the slots are only
+         * summed when the registry is scraped. Drop-in for the counter types
+         * ext/prometheus-cpp-lite builds and registers.
+         */
+        class ShardedCounter : public prometheus::Metric
+        {
+        public:
+            using Value = uint64_t;
+            using Family = prometheus::CustomFamily<ShardedCounter>;
+            static const prometheus::Metric::Type static_type = prometheus::Metric::Type::Counter;
+
+            ShardedCounter() : prometheus::Metric(static_type) {}
+
+            inline void Increment(const uint64_t val = 1)
+            {
+                _shards[_shardIndex()].count.fetch_add(val,std::memory_order_relaxed);
+            }
+            inline ShardedCounter &operator++() { Increment(); return *this; }
+            inline ShardedCounter &operator++(int) { Increment(); return *this; }
+            inline ShardedCounter &operator+=(const uint64_t val) { Increment(val); return *this; }
+
+            inline uint64_t Get() const
+            {
+                uint64_t sum = 0;
+                for(unsigned int s=0;s<ZT_METRICS_COUNTER_SHARDS;++s) {
+                    sum += _shards[s].count.load(std::memory_order_relaxed);
+                }
+                return sum;
+            }
+
+            virtual prometheus::ClientMetric Collect() const
+            {
+                prometheus::ClientMetric metric;
+                metric.counter.value = static_cast<double>(Get());
+                return metric;
+            }
+
+        private:
+            struct alignas(64) _Shard
+            {
+                std::atomic<uint64_t> count{0};
+            };
+            _Shard _shards[ZT_METRICS_COUNTER_SHARDS];
+
+            static inline unsigned int _shardIndex()
+            {
+                static std::atomic<unsigned int> nextShard(0);
+                static thread_local const unsigned int idx = nextShard.fetch_add(1,std::memory_order_relaxed) % ZT_METRICS_COUNTER_SHARDS;
+                return idx;
+            }
+        };
+
         // Packet Type Counts
-        extern prometheus::simpleapi::counter_family_t packets;
+        extern ShardedCounter::Family &packets;
 
         // incoming packets
-        extern prometheus::simpleapi::counter_metric_t pkt_nop_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_error_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_ack_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_qos_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_hello_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_ok_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_whois_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_rendezvous_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_frame_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_ext_frame_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_echo_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_multicast_like_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_network_credentials_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_network_config_request_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_network_config_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_multicast_gather_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_multicast_frame_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_push_direct_paths_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_user_message_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_remote_trace_in;
-        extern prometheus::simpleapi::counter_metric_t pkt_path_negotiation_request_in;
+        extern ShardedCounter &pkt_nop_in;
+        extern ShardedCounter &pkt_error_in;
+        extern ShardedCounter &pkt_ack_in;
+        extern ShardedCounter &pkt_qos_in;
+        extern ShardedCounter &pkt_hello_in;
+        extern ShardedCounter &pkt_ok_in;
+        extern ShardedCounter &pkt_whois_in;
+        extern ShardedCounter &pkt_rendezvous_in;
+        extern ShardedCounter &pkt_frame_in;
+        extern ShardedCounter &pkt_ext_frame_in;
+        extern ShardedCounter &pkt_frame_bundle_in;
+        extern ShardedCounter &pkt_group_key_in;
+        extern ShardedCounter &pkt_echo_in;
+        extern ShardedCounter &pkt_multicast_like_in;
+        extern ShardedCounter &pkt_network_credentials_in;
+        extern ShardedCounter &pkt_network_config_request_in;
+        extern ShardedCounter &pkt_network_config_in;
+        extern ShardedCounter &pkt_multicast_gather_in;
+        extern ShardedCounter &pkt_multicast_frame_in;
+        extern ShardedCounter &pkt_push_direct_paths_in;
+        extern ShardedCounter &pkt_user_message_in;
+        extern ShardedCounter &pkt_remote_trace_in;
+        extern ShardedCounter &pkt_path_negotiation_request_in;
 
         // outgoing packets
-        extern prometheus::simpleapi::counter_metric_t pkt_nop_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_error_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_ack_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_qos_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_hello_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_ok_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_whois_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_rendezvous_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_frame_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_ext_frame_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_echo_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_multicast_like_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_network_credentials_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_network_config_request_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_network_config_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_multicast_gather_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_multicast_frame_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_push_direct_paths_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_user_message_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_remote_trace_out;
-        extern prometheus::simpleapi::counter_metric_t pkt_path_negotiation_request_out;
+        extern ShardedCounter &pkt_nop_out;
+        extern ShardedCounter &pkt_error_out;
+        extern ShardedCounter &pkt_ack_out;
+        extern ShardedCounter &pkt_qos_out;
+        extern ShardedCounter &pkt_hello_out;
+        extern ShardedCounter &pkt_ok_out;
+        extern ShardedCounter &pkt_whois_out;
+        extern ShardedCounter &pkt_rendezvous_out;
+        extern ShardedCounter &pkt_frame_out;
+        extern ShardedCounter &pkt_ext_frame_out;
+        extern ShardedCounter &pkt_frame_bundle_out;
+        extern ShardedCounter &pkt_group_key_out;
+        extern ShardedCounter &pkt_echo_out;
+        extern ShardedCounter &pkt_multicast_like_out;
+        extern ShardedCounter &pkt_network_credentials_out;
+        extern ShardedCounter &pkt_network_config_request_out;
+        extern ShardedCounter &pkt_network_config_out;
+        extern ShardedCounter &pkt_multicast_gather_out;
+        extern ShardedCounter &pkt_multicast_frame_out;
+        extern ShardedCounter &pkt_push_direct_paths_out;
+        extern ShardedCounter &pkt_user_message_out;
+        extern ShardedCounter &pkt_remote_trace_out;
+        extern ShardedCounter &pkt_path_negotiation_request_out;
 
         // Packet Error Counts
         extern prometheus::simpleapi::counter_family_t packet_errors;
@@ -96,11 +174,23 @@ namespace ZeroTier {
         extern prometheus::simpleapi::counter_metric_t pkt_error_internal_server_error_out;
 
         // Data Sent/Received Metrics
-        extern prometheus::simpleapi::counter_family_t data;
-        extern prometheus::simpleapi::counter_metric_t udp_send;
-        extern prometheus::simpleapi::counter_metric_t udp_recv;
-        extern prometheus::simpleapi::counter_metric_t tcp_send;
-        extern prometheus::simpleapi::counter_metric_t tcp_recv;
+        extern ShardedCounter::Family &data;
+        extern ShardedCounter &udp_send;
+        extern ShardedCounter &udp_recv;
+        extern ShardedCounter &tcp_send;
+        extern ShardedCounter &tcp_recv;
+        extern prometheus::simpleapi::counter_metric_t udp_egress_queued;
+        extern prometheus::simpleapi::counter_metric_t udp_egress_queue_drop;
+
+        // Packets dropped by the front-line per-source ingress policer
+        // before any decryption or MAC verification was attempted
+        extern prometheus::simpleapi::counter_metric_t rx_policer_dropped;
+
+        // RX queue / reassembly pressure: live entries evicted to make room
+        // for new packets, and packets dropped because their source exceeded
+        // its per-peer reassembly byte budget
+        extern prometheus::simpleapi::counter_metric_t rx_queue_evicted;
+        extern prometheus::simpleapi::counter_metric_t rx_reassembly_over_budget;
 
         // Network Metrics
         extern prometheus::simpleapi::gauge_metric_t   network_num_joined;
@@ -115,6 +205,81 @@ namespace ZeroTier {
         extern prometheus::simpleapi::counter_family_t peer_packet_errors;
 #endif
 
+        // Lock contention (cumulative contended-acquire counts, sampled
+        // periodically from the locks' own counters so the datapath never
+        // touches a shared metric atomically)
+        extern prometheus::simpleapi::gauge_metric_t   tx_queue_lock_contended;
+        extern prometheus::simpleapi::gauge_metric_t   peer_table_lock_contended;
+
+        // Datapath stage timing (sampled, microseconds)
+        extern prometheus::CustomFamily<prometheus::Histogram<uint64_t>> &datapath_us;
+        extern prometheus::Histogram<uint64_t> &rx_packet_us;
+        extern prometheus::Histogram<uint64_t> &rx_dearmor_us;
+        extern prometheus::Histogram<uint64_t> &filter_us;
+        extern prometheus::Histogram<uint64_t> &tap_write_us;
+
+        // Service event loop health: per-iteration work time (poll wait
+        // excluded), background tick lateness, and tick duration
+        extern prometheus::CustomFamily<prometheus::Histogram<uint64_t>> &event_loop_us;
+        extern prometheus::Histogram<uint64_t> &loop_iteration_us;
+        extern prometheus::Histogram<uint64_t> &tick_overrun_us;
+        extern prometheus::Histogram<uint64_t> &tick_us;
+
+        /**
+         * Scope timer for sampled datapath instrumentation
+         *
+         * One in every ZT_METRICS_TIMING_SAMPLE_EVERY constructions arms the
+         * timer, which then records the scope's duration in microseconds into
+         * the given histogram when it is destroyed. Unarmed constructions cost
+         * a single relaxed atomic increment, so this can stay on in production.
+         */
+        /**
+         * Scope timer that adds its elapsed microseconds to a caller-held
+         * accumulator instead of observing a histogram directly
+         *
+         * Useful when one logical phase of an operation is made of several
+         * disjoint spans (e.g. every signature call in a config build) that
+         * should land in the histogram as a single observation.
+         */
+        class PhaseAccumulator
+        {
+        public:
+            inline PhaseAccumulator(int64_t &us) :
+                _us(us),
+                _start(std::chrono::steady_clock::now())
+            {
+            }
+            inline ~PhaseAccumulator()
+            {
+                _us += (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _start).count();
+            }
+        private:
+            int64_t &_us;
+            const std::chrono::steady_clock::time_point _start;
+        };
+
+        class SampledTimer
+        {
+        public:
+            inline SampledTimer(prometheus::Histogram<uint64_t> &h) :
+                _hist(((_sampleCtr.fetch_add(1,std::memory_order_relaxed) & (ZT_METRICS_TIMING_SAMPLE_EVERY - 1)) == 0) ? &h : (prometheus::Histogram<uint64_t> *)0)
+            {
+                if (_hist) {
+                    _start = std::chrono::steady_clock::now();
+                }
+            }
+            inline ~SampledTimer()
+            {
+                if (_hist) {
+                    _hist->Observe((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _start).count());
+                }
+            }
+        private:
+            static std::atomic<uint32_t> _sampleCtr;
+            prometheus::Histogram<uint64_t> *_hist;
+            std::chrono::steady_clock::time_point _start;
+        };
+
         // General Controller Metrics
         extern prometheus::simpleapi::gauge_metric_t   network_count;
         extern prometheus::simpleapi::gauge_metric_t   member_count;
@@ -127,8 +292,21 @@ namespace ZeroTier {
         extern prometheus::simpleapi::counter_metric_t sso_expiration_checks;
         extern prometheus::simpleapi::counter_metric_t sso_member_deauth;
         extern prometheus::simpleapi::counter_metric_t network_config_request;
+        extern prometheus::simpleapi::counter_metric_t network_config_cache_hit;
         extern prometheus::simpleapi::gauge_metric_t network_config_request_threads;
 
+        // Config request pipeline phase timing (microseconds): time spent
+        // queued, reading the DB, assembling the config, and signing
+        // credentials, plus end to end. Together with the queue depth gauge
+        // above this shows saturation building during reconnect storms
+        // instead of leaving it to be diagnosed after the fact.
+        extern prometheus::CustomFamily<prometheus::Histogram<uint64_t>> &controller_request_us;
+        extern prometheus::Histogram<uint64_t> &ctrl_request_queue_wait_us;
+        extern prometheus::Histogram<uint64_t> &ctrl_request_db_us;
+        extern prometheus::Histogram<uint64_t> &ctrl_request_build_us;
+        extern prometheus::Histogram<uint64_t> &ctrl_request_sign_us;
+        extern prometheus::Histogram<uint64_t> &ctrl_request_total_us;
+
         extern prometheus::simpleapi::counter_metric_t db_get_network;
         extern prometheus::simpleapi::counter_metric_t db_get_network_and_member;
         extern prometheus::simpleapi::counter_metric_t db_get_network_and_member_and_summary;
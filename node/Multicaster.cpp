@@ -29,7 +29,7 @@ namespace ZeroTier {
 
 Multicaster::Multicaster(const RuntimeEnvironment *renv) :
 	RR(renv),
-	_groups(32)
+	_groups(ZT_MULTICASTER_GROUPS_INITIAL_CAPACITY)
 {
 }
 
@@ -49,6 +49,14 @@ void Multicaster::addMultiple(void *tPtr,int64_t now,uint64_t nwid,const Multica
 	}
 }
 
+void Multicaster::likeMultiple(void *tPtr,int64_t now,const std::pair<uint64_t,MulticastGroup> *groups,unsigned int count,const Address &member)
+{
+	Mutex::Lock _l(_groups_m);
+	for(unsigned int i=0;i<count;++i) {
+		_add(tPtr,now,groups[i].first,groups[i].second,_groups[Multicaster::Key(groups[i].first,groups[i].second)],member);
+	}
+}
+
 void Multicaster::remove(uint64_t nwid,const MulticastGroup &mg,const Address &member)
 {
 	Mutex::Lock _l(_groups_m);
@@ -57,6 +65,7 @@ void Multicaster::remove(uint64_t nwid,const MulticastGroup &mg,const Address &m
 		for(std::vector<MulticastGroupMember>::iterator m(s->members.begin());m!=s->members.end();++m) {
 			if (m->address == member) {
 				s->members.erase(m);
+				s->packedDirty = true;
 				break;
 			}
 		}
@@ -65,9 +74,7 @@ void Multicaster::remove(uint64_t nwid,const MulticastGroup &mg,const Address &m
 
 unsigned int Multicaster::gather(const Address &queryingPeer,uint64_t nwid,const MulticastGroup &mg,Buffer<ZT_PROTO_MAX_PACKET_LENGTH> &appendTo,unsigned int limit) const
 {
-	unsigned char *p;
-	unsigned int added = 0,i,k,rptr,totalKnown = 0;
-	uint64_t a,picked[(ZT_PROTO_MAX_PACKET_LENGTH / 5) + 2];
+	unsigned int added = 0,totalKnown = 0;
 
 	if (!limit) {
 		return 0;
@@ -93,33 +100,40 @@ unsigned int Multicaster::gather(const Address &queryingPeer,uint64_t nwid,const
 
 	const MulticastGroupStatus *s = _groups.get(Multicaster::Key(nwid,mg));
 	if ((s)&&(!s->members.empty())) {
-		totalKnown += (unsigned int)s->members.size();
-
-		// Members are returned in random order so that repeated gather queries
-		// will return different subsets of a large multicast group.
-		k = 0;
-		while ((added < limit)&&(k < s->members.size())&&((appendTo.size() + ZT_ADDRESS_LENGTH) <= ZT_PROTO_MAX_PACKET_LENGTH)) {
-			rptr = (unsigned int)RR->node->prng();
-
-restart_member_scan:
-			a = s->members[rptr % (unsigned int)s->members.size()].address.toInt();
-			for(i=0;i<k;++i) {
-				if (picked[i] == a) {
-					++rptr;
-					goto restart_member_scan;
-				}
+		const unsigned int memberCount = (unsigned int)s->members.size();
+		totalKnown += memberCount;
+
+		// Regenerate the cached wire-format member blob if membership changed
+		// since it was last used. Gathers of a popular group overwhelmingly
+		// hit the cache and reduce to a byte copy below.
+		if (s->packedDirty) {
+			s->packedMembers.resize((size_t)memberCount * ZT_ADDRESS_LENGTH);
+			uint8_t *pp = s->packedMembers.data();
+			for(unsigned int m=0;m<memberCount;++m,pp+=ZT_ADDRESS_LENGTH) {
+				s->members[m].address.copyTo(pp,ZT_ADDRESS_LENGTH);
 			}
-			picked[k++] = a;
-
-			if (queryingPeer.toInt() != a) { // do not return the peer that is making the request as a result
-				p = (unsigned char *)appendTo.appendField(ZT_ADDRESS_LENGTH);
-				*(p++) = (unsigned char)((a >> 32) & 0xff);
-				*(p++) = (unsigned char)((a >> 24) & 0xff);
-				*(p++) = (unsigned char)((a >> 16) & 0xff);
-				*(p++) = (unsigned char)((a >> 8) & 0xff);
-				*p = (unsigned char)(a & 0xff);
+			s->packedDirty = false;
+		}
+
+		// Members are returned as a contiguous (wrapping) window starting at a
+		// random offset, so repeated gather queries still see different
+		// subsets of a large multicast group without any per-query shuffling
+		// or duplicate tracking.
+		uint8_t queryingPeerWire[ZT_ADDRESS_LENGTH];
+		queryingPeer.copyTo(queryingPeerWire,ZT_ADDRESS_LENGTH);
+		unsigned int idx = (unsigned int)(RR->node->prng() % (uint64_t)memberCount);
+		for(unsigned int m=0;m<memberCount;++m) {
+			if ((added >= limit)||((appendTo.size() + ZT_ADDRESS_LENGTH) > ZT_PROTO_MAX_PACKET_LENGTH)) {
+				break;
+			}
+			const uint8_t *const e = s->packedMembers.data() + ((size_t)idx * ZT_ADDRESS_LENGTH);
+			if (memcmp(e,queryingPeerWire,ZT_ADDRESS_LENGTH) != 0) { // do not return the peer that is making the request as a result
+				appendTo.append(e,ZT_ADDRESS_LENGTH);
 				++added;
 			}
+			if (++idx == memberCount) {
+				idx = 0;
+			}
 		}
 	}
 
@@ -208,6 +222,13 @@ void Multicaster::send(
 		}
 	}
 
+	// For groups already at or above the member limit the frame is prepared and
+	// destinations are collected under _groups_m, but the actual fan-out loop
+	// runs after the lock is dropped so a big replication burst doesn't stall
+	// other threads touching the multicaster.
+	OutboundMulticast burstOut;
+	std::vector<Address> burstDests;
+
 	try {
 		Mutex::Lock _l(_groups_m);
 		MulticastGroupStatus &gs = _groups[Multicaster::Key(network->id(),mg)];
@@ -236,9 +257,7 @@ void Multicaster::send(
 
 		if (gs.members.size() >= limit) {
 			// Skip queue if we already have enough members to complete the send operation
-			OutboundMulticast out;
-
-			out.init(
+			burstOut.init(
 				RR,
 				now,
 				network->id(),
@@ -252,10 +271,11 @@ void Multicaster::send(
 				len);
 
 			unsigned int count = 0;
+			burstDests.reserve(limit);
 
 			for(unsigned int i=0;i<activeBridgeCount;++i) {
 				if ((activeBridges[i] != RR->identity.address())&&(activeBridges[i] != origin)) {
-					out.sendOnly(RR,tPtr,activeBridges[i]); // optimization: don't use dedup log if it's a one-pass send
+					burstDests.push_back(activeBridges[i]);
 					if (++count >= limit) {
 						break;
 					}
@@ -266,7 +286,7 @@ void Multicaster::send(
 			while ((count < limit)&&(idx < gs.members.size())) {
 				const Address ma(gs.members[indexes[idx++]].address);
 				if ((std::find(activeBridges,activeBridges + activeBridgeCount,ma) == (activeBridges + activeBridgeCount))&&(ma != origin)) {
-					out.sendOnly(RR,tPtr,ma); // optimization: don't use dedup log if it's a one-pass send
+					burstDests.push_back(ma);
 					++count;
 				}
 			}
@@ -363,7 +383,7 @@ void Multicaster::send(
 
 			for(unsigned int i=0;i<activeBridgeCount;++i) {
 				if (activeBridges[i] != RR->identity.address()) {
-					out.sendAndLog(RR,tPtr,activeBridges[i]);
+					out.sendAndLog(RR,tPtr,network,activeBridges[i]);
 					if (++count >= limit) {
 						break;
 					}
@@ -374,7 +394,7 @@ void Multicaster::send(
 			while ((count < limit)&&(idx < gs.members.size())) {
 				Address ma(gs.members[indexes[idx++]].address);
 				if (std::find(activeBridges,activeBridges + activeBridgeCount,ma) == (activeBridges + activeBridgeCount)) {
-					out.sendAndLog(RR,tPtr,ma);
+					out.sendAndLog(RR,tPtr,network,ma);
 					++count;
 				}
 			}
@@ -385,6 +405,14 @@ void Multicaster::send(
 	if (indexes != idxbuf) {
 		delete [] indexes;
 	}
+
+	// Replicate to collected destinations outside the lock. The network is
+	// passed through so the per-destination path doesn't re-resolve it;
+	// compression was already done once in init(). Per-destination armoring
+	// remains since every peer pair has its own symmetric key.
+	for(std::vector<Address>::const_iterator d(burstDests.begin());d!=burstDests.end();++d) {
+		burstOut.sendOnly(RR,tPtr,network,*d); // optimization: don't use dedup log if it's a one-pass send
+	}
 }
 
 void Multicaster::clean(int64_t now)
@@ -392,7 +420,7 @@ void Multicaster::clean(int64_t now)
 	Mutex::Lock _l(_groups_m);
 	Multicaster::Key *k = (Multicaster::Key *)0;
 	MulticastGroupStatus *s = (MulticastGroupStatus *)0;
-	Hashtable<Multicaster::Key,MulticastGroupStatus>::Iterator mm(_groups);
+	FlatHashtable<Multicaster::Key,MulticastGroupStatus>::Iterator mm(_groups);
 	while (mm.next(k,s)) {
 		for(std::list<OutboundMulticast>::iterator tx(s->txQueue.begin());tx!=s->txQueue.end();) {
 			if ((tx->expired(now))||(tx->atLimit())) {
@@ -416,6 +444,9 @@ void Multicaster::clean(int64_t now)
 			}
 		}
 
+		if (count != (unsigned long)s->members.size()) {
+			s->packedDirty = true;
+		}
 		if (count) {
 			s->members.resize(count);
 		} else if (s->txQueue.empty()) {
@@ -445,6 +476,7 @@ void Multicaster::_add(void *tPtr,int64_t now,uint64_t nwid,const MulticastGroup
 	} else {
 		gs.members.push_back(MulticastGroupMember(member,now));
 	}
+	gs.packedDirty = true;
 
 	for(std::list<OutboundMulticast>::iterator tx(gs.txQueue.begin());tx!=gs.txQueue.end();) {
 		if (tx->atLimit()) {
@@ -23,6 +23,7 @@
 
 #include "Constants.hpp"
 #include "Hashtable.hpp"
+#include "FlatHashtable.hpp"
 #include "Address.hpp"
 #include "MAC.hpp"
 #include "MulticastGroup.hpp"
@@ -76,6 +77,20 @@ public:
 	 */
 	void addMultiple(void *tPtr,int64_t now,uint64_t nwid,const MulticastGroup &mg,const void *addresses,unsigned int count,unsigned int totalKnown);
 
+	/**
+	 * Add one member to multiple multicast groups under a single lock acquisition
+	 *
+	 * This is the receive side of a MULTICAST_LIKE packet, which packs many
+	 * (network ID, multicast group) tuples for one peer.
+	 *
+	 * @param tPtr Thread pointer to be handed through to any callbacks called as a result of this call
+	 * @param now Current time
+	 * @param groups Array of (network ID, multicast group) pairs
+	 * @param count Number of pairs
+	 * @param member Member address to add to each group
+	 */
+	void likeMultiple(void *tPtr,int64_t now,const std::pair<uint64_t,MulticastGroup> *groups,unsigned int count,const Address &member);
+
 	/**
 	 * Remove a multicast group member (if present)
 	 *
@@ -177,18 +192,25 @@ private:
 
 	struct MulticastGroupStatus
 	{
-		MulticastGroupStatus() : lastExplicitGather(0) {}
+		MulticastGroupStatus() : lastExplicitGather(0),packedDirty(true) {}
 
 		int64_t lastExplicitGather;
 		std::list<OutboundMulticast> txQueue; // pending outbound multicasts
 		std::vector<MulticastGroupMember> members; // members of this group
+
+		// Cached wire-format (5 bytes per address) copy of members for
+		// MULTICAST_GATHER replies, regenerated only when membership changes.
+		// Mutable because gather() is const and rebuilds it lazily; both are
+		// only touched with _groups_m held.
+		mutable std::vector<uint8_t> packedMembers;
+		mutable bool packedDirty;
 	};
 
 	void _add(void *tPtr,int64_t now,uint64_t nwid,const MulticastGroup &mg,MulticastGroupStatus &gs,const Address &member);
 
 	const RuntimeEnvironment *const RR;
 
-	Hashtable<Multicaster::Key,MulticastGroupStatus> _groups;
+	FlatHashtable<Multicaster::Key,MulticastGroupStatus> _groups;
 	Mutex _groups_m;
 };
 
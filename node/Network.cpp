@@ -32,6 +32,7 @@
 #include "Node.hpp"
 #include "Peer.hpp"
 #include "Trace.hpp"
+#include "Topology.hpp"
 #include "Metrics.hpp"
 
 #include <set>
@@ -71,6 +72,26 @@ static inline bool _ipv6GetPayload(const uint8_t *frameData,unsigned int frameLe
 	return false; // overflow == invalid
 }
 
+// Returns true if no rule in this set can yield a different verdict for two packets
+// belonging to the same flow (as identified by MACs, ZT addresses, ethertype, and
+// the IP 5-tuple), making verdicts for these rules safe to memoize per flow
+static bool _rulesAreFlowCacheable(const ZT_VirtualNetworkRule *rules,const unsigned int ruleCount)
+{
+	for(unsigned int rn=0;rn<ruleCount;++rn) {
+		switch((ZT_VirtualNetworkRuleType)(rules[rn].t & 0x3f)) {
+			case ZT_NETWORK_RULE_MATCH_IP_TOS:
+			case ZT_NETWORK_RULE_MATCH_ICMP:
+			case ZT_NETWORK_RULE_MATCH_CHARACTERISTICS:
+			case ZT_NETWORK_RULE_MATCH_FRAME_SIZE_RANGE:
+			case ZT_NETWORK_RULE_MATCH_RANDOM:
+				return false;
+			default:
+				break;
+		}
+	}
+	return true;
+}
+
 enum _doZtFilterResult
 {
 	DOZTFILTER_NO_MATCH,
@@ -96,11 +117,15 @@ static _doZtFilterResult _doZtFilter(
 	const unsigned int vlanId,
 	const ZT_VirtualNetworkRule *rules, // cannot be NULL
 	const unsigned int ruleCount,
+	const uint16_t *ruleResume, // jump-threading table compiled from the rules, or NULL to evaluate every entry
+
 	Address &cc, // MUTABLE -- set to TEE destination if TEE action is taken or left alone otherwise
 	unsigned int &ccLength, // MUTABLE -- set to length of packet payload to TEE
 	bool &ccWatch, // MUTABLE -- set to true for WATCH target as opposed to normal TEE
 	uint8_t &qosBucket) // MUTABLE -- set to the value of the argument provided to PRIORITY
 {
+	Metrics::SampledTimer _st(Metrics::filter_us);
+
 	// Set to true if we are a TEE/REDIRECT/WATCH target
 	bool superAccept = false;
 
@@ -185,6 +210,18 @@ static _doZtFilterResult _doZtFilter(
 		// Circuit breaker: no need to evaluate an AND if the set's match state
 		// is currently false since anything AND false is false.
 		if ((!thisSetMatches)&&(!(rules[rn].t & 0x40))) {
+			if (ruleResume) {
+				// Hop straight over the rest of this doomed run of AND matches
+				// to the next entry that can still change the outcome.
+				const unsigned int resumeAt = ruleResume[rn];
+				if ((resumeAt > rn)&&(resumeAt <= ruleCount)) {
+					for(unsigned int skip=rn;skip<resumeAt;++skip) {
+						rrl.logSkipped(skip,thisSetMatches);
+					}
+					rn = resumeAt - 1;
+					continue;
+				}
+			}
 			rrl.logSkipped(rn,thisSetMatches);
 			continue;
 		}
@@ -565,6 +602,9 @@ Network::Network(const RuntimeEnvironment *renv,void *tPtr,uint64_t nwid,void *u
 	_mac(renv->identity.address(),nwid),
 	_portInitialized(false),
 	_lastConfigUpdate(0),
+	_credentialPushWindowStart(0),
+	_credentialPushesInWindow(0),
+	_flowCacheEnabled(false),
 	_destroyed(false),
 	_netconfFailure(NETCONF_FAILURE_NONE),
 	_portError(0),
@@ -578,6 +618,9 @@ Network::Network(const RuntimeEnvironment *renv,void *tPtr,uint64_t nwid,void *u
 		_incomingConfigChunks[i].ts = 0;
 	}
 
+	Utils::getSecureRandom(&_multicastGroupKeyId,sizeof(_multicastGroupKeyId));
+	Utils::getSecureRandom(_multicastGroupKey,sizeof(_multicastGroupKey));
+
 	if (nconf) {
 		this->setConfiguration(tPtr,*nconf,false);
 		_lastConfigUpdate = 0; // still want to re-request since it's likely outdated
@@ -654,11 +697,79 @@ bool Network::filterOutgoingPacket(
 	unsigned int ccLength = 0;
 	bool ccWatch = false;
 
-	Mutex::Lock _l(_lock);
+	RWMutex::RLock _l(_lock);
+
+	// Fast path: most traffic is long-lived flows whose verdict never changes, so
+	// check the per-flow verdict cache before walking the rule set. Only pure
+	// ACCEPT/DROP verdicts are cached (no TEE, WATCH, or REDIRECT, which must send
+	// something per packet) and only when the rule set contains no matches that can
+	// vary from packet to packet within a flow. Remote tracing wants the full
+	// per-rule log, so it bypasses the cache entirely.
+	_FlowCacheKey flowKey;
+	bool flowCacheable = ((_flowCacheEnabled)&&(!_config.remoteTraceTarget));
+	bool flowTee = false;
+	if (flowCacheable) {
+		flowKey.macSource = macSource.toInt();
+		flowKey.macDest = macDest.toInt();
+		flowKey.ztSource = ztSource.toInt();
+		flowKey.ztDest = ztDest.toInt();
+		flowKey.etherType = (uint32_t)etherType;
+		flowKey.vlanId = (uint32_t)vlanId;
+		flowKey.noTee = (noTee) ? 1 : 0;
+		if (etherType == ZT_ETHERTYPE_IPV4) {
+			if ((frameLen >= 20)&&(((frameData[6] & 0x3f) == 0)&&(frameData[7] == 0))) { // don't cache fragments, which may lack ports
+				memcpy(flowKey.ipSrc,frameData + 12,4);
+				memcpy(flowKey.ipDest,frameData + 16,4);
+				flowKey.proto = frameData[9];
+				if ((flowKey.proto == 0x06)||(flowKey.proto == 0x11)) { // TCP, UDP
+					const unsigned int headerLen = 4 * (frameData[0] & 0xf);
+					if (frameLen >= (headerLen + 4)) {
+						flowKey.sport = (uint16_t)((((unsigned int)frameData[headerLen]) << 8) | (unsigned int)frameData[headerLen + 1]);
+						flowKey.dport = (uint16_t)((((unsigned int)frameData[headerLen + 2]) << 8) | (unsigned int)frameData[headerLen + 3]);
+					} else {
+						flowCacheable = false;
+					}
+				}
+			} else {
+				flowCacheable = false;
+			}
+		} else if (etherType == ZT_ETHERTYPE_IPV6) {
+			unsigned int pos = 0,proto = 0;
+			if (_ipv6GetPayload(frameData,frameLen,pos,proto)) {
+				memcpy(flowKey.ipSrc,frameData + 8,16);
+				memcpy(flowKey.ipDest,frameData + 24,16);
+				flowKey.proto = (uint8_t)proto;
+				if ((proto == 0x06)||(proto == 0x11)) { // TCP, UDP
+					if (frameLen >= (pos + 4)) {
+						flowKey.sport = (uint16_t)((((unsigned int)frameData[pos]) << 8) | (unsigned int)frameData[pos + 1]);
+						flowKey.dport = (uint16_t)((((unsigned int)frameData[pos + 2]) << 8) | (unsigned int)frameData[pos + 3]);
+					} else {
+						flowCacheable = false;
+					}
+				}
+			} else {
+				flowCacheable = false;
+			}
+		}
+		if (flowCacheable) {
+			Mutex::Lock _fcl(_flowCache_m);
+			const _FlowCacheEntry *const cached = _outgoingFlowCache.get(flowKey);
+			if (cached) {
+				qosBucket = cached->qosBucket;
+				if (cached->accept) {
+					_outgoing_packets_accepted++;
+					return true;
+				} else {
+					_outgoing_packets_dropped++;
+					return false;
+				}
+			}
+		}
+	}
 
 	Membership *const membership = (ztDest) ? _memberships.get(ztDest) : (Membership *)0;
 
-	switch(_doZtFilter(RR,rrl,_config,membership,false,ztSource,ztFinalDest,macSource,macDest,frameData,frameLen,etherType,vlanId,_config.rules,_config.ruleCount,cc,ccLength,ccWatch,qosBucket)) {
+	switch(_doZtFilter(RR,rrl,_config,membership,false,ztSource,ztFinalDest,macSource,macDest,frameData,frameLen,etherType,vlanId,_config.rules,_config.ruleCount,_config.ruleResume,cc,ccLength,ccWatch,qosBucket)) {
 
 		case DOZTFILTER_NO_MATCH: {
 			for(unsigned int c=0;c<_config.capabilityCount;++c) {
@@ -666,7 +777,7 @@ bool Network::filterOutgoingPacket(
 				Address cc2;
 				unsigned int ccLength2 = 0;
 				bool ccWatch2 = false;
-				switch (_doZtFilter(RR,crrl,_config,membership,false,ztSource,ztFinalDest,macSource,macDest,frameData,frameLen,etherType,vlanId,_config.capabilities[c].rules(),_config.capabilities[c].ruleCount(),cc2,ccLength2,ccWatch2,qosBucket)) {
+				switch (_doZtFilter(RR,crrl,_config,membership,false,ztSource,ztFinalDest,macSource,macDest,frameData,frameLen,etherType,vlanId,_config.capabilities[c].rules(),_config.capabilities[c].ruleCount(),(const uint16_t *)0,cc2,ccLength2,ccWatch2,qosBucket)) {
 					case DOZTFILTER_NO_MATCH:
 					case DOZTFILTER_DROP: // explicit DROP in a capability just terminates its evaluation and is an anti-pattern
 						break;
@@ -678,6 +789,7 @@ bool Network::filterOutgoingPacket(
 						accept = 1;
 
 						if ((!noTee)&&(cc2)) {
+							flowTee = true;
 							Packet outp(cc2,RR->identity.address(),Packet::VERB_EXT_FRAME);
 							outp.append(_id);
 							outp.append((uint8_t)(ccWatch2 ? 0x16 : 0x02));
@@ -701,6 +813,9 @@ bool Network::filterOutgoingPacket(
 			if (_config.remoteTraceTarget) {
 				RR->t->networkFilter(tPtr,*this,rrl,(Trace::RuleResultLog *)0,(Capability *)0,ztSource,ztDest,macSource,macDest,frameData,frameLen,etherType,vlanId,noTee,false,0);
 			}
+			if (flowCacheable) {
+				_flowCacheStore(flowKey,false,qosBucket);
+			}
 			return false;
 
 		case DOZTFILTER_REDIRECT: // interpreted as ACCEPT but ztFinalDest will have been changed in _doZtFilter()
@@ -716,6 +831,7 @@ bool Network::filterOutgoingPacket(
 	if (accept) {
 		_outgoing_packets_accepted++;
 		if ((!noTee)&&(cc)) {
+			flowTee = true;
 			Packet outp(cc,RR->identity.address(),Packet::VERB_EXT_FRAME);
 			outp.append(_id);
 			outp.append((uint8_t)(ccWatch ? 0x16 : 0x02));
@@ -746,6 +862,9 @@ bool Network::filterOutgoingPacket(
 			if (_config.remoteTraceTarget) {
 				RR->t->networkFilter(tPtr,*this,rrl,(localCapabilityIndex >= 0) ? &crrl : (Trace::RuleResultLog *)0,(localCapabilityIndex >= 0) ? &(_config.capabilities[localCapabilityIndex]) : (Capability *)0,ztSource,ztDest,macSource,macDest,frameData,frameLen,etherType,vlanId,noTee,false,1);
 			}
+			if ((flowCacheable)&&(!flowTee)) {
+				_flowCacheStore(flowKey,true,qosBucket);
+			}
 			return true;
 		}
 	} else {
@@ -753,6 +872,9 @@ bool Network::filterOutgoingPacket(
 		if (_config.remoteTraceTarget) {
 			RR->t->networkFilter(tPtr,*this,rrl,(localCapabilityIndex >= 0) ? &crrl : (Trace::RuleResultLog *)0,(localCapabilityIndex >= 0) ? &(_config.capabilities[localCapabilityIndex]) : (Capability *)0,ztSource,ztDest,macSource,macDest,frameData,frameLen,etherType,vlanId,noTee,false,0);
 		}
+		if (flowCacheable) {
+			_flowCacheStore(flowKey,false,qosBucket);
+		}
 		return false;
 	}
 }
@@ -778,45 +900,51 @@ int Network::filterIncomingPacket(
 
 	uint8_t qosBucket = 255; // For incoming packets this is a dummy value
 
-	Mutex::Lock _l(_lock);
+	RWMutex::RLock _l(_lock);
 
-	Membership &membership = _membership(sourcePeer->address());
+	// Look up but never create the membership here: the shared lock permits
+	// concurrent filter threads, and a missing membership filters identically
+	// to an empty one. Credential handling creates memberships under the
+	// exclusive lock.
+	Membership *const membership = _memberships.get(sourcePeer->address());
 
-	switch (_doZtFilter(RR,rrl,_config,&membership,true,sourcePeer->address(),ztFinalDest,macSource,macDest,frameData,frameLen,etherType,vlanId,_config.rules,_config.ruleCount,cc,ccLength,ccWatch,qosBucket)) {
+	switch (_doZtFilter(RR,rrl,_config,membership,true,sourcePeer->address(),ztFinalDest,macSource,macDest,frameData,frameLen,etherType,vlanId,_config.rules,_config.ruleCount,_config.ruleResume,cc,ccLength,ccWatch,qosBucket)) {
 
 		case DOZTFILTER_NO_MATCH: {
-			Membership::CapabilityIterator mci(membership,_config);
-			while ((c = mci.next())) {
-				ztFinalDest = ztDest; // sanity check, should be unmodified if there was no match
-				Address cc2;
-				unsigned int ccLength2 = 0;
-				bool ccWatch2 = false;
-				switch(_doZtFilter(RR,crrl,_config,&membership,true,sourcePeer->address(),ztFinalDest,macSource,macDest,frameData,frameLen,etherType,vlanId,c->rules(),c->ruleCount(),cc2,ccLength2,ccWatch2,qosBucket)) {
-					case DOZTFILTER_NO_MATCH:
-					case DOZTFILTER_DROP: // explicit DROP in a capability just terminates its evaluation and is an anti-pattern
-						break;
-					case DOZTFILTER_REDIRECT: // interpreted as ACCEPT but ztDest will have been changed in _doZtFilter()
-					case DOZTFILTER_ACCEPT:
-						accept = 1; // ACCEPT
-						break;
-					case DOZTFILTER_SUPER_ACCEPT:
-						accept = 2; // super-ACCEPT
-						break;
-				}
+			if (membership) {
+				Membership::CapabilityIterator mci(*membership,_config);
+				while ((c = mci.next())) {
+					ztFinalDest = ztDest; // sanity check, should be unmodified if there was no match
+					Address cc2;
+					unsigned int ccLength2 = 0;
+					bool ccWatch2 = false;
+					switch(_doZtFilter(RR,crrl,_config,membership,true,sourcePeer->address(),ztFinalDest,macSource,macDest,frameData,frameLen,etherType,vlanId,c->rules(),c->ruleCount(),(const uint16_t *)0,cc2,ccLength2,ccWatch2,qosBucket)) {
+						case DOZTFILTER_NO_MATCH:
+						case DOZTFILTER_DROP: // explicit DROP in a capability just terminates its evaluation and is an anti-pattern
+							break;
+						case DOZTFILTER_REDIRECT: // interpreted as ACCEPT but ztDest will have been changed in _doZtFilter()
+						case DOZTFILTER_ACCEPT:
+							accept = 1; // ACCEPT
+							break;
+						case DOZTFILTER_SUPER_ACCEPT:
+							accept = 2; // super-ACCEPT
+							break;
+					}
 
-				if (accept) {
-					if (cc2) {
-						Packet outp(cc2,RR->identity.address(),Packet::VERB_EXT_FRAME);
-						outp.append(_id);
-						outp.append((uint8_t)(ccWatch2 ? 0x1c : 0x08));
-						macDest.appendTo(outp);
-						macSource.appendTo(outp);
-						outp.append((uint16_t)etherType);
-						outp.append(frameData,ccLength2);
-						outp.compress();
-						RR->sw->send(tPtr,outp,true);
+					if (accept) {
+						if (cc2) {
+							Packet outp(cc2,RR->identity.address(),Packet::VERB_EXT_FRAME);
+							outp.append(_id);
+							outp.append((uint8_t)(ccWatch2 ? 0x1c : 0x08));
+							macDest.appendTo(outp);
+							macSource.appendTo(outp);
+							outp.append((uint16_t)etherType);
+							outp.append(frameData,ccLength2);
+							outp.compress();
+							RR->sw->send(tPtr,outp,true);
+						}
+						break;
 					}
-					break;
 				}
 			}
 		}	break;
@@ -876,9 +1004,50 @@ int Network::filterIncomingPacket(
 	return accept;
 }
 
+int Network::runRulesEngine(
+	const NetworkConfig &nconf,
+	bool useRuleResume,
+	bool inbound,
+	const Address &ztSource,
+	const Address &ztDest,
+	const MAC &macSource,
+	const MAC &macDest,
+	const uint8_t *frameData,
+	unsigned int frameLen,
+	unsigned int etherType,
+	unsigned int vlanId)
+{
+	for(unsigned int rn=0;rn<nconf.ruleCount;++rn) {
+		switch((ZT_VirtualNetworkRuleType)(nconf.rules[rn].t & 0x3f)) {
+			case ZT_NETWORK_RULE_ACTION_TEE:
+			case ZT_NETWORK_RULE_ACTION_WATCH:
+			case ZT_NETWORK_RULE_ACTION_REDIRECT:
+			case ZT_NETWORK_RULE_MATCH_RANDOM:
+				return -1; // these dereference the RuntimeEnvironment, which does not exist offline
+			default:
+				break;
+		}
+	}
+
+	Trace::RuleResultLog rrl;
+	rrl.clear();
+	Address ztFinalDest(ztDest);
+	Address cc;
+	unsigned int ccLength = 0;
+	bool ccWatch = false;
+	uint8_t qosBucket = ZT_AQM_DEFAULT_BUCKET;
+	switch(_doZtFilter((const RuntimeEnvironment *)0,rrl,nconf,(const Membership *)0,inbound,ztSource,ztFinalDest,macSource,macDest,frameData,frameLen,etherType,vlanId,nconf.rules,nconf.ruleCount,(useRuleResume) ? nconf.ruleResume : (const uint16_t *)0,cc,ccLength,ccWatch,qosBucket)) {
+		case DOZTFILTER_ACCEPT:
+		case DOZTFILTER_SUPER_ACCEPT:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
 bool Network::subscribedToMulticastGroup(const MulticastGroup &mg,bool includeBridgedGroups) const
 {
-	Mutex::Lock _l(_lock);
+	RWMutex::Lock _l(_lock);
 	if (std::binary_search(_myMulticastGroups.begin(),_myMulticastGroups.end(),mg)) {
 		return true;
 	} else if (includeBridgedGroups) {
@@ -889,7 +1058,7 @@ bool Network::subscribedToMulticastGroup(const MulticastGroup &mg,bool includeBr
 
 void Network::multicastSubscribe(void *tPtr,const MulticastGroup &mg)
 {
-	Mutex::Lock _l(_lock);
+	RWMutex::Lock _l(_lock);
 	if (!std::binary_search(_myMulticastGroups.begin(),_myMulticastGroups.end(),mg)) {
 		_myMulticastGroups.insert(std::upper_bound(_myMulticastGroups.begin(),_myMulticastGroups.end(),mg),mg);
 		_sendUpdatesToMembers(tPtr,&mg);
@@ -899,7 +1068,7 @@ void Network::multicastSubscribe(void *tPtr,const MulticastGroup &mg)
 
 void Network::multicastUnsubscribe(const MulticastGroup &mg)
 {
-	Mutex::Lock _l(_lock);
+	RWMutex::Lock _l(_lock);
 	std::vector<MulticastGroup>::iterator i(std::lower_bound(_myMulticastGroups.begin(),_myMulticastGroups.end(),mg));
 	if ( (i != _myMulticastGroups.end()) && (*i == mg) ) {
 		_myMulticastGroups.erase(i);
@@ -921,93 +1090,122 @@ uint64_t Network::handleConfigChunk(void *tPtr,const uint64_t packetId,const Add
 	const void *chunkData = chunk.field(ptr,chunkLen);
 	ptr += chunkLen;
 
-	NetworkConfig *nc = (NetworkConfig *)0;
-	uint64_t configUpdateId;
-	{
-		Mutex::Lock _l(_lock);
+	/* Chunk headers are parsed and each chunk's signature is verified as it
+	 * arrives, before _lock is taken: signature checks and the final
+	 * Dictionary parse are the expensive parts of assembling a large config
+	 * and neither needs to stall the data path, which shares this lock. */
 
-		_IncomingConfigChunk *c = (_IncomingConfigChunk *)0;
-		uint64_t chunkId = 0;
-		unsigned long totalLength,chunkIndex;
-		if (ptr < chunk.size()) {
-			const bool fastPropagate = ((chunk[ptr++] & 0x01) != 0);
-			configUpdateId = chunk.at<uint64_t>(ptr);
-			ptr += 8;
-			totalLength = chunk.at<uint32_t>(ptr);
-			ptr += 4;
-			chunkIndex = chunk.at<uint32_t>(ptr);
-			ptr += 4;
-
-			if (((chunkIndex + chunkLen) > totalLength)||(totalLength >= ZT_NETWORKCONFIG_DICT_CAPACITY)) { // >= since we need room for a null at the end
-				return 0;
-			}
-			if ((chunk[ptr] != 1)||(chunk.at<uint16_t>(ptr + 1) != ZT_C25519_SIGNATURE_LEN)) {
-				return 0;
-			}
-			const uint8_t *sig = reinterpret_cast<const uint8_t *>(chunk.field(ptr + 3,ZT_C25519_SIGNATURE_LEN));
+	bool signedChunk = false,fastPropagate = false;
+	uint64_t configUpdateId;
+	uint64_t chunkId = 0;
+	unsigned long totalLength,chunkIndex;
+	if (ptr < chunk.size()) {
+		signedChunk = true;
+		fastPropagate = ((chunk[ptr++] & 0x01) != 0);
+		configUpdateId = chunk.at<uint64_t>(ptr);
+		ptr += 8;
+		totalLength = chunk.at<uint32_t>(ptr);
+		ptr += 4;
+		chunkIndex = chunk.at<uint32_t>(ptr);
+		ptr += 4;
+
+		if (((chunkIndex + chunkLen) > totalLength)||(totalLength >= ZT_NETWORKCONFIG_DICT_CAPACITY)) { // >= since we need room for a null at the end
+			return 0;
+		}
+		if ((chunk[ptr] != 1)||(chunk.at<uint16_t>(ptr + 1) != ZT_C25519_SIGNATURE_LEN)) {
+			return 0;
+		}
+		const uint8_t *sig = reinterpret_cast<const uint8_t *>(chunk.field(ptr + 3,ZT_C25519_SIGNATURE_LEN));
 
-			// We can use the signature, which is unique per chunk, to get a per-chunk ID for local deduplication use
-			for(unsigned int i=0;i<16;++i) {
-				reinterpret_cast<uint8_t *>(&chunkId)[i & 7] ^= sig[i];
-			}
+		// We can use the signature, which is unique per chunk, to get a per-chunk ID for local deduplication use
+		for(unsigned int i=0;i<16;++i) {
+			reinterpret_cast<uint8_t *>(&chunkId)[i & 7] ^= sig[i];
+		}
 
-			// Find existing or new slot for this update and check if this is a duplicate chunk
+		// Drop duplicate chunks before the expensive signature check. This is
+		// re-checked under the write lock below since another thread could
+		// append the same chunk while we are verifying.
+		{
+			RWMutex::RLock _rl(_lock);
 			for(int i=0;i<ZT_NETWORK_MAX_INCOMING_UPDATES;++i) {
 				if (_incomingConfigChunks[i].updateId == configUpdateId) {
-					c = &(_incomingConfigChunks[i]);
-
-					for(unsigned long j=0;j<c->haveChunks;++j) {
-						if (c->haveChunkIds[j] == chunkId) {
+					for(unsigned long j=0;j<_incomingConfigChunks[i].haveChunks;++j) {
+						if (_incomingConfigChunks[i].haveChunkIds[j] == chunkId) {
 							return 0;
 						}
 					}
-
 					break;
-				} else if ((!c)||(_incomingConfigChunks[i].ts < c->ts)) {
-					c = &(_incomingConfigChunks[i]);
 				}
 			}
+		}
 
-			// If it's not a duplicate, check chunk signature
-			const Identity controllerId(RR->topology->getIdentity(tPtr,controller()));
-			if (!controllerId) { // we should always have the controller identity by now, otherwise how would we have queried it the first time?
-				return 0;
-			}
-			if (!controllerId.verify(chunk.field(start,ptr - start),ptr - start,sig,ZT_C25519_SIGNATURE_LEN)) {
-				return 0;
-			}
+		// If it's not a duplicate, check chunk signature
+		const Identity controllerId(RR->topology->getIdentity(tPtr,controller()));
+		if (!controllerId) { // we should always have the controller identity by now, otherwise how would we have queried it the first time?
+			return 0;
+		}
+		if (!controllerId.verify(chunk.field(start,ptr - start),ptr - start,sig,ZT_C25519_SIGNATURE_LEN)) {
+			return 0;
+		}
 
-			// New properly verified chunks can be flooded "virally" through the network
-			if (fastPropagate) {
-				Address *a = (Address *)0;
-				Membership *m = (Membership *)0;
-				Hashtable<Address,Membership>::Iterator i(_memberships);
-				while (i.next(a,m)) {
-					if ((*a != source)&&(*a != controller())) {
-						Packet outp(*a,RR->identity.address(),Packet::VERB_NETWORK_CONFIG);
-						outp.append(reinterpret_cast<const uint8_t *>(chunk.data()) + start,chunk.size() - start);
-						RR->sw->send(tPtr,outp,true);
-					}
+		// New properly verified chunks can be flooded "virally" through the network
+		if (fastPropagate) {
+			RWMutex::RLock _rl(_lock);
+			Address *a = (Address *)0;
+			Membership *m = (Membership *)0;
+			FlatHashtable<Address,Membership>::Iterator i(_memberships);
+			while (i.next(a,m)) {
+				if ((*a != source)&&(*a != controller())) {
+					Packet outp(*a,RR->identity.address(),Packet::VERB_NETWORK_CONFIG);
+					outp.append(reinterpret_cast<const uint8_t *>(chunk.data()) + start,chunk.size() - start);
+					RR->sw->send(tPtr,outp,true);
 				}
 			}
-		} else if ((source == controller())||(!source)) { // since old chunks aren't signed, only accept from controller itself (or via cluster backplane)
-			// Legacy support for OK(NETWORK_CONFIG_REQUEST) from older controllers
-			chunkId = packetId;
-			configUpdateId = chunkId;
-			totalLength = chunkLen;
-			chunkIndex = 0;
-
-			if (totalLength >= ZT_NETWORKCONFIG_DICT_CAPACITY) {
-				return 0;
+		}
+	} else if ((source == controller())||(!source)) { // since old chunks aren't signed, only accept from controller itself (or via cluster backplane)
+		// Legacy support for OK(NETWORK_CONFIG_REQUEST) from older controllers
+		chunkId = packetId;
+		configUpdateId = chunkId;
+		totalLength = chunkLen;
+		chunkIndex = 0;
+
+		if (totalLength >= ZT_NETWORKCONFIG_DICT_CAPACITY) {
+			return 0;
+		}
+	} else {
+		// Single-chunk unsigned legacy configs are only allowed from the controller itself
+		return 0;
+	}
+
+	_IncomingConfigChunk *completed = (_IncomingConfigChunk *)0;
+	{
+		RWMutex::Lock _l(_lock);
+
+		// Find existing or new slot for this update, skipping slots pinned by
+		// an in-progress parse, and re-check for a duplicate chunk
+		_IncomingConfigChunk *c = (_IncomingConfigChunk *)0;
+		for(int i=0;i<ZT_NETWORK_MAX_INCOMING_UPDATES;++i) {
+			if (_incomingConfigChunks[i].parsing) {
+				if ((signedChunk)&&(_incomingConfigChunks[i].updateId == configUpdateId)) {
+					return 0; // this update is already complete and being parsed
+				}
+				continue;
 			}
+			if ((signedChunk)&&(_incomingConfigChunks[i].updateId == configUpdateId)) {
+				c = &(_incomingConfigChunks[i]);
 
-			for(int i=0;i<ZT_NETWORK_MAX_INCOMING_UPDATES;++i) {
-				if ((!c)||(_incomingConfigChunks[i].ts < c->ts)) {
-					c = &(_incomingConfigChunks[i]);
+				for(unsigned long j=0;j<c->haveChunks;++j) {
+					if (c->haveChunkIds[j] == chunkId) {
+						return 0;
+					}
 				}
+
+				break;
+			} else if ((!c)||(_incomingConfigChunks[i].ts < c->ts)) {
+				c = &(_incomingConfigChunks[i]);
 			}
-		} else {
-			// Single-chunk unsigned legacy configs are only allowed from the controller itself
+		}
+		if (!c) { // every slot is pinned by a parse in progress; drop and let the chunk be resent
 			return 0;
 		}
 
@@ -1028,29 +1226,35 @@ uint64_t Network::handleConfigChunk(void *tPtr,const uint64_t packetId,const Add
 
 		if (c->haveBytes == totalLength) {
 			c->data.unsafeData()[c->haveBytes] = (char)0; // ensure null terminated
-
-			nc = new NetworkConfig();
-			try {
-				if (!nc->fromDictionary(c->data)) {
-					delete nc;
-					nc = (NetworkConfig *)0;
-				}
-			} catch ( ... ) {
-				delete nc;
-				nc = (NetworkConfig *)0;
-			}
+			c->parsing = true; // pin this slot so it cannot be reused until the parse below is done
+			completed = c;
 		}
 	}
 
-	if (nc) {
-		this->setConfiguration(tPtr, *nc, true);
+	// Parse the completed dictionary without holding _lock; the slot stays
+	// pinned until the parse is done, and setConfiguration() performs its own
+	// locked swap of the active config.
+	uint64_t result = 0;
+	if (completed) {
+		NetworkConfig *nc = new NetworkConfig();
+		bool ok = false;
+		try {
+			ok = nc->fromDictionary(completed->data);
+		} catch ( ... ) {
+			ok = false;
+		}
+		{
+			RWMutex::Lock _l(_lock);
+			completed->parsing = false;
+			completed->updateId = 0; // consumed; slot may be reused
+		}
+		if (ok) {
+			this->setConfiguration(tPtr,*nc,true);
+			result = configUpdateId;
+		}
 		delete nc;
-		return configUpdateId;
-	} else {
-		return 0;
 	}
-
-	return 0;
+	return result;
 }
 
 int Network::setConfiguration(void *tPtr,const NetworkConfig &nconf,bool saveToDisk)
@@ -1071,18 +1275,31 @@ int Network::setConfiguration(void *tPtr,const NetworkConfig &nconf,bool saveToD
 		ZT_VirtualNetworkConfig ctmp;
 		bool oldPortInitialized;
 		{	// do things that require lock here, but unlock before calling callbacks
-			Mutex::Lock _l(_lock);
+			RWMutex::Lock _l(_lock);
 
 			_config = nconf;
 			_lastConfigUpdate = RR->node->now();
 			_netconfFailure = NETCONF_FAILURE_NONE;
 
+			{
+				Mutex::Lock _fcl(_flowCache_m);
+				_outgoingFlowCache.clear();
+			}
+			_flowCacheEnabled = _rulesAreFlowCacheable(_config.rules,_config.ruleCount);
+			for(unsigned int c=0;(c<_config.capabilityCount)&&(_flowCacheEnabled);++c) {
+				_flowCacheEnabled = _rulesAreFlowCacheable(_config.capabilities[c].rules(),_config.capabilities[c].ruleCount());
+			}
+
 			oldPortInitialized = _portInitialized;
 			_portInitialized = true;
 
 			_externalConfig(&ctmp);
 		}
 
+		// Apply (or clear) any trusted path subnets this network's controller
+		// designated; local.conf trusted paths are unaffected
+		RR->topology->setNetworkTrustedPaths(_id,nconf.trustedPathNetworks,nconf.trustedPathIds,nconf.trustedPathCount);
+
 		_portError = RR->node->configureVirtualNetworkPort(tPtr,_id,&_uPtr,(oldPortInitialized) ? ZT_VIRTUAL_NETWORK_CONFIG_OPERATION_CONFIG_UPDATE : ZT_VIRTUAL_NETWORK_CONFIG_OPERATION_UP,&ctmp);
 		_authenticationURL = nconf.authenticationURL;
 
@@ -1292,17 +1509,25 @@ bool Network::gate(void *tPtr,const SharedPtr<Peer> &peer)
 	const int64_t now = RR->node->now();
 	//int64_t comTimestamp = 0;
 	//int64_t comRevocationThreshold = 0;
-	Mutex::Lock _l(_lock);
+	RWMutex::Lock _l(_lock);
 	try {
 		if (_config) {
 			Membership *m = _memberships.get(peer->address());
+			if ((!m)&&(!_config.isPublic())) {
+				// First sighting of this member since startup. _membership()
+				// seeds the new entry from the cached credential state, if
+				// any, so traffic from already-authorized members passes
+				// immediately after a restart instead of stalling until
+				// credentials are re-pushed.
+				m = &(_membership(tPtr,peer->address()));
+			}
 			//if (m) {
 			//	comTimestamp = m->comTimestamp();
 			//	comRevocationThreshold = m->comRevocationThreshold();
 			//}
 			if ( (_config.isPublic()) || ((m)&&(m->isAllowedOnNetwork(_config, peer->identity()))) ) {
 				if (!m) {
-					m = &(_membership(peer->address()));
+					m = &(_membership(tPtr,peer->address()));
 				}
 				if (m->multicastLikeGate(now)) {
 					_announceMulticastGroupsTo(tPtr,peer->address(),_allMulticastGroups());
@@ -1318,7 +1543,7 @@ bool Network::gate(void *tPtr,const SharedPtr<Peer> &peer)
 
 bool Network::recentlyAssociatedWith(const Address &addr)
 {
-	Mutex::Lock _l(_lock);
+	RWMutex::RLock _l(_lock);
 	const Membership *m = _memberships.get(addr);
 	return ((m)&&(m->recentlyAssociated(RR->node->now())));
 }
@@ -1326,12 +1551,18 @@ bool Network::recentlyAssociatedWith(const Address &addr)
 void Network::clean()
 {
 	const int64_t now = RR->node->now();
-	Mutex::Lock _l(_lock);
+	RWMutex::Lock _l(_lock);
 
 	if (_destroyed) {
 		return;
 	}
 
+	// Membership cleaning below can expire credentials, so memoized verdicts must go too
+	{
+		Mutex::Lock _fcl(_flowCache_m);
+		_outgoingFlowCache.clear();
+	}
+
 	{
 		Hashtable< MulticastGroup,uint64_t >::Iterator i(_multicastGroupsBehindMe);
 		MulticastGroup *mg = (MulticastGroup *)0;
@@ -1346,7 +1577,7 @@ void Network::clean()
 	{
 		Address *a = (Address *)0;
 		Membership *m = (Membership *)0;
-		Hashtable<Address,Membership>::Iterator i(_memberships);
+		FlatHashtable<Address,Membership>::Iterator i(_memberships);
 		while (i.next(a,m)) {
 			if (!RR->topology->getPeerNoCache(*a)) {
 				_memberships.erase(*a);
@@ -1357,47 +1588,111 @@ void Network::clean()
 	}
 }
 
-void Network::learnBridgeRoute(const MAC &mac,const Address &addr)
+void Network::_bridgeRouteUnlink(_BridgeRoute &br)
 {
-	Mutex::Lock _l(_lock);
-	_remoteBridgeRoutes[mac] = addr;
+	// assumes _lock is held for writing
+	if (br.lruNewer) {
+		_remoteBridgeRoutes.get(br.lruNewer)->lruOlder = br.lruOlder;
+	} else {
+		_bridgeRouteNewest = br.lruOlder;
+	}
+	if (br.lruOlder) {
+		_remoteBridgeRoutes.get(br.lruOlder)->lruNewer = br.lruNewer;
+	} else {
+		_bridgeRouteOldest = br.lruNewer;
+	}
 
-	// Anti-DOS circuit breaker to prevent nodes from spamming us with absurd numbers of bridge routes
-	while (_remoteBridgeRoutes.size() > ZT_MAX_BRIDGE_ROUTES) {
-		Hashtable< Address,unsigned long > counts;
-		Address maxAddr;
-		unsigned long maxCount = 0;
+	_BridgeRouteList *const vl = _bridgeRoutesByVia.get(br.via);
+	if (vl) {
+		if (br.viaNewer) {
+			_remoteBridgeRoutes.get(br.viaNewer)->viaOlder = br.viaOlder;
+		} else {
+			vl->newest = br.viaOlder;
+		}
+		if (br.viaOlder) {
+			_remoteBridgeRoutes.get(br.viaOlder)->viaNewer = br.viaNewer;
+		} else {
+			vl->oldest = br.viaNewer;
+		}
+		if (--vl->count == 0) {
+			_bridgeRoutesByVia.erase(br.via);
+		}
+	}
+}
 
-		MAC *m = (MAC *)0;
-		Address *a = (Address *)0;
+void Network::_bridgeRouteLinkFront(const MAC &mac,_BridgeRoute &br)
+{
+	// assumes _lock is held for writing and br is not currently linked
+	br.lruNewer.zero();
+	br.lruOlder = _bridgeRouteNewest;
+	if (_bridgeRouteNewest) {
+		_remoteBridgeRoutes.get(_bridgeRouteNewest)->lruNewer = mac;
+	} else {
+		_bridgeRouteOldest = mac;
+	}
+	_bridgeRouteNewest = mac;
 
-		// Find the address responsible for the most entries
-		{
-			Hashtable<MAC,Address>::Iterator i(_remoteBridgeRoutes);
-			while (i.next(m,a)) {
-				const unsigned long c = ++counts[*a];
-				if (c > maxCount) {
-					maxCount = c;
-					maxAddr = *a;
-				}
-			}
+	_BridgeRouteList &vl = _bridgeRoutesByVia[br.via];
+	br.viaNewer.zero();
+	br.viaOlder = vl.newest;
+	if (vl.newest) {
+		_remoteBridgeRoutes.get(vl.newest)->viaNewer = mac;
+	} else {
+		vl.oldest = mac;
+	}
+	vl.newest = mac;
+	++vl.count;
+}
+
+void Network::learnBridgeRoute(const MAC &mac,const Address &addr)
+{
+	RWMutex::Lock _l(_lock);
+
+	_BridgeRoute *const br = _remoteBridgeRoutes.get(mac);
+	if (br) {
+		// Known MAC: refresh its recency (and bridge, if it moved)
+		if ((br->via != addr)||(_bridgeRouteNewest != mac)) {
+			_bridgeRouteUnlink(*br);
+			br->via = addr;
+			_bridgeRouteLinkFront(mac,*br);
 		}
+		return;
+	}
 
-		// Kill this address from our table, since it's most likely spamming us
-		{
-			Hashtable<MAC,Address>::Iterator i(_remoteBridgeRoutes);
-			while (i.next(m,a)) {
-				if (*a == maxAddr) {
-					_remoteBridgeRoutes.erase(*m);
-				}
+	// Fairness quota: a bridge at its cap evicts its own least recently
+	// seen MAC rather than someone else's
+	{
+		_BridgeRouteList *const vl = _bridgeRoutesByVia.get(addr);
+		if ((vl)&&(vl->count >= ZT_MAX_BRIDGE_ROUTES_PER_BRIDGE)) {
+			const MAC victim(vl->oldest);
+			_BridgeRoute *const vbr = _remoteBridgeRoutes.get(victim);
+			if (vbr) {
+				_bridgeRouteUnlink(*vbr);
+				_remoteBridgeRoutes.erase(victim);
 			}
 		}
 	}
+
+	// Anti-DOS circuit breaker to prevent nodes from spamming us with absurd
+	// numbers of bridge routes: evict the globally least recently seen
+	while ((_remoteBridgeRoutes.size() >= ZT_MAX_BRIDGE_ROUTES)&&(_bridgeRouteOldest)) {
+		const MAC victim(_bridgeRouteOldest);
+		_BridgeRoute *const vbr = _remoteBridgeRoutes.get(victim);
+		if (!vbr) {
+			break;
+		}
+		_bridgeRouteUnlink(*vbr);
+		_remoteBridgeRoutes.erase(victim);
+	}
+
+	_BridgeRoute &nbr = _remoteBridgeRoutes[mac];
+	nbr.via = addr;
+	_bridgeRouteLinkFront(mac,nbr);
 }
 
 void Network::learnBridgedMulticastGroup(void *tPtr,const MulticastGroup &mg,int64_t now)
 {
-	Mutex::Lock _l(_lock);
+	RWMutex::Lock _l(_lock);
 	const unsigned long tmp = (unsigned long)_multicastGroupsBehindMe.size();
 	_multicastGroupsBehindMe.set(mg,now);
 	if (tmp != _multicastGroupsBehindMe.size()) {
@@ -1410,8 +1705,17 @@ Membership::AddCredentialResult Network::addCredential(void *tPtr,const Certific
 	if (com.networkId() != _id) {
 		return Membership::ADD_REJECTED;
 	}
-	Mutex::Lock _l(_lock);
-	return _membership(com.issuedTo()).addCredential(RR,tPtr,_config,com);
+	RWMutex::Lock _l(_lock);
+	{
+		Mutex::Lock _fcl(_flowCache_m);
+		_outgoingFlowCache.clear(); // credentials can change cached filter verdicts
+	}
+	Membership &m = _membership(tPtr,com.issuedTo());
+	const Membership::AddCredentialResult result = m.addCredential(RR,tPtr,_config,com);
+	if (result == Membership::ADD_ACCEPTED_NEW) {
+		_membershipStateChanged(tPtr,com.issuedTo(),m);
+	}
+	return result;
 }
 
 Membership::AddCredentialResult Network::addCredential(void *tPtr,const Address &sentFrom,const Revocation &rev)
@@ -1420,15 +1724,25 @@ Membership::AddCredentialResult Network::addCredential(void *tPtr,const Address
 		return Membership::ADD_REJECTED;
 	}
 
-	Mutex::Lock _l(_lock);
-	Membership &m = _membership(rev.target());
+	RWMutex::Lock _l(_lock);
+	{
+		Mutex::Lock _fcl(_flowCache_m);
+		_outgoingFlowCache.clear(); // credentials can change cached filter verdicts
+	}
+	Membership &m = _membership(tPtr,rev.target());
 
 	const Membership::AddCredentialResult result = m.addCredential(RR,tPtr,_config,rev);
 
+	if (result == Membership::ADD_ACCEPTED_NEW) {
+		// Revocations must survive a restart or cached credentials could
+		// resurrect a member that was kicked, so persist immediately.
+		_membershipStateChanged(tPtr,rev.target(),m);
+	}
+
 	if ((result == Membership::ADD_ACCEPTED_NEW)&&(rev.fastPropagate())) {
 		Address *a = (Address *)0;
 		Membership *m = (Membership *)0;
-		Hashtable<Address,Membership>::Iterator i(_memberships);
+		FlatHashtable<Address,Membership>::Iterator i(_memberships);
 		while (i.next(a,m)) {
 			if ((*a != sentFrom)&&(*a != rev.signer())) {
 				Packet outp(*a,RR->identity.address(),Packet::VERB_NETWORK_CREDENTIALS);
@@ -1448,7 +1762,8 @@ Membership::AddCredentialResult Network::addCredential(void *tPtr,const Address
 
 void Network::destroy()
 {
-	Mutex::Lock _l(_lock);
+	RR->topology->setNetworkTrustedPaths(_id,(const InetAddress *)0,(const uint64_t *)0,0);
+	RWMutex::Lock _l(_lock);
 	_destroyed = true;
 }
 
@@ -1582,14 +1897,29 @@ void Network::_sendUpdatesToMembers(void *tPtr,const MulticastGroup *const newMu
 	}
 
 	{
+		// The budget is consulted before the gate so that a member skipped in
+		// this pass stays due and is announced to on a following pass, which
+		// spreads announcement bursts on large networks across several ticks
+		// instead of freezing the tick thread on one huge member loop.
+		unsigned int announced = 0;
 		Address *a = (Address *)0;
 		Membership *m = (Membership *)0;
-		Hashtable<Address,Membership>::Iterator i(_memberships);
+		FlatHashtable<Address,Membership>::Iterator i(_memberships);
 		while (i.next(a,m)) {
+			if (std::binary_search(alwaysAnnounceTo.begin(),alwaysAnnounceTo.end(),*a)) {
+				continue;
+			}
 			const Identity remoteIdentity(RR->topology->getIdentity(tPtr, *a));
-			if (remoteIdentity) {
-				if ( ( m->multicastLikeGate(now) || (newMulticastGroup) ) && (m->isAllowedOnNetwork(_config, remoteIdentity)) && (!std::binary_search(alwaysAnnounceTo.begin(),alwaysAnnounceTo.end(),*a)) ) {
+			if ((remoteIdentity)&&(m->isAllowedOnNetwork(_config, remoteIdentity))) {
+				if (announced >= ZT_MULTICAST_ANNOUNCE_MAX_PER_PASS) {
+					if (newMulticastGroup) {
+						m->resetMulticastLikeGate(); // the next pass sends all groups, including this new one
+					}
+					continue;
+				}
+				if ( m->multicastLikeGate(now) || (newMulticastGroup) ) {
 					_announceMulticastGroupsTo(tPtr,*a,groups);
+					++announced;
 				}
 			}
 		}
@@ -1637,15 +1967,58 @@ std::vector<MulticastGroup> Network::_allMulticastGroups() const
 	return mgs;
 }
 
-Membership &Network::_membership(const Address &a)
+Membership &Network::_membership(void *tPtr,const Address &a)
 {
 	// assumes _lock is locked
-	return _memberships[a];
+	Membership *const m = _memberships.get(a);
+	if (m) {
+		return *m;
+	}
+	Membership &nm = _memberships[a];
+	// A member we have no live state for may have credential state cached
+	// from a previous run. Restoring it means a fleet restart does not
+	// trigger a credential re-exchange proportional to members times peers.
+	try {
+		Buffer<ZT_MEMBERSHIP_MAX_SERIALIZED_STATE_SIZE> buf;
+		uint64_t sid[2];
+		sid[0] = _id;
+		sid[1] = a.toInt();
+		const int len = RR->node->stateObjectGet(tPtr,ZT_STATE_OBJECT_MEMBERSHIP,sid,buf.unsafeData(),ZT_MEMBERSHIP_MAX_SERIALIZED_STATE_SIZE);
+		if (len > 0) {
+			buf.setSize((unsigned int)len);
+			nm.deserializeFromCache(buf);
+		}
+	} catch ( ... ) {} // an unreadable cache entry is simply ignored
+	return nm;
+}
+
+void Network::_membershipStateChanged(void *tPtr,const Address &a,const Membership &m)
+{
+	// assumes _lock is locked
+	try {
+		Buffer<ZT_MEMBERSHIP_MAX_SERIALIZED_STATE_SIZE> buf;
+		m.serializeForCache(buf);
+		uint64_t sid[2];
+		sid[0] = _id;
+		sid[1] = a.toInt();
+		RR->node->stateObjectPut(tPtr,ZT_STATE_OBJECT_MEMBERSHIP,sid,buf.data(),buf.size());
+	} catch ( ... ) {} // too large to cache; skip, correctness does not depend on the cache
+}
+
+void Network::_flowCacheStore(const _FlowCacheKey &key,const bool accept,const uint8_t qosBucket)
+{
+	Mutex::Lock _l(_flowCache_m);
+	if (_outgoingFlowCache.size() >= ZT_NETWORK_FLOW_CACHE_SIZE) {
+		_outgoingFlowCache.clear(); // flows repopulate quickly, so wholesale eviction is simpler than LRU
+	}
+	_FlowCacheEntry &e = _outgoingFlowCache[key];
+	e.accept = accept;
+	e.qosBucket = qosBucket;
 }
 
 void Network::setAuthenticationRequired(void *tPtr, const char* issuerURL, const char* centralEndpoint, const char* clientID, const char *ssoProvider, const char* nonce, const char* state)
 {
-	Mutex::Lock _l(_lock);
+	RWMutex::Lock _l(_lock);
 	_netconfFailure = NETCONF_FAILURE_AUTHENTICATION_REQUIRED;
 	_config.ssoEnabled = true;
 	_config.ssoVersion = 1;
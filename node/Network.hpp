@@ -26,8 +26,10 @@
 
 #include "Constants.hpp"
 #include "Hashtable.hpp"
+#include "FlatHashtable.hpp"
 #include "Address.hpp"
 #include "Mutex.hpp"
+#include "RWMutex.hpp"
 #include "SharedPtr.hpp"
 #include "AtomicCounter.hpp"
 #include "MulticastGroup.hpp"
@@ -86,7 +88,7 @@ public:
 	inline bool multicastEnabled() const { return (_config.multicastLimit > 0); }
 	inline bool hasConfig() const { return (_config); }
 	inline uint64_t lastConfigUpdate() const { return _lastConfigUpdate; }
-	inline ZT_VirtualNetworkStatus status() const { Mutex::Lock _l(_lock); return _status(); }
+	inline ZT_VirtualNetworkStatus status() const { RWMutex::RLock _l(_lock); return _status(); }
 	inline const NetworkConfig &config() const { return _config; }
 	inline const MAC &mac() const { return _mac; }
 
@@ -153,6 +155,41 @@ public:
 		const unsigned int etherType,
 		const unsigned int vlanId);
 
+	/**
+	 * Run the rules engine directly against a synthetic frame (1.10.7+)
+	 *
+	 * This drives the exact evaluator the data path uses but without a live
+	 * network, for the offline rules microbenchmark (zerotier-bench rules)
+	 * and the selftest. No RuntimeEnvironment or peer membership exists in
+	 * that setting, so rule sets using actions or matches that need one
+	 * (TEE, WATCH, REDIRECT, MATCH_RANDOM) are rejected rather than evaluated.
+	 *
+	 * @param nconf Network config holding the rules (and tags/COOs, if any)
+	 * @param useRuleResume If true use nconf's compiled jump-threading table, if false evaluate every entry
+	 * @param inbound True to evaluate as an inbound frame
+	 * @param ztSource Source ZeroTier address
+	 * @param ztDest Destination ZeroTier address
+	 * @param macSource Ethernet layer source address
+	 * @param macDest Ethernet layer destination address
+	 * @param frameData Ethernet frame data (payload after the Ethernet header)
+	 * @param frameLen Ethernet frame payload length
+	 * @param etherType 16-bit ethernet type ID
+	 * @param vlanId 16-bit VLAN ID
+	 * @return 1 == accept, 0 == drop, -1 == rule set cannot be evaluated offline
+	 */
+	static int runRulesEngine(
+		const NetworkConfig &nconf,
+		bool useRuleResume,
+		bool inbound,
+		const Address &ztSource,
+		const Address &ztDest,
+		const MAC &macSource,
+		const MAC &macDest,
+		const uint8_t *frameData,
+		unsigned int frameLen,
+		unsigned int etherType,
+		unsigned int vlanId);
+
 	/**
 	 * Check whether we are subscribed to a multicast group
 	 *
@@ -208,7 +245,7 @@ public:
 	 */
 	inline void setAccessDenied(void *tPtr)
 	{
-		Mutex::Lock _l(_lock);
+		RWMutex::Lock _l(_lock);
 		_netconfFailure = NETCONF_FAILURE_ACCESS_DENIED;
 
 		_sendUpdateEvent(tPtr);
@@ -219,7 +256,7 @@ public:
 	 */
 	inline void setNotFound(void *tPtr)
 	{
-		Mutex::Lock _l(_lock);
+		RWMutex::Lock _l(_lock);
 		_netconfFailure = NETCONF_FAILURE_NOT_FOUND;
 
 		_sendUpdateEvent(tPtr);
@@ -230,7 +267,7 @@ public:
 	 */
 	inline void setAuthenticationRequired(void *tPtr, const char *url)
 	{
-		Mutex::Lock _l(_lock);
+		RWMutex::Lock _l(_lock);
 		_netconfFailure = NETCONF_FAILURE_AUTHENTICATION_REQUIRED;
 		_authenticationURL = (url) ? url : "";
 		_config.ssoEnabled = true;
@@ -284,7 +321,7 @@ public:
 	 */
 	inline void sendUpdatesToMembers(void *tPtr)
 	{
-		Mutex::Lock _l(_lock);
+		RWMutex::Lock _l(_lock);
 		_sendUpdatesToMembers(tPtr,(const MulticastGroup *)0);
 	}
 
@@ -296,15 +333,15 @@ public:
 	 */
 	inline Address findBridgeTo(const MAC &mac) const
 	{
-		Mutex::Lock _l(_lock);
-		const Address *const br = _remoteBridgeRoutes.get(mac);
-		return ((br) ? *br : Address());
+		RWMutex::RLock _l(_lock);
+		const _BridgeRoute *const br = _remoteBridgeRoutes.get(mac);
+		return ((br) ? br->via : Address());
 	}
 
 	/**
 	 * @return True if QoS is in effect for this network
 	 */
-	inline bool qosEnabled() { return false; }
+	inline bool qosEnabled() const { return ((_config)&&(_config.enableQos())); }
 
 	/**
 	 * Set a bridge route
@@ -336,8 +373,14 @@ public:
 		if (cap.networkId() != _id) {
 			return Membership::ADD_REJECTED;
 		}
-		Mutex::Lock _l(_lock);
-		return _membership(cap.issuedTo()).addCredential(RR,tPtr,_config,cap);
+		RWMutex::Lock _l(_lock);
+		_outgoingFlowCache.clear(); // credentials can change cached filter verdicts
+		Membership &m = _membership(tPtr,cap.issuedTo());
+		const Membership::AddCredentialResult result = m.addCredential(RR,tPtr,_config,cap);
+		if (result == Membership::ADD_ACCEPTED_NEW) {
+			_membershipStateChanged(tPtr,cap.issuedTo(),m);
+		}
+		return result;
 	}
 
 	/**
@@ -348,8 +391,14 @@ public:
 		if (tag.networkId() != _id) {
 			return Membership::ADD_REJECTED;
 		}
-		Mutex::Lock _l(_lock);
-		return _membership(tag.issuedTo()).addCredential(RR,tPtr,_config,tag);
+		RWMutex::Lock _l(_lock);
+		_outgoingFlowCache.clear(); // credentials can change cached filter verdicts
+		Membership &m = _membership(tPtr,tag.issuedTo());
+		const Membership::AddCredentialResult result = m.addCredential(RR,tPtr,_config,tag);
+		if (result == Membership::ADD_ACCEPTED_NEW) {
+			_membershipStateChanged(tPtr,tag.issuedTo(),m);
+		}
+		return result;
 	}
 
 	/**
@@ -365,8 +414,14 @@ public:
 		if (coo.networkId() != _id) {
 			return Membership::ADD_REJECTED;
 		}
-		Mutex::Lock _l(_lock);
-		return _membership(coo.issuedTo()).addCredential(RR,tPtr,_config,coo);
+		RWMutex::Lock _l(_lock);
+		_outgoingFlowCache.clear(); // credentials can change cached filter verdicts
+		Membership &m = _membership(tPtr,coo.issuedTo());
+		const Membership::AddCredentialResult result = m.addCredential(RR,tPtr,_config,coo);
+		if (result == Membership::ADD_ACCEPTED_NEW) {
+			_membershipStateChanged(tPtr,coo.issuedTo(),m);
+		}
+		return result;
 	}
 
 	/**
@@ -378,14 +433,68 @@ public:
 	 */
 	inline void peerRequestedCredentials(void *tPtr,const Address &to,const int64_t now)
 	{
-		Mutex::Lock _l(_lock);
-		Membership &m = _membership(to);
+		RWMutex::Lock _l(_lock);
+		Membership &m = _membership(tPtr,to);
 		const int64_t lastPushed = m.lastPushedCredentials();
-		if ((lastPushed < _lastConfigUpdate)||((now - lastPushed) > ZT_PEER_CREDENTIALS_REQUEST_RATE_LIMIT)) {
-			m.pushCredentials(RR,tPtr,now,to,_config);
+		if ((m.lastPushedCredentialsConfigTimestamp() != _config.timestamp)||((now - lastPushed) > ZT_PEER_CREDENTIALS_REQUEST_RATE_LIMIT)) {
+			m.pushCredentials(RR,tPtr,now,to,_config,_credentialPushCache,_multicastGroupKeyId,_multicastGroupKey);
+			_membershipStateChanged(tPtr,to,m);
+		}
+	}
+
+	/**
+	 * Re-push credentials to a member that just resumed a session after a restart
+	 *
+	 * Called when a peer presents a valid session resumption ticket in HELLO,
+	 * indicating it restarted recently and lost the credentials we pushed
+	 * during the previous session. Only members we already track get a push,
+	 * and the explicit-request rate limit applies, so an errant ticket cannot
+	 * amplify traffic.
+	 *
+	 * @param tPtr Thread pointer to be handed through to any callbacks called as a result of this call
+	 * @param to Destination peer address
+	 * @param now Current time
+	 */
+	inline void peerSessionResumed(void *tPtr,const Address &to,const int64_t now)
+	{
+		RWMutex::Lock _l(_lock);
+		Membership *const m = _memberships.get(to);
+		if (m) {
+			const int64_t lastPushed = m->lastPushedCredentials();
+			if ((lastPushed < _lastConfigUpdate)||((now - lastPushed) > ZT_PEER_CREDENTIALS_REQUEST_RATE_LIMIT)) {
+				m->pushCredentials(RR,tPtr,now,to,_config,_credentialPushCache,_multicastGroupKeyId,_multicastGroupKey);
+				_membershipStateChanged(tPtr,to,*m);
+			}
 		}
 	}
 
+	/**
+	 * @return ID of this network's current multicast group key
+	 */
+	inline uint64_t multicastGroupKeyId() const { return _multicastGroupKeyId; }
+
+	/**
+	 * @return This network's 32-byte multicast group key
+	 */
+	inline const uint8_t *multicastGroupKey() const { return _multicastGroupKey; }
+
+	/**
+	 * Check whether a member already holds our current multicast group key
+	 *
+	 * Used by the multicast fan-out to decide between the shared-key fast
+	 * path and per-destination armoring; a member whose key push is still
+	 * in flight just takes the slow path for its first few frames.
+	 *
+	 * @param to Member address
+	 * @return True if the current group key has been pushed to this member
+	 */
+	inline bool multicastGroupKeyReadyFor(const Address &to)
+	{
+		RWMutex::RLock _l(_lock);
+		const Membership *const m = _memberships.get(to);
+		return ((m)&&(m->groupKeyPushed(_multicastGroupKeyId)));
+	}
+
 	/**
 	 * Push credentials if we haven't done so in a very long time
 	 *
@@ -395,11 +504,23 @@ public:
 	 */
 	inline void pushCredentialsIfNeeded(void *tPtr,const Address &to,const int64_t now)
 	{
-		Mutex::Lock _l(_lock);
-		Membership &m = _membership(to);
+		RWMutex::Lock _l(_lock);
+		Membership &m = _membership(tPtr,to);
 		const int64_t lastPushed = m.lastPushedCredentials();
-		if ((lastPushed < _lastConfigUpdate)||((now - lastPushed) > ZT_PEER_ACTIVITY_TIMEOUT)) {
-			m.pushCredentials(RR,tPtr,now,to,_config);
+		if ((m.lastPushedCredentialsConfigTimestamp() != _config.timestamp)||((now - lastPushed) > ZT_PEER_ACTIVITY_TIMEOUT)) {
+			// Pace spontaneous pushes so a config refresh on a large network
+			// doesn't burst one packet volley per member all at once. Peers
+			// past the budget trigger again on their next packet, so the
+			// storm spreads over successive windows. Explicit credential
+			// requests (peerRequestedCredentials()) are not subject to this.
+			if ((now - _credentialPushWindowStart) > ZT_CREDENTIAL_PUSH_WINDOW) {
+				_credentialPushWindowStart = now;
+				_credentialPushesInWindow = 0;
+			}
+			if (++_credentialPushesInWindow <= ZT_CREDENTIAL_PUSH_MAX_PER_WINDOW) {
+				m.pushCredentials(RR,tPtr,now,to,_config,_credentialPushCache,_multicastGroupKeyId,_multicastGroupKey);
+				_membershipStateChanged(tPtr,to,m);
+			}
 		}
 	}
 
@@ -418,7 +539,7 @@ public:
 	 */
 	inline void externalConfig(ZT_VirtualNetworkConfig *ec) const
 	{
-		Mutex::Lock _l(_lock);
+		RWMutex::RLock _l(_lock);
 		_externalConfig(ec);
 	}
 
@@ -428,13 +549,30 @@ public:
 	inline void **userPtr() { return &_uPtr; }
 
 private:
+	struct _BridgeRoute
+	{
+		_BridgeRoute() {}
+		Address via;           // bridge this MAC is reachable behind
+		MAC lruNewer,lruOlder; // global LRU links
+		MAC viaNewer,viaOlder; // per-bridge LRU links
+	};
+	struct _BridgeRouteList
+	{
+		_BridgeRouteList() : count(0) {}
+		unsigned long count;
+		MAC newest,oldest;
+	};
+
 	ZT_VirtualNetworkStatus _status() const;
 	void _externalConfig(ZT_VirtualNetworkConfig *ec) const; // assumes _lock is locked
 	bool _gate(const SharedPtr<Peer> &peer);
 	void _sendUpdatesToMembers(void *tPtr,const MulticastGroup *const newMulticastGroup);
 	void _announceMulticastGroupsTo(void *tPtr,const Address &peer,const std::vector<MulticastGroup> &allMulticastGroups);
 	std::vector<MulticastGroup> _allMulticastGroups() const;
-	Membership &_membership(const Address &a);
+	Membership &_membership(void *tPtr,const Address &a);
+	void _membershipStateChanged(void *tPtr,const Address &a,const Membership &m);
+	void _bridgeRouteUnlink(_BridgeRoute &br);
+	void _bridgeRouteLinkFront(const MAC &mac,_BridgeRoute &br);
 	void _sendUpdateEvent(void *tPtr);
 
 	const RuntimeEnvironment *const RR;
@@ -447,10 +585,21 @@ private:
 
 	std::vector< MulticastGroup > _myMulticastGroups; // multicast groups that we belong to (according to tap)
 	Hashtable< MulticastGroup,uint64_t > _multicastGroupsBehindMe; // multicast groups that seem to be behind us and when we last saw them (if we are a bridge)
-	Hashtable< MAC,Address > _remoteBridgeRoutes; // remote addresses where given MACs are reachable (for tracking devices behind remote bridges)
+
+	// Remote addresses where given MACs are reachable (for tracking devices
+	// behind remote bridges). Entries are threaded onto two intrusive LRU
+	// lists -- one global, one per bridge -- linked by MAC key (a null MAC
+	// terminates a list), so cap enforcement evicts the least recently seen
+	// route in constant time instead of scanning the table. This stays a
+	// chained Hashtable because the links rely on its pointer stability.
+	Hashtable< MAC,_BridgeRoute > _remoteBridgeRoutes;
+	MAC _bridgeRouteNewest,_bridgeRouteOldest;
+	Hashtable< Address,_BridgeRouteList > _bridgeRoutesByVia;
 
 	NetworkConfig _config;
 	int64_t _lastConfigUpdate;
+	int64_t _credentialPushWindowStart;
+	unsigned int _credentialPushesInWindow;
 
 	struct _IncomingConfigChunk
 	{
@@ -460,10 +609,49 @@ private:
 		uint64_t haveChunkIds[ZT_NETWORK_MAX_UPDATE_CHUNKS];
 		unsigned long haveChunks;
 		unsigned long haveBytes;
+		bool parsing; // slot is pinned while its completed data is parsed outside _lock
 		Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> data;
 	};
 	_IncomingConfigChunk _incomingConfigChunks[ZT_NETWORK_MAX_INCOMING_UPDATES];
 
+	struct _FlowCacheKey
+	{
+		_FlowCacheKey() { memset(this,0,sizeof(_FlowCacheKey)); }
+		inline unsigned long hashCode() const
+		{
+			uint64_t h = macSource + (macDest * 0x9e3779b97f4a7c15ULL) + ztSource + ztDest + ((uint64_t)etherType << 48) + ((uint64_t)vlanId << 32) + ((uint64_t)proto << 24) + ((uint64_t)sport << 8) + (uint64_t)dport + (uint64_t)noTee;
+			for(unsigned int i=0;i<16;++i) {
+				h = (h ^ (uint64_t)ipSrc[i]) * 0x100000001b3ULL;
+				h = (h ^ (uint64_t)ipDest[i]) * 0x100000001b3ULL;
+			}
+			return (unsigned long)h;
+		}
+		inline bool operator==(const _FlowCacheKey &k) const { return (memcmp(this,&k,sizeof(_FlowCacheKey)) == 0); }
+		uint64_t macSource;
+		uint64_t macDest;
+		uint64_t ztSource;
+		uint64_t ztDest;
+		uint8_t ipSrc[16];
+		uint8_t ipDest[16];
+		uint32_t etherType;
+		uint32_t vlanId;
+		uint16_t sport;
+		uint16_t dport;
+		uint8_t proto;
+		uint8_t noTee;
+	};
+	struct _FlowCacheEntry
+	{
+		_FlowCacheEntry() : accept(false),qosBucket(255) {}
+		bool accept;
+		uint8_t qosBucket;
+	};
+	void _flowCacheStore(const _FlowCacheKey &key,const bool accept,const uint8_t qosBucket); // takes _flowCache_m itself
+
+	Hashtable< _FlowCacheKey,_FlowCacheEntry > _outgoingFlowCache; // memoized filter verdicts for long-lived outgoing flows
+	Mutex _flowCache_m; // guards _outgoingFlowCache so filter threads holding only the read lock can update it
+	bool _flowCacheEnabled; // false if the current rule set contains matches that can vary per packet within a flow
+
 	bool _destroyed;
 
 	enum {
@@ -476,9 +664,17 @@ private:
 	int _portError; // return value from port config callback
 	std::string _authenticationURL;
 
-	Hashtable<Address,Membership> _memberships;
+	FlatHashtable<Address,Membership> _memberships;
+	Membership::CredentialPushCache _credentialPushCache; // shared wire form of our credential push (guarded by _lock)
+
+	// Sender-generated symmetric key for group-keyed multicast fan-out,
+	// distributed to supporting members alongside credential pushes. Fresh
+	// per process (never persisted); the random ID lets receivers match
+	// keys without trial decryption against multiple senders.
+	uint64_t _multicastGroupKeyId;
+	uint8_t _multicastGroupKey[32];
 
-	Mutex _lock;
+	RWMutex _lock;
 
 	AtomicCounter __refCount;
 
@@ -45,6 +45,11 @@
  */
 #define ZT_NETWORKCONFIG_DEFAULT_CREDENTIAL_TIME_DFL_MAX_DELTA ((int64_t)(1000 * 60 * 30))
 
+/**
+ * Maximum number of controller-designated trusted physical path subnets per network
+ */
+#define ZT_MAX_NETWORK_TRUSTED_PATHS 4
+
 /**
  * Maximum time delta for COMs, tags, and capabilities
  */
@@ -75,6 +80,21 @@
  */
 #define ZT_NETWORKCONFIG_FLAG_DISABLE_COMPRESSION 0x0000000000000010ULL
 
+/**
+ * Flag: enable compression of large unicast frames
+ */
+#define ZT_NETWORKCONFIG_FLAG_ENABLE_UNICAST_COMPRESSION 0x0000000000000020ULL
+
+/**
+ * Flag: enable QoS/AQM egress scheduling for this network's frames
+ */
+#define ZT_NETWORKCONFIG_FLAG_ENABLE_QOS 0x0000000000000040ULL
+
+/**
+ * Flag: enable group-keyed multicast fan-out (single-pass encryption)
+ */
+#define ZT_NETWORKCONFIG_FLAG_ENABLE_GROUP_KEYED_MULTICAST 0x0000000000000080ULL
+
 /**
  * Device can bridge to other Ethernet networks and gets unknown recipient multicasts
  */
@@ -177,6 +197,10 @@ namespace ZeroTier {
 #define ZT_NETWORKCONFIG_DICT_KEY_CERTIFICATES_OF_OWNERSHIP "COO"
 // dns (binary blobs)
 #define ZT_NETWORKCONFIG_DICT_KEY_DNS "DNS"
+// trusted physical path subnets (1.10.7+)
+#define ZT_NETWORKCONFIG_DICT_KEY_TRUSTED_PATHS "TP"
+// inner-to-outer DSCP policy map (64 binary bytes, optional) (1.10.7+)
+#define ZT_NETWORKCONFIG_DICT_KEY_DSCP_MAP "dscpMap"
 // sso enabled
 #define ZT_NETWORKCONFIG_DICT_KEY_SSO_ENABLED "ssoe"
 // so version
@@ -240,11 +264,96 @@ namespace ZeroTier {
 
 // End legacy fields
 
+/**
+ * Heap-backed array member of NetworkConfig
+ *
+ * NetworkConfig's rule and credential tables account for nearly all of its
+ * almost half-megabyte footprint, and in typical configs they are almost
+ * entirely unused. This holds them on the heap instead: storage is created
+ * at full capacity (zero-initialized) on first mutable access, since the
+ * decode and controller assembly paths index through the decayed pointer
+ * with no per-write hook, and compact() then shrinks it to the element
+ * count actually decoded. The implicit conversions let existing code treat
+ * this exactly like the plain in-line array it replaces. Copies are deep
+ * and copy only what is allocated.
+ */
+template<typename T,unsigned int C>
+class NetworkConfigArray
+{
+public:
+	NetworkConfigArray() : _a((T *)0),_n(0) {}
+	NetworkConfigArray(const NetworkConfigArray &ar) : _a((T *)0),_n(0) { *this = ar; }
+	~NetworkConfigArray() { delete [] _a; }
+
+	inline NetworkConfigArray &operator=(const NetworkConfigArray &ar)
+	{
+		if (&ar != this) {
+			delete [] _a;
+			_a = (T *)0;
+			_n = 0;
+			if (ar._n > 0) {
+				_a = new T[ar._n]();
+				_n = ar._n;
+				for(unsigned int i=0;i<_n;++i) {
+					_a[i] = ar._a[i];
+				}
+			}
+		}
+		return *this;
+	}
+
+	/**
+	 * Decay to a mutable pointer, allocating at full capacity on first use
+	 */
+	inline operator T *()
+	{
+		if (!_a) {
+			_a = new T[C]();
+			_n = C;
+		}
+		return _a;
+	}
+
+	/**
+	 * Decay to a const pointer (NULL if nothing has been written yet)
+	 */
+	inline operator const T *() const { return _a; }
+
+	/**
+	 * Release all storage beyond the given number of leading elements
+	 *
+	 * @param count Number of elements actually in use
+	 */
+	inline void compact(const unsigned int count)
+	{
+		if ((_a)&&(count < _n)) {
+			if (count == 0) {
+				delete [] _a;
+				_a = (T *)0;
+				_n = 0;
+			} else {
+				T *const na = new T[count]();
+				for(unsigned int i=0;i<count;++i) {
+					na[i] = _a[i];
+				}
+				delete [] _a;
+				_a = na;
+				_n = count;
+			}
+		}
+	}
+
+private:
+	T *_a;
+	unsigned int _n;
+};
+
 /**
  * Network configuration received from network controller nodes
  *
- * This is a memcpy()'able structure and is safe (in a crash sense) to modify
- * without locks.
+ * The bulk rule and credential tables are heap backed (see
+ * NetworkConfigArray) and sized to their contents, so this must be copied
+ * with its copy constructor or assignment operator rather than memcpy().
  */
 class NetworkConfig
 {
@@ -267,6 +376,7 @@ public:
 		capabilityCount(0),
 		tagCount(0),
 		certificateOfOwnershipCount(0),
+		trustedPathCount(0),
 		capabilities(),
 		tags(),
 		certificatesOfOwnership(),
@@ -285,7 +395,7 @@ public:
 		memset(specialists, 0, sizeof(uint64_t)*ZT_MAX_NETWORK_SPECIALISTS);
 		memset(routes, 0, sizeof(ZT_VirtualNetworkRoute)*ZT_MAX_NETWORK_ROUTES);
 		memset(staticIps, 0, sizeof(InetAddress)*ZT_MAX_ZT_ASSIGNED_ADDRESSES);
-		memset(rules, 0, sizeof(ZT_VirtualNetworkRule)*ZT_MAX_NETWORK_RULES);
+		memset(trustedPathIds, 0, sizeof(uint64_t)*ZT_MAX_NETWORK_TRUSTED_PATHS);
 		memset(&dns, 0, sizeof(ZT_VirtualNetworkDNS));
 		memset(authenticationURL, 0, sizeof(authenticationURL));
 		memset(issuerURL, 0, sizeof(issuerURL));
@@ -294,6 +404,8 @@ public:
 		memset(ssoState, 0, sizeof(ssoState));
 		memset(ssoClientID, 0, sizeof(ssoClientID));
 		strncpy(ssoProvider, "default", sizeof(ssoProvider));
+		for(unsigned int i=0;i<64;++i)
+			dscpMap[i] = (uint8_t)i;
 	}
 
 	/**
@@ -313,6 +425,14 @@ public:
 	 */
 	bool fromDictionary(const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &d);
 
+	/**
+	 * (Re)compile the rule evaluator's jump-threading table (see ruleResume)
+	 *
+	 * Called automatically by fromDictionary(). Must be called again if the
+	 * rule array is modified directly.
+	 */
+	void compileRuleResumeTable();
+
 	/**
 	 * @return True if broadcast (ff:ff:ff:ff:ff:ff) address should work on this network
 	 */
@@ -339,6 +459,32 @@ public:
 #endif
 	}
 
+	/**
+	 * Unicast frame compression was disabled by default in 1.4.8 since it almost
+	 * never helps on typical traffic. Networks carrying mostly compressible bulk
+	 * data over bandwidth-constrained WAN links can opt back in via this flag.
+	 *
+	 * @return True if large unicast frames should be compressed before send
+	 */
+	inline bool enableUnicastCompression() const
+	{
+#ifndef ZT_DISABLE_COMPRESSION
+		return (((this->flags & ZT_NETWORKCONFIG_FLAG_ENABLE_UNICAST_COMPRESSION) != 0)&&(!disableCompression()));
+#else
+		return false;
+#endif
+	}
+
+	/**
+	 * @return True if frames should pass through the QoS/AQM egress scheduler
+	 */
+	inline bool enableQos() const { return ((this->flags & ZT_NETWORKCONFIG_FLAG_ENABLE_QOS) != 0); }
+
+	/**
+	 * @return True if multicast fan-out may armor once with a shared group key instead of per destination
+	 */
+	inline bool groupKeyedMulticastEnabled() const { return ((this->flags & ZT_NETWORKCONFIG_FLAG_ENABLE_GROUP_KEYED_MULTICAST) != 0); }
+
 	/**
 	 * @return Network type is public (no access control)
 	 */
@@ -473,7 +619,7 @@ public:
 	}
 
 	inline operator bool() const { return (networkId != 0); }
-	inline bool operator==(const NetworkConfig &nc) const { return (memcmp(this,&nc,sizeof(NetworkConfig)) == 0); }
+	bool operator==(const NetworkConfig &nc) const;
 	inline bool operator!=(const NetworkConfig &nc) const { return (!(*this == nc)); }
 
 	/**
@@ -607,6 +753,11 @@ public:
 	 */
 	unsigned int certificateOfOwnershipCount;
 
+	/**
+	 * Number of controller-designated trusted physical path subnets
+	 */
+	unsigned int trustedPathCount;
+
 	/**
 	 * Specialist devices
 	 *
@@ -625,25 +776,50 @@ public:
 	 */
 	InetAddress staticIps[ZT_MAX_ZT_ASSIGNED_ADDRESSES];
 
+	/**
+	 * Controller-designated trusted physical path subnets (1.10.7+)
+	 *
+	 * Direct paths whose physical address falls within one of these subnets
+	 * are treated exactly like a local.conf trusted path with the paired ID:
+	 * packet encryption and MAC checking are skipped for line-rate
+	 * forwarding. All members receive the same signed designations, so both
+	 * ends of a path agree on the ID without any extra negotiation. Only
+	 * private and shared scope subnets are honored; see
+	 * Topology::setNetworkTrustedPaths().
+	 */
+	InetAddress trustedPathNetworks[ZT_MAX_NETWORK_TRUSTED_PATHS];
+	uint64_t trustedPathIds[ZT_MAX_NETWORK_TRUSTED_PATHS];
+
 	/**
 	 * Base network rules
 	 */
-	ZT_VirtualNetworkRule rules[ZT_MAX_NETWORK_RULES];
+	NetworkConfigArray<ZT_VirtualNetworkRule,ZT_MAX_NETWORK_RULES> rules;
+
+	/**
+	 * Jump-threading table for the rule evaluator, compiled by compileRuleResumeTable()
+	 *
+	 * For each rule index this holds the index of the next entry that can
+	 * still affect the outcome once the current match set has failed: the
+	 * set's terminating ACTION or an OR-condition match, whichever comes
+	 * first. The evaluator uses it to hop over runs of doomed AND matches
+	 * instead of dispatching on every one.
+	 */
+	NetworkConfigArray<uint16_t,ZT_MAX_NETWORK_RULES> ruleResume;
 
 	/**
 	 * Capabilities for this node on this network, in ascending order of capability ID
 	 */
-	Capability capabilities[ZT_MAX_NETWORK_CAPABILITIES];
+	NetworkConfigArray<Capability,ZT_MAX_NETWORK_CAPABILITIES> capabilities;
 
 	/**
 	 * Tags for this node on this network, in ascending order of tag ID
 	 */
-	Tag tags[ZT_MAX_NETWORK_TAGS];
+	NetworkConfigArray<Tag,ZT_MAX_NETWORK_TAGS> tags;
 
 	/**
 	 * Certificates of ownership for this network member
 	 */
-	CertificateOfOwnership certificatesOfOwnership[ZT_MAX_CERTIFICATES_OF_OWNERSHIP];
+	NetworkConfigArray<CertificateOfOwnership,ZT_MAX_CERTIFICATES_OF_OWNERSHIP> certificatesOfOwnership;
 
 	/**
 	 * Network type (currently just public or private)
@@ -670,6 +846,16 @@ public:
 	 */
 	ZT_VirtualNetworkDNS dns;
 
+	/**
+	 * Inner-to-outer DSCP policy map (1.10.7+)
+	 *
+	 * Indexed by the DSCP of the inner IP frame; the value is the DSCP the
+	 * service marks on the outer UDP packet so provider QoS can tell
+	 * prioritized inner traffic apart. Defaults to a straight copy; an
+	 * all-zero map disables propagation for the network.
+	 */
+	uint8_t dscpMap[64];
+
 	/**
 	 * SSO enabled flag.
 	 */
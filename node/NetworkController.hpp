@@ -59,6 +59,22 @@ public:
 		 */
 		virtual void ncSendConfig(uint64_t nwid,uint64_t requestPacketId,const Address &destination,const NetworkConfig &nc,bool sendLegacyFormatConfig) = 0;
 
+		/**
+		 * Send a pre-serialized network configuration dictionary (1.10.7+)
+		 *
+		 * Blob form of ncSendConfig() for controllers that cache built
+		 * configs: the dictionary is already serialized and its credentials
+		 * signed, so only per-request chunking and signing remain. Must not
+		 * be used when the destination is the controller node itself.
+		 *
+		 * @param nwid Network ID
+		 * @param requestPacketId Request packet ID to send OK(NETWORK_CONFIG_REQUEST) or 0 to send NETWORK_CONFIG (push)
+		 * @param destination Destination peer Address
+		 * @param dictData Serialized network config dictionary
+		 * @param dictLen Length of dictData in bytes
+		 */
+		virtual void ncSendConfigBlob(uint64_t nwid,uint64_t requestPacketId,const Address &destination,const void *dictData,unsigned int dictLen) = 0;
+
 		/**
 		 * Send revocation to a node
 		 *
@@ -31,6 +31,7 @@
 #include "Packet.hpp"
 #include "Address.hpp"
 #include "Identity.hpp"
+#include "SHA512.hpp"
 #include "SelfAwareness.hpp"
 #include "Network.hpp"
 #include "Trace.hpp"
@@ -49,6 +50,9 @@ Node::Node(void *uptr,void *tptr,const struct ZT_Node_Callbacks *callbacks,int64
 	_networks(8),
 	_now(now),
 	_lastPingCheck(0),
+	_lastPingSlice(0),
+	_upstreamsCold(true),
+	_pingSliceShard(0),
 	_lastGratuitousPingCheck(0),
 	_lastHousekeepingRun(0),
 	_lastMemoizedTraceSettings(0),
@@ -79,6 +83,31 @@ Node::Node(void *uptr,void *tptr,const struct ZT_Node_Callbacks *callbacks,int64
 		if (RR->identity.fromString(tmp)) {
 			RR->identity.toString(false,RR->publicIdentityStr);
 			RR->identity.toString(true,RR->secretIdentityStr);
+
+			// Validate the loaded identity. Full locallyValidate() is
+			// memory-hard and costs a material slice of a container cold
+			// start, so its result is cached as a MAC over the identity
+			// string keyed by a locally stored random secret; a boot with a
+			// byte-identical identity verifies the MAC and skips the hashcash
+			// recomputation. An identity failing both checks is treated like
+			// an unparseable one.
+			idtmp[0] = RR->identity.address().toInt();
+			uint8_t vtoken[32 + ZT_HMACSHA384_LEN];
+			uint8_t vmac[ZT_HMACSHA384_LEN];
+			bool validated = false;
+			if (stateObjectGet(tptr,ZT_STATE_OBJECT_IDENTITY_VALIDATION,idtmp,vtoken,sizeof(vtoken)) == (int)sizeof(vtoken)) {
+				HMACSHA384(vtoken,RR->secretIdentityStr,(unsigned int)strlen(RR->secretIdentityStr),vmac);
+				validated = (memcmp(vmac,vtoken + 32,ZT_HMACSHA384_LEN) == 0);
+			}
+			if (!validated) {
+				if (RR->identity.locallyValidate()) {
+					Utils::getSecureRandom(vtoken,32);
+					HMACSHA384(vtoken,RR->secretIdentityStr,(unsigned int)strlen(RR->secretIdentityStr),vtoken + 32);
+					stateObjectPut(tptr,ZT_STATE_OBJECT_IDENTITY_VALIDATION,idtmp,vtoken,sizeof(vtoken));
+				} else {
+					n = -1;
+				}
+			}
 		} else {
 			n = -1;
 		}
@@ -92,6 +121,14 @@ Node::Node(void *uptr,void *tptr,const struct ZT_Node_Callbacks *callbacks,int64
 		idtmp[1] = 0;
 		stateObjectPut(tptr,ZT_STATE_OBJECT_IDENTITY_SECRET,idtmp,RR->secretIdentityStr,(unsigned int)strlen(RR->secretIdentityStr));
 		stateObjectPut(tptr,ZT_STATE_OBJECT_IDENTITY_PUBLIC,idtmp,RR->publicIdentityStr,(unsigned int)strlen(RR->publicIdentityStr));
+		{
+			// generate() output is valid by construction, so seed the
+			// validation cache right away
+			uint8_t vtoken[32 + ZT_HMACSHA384_LEN];
+			Utils::getSecureRandom(vtoken,32);
+			HMACSHA384(vtoken,RR->secretIdentityStr,(unsigned int)strlen(RR->secretIdentityStr),vtoken + 32);
+			stateObjectPut(tptr,ZT_STATE_OBJECT_IDENTITY_VALIDATION,idtmp,vtoken,sizeof(vtoken));
+		}
 	} else {
 		idtmp[0] = RR->identity.address().toInt();
 		idtmp[1] = 0;
@@ -199,6 +236,22 @@ ZT_ResultCode Node::processWirePacket(
 	return ZT_RESULT_OK;
 }
 
+ZT_ResultCode Node::processWirePacketLended(
+	void *tptr,
+	int64_t now,
+	int64_t localSocket,
+	const struct sockaddr_storage *remoteAddress,
+	void *packetData,
+	unsigned int packetLength,
+	ZT_BufferFreeFunction freeFunction,
+	void *freeFunctionArg,
+	volatile int64_t *nextBackgroundTaskDeadline)
+{
+	_now = now;
+	RR->sw->onRemotePacketLended(tptr,localSocket,*(reinterpret_cast<const InetAddress *>(remoteAddress)),packetData,packetLength,freeFunction,freeFunctionArg);
+	return ZT_RESULT_OK;
+}
+
 ZT_ResultCode Node::processVirtualNetworkFrame(
 	void *tptr,
 	int64_t now,
@@ -221,6 +274,27 @@ ZT_ResultCode Node::processVirtualNetworkFrame(
 	}
 }
 
+ZT_ResultCode Node::processVirtualNetworkFrames(
+	void *tptr,
+	int64_t now,
+	uint64_t nwid,
+	const ZT_VirtualNetworkFrame *frames,
+	unsigned int frameCount,
+	volatile int64_t *nextBackgroundTaskDeadline)
+{
+	_now = now;
+	// One network lookup (and thus one pass through the networks lock) for
+	// the whole batch; the frames then go straight into the switch.
+	SharedPtr<Network> nw(this->network(nwid));
+	if (!nw) {
+		return ZT_RESULT_ERROR_NETWORK_NOT_FOUND;
+	}
+	for(unsigned int i=0;i<frameCount;++i) {
+		RR->sw->onLocalEthernet(tptr,nw,MAC(frames[i].sourceMac),MAC(frames[i].destMac),frames[i].etherType,frames[i].vlanId,frames[i].frameData,frames[i].frameLength);
+	}
+	return ZT_RESULT_OK;
+}
+
 // Closure used to ping upstream and active/online peers
 class _PingPeersThatNeedPing
 {
@@ -292,6 +366,28 @@ private:
 	const SharedPtr<Peer> _bestCurrentUpstream;
 };
 
+// Closure used to send keepalives to active peers, one peer table shard at a time
+class _PingActivePeers
+{
+public:
+	_PingActivePeers(void *tPtr,int64_t now) :
+		_tPtr(tPtr),
+		_now(now)
+	{
+	}
+
+	inline void operator()(Topology &t,const SharedPtr<Peer> &p)
+	{
+		if (p->isActive(_now)) {
+			p->doPingAndKeepalive(_tPtr,_now);
+		}
+	}
+
+private:
+	void *_tPtr;
+	const int64_t _now;
+};
+
 ZT_ResultCode Node::processBackgroundTasks(void *tptr,int64_t now,volatile int64_t *nextBackgroundTaskDeadline)
 {
 	_now = now;
@@ -307,6 +403,34 @@ ZT_ResultCode Node::processBackgroundTasks(void *tptr,int64_t now,volatile int64
 		}
 	}
 
+	// On the first background pass after startup, HELLO every stable
+	// endpoint of every upstream in parallel rather than letting the regular
+	// ping check pick one random endpoint per address family. First response
+	// wins: whichever endpoint answers first becomes the initial path, and
+	// best-root selection then settles on the lowest-latency responder. This
+	// cuts cold-boot time to a usable root (and thus to WHOIS and rendezvous)
+	// when the randomly chosen endpoint would have been unreachable or slow.
+	if (_upstreamsCold) {
+		_upstreamsCold = false;
+		try {
+			Hashtable< Address,std::vector<InetAddress> > upstreams;
+			RR->topology->getUpstreamsToContact(upstreams,now);
+			Hashtable< Address,std::vector<InetAddress> >::Iterator i(upstreams);
+			Address *upstreamAddress = (Address *)0;
+			std::vector<InetAddress> *upstreamStableEndpoints = (std::vector<InetAddress> *)0;
+			while (i.next(upstreamAddress,upstreamStableEndpoints)) {
+				const SharedPtr<Peer> p(RR->topology->getPeerNoCache(*upstreamAddress));
+				if (p) {
+					for(std::vector<InetAddress>::const_iterator ep(upstreamStableEndpoints->begin());ep!=upstreamStableEndpoints->end();++ep) {
+						p->sendHELLO(tptr,-1,*ep,now);
+					}
+				} else {
+					RR->sw->requestWhois(tptr,now,*upstreamAddress);
+				}
+			}
+		} catch ( ... ) {}
+	}
+
 	unsigned long timeUntilNextPingCheck = _lowBandwidthMode ? (ZT_PING_CHECK_INVERVAL * 5) : ZT_PING_CHECK_INVERVAL;
 	const int64_t timeSinceLastPingCheck = now - _lastPingCheck;
 	if (timeSinceLastPingCheck >= timeUntilNextPingCheck) {
@@ -315,7 +439,7 @@ ZT_ResultCode Node::processBackgroundTasks(void *tptr,int64_t now,volatile int64
 
 			// Get designated VL1 upstreams
 			Hashtable< Address,std::vector<InetAddress> > alwaysContact;
-			RR->topology->getUpstreamsToContact(alwaysContact);
+			RR->topology->getUpstreamsToContact(alwaysContact,now);
 
 			// Uncomment to dump stats
 			/*
@@ -369,9 +493,20 @@ ZT_ResultCode Node::processBackgroundTasks(void *tptr,int64_t now,volatile int64
 				}
 			}
 
-			// Ping active peers, upstreams, and others that we should always contact
-			_PingPeersThatNeedPing pfunc(RR,tptr,alwaysContact,now);
-			RR->topology->eachPeer<_PingPeersThatNeedPing &>(pfunc);
+			// Contact upstreams and other always-contact peers by direct lookup
+			// rather than by scanning the whole peer table. Keepalives for
+			// ordinary active peers are handled by the sharded scan below, so
+			// this pass only touches peers that actually have work due.
+			{
+				_PingPeersThatNeedPing pfunc(RR,tptr,alwaysContact,now);
+				const std::vector<Address> ac(alwaysContact.keys());
+				for(std::vector<Address>::const_iterator a(ac.begin());a!=ac.end();++a) {
+					const SharedPtr<Peer> p(RR->topology->getPeerNoCache(*a));
+					if (p) {
+						pfunc(*RR->topology,p);
+					}
+				}
+			}
 
 			// Run WHOIS to create Peer for alwaysContact addresses that could not be contacted
 			{
@@ -406,11 +541,31 @@ ZT_ResultCode Node::processBackgroundTasks(void *tptr,int64_t now,volatile int64
 		timeUntilNextPingCheck -= (unsigned long)timeSinceLastPingCheck;
 	}
 
+	// Send keepalives to active peers one peer table shard per tick. This
+	// spreads what used to be a single full-table scan every ping check
+	// across many small slices while still visiting every peer once per
+	// ping check interval.
+	unsigned long timeUntilNextPingSlice = std::max((unsigned long)((_lowBandwidthMode ? (ZT_PING_CHECK_INVERVAL * 5) : ZT_PING_CHECK_INVERVAL) / ZT_TOPOLOGY_PEER_SHARDS),(unsigned long)ZT_CORE_TIMER_TASK_GRANULARITY);
+	const int64_t timeSinceLastPingSlice = now - _lastPingSlice;
+	if (timeSinceLastPingSlice >= (int64_t)timeUntilNextPingSlice) {
+		_lastPingSlice = now;
+		try {
+			_PingActivePeers pfunc(tptr,now);
+			RR->topology->eachPeerInShard<_PingActivePeers &>(pfunc,_pingSliceShard++);
+		} catch ( ... ) {
+			return ZT_RESULT_FATAL_ERROR_INTERNAL;
+		}
+	} else {
+		timeUntilNextPingSlice -= (unsigned long)timeSinceLastPingSlice;
+	}
+
 	if ((now - _lastMemoizedTraceSettings) >= (ZT_HOUSEKEEPING_PERIOD / 4)) {
 		_lastMemoizedTraceSettings = now;
 		RR->t->updateMemoizedSettings();
 	}
 
+	RR->t->flushTraceBuffers(tptr,now);
+
 	if ((now - _lastHousekeepingRun) >= ZT_HOUSEKEEPING_PERIOD) {
 		_lastHousekeepingRun = now;
 		try {
@@ -423,7 +578,7 @@ ZT_ResultCode Node::processBackgroundTasks(void *tptr,int64_t now,volatile int64
 	}
 
 	try {
-		*nextBackgroundTaskDeadline = now + (int64_t)std::max(std::min(bondCheckInterval,std::min(timeUntilNextPingCheck,RR->sw->doTimerTasks(tptr,now))),(unsigned long)ZT_CORE_TIMER_TASK_GRANULARITY);
+		*nextBackgroundTaskDeadline = now + (int64_t)std::max(std::min(bondCheckInterval,std::min(std::min(timeUntilNextPingCheck,timeUntilNextPingSlice),RR->sw->doTimerTasks(tptr,now))),(unsigned long)ZT_CORE_TIMER_TASK_GRANULARITY);
 	} catch ( ... ) {
 		return ZT_RESULT_FATAL_ERROR_INTERNAL;
 	}
@@ -565,6 +720,10 @@ ZT_PeerList *Node::peers() const
 				p->paths[p->pathCount].localSocket = (*path)->localSocket();
 				p->paths[p->pathCount].lastSend = (*path)->lastOut();
 				p->paths[p->pathCount].lastReceive = (*path)->lastIn();
+				p->paths[p->pathCount].bytesIn = (*path)->bytesIn();
+				p->paths[p->pathCount].bytesOut = (*path)->bytesOut();
+				p->paths[p->pathCount].rateIn = (*path)->ewmaRateIn(_now);
+				p->paths[p->pathCount].rateOut = (*path)->ewmaRateOut(_now);
 				p->paths[p->pathCount].trustedPathId = RR->topology->getOutboundPathTrust((*path)->address());
 				p->paths[p->pathCount].expired = 0;
 				p->paths[p->pathCount].preferred = ((*path) == bestp) ? 1 : 0;
@@ -678,6 +837,28 @@ void Node::setNetconfMaster(void *networkControllerInstance)
 	}
 }
 
+void Node::setRxWorkerThreads(unsigned int threadCount,const unsigned int *pinCpus,unsigned int pinCpuCount)
+{
+	RR->sw->setRxWorkerThreads(threadCount,pinCpus,pinCpuCount);
+}
+
+void Node::setRxQueueMemoryBudget(uint64_t bytes)
+{
+	RR->sw->setRxQueueMemoryBudget(bytes);
+}
+
+static thread_local unsigned int _tlTxWireDscp = 0;
+
+void Node::setTxWireDscp(unsigned int dscp)
+{
+	_tlTxWireDscp = (dscp & 0x3f);
+}
+
+unsigned int Node::txWireDscp()
+{
+	return _tlTxWireDscp;
+}
+
 /****************************************************************************/
 /* Node methods used only within node/                                      */
 /****************************************************************************/
@@ -711,6 +892,13 @@ bool Node::shouldUsePathForZeroTierTraffic(void *tPtr,const Address &ztaddr,cons
 	return ( (_cb.pathCheckFunction) ? (_cb.pathCheckFunction(reinterpret_cast<ZT_Node *>(this),_uPtr,tPtr,ztaddr.toInt(),localSocket,reinterpret_cast<const struct sockaddr_storage *>(&remoteAddress)) != 0) : true);
 }
 
+void Node::prefetchPeer(void *tPtr,const Address &ztaddr)
+{
+	if ((ztaddr)&&(ztaddr != RR->identity.address())) {
+		RR->topology->getPeer(tPtr,ztaddr); // loads from the peer cache on miss and attempts contact at cached paths
+	}
+}
+
 uint64_t Node::prng()
 {
 	// https://en.wikipedia.org/wiki/Xorshift#xorshift.2B
@@ -741,11 +929,11 @@ std::vector<World> Node::moons() const
 
 void Node::ncSendConfig(uint64_t nwid,uint64_t requestPacketId,const Address &destination,const NetworkConfig &nc,bool sendLegacyFormatConfig)
 {
-	_localControllerAuthorizations_m.lock();
-	_localControllerAuthorizations[_LocalControllerAuth(nwid,destination)] = now();
-	_localControllerAuthorizations_m.unlock();
-
 	if (destination == RR->identity.address()) {
+		_localControllerAuthorizations_m.lock();
+		_localControllerAuthorizations[_LocalControllerAuth(nwid,destination)] = now();
+		_localControllerAuthorizations_m.unlock();
+
 		SharedPtr<Network> n(network(nwid));
 		if (!n) {
 			return;
@@ -755,40 +943,7 @@ void Node::ncSendConfig(uint64_t nwid,uint64_t requestPacketId,const Address &de
 		Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *dconf = new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>();
 		try {
 			if (nc.toDictionary(*dconf,sendLegacyFormatConfig)) {
-				uint64_t configUpdateId = prng();
-				if (!configUpdateId) {
-					++configUpdateId;
-				}
-
-				const unsigned int totalSize = dconf->sizeBytes();
-				unsigned int chunkIndex = 0;
-				while (chunkIndex < totalSize) {
-					const unsigned int chunkLen = std::min(totalSize - chunkIndex,(unsigned int)(ZT_PROTO_MAX_PACKET_LENGTH - (ZT_PACKET_IDX_PAYLOAD + 256)));
-					Packet outp(destination,RR->identity.address(),(requestPacketId) ? Packet::VERB_OK : Packet::VERB_NETWORK_CONFIG);
-					if (requestPacketId) {
-						outp.append((unsigned char)Packet::VERB_NETWORK_CONFIG_REQUEST);
-						outp.append(requestPacketId);
-					}
-
-					const unsigned int sigStart = outp.size();
-					outp.append(nwid);
-					outp.append((uint16_t)chunkLen);
-					outp.append((const void *)(dconf->data() + chunkIndex),chunkLen);
-
-					outp.append((uint8_t)0); // no flags
-					outp.append((uint64_t)configUpdateId);
-					outp.append((uint32_t)totalSize);
-					outp.append((uint32_t)chunkIndex);
-
-					C25519::Signature sig(RR->identity.sign(reinterpret_cast<const uint8_t *>(outp.data()) + sigStart,outp.size() - sigStart));
-					outp.append((uint8_t)1);
-					outp.append((uint16_t)ZT_C25519_SIGNATURE_LEN);
-					outp.append(sig.data,ZT_C25519_SIGNATURE_LEN);
-
-					outp.compress();
-					RR->sw->send((void *)0,outp,true);
-					chunkIndex += chunkLen;
-				}
+				ncSendConfigBlob(nwid,requestPacketId,destination,dconf->data(),dconf->sizeBytes());
 			}
 			delete dconf;
 		} catch ( ... ) {
@@ -798,6 +953,48 @@ void Node::ncSendConfig(uint64_t nwid,uint64_t requestPacketId,const Address &de
 	}
 }
 
+void Node::ncSendConfigBlob(uint64_t nwid,uint64_t requestPacketId,const Address &destination,const void *dictData,unsigned int dictLen)
+{
+	_localControllerAuthorizations_m.lock();
+	_localControllerAuthorizations[_LocalControllerAuth(nwid,destination)] = now();
+	_localControllerAuthorizations_m.unlock();
+
+	uint64_t configUpdateId = prng();
+	if (!configUpdateId) {
+		++configUpdateId;
+	}
+
+	const unsigned int totalSize = dictLen;
+	unsigned int chunkIndex = 0;
+	while (chunkIndex < totalSize) {
+		const unsigned int chunkLen = std::min(totalSize - chunkIndex,(unsigned int)(ZT_PROTO_MAX_PACKET_LENGTH - (ZT_PACKET_IDX_PAYLOAD + 256)));
+		Packet outp(destination,RR->identity.address(),(requestPacketId) ? Packet::VERB_OK : Packet::VERB_NETWORK_CONFIG);
+		if (requestPacketId) {
+			outp.append((unsigned char)Packet::VERB_NETWORK_CONFIG_REQUEST);
+			outp.append(requestPacketId);
+		}
+
+		const unsigned int sigStart = outp.size();
+		outp.append(nwid);
+		outp.append((uint16_t)chunkLen);
+		outp.append((const void *)(reinterpret_cast<const uint8_t *>(dictData) + chunkIndex),chunkLen);
+
+		outp.append((uint8_t)0); // no flags
+		outp.append((uint64_t)configUpdateId);
+		outp.append((uint32_t)totalSize);
+		outp.append((uint32_t)chunkIndex);
+
+		C25519::Signature sig(RR->identity.sign(reinterpret_cast<const uint8_t *>(outp.data()) + sigStart,outp.size() - sigStart));
+		outp.append((uint8_t)1);
+		outp.append((uint16_t)ZT_C25519_SIGNATURE_LEN);
+		outp.append(sig.data,ZT_C25519_SIGNATURE_LEN);
+
+		outp.compress();
+		RR->sw->send((void *)0,outp,true);
+		chunkIndex += chunkLen;
+	}
+}
+
 void Node::ncSendRevocation(const Address &destination,const Revocation &rev)
 {
 	if (destination == RR->identity.address()) {
@@ -922,6 +1119,27 @@ enum ZT_ResultCode ZT_Node_processWirePacket(
 	}
 }
 
+enum ZT_ResultCode ZT_Node_processWirePacketLended(
+	ZT_Node *node,
+	void *tptr,
+	int64_t now,
+	int64_t localSocket,
+	const struct sockaddr_storage *remoteAddress,
+	void *packetData,
+	unsigned int packetLength,
+	ZT_BufferFreeFunction freeFunction,
+	void *freeFunctionArg,
+	volatile int64_t *nextBackgroundTaskDeadline)
+{
+	try {
+		return reinterpret_cast<ZeroTier::Node *>(node)->processWirePacketLended(tptr,now,localSocket,remoteAddress,packetData,packetLength,freeFunction,freeFunctionArg,nextBackgroundTaskDeadline);
+	} catch (std::bad_alloc &exc) {
+		return ZT_RESULT_FATAL_ERROR_OUT_OF_MEMORY;
+	} catch ( ... ) {
+		return ZT_RESULT_OK; // "OK" since invalid packets are simply dropped, but the system is still up
+	}
+}
+
 enum ZT_ResultCode ZT_Node_processVirtualNetworkFrame(
 	ZT_Node *node,
 	void *tptr,
@@ -944,6 +1162,24 @@ enum ZT_ResultCode ZT_Node_processVirtualNetworkFrame(
 	}
 }
 
+enum ZT_ResultCode ZT_Node_processVirtualNetworkFrames(
+	ZT_Node *node,
+	void *tptr,
+	int64_t now,
+	uint64_t nwid,
+	const ZT_VirtualNetworkFrame *frames,
+	unsigned int frameCount,
+	volatile int64_t *nextBackgroundTaskDeadline)
+{
+	try {
+		return reinterpret_cast<ZeroTier::Node *>(node)->processVirtualNetworkFrames(tptr,now,nwid,frames,frameCount,nextBackgroundTaskDeadline);
+	} catch (std::bad_alloc &exc) {
+		return ZT_RESULT_FATAL_ERROR_OUT_OF_MEMORY;
+	} catch ( ... ) {
+		return ZT_RESULT_FATAL_ERROR_INTERNAL;
+	}
+}
+
 enum ZT_ResultCode ZT_Node_processBackgroundTasks(ZT_Node *node,void *tptr,int64_t now,volatile int64_t *nextBackgroundTaskDeadline)
 {
 	try {
@@ -36,6 +36,7 @@
 #include "Hashtable.hpp"
 #include "Bond.hpp"
 #include "SelfAwareness.hpp"
+#include "Metrics.hpp"
 
 // Bit mask for "expecting reply" hash
 #define ZT_EXPECTING_REPLIES_BUCKET_MASK1 255
@@ -72,6 +73,16 @@ public:
 		const void *packetData,
 		unsigned int packetLength,
 		volatile int64_t *nextBackgroundTaskDeadline);
+	ZT_ResultCode processWirePacketLended(
+		void *tptr,
+		int64_t now,
+		int64_t localSocket,
+		const struct sockaddr_storage *remoteAddress,
+		void *packetData,
+		unsigned int packetLength,
+		ZT_BufferFreeFunction freeFunction,
+		void *freeFunctionArg,
+		volatile int64_t *nextBackgroundTaskDeadline);
 	ZT_ResultCode processVirtualNetworkFrame(
 		void *tptr,
 		int64_t now,
@@ -83,6 +94,13 @@ public:
 		const void *frameData,
 		unsigned int frameLength,
 		volatile int64_t *nextBackgroundTaskDeadline);
+	ZT_ResultCode processVirtualNetworkFrames(
+		void *tptr,
+		int64_t now,
+		uint64_t nwid,
+		const ZT_VirtualNetworkFrame *frames,
+		unsigned int frameCount,
+		volatile int64_t *nextBackgroundTaskDeadline);
 	ZT_ResultCode processBackgroundTasks(void *tptr,int64_t now,volatile int64_t *nextBackgroundTaskDeadline);
 	ZT_ResultCode join(uint64_t nwid,void *uptr,void *tptr);
 	ZT_ResultCode leave(uint64_t nwid,void **uptr,void *tptr);
@@ -101,6 +119,44 @@ public:
 	int sendUserMessage(void *tptr,uint64_t dest,uint64_t typeId,const void *data,unsigned int len);
 	void setNetconfMaster(void *networkControllerInstance);
 
+	/**
+	 * Set the number of incoming packet processing threads
+	 *
+	 * Must be called before packet I/O begins. See Switch::setRxWorkerThreads().
+	 *
+	 * @param threadCount Number of worker threads or 0 (the default) for single-threaded processing
+	 * @param pinCpus CPU indexes to pin workers to round-robin, or NULL for no pinning (Linux and FreeBSD only)
+	 * @param pinCpuCount Number of entries in pinCpus
+	 */
+	void setRxWorkerThreads(unsigned int threadCount,const unsigned int *pinCpus = (const unsigned int *)0,unsigned int pinCpuCount = 0);
+
+	/**
+	 * Set the memory budget for the RX reassembly/decode queue
+	 *
+	 * Must be called before packet I/O begins. See Switch::setRxQueueMemoryBudget().
+	 *
+	 * @param bytes Approximate budget in bytes, 0 for the compile-time default
+	 */
+	void setRxQueueMemoryBudget(uint64_t bytes);
+
+	/**
+	 * Set the DSCP to mark on outer packets sent from the calling thread (1.10.7+)
+	 *
+	 * The datapath classifies each inner frame and leaves the mapped DSCP
+	 * here before sending; the service's wire send callback reads it with
+	 * txWireDscp() and marks the outer UDP packet. Stored per thread, so
+	 * concurrent workers never see each other's values, and every frame
+	 * classification overwrites it (including back to zero).
+	 *
+	 * @param dscp DSCP value (0-63, 0 = default marking)
+	 */
+	static void setTxWireDscp(unsigned int dscp);
+
+	/**
+	 * @return The calling thread's pending outer-packet DSCP (0 = default)
+	 */
+	static unsigned int txWireDscp();
+
 	// Internal functions ------------------------------------------------------
 
 	inline int64_t now() const { return _now; }
@@ -120,6 +176,7 @@ public:
 
 	inline void putFrame(void *tPtr,uint64_t nwid,void **nuptr,const MAC &source,const MAC &dest,unsigned int etherType,unsigned int vlanId,const void *data,unsigned int len)
 	{
+		Metrics::SampledTimer _st(Metrics::tap_write_us);
 		_cb.virtualNetworkFrameFunction(
 			reinterpret_cast<ZT_Node *>(this),
 			_uPtr,
@@ -180,6 +237,18 @@ public:
 	inline void stateObjectDelete(void *const tPtr,ZT_StateObjectType type,const uint64_t id[2]) { _cb.statePutFunction(reinterpret_cast<ZT_Node *>(this),_uPtr,tPtr,type,id,(const void *)0,-1); }
 
 	bool shouldUsePathForZeroTierTraffic(void *tPtr,const Address &ztaddr,const int64_t localSocket,const InetAddress &remoteAddress);
+
+	/**
+	 * Load a cached peer (if any) and immediately attempt its last known direct paths
+	 *
+	 * This is used by the service at startup to warm-start connectivity from
+	 * the on-disk peer cache instead of waiting for the first packet to or
+	 * from each peer. It is a no-op for addresses with no cache entry.
+	 *
+	 * @param tPtr Thread pointer to pass to functions/callbacks resulting from this call
+	 * @param ztaddr ZeroTier address of cached peer
+	 */
+	void prefetchPeer(void *tPtr,const Address &ztaddr);
 	inline bool externalPathLookup(void *tPtr,const Address &ztaddr,int family,InetAddress &addr) { return ( (_cb.pathLookupFunction) ? (_cb.pathLookupFunction(reinterpret_cast<ZT_Node *>(this),_uPtr,tPtr,ztaddr.toInt(),family,reinterpret_cast<struct sockaddr_storage *>(&addr)) != 0) : false ); }
 
 	uint64_t prng();
@@ -250,6 +319,7 @@ public:
 	}
 
 	virtual void ncSendConfig(uint64_t nwid,uint64_t requestPacketId,const Address &destination,const NetworkConfig &nc,bool sendLegacyFormatConfig);
+	virtual void ncSendConfigBlob(uint64_t nwid,uint64_t requestPacketId,const Address &destination,const void *dictData,unsigned int dictLen);
 	virtual void ncSendRevocation(const Address &destination,const Revocation &rev);
 	virtual void ncSendError(uint64_t nwid,uint64_t requestPacketId,const Address &destination,NetworkController::ErrorCode errorCode, const void *errorData, unsigned int errorDataSize);
 
@@ -325,6 +395,9 @@ private:
 
 	volatile int64_t _now;
 	int64_t _lastPingCheck;
+	int64_t _lastPingSlice;
+	bool _upstreamsCold;
+	unsigned long _pingSliceShard;
 	int64_t _lastGratuitousPingCheck;
 	int64_t _lastHousekeepingRun;
 	int64_t _lastMemoizedTraceSettings;
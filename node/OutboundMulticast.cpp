@@ -39,6 +39,7 @@ void OutboundMulticast::init(
 
 	_timestamp = timestamp;
 	_nwid = nwid;
+	_gArmored = false;
 	if (src) {
 		_macSrc = src;
 		flags |= 0x04;
@@ -78,9 +79,37 @@ void OutboundMulticast::init(
 void OutboundMulticast::sendOnly(const RuntimeEnvironment *RR,void *tPtr,const Address &toAddr)
 {
 	const SharedPtr<Network> nw(RR->node->network(_nwid));
+	sendOnly(RR,tPtr,nw,toAddr);
+}
+
+void OutboundMulticast::sendOnly(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Network> &nw,const Address &toAddr)
+{
 	uint8_t QoSBucket = 255; // Dummy value
 	if ((nw)&&(nw->filterOutgoingPacket(tPtr,true,RR->identity.address(),toAddr,_macSrc,_macDest,_frameData,_frameLen,_etherType,0,QoSBucket))) {
 		nw->pushCredentialsIfNeeded(tPtr,toAddr,RR->node->now());
+
+		// Group-keyed fast path: armor the frame once with the network's
+		// multicast group key, then serve every supporting member from that
+		// one ciphertext with just a destination patch. The per-destination
+		// path below remains for members whose key push is still in flight
+		// and for peers that never advertised support.
+		if (nw->config().groupKeyedMulticastEnabled()) {
+			const SharedPtr<Peer> peer(RR->topology->getPeerNoCache(toAddr));
+			if ((peer)&&(peer->remoteSupportsGroupKeys())&&(nw->multicastGroupKeyReadyFor(toAddr))) {
+				if (!_gArmored) {
+					_gtmp = _packet;
+					_gtmp.newInitializationVector();
+					_gtmp.armorGroup(nw->multicastGroupKey());
+					_gArmored = true;
+				}
+				_tmp = _gtmp;
+				_tmp.setDestination(toAddr);
+				RR->node->expectReplyTo(_tmp.packetId());
+				RR->sw->send(tPtr,_tmp,true);
+				return;
+			}
+		}
+
 		_packet.newInitializationVector();
 		_packet.setDestination(toAddr);
 		RR->node->expectReplyTo(_packet.packetId());
@@ -24,10 +24,12 @@
 #include "MulticastGroup.hpp"
 #include "Address.hpp"
 #include "Packet.hpp"
+#include "SharedPtr.hpp"
 
 namespace ZeroTier {
 
 class CertificateOfMembership;
+class Network;
 class RuntimeEnvironment;
 
 /**
@@ -99,6 +101,19 @@ public:
 	 */
 	void sendOnly(const RuntimeEnvironment *RR,void *tPtr,const Address &toAddr);
 
+	/**
+	 * Just send without checking log, with the network already resolved
+	 *
+	 * Used when fanning a frame out to many destinations at once so the
+	 * network is not looked up again for every member.
+	 *
+	 * @param RR Runtime environment
+	 * @param tPtr Thread pointer to be handed through to any callbacks called as a result of this call
+	 * @param nw Network this multicast belongs to
+	 * @param toAddr Destination address
+	 */
+	void sendOnly(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Network> &nw,const Address &toAddr);
+
 	/**
 	 * Just send and log but do not check sent log
 	 *
@@ -112,6 +127,20 @@ public:
 		sendOnly(RR,tPtr,toAddr);
 	}
 
+	/**
+	 * Just send and log but do not check sent log, with the network already resolved
+	 *
+	 * @param RR Runtime environment
+	 * @param tPtr Thread pointer to be handed through to any callbacks called as a result of this call
+	 * @param nw Network this multicast belongs to
+	 * @param toAddr Destination address
+	 */
+	inline void sendAndLog(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Network> &nw,const Address &toAddr)
+	{
+		_alreadySentTo.push_back(toAddr);
+		sendOnly(RR,tPtr,nw,toAddr);
+	}
+
 	/**
 	 * Log an address as having been used so we will not send there in the future
 	 *
@@ -149,6 +178,8 @@ private:
 	unsigned int _frameLen;
 	unsigned int _etherType;
 	Packet _packet,_tmp;
+	Packet _gtmp; // group-armored copy of _packet, built lazily on first eligible destination
+	bool _gArmored;
 	std::vector<Address> _alreadySentTo;
 	uint8_t _frameData[ZT_MAX_MTU];
 };
@@ -18,6 +18,7 @@
 #include <stdio.h>
 
 #include "Packet.hpp"
+#include "Metrics.hpp"
 
 #if defined(ZT_USE_X64_ASM_SALSA2012) && defined(ZT_ARCH_X64)
 #include "../ext/x64-salsa2012-asm/salsa2012.h"
@@ -1009,7 +1010,6 @@ void Packet::armor(const void *key,bool encryptPayload,const AES aesKeys[2])
 {
 	uint8_t *const data = reinterpret_cast<uint8_t *>(unsafeData());
 	if ((aesKeys) && (encryptPayload)) {
-		//char tmp0[16],tmp1[16];
 		setCipher(ZT_PROTO_CIPHER_SUITE__AES_GMAC_SIV);
 
 		uint8_t *const payload = data + ZT_PACKET_IDX_VERB;
@@ -1037,12 +1037,32 @@ void Packet::armor(const void *key,bool encryptPayload,const AES aesKeys[2])
 		_salsa20MangleKey((const unsigned char *)key,mangledKey);
 
 		if (ZT_HAS_FAST_CRYPTO()) {
-			const unsigned int payloadLen = (encryptPayload) ? (size() - ZT_PACKET_IDX_VERB) : 0;
+			const unsigned int macLen = size() - ZT_PACKET_IDX_VERB;
+			const unsigned int payloadLen = (encryptPayload) ? macLen : 0;
 			uint64_t keyStream[(ZT_PROTO_MAX_PACKET_LENGTH + 64 + 8) / 8];
 			ZT_FAST_SINGLE_PASS_SALSA2012(keyStream,payloadLen + 64,(data + ZT_PACKET_IDX_IV),mangledKey);
-			Salsa20::memxor(data + ZT_PACKET_IDX_VERB,reinterpret_cast<const uint8_t *>(keyStream + 8),payloadLen);
+
+			// Single in-place sweep: XOR each cache-sized chunk of keystream
+			// into the buffer and immediately MAC the resulting ciphertext
+			// while it is still hot, instead of a full encrypt pass followed
+			// by a full Poly1305 pass.
+			Poly1305 poly;
+			poly.init(keyStream);
+			const uint8_t *const ks = reinterpret_cast<const uint8_t *>(keyStream + 8);
+			unsigned int done = 0;
+			while (done < macLen) {
+				unsigned int chunk = macLen - done;
+				if (chunk > 1024) {
+					chunk = 1024;
+				}
+				if (done < payloadLen) {
+					Salsa20::memxor(data + ZT_PACKET_IDX_VERB + done,ks + done,chunk);
+				}
+				poly.update(data + ZT_PACKET_IDX_VERB + done,chunk);
+				done += chunk;
+			}
 			uint64_t mac[2];
-			Poly1305::compute(mac,data + ZT_PACKET_IDX_VERB,size() - ZT_PACKET_IDX_VERB,keyStream);
+			poly.finish(mac);
 #ifdef ZT_NO_TYPE_PUNNING
 			memcpy(data + ZT_PACKET_IDX_MAC,mac,8);
 #else
@@ -1069,6 +1089,7 @@ void Packet::armor(const void *key,bool encryptPayload,const AES aesKeys[2])
 
 bool Packet::dearmor(const void *key,const AES aesKeys[2])
 {
+	Metrics::SampledTimer _st(Metrics::rx_dearmor_us);
 	uint8_t *const data = reinterpret_cast<uint8_t *>(unsafeData());
 	const unsigned int payloadLen = size() - ZT_PACKET_IDX_VERB;
 	unsigned char *const payload = data + ZT_PACKET_IDX_VERB;
@@ -1100,8 +1121,30 @@ bool Packet::dearmor(const void *key,const AES aesKeys[2])
 		if (ZT_HAS_FAST_CRYPTO()) {
 			uint64_t keyStream[(ZT_PROTO_MAX_PACKET_LENGTH + 64 + 8) / 8];
 			ZT_FAST_SINGLE_PASS_SALSA2012(keyStream,((cs == ZT_PROTO_CIPHER_SUITE__C25519_POLY1305_SALSA2012) ? (payloadLen + 64) : 64),(data + ZT_PACKET_IDX_IV),mangledKey);
+
+			// Single in-place sweep: MAC each chunk of ciphertext, then
+			// decrypt it in place while it is still hot. The MAC is still
+			// computed over the ciphertext; only the tag comparison moves
+			// after decryption, and on failure the (garbage) buffer is
+			// discarded by the caller, as in the AES-GMAC-SIV path.
+			Poly1305 poly;
+			poly.init(keyStream);
+			const bool decrypt = (cs == ZT_PROTO_CIPHER_SUITE__C25519_POLY1305_SALSA2012);
+			const uint8_t *const ks = reinterpret_cast<const uint8_t *>(keyStream + 8);
+			unsigned int done = 0;
+			while (done < payloadLen) {
+				unsigned int chunk = payloadLen - done;
+				if (chunk > 1024) {
+					chunk = 1024;
+				}
+				poly.update(payload + done,chunk);
+				if (decrypt) {
+					Salsa20::memxor(payload + done,ks + done,chunk);
+				}
+				done += chunk;
+			}
 			uint64_t mac[2];
-			Poly1305::compute(mac,payload,payloadLen,keyStream);
+			poly.finish(mac);
 #ifdef ZT_NO_TYPE_PUNNING
 			if (!Utils::secureEq(mac,data + ZT_PACKET_IDX_MAC,8)) {
 				return false;
@@ -1111,9 +1154,6 @@ bool Packet::dearmor(const void *key,const AES aesKeys[2])
 				return false;
 			}
 #endif
-			if (cs == ZT_PROTO_CIPHER_SUITE__C25519_POLY1305_SALSA2012) {
-				Salsa20::memxor(data + ZT_PACKET_IDX_VERB,reinterpret_cast<const uint8_t *>(keyStream + 8),payloadLen);
-			}
 		} else {
 			Salsa20 s20(mangledKey,data + ZT_PACKET_IDX_IV);
 			uint64_t macKey[4];
@@ -1139,6 +1179,59 @@ bool Packet::dearmor(const void *key,const AES aesKeys[2])
 	return false;
 }
 
+void Packet::armorGroup(const void *groupKey)
+{
+	uint8_t *const data = reinterpret_cast<uint8_t *>(unsafeData());
+	setCipher(ZT_PROTO_CIPHER_SUITE__POLY1305_SALSA2012_GROUP);
+
+	uint8_t mangledKey[32];
+	_salsa20MangleKeyGroup((const unsigned char *)groupKey,mangledKey);
+
+	Salsa20 s20(mangledKey,data + ZT_PACKET_IDX_IV);
+	uint64_t macKey[4];
+	s20.crypt12(ZERO_KEY,macKey,sizeof(macKey));
+
+	uint8_t *const payload = data + ZT_PACKET_IDX_VERB;
+	const unsigned int payloadLen = size() - ZT_PACKET_IDX_VERB;
+	s20.crypt12(payload,payload,payloadLen);
+
+	uint64_t mac[2];
+	Poly1305::compute(mac,payload,payloadLen,macKey);
+	memcpy(data + ZT_PACKET_IDX_MAC,mac,8);
+}
+
+bool Packet::dearmorGroup(const void *groupKey)
+{
+	Metrics::SampledTimer _st(Metrics::rx_dearmor_us);
+	uint8_t *const data = reinterpret_cast<uint8_t *>(unsafeData());
+	const unsigned int payloadLen = size() - ZT_PACKET_IDX_VERB;
+	unsigned char *const payload = data + ZT_PACKET_IDX_VERB;
+
+	if (cipher() != ZT_PROTO_CIPHER_SUITE__POLY1305_SALSA2012_GROUP) {
+		return false;
+	}
+
+	uint8_t mangledKey[32];
+	_salsa20MangleKeyGroup((const unsigned char *)groupKey,mangledKey);
+
+	Salsa20 s20(mangledKey,data + ZT_PACKET_IDX_IV);
+	uint64_t macKey[4];
+	s20.crypt12(ZERO_KEY,macKey,sizeof(macKey));
+	uint64_t mac[2];
+	Poly1305::compute(mac,payload,payloadLen,macKey);
+#ifdef ZT_NO_TYPE_PUNNING
+	if (!Utils::secureEq(mac,data + ZT_PACKET_IDX_MAC,8)) {
+		return false;
+	}
+#else
+	if ((*reinterpret_cast<const uint64_t *>(data + ZT_PACKET_IDX_MAC)) != mac[0]) { // also secure, constant time
+		return false;
+	}
+#endif
+	s20.crypt12(payload,payload,payloadLen);
+	return true;
+}
+
 void Packet::cryptField(const void *key,unsigned int start,unsigned int len)
 {
 	uint8_t *const data = reinterpret_cast<uint8_t *>(unsafeData());
@@ -127,6 +127,18 @@
  */
 #define ZT_PROTO_CIPHER_SUITE__NO_CRYPTO_TRUSTED_PATH 2
 
+/**
+ * Cipher suite: group-keyed Poly1305/Salsa20/12 (1.10.7+)
+ *
+ * Same construction as C25519_POLY1305_SALSA2012 except that the key is a
+ * sender-generated symmetric group key (distributed via VERB_GROUP_KEY)
+ * rather than the pairwise session key, and the destination address is
+ * excluded from key mangling so one armoring pass is valid for every
+ * member of the group: fan-out only patches the destination field. Only
+ * sent to peers that advertised support in HELLO extension flags.
+ */
+#define ZT_PROTO_CIPHER_SUITE__POLY1305_SALSA2012_GROUP 4
+
 /**
  * DEPRECATED payload encrypted flag, may be re-used in the future.
  *
@@ -291,6 +303,8 @@
 #define ZT_PROTO_VERB_FRAME_IDX_ETHERTYPE (ZT_PROTO_VERB_FRAME_IDX_NETWORK_ID + 8)
 #define ZT_PROTO_VERB_FRAME_IDX_PAYLOAD (ZT_PROTO_VERB_FRAME_IDX_ETHERTYPE + 2)
 
+#define ZT_PROTO_VERB_FRAME_BUNDLE_IDX_FRAME_COUNT (ZT_PACKET_IDX_PAYLOAD)
+
 #define ZT_PROTO_VERB_EXT_FRAME_IDX_NETWORK_ID (ZT_PACKET_IDX_PAYLOAD)
 #define ZT_PROTO_VERB_EXT_FRAME_LEN_NETWORK_ID 8
 #define ZT_PROTO_VERB_EXT_FRAME_IDX_FLAGS (ZT_PROTO_VERB_EXT_FRAME_IDX_NETWORK_ID + ZT_PROTO_VERB_EXT_FRAME_LEN_NETWORK_ID)
@@ -1050,7 +1064,47 @@ public:
 		 * that as a refusal by the remote peer, in this case if the utility is
 		 * negligible it will voluntarily switch to the remote peer's chosen path.
 		 */
-		VERB_PATH_NEGOTIATION_REQUEST = 0x16
+		VERB_PATH_NEGOTIATION_REQUEST = 0x16,
+
+		/**
+		 * A bundle of small frames coalesced into a single wire packet:
+		 *   <[1] 8-bit number of frames in bundle>
+		 *   [... for each frame ...]
+		 *   <[8] 64-bit network ID>
+		 *   <[1] flags (currently unused, must be 0)>
+		 *   <[6] destination MAC or all zero for destination node>
+		 *   <[6] source MAC or all zero for node of origin>
+		 *   <[2] 16-bit ethertype>
+		 *   <[2] 16-bit length of frame payload>
+		 *   <[...] ethernet payload>
+		 *
+		 * Each frame is processed exactly as a VERB_EXT_FRAME with no flags
+		 * set. This verb is only sent to peers that advertised support for it
+		 * in the extension flags of HELLO or OK(HELLO), so older nodes never
+		 * see it. It amortizes per-packet MAC/encryption and send overhead
+		 * across bursts of small frames (VoIP, games, etc.).
+		 *
+		 * No OK or ERROR is generated.
+		 */
+		VERB_FRAME_BUNDLE = 0x17,
+
+		/**
+		 * A sender-generated symmetric group key:
+		 *   <[8] 64-bit network ID>
+		 *   <[1] flags (currently unused, must be 0)>
+		 *   <[8] 64-bit group key ID>
+		 *   <[32] symmetric key>
+		 *
+		 * Distributes the key used to armor group-keyed multicast frames
+		 * (cipher suite POLY1305_SALSA2012_GROUP) so that one encryption
+		 * pass can serve an entire fan-out. The packet itself travels under
+		 * the normal pairwise encryption, so the key is never exposed. Only
+		 * sent to peers that advertised support in HELLO extension flags
+		 * and that are authorized members of the network.
+		 *
+		 * No OK or ERROR is generated.
+		 */
+		VERB_GROUP_KEY = 0x18
 	};
 
 	/**
@@ -1257,7 +1311,7 @@ public:
 	 */
 	inline bool isEncrypted() const
 	{
-		return (cipher() == ZT_PROTO_CIPHER_SUITE__C25519_POLY1305_SALSA2012) || (cipher() == ZT_PROTO_CIPHER_SUITE__AES_GMAC_SIV);
+		return (cipher() == ZT_PROTO_CIPHER_SUITE__C25519_POLY1305_SALSA2012) || (cipher() == ZT_PROTO_CIPHER_SUITE__AES_GMAC_SIV) || (cipher() == ZT_PROTO_CIPHER_SUITE__POLY1305_SALSA2012_GROUP);
 	}
 
 	/**
@@ -1353,6 +1407,25 @@ public:
 	 */
 	bool dearmor(const void *key,const AES aesKeys[2]);
 
+	/**
+	 * Armor with a group key (cipher suite POLY1305_SALSA2012_GROUP)
+	 *
+	 * The destination address is excluded from key mangling, so after this
+	 * call the destination field may be patched freely and the packet sent
+	 * to any number of group members without re-encrypting.
+	 *
+	 * @param groupKey 32-byte symmetric group key
+	 */
+	void armorGroup(const void *groupKey);
+
+	/**
+	 * Verify and (if encrypted) decrypt a group-keyed packet
+	 *
+	 * @param groupKey 32-byte symmetric group key
+	 * @return False if packet is invalid or failed MAC authenticity check
+	 */
+	bool dearmorGroup(const void *groupKey);
+
 	/**
 	 * Encrypt/decrypt a separately armored portion of a packet
 	 *
@@ -1404,6 +1477,30 @@ private:
 	 * @param in Input key (32 bytes)
 	 * @param out Output buffer (32 bytes)
 	 */
+	// Variant of _salsa20MangleKey for group-keyed packets: the destination
+	// address bytes are excluded so the same ciphertext and MAC remain valid
+	// for every member of the group. The group key itself provides the key
+	// separation the destination XOR provides for pairwise keys.
+	inline void _salsa20MangleKeyGroup(const unsigned char *in,unsigned char *out) const
+	{
+		const unsigned char *d = (const unsigned char *)data();
+		for(unsigned int i=0;i<8;++i) {
+			out[i] = in[i] ^ d[i]; // IV
+		}
+		for(unsigned int i=8;i<13;++i) {
+			out[i] = in[i]; // destination excluded
+		}
+		for(unsigned int i=13;i<18;++i) {
+			out[i] = in[i] ^ d[i]; // source
+		}
+		out[18] = in[18] ^ (d[ZT_PACKET_IDX_FLAGS] & 0xf8);
+		out[19] = in[19] ^ (unsigned char)(size() & 0xff);
+		out[20] = in[20] ^ (unsigned char)((size() >> 8) & 0xff);
+		for(unsigned int i=21;i<32;++i) {
+			out[i] = in[i];
+		}
+	}
+
 	inline void _salsa20MangleKey(const unsigned char *in,unsigned char *out) const
 	{
 		const unsigned char *d = (const unsigned char *)data();
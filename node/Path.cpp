@@ -20,7 +20,10 @@ namespace ZeroTier {
 bool Path::send(const RuntimeEnvironment *RR,void *tPtr,const void *data,unsigned int len,int64_t now)
 {
 	if (RR->node->putPacket(tPtr,_localSocket,_addr,data,len)) {
-		_lastOut = now;
+		_lastOut.store(now,std::memory_order_relaxed);
+		_bytesOut.fetch_add((uint64_t)len,std::memory_order_relaxed);
+		_packetsOut.fetch_add(1,std::memory_order_relaxed);
+		rateAccountSent(now,len);
 		return true;
 	}
 	return false;
@@ -20,6 +20,7 @@
 
 #include <stdexcept>
 #include <algorithm>
+#include <atomic>
 
 #include "Constants.hpp"
 #include "InetAddress.hpp"
@@ -83,7 +84,14 @@ public:
 		_lastOut(0),
 		_lastIn(0),
 		_lastTrustEstablishedPacketReceived(0),
+		_keepaliveInterval(ZT_PATH_HEARTBEAT_PERIOD),
+		_keepaliveProbeSentAt(0),
+		_keepaliveProbeWindow(0),
+		_keepaliveGoodInterval(ZT_PATH_HEARTBEAT_PERIOD),
+		_keepaliveBadInterval(0),
+		_keepaliveBadAt(0),
 		_lastEchoRequestReceived(0),
+		_lastMtuProbe(0),
 		_localSocket(-1),
 		_latencyMean(0.0),
 		_latencyVariance(0.0),
@@ -93,9 +101,19 @@ public:
 		_eligible(false),
 		_bonded(false),
 		_mtu(0),
+		_probedMtu(0),
 		_givenLinkSpeed(0),
 		_relativeQuality(0),
 		_latency(0xffff),
+		_bytesIn(0),
+		_bytesOut(0),
+		_packetsIn(0),
+		_packetsOut(0),
+		_rateBucketStart(0),
+		_rateBucketIn(0),
+		_rateBucketOut(0),
+		_rateIn(0),
+		_rateOut(0),
 		_addr(),
 		_ipScope(InetAddress::IP_SCOPE_NONE)
 		{}
@@ -104,7 +122,14 @@ public:
 		_lastOut(0),
 		_lastIn(0),
 		_lastTrustEstablishedPacketReceived(0),
+		_keepaliveInterval(ZT_PATH_HEARTBEAT_PERIOD),
+		_keepaliveProbeSentAt(0),
+		_keepaliveProbeWindow(0),
+		_keepaliveGoodInterval(ZT_PATH_HEARTBEAT_PERIOD),
+		_keepaliveBadInterval(0),
+		_keepaliveBadAt(0),
 		_lastEchoRequestReceived(0),
+		_lastMtuProbe(0),
 		_localSocket(localSocket),
 		_latencyMean(0.0),
 		_latencyVariance(0.0),
@@ -114,9 +139,19 @@ public:
 		_eligible(false),
 		_bonded(false),
 		_mtu(0),
+		_probedMtu(0),
 		_givenLinkSpeed(0),
 		_relativeQuality(0),
 		_latency(0xffff),
+		_bytesIn(0),
+		_bytesOut(0),
+		_packetsIn(0),
+		_packetsOut(0),
+		_rateBucketStart(0),
+		_rateBucketIn(0),
+		_rateBucketOut(0),
+		_rateIn(0),
+		_rateOut(0),
 		_addr(addr),
 		_ipScope(addr.ipScope())
 	{}
@@ -124,17 +159,25 @@ public:
 	/**
 	 * Called when a packet is received from this remote path, regardless of content
 	 *
+	 * All bookkeeping is relaxed atomic so concurrent receive threads never
+	 * serialize here.
+	 *
 	 * @param t Time of receive
+	 * @param bytes Size of received packet
 	 */
-	inline void received(const uint64_t t)
+	inline void received(const uint64_t t,const unsigned int bytes)
 	{
-		_lastIn = t;
+		_lastIn.store((int64_t)t,std::memory_order_relaxed);
+		_bytesIn.fetch_add((uint64_t)bytes,std::memory_order_relaxed);
+		_packetsIn.fetch_add(1,std::memory_order_relaxed);
+		_rateBucketIn.fetch_add((uint64_t)bytes,std::memory_order_relaxed);
+		_rateRoll((int64_t)t);
 	}
 
 	/**
 	 * Set time last trusted packet was received (done in Peer::received())
 	 */
-	inline void trustedPacketReceived(const uint64_t t) { _lastTrustEstablishedPacketReceived = t; }
+	inline void trustedPacketReceived(const uint64_t t) { _lastTrustEstablishedPacketReceived.store((int64_t)t,std::memory_order_relaxed); }
 
 	/**
 	 * Send a packet via this path (last out time is also updated)
@@ -153,20 +196,23 @@ public:
 	 *
 	 * @param t Time of send
 	 */
-	inline void sent(const int64_t t) { _lastOut = t; }
+	inline void sent(const int64_t t) { _lastOut.store(t,std::memory_order_relaxed); }
 
 	/**
 	 * Update path latency with a new measurement
 	 *
+	 * A racing update can drop one sample from the moving average, which is
+	 * harmless, so this doesn't bother with a compare-exchange loop.
+	 *
 	 * @param l Measured latency
 	 */
 	inline void updateLatency(const unsigned int l, int64_t now)
 	{
-		unsigned int pl = _latency;
+		unsigned int pl = _latency.load(std::memory_order_relaxed);
 		if (pl < 0xffff) {
-			_latency = (pl + l) / 2;
+			_latency.store((pl + l) / 2,std::memory_order_relaxed);
 		} else {
-			_latency = l;
+			_latency.store(l,std::memory_order_relaxed);
 		}
 	}
 
@@ -188,7 +234,7 @@ public:
 	/**
 	 * @return True if path has received a trust established packet (e.g. common network membership) in the past ZT_TRUST_EXPIRATION ms
 	 */
-	inline bool trustEstablished(const int64_t now) const { return ((now - _lastTrustEstablishedPacketReceived) < ZT_TRUST_EXPIRATION); }
+	inline bool trustEstablished(const int64_t now) const { return ((now - _lastTrustEstablishedPacketReceived.load(std::memory_order_relaxed)) < ZT_TRUST_EXPIRATION); }
 
 	/**
 	 * @return Preference rank, higher == better
@@ -244,15 +290,15 @@ public:
 	/**
 	 * @return Latency or 0xffff if unknown
 	 */
-	inline unsigned int latency() const { return _latency; }
+	inline unsigned int latency() const { return _latency.load(std::memory_order_relaxed); }
 
 	/**
 	 * @return Path quality -- lower is better
 	 */
 	inline long quality(const int64_t now) const
 	{
-		const int l = (long)_latency;
-		const int age = (long)std::min((now - _lastIn),(int64_t)(ZT_PATH_HEARTBEAT_PERIOD * 10)); // set an upper sanity limit to avoid overflow
+		const int l = (long)_latency.load(std::memory_order_relaxed);
+		const int age = (long)std::min((now - _lastIn.load(std::memory_order_relaxed)),(int64_t)(ZT_PATH_HEARTBEAT_PERIOD * 10)); // set an upper sanity limit to avoid overflow
 		return (((age < (ZT_PATH_HEARTBEAT_PERIOD + 5000)) ? l : (l + 0xffff + age)) * (long)((ZT_INETADDRESS_MAX_SCOPE - _ipScope) + 1));
 	}
 
@@ -260,33 +306,161 @@ public:
 	 * @return True if this path is alive (receiving heartbeats)
 	 */
 	inline bool alive(const int64_t now) const {
-		return (now - _lastIn) < (ZT_PATH_HEARTBEAT_PERIOD + 5000);
+		// The inbound silence tolerated here scales with this path's keepalive
+		// schedule. The far end runs the same binding lifetime probe over the
+		// same NAT pair, so its keepalives arrive at a comparable cadence; a
+		// default-period margin covers the two ends probing out of step.
+		return (now - _lastIn.load(std::memory_order_relaxed)) < (_keepaliveInterval.load(std::memory_order_relaxed) + ZT_PATH_HEARTBEAT_PERIOD + 5000);
 	}
 
 	/**
 	 * @return True if this path needs a heartbeat
 	 */
-	inline bool needsHeartbeat(const int64_t now) const { return ((now - _lastOut) >= ZT_PATH_HEARTBEAT_PERIOD); }
+	inline bool needsHeartbeat(const int64_t now) const { return ((now - _lastOut.load(std::memory_order_relaxed)) >= _keepaliveInterval.load(std::memory_order_relaxed)); }
+
+	/**
+	 * @param now Current time
+	 * @param earlyBy Milliseconds by which to advance the deadline (deterministic jitter, must be < ZT_PATH_HEARTBEAT_PERIOD)
+	 * @return True if this path needs a heartbeat
+	 */
+	inline bool needsHeartbeat(const int64_t now,const unsigned int earlyBy) const { return ((now - _lastOut.load(std::memory_order_relaxed)) >= (_keepaliveInterval.load(std::memory_order_relaxed) - (int64_t)earlyBy)); }
+
+	/**
+	 * Adapt this path's keepalive interval to the observed NAT binding lifetime
+	 *
+	 * Called from Peer::doPingAndKeepalive() just before a keepalive is sent.
+	 * It judges the previous keepalive probe: that probe followed a full
+	 * interval of outbound silence, so a response to it (or any other inbound
+	 * arriving after it) proves the NAT binding survived that much silence and
+	 * a longer interval can be tried. No inbound since a stretched probe is
+	 * taken as the binding having expired inside the window: the failed window
+	 * is remembered and the interval drops straight back to the default so
+	 * connectivity recovers quickly. Growth doubles while unopposed and
+	 * bisects once a failing window is known, converging in a handful of
+	 * windows. A lost probe or reply just causes one conservative reset.
+	 *
+	 * @param now Current time
+	 */
+	inline void updateKeepaliveInterval(const int64_t now)
+	{
+		const int64_t cur = _keepaliveInterval.load(std::memory_order_relaxed);
+		if ((_keepaliveProbeSentAt <= 0)||((_keepaliveProbeWindow + (int64_t)ZT_PATH_KEEPALIVE_PROBE_QUANTUM) < cur)) {
+			return; // no probe outstanding, or it did not follow a full silence window
+		}
+		if (_lastIn.load(std::memory_order_relaxed) > _keepaliveProbeSentAt) {
+			_keepaliveGoodInterval = cur;
+			if ((_keepaliveBadInterval > 0)&&((now - _keepaliveBadAt) > (int64_t)ZT_PATH_KEEPALIVE_RELEARN_PERIOD)) {
+				_keepaliveBadInterval = 0;
+			}
+			int64_t next = (_keepaliveBadInterval > 0) ? ((_keepaliveGoodInterval + _keepaliveBadInterval) / 2) : (cur * 2);
+			if (next > (int64_t)ZT_PATH_KEEPALIVE_MAX_PERIOD) {
+				next = (int64_t)ZT_PATH_KEEPALIVE_MAX_PERIOD;
+			}
+			if ((next - _keepaliveGoodInterval) >= (int64_t)ZT_PATH_KEEPALIVE_PROBE_QUANTUM) {
+				_keepaliveInterval.store(next,std::memory_order_relaxed);
+			}
+		} else if (cur > (int64_t)ZT_PATH_HEARTBEAT_PERIOD) {
+			_keepaliveBadInterval = cur;
+			_keepaliveBadAt = now;
+			_keepaliveInterval.store((int64_t)ZT_PATH_HEARTBEAT_PERIOD,std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * Record that a keepalive probe is going out on this path
+	 *
+	 * Must be called before sent() so the preceding silence window can be
+	 * measured; updateKeepaliveInterval() only trusts probes that followed a
+	 * full window.
+	 *
+	 * @param now Current time
+	 */
+	inline void keepaliveProbeSent(const int64_t now)
+	{
+		_keepaliveProbeWindow = now - _lastOut.load(std::memory_order_relaxed);
+		_keepaliveProbeSentAt = now;
+	}
+
+	/**
+	 * @return Current keepalive interval for this path in milliseconds
+	 */
+	inline int64_t keepaliveInterval() const { return _keepaliveInterval.load(std::memory_order_relaxed); }
 
 	/**
 	 * @return Last time we sent something
 	 */
-	inline int64_t lastOut() const { return _lastOut; }
+	inline int64_t lastOut() const { return _lastOut.load(std::memory_order_relaxed); }
 
 	/**
 	 * @return Last time we received anything
 	 */
-	inline int64_t lastIn() const { return _lastIn; }
+	inline int64_t lastIn() const { return _lastIn.load(std::memory_order_relaxed); }
 
 	/**
 	 * @return the age of the path in terms of receiving packets
 	 */
-	inline int64_t age(int64_t now) { return (now - _lastIn); }
+	inline int64_t age(int64_t now) { return (now - _lastIn.load(std::memory_order_relaxed)); }
 
 	/**
 	 * @return Time last trust-established packet was received
 	 */
-	inline int64_t lastTrustEstablishedPacketReceived() const { return _lastTrustEstablishedPacketReceived; }
+	inline int64_t lastTrustEstablishedPacketReceived() const { return _lastTrustEstablishedPacketReceived.load(std::memory_order_relaxed); }
+
+	/**
+	 * @return Total bytes received on this path
+	 */
+	inline uint64_t bytesIn() const { return _bytesIn.load(std::memory_order_relaxed); }
+
+	/**
+	 * @return Total bytes sent on this path
+	 */
+	inline uint64_t bytesOut() const { return _bytesOut.load(std::memory_order_relaxed); }
+
+	/**
+	 * @return Total packets received on this path
+	 */
+	inline uint64_t packetsIn() const { return _packetsIn.load(std::memory_order_relaxed); }
+
+	/**
+	 * @return Total packets sent on this path
+	 */
+	inline uint64_t packetsOut() const { return _packetsOut.load(std::memory_order_relaxed); }
+
+	/**
+	 * Account an outgoing packet toward this path's send rate estimate
+	 *
+	 * Called from send() alongside the byte counters.
+	 *
+	 * @param t Time of send
+	 * @param bytes Size of sent packet
+	 */
+	inline void rateAccountSent(const int64_t t,const unsigned int bytes)
+	{
+		_rateBucketOut.fetch_add((uint64_t)bytes,std::memory_order_relaxed);
+		_rateRoll(t);
+	}
+
+	/**
+	 * @param now Current time
+	 * @return Smoothed receive rate in bytes/sec, decayed if the path is idle
+	 */
+	inline uint64_t ewmaRateIn(const int64_t now) const
+	{
+		const int64_t secs = (now - _rateBucketStart.load(std::memory_order_relaxed)) / 1000;
+		const uint64_t r = _rateIn.load(std::memory_order_relaxed);
+		return ((secs > 1) ? ((secs < 63) ? (r >> secs) : 0) : r);
+	}
+
+	/**
+	 * @param now Current time
+	 * @return Smoothed send rate in bytes/sec, decayed if the path is idle
+	 */
+	inline uint64_t ewmaRateOut(const int64_t now) const
+	{
+		const int64_t secs = (now - _rateBucketStart.load(std::memory_order_relaxed)) / 1000;
+		const uint64_t r = _rateOut.load(std::memory_order_relaxed);
+		return ((secs > 1) ? ((secs < 63) ? (r >> secs) : 0) : r);
+	}
 
 	/**
 	 * Rate limit gate for inbound ECHO requests
@@ -341,6 +515,53 @@ public:
 	 */
 	inline uint16_t mtu() const { return _mtu; }
 
+	/**
+	 * @return Largest wire packet size verified to round-trip this path, or 0 if not yet probed
+	 */
+	inline uint16_t probedMtu() const { return _probedMtu; }
+
+	/**
+	 * Record that a packet of the given wire size traversed this path intact
+	 *
+	 * @param bytes Wire packet size in bytes
+	 */
+	inline void updateProbedMtu(const unsigned int bytes)
+	{
+		if ((bytes > (unsigned int)_probedMtu)&&(bytes <= (unsigned int)ZT_MAX_PHYSMTU)) {
+			_probedMtu = (uint16_t)bytes;
+		}
+	}
+
+	/**
+	 * @return Next candidate wire size for MTU probing, or 0 if the ladder is exhausted
+	 */
+	inline unsigned int mtuProbeSize() const
+	{
+		static const uint16_t ladder[4] = { 1500,3000,6000,9000 };
+		const unsigned int verified = (_probedMtu > 0) ? (unsigned int)_probedMtu : (unsigned int)ZT_DEFAULT_PHYSMTU;
+		for(unsigned int i=0;i<4;++i) {
+			if ((unsigned int)ladder[i] > verified) {
+				return (unsigned int)ladder[i];
+			}
+		}
+		return 0;
+	}
+
+	/**
+	 * Rate gate MTU probes to once every ZT_PATH_MTU_PROBE_INTERVAL per path
+	 *
+	 * @param now Current time
+	 * @return True if an MTU probe should be sent now
+	 */
+	inline bool shouldProbeMtu(const int64_t now)
+	{
+		if (((now - _lastMtuProbe) >= (int64_t)ZT_PATH_MTU_PROBE_INTERVAL)&&(mtuProbeSize() > 0)) {
+			_lastMtuProbe = now;
+			return true;
+		}
+		return false;
+	}
+
 	/**
 	 * @return Given link capacity as reported by the bonding layer
 	 */
@@ -362,11 +583,46 @@ private:
 
 	char _ifname[ZT_MAX_PHYSIFNAME] = { };
 
-	volatile int64_t _lastOut;
-	volatile int64_t _lastIn;
-	volatile int64_t _lastTrustEstablishedPacketReceived;
+	// Hot datapath bookkeeping is relaxed atomic so concurrent send/receive
+	// threads never serialize on it; readers tolerate slightly stale values.
+	// Fold the current rate bucket into the per-second EWMA once at least a
+	// second has elapsed. One caller wins the rollover via compare-exchange;
+	// losing a racing sample is harmless, matching the other accounting here.
+	inline void _rateRoll(const int64_t now)
+	{
+		int64_t bs = _rateBucketStart.load(std::memory_order_relaxed);
+		if ((now - bs) >= 1000) {
+			if (_rateBucketStart.compare_exchange_strong(bs,now,std::memory_order_relaxed)) {
+				const uint64_t in = _rateBucketIn.exchange(0,std::memory_order_relaxed);
+				const uint64_t out = _rateBucketOut.exchange(0,std::memory_order_relaxed);
+				const uint64_t secs = (bs > 0) ? (uint64_t)((now - bs) / 1000) : 1;
+				uint64_t r = _rateIn.load(std::memory_order_relaxed);
+				r = (secs < 63) ? (r >> secs) : 0;
+				_rateIn.store(r + ((in / secs) >> 1),std::memory_order_relaxed);
+				r = _rateOut.load(std::memory_order_relaxed);
+				r = (secs < 63) ? (r >> secs) : 0;
+				_rateOut.store(r + ((out / secs) >> 1),std::memory_order_relaxed);
+			}
+		}
+	}
+
+	std::atomic<int64_t> _lastOut;
+	std::atomic<int64_t> _lastIn;
+	std::atomic<int64_t> _lastTrustEstablishedPacketReceived;
+
+	// Keepalive schedule adapted to this path's observed NAT binding
+	// lifetime. The interval is read from receive/housekeeping threads, so
+	// it is atomic; the probe bookkeeping below is only touched under the
+	// owning Peer's path lock in doPingAndKeepalive().
+	std::atomic<int64_t> _keepaliveInterval;
+	int64_t _keepaliveProbeSentAt;
+	int64_t _keepaliveProbeWindow;
+	int64_t _keepaliveGoodInterval;
+	int64_t _keepaliveBadInterval;
+	int64_t _keepaliveBadAt;
 
 	int64_t _lastEchoRequestReceived;
+	int64_t _lastMtuProbe;
 
 	int64_t _localSocket;
 
@@ -378,10 +634,20 @@ private:
 	volatile bool _eligible;
 	volatile bool _bonded;
 	volatile uint16_t _mtu;
+	volatile uint16_t _probedMtu;
 	volatile uint32_t _givenLinkSpeed;
 	volatile float _relativeQuality;
 
-	volatile unsigned int _latency;
+	std::atomic<unsigned int> _latency;
+	std::atomic<uint64_t> _bytesIn;
+	std::atomic<uint64_t> _bytesOut;
+	std::atomic<uint64_t> _packetsIn;
+	std::atomic<uint64_t> _packetsOut;
+	std::atomic<int64_t> _rateBucketStart;
+	std::atomic<uint64_t> _rateBucketIn;
+	std::atomic<uint64_t> _rateBucketOut;
+	std::atomic<uint64_t> _rateIn;
+	std::atomic<uint64_t> _rateOut;
 	InetAddress _addr;
 	InetAddress::IpScope _ipScope; // memoize this since it's a computed value checked often
 	AtomicCounter __refCount;
@@ -32,25 +32,13 @@ Peer::Peer(const RuntimeEnvironment *renv,const Identity &myIdentity,const Ident
 	: RR(renv)
 	, _lastReceive(0)
 	, _lastNontrivialReceive(0)
-	, _lastTriedMemorizedPath(0)
-	, _lastDirectPathPushSent(0)
-	, _lastDirectPathPushReceive(0)
-	, _lastCredentialRequestSent(0)
-	, _lastWhoisRequestReceived(0)
-	, _lastCredentialsReceived(0)
 	, _lastTrustEstablishedPacketReceived(0)
-	, _lastSentFullHello(0)
-	, _lastEchoCheck(0)
-	, _freeRandomByte((unsigned char)((uintptr_t)this >> 4) ^ ++s_freeRandomByteCounter)
+	, _lastPathSelection(0)
+	, _cachedBestPathIdx(ZT_MAX_PEER_NETWORK_PATHS)
 	, _vProto(0)
-	, _vMajor(0)
-	, _vMinor(0)
-	, _vRevision(0)
+	, _freeRandomByte((unsigned char)((uintptr_t)this >> 4) ^ ++s_freeRandomByteCounter)
+	, _cold((_ColdData *)0)
 	, _id(peerIdentity)
-	, _directPathPushCutoffCount(0)
-	, _echoRequestCutoffCount(0)
-	, _localMultipathSupported(false)
-	, _lastComputedAggregateMeanLatency(0)
 #ifndef ZT_NO_PEER_METRICS
 	, _peer_latency{Metrics::peer_latency.Add({{"node_id", OSUtils::nodeIDStr(peerIdentity.address().toInt())}}, std::vector<uint64_t>{1,3,6,10,30,60,100,300,600,1000})}
 	, _alive_path_count{Metrics::peer_path_count.Add({{"node_id", OSUtils::nodeIDStr(peerIdentity.address().toInt())},{"status","alive"}})}
@@ -60,9 +48,30 @@ Peer::Peer(const RuntimeEnvironment *renv,const Identity &myIdentity,const Ident
 	, _packet_errors{Metrics::peer_packet_errors.Add({{"node_id", OSUtils::nodeIDStr(peerIdentity.address().toInt())}})}
 #endif
 {
+	// Layout guards: received() and getAppropriatePath() are meant to touch
+	// the leading scalar block, the key material, and the path table, and
+	// nothing else. If one of these fires, a field was probably added to the
+	// hot block that belongs in _ColdData instead.
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+	static_assert(offsetof(Peer,_lastReceive) < 64,"Peer hot scalar block must start in the first cache line");
+	static_assert((offsetof(Peer,_cold) + sizeof(void *)) - offsetof(Peer,_lastReceive) <= 128,"Peer hot scalar block must fit in two cache lines");
+	static_assert(offsetof(Peer,_cold) < offsetof(Peer,_key),"cold-data pointer must precede the bulk key material");
+#pragma GCC diagnostic pop
+#endif
+
 	if (!myIdentity.agree(peerIdentity,_key)) {
 		throw ZT_EXCEPTION_INVALID_ARGUMENT;
 	}
+	_cold = new _ColdData(peerIdentity);
+
+	memset(_pathIndex,0,sizeof(_pathIndex));
+	_firstEmptyPathSlot = 0;
+
+	_remoteSupportsFrameBundles = false;
+	_remoteSupportsGroupKeys = false;
+	_remoteGroupKeyCount = 0;
 
 	uint8_t ktmp[ZT_SYMMETRIC_KEY_SIZE];
 	KBKDFHMACSHA384(_key,ZT_KBKDF_LABEL_AES_GMAC_SIV_K0,0,0,ktmp);
@@ -72,6 +81,58 @@ Peer::Peer(const RuntimeEnvironment *renv,const Identity &myIdentity,const Ident
 	Utils::burn(ktmp,ZT_SYMMETRIC_KEY_SIZE);
 }
 
+unsigned long Peer::_pathIndexHash(const int64_t localSocket,const InetAddress &addr)
+{
+	// rateGateHash() covers the IP but not the port, which is what ipsEqual()
+	// compares; mixing in the local socket keeps paths on different local
+	// interfaces in different buckets
+	return ((unsigned long)addr.rateGateHash() ^ (unsigned long)(((uint64_t)localSocket * 0x9e3779b97f4a7c15ULL) >> 48)) & (ZT_PEER_PATH_INDEX_SIZE - 1);
+}
+
+void Peer::_rebuildPathIndex()
+{
+	// assumes _paths_m is locked
+	memset(_pathIndex,0,sizeof(_pathIndex));
+	_firstEmptyPathSlot = ZT_MAX_PEER_NETWORK_PATHS;
+	for(unsigned int i=0;i<ZT_MAX_PEER_NETWORK_PATHS;++i) {
+		if (_paths[i].p) {
+			unsigned long b = _pathIndexHash(_paths[i].p->localSocket(),_paths[i].p->address());
+			while (_pathIndex[b]) {
+				b = (b + 1) & (ZT_PEER_PATH_INDEX_SIZE - 1);
+			}
+			_pathIndex[b] = (uint8_t)(i + 1);
+		} else if (_firstEmptyPathSlot == ZT_MAX_PEER_NETWORK_PATHS) {
+			_firstEmptyPathSlot = i;
+		}
+	}
+}
+
+int Peer::_findPathSlot(const SharedPtr<Path> &path) const
+{
+	// assumes _paths_m is locked; returns the slot holding this exact path, a
+	// slot with the same address on the same interface if there is no exact
+	// match, or -1
+	int sameAddr = -1;
+	unsigned long b = _pathIndexHash(path->localSocket(),path->address());
+	for(unsigned int probes=0;probes<ZT_PEER_PATH_INDEX_SIZE;++probes) {
+		const unsigned int e = _pathIndex[b];
+		if (!e) {
+			break;
+		}
+		const unsigned int s = e - 1;
+		if (_paths[s].p) {
+			if (_paths[s].p == path) {
+				return (int)s;
+			}
+			if ((sameAddr < 0)&&(_paths[s].p->localSocket() == path->localSocket())&&(_paths[s].p->address().ipsEqual(path->address()))) {
+				sameAddr = (int)s;
+			}
+		}
+		b = (b + 1) & (ZT_PEER_PATH_INDEX_SIZE - 1);
+	}
+	return sameAddr;
+}
+
 void Peer::received(
 	void *tPtr,
 	const SharedPtr<Path> &path,
@@ -91,6 +152,7 @@ void Peer::received(
 	switch (verb) {
 		case Packet::VERB_FRAME:
 		case Packet::VERB_EXT_FRAME:
+		case Packet::VERB_FRAME_BUNDLE:
 		case Packet::VERB_NETWORK_CONFIG_REQUEST:
 		case Packet::VERB_NETWORK_CONFIG:
 		case Packet::VERB_MULTICAST_FRAME:
@@ -114,22 +176,14 @@ void Peer::received(
 		bool havePath = false;
 		{
 			Mutex::Lock _l(_paths_m);
-			for(unsigned int i=0;i<ZT_MAX_PEER_NETWORK_PATHS;++i) {
-				if (_paths[i].p) {
-					if (_paths[i].p == path) {
-						_paths[i].lr = now;
-						havePath = true;
-						break;
-					}
-					// If same address on same interface then don't learn unless existing path isn't alive (prevents learning loop)
-					if (_paths[i].p->address().ipsEqual(path->address()) && _paths[i].p->localSocket() == path->localSocket()) {
-						if (_paths[i].p->alive(now) && !_bond) {
-							havePath = true;
-							break;
-						}
-					}
-				} else {
-					break;
+			const int s = _findPathSlot(path);
+			if (s >= 0) {
+				if (_paths[s].p == path) {
+					_paths[s].lr = now;
+					havePath = true;
+				} else if (_paths[s].p->alive(now) && !_bond) {
+					// Same address on same interface: don't learn unless the existing path isn't alive (prevents learning loop)
+					havePath = true;
 				}
 			}
 		}
@@ -137,51 +191,55 @@ void Peer::received(
 		if ( (!havePath) && RR->node->shouldUsePathForZeroTierTraffic(tPtr,_id.address(),path->localSocket(),path->address()) ) {
 			if (verb == Packet::VERB_OK) {
 				Mutex::Lock _l(_paths_m);
-				unsigned int oldestPathIdx = ZT_MAX_PEER_NETWORK_PATHS;
-				unsigned int oldestPathAge = 0;
 				unsigned int replacePath = ZT_MAX_PEER_NETWORK_PATHS;
 
-				for(unsigned int i=0;i<ZT_MAX_PEER_NETWORK_PATHS;++i) {
-					if (_paths[i].p) {
-						// Keep track of oldest path as a last resort option
-						unsigned int currAge = _paths[i].p->age(now);
-						if (currAge > oldestPathAge) {
-							oldestPathAge = currAge;
-							oldestPathIdx = i;
-						}
-						if (_paths[i].p->address().ipsEqual(path->address())) {
-							if (_paths[i].p->localSocket() == path->localSocket()) {
-								if (!_paths[i].p->alive(now)) {
-									replacePath = i;
-									break;
-								}
+				// A dead path to the same address on the same interface or a
+				// free slot can both be found via the index, so the scoring
+				// scan below only runs when the path table is completely full
+				const int s = _findPathSlot(path);
+				if ((s >= 0)&&(_paths[s].p != path)&&(!_paths[s].p->alive(now))) {
+					replacePath = (unsigned int)s;
+				} else if (_firstEmptyPathSlot < ZT_MAX_PEER_NETWORK_PATHS) {
+					replacePath = _firstEmptyPathSlot;
+				} else {
+					// Last resort: replace the oldest path
+					unsigned int oldestPathIdx = ZT_MAX_PEER_NETWORK_PATHS;
+					unsigned int oldestPathAge = 0;
+					for(unsigned int i=0;i<ZT_MAX_PEER_NETWORK_PATHS;++i) {
+						if (_paths[i].p) {
+							unsigned int currAge = _paths[i].p->age(now);
+							if (currAge > oldestPathAge) {
+								oldestPathAge = currAge;
+								oldestPathIdx = i;
 							}
 						}
-					} else {
-						replacePath = i;
-						break;
 					}
+					replacePath = oldestPathIdx;
 				}
 
-				// If we didn't find a good candidate then resort to replacing oldest path
-				replacePath = (replacePath == ZT_MAX_PEER_NETWORK_PATHS) ? oldestPathIdx : replacePath;
 				if (replacePath != ZT_MAX_PEER_NETWORK_PATHS) {
 					RR->t->peerLearnedNewPath(tPtr, networkId, *this, path, packetId);
 					_paths[replacePath].lr = now;
 					_paths[replacePath].p = path;
 					_paths[replacePath].priority = 1;
+					_rebuildPathIndex();
+
+					_cold->_lastDirectPathSuccess = now;
+					if (((now - _cold->_lastRendezvousAt) <= ZT_PEER_RENDEZVOUS_ATTRIBUTION_WINDOW)&&(_cold->_lastRendezvousAddr.ipsEqual(path->address()))) {
+						_cold->_natPortDelta = (int)path->address().port() - (int)_cold->_lastRendezvousAddr.port();
+					}
 					Mutex::Lock _l(_bond_m);
 					if(_bond) {
 						_bond->nominatePathToBond(_paths[replacePath].p, now);
 					}
 				}
 			} else {
-				Mutex::Lock ltl(_lastTriedPath_m);
+				Mutex::Lock ltl(_cold->_lastTriedPath_m);
 
 				bool triedTooRecently = false;
-				for(std::list< std::pair< Path *, int64_t > >::iterator i(_lastTriedPath.begin());i!=_lastTriedPath.end();) {
+				for(std::list< std::pair< Path *, int64_t > >::iterator i(_cold->_lastTriedPath.begin());i!=_cold->_lastTriedPath.end();) {
 					if ((now - i->second) > 1000) {
-						_lastTriedPath.erase(i++);
+						_cold->_lastTriedPath.erase(i++);
 					} else if (i->first == path.ptr()) {
 						++i;
 						triedTooRecently = true;
@@ -191,7 +249,7 @@ void Peer::received(
 				}
 
 				if (!triedTooRecently) {
-					_lastTriedPath.push_back(std::pair< Path *, int64_t >(path.ptr(), now));
+					_cold->_lastTriedPath.push_back(std::pair< Path *, int64_t >(path.ptr(), now));
 					attemptToContactAt(tPtr,path->localSocket(),path->address(),now,true);
 					path->sent(now);
 					RR->t->peerConfirmingUnknownPath(tPtr,networkId,*this,path,packetId,verb);
@@ -204,11 +262,11 @@ void Peer::received(
 	// all known external addresses for ourselves. If we already have a path this
 	// is done less frequently.
 	if (this->trustEstablished(now)) {
-		const int64_t sinceLastPush = now - _lastDirectPathPushSent;
+		const int64_t sinceLastPush = now - _cold->_lastDirectPathPushSent;
 		bool lowBandwidth = RR->node->lowBandwidthModeEnabled();
 		int timerScale = lowBandwidth ? 16 : 1;
 		if (sinceLastPush >= ((hops == 0) ? ZT_DIRECT_PATH_PUSH_INTERVAL_HAVEPATH * timerScale : ZT_DIRECT_PATH_PUSH_INTERVAL)) {
-			_lastDirectPathPushSent = now;
+			_cold->_lastDirectPathPushSent = now;
 			std::vector<InetAddress> pathsToPush(RR->node->directPaths());
 			std::vector<InetAddress> ma = RR->sa->whoami();
 			pathsToPush.insert(pathsToPush.end(), ma.begin(), ma.end());
@@ -263,6 +321,19 @@ SharedPtr<Path> Peer::getAppropriatePath(int64_t now, bool includeExpired, int32
 	if(_bond && _bond->isReady()) {
 		return _bond->getAppropriatePath(now, flowId);
 	}
+
+	// Fast path: for stable single-path peers the last selection stays good
+	// for a while, so skip re-scoring every path on every packet. The cached
+	// pointer is re-checked against its slot so path replacement or array
+	// compaction falls through to full selection, as does the path dying or
+	// expiring or the cache aging out.
+	if ((!includeExpired)&&(_cachedBestPathIdx != ZT_MAX_PEER_NETWORK_PATHS)&&((now - _lastPathSelection) < ZT_PEER_PATH_SELECTION_CACHE_PERIOD)) {
+		const _PeerPath &pp = _paths[_cachedBestPathIdx];
+		if ((pp.p == _cachedBestPath)&&(pp.p)&&(pp.p->alive(now))&&((now - pp.lr) < ZT_PEER_PATH_EXPIRATION)) {
+			return pp.p;
+		}
+	}
+
 	unsigned int bestPath = ZT_MAX_PEER_NETWORK_PATHS;
 	/**
 	 * Send traffic across the highest quality path only. This algorithm will still
@@ -283,8 +354,15 @@ SharedPtr<Path> Peer::getAppropriatePath(int64_t now, bool includeExpired, int32
 		}
 	}
 	if (bestPath != ZT_MAX_PEER_NETWORK_PATHS) {
+		if (!includeExpired) {
+			_cachedBestPath = _paths[bestPath].p;
+			_cachedBestPathIdx = bestPath;
+			_lastPathSelection = now;
+		}
 		return _paths[bestPath].p;
 	}
+	_cachedBestPath.zero();
+	_cachedBestPathIdx = ZT_MAX_PEER_NETWORK_PATHS;
 	return SharedPtr<Path>();
 }
 
@@ -446,6 +524,24 @@ void Peer::sendHELLO(void *tPtr,const int64_t localSocket,const InetAddress &atA
 		outp.append((uint64_t)0);
 	}
 
+	{
+		// Extension flags (1.10.7+): bit 0 = session resumption ticket follows
+		// (presented on the first HELLO after start if this peer gave us one
+		// last session), bit 1 = we accept VERB_FRAME_BUNDLE, bit 2 = we
+		// accept VERB_GROUP_KEY and group-keyed packets. These ride in
+		// the crypted portion; older versions ignore trailing fields.
+		uint8_t extFlags = 0x06;
+		uint8_t resumptionTicket[ZT_PEER_RESUMPTION_TICKET_SIZE];
+		const bool presentTicket = resumptionTicketToPresent(now,resumptionTicket);
+		if (presentTicket) {
+			extFlags |= 0x01;
+		}
+		outp.append(extFlags);
+		if (presentTicket) {
+			outp.append(resumptionTicket,ZT_PEER_RESUMPTION_TICKET_SIZE);
+		}
+	}
+
 	outp.cryptField(_key,startCryptedPortionAt,outp.size() - startCryptedPortionAt);
 
 	Metrics::pkt_hello_out++;
@@ -462,7 +558,7 @@ void Peer::sendHELLO(void *tPtr,const int64_t localSocket,const InetAddress &atA
 
 void Peer::attemptToContactAt(void *tPtr,const int64_t localSocket,const InetAddress &atAddress,int64_t now,bool sendFullHello)
 {
-	if ( (!sendFullHello) && (_vProto >= 5) && (!((_vMajor == 1)&&(_vMinor == 1)&&(_vRevision == 0))) ) {
+	if ( (!sendFullHello) && (_vProto >= 5) && (!((_cold->_vMajor == 1)&&(_cold->_vMinor == 1)&&(_cold->_vRevision == 0))) ) {
 		Packet outp(_id.address(),RR->identity.address(),Packet::VERB_ECHO);
 		outp.armor(_key,true,aesKeysIfSupported());
 		Metrics::pkt_echo_out++;
@@ -473,10 +569,31 @@ void Peer::attemptToContactAt(void *tPtr,const int64_t localSocket,const InetAdd
 	}
 }
 
+void Peer::sendMtuProbe(void *tPtr,const SharedPtr<Path> &path,int64_t now)
+{
+	const unsigned int probeSize = path->mtuProbeSize();
+	if ((probeSize == 0)||(_vProto < 5)) {
+		return;
+	}
+	Packet outp(_id.address(),RR->identity.address(),Packet::VERB_ECHO);
+	// Zero-pad to the candidate wire size. The payload is ignored on the other
+	// end and simply echoed back, so the OK() proves round-trip delivery at
+	// this size without fragmentation.
+	char padding[ZT_MAX_PHYSMTU];
+	memset(padding,0,sizeof(padding));
+	if (probeSize > outp.size()) {
+		outp.append(padding,probeSize - outp.size());
+	}
+	outp.armor(_key,true,aesKeysIfSupported());
+	Metrics::pkt_echo_out++;
+	RR->node->expectReplyTo(outp.packetId());
+	path->send(RR,tPtr,outp.data(),outp.size(),now);
+}
+
 void Peer::tryMemorizedPath(void *tPtr,int64_t now)
 {
-	if ((now - _lastTriedMemorizedPath) >= ZT_TRY_MEMORIZED_PATH_INTERVAL) {
-		_lastTriedMemorizedPath = now;
+	if ((now - _cold->_lastTriedMemorizedPath) >= ZT_TRY_MEMORIZED_PATH_INTERVAL) {
+		_cold->_lastTriedMemorizedPath = now;
 		InetAddress mp;
 		if (RR->node->externalPathLookup(tPtr,_id.address(),-1,mp)) {
 			attemptToContactAt(tPtr,-1,mp,now,true);
@@ -501,8 +618,8 @@ void Peer::performMultipathStateCheck(void *tPtr, int64_t now)
 			numAlivePaths++;
 		}
 	}
-	_localMultipathSupported = ((numAlivePaths >= 1) && (RR->bc->inUse()) && (ZT_PROTO_VERSION > 9));
-	if (_localMultipathSupported && !_bond) {
+	_cold->_localMultipathSupported = ((numAlivePaths >= 1) && (RR->bc->inUse()) && (ZT_PROTO_VERSION > 9));
+	if (_cold->_localMultipathSupported && !_bond) {
 		if (RR->bc) {
 			_bond = RR->bc->createBond(RR, this);
 			/**
@@ -527,9 +644,9 @@ unsigned int Peer::doPingAndKeepalive(void *tPtr,int64_t now)
 
 		performMultipathStateCheck(tPtr, now);
 
-		const bool sendFullHello = ((now - _lastSentFullHello) >= ZT_PEER_PING_PERIOD);
+		const bool sendFullHello = ((now - _cold->_lastSentFullHello) >= (int64_t)(ZT_PEER_PING_PERIOD - _cold->_keepaliveJitter));
 		if (sendFullHello) {
-			_lastSentFullHello = now;
+			_cold->_lastSentFullHello = now;
 		}
 
 		// Right now we only keep pinging links that have the maximum priority. The
@@ -550,11 +667,16 @@ unsigned int Peer::doPingAndKeepalive(void *tPtr,int64_t now)
 			if (_paths[i].p) {
 				// Clean expired and reduced priority paths
 				if ( ((now - _paths[i].lr) < ZT_PEER_PATH_EXPIRATION) && (_paths[i].priority == maxPriority) ) {
-					if ((sendFullHello)||(_paths[i].p->needsHeartbeat(now))) {
+					if ((sendFullHello)||(_paths[i].p->needsHeartbeat(now,_cold->_keepaliveJitter % (ZT_PATH_HEARTBEAT_PERIOD / 8)))) {
+						_paths[i].p->updateKeepaliveInterval(now);
+						_paths[i].p->keepaliveProbeSent(now);
 						attemptToContactAt(tPtr,_paths[i].p->localSocket(),_paths[i].p->address(),now,sendFullHello);
 						_paths[i].p->sent(now);
 						sent |= (_paths[i].p->address().ss_family == AF_INET) ? 0x1 : 0x2;
 					}
+					if ((_paths[i].p->alive(now))&&(_paths[i].p->shouldProbeMtu(now))) {
+						sendMtuProbe(tPtr,_paths[i].p,now);
+					}
 				} else {
 					_paths[i] = _PeerPath();
 					deletionOccurred = true;
@@ -571,6 +693,7 @@ unsigned int Peer::doPingAndKeepalive(void *tPtr,int64_t now)
 				deletionOccurred = false;
 			}
 		}
+		_rebuildPathIndex();
 #ifndef ZT_NO_PEER_METRICS
 		uint16_t alive_path_count_tmp = 0, dead_path_count_tmp = 0;
 		for(unsigned int i=0;i<ZT_MAX_PEER_NETWORK_PATHS;++i) {
@@ -642,6 +765,7 @@ void Peer::clusterRedirect(void *tPtr,const SharedPtr<Path> &originatingPath,con
 				++j;
 			}
 		}
+		_rebuildPathIndex();
 	}
 }
 
@@ -667,7 +791,7 @@ void Peer::recordOutgoingPacket(const SharedPtr<Path> &path, const uint64_t pack
 #ifndef ZT_NO_PEER_METRICS
 	_outgoing_packet++;
 #endif
-	if (_localMultipathSupported && _bond) {
+	if (_cold->_localMultipathSupported && _bond) {
 		_bond->recordOutgoingPacket(path, packetId, payloadLength, verb, flowId, now);
 	}
 }
@@ -677,7 +801,7 @@ void Peer::recordIncomingInvalidPacket(const SharedPtr<Path>& path)
 #ifndef ZT_NO_PEER_METRICS
 	_packet_errors++;
 #endif
-	if (_localMultipathSupported && _bond) {
+	if (_cold->_localMultipathSupported && _bond) {
 		_bond->recordIncomingInvalidPacket(path);
 	}
 }
@@ -685,7 +809,7 @@ void Peer::recordIncomingInvalidPacket(const SharedPtr<Path>& path)
 void Peer::recordIncomingPacket(const SharedPtr<Path> &path, const uint64_t packetId,
 	uint16_t payloadLength, const Packet::Verb verb, const int32_t flowId, int64_t now)
 {
-	if (_localMultipathSupported && _bond) {
+	if (_cold->_localMultipathSupported && _bond) {
 		_bond->recordIncomingPacket(path, packetId, payloadLength, verb, flowId, now);
 	}
 }
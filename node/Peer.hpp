@@ -36,7 +36,29 @@
 #include "AES.hpp"
 #include "Metrics.hpp"
 
-#define ZT_PEER_MAX_SERIALIZED_STATE_SIZE (sizeof(Peer) + 32 + (sizeof(Path) * 2))
+// The + 256 covers the cold bookkeeping that lives behind Peer::_cold and so no longer counts toward sizeof(Peer)
+#define ZT_PEER_MAX_SERIALIZED_STATE_SIZE (sizeof(Peer) + 256 + 32 + (sizeof(Path) * 2))
+
+// Size of the per-peer path match index (power of two, >= 2x ZT_MAX_PEER_NETWORK_PATHS)
+#define ZT_PEER_PATH_INDEX_SIZE 128
+
+// Size of a session resumption ticket in bytes
+#define ZT_PEER_RESUMPTION_TICKET_SIZE 32
+
+// Wire length of a serialized public C25519 identity (address, type byte,
+// public key, zero private key length) as sent in OK(WHOIS) responses
+#define ZT_PEER_WHOIS_IDENTITY_LENGTH (ZT_ADDRESS_LENGTH + 2 + ZT_C25519_PUBLIC_KEY_LEN)
+
+/**
+ * Maximum number of remote group keys remembered per peer (one per network in practice)
+ */
+#define ZT_PEER_MAX_REMOTE_GROUP_KEYS 4
+
+// How long a session resumption ticket remains valid after issue
+#define ZT_PEER_RESUMPTION_TICKET_TTL 3600000
+
+// How long after a RENDEZVOUS a learned direct path is attributed to it for NAT port delta learning
+#define ZT_PEER_RENDEZVOUS_ATTRIBUTION_WINDOW 30000
 
 namespace ZeroTier {
 
@@ -57,6 +79,7 @@ public:
 	~Peer() {
 		Utils::burn(_key,sizeof(_key));
 		RR->bc->destroyBond(_id.address().toInt());
+		delete _cold;
 	}
 
 	/**
@@ -79,6 +102,11 @@ public:
 	 */
 	inline const Identity &identity() const { return _id; }
 
+	/**
+	 * @return This peer's public identity in wire form, cached for WHOIS serving (ZT_PEER_WHOIS_IDENTITY_LENGTH bytes)
+	 */
+	inline const uint8_t *serializedIdentityForWhois() const { return _cold->_whoisIdentityBlob; }
+
 	/**
 	 * Log receipt of an authenticated packet
 	 *
@@ -223,6 +251,18 @@ public:
 	 */
 	void attemptToContactAt(void *tPtr,const int64_t localSocket,const InetAddress &atAddress,int64_t now,bool sendFullHello);
 
+	/**
+	 * Send a zero-padded ECHO over the given path to probe its physical MTU
+	 *
+	 * The echoed OK() will be the same wire size as the probe, so its arrival
+	 * proves the path carries packets of that size in both directions.
+	 *
+	 * @param tPtr Thread pointer to be handed through to any callbacks called as a result of this call
+	 * @param path Direct path to probe
+	 * @param now Current time
+	 */
+	void sendMtuProbe(void *tPtr,const SharedPtr<Path> &path,int64_t now);
+
 	/**
 	 * Try a memorized or statically defined path if any are known
 	 *
@@ -309,15 +349,15 @@ public:
 	 */
 	inline int64_t isActive(int64_t now) const { return ((now - _lastNontrivialReceive) < ZT_PEER_ACTIVITY_TIMEOUT); }
 
-	inline int64_t lastSentFullHello() { return _lastSentFullHello; }
+	inline int64_t lastSentFullHello() { return _cold->_lastSentFullHello; }
 
 	/**
 	 * @return Latency in milliseconds of best/aggregate path or 0xffff if unknown / no paths
 	 */
 	inline unsigned int latency(const int64_t now)
 	{
-		if (_localMultipathSupported) {
-			return (int)_lastComputedAggregateMeanLatency;
+		if (_cold->_localMultipathSupported) {
+			return (int)_cold->_lastComputedAggregateMeanLatency;
 		} else {
 			SharedPtr<Path> bp(getAppropriatePath(now,false));
 			if (bp) {
@@ -353,6 +393,11 @@ public:
 
 	/**
 	 * @return 256-bit secret symmetric encryption key
+	 *
+	 * The key and the AES key schedules derived from it are computed once in
+	 * the constructor and are immutable for the life of the Peer, so armor()
+	 * and dearmor() never pay for key agreement or key expansion on the
+	 * packet path.
 	 */
 	inline const unsigned char *key() const { return _key; }
 
@@ -367,17 +412,17 @@ public:
 	inline void setRemoteVersion(unsigned int vproto,unsigned int vmaj,unsigned int vmin,unsigned int vrev)
 	{
 		_vProto = (uint16_t)vproto;
-		_vMajor = (uint16_t)vmaj;
-		_vMinor = (uint16_t)vmin;
-		_vRevision = (uint16_t)vrev;
+		_cold->_vMajor = (uint16_t)vmaj;
+		_cold->_vMinor = (uint16_t)vmin;
+		_cold->_vRevision = (uint16_t)vrev;
 	}
 
 	inline unsigned int remoteVersionProtocol() const { return _vProto; }
-	inline unsigned int remoteVersionMajor() const { return _vMajor; }
-	inline unsigned int remoteVersionMinor() const { return _vMinor; }
-	inline unsigned int remoteVersionRevision() const { return _vRevision; }
+	inline unsigned int remoteVersionMajor() const { return _cold->_vMajor; }
+	inline unsigned int remoteVersionMinor() const { return _cold->_vMinor; }
+	inline unsigned int remoteVersionRevision() const { return _cold->_vRevision; }
 
-	inline bool remoteVersionKnown() const { return ((_vMajor > 0)||(_vMinor > 0)||(_vRevision > 0)); }
+	inline bool remoteVersionKnown() const { return ((_cold->_vMajor > 0)||(_cold->_vMinor > 0)||(_cold->_vRevision > 0)); }
 
 	/**
 	 * @return True if peer has received a trust established packet (e.g. common network membership) in the past ZT_TRUST_EXPIRATION ms
@@ -389,13 +434,13 @@ public:
 	 */
 	inline bool rateGatePushDirectPaths(const int64_t now)
 	{
-		if ((now - _lastDirectPathPushReceive) <= ZT_PUSH_DIRECT_PATHS_CUTOFF_TIME) {
-			++_directPathPushCutoffCount;
+		if ((now - _cold->_lastDirectPathPushReceive) <= ZT_PUSH_DIRECT_PATHS_CUTOFF_TIME) {
+			++_cold->_directPathPushCutoffCount;
 		} else {
-			_directPathPushCutoffCount = 0;
+			_cold->_directPathPushCutoffCount = 0;
 		}
-		_lastDirectPathPushReceive = now;
-		return (_directPathPushCutoffCount < ZT_PUSH_DIRECT_PATHS_CUTOFF_LIMIT);
+		_cold->_lastDirectPathPushReceive = now;
+		return (_cold->_directPathPushCutoffCount < ZT_PUSH_DIRECT_PATHS_CUTOFF_LIMIT);
 	}
 
 	/**
@@ -403,8 +448,8 @@ public:
 	 */
 	inline bool rateGateCredentialsReceived(const int64_t now)
 	{
-		if ((now - _lastCredentialsReceived) >= ZT_PEER_CREDENTIALS_RATE_LIMIT) {
-			_lastCredentialsReceived = now;
+		if ((now - _cold->_lastCredentialsReceived) >= ZT_PEER_CREDENTIALS_RATE_LIMIT) {
+			_cold->_lastCredentialsReceived = now;
 			return true;
 		}
 		return false;
@@ -415,8 +460,8 @@ public:
 	 */
 	inline bool rateGateRequestCredentials(const int64_t now)
 	{
-		if ((now - _lastCredentialRequestSent) >= ZT_PEER_GENERAL_RATE_LIMIT) {
-			_lastCredentialRequestSent = now;
+		if ((now - _cold->_lastCredentialRequestSent) >= ZT_PEER_GENERAL_RATE_LIMIT) {
+			_cold->_lastCredentialRequestSent = now;
 			return true;
 		}
 		return false;
@@ -427,13 +472,185 @@ public:
 	 */
 	inline bool rateGateInboundWhoisRequest(const int64_t now)
 	{
-		if ((now - _lastWhoisRequestReceived) >= ZT_PEER_WHOIS_RATE_LIMIT) {
-			_lastWhoisRequestReceived = now;
+		if ((now - _cold->_lastWhoisRequestReceived) >= ZT_PEER_WHOIS_RATE_LIMIT) {
+			_cold->_lastWhoisRequestReceived = now;
 			return true;
 		}
 		return false;
 	}
 
+	/**
+	 * @return True if this peer advertised VERB_FRAME_BUNDLE support in its last HELLO or OK(HELLO)
+	 */
+	inline bool remoteSupportsFrameBundles() const { return _remoteSupportsFrameBundles; }
+
+	/**
+	 * Set whether this peer accepts VERB_FRAME_BUNDLE (from HELLO/OK(HELLO) extension flags)
+	 */
+	inline void setRemoteFrameBundleSupport(const bool supported) { _remoteSupportsFrameBundles = supported; }
+
+	/**
+	 * @return True if this peer advertised group key support in its last HELLO or OK(HELLO)
+	 */
+	inline bool remoteSupportsGroupKeys() const { return _remoteSupportsGroupKeys; }
+
+	/**
+	 * Set whether this peer accepts VERB_GROUP_KEY and group-keyed packets (from HELLO/OK(HELLO) extension flags)
+	 */
+	inline void setRemoteGroupKeySupport(const bool supported) { _remoteSupportsGroupKeys = supported; }
+
+	/**
+	 * Store a group key received from this peer via VERB_GROUP_KEY
+	 *
+	 * A key with an already-known ID refreshes in place; otherwise the
+	 * oldest slot is replaced. Senders use one key per network, so the
+	 * small fixed table never evicts live keys in practice.
+	 *
+	 * @param keyId Sender-assigned 64-bit key ID
+	 * @param key 32-byte symmetric key
+	 */
+	inline void receiveRemoteGroupKey(const uint64_t keyId,const uint8_t key[32])
+	{
+		Mutex::Lock _l(_remoteGroupKeys_m);
+		for(unsigned int i=0;i<_remoteGroupKeyCount;++i) {
+			if (_remoteGroupKeys[i].id == keyId) {
+				memcpy(_remoteGroupKeys[i].key,key,32);
+				return;
+			}
+		}
+		if (_remoteGroupKeyCount >= ZT_PEER_MAX_REMOTE_GROUP_KEYS) {
+			memmove(&(_remoteGroupKeys[0]),&(_remoteGroupKeys[1]),sizeof(_remoteGroupKeys[0]) * (ZT_PEER_MAX_REMOTE_GROUP_KEYS - 1));
+			_remoteGroupKeyCount = ZT_PEER_MAX_REMOTE_GROUP_KEYS - 1;
+		}
+		_remoteGroupKeys[_remoteGroupKeyCount].id = keyId;
+		memcpy(_remoteGroupKeys[_remoteGroupKeyCount].key,key,32);
+		++_remoteGroupKeyCount;
+	}
+
+	/**
+	 * Try to authenticate and decrypt a group-keyed packet from this peer
+	 *
+	 * The key ID is not carried in the packet header, so each of this
+	 * peer's known group keys (almost always one) is tried in turn.
+	 *
+	 * @param pkt Packet armored with cipher suite POLY1305_SALSA2012_GROUP
+	 * @return True if a known group key authenticated the packet
+	 */
+	inline bool dearmorWithRemoteGroupKey(Packet &pkt)
+	{
+		uint8_t keys[ZT_PEER_MAX_REMOTE_GROUP_KEYS][32];
+		unsigned int nk = 0;
+		{
+			Mutex::Lock _l(_remoteGroupKeys_m);
+			nk = _remoteGroupKeyCount;
+			for(unsigned int i=0;i<nk;++i) {
+				memcpy(keys[i],_remoteGroupKeys[i].key,32);
+			}
+		}
+		for(unsigned int i=0;i<nk;++i) {
+			if (pkt.dearmorGroup(keys[i])) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Record the target address of a RENDEZVOUS-driven contact attempt
+	 *
+	 * If a direct path to this peer is learned shortly afterward, the
+	 * difference between the advertised and working ports is remembered as
+	 * this peer's NAT port delta (symmetric NATs commonly remap ports by a
+	 * stable offset) and persisted with the peer cache.
+	 *
+	 * @param addr Address advertised in RENDEZVOUS
+	 * @param now Current time
+	 */
+	inline void noteRendezvous(const InetAddress &addr,const int64_t now)
+	{
+		_cold->_lastRendezvousAddr = addr;
+		_cold->_lastRendezvousAt = now;
+	}
+
+	/**
+	 * @return Learned NAT port delta for this peer (0 if none learned)
+	 */
+	inline int natPortDelta() const { return _cold->_natPortDelta; }
+
+	/**
+	 * @return Time a direct path to this peer last became established, or 0 if never
+	 */
+	inline int64_t lastDirectPathSuccess() const { return _cold->_lastDirectPathSuccess; }
+
+	/**
+	 * Get a session resumption ticket to send in OK(HELLO)
+	 *
+	 * The ticket is remembered (and persisted with the peer cache) so this
+	 * peer can present it in its first HELLO after a restart to prove a
+	 * recent authenticated session. The current ticket is reused while it
+	 * still has at least half its life left, so an OK(HELLO) lost in transit
+	 * does not invalidate the copy the peer already holds.
+	 *
+	 * @param now Current time
+	 * @param ticket Buffer to receive ZT_PEER_RESUMPTION_TICKET_SIZE bytes
+	 */
+	inline void issueResumptionTicket(const int64_t now,uint8_t ticket[ZT_PEER_RESUMPTION_TICKET_SIZE])
+	{
+		if ((_cold->_resumptionTicketIssuedExpiry - now) < (ZT_PEER_RESUMPTION_TICKET_TTL / 2)) {
+			Utils::getSecureRandom(_cold->_resumptionTicketIssued,ZT_PEER_RESUMPTION_TICKET_SIZE);
+			_cold->_resumptionTicketIssuedExpiry = now + ZT_PEER_RESUMPTION_TICKET_TTL;
+		}
+		memcpy(ticket,_cold->_resumptionTicketIssued,ZT_PEER_RESUMPTION_TICKET_SIZE);
+	}
+
+	/**
+	 * Check a session resumption ticket presented in HELLO against the one we issued
+	 *
+	 * @param ticket Presented ticket (ZT_PEER_RESUMPTION_TICKET_SIZE bytes)
+	 * @param now Current time
+	 * @return True if the ticket matches an unexpired ticket we issued to this peer
+	 */
+	inline bool checkResumptionTicket(const uint8_t *ticket,const int64_t now) const
+	{
+		if ((_cold->_resumptionTicketIssuedExpiry == 0)||(_cold->_resumptionTicketIssuedExpiry <= now)) {
+			return false;
+		}
+		return Utils::secureEq(ticket,_cold->_resumptionTicketIssued,ZT_PEER_RESUMPTION_TICKET_SIZE);
+	}
+
+	/**
+	 * Remember a session resumption ticket this peer issued to us in OK(HELLO)
+	 *
+	 * @param ticket Issued ticket (ZT_PEER_RESUMPTION_TICKET_SIZE bytes)
+	 * @param now Current time
+	 */
+	inline void setResumptionTicket(const uint8_t *ticket,const int64_t now)
+	{
+		memcpy(_cold->_resumptionTicketReceived,ticket,ZT_PEER_RESUMPTION_TICKET_SIZE);
+		_cold->_resumptionTicketReceivedExpiry = now + ZT_PEER_RESUMPTION_TICKET_TTL;
+	}
+
+	/**
+	 * Get the session resumption ticket to present in HELLO, if any
+	 *
+	 * Only the first HELLO to this peer after process start presents a
+	 * ticket; within a continuous session the other side's state is intact
+	 * and there is nothing to resume.
+	 *
+	 * @param now Current time
+	 * @param ticket Buffer to receive ZT_PEER_RESUMPTION_TICKET_SIZE bytes
+	 * @return True if a ticket should be presented and was copied to the buffer
+	 */
+	inline bool resumptionTicketToPresent(const int64_t now,uint8_t ticket[ZT_PEER_RESUMPTION_TICKET_SIZE])
+	{
+		if ((_cold->_resumptionTicketPresented)||(_cold->_resumptionTicketReceivedExpiry == 0)||(_cold->_resumptionTicketReceivedExpiry <= now)) {
+			return false;
+		}
+		_cold->_resumptionTicketPresented = true;
+		memcpy(ticket,_cold->_resumptionTicketReceived,ZT_PEER_RESUMPTION_TICKET_SIZE);
+		return true;
+	}
+
 	/**
 	 * Serialize a peer for storage in local cache
 	 *
@@ -442,14 +659,14 @@ public:
 	template<unsigned int C>
 	inline void serializeForCache(Buffer<C> &b) const
 	{
-		b.append((uint8_t)2);
+		b.append((uint8_t)3);
 
 		_id.serialize(b);
 
 		b.append((uint16_t)_vProto);
-		b.append((uint16_t)_vMajor);
-		b.append((uint16_t)_vMinor);
-		b.append((uint16_t)_vRevision);
+		b.append((uint16_t)_cold->_vMajor);
+		b.append((uint16_t)_cold->_vMinor);
+		b.append((uint16_t)_cold->_vRevision);
 
 		{
 			Mutex::Lock _l(_paths_m);
@@ -466,6 +683,14 @@ public:
 				_paths[i].p->address().serialize(b);
 			}
 		}
+
+		b.append(_cold->_resumptionTicketIssued,ZT_PEER_RESUMPTION_TICKET_SIZE);
+		b.append((uint64_t)_cold->_resumptionTicketIssuedExpiry);
+		b.append(_cold->_resumptionTicketReceived,ZT_PEER_RESUMPTION_TICKET_SIZE);
+		b.append((uint64_t)_cold->_resumptionTicketReceivedExpiry);
+
+		b.append((uint64_t)_cold->_lastDirectPathSuccess);
+		b.append((uint32_t)((int32_t)_cold->_natPortDelta));
 	}
 
 	template<unsigned int C>
@@ -473,7 +698,8 @@ public:
 	{
 		try {
 			unsigned int ptr = 0;
-			if (b[ptr++] != 2) {
+			const uint8_t cacheVersion = b[ptr++];
+			if ((cacheVersion != 2)&&(cacheVersion != 3)) {
 				return SharedPtr<Peer>();
 			}
 
@@ -487,11 +713,11 @@ public:
 
 			p->_vProto = b.template at<uint16_t>(ptr);
 			ptr += 2;
-			p->_vMajor = b.template at<uint16_t>(ptr);
+			p->_cold->_vMajor = b.template at<uint16_t>(ptr);
 			ptr += 2;
-			p->_vMinor = b.template at<uint16_t>(ptr);
+			p->_cold->_vMinor = b.template at<uint16_t>(ptr);
 			ptr += 2;
-			p->_vRevision = b.template at<uint16_t>(ptr);
+			p->_cold->_vRevision = b.template at<uint16_t>(ptr);
 			ptr += 2;
 
 			// When we deserialize from the cache we don't actually restore paths. We
@@ -511,6 +737,22 @@ public:
 				}
 			}
 
+			if (cacheVersion >= 3) {
+				memcpy(p->_cold->_resumptionTicketIssued,b.field(ptr,ZT_PEER_RESUMPTION_TICKET_SIZE),ZT_PEER_RESUMPTION_TICKET_SIZE);
+				ptr += ZT_PEER_RESUMPTION_TICKET_SIZE;
+				p->_cold->_resumptionTicketIssuedExpiry = (int64_t)b.template at<uint64_t>(ptr);
+				ptr += 8;
+				memcpy(p->_cold->_resumptionTicketReceived,b.field(ptr,ZT_PEER_RESUMPTION_TICKET_SIZE),ZT_PEER_RESUMPTION_TICKET_SIZE);
+				ptr += ZT_PEER_RESUMPTION_TICKET_SIZE;
+				p->_cold->_resumptionTicketReceivedExpiry = (int64_t)b.template at<uint64_t>(ptr);
+				ptr += 8;
+
+				p->_cold->_lastDirectPathSuccess = (int64_t)b.template at<uint64_t>(ptr);
+				ptr += 8;
+				p->_cold->_natPortDelta = (int)((int32_t)b.template at<uint32_t>(ptr));
+				ptr += 4;
+			}
+
 			return p;
 		} catch ( ... ) {
 			return SharedPtr<Peer>();
@@ -551,53 +793,179 @@ private:
 		long priority; // >= 1, higher is better
 	};
 
-	uint8_t _key[ZT_SYMMETRIC_KEY_SIZE];
-	AES _aesKeys[2];
+	/**
+	 * Rarely touched per-peer bookkeeping, held behind a single pointer
+	 *
+	 * Everything here is read only by periodic housekeeping, HELLO/version
+	 * exchange, rate gates, or diagnostics, so it stays off the cache lines
+	 * the per-packet paths walk. Anything touched by received() or
+	 * getAppropriatePath() on the fast path belongs among the hot fields
+	 * below instead; the layout guards at the top of Peer.cpp enforce that
+	 * block's size. On relays peers are the dominant working set, which is
+	 * what makes the line count per packet matter.
+	 */
+	struct _ColdData
+	{
+		_ColdData(const Identity &peerIdentity) :
+			_lastTriedMemorizedPath(0),
+			_lastDirectPathPushSent(0),
+			_lastDirectPathPushReceive(0),
+			_lastCredentialRequestSent(0),
+			_lastWhoisRequestReceived(0),
+			_lastCredentialsReceived(0),
+			_lastSentFullHello(0),
+			_lastEchoCheck(0),
+			_keepaliveJitter((unsigned int)((peerIdentity.address().toInt() * 0x9e3779b97f4a7c15ULL) >> 52)), // 0-4095ms
+			_vMajor(0),
+			_vMinor(0),
+			_vRevision(0),
+			_resumptionTicketIssuedExpiry(0),
+			_resumptionTicketReceivedExpiry(0),
+			_resumptionTicketPresented(false),
+			_lastRendezvousAt(0),
+			_lastDirectPathSuccess(0),
+			_natPortDelta(0),
+			_directPathPushCutoffCount(0),
+			_echoRequestCutoffCount(0),
+			_localMultipathSupported(false),
+			_lastComputedAggregateMeanLatency(0)
+		{
+			memset(_resumptionTicketIssued,0,sizeof(_resumptionTicketIssued));
+			memset(_resumptionTicketReceived,0,sizeof(_resumptionTicketReceived));
+			Buffer<ZT_PEER_WHOIS_IDENTITY_LENGTH> wb;
+			peerIdentity.serialize(wb,false);
+			memcpy(_whoisIdentityBlob,wb.data(),ZT_PEER_WHOIS_IDENTITY_LENGTH);
+		}
+
+		int64_t _lastTriedMemorizedPath;
+		int64_t _lastDirectPathPushSent;
+		int64_t _lastDirectPathPushReceive;
+		int64_t _lastCredentialRequestSent;
+		int64_t _lastWhoisRequestReceived;
+		int64_t _lastCredentialsReceived;
+		int64_t _lastSentFullHello;
+		int64_t _lastEchoCheck;
+
+		// Deterministic per-peer jitter (milliseconds) subtracted from the HELLO
+		// and heartbeat periods so keepalive deadlines for different peers do not
+		// phase-lock into synchronized bursts. Derived from the peer's address so
+		// it is stable across restarts; periods are only ever shortened, never
+		// stretched, so path liveness margins are unaffected.
+		unsigned int _keepaliveJitter;
+
+		uint16_t _vMajor;
+		uint16_t _vMinor;
+		uint16_t _vRevision;
+
+		// Session resumption tickets: the one we issued to this peer in OK(HELLO)
+		// (checked when presented back in HELLO) and the one it issued to us
+		// (presented in our first HELLO after a restart). Both persist with the
+		// peer cache; _resumptionTicketPresented does not, which is what limits
+		// presentation to the first HELLO of a process lifetime.
+		uint8_t _resumptionTicketIssued[ZT_PEER_RESUMPTION_TICKET_SIZE];
+		uint8_t _resumptionTicketReceived[ZT_PEER_RESUMPTION_TICKET_SIZE];
+		int64_t _resumptionTicketIssuedExpiry;
+		int64_t _resumptionTicketReceivedExpiry;
+		bool _resumptionTicketPresented;
+
+		// NAT traversal outcome memory: when a direct path is learned within
+		// ZT_PEER_RENDEZVOUS_ATTRIBUTION_WINDOW of a RENDEZVOUS to the same IP,
+		// the port offset between the advertised and working address is recorded
+		// so future hole punches can probe the remapped port immediately. The
+		// delta and last success time persist with the peer cache; the pending
+		// rendezvous target is transient.
+		InetAddress _lastRendezvousAddr;
+		int64_t _lastRendezvousAt;
+		int64_t _lastDirectPathSuccess;
+		int _natPortDelta;
+
+		unsigned int _directPathPushCutoffCount;
+		unsigned int _echoRequestCutoffCount;
+
+		bool _localMultipathSupported;
+
+		int32_t _lastComputedAggregateMeanLatency;
+
+		// Wire-form public identity, serialized once at construction so roots
+		// can answer WHOIS for this peer with a memcpy
+		uint8_t _whoisIdentityBlob[ZT_PEER_WHOIS_IDENTITY_LENGTH];
+
+		std::list< std::pair< Path *, int64_t > > _lastTriedPath;
+		Mutex _lastTriedPath_m;
+	};
+
+	// ------------------------------------------------------------------
+	// Hot fields: the per-packet receive/send paths touch only the scalar
+	// block below, the key material after it, and the path table. Keep the
+	// scalars packed so they share a couple of cache lines; anything colder
+	// goes in _ColdData above. Layout guards at the top of Peer.cpp.
+	// ------------------------------------------------------------------
 
 	const RuntimeEnvironment *RR;
 
 	int64_t _lastReceive; // direct or indirect
 	int64_t _lastNontrivialReceive; // frames, things like netconf, etc.
-	int64_t _lastTriedMemorizedPath;
-	int64_t _lastDirectPathPushSent;
-	int64_t _lastDirectPathPushReceive;
-	int64_t _lastCredentialRequestSent;
-	int64_t _lastWhoisRequestReceived;
-	int64_t _lastCredentialsReceived;
 	int64_t _lastTrustEstablishedPacketReceived;
-	int64_t _lastSentFullHello;
-	int64_t _lastEchoCheck;
+	int64_t _lastPathSelection;
 
-	unsigned char _freeRandomByte;
+	AtomicCounter __refCount;
+
+	unsigned int _firstEmptyPathSlot; // first free slot in _paths, or ZT_MAX_PEER_NETWORK_PATHS if full
+	unsigned int _cachedBestPathIdx;
 
 	uint16_t _vProto;
-	uint16_t _vMajor;
-	uint16_t _vMinor;
-	uint16_t _vRevision;
+	unsigned char _freeRandomByte;
 
-	std::list< std::pair< Path *, int64_t > > _lastTriedPath;
-	Mutex _lastTriedPath_m;
+	// Whether the remote's last HELLO/OK(HELLO) advertised VERB_FRAME_BUNDLE
+	// support; session state, so not persisted with the peer cache
+	bool _remoteSupportsFrameBundles;
 
-	_PeerPath _paths[ZT_MAX_PEER_NETWORK_PATHS];
-	Mutex _paths_m;
-	Mutex _bond_m;
+	// Same for VERB_GROUP_KEY / group-keyed packets
+	bool _remoteSupportsGroupKeys;
 
 	bool _isLeaf;
+	volatile bool _shouldCollectPathStatistics;
 
-	Identity _id;
+	// Cached getAppropriatePath() result for the common stable single-path case (guarded by _paths_m)
+	SharedPtr<Path> _cachedBestPath;
 
-	unsigned int _directPathPushCutoffCount;
-	unsigned int _echoRequestCutoffCount;
+	SharedPtr<Bond> _bond;
 
-	AtomicCounter __refCount;
+	// Rarely touched bookkeeping (see _ColdData above)
+	_ColdData *_cold;
 
-	bool _localMultipathSupported;
+	// Symmetric key material, streamed by the crypto on every packet; bulky,
+	// so it sits behind the hot scalars rather than among them
+	uint8_t _key[ZT_SYMMETRIC_KEY_SIZE];
+	AES _aesKeys[2];
 
-	volatile bool _shouldCollectPathStatistics;
+	static unsigned long _pathIndexHash(const int64_t localSocket,const InetAddress &addr);
+	void _rebuildPathIndex();
+	int _findPathSlot(const SharedPtr<Path> &path) const;
 
-	int32_t _lastComputedAggregateMeanLatency;
+	_PeerPath _paths[ZT_MAX_PEER_NETWORK_PATHS];
+	Mutex _paths_m;
 
-	SharedPtr<Bond> _bond;
+	// Open addressing index mapping (local socket, remote IP) to a slot in
+	// _paths so per-packet path matching is O(1) instead of a scan of every
+	// slot. Guarded by _paths_m and rebuilt whenever the path table changes,
+	// which is rare next to per-packet lookups. Entries are slot + 1 with 0
+	// meaning empty; the hash covers the IP only, matching the ipsEqual()
+	// semantics used when comparing paths.
+	uint8_t _pathIndex[ZT_PEER_PATH_INDEX_SIZE];
+
+	Mutex _bond_m;
+
+	// Group keys this peer has sent us for group-keyed multicast (session
+	// state, never persisted); scanned on every group-armored packet
+	struct {
+		uint64_t id;
+		uint8_t key[32];
+	} _remoteGroupKeys[ZT_PEER_MAX_REMOTE_GROUP_KEYS];
+	unsigned int _remoteGroupKeyCount;
+	Mutex _remoteGroupKeys_m;
+
+	Identity _id;
 
 #ifndef ZT_NO_PEER_METRICS
 	prometheus::Histogram<uint64_t> &_peer_latency;
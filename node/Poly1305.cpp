@@ -6,6 +6,7 @@ Public domain.
 
 #include "Constants.hpp"
 #include "Poly1305.hpp"
+#include "Utils.hpp"
 
 #include <stdio.h>
 #include <stdint.h>
@@ -139,6 +140,17 @@ static inline void poly1305_blocks(poly1305_state_internal_t *st, const unsigned
   unsigned long long c;
   uint128_t d0,d1,d2,d;
 
+#ifdef ZT_POLY1305_AVX2
+  /* The multi-block kernel pays for computing powers of r, so only bother
+   * for messages of several blocks. It never handles the final block since
+   * it always runs with the 2^128 bit set. */
+  if ((!st->final)&&(bytes >= 256)&&(Utils::CPUID.avx2)) {
+    const size_t done = poly1305BlocksAVX2(st->r,st->h,m,bytes);
+    m += done;
+    bytes -= done;
+  }
+#endif
+
   r0 = st->r[0];
   r1 = st->r[1];
   r2 = st->r[2];
@@ -522,4 +534,20 @@ void Poly1305::compute(void *auth,const void *data,unsigned int len,const void *
   poly1305_finish(&ctx,reinterpret_cast<unsigned char *>(auth));
 }
 
+void Poly1305::init(const void *key)
+{
+  static_assert(sizeof(poly1305_context) <= sizeof(_ctx),"Poly1305 opaque context storage too small");
+  poly1305_init(reinterpret_cast<poly1305_context *>(_ctx),reinterpret_cast<const unsigned char *>(key));
+}
+
+void Poly1305::update(const void *data,unsigned int len)
+{
+  poly1305_update(reinterpret_cast<poly1305_context *>(_ctx),reinterpret_cast<const unsigned char *>(data),(size_t)len);
+}
+
+void Poly1305::finish(void *auth)
+{
+  poly1305_finish(reinterpret_cast<poly1305_context *>(_ctx),reinterpret_cast<unsigned char *>(auth));
+}
+
 } // namespace ZeroTier
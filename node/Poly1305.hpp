@@ -14,11 +14,41 @@
 #ifndef ZT_POLY1305_HPP
 #define ZT_POLY1305_HPP
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Constants.hpp"
+
+/* Multi-block AVX2 kernel, dispatched at runtime on Utils::CPUID.avx2.
+ * Disable on compilers too old to compile these intrinsics and on Windows
+ * where MinGW64 support is spotty (same guard as the VAES code in AES). */
+#if defined(ZT_ARCH_X64) && !defined(__WINDOWS__) && ((__GNUC__ >= 8) || (__clang_major__ >= 7))
+#define ZT_POLY1305_AVX2 1
+#endif
+
 namespace ZeroTier {
 
 #define ZT_POLY1305_KEY_LEN 32
 #define ZT_POLY1305_MAC_LEN 16
 
+#ifdef ZT_POLY1305_AVX2
+/**
+ * Accumulate as many whole groups of four 16-byte blocks as possible using AVX2
+ *
+ * Internal to Poly1305; defined in Poly1305_avx2.cpp. Takes and updates the
+ * radix 2^44 accumulator used by the 128-bit scalar implementation and
+ * returns the number of bytes consumed (a multiple of 64); the caller
+ * processes the remainder.
+ *
+ * @param r Clamped key in three 44-bit limbs
+ * @param h Accumulator in three 44-bit limbs (updated)
+ * @param m Message bytes
+ * @param bytes Length of message
+ * @return Number of bytes processed
+ */
+size_t poly1305BlocksAVX2(const unsigned long long r[3],unsigned long long h[3],const unsigned char *m,size_t bytes) noexcept;
+#endif // ZT_POLY1305_AVX2
+
 /**
  * Poly1305 one-time authentication code
  *
@@ -42,6 +72,41 @@ public:
 	 * @param key 32-byte one-time use key to authenticate data (must not be reused)
 	 */
 	static void compute(void *auth,const void *data,unsigned int len,const void *key);
+
+	/**
+	 * Create an incremental Poly1305 instance (init() must be called before use)
+	 *
+	 * The incremental interface produces the same code as compute() but lets
+	 * the message be fed in chunks, so callers can interleave authentication
+	 * with other per-chunk work (e.g. encrypting in place) in one sweep of a
+	 * buffer instead of making a second full pass.
+	 */
+	Poly1305() {}
+
+	/**
+	 * Initialize or reset for a new message
+	 *
+	 * @param key 32-byte one-time use key (must not be reused)
+	 */
+	void init(const void *key);
+
+	/**
+	 * Process a chunk of the message
+	 *
+	 * @param data Data to authenticate
+	 * @param len Length of data in bytes
+	 */
+	void update(const void *data,unsigned int len);
+
+	/**
+	 * Generate the authentication code (call only once per init())
+	 *
+	 * @param auth Buffer to receive code -- MUST be 16 bytes in length
+	 */
+	void finish(void *auth);
+
+private:
+	uint64_t _ctx[18]; // opaque storage for the implementation's context
 };
 
 } // namespace ZeroTier
@@ -0,0 +1,225 @@
+/*
+ * AVX2 multi-block Poly1305 kernel for the scalar implementation in
+ * Poly1305.cpp, which is based on public domain Poly1305-donna code.
+ * This therefore is public domain as well.
+ */
+
+#include "Constants.hpp"
+#include "Poly1305.hpp"
+
+#ifdef ZT_POLY1305_AVX2
+
+#include <stdint.h>
+
+#include <immintrin.h>
+
+namespace ZeroTier {
+
+namespace {
+
+#if defined(__SIZEOF_INT128__)
+typedef unsigned __int128 uint128_t;
+#else
+typedef unsigned uint128_t __attribute__((mode(TI)));
+#endif
+
+#define M26 0x3ffffff
+
+// Multiply two radix 2^26 numbers mod 2^130-5, fully carried, limbs < 2^26
+void p_mul26(uint32_t out[5],const uint32_t a[5],const uint32_t b[5]) noexcept
+{
+	const uint64_t b0 = b[0],b1 = b[1],b2 = b[2],b3 = b[3],b4 = b[4];
+	const uint64_t s1 = b1 * 5,s2 = b2 * 5,s3 = b3 * 5,s4 = b4 * 5;
+	uint64_t d0 = ((uint64_t)a[0] * b0) + ((uint64_t)a[1] * s4) + ((uint64_t)a[2] * s3) + ((uint64_t)a[3] * s2) + ((uint64_t)a[4] * s1);
+	uint64_t d1 = ((uint64_t)a[0] * b1) + ((uint64_t)a[1] * b0) + ((uint64_t)a[2] * s4) + ((uint64_t)a[3] * s3) + ((uint64_t)a[4] * s2);
+	uint64_t d2 = ((uint64_t)a[0] * b2) + ((uint64_t)a[1] * b1) + ((uint64_t)a[2] * b0) + ((uint64_t)a[3] * s4) + ((uint64_t)a[4] * s3);
+	uint64_t d3 = ((uint64_t)a[0] * b3) + ((uint64_t)a[1] * b2) + ((uint64_t)a[2] * b1) + ((uint64_t)a[3] * b0) + ((uint64_t)a[4] * s4);
+	uint64_t d4 = ((uint64_t)a[0] * b4) + ((uint64_t)a[1] * b3) + ((uint64_t)a[2] * b2) + ((uint64_t)a[3] * b1) + ((uint64_t)a[4] * b0);
+	uint64_t c;
+	              c = d0 >> 26; d0 &= M26;
+	d1 += c;      c = d1 >> 26; d1 &= M26;
+	d2 += c;      c = d2 >> 26; d2 &= M26;
+	d3 += c;      c = d3 >> 26; d3 &= M26;
+	d4 += c;      c = d4 >> 26; d4 &= M26;
+	d0 += c * 5;  c = d0 >> 26; d0 &= M26;
+	d1 += c;
+	out[0] = (uint32_t)d0;
+	out[1] = (uint32_t)d1;
+	out[2] = (uint32_t)d2;
+	out[3] = (uint32_t)d3;
+	out[4] = (uint32_t)d4;
+}
+
+// Split four consecutive 16-byte blocks (one per 64-bit lane) into radix
+// 2^26 limb vectors, with the 2^128 bit set on the top limb.
+#define POLY1305_LOAD4(mm,C0,C1,C2,C3,C4) { \
+	const __m256i t0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mm)); \
+	const __m256i t1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>((mm) + 32)); \
+	const __m256i lo = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(t0,t1),0xD8); \
+	const __m256i hi = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(t0,t1),0xD8); \
+	C0 = _mm256_and_si256(lo,M26v); \
+	C1 = _mm256_and_si256(_mm256_srli_epi64(lo,26),M26v); \
+	C2 = _mm256_and_si256(_mm256_or_si256(_mm256_srli_epi64(lo,52),_mm256_slli_epi64(hi,12)),M26v); \
+	C3 = _mm256_and_si256(_mm256_srli_epi64(hi,14),M26v); \
+	C4 = _mm256_or_si256(_mm256_srli_epi64(hi,40),HIBIT); \
+}
+
+// A *= R (independently per 64-bit lane), with partial carry leaving limbs
+// just above 2^26 at most. S1..S4 are the corresponding limbs times 5.
+#define POLY1305_MUL(A0,A1,A2,A3,A4,R0,R1,R2,R3,R4,S1,S2,S3,S4) { \
+	__m256i d0 = _mm256_mul_epu32(A0,R0); \
+	d0 = _mm256_add_epi64(d0,_mm256_mul_epu32(A1,S4)); \
+	d0 = _mm256_add_epi64(d0,_mm256_mul_epu32(A2,S3)); \
+	d0 = _mm256_add_epi64(d0,_mm256_mul_epu32(A3,S2)); \
+	d0 = _mm256_add_epi64(d0,_mm256_mul_epu32(A4,S1)); \
+	__m256i d1 = _mm256_mul_epu32(A0,R1); \
+	d1 = _mm256_add_epi64(d1,_mm256_mul_epu32(A1,R0)); \
+	d1 = _mm256_add_epi64(d1,_mm256_mul_epu32(A2,S4)); \
+	d1 = _mm256_add_epi64(d1,_mm256_mul_epu32(A3,S3)); \
+	d1 = _mm256_add_epi64(d1,_mm256_mul_epu32(A4,S2)); \
+	__m256i d2 = _mm256_mul_epu32(A0,R2); \
+	d2 = _mm256_add_epi64(d2,_mm256_mul_epu32(A1,R1)); \
+	d2 = _mm256_add_epi64(d2,_mm256_mul_epu32(A2,R0)); \
+	d2 = _mm256_add_epi64(d2,_mm256_mul_epu32(A3,S4)); \
+	d2 = _mm256_add_epi64(d2,_mm256_mul_epu32(A4,S3)); \
+	__m256i d3 = _mm256_mul_epu32(A0,R3); \
+	d3 = _mm256_add_epi64(d3,_mm256_mul_epu32(A1,R2)); \
+	d3 = _mm256_add_epi64(d3,_mm256_mul_epu32(A2,R1)); \
+	d3 = _mm256_add_epi64(d3,_mm256_mul_epu32(A3,R0)); \
+	d3 = _mm256_add_epi64(d3,_mm256_mul_epu32(A4,S4)); \
+	__m256i d4 = _mm256_mul_epu32(A0,R4); \
+	d4 = _mm256_add_epi64(d4,_mm256_mul_epu32(A1,R3)); \
+	d4 = _mm256_add_epi64(d4,_mm256_mul_epu32(A2,R2)); \
+	d4 = _mm256_add_epi64(d4,_mm256_mul_epu32(A3,R1)); \
+	d4 = _mm256_add_epi64(d4,_mm256_mul_epu32(A4,R0)); \
+	__m256i cc = _mm256_srli_epi64(d0,26); A0 = _mm256_and_si256(d0,M26v); \
+	d1 = _mm256_add_epi64(d1,cc); cc = _mm256_srli_epi64(d1,26); A1 = _mm256_and_si256(d1,M26v); \
+	d2 = _mm256_add_epi64(d2,cc); cc = _mm256_srli_epi64(d2,26); A2 = _mm256_and_si256(d2,M26v); \
+	d3 = _mm256_add_epi64(d3,cc); cc = _mm256_srli_epi64(d3,26); A3 = _mm256_and_si256(d3,M26v); \
+	d4 = _mm256_add_epi64(d4,cc); cc = _mm256_srli_epi64(d4,26); A4 = _mm256_and_si256(d4,M26v); \
+	A0 = _mm256_add_epi64(A0,_mm256_add_epi64(cc,_mm256_slli_epi64(cc,2))); \
+	cc = _mm256_srli_epi64(A0,26); A0 = _mm256_and_si256(A0,M26v); \
+	A1 = _mm256_add_epi64(A1,cc); \
+}
+
+} // anonymous namespace
+
+#ifdef __GNUC__
+__attribute__((__target__("avx2")))
+#endif
+size_t poly1305BlocksAVX2(const unsigned long long r[3],unsigned long long h[3],const unsigned char *m,size_t bytes) noexcept
+{
+	// Four blocks per iteration, one per 64-bit lane. With message blocks
+	// c1..cn the tag polynomial is sum(c_j * r^(n-j+1)), so lane l can
+	// accumulate every fourth block by Horner evaluation in r^4 and the four
+	// lane sums are then weighted by r^4, r^3, r^2 and r and added. The
+	// running accumulator folds into the first block of the first group.
+	const size_t groups = bytes >> 6;
+	if (!groups) {
+		return 0;
+	}
+
+	// r and its powers in radix 2^26
+	uint32_t r1x[5],r2x[5],r3x[5],r4x[5];
+	const uint128_t rv = ((uint128_t)r[0]) | (((uint128_t)r[1]) << 44) | (((uint128_t)r[2]) << 88);
+	for(int i=0;i<5;++i) {
+		r1x[i] = (uint32_t)((uint64_t)(rv >> (26 * i)) & M26);
+	}
+	p_mul26(r2x,r1x,r1x);
+	p_mul26(r3x,r2x,r1x);
+	p_mul26(r4x,r2x,r2x);
+
+	const __m256i M26v = _mm256_set1_epi64x((long long)M26);
+	const __m256i HIBIT = _mm256_set1_epi64x((long long)1 << 24); /* 1 << 128 */
+
+	// r^4 broadcast for the Horner iteration
+	const __m256i R0 = _mm256_set1_epi64x((long long)r4x[0]);
+	const __m256i R1 = _mm256_set1_epi64x((long long)r4x[1]);
+	const __m256i R2 = _mm256_set1_epi64x((long long)r4x[2]);
+	const __m256i R3 = _mm256_set1_epi64x((long long)r4x[3]);
+	const __m256i R4 = _mm256_set1_epi64x((long long)r4x[4]);
+	const __m256i S1 = _mm256_set1_epi64x((long long)r4x[1] * 5);
+	const __m256i S2 = _mm256_set1_epi64x((long long)r4x[2] * 5);
+	const __m256i S3 = _mm256_set1_epi64x((long long)r4x[3] * 5);
+	const __m256i S4 = _mm256_set1_epi64x((long long)r4x[4] * 5);
+
+	// first group with the accumulator added to lane 0; the full 130-bit
+	// accumulator does not fit a uint128_t (unlike clamped r above), and the
+	// caller's partial reduction can leave limbs marginally above their
+	// nominal widths, so carry into canonical 44/44/42 form and then split
+	// into radix 2^26 limbs directly
+	uint64_t h0 = h[0],h1 = h[1],h2 = h[2],hc;
+	     hc = h0 >> 44; h0 &= 0xfffffffffffULL;
+	h1 += hc; hc = h1 >> 44; h1 &= 0xfffffffffffULL;
+	h2 += hc; hc = h2 >> 42; h2 &= 0x3ffffffffffULL;
+	h0 += hc * 5; hc = h0 >> 44; h0 &= 0xfffffffffffULL;
+	h1 += hc; hc = h1 >> 44; h1 &= 0xfffffffffffULL;
+	h2 += hc;
+	__m256i A0,A1,A2,A3,A4;
+	POLY1305_LOAD4(m,A0,A1,A2,A3,A4);
+	A0 = _mm256_add_epi64(A0,_mm256_set_epi64x(0,0,0,(long long)(h0 & M26)));
+	A1 = _mm256_add_epi64(A1,_mm256_set_epi64x(0,0,0,(long long)(((h0 >> 26) | (h1 << 18)) & M26)));
+	A2 = _mm256_add_epi64(A2,_mm256_set_epi64x(0,0,0,(long long)((h1 >> 8) & M26)));
+	A3 = _mm256_add_epi64(A3,_mm256_set_epi64x(0,0,0,(long long)(((h1 >> 34) | (h2 << 10)) & M26)));
+	A4 = _mm256_add_epi64(A4,_mm256_set_epi64x(0,0,0,(long long)(h2 >> 16)));
+	m += 64;
+
+	for(size_t g=1;g<groups;++g) {
+		POLY1305_MUL(A0,A1,A2,A3,A4,R0,R1,R2,R3,R4,S1,S2,S3,S4);
+		__m256i C0,C1,C2,C3,C4;
+		POLY1305_LOAD4(m,C0,C1,C2,C3,C4);
+		A0 = _mm256_add_epi64(A0,C0);
+		A1 = _mm256_add_epi64(A1,C1);
+		A2 = _mm256_add_epi64(A2,C2);
+		A3 = _mm256_add_epi64(A3,C3);
+		A4 = _mm256_add_epi64(A4,C4);
+		m += 64;
+	}
+
+	// weight lanes by r^4, r^3, r^2, r
+	const __m256i P0 = _mm256_set_epi64x((long long)r1x[0],(long long)r2x[0],(long long)r3x[0],(long long)r4x[0]);
+	const __m256i P1 = _mm256_set_epi64x((long long)r1x[1],(long long)r2x[1],(long long)r3x[1],(long long)r4x[1]);
+	const __m256i P2 = _mm256_set_epi64x((long long)r1x[2],(long long)r2x[2],(long long)r3x[2],(long long)r4x[2]);
+	const __m256i P3 = _mm256_set_epi64x((long long)r1x[3],(long long)r2x[3],(long long)r3x[3],(long long)r4x[3]);
+	const __m256i P4 = _mm256_set_epi64x((long long)r1x[4],(long long)r2x[4],(long long)r3x[4],(long long)r4x[4]);
+	const __m256i Q1 = _mm256_set_epi64x((long long)r1x[1] * 5,(long long)r2x[1] * 5,(long long)r3x[1] * 5,(long long)r4x[1] * 5);
+	const __m256i Q2 = _mm256_set_epi64x((long long)r1x[2] * 5,(long long)r2x[2] * 5,(long long)r3x[2] * 5,(long long)r4x[2] * 5);
+	const __m256i Q3 = _mm256_set_epi64x((long long)r1x[3] * 5,(long long)r2x[3] * 5,(long long)r3x[3] * 5,(long long)r4x[3] * 5);
+	const __m256i Q4 = _mm256_set_epi64x((long long)r1x[4] * 5,(long long)r2x[4] * 5,(long long)r3x[4] * 5,(long long)r4x[4] * 5);
+	POLY1305_MUL(A0,A1,A2,A3,A4,P0,P1,P2,P3,P4,Q1,Q2,Q3,Q4);
+
+	// horizontal add across lanes and fold back into three 44-bit limbs
+	uint64_t lanes[5][4];
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes[0]),A0);
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes[1]),A1);
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes[2]),A2);
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes[3]),A3);
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes[4]),A4);
+	uint64_t t0 = lanes[0][0] + lanes[0][1] + lanes[0][2] + lanes[0][3];
+	uint64_t t1 = lanes[1][0] + lanes[1][1] + lanes[1][2] + lanes[1][3];
+	uint64_t t2 = lanes[2][0] + lanes[2][1] + lanes[2][2] + lanes[2][3];
+	uint64_t t3 = lanes[3][0] + lanes[3][1] + lanes[3][2] + lanes[3][3];
+	uint64_t t4 = lanes[4][0] + lanes[4][1] + lanes[4][2] + lanes[4][3];
+	uint64_t c;
+	         c = t0 >> 26; t0 &= M26;
+	t1 += c; c = t1 >> 26; t1 &= M26;
+	t2 += c; c = t2 >> 26; t2 &= M26;
+	t3 += c; c = t3 >> 26; t3 &= M26;
+	t4 += c; c = t4 >> 26; t4 &= M26; /* overflow past 2^130 wraps to *5 */
+	t0 += c * 5;
+	         c = t0 >> 26; t0 &= M26;
+	t1 += c; c = t1 >> 26; t1 &= M26;
+	t2 += c; c = t2 >> 26; t2 &= M26;
+	t3 += c; c = t3 >> 26; t3 &= M26;
+	t4 += c;
+	const uint64_t mid = ((t0 | (t1 << 26)) >> 44) + (t2 << 8) + (t3 << 34);
+	h[0] = (t0 | (t1 << 26)) & 0xfffffffffffULL;
+	h[1] = mid & 0xfffffffffffULL;
+	h[2] = (mid >> 44) + (t4 << 16);
+
+	return groups << 6;
+}
+
+} // namespace ZeroTier
+
+#endif // ZT_POLY1305_AVX2
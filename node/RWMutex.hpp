@@ -0,0 +1,249 @@
+/*
+ * Copyright (c)2019 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2025-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+#ifndef ZT_RWMUTEX_HPP
+#define ZT_RWMUTEX_HPP
+
+#include "Constants.hpp"
+
+#ifdef __UNIX_LIKE__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+namespace ZeroTier {
+
+// libpthread based reader/writer lock
+class RWMutex
+{
+public:
+	RWMutex()
+	{
+		pthread_rwlock_init(&_mh,(const pthread_rwlockattr_t *)0);
+	}
+
+	~RWMutex()
+	{
+		pthread_rwlock_destroy(&_mh);
+	}
+
+	inline void lock() const
+	{
+		pthread_rwlock_wrlock(&((const_cast <RWMutex *> (this))->_mh));
+	}
+
+	inline void rlock() const
+	{
+		pthread_rwlock_rdlock(&((const_cast <RWMutex *> (this))->_mh));
+	}
+
+	inline void unlock() const
+	{
+		pthread_rwlock_unlock(&((const_cast <RWMutex *> (this))->_mh));
+	}
+
+	inline void runlock() const
+	{
+		pthread_rwlock_unlock(&((const_cast <RWMutex *> (this))->_mh));
+	}
+
+	/**
+	 * RAII exclusive (writer) lock
+	 */
+	class Lock
+	{
+	public:
+		Lock(RWMutex &m) :
+			_m(&m)
+		{
+			m.lock();
+		}
+
+		Lock(const RWMutex &m) :
+			_m(const_cast<RWMutex *>(&m))
+		{
+			_m->lock();
+		}
+
+		~Lock()
+		{
+			_m->unlock();
+		}
+
+	private:
+		RWMutex *const _m;
+	};
+
+	/**
+	 * RAII shared (reader) lock
+	 */
+	class RLock
+	{
+	public:
+		RLock(RWMutex &m) :
+			_m(&m)
+		{
+			m.rlock();
+		}
+
+		RLock(const RWMutex &m) :
+			_m(const_cast<RWMutex *>(&m))
+		{
+			_m->rlock();
+		}
+
+		~RLock()
+		{
+			_m->runlock();
+		}
+
+	private:
+		RWMutex *const _m;
+	};
+
+private:
+	RWMutex(const RWMutex &) {}
+	const RWMutex &operator=(const RWMutex &) { return *this; }
+
+	pthread_rwlock_t _mh;
+};
+
+} // namespace ZeroTier
+
+#endif
+
+#ifdef __WINDOWS__
+
+#include <stdlib.h>
+#include <windows.h>
+
+namespace ZeroTier {
+
+// SRWLOCK based reader/writer lock
+class RWMutex
+{
+public:
+	RWMutex()
+	{
+		InitializeSRWLock(&_sl);
+	}
+
+	~RWMutex() {}
+
+	inline void lock()
+	{
+		AcquireSRWLockExclusive(&_sl);
+	}
+
+	inline void rlock()
+	{
+		AcquireSRWLockShared(&_sl);
+	}
+
+	inline void unlock()
+	{
+		ReleaseSRWLockExclusive(&_sl);
+	}
+
+	inline void runlock()
+	{
+		ReleaseSRWLockShared(&_sl);
+	}
+
+	inline void lock() const
+	{
+		(const_cast <RWMutex *> (this))->lock();
+	}
+
+	inline void rlock() const
+	{
+		(const_cast <RWMutex *> (this))->rlock();
+	}
+
+	inline void unlock() const
+	{
+		(const_cast <RWMutex *> (this))->unlock();
+	}
+
+	inline void runlock() const
+	{
+		(const_cast <RWMutex *> (this))->runlock();
+	}
+
+	/**
+	 * RAII exclusive (writer) lock
+	 */
+	class Lock
+	{
+	public:
+		Lock(RWMutex &m) :
+			_m(&m)
+		{
+			m.lock();
+		}
+
+		Lock(const RWMutex &m) :
+			_m(const_cast<RWMutex *>(&m))
+		{
+			_m->lock();
+		}
+
+		~Lock()
+		{
+			_m->unlock();
+		}
+
+	private:
+		RWMutex *const _m;
+	};
+
+	/**
+	 * RAII shared (reader) lock
+	 */
+	class RLock
+	{
+	public:
+		RLock(RWMutex &m) :
+			_m(&m)
+		{
+			m.rlock();
+		}
+
+		RLock(const RWMutex &m) :
+			_m(const_cast<RWMutex *>(&m))
+		{
+			_m->rlock();
+		}
+
+		~RLock()
+		{
+			_m->runlock();
+		}
+
+	private:
+		RWMutex *const _m;
+	};
+
+private:
+	RWMutex(const RWMutex &) {}
+	const RWMutex &operator=(const RWMutex &) { return *this; }
+
+	SRWLOCK _sl;
+};
+
+} // namespace ZeroTier
+
+#endif // _WIN32
+
+#endif
@@ -43,11 +43,33 @@ private:
 	size_t end;
 	bool wrap;
 
+	// Running sum and sum of squares over the current contents, maintained
+	// incrementally as elements enter and leave so the mean and variance can
+	// be read in O(1) instead of re-scanning the window every time
+	double runSum;
+	double runSumSq;
+
+	inline void statAdd(const T value)
+	{
+		const double v = (double)value;
+		runSum += v;
+		runSumSq += v * v;
+	}
+
+	inline void statRemove(const T value)
+	{
+		const double v = (double)value;
+		runSum -= v;
+		runSumSq -= v * v;
+	}
+
 public:
 	RingBuffer() :
 		begin(0),
 		end(0),
-		wrap(false)
+		wrap(false),
+		runSum(0),
+		runSumSq(0)
 	{
 		memset(buf,0,sizeof(T)*S);
 	}
@@ -71,6 +93,9 @@ public:
 		if (n == 0) {
 			return n;
 		}
+		for (size_t i=0; i<n; i++) {
+			statAdd(*(buf + ((end + i) % S)));
+		}
 		const size_t first_chunk = std::min(n, S - end);
 		end = (end + first_chunk) % S;
 		if (first_chunk < n) {
@@ -87,7 +112,12 @@ public:
 	 * Fast erase, O(1).
 	 * Merely reset the buffer pointer, doesn't erase contents
 	 */
-	inline void reset() { consume(count()); }
+	inline void reset()
+	{
+		consume(count());
+		runSum = 0;
+		runSumSq = 0;
+	}
 
 	/**
 	 * adjust buffer index pointer as if we copied data out
@@ -100,6 +130,9 @@ public:
 		if (n == 0) {
 			return n;
 		}
+		for (size_t i=0; i<n; i++) {
+			statRemove(*(buf + ((begin + i) % S)));
+		}
 		if (wrap) {
 			wrap = false;
 		}
@@ -122,6 +155,9 @@ public:
 		if (n == 0) {
 			return n;
 		}
+		for (size_t i=0; i<n; i++) {
+			statAdd(data[i]);
+		}
 		const size_t first_chunk = std::min(n, S - end);
 		memcpy(buf + end, data, first_chunk * sizeof(T));
 		end = (end + first_chunk) % S;
@@ -146,6 +182,7 @@ public:
 		if (count() == S) {
 			consume(1);
 		}
+		statAdd(value);
 		const size_t first_chunk = std::min((size_t)1, S - end);
 		*(buf + end) = value;
 		end = (end + first_chunk) % S;
@@ -170,6 +207,9 @@ public:
 		if (n == 0) {
 			return n;
 		}
+		for (size_t i=0; i<n; i++) {
+			statRemove(*(buf + ((begin + i) % S)));
+		}
 		if (wrap) {
 			wrap = false;
 		}
@@ -251,6 +291,40 @@ public:
 		return total;
 	}
 
+	/**
+	 * O(1) arithmetic mean computed from the running sum. Exact for the
+	 * sliding window: the paired add/remove in push() keeps the sum current
+	 * as old samples are evicted, so no re-scan is ever needed.
+	 *
+	 * @return The arithmetic mean of the contents of the buffer
+	 */
+	inline float runningMean()
+	{
+		const size_t curr_cnt = count();
+		return curr_cnt ? (float)(runSum / (double)curr_cnt) : 0;
+	}
+
+	/**
+	 * O(1) sample variance computed from the running sum and sum of squares
+	 * (clamped at zero against floating point cancellation)
+	 *
+	 * @return The variance of element values
+	 */
+	inline float runningVariance()
+	{
+		const size_t curr_cnt = count();
+		if (curr_cnt < 2) {
+			return 0;
+		}
+		const double ssd = runSumSq - ((runSum * runSum) / (double)curr_cnt);
+		return (ssd > 0) ? (float)(ssd / (double)(curr_cnt - 1)) : 0;
+	}
+
+	/**
+	 * @return The sample standard deviation of element values, O(1)
+	 */
+	inline float runningStddev() { return sqrt(runningVariance()); }
+
 	/**
 	 * @return The sample standard deviation of element values
 	 */
@@ -58,6 +58,13 @@ static ZT_INLINE void sha512_compress(sha512_state *const md,uint8_t *const buf)
 	uint64_t S[8], W[80], t0, t1;
 	int i;
 
+#ifdef ZT_SHA512_BMI2
+	if (Utils::CPUID.bmi2) {
+		sha512CompressBMI2(md->state,buf);
+		return;
+	}
+#endif
+
 	for (i = 0; i < 8; i++) {
 		S[i] = md->state[i];
 	}
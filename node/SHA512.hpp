@@ -60,6 +60,13 @@ static ZT_INLINE void SHA384(void *digest,const void *data0,unsigned int len0,co
 void SHA512(void *digest,const void *data,unsigned int len);
 void SHA384(void *digest,const void *data,unsigned int len);
 void SHA384(void *digest,const void *data0,unsigned int len0,const void *data1,unsigned int len1);
+
+// BMI1/BMI2 build of the compression function (RORX/ANDN), selected at
+// runtime via Utils::CPUID like the accelerated AES code.
+#if defined(ZT_ARCH_X64) && !defined(__WINDOWS__)
+#define ZT_SHA512_BMI2 1
+void sha512CompressBMI2(uint64_t state[8],const uint8_t buf[128]) noexcept;
+#endif
 #endif
 
 /**
@@ -125,6 +125,18 @@ void Salsa20::crypt12(const void *in,void *out,unsigned int bytes)
 		return;
 	}
 
+#ifdef ZT_SALSA20_AVX2
+	if ((bytes >= 128)&&(Utils::CPUID.avx2)) {
+		const unsigned int done = _cryptBlocksAVX2(m,c,bytes,6);
+		bytes -= done;
+		if (!bytes) {
+			return;
+		}
+		m += done;
+		c += done;
+	}
+#endif // ZT_SALSA20_AVX2
+
 #ifndef ZT_SALSA20_SSE
 	j0 = _state.i[0];
 	j1 = _state.i[1];
@@ -627,6 +639,18 @@ void Salsa20::crypt20(const void *in,void *out,unsigned int bytes)
 		return;
 	}
 
+#ifdef ZT_SALSA20_AVX2
+	if ((bytes >= 128)&&(Utils::CPUID.avx2)) {
+		const unsigned int done = _cryptBlocksAVX2(m,c,bytes,10);
+		bytes -= done;
+		if (!bytes) {
+			return;
+		}
+		m += done;
+		c += done;
+	}
+#endif // ZT_SALSA20_AVX2
+
 #ifndef ZT_SALSA20_SSE
 	j0 = _state.i[0];
 	j1 = _state.i[1];
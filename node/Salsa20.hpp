@@ -21,6 +21,13 @@
 
 #ifdef ZT_SALSA20_SSE
 #include <emmintrin.h>
+
+/* Multi-block AVX2 kernel, dispatched at runtime on Utils::CPUID.avx2.
+ * Disable on compilers too old to compile these intrinsics and on Windows
+ * where MinGW64 support is spotty (same guard as the VAES code in AES). */
+#if defined(ZT_ARCH_X64) && !defined(__WINDOWS__) && ((__GNUC__ >= 8) || (__clang_major__ >= 7))
+#define ZT_SALSA20_AVX2 1
+#endif
 #endif // ZT_SALSA20_SSE
 
 namespace ZeroTier {
@@ -146,6 +153,22 @@ public:
 	void crypt20(const void *in,void *out,unsigned int bytes);
 
 private:
+#ifdef ZT_SALSA20_AVX2
+	/**
+	 * Crypt as many whole pairs of 64-byte blocks as possible using AVX2
+	 *
+	 * Updates the block counter in _state and returns the number of bytes
+	 * processed (a multiple of 128); the caller crypts the remainder.
+	 *
+	 * @param m Input bytes
+	 * @param c Output buffer
+	 * @param bytes Length of data
+	 * @param doubleRounds Number of Salsa20 double rounds (6 for /12, 10 for /20)
+	 * @return Number of bytes processed
+	 */
+	unsigned int _cryptBlocksAVX2(const uint8_t *m,uint8_t *c,unsigned int bytes,unsigned int doubleRounds) noexcept;
+#endif // ZT_SALSA20_AVX2
+
 	union {
 #ifdef ZT_SALSA20_SSE
 		__m128i v[4];
@@ -0,0 +1,118 @@
+/*
+ * Based on public domain code available at: http://cr.yp.to/snuffle.html
+ *
+ * AVX2 multi-block kernel derived from the SSE implementation in
+ * Salsa20.cpp. Since the original was public domain, this is too.
+ */
+
+#include "Constants.hpp"
+#include "Salsa20.hpp"
+
+#ifdef ZT_SALSA20_AVX2
+
+#include <immintrin.h>
+
+namespace ZeroTier {
+
+#ifdef __GNUC__
+__attribute__((__target__("avx2")))
+#endif
+unsigned int Salsa20::_cryptBlocksAVX2(const uint8_t *m,uint8_t *c,unsigned int bytes,const unsigned int doubleRounds) noexcept
+{
+	// Two 64-byte blocks are processed per iteration, one per 128-bit lane.
+	// Every operation in the Salsa20 round function is lane-local, so this
+	// is the exact round sequence from the SSE code in Salsa20.cpp widened
+	// to 256 bits; only the block counter differs between the two lanes.
+	uint64_t ctr = (((uint64_t)_state.i[5]) << 32) | (uint64_t)_state.i[8];
+
+	// Rows 0 and 3 of the (SSE-reordered) state contain no counter words
+	// and are the same for every block.
+	const __m256i X0in = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)&(_state.v[0])));
+	const __m256i X3in = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)&(_state.v[3])));
+
+	const __m256i maskLo32 = _mm256_set1_epi64x((long long)0xffffffffULL);
+	const __m256i maskHi32 = _mm256_slli_epi64(maskLo32,32);
+
+	unsigned int done = 0;
+	while (bytes >= 128) {
+		const uint64_t ctr1 = ctr + 1;
+		const __m256i X1in = _mm256_set_epi32(
+			(int)_state.i[7],(int)_state.i[6],(int)(uint32_t)(ctr1 >> 32),(int)_state.i[4],
+			(int)_state.i[7],(int)_state.i[6],(int)(uint32_t)(ctr >> 32),(int)_state.i[4]);
+		const __m256i X2in = _mm256_set_epi32(
+			(int)_state.i[11],(int)_state.i[10],(int)_state.i[9],(int)(uint32_t)ctr1,
+			(int)_state.i[11],(int)_state.i[10],(int)_state.i[9],(int)(uint32_t)ctr);
+
+		__m256i X0 = X0in;
+		__m256i X1 = X1in;
+		__m256i X2 = X2in;
+		__m256i X3 = X3in;
+		__m256i T;
+
+		for(unsigned int r=0;r<doubleRounds;++r) {
+			// 2X round ---------------------------------------------------------
+			T = _mm256_add_epi32(X0, X3);
+			X1 = _mm256_xor_si256(_mm256_xor_si256(X1, _mm256_slli_epi32(T, 7)), _mm256_srli_epi32(T, 25));
+			T = _mm256_add_epi32(X1, X0);
+			X2 = _mm256_xor_si256(_mm256_xor_si256(X2, _mm256_slli_epi32(T, 9)), _mm256_srli_epi32(T, 23));
+			T = _mm256_add_epi32(X2, X1);
+			X3 = _mm256_xor_si256(_mm256_xor_si256(X3, _mm256_slli_epi32(T, 13)), _mm256_srli_epi32(T, 19));
+			T = _mm256_add_epi32(X3, X2);
+			X0 = _mm256_xor_si256(_mm256_xor_si256(X0, _mm256_slli_epi32(T, 18)), _mm256_srli_epi32(T, 14));
+			X1 = _mm256_shuffle_epi32(X1, 0x93);
+			X2 = _mm256_shuffle_epi32(X2, 0x4E);
+			X3 = _mm256_shuffle_epi32(X3, 0x39);
+			T = _mm256_add_epi32(X0, X1);
+			X3 = _mm256_xor_si256(_mm256_xor_si256(X3, _mm256_slli_epi32(T, 7)), _mm256_srli_epi32(T, 25));
+			T = _mm256_add_epi32(X3, X0);
+			X2 = _mm256_xor_si256(_mm256_xor_si256(X2, _mm256_slli_epi32(T, 9)), _mm256_srli_epi32(T, 23));
+			T = _mm256_add_epi32(X2, X3);
+			X1 = _mm256_xor_si256(_mm256_xor_si256(X1, _mm256_slli_epi32(T, 13)), _mm256_srli_epi32(T, 19));
+			T = _mm256_add_epi32(X1, X2);
+			X0 = _mm256_xor_si256(_mm256_xor_si256(X0, _mm256_slli_epi32(T, 18)), _mm256_srli_epi32(T, 14));
+			X1 = _mm256_shuffle_epi32(X1, 0x39);
+			X2 = _mm256_shuffle_epi32(X2, 0x4E);
+			X3 = _mm256_shuffle_epi32(X3, 0x93);
+		}
+
+		X0 = _mm256_add_epi32(X0in,X0);
+		X1 = _mm256_add_epi32(X1in,X1);
+		X2 = _mm256_add_epi32(X2in,X2);
+		X3 = _mm256_add_epi32(X3in,X3);
+
+		const __m256i k02 = _mm256_shuffle_epi32(_mm256_or_si256(_mm256_slli_epi64(X0, 32), _mm256_srli_epi64(X3, 32)), _MM_SHUFFLE(0, 1, 2, 3));
+		const __m256i k13 = _mm256_shuffle_epi32(_mm256_or_si256(_mm256_slli_epi64(X1, 32), _mm256_srli_epi64(X0, 32)), _MM_SHUFFLE(0, 1, 2, 3));
+		const __m256i k20 = _mm256_or_si256(_mm256_and_si256(X2, maskLo32), _mm256_and_si256(X1, maskHi32));
+		const __m256i k31 = _mm256_or_si256(_mm256_and_si256(X3, maskLo32), _mm256_and_si256(X2, maskHi32));
+		const __m256i w0 = _mm256_unpackhi_epi64(k02,k20);
+		const __m256i w1 = _mm256_unpackhi_epi64(k13,k31);
+		const __m256i w2 = _mm256_unpacklo_epi64(k20,k02);
+		const __m256i w3 = _mm256_unpacklo_epi64(k31,k13);
+
+		// Low lanes are block N (first 64 bytes), high lanes block N+1.
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(c),_mm_xor_si128(_mm256_castsi256_si128(w0),_mm_loadu_si128(reinterpret_cast<const __m128i *>(m))));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(c + 16),_mm_xor_si128(_mm256_castsi256_si128(w1),_mm_loadu_si128(reinterpret_cast<const __m128i *>(m + 16))));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(c + 32),_mm_xor_si128(_mm256_castsi256_si128(w2),_mm_loadu_si128(reinterpret_cast<const __m128i *>(m + 32))));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(c + 48),_mm_xor_si128(_mm256_castsi256_si128(w3),_mm_loadu_si128(reinterpret_cast<const __m128i *>(m + 48))));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(c + 64),_mm_xor_si128(_mm256_extracti128_si256(w0,1),_mm_loadu_si128(reinterpret_cast<const __m128i *>(m + 64))));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(c + 80),_mm_xor_si128(_mm256_extracti128_si256(w1,1),_mm_loadu_si128(reinterpret_cast<const __m128i *>(m + 80))));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(c + 96),_mm_xor_si128(_mm256_extracti128_si256(w2,1),_mm_loadu_si128(reinterpret_cast<const __m128i *>(m + 96))));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(c + 112),_mm_xor_si128(_mm256_extracti128_si256(w3,1),_mm_loadu_si128(reinterpret_cast<const __m128i *>(m + 112))));
+
+		ctr += 2;
+		m += 128;
+		c += 128;
+		bytes -= 128;
+		done += 128;
+	}
+
+	_state.i[8] = (uint32_t)ctr;
+	_state.i[5] = (uint32_t)(ctr >> 32); // state reordered for SSE
+	/* stopping at 2^70 bytes per nonce is user's responsibility */
+
+	return done;
+}
+
+} // namespace ZeroTier
+
+#endif // ZT_SALSA20_AVX2
@@ -53,7 +53,8 @@ private:
 
 SelfAwareness::SelfAwareness(const RuntimeEnvironment *renv) :
 	RR(renv),
-	_phy(128)
+	_phy(ZT_SELFAWARENESS_PHY_INITIAL_CAPACITY),
+	_surfacesDirty(false)
 {
 }
 
@@ -67,6 +68,9 @@ void SelfAwareness::iam(void *tPtr,const Address &reporter,const int64_t receive
 
 	Mutex::Lock _l(_phy_m);
 	PhySurfaceEntry &entry = _phy[PhySurfaceKey(reporter,receivedOnLocalSocket,reporterPhysicalAddress,scope)];
+	if (entry.mySurface != myPhysicalAddress) {
+		_surfacesDirty = true; // new entry or surface changed; whoami() must recompute
+	}
 
 	if ( (trusted) && ((now - entry.ts) < ZT_SELFAWARENESS_ENTRY_TIMEOUT) && (!entry.mySurface.ipsEqual(myPhysicalAddress)) ) {
 		// Changes to external surface reported by trusted peers causes path reset in this scope
@@ -80,12 +84,14 @@ void SelfAwareness::iam(void *tPtr,const Address &reporter,const int64_t receive
 		// due to multiple reports of endpoint change.
 		// Don't use 'entry' after this since hash table gets modified.
 		{
+			const InetAddress::Key reporterPhysicalAddressKey(reporterPhysicalAddress);
 			Hashtable< PhySurfaceKey,PhySurfaceEntry >::Iterator i(_phy);
 			PhySurfaceKey *k = (PhySurfaceKey *)0;
 			PhySurfaceEntry *e = (PhySurfaceEntry *)0;
 			while (i.next(k,e)) {
-				if ((k->reporterPhysicalAddress != reporterPhysicalAddress)&&(k->scope == scope)) {
+				if ((k->reporterPhysicalAddress != reporterPhysicalAddressKey)&&(k->scope == scope)) {
 					_phy.erase(*k);
+					_surfacesDirty = true;
 				}
 			}
 		}
@@ -103,17 +109,20 @@ void SelfAwareness::iam(void *tPtr,const Address &reporter,const int64_t receive
 
 std::vector<InetAddress> SelfAwareness::whoami()
 {
-	std::vector<InetAddress> surfaceAddresses;
 	Mutex::Lock _l(_phy_m);
-	Hashtable< PhySurfaceKey,PhySurfaceEntry >::Iterator i(_phy);
-	PhySurfaceKey *k = (PhySurfaceKey *)0;
-	PhySurfaceEntry *e = (PhySurfaceEntry *)0;
-	while (i.next(k,e)) {
-		if (std::find(surfaceAddresses.begin(), surfaceAddresses.end(), e->mySurface) == surfaceAddresses.end()) {
-			surfaceAddresses.push_back(e->mySurface);
+	if (_surfacesDirty) {
+		_surfaces.clear();
+		Hashtable< PhySurfaceKey,PhySurfaceEntry >::Iterator i(_phy);
+		PhySurfaceKey *k = (PhySurfaceKey *)0;
+		PhySurfaceEntry *e = (PhySurfaceEntry *)0;
+		while (i.next(k,e)) {
+			if (std::find(_surfaces.begin(), _surfaces.end(), e->mySurface) == _surfaces.end()) {
+				_surfaces.push_back(e->mySurface);
+			}
 		}
+		_surfacesDirty = false;
 	}
-	return surfaceAddresses;
+	return _surfaces;
 }
 
 void SelfAwareness::clean(int64_t now)
@@ -125,6 +134,7 @@ void SelfAwareness::clean(int64_t now)
 	while (i.next(k,e)) {
 		if ((now - e->ts) >= ZT_SELFAWARENESS_ENTRY_TIMEOUT) {
 			_phy.erase(*k);
+			_surfacesDirty = true;
 		}
 	}
 }
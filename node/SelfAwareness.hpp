@@ -14,6 +14,8 @@
 #ifndef ZT_SELFAWARENESS_HPP
 #define ZT_SELFAWARENESS_HPP
 
+#include <vector>
+
 #include "Constants.hpp"
 #include "InetAddress.hpp"
 #include "Hashtable.hpp"
@@ -63,13 +65,13 @@ private:
 	{
 		Address reporter;
 		int64_t receivedOnLocalSocket;
-		InetAddress reporterPhysicalAddress;
+		InetAddress::Key reporterPhysicalAddress; // compact key form; full sockaddr is never needed here
 		InetAddress::IpScope scope;
 
 		PhySurfaceKey() : reporter(),scope(InetAddress::IP_SCOPE_NONE) {}
 		PhySurfaceKey(const Address &r,const int64_t rol,const InetAddress &ra,InetAddress::IpScope s) : reporter(r),receivedOnLocalSocket(rol),reporterPhysicalAddress(ra),scope(s) {}
 
-		inline unsigned long hashCode() const { return ((unsigned long)reporter.toInt() + (unsigned long)scope); }
+		inline unsigned long hashCode() const { return ((unsigned long)reporter.toInt() + reporterPhysicalAddress.hashCode() + (unsigned long)scope); }
 		inline bool operator==(const PhySurfaceKey &k) const { return ((reporter == k.reporter)&&(receivedOnLocalSocket == k.receivedOnLocalSocket)&&(reporterPhysicalAddress == k.reporterPhysicalAddress)&&(scope == k.scope)); }
 	};
 	struct PhySurfaceEntry
@@ -85,6 +87,8 @@ private:
 	const RuntimeEnvironment *RR;
 
 	Hashtable< PhySurfaceKey,PhySurfaceEntry > _phy;
+	std::vector<InetAddress> _surfaces; // memoized whoami() result, rebuilt when _phy changes
+	bool _surfacesDirty;
 	Mutex _phy_m;
 };
 
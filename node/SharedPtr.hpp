@@ -33,6 +33,7 @@ public:
 	SharedPtr() : _ptr((T *)0) {}
 	SharedPtr(T *obj) : _ptr(obj) { ++obj->__refCount; }
 	SharedPtr(const SharedPtr &sp) : _ptr(sp._getAndInc()) {}
+	SharedPtr(SharedPtr &&sp) noexcept : _ptr(sp._ptr) { sp._ptr = (T *)0; }
 
 	~SharedPtr()
 	{
@@ -57,6 +58,24 @@ public:
 		return *this;
 	}
 
+	// Moving steals the reference, so assigning from a temporary (e.g. the
+	// return value of a lookup) costs no atomic operations at all.
+	inline SharedPtr &operator=(SharedPtr &&sp) noexcept
+	{
+		if (_ptr != sp._ptr) {
+			if (_ptr) {
+				if (--_ptr->__refCount <= 0) {
+					delete _ptr;
+				}
+			}
+			_ptr = sp._ptr;
+			sp._ptr = (T *)0;
+		} else {
+			sp.zero();
+		}
+		return *this;
+	}
+
 	/**
 	 * Set to a naked pointer and increment its reference count
 	 *
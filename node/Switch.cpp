@@ -14,6 +14,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifdef __LINUX__
+#include <sched.h>
+#include <pthread.h>
+#endif
+#ifdef __FreeBSD__
+#include <pthread.h>
+#include <pthread_np.h>
+#endif
+
 #include <algorithm>
 #include <utility>
 #include <stdexcept>
@@ -33,14 +42,167 @@
 #include "Trace.hpp"
 #include "Metrics.hpp"
 
+// Don't bother compressing unicast frames below this size; the LZ4 overhead
+// outweighs any savings and small frames are usually latency sensitive.
+#define ZT_UNICAST_COMPRESSION_MIN_FRAME_SIZE 512
+
 namespace ZeroTier {
 
 Switch::Switch(const RuntimeEnvironment *renv) :
 	RR(renv),
 	_lastBeaconResponse(0),
 	_lastCheckedQueues(0),
-	_lastUniteAttempt(8) // only really used on root servers and upstreams, and it'll grow there just fine
+	_rxWorkersRun(false),
+	_txQueueSize(0),
+	_uniteGate((_UniteGateEntry *)0),
+	_frameBundleCount(0)
+{
+	memset(_smallFrameSeen,0,sizeof(_smallFrameSeen));
+	_rxQueue = new RXQueueEntry[ZT_RX_QUEUE_SIZE];
+	_rxQueueSize = ZT_RX_QUEUE_SIZE;
+}
+
+Switch::~Switch()
 {
+	_stopRxWorkers();
+	delete [] _rxQueue;
+	delete [] _uniteGate;
+}
+
+void Switch::setRxQueueMemoryBudget(uint64_t bytes)
+{
+	unsigned int entries = ZT_RX_QUEUE_SIZE;
+	if (bytes > 0) {
+		const uint64_t n = bytes / (uint64_t)sizeof(RXQueueEntry);
+		if (n > (uint64_t)entries) {
+			entries = (unsigned int)std::min(n,(uint64_t)16384); // sanity cap; entries are large
+		}
+	}
+	if (entries == _rxQueueSize) {
+		return;
+	}
+	delete [] _rxQueue;
+	_rxQueue = new RXQueueEntry[entries];
+	_rxQueueSize = entries;
+}
+
+void Switch::setRxWorkerThreads(unsigned int threadCount,const unsigned int *pinCpus,unsigned int pinCpuCount)
+{
+	_stopRxWorkers();
+	if (threadCount == 0) {
+		return;
+	}
+	_rxWorkersRun.store(true,std::memory_order_release);
+	for(unsigned int t=0;t<threadCount;++t) {
+		RXWorker *const w = new RXWorker();
+		w->pinCpu = ((pinCpus)&&(pinCpuCount > 0)) ? (int)pinCpus[t % pinCpuCount] : -1;
+		_rxWorkers.push_back(w);
+	}
+	// Threads are started only after the worker set is final since
+	// onRemotePacket() indexes it without a lock.
+	for(std::vector<RXWorker *>::iterator w(_rxWorkers.begin());w!=_rxWorkers.end();++w) {
+		(*w)->thread = std::thread(&Switch::_rxWorkerLoop,this,*w);
+	}
+}
+
+void Switch::_stopRxWorkers()
+{
+	if (_rxWorkers.empty()) {
+		return;
+	}
+	_rxWorkersRun.store(false,std::memory_order_release);
+	for(std::vector<RXWorker *>::iterator w(_rxWorkers.begin());w!=_rxWorkers.end();++w) {
+		{
+			std::lock_guard<std::mutex> l((*w)->lock);
+			(*w)->cond.notify_all();
+		}
+		(*w)->thread.join();
+		for(std::list<RXWorkItem>::iterator i((*w)->q.begin());i!=(*w)->q.end();++i) {
+			if (i->extData)
+				i->extFree(i->extFreeArg,i->extData); // return lended buffers that were never processed
+		}
+		delete *w;
+	}
+	_rxWorkers.clear();
+}
+
+void Switch::_rxWorkerLoop(RXWorker *w)
+{
+#if defined(__LINUX__) || defined(__FreeBSD__)
+	if (w->pinCpu >= 0) {
+		// Pin before touching any work so this worker's first-touch
+		// allocations land on its own socket.
+#ifdef __LINUX__
+		cpu_set_t cs;
+#else
+		cpuset_t cs;
+#endif
+		CPU_ZERO(&cs);
+		CPU_SET((unsigned int)w->pinCpu,&cs);
+		pthread_setaffinity_np(pthread_self(),sizeof(cs),&cs);
+	}
+#endif
+
+	// Pre-populate part of this worker's recycle pool from its own (now
+	// pinned) thread. With first-touch allocation the item buffers land on
+	// this worker's NUMA node, so on multi-socket hosts the steady-state
+	// packet pool is node-local instead of living wherever the I/O thread
+	// that first warmed it happened to run. Only a fraction of the cap is
+	// pre-faulted; the rest of the pool still warms up on demand under
+	// sustained bursts.
+	{
+		std::list<RXWorkItem> warm;
+		for(unsigned int i=0;i<(ZT_RX_WORKER_MAX_QUEUE_SIZE / 4);++i) {
+			warm.push_back(RXWorkItem());
+			memset(warm.back().data,0,sizeof(warm.back().data)); // fault every page now
+		}
+		std::lock_guard<std::mutex> l(w->lock);
+		w->pool.splice(w->pool.end(),warm);
+	}
+
+	std::list<RXWorkItem> cur;
+	for(;;) {
+		{
+			std::unique_lock<std::mutex> l(w->lock);
+			while ((w->q.empty())&&(_rxWorkersRun.load(std::memory_order_acquire))) {
+				w->cond.wait(l);
+			}
+			if (!_rxWorkersRun.load(std::memory_order_acquire)) {
+				return;
+			}
+			cur.splice(cur.end(),w->q,w->q.begin()); // move one item out without copying it
+		}
+		RXWorkItem &item = cur.front();
+		_doOnRemotePacket(item.tPtr,item.localSocket,item.fromAddr,(item.extData) ? item.extData : (const void *)item.data,item.len);
+		if (item.extData) {
+			item.extFree(item.extFreeArg,item.extData);
+			item.extData = (void *)0;
+		}
+		{
+			std::lock_guard<std::mutex> l(w->lock);
+			if (w->pool.size() < ZT_RX_WORKER_MAX_QUEUE_SIZE) {
+				w->pool.splice(w->pool.end(),cur,cur.begin()); // recycle the node for a future packet
+			}
+		}
+		cur.clear(); // frees the node only if the pool was already full
+	}
+}
+
+bool Switch::_ingressPolicerGate(const int64_t now,const InetAddress &fromAddr)
+{
+	_IngressPolicerBucket &b = _ingressPolicer[fromAddr.rateGateHash()];
+	const int64_t since = now - b.lastRefill;
+	if (since > 0) {
+		b.lastRefill = now;
+		const int64_t replenished = (int64_t)b.tokens + (since * (ZT_INGRESS_POLICER_RATE / 1000));
+		b.tokens = (replenished > (int64_t)ZT_INGRESS_POLICER_BURST) ? (int32_t)ZT_INGRESS_POLICER_BURST : (int32_t)replenished;
+	}
+	if (b.tokens <= 0) {
+		Metrics::rx_policer_dropped++;
+		return false;
+	}
+	--b.tokens;
+	return true;
 }
 
 // Returns true if packet appears valid; pos and proto will be set
@@ -74,14 +236,180 @@ static bool _ipv6GetPayload(const uint8_t *frameData,unsigned int frameLen,unsig
 	return false; // overflow == invalid
 }
 
+// Shard by source peer so per-peer ordering is preserved. Fragments
+// carry no source address, so they shard by packet ID instead; the
+// RX queue entry lock serializes reassembly across workers.
+static inline unsigned long _rxWorkerShard(const uint8_t *const d)
+{
+	if (d[ZT_PACKET_FRAGMENT_IDX_FRAGMENT_INDICATOR] == ZT_PACKET_FRAGMENT_INDICATOR) {
+		return (unsigned long)d[ZT_PACKET_FRAGMENT_IDX_PACKET_ID + 7];
+	}
+	return (unsigned long)(d[ZT_PACKET_IDX_SOURCE] ^ d[ZT_PACKET_IDX_SOURCE + 1] ^ d[ZT_PACKET_IDX_SOURCE + 2] ^ d[ZT_PACKET_IDX_SOURCE + 3] ^ d[ZT_PACKET_IDX_SOURCE + 4]);
+}
+
 void Switch::onRemotePacket(void *tPtr,const int64_t localSocket,const InetAddress &fromAddr,const void *data,unsigned int len)
 {
+	if (!_ingressPolicerGate(RR->node->now(),fromAddr)) {
+		return; // source is over its ingress rate budget; shed before any crypto
+	}
+
+	if ((!_rxWorkers.empty())&&(len > ZT_PROTO_MIN_FRAGMENT_LENGTH)) {
+		if (len > ZT_PROTO_MAX_PACKET_LENGTH) {
+			return; // would not fit in a Packet buffer anyway
+		}
+		const uint8_t *const d = reinterpret_cast<const uint8_t *>(data);
+		RXWorker &w = *(_rxWorkers[_rxWorkerShard(d) % _rxWorkers.size()]);
+		{
+			std::lock_guard<std::mutex> l(w.lock);
+			if (w.q.size() >= ZT_RX_WORKER_MAX_QUEUE_SIZE) {
+				return; // overloaded: drop, as the wire would
+			}
+			if (w.pool.empty()) {
+				w.q.push_back(RXWorkItem()); // pool warms up over the first bursts, then this never runs
+			} else {
+				w.q.splice(w.q.end(),w.pool,w.pool.begin()); // reuse a node without allocating
+			}
+			RXWorkItem &item = w.q.back();
+			item.tPtr = tPtr;
+			item.localSocket = localSocket;
+			item.fromAddr = fromAddr;
+			item.len = len;
+			memcpy(item.data,data,len);
+		}
+		w.cond.notify_one();
+		return;
+	}
+
+	// Beacons and runts are cheap and are handled inline even in worker mode
+	_doOnRemotePacket(tPtr,localSocket,fromAddr,data,len);
+}
+
+void Switch::onRemotePacketLended(void *tPtr,const int64_t localSocket,const InetAddress &fromAddr,void *data,unsigned int len,ZT_BufferFreeFunction freeFunction,void *freeFunctionArg)
+{
+	if (!freeFunction) {
+		onRemotePacket(tPtr,localSocket,fromAddr,data,len);
+		return;
+	}
+
+	if (!_ingressPolicerGate(RR->node->now(),fromAddr)) {
+		freeFunction(freeFunctionArg,data); // source is over its ingress rate budget; shed before any crypto
+		return;
+	}
+
+	if ((!_rxWorkers.empty())&&(len > ZT_PROTO_MIN_FRAGMENT_LENGTH)&&(len <= ZT_PROTO_MAX_PACKET_LENGTH)) {
+		RXWorker &w = *(_rxWorkers[_rxWorkerShard(reinterpret_cast<const uint8_t *>(data)) % _rxWorkers.size()]);
+		{
+			std::lock_guard<std::mutex> l(w.lock);
+			if (w.q.size() < ZT_RX_WORKER_MAX_QUEUE_SIZE) {
+				if (w.pool.empty()) {
+					w.q.push_back(RXWorkItem()); // pool warms up over the first bursts, then this never runs
+				} else {
+					w.q.splice(w.q.end(),w.pool,w.pool.begin()); // reuse a node without allocating
+				}
+				RXWorkItem &item = w.q.back();
+				item.tPtr = tPtr;
+				item.localSocket = localSocket;
+				item.fromAddr = fromAddr;
+				item.len = len;
+				item.extData = data; // borrowed, not copied; the worker returns it after processing
+				item.extFree = freeFunction;
+				item.extFreeArg = freeFunctionArg;
+				w.cond.notify_one();
+				return;
+			}
+		}
+		freeFunction(freeFunctionArg,data); // overloaded: drop, as the wire would
+		return;
+	}
+
+	_doOnRemotePacket(tPtr,localSocket,fromAddr,data,len);
+	freeFunction(freeFunctionArg,data);
+}
+
+Switch::RXQueueEntry *Switch::_findRXQueueEntry(const int64_t now,const uint64_t packetId)
+{
+	RXQueueEntry *victim = (RXQueueEntry *)0;
+	int victimClass = 0;
+	for(unsigned int k=0;k<_rxQueueSize;++k) {
+		RXQueueEntry *const rq = &(_rxQueue[k]);
+		if ((rq->packetId == packetId)&&(rq->timestamp)) {
+			return rq;
+		}
+
+		// Rank candidates for reuse: free beats expired beats complete (these are
+		// just waiting on a WHOIS) beats live reassembly, oldest first within a
+		// rank, so a burst of new packets never evicts an in-progress reassembly
+		// while a less valuable slot is available.
+		int c;
+		if (!rq->timestamp) {
+			c = 4;
+		} else if ((now - rq->timestamp) > ZT_RECEIVE_QUEUE_TIMEOUT) {
+			c = 3;
+		} else if (rq->complete) {
+			c = 2;
+		} else {
+			c = 1;
+		}
+		if ((c > victimClass)||((c == victimClass)&&(rq->timestamp < victim->timestamp))) {
+			victim = rq;
+			victimClass = c;
+		}
+	}
+	return victim;
+}
+
+Switch::RXQueueEntry *Switch::_nextRXQueueEntry(const int64_t now)
+{
+	return _findRXQueueEntry(now,0); // zero matches no real packet ID so this just selects a victim
+}
+
+bool Switch::_rxReassemblyCharge(const Address &src,const unsigned int bytes)
+{
+	Mutex::Lock _l(_rxReassemblyBytes_m);
+	unsigned int &b = _rxReassemblyBytes[src];
+	if ((b + bytes) > ZT_RX_MAX_REASSEMBLY_BYTES_PER_PEER) {
+		if (!b) {
+			_rxReassemblyBytes.erase(src);
+		}
+		return false;
+	}
+	b += bytes;
+	return true;
+}
+
+void Switch::_rxReassemblyRefund(const Address &src,const unsigned int bytes)
+{
+	Mutex::Lock _l(_rxReassemblyBytes_m);
+	unsigned int *const b = _rxReassemblyBytes.get(src);
+	if (b) {
+		if (*b > bytes) {
+			*b -= bytes;
+		} else {
+			_rxReassemblyBytes.erase(src);
+		}
+	}
+}
+
+void Switch::_releaseRXQueueEntry(RXQueueEntry *const rq)
+{
+	if (rq->source) {
+		_rxReassemblyRefund(rq->source,rq->bytesBuffered);
+		rq->source.zero();
+	}
+	rq->bytesBuffered = 0;
+	rq->timestamp = 0;
+}
+
+void Switch::_doOnRemotePacket(void *tPtr,const int64_t localSocket,const InetAddress &fromAddr,const void *data,unsigned int len)
+{
+	Metrics::SampledTimer _st(Metrics::rx_packet_us);
 	int32_t flowId = ZT_QOS_NO_FLOW;
 	try {
 		const int64_t now = RR->node->now();
+		_flushExpiredFrameBundles(tPtr,now);
 
 		const SharedPtr<Path> path(RR->topology->getPath(localSocket,fromAddr));
-		path->received(now);
+		path->received(now,len);
 
 		if (len == 13) {
 			/* LEGACY: before VERB_PUSH_DIRECT_PATHS, peers used broadcast
@@ -145,11 +473,14 @@ void Switch::onRemotePacket(void *tPtr,const int64_t localSocket,const InetAddre
 						// Total fragments must be more than 1, otherwise why are we
 						// seeing a Packet::Fragment?
 
-						RXQueueEntry *const rq = _findRXQueueEntry(fragmentPacketId);
+						RXQueueEntry *const rq = _findRXQueueEntry(now,fragmentPacketId);
 						Mutex::Lock rql(rq->lock);
 						if (rq->packetId != fragmentPacketId) {
 							// No packet found, so we received a fragment without its head.
 
+							if ((rq->timestamp)&&((now - rq->timestamp) <= ZT_RECEIVE_QUEUE_TIMEOUT))
+								Metrics::rx_queue_evicted++; // a live entry is being reused
+							_releaseRXQueueEntry(rq); // refund whatever was here before
 							rq->flowId = flowId;
 							rq->timestamp = now;
 							rq->packetId = fragmentPacketId;
@@ -157,9 +488,16 @@ void Switch::onRemotePacket(void *tPtr,const int64_t localSocket,const InetAddre
 							rq->totalFragments = totalFragments; // total fragment count is known
 							rq->haveFragments = 1 << fragmentNumber; // we have only this fragment
 							rq->complete = false;
+							rq->bytesBuffered = len; // charged to the source's budget when the head arrives
 						} else if (!(rq->haveFragments & (1 << fragmentNumber))) {
 							// We have other fragments and maybe the head, so add this one and check
 
+							if ((rq->source)&&(!_rxReassemblyCharge(rq->source,len))) {
+								Metrics::rx_reassembly_over_budget++;
+								_releaseRXQueueEntry(rq); // source is over its reassembly budget
+								return;
+							}
+							rq->bytesBuffered += len;
 							rq->frags[fragmentNumber - 1] = fragment;
 							rq->totalFragments = totalFragments;
 
@@ -171,7 +509,7 @@ void Switch::onRemotePacket(void *tPtr,const int64_t localSocket,const InetAddre
 								}
 
 								if (rq->frag0.tryDecode(RR,tPtr,flowId)) {
-									rq->timestamp = 0; // packet decoded, free entry
+									_releaseRXQueueEntry(rq); // packet decoded, free entry
 								} else {
 									rq->complete = true; // set complete flag but leave entry since it probably needs WHOIS or something
 								}
@@ -234,11 +572,18 @@ void Switch::onRemotePacket(void *tPtr,const int64_t localSocket,const InetAddre
 						((uint64_t)reinterpret_cast<const uint8_t *>(data)[7])
 					);
 
-					RXQueueEntry *const rq = _findRXQueueEntry(packetId);
+					RXQueueEntry *const rq = _findRXQueueEntry(now,packetId);
 					Mutex::Lock rql(rq->lock);
 					if (rq->packetId != packetId) {
 						// If we have no other fragments yet, create an entry and save the head
 
+						if (!_rxReassemblyCharge(source,len)) {
+							Metrics::rx_reassembly_over_budget++;
+							return; // over budget: drop the new head, keep whatever the entry holds
+						}
+						if ((rq->timestamp)&&((now - rq->timestamp) <= ZT_RECEIVE_QUEUE_TIMEOUT))
+							Metrics::rx_queue_evicted++; // a live entry is being reused
+						_releaseRXQueueEntry(rq); // refund whatever was here before
 						rq->flowId = flowId;
 						rq->timestamp = now;
 						rq->packetId = packetId;
@@ -246,8 +591,20 @@ void Switch::onRemotePacket(void *tPtr,const int64_t localSocket,const InetAddre
 						rq->totalFragments = 0;
 						rq->haveFragments = 1;
 						rq->complete = false;
+						rq->source = source;
+						rq->bytesBuffered = len;
 					} else if (!(rq->haveFragments & 1)) {
-						// If we have other fragments but no head, see if we are complete with the head
+						// If we have other fragments but no head, charge everything buffered so
+						// far (fragments arriving before the head could not name their source)
+						// and see if we are complete with the head
+
+						if (!_rxReassemblyCharge(source,rq->bytesBuffered + len)) {
+							Metrics::rx_reassembly_over_budget++;
+							_releaseRXQueueEntry(rq); // source is over its reassembly budget
+							return;
+						}
+						rq->source = source;
+						rq->bytesBuffered += len;
 
 						if ((rq->totalFragments > 1)&&(Utils::countBits(rq->haveFragments |= 1) == rq->totalFragments)) {
 							// We have all fragments -- assemble and process full Packet
@@ -258,7 +615,7 @@ void Switch::onRemotePacket(void *tPtr,const int64_t localSocket,const InetAddre
 							}
 
 							if (rq->frag0.tryDecode(RR,tPtr,flowId)) {
-								rq->timestamp = 0; // packet decoded, free entry
+								_releaseRXQueueEntry(rq); // packet decoded, free entry
 							} else {
 								rq->complete = true; // set complete flag but leave entry since it probably needs WHOIS or something
 							}
@@ -271,8 +628,15 @@ void Switch::onRemotePacket(void *tPtr,const int64_t localSocket,const InetAddre
 					// Packet is unfragmented, so just process it
 					IncomingPacket packet(data,len,path,now);
 					if (!packet.tryDecode(RR,tPtr,flowId)) {
-						RXQueueEntry *const rq = _nextRXQueueEntry();
+						if (!_rxReassemblyCharge(source,len)) {
+							Metrics::rx_reassembly_over_budget++;
+							return; // over budget: drop rather than queue for WHOIS
+						}
+						RXQueueEntry *const rq = _nextRXQueueEntry(now);
 						Mutex::Lock rql(rq->lock);
+						if ((rq->timestamp)&&((now - rq->timestamp) <= ZT_RECEIVE_QUEUE_TIMEOUT))
+							Metrics::rx_queue_evicted++; // a live entry is being reused
+						_releaseRXQueueEntry(rq); // refund whatever was here before
 						rq->flowId = flowId;
 						rq->timestamp = now;
 						rq->packetId = packet.packetId();
@@ -280,6 +644,8 @@ void Switch::onRemotePacket(void *tPtr,const int64_t localSocket,const InetAddre
 						rq->totalFragments = 1;
 						rq->haveFragments = 1;
 						rq->complete = true;
+						rq->source = source;
+						rq->bytesBuffered = len;
 					}
 				}
 
@@ -291,6 +657,8 @@ void Switch::onRemotePacket(void *tPtr,const int64_t localSocket,const InetAddre
 
 void Switch::onLocalEthernet(void *tPtr,const SharedPtr<Network> &network,const MAC &from,const MAC &to,unsigned int etherType,unsigned int vlanId,const void *data,unsigned int len)
 {
+	_flushExpiredFrameBundles(tPtr,RR->node->now());
+
 	if (!network->hasConfig()) {
 		return;
 	}
@@ -306,6 +674,21 @@ void Switch::onLocalEthernet(void *tPtr,const SharedPtr<Network> &network,const
 
 	uint8_t qosBucket = ZT_AQM_DEFAULT_BUCKET;
 
+	// Classify the inner frame's DSCP through this network's policy map and
+	// leave it for the wire send callback, which marks the outer UDP packets
+	// this frame becomes so provider QoS can see prioritized inner traffic.
+	// Non-IP frames reset the thread's marking to the default.
+	{
+		unsigned int innerDscp = 0;
+		const uint8_t *const fd = (const uint8_t *)data;
+		if ((etherType == ZT_ETHERTYPE_IPV4)&&(len >= 20)) {
+			innerDscp = ((unsigned int)fd[1] >> 2);
+		} else if ((etherType == ZT_ETHERTYPE_IPV6)&&(len >= 40)) {
+			innerDscp = ((((unsigned int)(fd[0] & 0x0f) << 4) | ((unsigned int)fd[1] >> 4)) >> 2);
+		}
+		Node::setTxWireDscp(network->config().dscpMap[innerDscp & 0x3f]);
+	}
+
 	/**
 	 * A pseudo-unique identifier used by balancing and bonding policies to
 	 * categorize individual flows/conversations for assignment to a specific
@@ -561,14 +944,24 @@ void Switch::onLocalEthernet(void *tPtr,const SharedPtr<Network> &network,const
 
 		network->pushCredentialsIfNeeded(tPtr,toZT,RR->node->now());
 
+		if ((len <= ZT_FRAME_BUNDLE_MAX_FRAME_SIZE)&&(toPeer)&&(toPeer->remoteSupportsFrameBundles())) {
+			// Bursts of small frames to the same peer coalesce into a single
+			// VERB_FRAME_BUNDLE, paying armor and send overhead once. Support
+			// is negotiated via HELLO, so old peers never see the new verb.
+			if (_bundleSmallFrame(tPtr,network,toZT,to,from,etherType,data,len,qosBucket,flowId,RR->node->now())) {
+				return;
+			}
+		}
+
 		if (!fromBridged) {
 			Packet outp(toZT,RR->identity.address(),Packet::VERB_FRAME);
 			outp.append(network->id());
 			outp.append((uint16_t)etherType);
 			outp.append(data,len);
-			// 1.4.8: disable compression for unicast as it almost never helps
-			//if (!network->config().disableCompression())
-			//	outp.compress();
+			// 1.4.8: disabled by default for unicast as it almost never helps, but
+			// networks can opt back in for compressible bulk traffic over slow links
+			if ((network->config().enableUnicastCompression())&&(len >= ZT_UNICAST_COMPRESSION_MIN_FRAME_SIZE))
+				outp.compress();
 			aqm_enqueue(tPtr,network,outp,true,qosBucket,flowId);
 		} else {
 			Packet outp(toZT,RR->identity.address(),Packet::VERB_EXT_FRAME);
@@ -578,9 +971,10 @@ void Switch::onLocalEthernet(void *tPtr,const SharedPtr<Network> &network,const
 			from.appendTo(outp);
 			outp.append((uint16_t)etherType);
 			outp.append(data,len);
-			// 1.4.8: disable compression for unicast as it almost never helps
-			//if (!network->config().disableCompression())
-			//	outp.compress();
+			// 1.4.8: disabled by default for unicast as it almost never helps, but
+			// networks can opt back in for compressible bulk traffic over slow links
+			if ((network->config().enableUnicastCompression())&&(len >= ZT_UNICAST_COMPRESSION_MIN_FRAME_SIZE))
+				outp.compress();
 			aqm_enqueue(tPtr,network,outp,true,qosBucket,flowId);
 		}
 	} else {
@@ -638,9 +1032,10 @@ void Switch::onLocalEthernet(void *tPtr,const SharedPtr<Network> &network,const
 				from.appendTo(outp);
 				outp.append((uint16_t)etherType);
 				outp.append(data,len);
-				// 1.4.8: disable compression for unicast as it almost never helps
-				//if (!network->config().disableCompression())
-				//	outp.compress();
+				// 1.4.8: disabled by default for unicast as it almost never helps, but
+				// networks can opt back in for compressible bulk traffic over slow links
+				if ((network->config().enableUnicastCompression())&&(len >= ZT_UNICAST_COMPRESSION_MIN_FRAME_SIZE))
+					outp.compress();
 				aqm_enqueue(tPtr,network,outp,true,qosBucket,flowId);
 			} else {
 				RR->t->outgoingNetworkFrameDropped(tPtr,network,from,to,etherType,vlanId,len,"filter blocked (bridge replication)");
@@ -655,6 +1050,14 @@ void Switch::aqm_enqueue(void *tPtr, const SharedPtr<Network> &network, Packet &
 		send(tPtr, packet, encrypt, flowId);
 		return;
 	}
+	// Don't apply QoS scheduling to ZT protocol traffic
+	if (packet.verb() != Packet::VERB_FRAME && packet.verb() != Packet::VERB_EXT_FRAME) {
+		send(tPtr, packet, encrypt, flowId);
+		return;
+	}
+
+	_aqm_m.lock();
+
 	NetworkQoSControlBlock *nqcb = _netQueueControlBlock[network->id()];
 	if (!nqcb) {
 		nqcb = new NetworkQoSControlBlock();
@@ -665,12 +1068,6 @@ void Switch::aqm_enqueue(void *tPtr, const SharedPtr<Network> &network, Packet &
 			nqcb->inactiveQueues.push_back(new ManagedQueue(i));
 		}
 	}
-	// Don't apply QoS scheduling to ZT protocol traffic
-	if (packet.verb() != Packet::VERB_FRAME && packet.verb() != Packet::VERB_EXT_FRAME) {
-		send(tPtr, packet, encrypt, flowId);
-	}
-
-	_aqm_m.lock();
 
 	// Enqueue packet and move queue to appropriate list
 
@@ -701,6 +1098,7 @@ void Switch::aqm_enqueue(void *tPtr, const SharedPtr<Network> &network, Packet &
 		}
 	}
 	if (!selectedQueue) {
+		delete txEntry;
 		_aqm_m.unlock();
 		return;
 	}
@@ -758,7 +1156,7 @@ Switch::dqr Switch::dodequeue(ManagedQueue *q, uint64_t now)
 {
 	dqr r;
 	r.ok_to_drop = false;
-	r.p = q->q.front();
+	r.p = (q->q.empty()) ? (TXQueueEntry *)NULL : q->q.front();
 
 	if (r.p == NULL) {
 		q->first_above_time = 0;
@@ -780,7 +1178,16 @@ Switch::dqr Switch::dodequeue(ManagedQueue *q, uint64_t now)
 	return r;
 }
 
-Switch::TXQueueEntry * Switch::CoDelDequeue(ManagedQueue *q, bool isNew, uint64_t now)
+void Switch::_aqmDrop(ManagedQueue *q, NetworkQoSControlBlock *nqcb)
+{
+	TXQueueEntry *const dropped = q->q.front();
+	q->byteLength -= dropped->packet.payloadLength();
+	nqcb->_currEnqueuedPackets--;
+	delete dropped;
+	q->q.pop_front();
+}
+
+Switch::TXQueueEntry * Switch::CoDelDequeue(ManagedQueue *q, bool isNew, uint64_t now, NetworkQoSControlBlock *nqcb)
 {
 	dqr r = dodequeue(q, now);
 
@@ -789,7 +1196,7 @@ Switch::TXQueueEntry * Switch::CoDelDequeue(ManagedQueue *q, bool isNew, uint64_
 			q->dropping = false;
 		}
 		while (now >= q->drop_next && q->dropping) {
-			q->q.pop_front(); // drop
+			_aqmDrop(q,nqcb);
 			r = dodequeue(q, now);
 			if (!r.ok_to_drop) {
 				// leave dropping state
@@ -801,7 +1208,7 @@ Switch::TXQueueEntry * Switch::CoDelDequeue(ManagedQueue *q, bool isNew, uint64_
 			}
 		}
 	} else if (r.ok_to_drop) {
-		q->q.pop_front(); // drop
+		_aqmDrop(q,nqcb);
 		r = dodequeue(q, now);
 		q->dropping = true;
 		q->count = (q->count > 2 && now - q->drop_next < 8*ZT_AQM_INTERVAL)?
@@ -813,10 +1220,13 @@ Switch::TXQueueEntry * Switch::CoDelDequeue(ManagedQueue *q, bool isNew, uint64_
 
 void Switch::aqm_dequeue(void *tPtr)
 {
+	Mutex::Lock _l(_aqm_m);
+
 	// Cycle through network-specific QoS control blocks
 	for(std::map<uint64_t,NetworkQoSControlBlock*>::iterator nqcb(_netQueueControlBlock.begin());nqcb!=_netQueueControlBlock.end();) {
 		if (!(*nqcb).second->_currEnqueuedPackets) {
-			return;
+			nqcb++;
+			continue;
 		}
 
 		uint64_t now = RR->node->now();
@@ -825,8 +1235,6 @@ void Switch::aqm_dequeue(void *tPtr)
 		std::vector<ManagedQueue*> *oldQueues = &((*nqcb).second->oldQueues);
 		std::vector<ManagedQueue*> *inactiveQueues = &((*nqcb).second->inactiveQueues);
 
-		_aqm_m.lock();
-
 		// Attempt dequeue from queues in NEW list
 		bool examiningNewQueues = true;
 		while (currQueues->size()) {
@@ -838,7 +1246,7 @@ void Switch::aqm_dequeue(void *tPtr)
 				oldQueues->push_back(queueAtFrontOfList);
 				currQueues->erase(currQueues->begin());
 			} else {
-				entryToEmit = CoDelDequeue(queueAtFrontOfList, examiningNewQueues, now);
+				entryToEmit = CoDelDequeue(queueAtFrontOfList, examiningNewQueues, now, (*nqcb).second);
 				if (!entryToEmit) {
 					// Move to end of list of OLD queues
 					// DEBUG_INFO("moving q=%p from NEW to OLD list", queueAtFrontOfList);
@@ -851,6 +1259,7 @@ void Switch::aqm_dequeue(void *tPtr)
 					// Send the packet!
 					queueAtFrontOfList->q.pop_front();
 					send(tPtr, entryToEmit->packet, entryToEmit->encrypt, entryToEmit->flowId);
+					delete entryToEmit;
 					(*nqcb).second->_currEnqueuedPackets--;
 				}
 				if (queueAtFrontOfList) {
@@ -870,7 +1279,7 @@ void Switch::aqm_dequeue(void *tPtr)
 				oldQueues->push_back(queueAtFrontOfList);
 				currQueues->erase(currQueues->begin());
 			} else {
-				entryToEmit = CoDelDequeue(queueAtFrontOfList, examiningNewQueues, now);
+				entryToEmit = CoDelDequeue(queueAtFrontOfList, examiningNewQueues, now, (*nqcb).second);
 				if (!entryToEmit) {
 					//DEBUG_INFO("moving q=%p from OLD to INACTIVE list", queueAtFrontOfList);
 					// Move to inactive list of queues
@@ -882,6 +1291,7 @@ void Switch::aqm_dequeue(void *tPtr)
 					queueAtFrontOfList->byteCredit -= len;
 					queueAtFrontOfList->q.pop_front();
 					send(tPtr, entryToEmit->packet, entryToEmit->encrypt, entryToEmit->flowId);
+					delete entryToEmit;
 					(*nqcb).second->_currEnqueuedPackets--;
 				}
 				if (queueAtFrontOfList) {
@@ -891,17 +1301,27 @@ void Switch::aqm_dequeue(void *tPtr)
 			}
 		}
 		nqcb++;
-		_aqm_m.unlock();
 	}
 }
 
 void Switch::removeNetworkQoSControlBlock(uint64_t nwid)
 {
-	NetworkQoSControlBlock *nq = _netQueueControlBlock[nwid];
-	if (nq) {
-		_netQueueControlBlock.erase(nwid);
-		delete nq;
-		nq = NULL;
+	Mutex::Lock _l(_aqm_m);
+	std::map<uint64_t,NetworkQoSControlBlock*>::iterator nq(_netQueueControlBlock.find(nwid));
+	if (nq != _netQueueControlBlock.end()) {
+		NetworkQoSControlBlock *const nqcb = nq->second;
+		_netQueueControlBlock.erase(nq);
+		std::vector<ManagedQueue *> queues(nqcb->newQueues);
+		queues.insert(queues.end(),nqcb->oldQueues.begin(),nqcb->oldQueues.end());
+		queues.insert(queues.end(),nqcb->inactiveQueues.begin(),nqcb->inactiveQueues.end());
+		for(std::vector<ManagedQueue *>::iterator q(queues.begin());q!=queues.end();++q) {
+			while (!(*q)->q.empty()) {
+				delete (*q)->q.front();
+				(*q)->q.pop_front();
+			}
+			delete *q;
+		}
+		delete nqcb;
 	}
 }
 
@@ -914,11 +1334,49 @@ void Switch::send(void *tPtr,Packet &packet,bool encrypt,int32_t flowId)
 	_recordOutgoingPacketMetrics(packet);
 	if (!_trySend(tPtr,packet,encrypt,flowId)) {
 		{
-			Mutex::Lock _l(_txQueue_m);
-			if (_txQueue.size() >= ZT_TX_QUEUE_SIZE) {
-				_txQueue.pop_front();
+			AdaptiveMutex::Lock _l(_txQueue_m);
+
+			_TXQueueByDest &dq = _txQueue[dest];
+
+			// Bound parked bytes per destination so one unknown sender can't
+			// monopolize the queue, evicting that destination's oldest first.
+			dq.bytes += packet.size();
+			while ((dq.bytes > ZT_TX_QUEUE_MAX_BYTES_PER_DEST)&&(!dq.q.empty())) {
+				dq.bytes -= dq.q.front().packet.size();
+				dq.q.pop_front();
+				--_txQueueSize;
+			}
+
+			if (_txQueueSize >= ZT_TX_QUEUE_SIZE) {
+				// Global cap: evict the oldest parked entry across all
+				// destinations. Each per-destination queue is FIFO so only
+				// the heads need comparing.
+				Address oldestDest;
+				uint64_t oldestTime = 0xffffffffffffffffULL;
+				{
+					Hashtable< Address,_TXQueueByDest >::Iterator i(_txQueue);
+					Address *a = (Address *)0;
+					_TXQueueByDest *odq = (_TXQueueByDest *)0;
+					while (i.next(a,odq)) {
+						if ((!odq->q.empty())&&(odq->q.front().creationTime < oldestTime)) {
+							oldestTime = odq->q.front().creationTime;
+							oldestDest = *a;
+						}
+					}
+				}
+				if (oldestDest) {
+					_TXQueueByDest *const odq = _txQueue.get(oldestDest);
+					odq->bytes -= odq->q.front().packet.size();
+					odq->q.pop_front();
+					--_txQueueSize;
+					if ((odq->q.empty())&&(oldestDest != dest)) { // dq must stay valid for the insert below
+						_txQueue.erase(oldestDest);
+					}
+				}
 			}
-			_txQueue.push_back(TXQueueEntry(dest,RR->node->now(),packet,encrypt,flowId));
+
+			dq.q.emplace_back(dest,RR->node->now(),packet,encrypt,flowId); // construct in place; one live-length packet copy
+			++_txQueueSize;
 		}
 		if (!RR->topology->getPeer(tPtr,dest)) {
 			requestWhois(tPtr,RR->node->now(),dest);
@@ -933,13 +1391,21 @@ void Switch::requestWhois(void *tPtr,const int64_t now,const Address &addr)
 	}
 
 	{
-		Mutex::Lock _l(_lastSentWhoisRequest_m);
-		int64_t &last = _lastSentWhoisRequest[addr];
-		if ((now - last) < ZT_WHOIS_RETRY_DELAY) {
+		Mutex::Lock _l(_whoisRequests_m);
+		_WhoisRequest &wr = _whoisRequests[addr];
+		if (now < wr.negativeUntil) {
+			return; // lookups for this address recently went unanswered; don't stampede upstream
+		}
+		if ((now - wr.lastSent) < ZT_WHOIS_RETRY_DELAY) {
+			return; // coalesce: a request for this address is already in flight
+		}
+		if (wr.retries >= ZT_WHOIS_MAX_RETRIES) {
+			wr.negativeUntil = now + ZT_WHOIS_NEGATIVE_CACHE_TTL;
+			wr.retries = 0;
 			return;
-		} else {
-			last = now;
 		}
+		wr.lastSent = now;
+		++wr.retries;
 	}
 
 	const SharedPtr<Peer> upstream(RR->topology->getUpstreamPeer());
@@ -954,39 +1420,129 @@ void Switch::requestWhois(void *tPtr,const int64_t now,const Address &addr)
 void Switch::doAnythingWaitingForPeer(void *tPtr,const SharedPtr<Peer> &peer)
 {
 	{
-		Mutex::Lock _l(_lastSentWhoisRequest_m);
-		_lastSentWhoisRequest.erase(peer->address());
+		Mutex::Lock _l(_whoisRequests_m);
+		_whoisRequests.erase(peer->address()); // also clears any negative cache entry
 	}
 
 	const int64_t now = RR->node->now();
-	for(unsigned int ptr=0;ptr<ZT_RX_QUEUE_SIZE;++ptr) {
+	for(unsigned int ptr=0;ptr<_rxQueueSize;++ptr) {
 		RXQueueEntry *const rq = &(_rxQueue[ptr]);
 		Mutex::Lock rql(rq->lock);
 		if ((rq->timestamp)&&(rq->complete)) {
 			if ((rq->frag0.tryDecode(RR,tPtr,rq->flowId))||((now - rq->timestamp) > ZT_RECEIVE_QUEUE_TIMEOUT)) {
-				rq->timestamp = 0;
+				_releaseRXQueueEntry(rq);
 			}
 		}
 	}
 
 	{
-		Mutex::Lock _l(_txQueue_m);
-		for(std::list< TXQueueEntry >::iterator txi(_txQueue.begin());txi!=_txQueue.end();) {
-			if (txi->dest == peer->address()) {
+		AdaptiveMutex::Lock _l(_txQueue_m);
+		_TXQueueByDest *const dq = _txQueue.get(peer->address());
+		if (dq) {
+			for(std::list< TXQueueEntry >::iterator txi(dq->q.begin());txi!=dq->q.end();) {
 				if (_trySend(tPtr,txi->packet,txi->encrypt,txi->flowId)) {
-					_txQueue.erase(txi++);
+					dq->bytes -= txi->packet.size();
+					dq->q.erase(txi++);
+					--_txQueueSize;
 				} else {
 					++txi;
 				}
-			} else {
-				++txi;
 			}
+			if (dq->q.empty()) {
+				_txQueue.erase(peer->address());
+			}
+		}
+	}
+}
+
+void Switch::_flushFrameBundle(void *tPtr,_FrameBundle &b)
+{
+	b.outp.setAt<uint8_t>(ZT_PROTO_VERB_FRAME_BUNDLE_IDX_FRAME_COUNT,(uint8_t)b.count);
+	aqm_enqueue(tPtr,b.network,b.outp,true,b.qosBucket,b.flowId);
+}
+
+bool Switch::_bundleSmallFrame(void *tPtr,const SharedPtr<Network> &network,const Address &toZT,const MAC &to,const MAC &from,unsigned int etherType,const void *data,unsigned int len,uint8_t qosBucket,int32_t flowId,int64_t now)
+{
+	const unsigned int subLen = 8 + 1 + 6 + 6 + 2 + 2 + len;
+
+	Mutex::Lock _l(_frameBundles_m);
+
+	for(std::list<_FrameBundle>::iterator b(_frameBundles.begin());b!=_frameBundles.end();++b) {
+		if (b->dest == toZT) {
+			if (((b->outp.size() + subLen) > (unsigned int)(ZT_PACKET_IDX_PAYLOAD + 1 + ZT_FRAME_BUNDLE_MAX_PAYLOAD))||(b->count >= ZT_FRAME_BUNDLE_MAX_FRAMES)) {
+				_flushFrameBundle(tPtr,*b);
+				b->outp.reset(toZT,RR->identity.address(),Packet::VERB_FRAME_BUNDLE);
+				b->outp.append((uint8_t)0); // frame count, set at flush
+				b->count = 0;
+				b->network = network;
+				b->createdAt = now;
+				b->qosBucket = qosBucket;
+				b->flowId = flowId;
+			}
+			b->outp.append((uint64_t)network->id());
+			b->outp.append((uint8_t)0x00);
+			to.appendTo(b->outp);
+			from.appendTo(b->outp);
+			b->outp.append((uint16_t)etherType);
+			b->outp.append((uint16_t)len);
+			b->outp.append(data,len);
+			++b->count;
+			return true;
+		}
+	}
+
+	// No open bundle for this destination: only start one if this is the
+	// second small frame to it within the window, so a lone small frame goes
+	// out immediately and coalescing kicks in when a burst is actually
+	// happening
+	_SmallFrameSeen &sf = _smallFrameSeen[(unsigned long)(toZT.toInt()) & (ZT_FRAME_BUNDLE_SEEN_SIZE - 1)];
+	const bool burst = ((sf.addr == toZT.toInt())&&((now - sf.at) <= ZT_FRAME_BUNDLE_WINDOW));
+	sf.addr = toZT.toInt();
+	sf.at = now;
+	if ((!burst)||(_frameBundles.size() >= ZT_FRAME_BUNDLE_MAX_CONCURRENT)) {
+		return false; // send normally
+	}
+
+	_frameBundles.push_back(_FrameBundle(toZT,RR->identity.address()));
+	_FrameBundle &nb = _frameBundles.back();
+	nb.network = network;
+	nb.createdAt = now;
+	nb.qosBucket = qosBucket;
+	nb.flowId = flowId;
+	nb.outp.append((uint8_t)0); // frame count, set at flush
+	nb.outp.append((uint64_t)network->id());
+	nb.outp.append((uint8_t)0x00);
+	to.appendTo(nb.outp);
+	from.appendTo(nb.outp);
+	nb.outp.append((uint16_t)etherType);
+	nb.outp.append((uint16_t)len);
+	nb.outp.append(data,len);
+	nb.count = 1;
+	_frameBundleCount = (unsigned int)_frameBundles.size();
+	return true;
+}
+
+void Switch::_flushExpiredFrameBundles(void *tPtr,int64_t now)
+{
+	if (_frameBundleCount.load(std::memory_order_relaxed) == 0) {
+		return;
+	}
+	Mutex::Lock _l(_frameBundles_m);
+	for(std::list<_FrameBundle>::iterator b(_frameBundles.begin());b!=_frameBundles.end();) {
+		if ((now - b->createdAt) >= ZT_FRAME_BUNDLE_WINDOW) {
+			_flushFrameBundle(tPtr,*b);
+			b = _frameBundles.erase(b);
+		} else {
+			++b;
 		}
 	}
+	_frameBundleCount = (unsigned int)_frameBundles.size();
 }
 
 unsigned long Switch::doTimerTasks(void *tPtr,int64_t now)
 {
+	_flushExpiredFrameBundles(tPtr,now);
+
 	const uint64_t timeSinceLastCheck = now - _lastCheckedQueues;
 	if (timeSinceLastCheck < ZT_WHOIS_RETRY_DELAY) {
 		return (unsigned long)(ZT_WHOIS_RETRY_DELAY - timeSinceLastCheck);
@@ -995,18 +1551,37 @@ unsigned long Switch::doTimerTasks(void *tPtr,int64_t now)
 
 	std::vector<Address> needWhois;
 	{
-		Mutex::Lock _l(_txQueue_m);
+		AdaptiveMutex::Lock _l(_txQueue_m);
 
-		for(std::list< TXQueueEntry >::iterator txi(_txQueue.begin());txi!=_txQueue.end();) {
-			if (_trySend(tPtr,txi->packet,txi->encrypt,txi->flowId)) {
-				_txQueue.erase(txi++);
-			} else if ((now - txi->creationTime) > ZT_TRANSMIT_QUEUE_TIMEOUT) {
-				_txQueue.erase(txi++);
-			} else {
-				if (!RR->topology->getPeer(tPtr,txi->dest)) {
-					needWhois.push_back(txi->dest);
+		Hashtable< Address,_TXQueueByDest >::Iterator i(_txQueue);
+		Address *a = (Address *)0;
+		_TXQueueByDest *dq = (_TXQueueByDest *)0;
+		while (i.next(a,dq)) {
+			// One peer lookup per destination rather than per parked packet
+			const bool haveIdentity = (bool)RR->topology->getPeer(tPtr,*a);
+			if (haveIdentity) {
+				for(std::list< TXQueueEntry >::iterator txi(dq->q.begin());txi!=dq->q.end();) {
+					if (_trySend(tPtr,txi->packet,txi->encrypt,txi->flowId)) {
+						dq->bytes -= txi->packet.size();
+						dq->q.erase(txi++);
+						--_txQueueSize;
+					} else {
+						++txi;
+					}
 				}
-				++txi;
+			}
+
+			// Queues are FIFO by creation time, so expired entries are at the head
+			while ((!dq->q.empty())&&((now - (int64_t)dq->q.front().creationTime) > ZT_TRANSMIT_QUEUE_TIMEOUT)) {
+				dq->bytes -= dq->q.front().packet.size();
+				dq->q.pop_front();
+				--_txQueueSize;
+			}
+
+			if (dq->q.empty()) {
+				_txQueue.erase(*a);
+			} else if (!haveIdentity) {
+				needWhois.push_back(*a);
 			}
 		}
 	}
@@ -1014,41 +1589,36 @@ unsigned long Switch::doTimerTasks(void *tPtr,int64_t now)
 		requestWhois(tPtr,now,*i);
 	}
 
-	for(unsigned int ptr=0;ptr<ZT_RX_QUEUE_SIZE;++ptr) {
+	Metrics::tx_queue_lock_contended = (long)_txQueue_m.contendedAcquires();
+
+	for(unsigned int ptr=0;ptr<_rxQueueSize;++ptr) {
 		RXQueueEntry *const rq = &(_rxQueue[ptr]);
 		Mutex::Lock rql(rq->lock);
-		if ((rq->timestamp)&&(rq->complete)) {
-			if ((rq->frag0.tryDecode(RR,tPtr,rq->flowId))||((now - rq->timestamp) > ZT_RECEIVE_QUEUE_TIMEOUT)) {
-				rq->timestamp = 0;
-			} else {
-				const Address src(rq->frag0.source());
-				if (!RR->topology->getPeer(tPtr,src)) {
-					requestWhois(tPtr,now,src);
+		if (rq->timestamp) {
+			if (rq->complete) {
+				if ((rq->frag0.tryDecode(RR,tPtr,rq->flowId))||((now - rq->timestamp) > ZT_RECEIVE_QUEUE_TIMEOUT)) {
+					_releaseRXQueueEntry(rq);
+				} else {
+					const Address src(rq->frag0.source());
+					if (!RR->topology->getPeer(tPtr,src)) {
+						requestWhois(tPtr,now,src);
+					}
 				}
+			} else if ((now - rq->timestamp) > ZT_RECEIVE_QUEUE_TIMEOUT) {
+				// Reassembly timed out: free the slot and refund the source's budget
+				_releaseRXQueueEntry(rq);
 			}
 		}
 	}
 
 	{
-		Mutex::Lock _l(_lastUniteAttempt_m);
-		Hashtable< _LastUniteKey,uint64_t >::Iterator i(_lastUniteAttempt);
-		_LastUniteKey *k = (_LastUniteKey *)0;
-		uint64_t *v = (uint64_t *)0;
-		while (i.next(k,v)) {
-			if ((now - *v) >= (ZT_MIN_UNITE_INTERVAL * 8)) {
-				_lastUniteAttempt.erase(*k);
-			}
-		}
-	}
-
-	{
-		Mutex::Lock _l(_lastSentWhoisRequest_m);
-		Hashtable< Address,int64_t >::Iterator i(_lastSentWhoisRequest);
+		Mutex::Lock _l(_whoisRequests_m);
+		Hashtable< Address,_WhoisRequest >::Iterator i(_whoisRequests);
 		Address *a = (Address *)0;
-		int64_t *ts = (int64_t *)0;
-		while (i.next(a,ts)) {
-			if ((now - *ts) > (ZT_WHOIS_RETRY_DELAY * 2)) {
-				_lastSentWhoisRequest.erase(*a);
+		_WhoisRequest *wr = (_WhoisRequest *)0;
+		while (i.next(a,wr)) {
+			if (((now - wr->lastSent) > (ZT_WHOIS_RETRY_DELAY * 2))&&(now >= wr->negativeUntil)) {
+				_whoisRequests.erase(*a);
 			}
 		}
 	}
@@ -1058,13 +1628,41 @@ unsigned long Switch::doTimerTasks(void *tPtr,int64_t now)
 
 bool Switch::_shouldUnite(const int64_t now,const Address &source,const Address &destination)
 {
-	Mutex::Lock _l(_lastUniteAttempt_m);
-	uint64_t &ts = _lastUniteAttempt[_LastUniteKey(source,destination)];
-	if ((now - ts) >= ZT_MIN_UNITE_INTERVAL) {
-		ts = now;
-		return true;
+	uint64_t x = source.toInt();
+	uint64_t y = destination.toInt();
+	if (x > y) {
+		const uint64_t tmp = x;
+		x = y;
+		y = tmp;
 	}
-	return false;
+	const unsigned long bucket = (unsigned long)(((x ^ (y >> 5)) * 0x9e3779b97f4a7c15ULL) >> 32) & (unsigned long)(ZT_SWITCH_UNITE_GATE_BUCKETS - 1);
+
+	Mutex::Lock _l(_uniteGate_m);
+
+	if (!_uniteGate) {
+		_uniteGate = new _UniteGateEntry[ZT_SWITCH_UNITE_GATE_BUCKETS * ZT_SWITCH_UNITE_GATE_WAYS]();
+	}
+
+	_UniteGateEntry *const b = _uniteGate + (bucket * ZT_SWITCH_UNITE_GATE_WAYS);
+	_UniteGateEntry *stalest = b;
+	for(unsigned int w=0;w<ZT_SWITCH_UNITE_GATE_WAYS;++w) {
+		if ((b[w].x == x)&&(b[w].y == y)) {
+			if ((now - b[w].ts) >= ZT_MIN_UNITE_INTERVAL) {
+				b[w].ts = now;
+				return true;
+			}
+			return false;
+		}
+		if (b[w].ts < stalest->ts) {
+			stalest = &(b[w]);
+		}
+	}
+
+	// Not tracked: displace the stalest entry in the bucket and unite now
+	stalest->x = x;
+	stalest->y = y;
+	stalest->ts = now;
+	return true;
 }
 
 bool Switch::_trySend(void *tPtr,Packet &packet,bool encrypt,int32_t flowId)
@@ -1107,19 +1705,40 @@ bool Switch::_trySend(void *tPtr,Packet &packet,bool encrypt,int32_t flowId)
 	return false;
 }
 
-void Switch::_sendViaSpecificPath(void *tPtr,SharedPtr<Peer> peer,SharedPtr<Path> viaPath,uint16_t userSpecifiedMtu, int64_t now,Packet &packet,bool encrypt,int32_t flowId)
+void Switch::_sendViaSpecificPath(void *tPtr,const SharedPtr<Peer> &peer,const SharedPtr<Path> &viaPath,uint16_t userSpecifiedMtu, int64_t now,Packet &packet,bool encrypt,int32_t flowId)
 {
 	unsigned int mtu = ZT_DEFAULT_PHYSMTU;
 	uint64_t trustedPathId = 0;
 	RR->topology->getOutboundPathInfo(viaPath->address(),mtu,trustedPathId);
 
+	if (!trustedPathId) {
+		// Controller-designated trusted paths are honored per peer, not
+		// globally like local.conf entries: the destination must be a
+		// verified authorized member of the designating network before
+		// anything is sent to it in the clear.
+		uint64_t tpNwid = 0;
+		const uint64_t networkTpid = RR->topology->getNetworkTrustedPath(viaPath->address(),tpNwid);
+		if (networkTpid) {
+			const SharedPtr<Network> network(RR->node->network(tpNwid));
+			if ((network)&&(network->gate(tPtr,peer))) {
+				trustedPathId = networkTpid;
+			}
+		}
+	}
+
 	if (userSpecifiedMtu > 0) {
 		mtu = userSpecifiedMtu;
+	} else if ((unsigned int)viaPath->probedMtu() > mtu) {
+		// MTU probing verified that this path round-trips larger packets, so
+		// fragment against the learned size instead of the conservative default.
+		mtu = (unsigned int)viaPath->probedMtu();
 	}
 	unsigned int chunkSize = std::min(packet.size(),mtu);
 	packet.setFragmented(chunkSize < packet.size());
 
-	if (trustedPathId) {
+	if ((trustedPathId)&&(!packet.isEncrypted())) {
+		// Group-keyed packets arrive here already armored and must keep
+		// their MAC; everything else on a trusted path skips crypto
 		packet.setTrusted(trustedPathId);
 	} else {
 		if (!packet.isEncrypted()) {
@@ -1178,6 +1797,9 @@ void Switch::_recordOutgoingPacketMetrics(const Packet &p) {
 		case Packet::VERB_EXT_FRAME:
 			Metrics::pkt_ext_frame_out++;
 			break;
+		case Packet::VERB_FRAME_BUNDLE:
+			Metrics::pkt_frame_bundle_out++;
+			break;
 		case Packet::VERB_ECHO:
 			Metrics::pkt_echo_out++;
 			break;
@@ -1217,6 +1839,9 @@ void Switch::_recordOutgoingPacketMetrics(const Packet &p) {
 		case Packet::VERB_PATH_NEGOTIATION_REQUEST:
 			Metrics::pkt_path_negotiation_request_out++;
 			break;
+		case Packet::VERB_GROUP_KEY:
+			Metrics::pkt_group_key_out++;
+			break;
 	}
 }
 
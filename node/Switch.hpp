@@ -19,6 +19,11 @@
 #include <vector>
 #include <list>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include "Constants.hpp"
 #include "Mutex.hpp"
 #include "MAC.hpp"
@@ -41,6 +46,20 @@
 #define ZT_ETHERTYPE_IPX_B 0x8138
 #define ZT_ETHERTYPE_IPV6 0x86dd
 
+// Outbound small-frame coalescing (VERB_FRAME_BUNDLE): unicast frames of at
+// most MAX_FRAME_SIZE bytes sent to the same bundle-capable peer within
+// WINDOW milliseconds of one another share a single armored wire packet
+#define ZT_FRAME_BUNDLE_WINDOW 1
+#define ZT_FRAME_BUNDLE_MAX_FRAME_SIZE 400
+#define ZT_FRAME_BUNDLE_MAX_FRAMES 32
+#define ZT_FRAME_BUNDLE_MAX_PAYLOAD ZT_DEFAULT_MTU
+#define ZT_FRAME_BUNDLE_MAX_CONCURRENT 16
+#define ZT_FRAME_BUNDLE_SEEN_SIZE 64
+
+// Geometry of the RENDEZVOUS rate-gate table (buckets must be a power of two)
+#define ZT_SWITCH_UNITE_GATE_BUCKETS 8192
+#define ZT_SWITCH_UNITE_GATE_WAYS 4
+
 namespace ZeroTier {
 
 class RuntimeEnvironment;
@@ -57,6 +76,7 @@ class Peer;
 class Switch
 {
 	struct ManagedQueue;
+	struct NetworkQoSControlBlock;
 	struct TXQueueEntry;
 
 	friend class SharedPtr<Peer>;
@@ -68,10 +88,15 @@ class Switch
 
 public:
 	Switch(const RuntimeEnvironment *renv);
+	~Switch();
 
 	/**
 	 * Called when a packet is received from the real network
 	 *
+	 * If worker threads are enabled (see setRxWorkerThreads()) this copies
+	 * the packet onto a worker's queue and returns immediately. Otherwise
+	 * the packet is processed synchronously on the calling thread.
+	 *
 	 * @param tPtr Thread pointer to be handed through to any callbacks called as a result of this call
 	 * @param localSocket Local I/O socket as supplied by external code
 	 * @param fromAddr Internet IP address of origin
@@ -80,6 +105,57 @@ public:
 	 */
 	void onRemotePacket(void *tPtr,const int64_t localSocket,const InetAddress &fromAddr,const void *data,unsigned int len);
 
+	/**
+	 * Called when a packet is received from the real network, lending the buffer
+	 *
+	 * Unlike onRemotePacket() the caller's buffer is borrowed rather than
+	 * copied: it remains owned by the core until freeFunction is invoked
+	 * with it, which may happen on a worker thread after this returns.
+	 * This removes the staging copy per packet when worker threads are
+	 * enabled. With a NULL freeFunction this is exactly onRemotePacket().
+	 *
+	 * @param tPtr Thread pointer to be handed through to any callbacks called as a result of this call
+	 * @param localSocket Local I/O socket as supplied by external code
+	 * @param fromAddr Internet IP address of origin
+	 * @param data Packet data (lent until freeFunction is called)
+	 * @param len Packet length
+	 * @param freeFunction Called exactly once to return the buffer, or NULL to copy
+	 * @param freeFunctionArg First argument passed to freeFunction
+	 */
+	void onRemotePacketLended(void *tPtr,const int64_t localSocket,const InetAddress &fromAddr,void *data,unsigned int len,ZT_BufferFreeFunction freeFunction,void *freeFunctionArg);
+
+	/**
+	 * Enable or disable parallel processing of incoming packets
+	 *
+	 * When enabled, decryption, MAC verification, and rule evaluation for
+	 * incoming packets run on a pool of worker threads instead of the
+	 * I/O thread. Packets are sharded onto workers by source address so
+	 * ordering is preserved per peer. Fragments (which carry no source
+	 * address) are sharded by packet ID; reassembly is protected by the
+	 * RX queue entry lock as in single-threaded mode.
+	 *
+	 * This must be called before packet I/O begins as the worker set is
+	 * not guarded against concurrent dispatch. The default is 0 (process
+	 * synchronously on the I/O thread).
+	 *
+	 * @param threadCount Number of worker threads or 0 to disable
+	 */
+	void setRxWorkerThreads(unsigned int threadCount,const unsigned int *pinCpus = (const unsigned int *)0,unsigned int pinCpuCount = 0);
+
+	/**
+	 * Size the RX queue against a memory budget
+	 *
+	 * RX queue entries hold in-progress fragment reassemblies and packets
+	 * awaiting WHOIS, so relays with many concurrent fragment streams need
+	 * more than the compile-time default. Like the worker thread count this
+	 * must be called before packet I/O begins and is applied at startup
+	 * only. The budget can only grow the queue, never shrink it below the
+	 * compile-time size.
+	 *
+	 * @param bytes Approximate memory budget in bytes (0 = compile-time default)
+	 */
+	void setRxQueueMemoryBudget(uint64_t bytes);
+
 	/**
 	 * Returns whether our bonding or balancing policy is aware of flows.
 	 */
@@ -140,8 +216,18 @@ public:
 	 * @param q The TX queue that is being dequeued from
 	 * @param isNew Whether or not this queue is in the NEW list
 	 * @param now Current time
+	 * @param nqcb Control block owning the queue, for drop accounting
 	 */
-	Switch::TXQueueEntry * CoDelDequeue(ManagedQueue *q, bool isNew, uint64_t now);
+	Switch::TXQueueEntry * CoDelDequeue(ManagedQueue *q, bool isNew, uint64_t now, NetworkQoSControlBlock *nqcb);
+
+	/**
+	 * Drops the packet at the head of a managed queue, updating byte and
+	 * packet accounting so the control law sees the reduced backlog.
+	 *
+	 * @param q The TX queue to drop from (must be non-empty)
+	 * @param nqcb Control block owning the queue
+	 */
+	void _aqmDrop(ManagedQueue *q, NetworkQoSControlBlock *nqcb);
 
 	/**
 	 * Removes QoS Queues and flow state variables for a specific network. These queues are created
@@ -205,23 +291,34 @@ public:
 	unsigned long doTimerTasks(void *tPtr,int64_t now);
 
 private:
+	void _doOnRemotePacket(void *tPtr,const int64_t localSocket,const InetAddress &fromAddr,const void *data,unsigned int len);
+	bool _ingressPolicerGate(const int64_t now,const InetAddress &fromAddr);
 	bool _shouldUnite(const int64_t now,const Address &source,const Address &destination);
 	bool _trySend(void *tPtr,Packet &packet,bool encrypt,int32_t flowId = ZT_QOS_NO_FLOW); // packet is modified if return is true
-	void _sendViaSpecificPath(void *tPtr,SharedPtr<Peer> peer,SharedPtr<Path> viaPath,uint16_t userSpecifiedMtu, int64_t now,Packet &packet,bool encrypt,int32_t flowId);
+	void _sendViaSpecificPath(void *tPtr,const SharedPtr<Peer> &peer,const SharedPtr<Path> &viaPath,uint16_t userSpecifiedMtu, int64_t now,Packet &packet,bool encrypt,int32_t flowId);
 	void _recordOutgoingPacketMetrics(const Packet &p);
+	bool _bundleSmallFrame(void *tPtr,const SharedPtr<Network> &network,const Address &toZT,const MAC &to,const MAC &from,unsigned int etherType,const void *data,unsigned int len,uint8_t qosBucket,int32_t flowId,int64_t now);
+	void _flushExpiredFrameBundles(void *tPtr,int64_t now);
 
 	const RuntimeEnvironment *const RR;
 	int64_t _lastBeaconResponse;
 	volatile int64_t _lastCheckedQueues;
 
-	// Time we last sent a WHOIS request for each address
-	Hashtable< Address,int64_t > _lastSentWhoisRequest;
-	Mutex _lastSentWhoisRequest_m;
+	// State of an outstanding (or recently failed) WHOIS for one address
+	struct _WhoisRequest
+	{
+		_WhoisRequest() : lastSent(0),negativeUntil(0),retries(0) {}
+		int64_t lastSent;
+		int64_t negativeUntil; // if in the future, lookups for this address went unanswered; don't retry yet
+		unsigned int retries;
+	};
+	Hashtable< Address,_WhoisRequest > _whoisRequests;
+	Mutex _whoisRequests_m;
 
 	// Packets waiting for WHOIS replies or other decode info or missing fragments
 	struct RXQueueEntry
 	{
-		RXQueueEntry() : timestamp(0) {}
+		RXQueueEntry() : timestamp(0),bytesBuffered(0) {}
 		volatile int64_t timestamp; // 0 if entry is not in use
 		volatile uint64_t packetId;
 		IncomingPacket frag0; // head of packet
@@ -230,30 +327,80 @@ private:
 		uint32_t haveFragments; // bit mask, LSB to MSB
 		volatile bool complete; // if true, packet is complete
 		volatile int32_t flowId;
+		Address source; // originating peer, or zero for a fragment set whose head has not arrived yet
+		unsigned int bytesBuffered; // wire bytes held by this entry, charged to source's budget once known
 		Mutex lock;
 	};
-	RXQueueEntry _rxQueue[ZT_RX_QUEUE_SIZE];
-	AtomicCounter _rxQueuePtr;
-
-	// Returns matching or next available RX queue entry
-	inline RXQueueEntry *_findRXQueueEntry(uint64_t packetId)
+	// Allocated at construction to ZT_RX_QUEUE_SIZE entries; may be grown by
+	// setRxQueueMemoryBudget() before packet I/O begins
+	RXQueueEntry *_rxQueue;
+	unsigned int _rxQueueSize;
+
+	// Wire bytes buffered for reassembly or decode-info waits per originating peer
+	Hashtable< Address,unsigned int > _rxReassemblyBytes;
+	Mutex _rxReassemblyBytes_m;
+
+	// An incoming wire packet staged off the I/O thread for a worker: either
+	// copied into data[] or, for lended buffers, referenced via extData with
+	// a disposer to call once the packet has been processed
+	struct RXWorkItem
+	{
+		RXWorkItem() : tPtr((void *)0),localSocket(-1),len(0),extData((void *)0),extFree((ZT_BufferFreeFunction)0),extFreeArg((void *)0) {}
+		void *tPtr;
+		int64_t localSocket;
+		InetAddress fromAddr;
+		unsigned int len;
+		void *extData; // if non-NULL, process from this caller-lent buffer instead of data[]
+		ZT_BufferFreeFunction extFree;
+		void *extFreeArg;
+		uint8_t data[ZT_PROTO_MAX_PACKET_LENGTH];
+	};
+	struct RXWorker
 	{
-		const unsigned int current = static_cast<unsigned int>(_rxQueuePtr.load());
-		for(unsigned int k=1;k<=ZT_RX_QUEUE_SIZE;++k) {
-			RXQueueEntry *rq = &(_rxQueue[(current - k) % ZT_RX_QUEUE_SIZE]);
-			if ((rq->packetId == packetId)&&(rq->timestamp)) {
-				return rq;
-			}
-		}
-		++_rxQueuePtr;
-		return &(_rxQueue[static_cast<unsigned int>(current) % ZT_RX_QUEUE_SIZE]);
-	}
-
-	// Returns current entry in rx queue ring buffer and increments ring pointer
-	inline RXQueueEntry *_nextRXQueueEntry()
+		int pinCpu; // CPU this worker pins itself to, -1 for unpinned
+		std::thread thread;
+		std::mutex lock;
+		std::condition_variable cond;
+		std::list<RXWorkItem> q;
+		std::list<RXWorkItem> pool; // processed items are recycled here so the steady state does no malloc/free per packet
+	};
+	void _rxWorkerLoop(RXWorker *w);
+	void _stopRxWorkers();
+	std::vector<RXWorker *> _rxWorkers; // empty in single-threaded mode
+	std::atomic<bool> _rxWorkersRun;
+
+	// Front-line per-source ingress token buckets indexed by
+	// InetAddress::rateGateHash(); colliding sources share a bucket, which
+	// only makes the policer marginally stricter. Fields are deliberately
+	// plain: concurrent I/O threads may lose or double-spend a few tokens,
+	// which is harmless in a policer.
+	struct _IngressPolicerBucket
 	{
-		return &(_rxQueue[static_cast<unsigned int>((++_rxQueuePtr) - 1) % ZT_RX_QUEUE_SIZE]);
-	}
+		_IngressPolicerBucket() : tokens(ZT_INGRESS_POLICER_BURST),lastRefill(0) {}
+		int32_t tokens;
+		int64_t lastRefill;
+	};
+	_IngressPolicerBucket _ingressPolicer[16384];
+
+	// Returns matching RX queue entry or the best candidate for (re)use, preferring
+	// free or expired entries over live reassemblies. The caller must lock the
+	// entry and, if it is being reused, release it before re-initializing it.
+	RXQueueEntry *_findRXQueueEntry(int64_t now,uint64_t packetId);
+
+	// Returns the best RX queue entry to (re)use for a new packet (same selection
+	// as _findRXQueueEntry but with no matching phase)
+	RXQueueEntry *_nextRXQueueEntry(int64_t now);
+
+	// Charge bytes against a peer's reassembly budget, returns false (and charges
+	// nothing) if this would exceed ZT_RX_MAX_REASSEMBLY_BYTES_PER_PEER
+	bool _rxReassemblyCharge(const Address &src,unsigned int bytes);
+
+	// Return bytes to a peer's reassembly budget
+	void _rxReassemblyRefund(const Address &src,unsigned int bytes);
+
+	// Free an RX queue entry, refunding anything charged to its source's budget
+	// (must be called with the entry's lock held; no-op on an already free entry)
+	void _releaseRXQueueEntry(RXQueueEntry *rq);
 
 	// ZeroTier-layer TX queue entry
 	struct TXQueueEntry
@@ -272,30 +419,72 @@ private:
 		bool encrypt;
 		int32_t flowId;
 	};
-	std::list< TXQueueEntry > _txQueue;
-	Mutex _txQueue_m;
+	// Parked packets indexed by destination. Every entry shares the same
+	// fixed lifetime and each per-destination queue is FIFO by creation
+	// time, so the queue head is always the next entry to expire -- deadline
+	// order falls out of insertion order and no separate heap is needed.
+	// Indexing by destination lets enqueue byte-accounting, the flush when a
+	// WHOIS reply arrives, and timer expiry each touch only the entries they
+	// concern instead of scanning the whole queue.
+	struct _TXQueueByDest
+	{
+		_TXQueueByDest() : bytes(0) {}
+		std::list< TXQueueEntry > q; // FIFO by creationTime
+		unsigned int bytes; // total parked packet bytes for this destination
+	};
+	Hashtable< Address,_TXQueueByDest > _txQueue;
+	unsigned long _txQueueSize; // total entries across all destinations
+	AdaptiveMutex _txQueue_m;
 	Mutex _aqm_m;
 
-	// Tracks sending of VERB_RENDEZVOUS to relaying peers
-	struct _LastUniteKey
+	// Rate gate for VERB_RENDEZVOUS to relayed address pairs. This used to be
+	// a Hashtable grown on every relayed flow and pruned by full iteration in
+	// doTimerTasks(), which on busy relays reached hundreds of thousands of
+	// entries and made the sweep a recurring latency spike. It is now a
+	// fixed-size set-associative table: each pair hashes to a bucket of
+	// ZT_SWITCH_UNITE_GATE_WAYS entries and displaces the stalest entry on
+	// miss, so maintenance is O(1) per lookup and there is nothing to sweep.
+	// Collision evictions only cause an occasional early RENDEZVOUS for one
+	// of the colliding pairs, which is harmless. Allocated on first use since
+	// only relaying nodes ever populate it.
+	struct _UniteGateEntry
 	{
-		_LastUniteKey() : x(0),y(0) {}
-		_LastUniteKey(const Address &a1,const Address &a2)
-		{
-			if (a1 > a2) {
-				x = a2.toInt();
-				y = a1.toInt();
-			} else {
-				x = a1.toInt();
-				y = a2.toInt();
-			}
-		}
-		inline unsigned long hashCode() const { return ((unsigned long)x ^ (unsigned long)y); }
-		inline bool operator==(const _LastUniteKey &k) const { return ((x == k.x)&&(y == k.y)); }
-		uint64_t x,y;
+		uint64_t x,y; // address pair, sorted ascending (0,0 == empty)
+		int64_t ts; // time of last RENDEZVOUS for this pair
+	};
+	_UniteGateEntry *_uniteGate;
+	Mutex _uniteGate_m;
+
+	// Pending outbound small-frame bundles (VERB_FRAME_BUNDLE) keyed by
+	// destination, flushed when size or count caps are reached or when the
+	// coalescing window expires (checked on subsequent tap and wire traffic
+	// and in doTimerTasks()). A bundle only starts once two small frames to
+	// the same destination land within the window, so an isolated small
+	// frame is never held back.
+	struct _FrameBundle
+	{
+		_FrameBundle(const Address &d,const Address &self) :
+			dest(d),
+			network(),
+			outp(d,self,Packet::VERB_FRAME_BUNDLE),
+			count(0),
+			createdAt(0),
+			qosBucket(0),
+			flowId(ZT_QOS_NO_FLOW) {}
+		Address dest;
+		SharedPtr<Network> network; // network of first frame, used for queue assignment
+		Packet outp;
+		unsigned int count;
+		int64_t createdAt;
+		uint8_t qosBucket;
+		int32_t flowId;
 	};
-	Hashtable< _LastUniteKey,uint64_t > _lastUniteAttempt; // key is always sorted in ascending order, for set-like behavior
-	Mutex _lastUniteAttempt_m;
+	void _flushFrameBundle(void *tPtr,_FrameBundle &b); // assumes _frameBundles_m is locked
+	std::list<_FrameBundle> _frameBundles;
+	std::atomic<unsigned int> _frameBundleCount; // kept equal to _frameBundles.size() for a lock-free empty check
+	struct _SmallFrameSeen { uint64_t addr; int64_t at; };
+	_SmallFrameSeen _smallFrameSeen[ZT_FRAME_BUNDLE_SEEN_SIZE]; // last small frame time per destination (flat table, takeover on collision)
+	Mutex _frameBundles_m;
 
 	// Queue with additional flow state variables
 	struct ManagedQueue
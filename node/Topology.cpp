@@ -19,6 +19,11 @@
 #include "NetworkConfig.hpp"
 #include "Buffer.hpp"
 #include "Switch.hpp"
+#include "SHA512.hpp"
+#include "Metrics.hpp"
+
+#include <thread>
+#include <atomic>
 
 namespace ZeroTier {
 
@@ -28,6 +33,8 @@ static const unsigned char ZT_DEFAULT_WORLD[ZT_DEFAULT_WORLD_LENGTH] = {0x01,0x0
 Topology::Topology(const RuntimeEnvironment *renv,void *tPtr) :
 	RR(renv),
 	_numConfiguredPhysicalPaths(0),
+	_numNetworkTrustedPaths(0),
+	_bestUpstreamRescore(0),
 	_amUpstream(false)
 {
 	uint8_t tmp[ZT_WORLD_MAX_SERIALIZED_LENGTH];
@@ -53,11 +60,13 @@ Topology::Topology(const RuntimeEnvironment *renv,void *tPtr) :
 
 Topology::~Topology()
 {
-	Hashtable< Address,SharedPtr<Peer> >::Iterator i(_peers);
-	Address *a = (Address *)0;
-	SharedPtr<Peer> *p = (SharedPtr<Peer> *)0;
-	while (i.next(a,p)) {
-		_savePeer((void *)0,*p);
+	for(unsigned long s=0;s<ZT_TOPOLOGY_PEER_SHARDS;++s) {
+		FlatHashtable< Address,SharedPtr<Peer> >::Iterator i(_peerShards[s].peers);
+		Address *a = (Address *)0;
+		SharedPtr<Peer> *p = (SharedPtr<Peer> *)0;
+		while (i.next(a,p)) {
+			_savePeer((void *)0,*p);
+		}
 	}
 }
 
@@ -65,8 +74,9 @@ SharedPtr<Peer> Topology::addPeer(void *tPtr,const SharedPtr<Peer> &peer)
 {
 	SharedPtr<Peer> np;
 	{
-		Mutex::Lock _l(_peers_m);
-		SharedPtr<Peer> &hp = _peers[peer->address()];
+		PeerShard &ps = _peerShard(peer->address());
+		AdaptiveMutex::Lock _l(ps.lock);
+		SharedPtr<Peer> &hp = ps.peers[peer->address()];
 		if (!hp) {
 			hp = peer;
 		}
@@ -81,9 +91,11 @@ SharedPtr<Peer> Topology::getPeer(void *tPtr,const Address &zta)
 		return SharedPtr<Peer>();
 	}
 
+	PeerShard &ps = _peerShard(zta);
+
 	{
-		Mutex::Lock _l(_peers_m);
-		const SharedPtr<Peer> *const ap = _peers.get(zta);
+		AdaptiveMutex::Lock _l(ps.lock);
+		const SharedPtr<Peer> *const ap = ps.peers.get(zta);
 		if (ap) {
 			return *ap;
 		}
@@ -97,14 +109,14 @@ SharedPtr<Peer> Topology::getPeer(void *tPtr,const Address &zta)
 		int len = RR->node->stateObjectGet(tPtr,ZT_STATE_OBJECT_PEER,idbuf,buf.unsafeData(),ZT_PEER_MAX_SERIALIZED_STATE_SIZE);
 		if (len > 0) {
 			buf.setSize(len);
-			Mutex::Lock _l(_peers_m);
-			SharedPtr<Peer> &ap = _peers[zta];
+			AdaptiveMutex::Lock _l(ps.lock);
+			SharedPtr<Peer> &ap = ps.peers[zta];
 			if (ap) {
 				return ap;
 			}
 			ap = Peer::deserializeFromCache(RR->node->now(),tPtr,buf,RR);
 			if (!ap) {
-				_peers.erase(zta);
+				ps.peers.erase(zta);
 			}
 			return SharedPtr<Peer>();
 		}
@@ -118,8 +130,9 @@ Identity Topology::getIdentity(void *tPtr,const Address &zta)
 	if (zta == RR->identity.address()) {
 		return RR->identity;
 	} else {
-		Mutex::Lock _l(_peers_m);
-		const SharedPtr<Peer> *const ap = _peers.get(zta);
+		PeerShard &ps = _peerShard(zta);
+		AdaptiveMutex::Lock _l(ps.lock);
+		const SharedPtr<Peer> *const ap = ps.peers.get(zta);
 		if (ap) {
 			return (*ap)->identity();
 		}
@@ -127,30 +140,87 @@ Identity Topology::getIdentity(void *tPtr,const Address &zta)
 	return Identity();
 }
 
+bool Topology::validateIdentity(const Identity &id)
+{
+	uint64_t digest[8];
+	{
+		Buffer<ZT_IDENTITY_STRING_BUFFER_LENGTH> tmp;
+		id.serialize(tmp,false);
+		SHA512(digest,tmp.data(),tmp.size());
+	}
+
+	{
+		Mutex::Lock _l(_verifiedIdentities_m);
+		const uint64_t *const fp = _verifiedIdentities.get(digest[0]);
+		if ((fp)&&(*fp == digest[1])) {
+			return true;
+		}
+	}
+
+	if (!id.locallyValidate()) {
+		return false;
+	}
+
+	{
+		Mutex::Lock _l(_verifiedIdentities_m);
+		if (_verifiedIdentities.size() >= ZT_TOPOLOGY_VERIFIED_IDENTITY_CACHE_SIZE) {
+			_verifiedIdentities.clear();
+		}
+		_verifiedIdentities.set(digest[0],digest[1]);
+	}
+	return true;
+}
+
 SharedPtr<Peer> Topology::getUpstreamPeer()
 {
 	const int64_t now = RR->node->now();
 	unsigned int bestq = ~((unsigned int)0);
-	const SharedPtr<Peer> *best = (const SharedPtr<Peer> *)0;
+	SharedPtr<Peer> best;
 
-	Mutex::Lock _l2(_peers_m);
-	Mutex::Lock _l1(_upstreams_m);
+	// Fast path: return the memoized winner unless it is time to rescore or
+	// the incumbent has gone silent.
+	{
+		Mutex::Lock _l(_bestUpstream_m);
+		if ((_bestUpstream)&&((now - _bestUpstreamRescore) < (int64_t)ZT_TOPOLOGY_UPSTREAM_RESCORE_PERIOD)) {
+			if (_bestUpstream->relayQuality(now) != (~(unsigned int)0)) {
+				return _bestUpstream;
+			}
+		}
+	}
+
+	std::vector<Address> upstreams;
+	{
+		Mutex::Lock _l(_upstreams_m);
+		upstreams = _upstreamAddresses;
+	}
 
-	for(std::vector<Address>::const_iterator a(_upstreamAddresses.begin());a!=_upstreamAddresses.end();++a) {
-		const SharedPtr<Peer> *p = _peers.get(*a);
+	for(std::vector<Address>::const_iterator a(upstreams.begin());a!=upstreams.end();++a) {
+		PeerShard &ps = _peerShard(*a);
+		AdaptiveMutex::Lock _l(ps.lock);
+		const SharedPtr<Peer> *p = ps.peers.get(*a);
 		if (p) {
 			const unsigned int q = (*p)->relayQuality(now);
 			if (q <= bestq) {
 				bestq = q;
-				best = p;
+				best = *p;
 			}
 		}
 	}
 
-	if (!best) {
-		return SharedPtr<Peer>();
+	{
+		Mutex::Lock _l(_bestUpstream_m);
+		_bestUpstreamRescore = now;
+		if ((_bestUpstream)&&(best)&&(_bestUpstream != best)) {
+			// Hysteresis: stick with the incumbent unless the challenger scores
+			// at least ~25% better, so roots with similar latency don't flap.
+			const unsigned int incumbentq = _bestUpstream->relayQuality(now);
+			if ((incumbentq != (~(unsigned int)0))&&(((uint64_t)bestq + ((uint64_t)bestq >> 2)) >= (uint64_t)incumbentq)) {
+				return _bestUpstream;
+			}
+		}
+		_bestUpstream = best;
 	}
-	return *best;
+	return best;
 }
 
 bool Topology::isUpstream(const Identity &id) const
@@ -232,7 +302,6 @@ bool Topology::addWorld(void *tPtr,const World &newWorld,bool alwaysAcceptNew)
 		return false;
 	}
 
-	Mutex::Lock _l2(_peers_m);
 	Mutex::Lock _l1(_upstreams_m);
 
 	World *existing = (World *)0;
@@ -328,7 +397,6 @@ void Topology::addMoon(void *tPtr,const uint64_t id,const Address &seed)
 
 void Topology::removeMoon(void *tPtr,const uint64_t id)
 {
-	Mutex::Lock _l2(_peers_m);
 	Mutex::Lock _l1(_upstreams_m);
 
 	std::vector<World> nm;
@@ -358,16 +426,53 @@ void Topology::removeMoon(void *tPtr,const uint64_t id)
 void Topology::doPeriodicTasks(void *tPtr,int64_t now)
 {
 	{
-		Mutex::Lock _l1(_peers_m);
-		Mutex::Lock _l2(_upstreams_m);
-		Hashtable< Address,SharedPtr<Peer> >::Iterator i(_peers);
-		Address *a = (Address *)0;
-		SharedPtr<Peer> *p = (SharedPtr<Peer> *)0;
-		while (i.next(a,p)) {
-			if ( (!(*p)->isAlive(now)) && (std::find(_upstreamAddresses.begin(),_upstreamAddresses.end(),*a) == _upstreamAddresses.end()) ) {
-				_savePeer(tPtr,*p);
-				_peers.erase(*a);
+		std::vector<Address> upstreams;
+		{
+			Mutex::Lock _l(_upstreams_m);
+			upstreams = _upstreamAddresses;
+		}
+		// Clean and re-save the shards in parallel. Shards are independently
+		// locked, so workers claiming distinct shards never contend with one
+		// another; the tick thread works alongside the pool so upkeep of a
+		// very large peer table spreads across cores instead of serializing
+		// behind a single full-table scan. The state put layer is safe to
+		// call concurrently (writes coalesce behind their own lock).
+		std::atomic<unsigned long> nextShard(0);
+		auto cleanShards = [this,tPtr,now,&upstreams,&nextShard]() {
+			for(;;) {
+				const unsigned long s = nextShard.fetch_add(1);
+				if (s >= ZT_TOPOLOGY_PEER_SHARDS) {
+					break;
+				}
+				AdaptiveMutex::Lock _l(_peerShards[s].lock);
+				FlatHashtable< Address,SharedPtr<Peer> >::Iterator i(_peerShards[s].peers);
+				Address *a = (Address *)0;
+				SharedPtr<Peer> *p = (SharedPtr<Peer> *)0;
+				while (i.next(a,p)) {
+					if ( (!(*p)->isAlive(now)) && (std::find(upstreams.begin(),upstreams.end(),*a) == upstreams.end()) ) {
+						_savePeer(tPtr,*p);
+						_peerShards[s].peers.erase(*a);
+					} else {
+						// Keep the on-disk cache fresh for peers we still talk to so
+						// an unclean shutdown doesn't lose their direct paths. The
+						// state put layer skips writes whose content is unchanged,
+						// so this is cheap when nothing has moved.
+						_savePeer(tPtr,*p);
+					}
+				}
 			}
+		};
+		unsigned int workers = std::thread::hardware_concurrency();
+		if (workers > (unsigned int)ZT_TOPOLOGY_PEER_SHARDS) {
+			workers = (unsigned int)ZT_TOPOLOGY_PEER_SHARDS;
+		}
+		std::vector<std::thread> pool;
+		for(unsigned int t=1;t<workers;++t) {
+			pool.push_back(std::thread(cleanShards));
+		}
+		cleanShards();
+		for(std::vector<std::thread>::iterator t(pool.begin());t!=pool.end();++t) {
+			t->join();
 		}
 	}
 
@@ -382,12 +487,21 @@ void Topology::doPeriodicTasks(void *tPtr,int64_t now)
 			}
 		}
 	}
+
+	{
+		uint64_t contended = 0;
+		for(unsigned long s=0;s<ZT_TOPOLOGY_PEER_SHARDS;++s) {
+			contended += _peerShards[s].lock.contendedAcquires();
+		}
+		Metrics::peer_table_lock_contended = (long)contended;
+	}
 }
 
 void Topology::_memoizeUpstreams(void *tPtr)
 {
-	// assumes _upstreams_m and _peers_m are locked
-	_upstreamAddresses.clear();
+	// assumes _upstreams_m is locked; peer shards are locked as entries are added
+	std::vector<Address> previousUpstreams;
+	previousUpstreams.swap(_upstreamAddresses);
 	_amUpstream = false;
 
 	for(std::vector<World::Root>::const_iterator i(_planet.roots().begin());i!=_planet.roots().end();++i) {
@@ -396,8 +510,12 @@ void Topology::_memoizeUpstreams(void *tPtr)
 			_amUpstream = true;
 		} else if (std::find(_upstreamAddresses.begin(),_upstreamAddresses.end(),id.address()) == _upstreamAddresses.end()) {
 			_upstreamAddresses.push_back(id.address());
-			SharedPtr<Peer> &hp = _peers[id.address()];
-			if (!hp) {
+			PeerShard &ps = _peerShard(id.address());
+			AdaptiveMutex::Lock _l(ps.lock);
+			SharedPtr<Peer> &hp = ps.peers[id.address()];
+			if ((!hp)||(hp->identity() != id)) {
+				// Only replace the peer if the root's identity actually changed;
+				// otherwise keep the existing peer and its established paths.
 				hp = new Peer(RR,RR->identity,id);
 			}
 		}
@@ -409,8 +527,10 @@ void Topology::_memoizeUpstreams(void *tPtr)
 				_amUpstream = true;
 			} else if (std::find(_upstreamAddresses.begin(),_upstreamAddresses.end(),i->identity.address()) == _upstreamAddresses.end()) {
 				_upstreamAddresses.push_back(i->identity.address());
-				SharedPtr<Peer> &hp = _peers[i->identity.address()];
-				if (!hp) {
+				PeerShard &ps = _peerShard(i->identity.address());
+				AdaptiveMutex::Lock _l(ps.lock);
+				SharedPtr<Peer> &hp = ps.peers[i->identity.address()];
+				if ((!hp)||(hp->identity() != i->identity)) {
 					hp = new Peer(RR,RR->identity,i->identity);
 				}
 			}
@@ -418,6 +538,30 @@ void Topology::_memoizeUpstreams(void *tPtr)
 	}
 
 	std::sort(_upstreamAddresses.begin(),_upstreamAddresses.end());
+
+	// Stagger first contact with upstreams that were just added by a world
+	// update so fleet-wide pushes don't re-handshake new roots in lockstep.
+	// At startup the previous set is empty and everything is contacted
+	// immediately as before.
+	if (!previousUpstreams.empty()) {
+		const int64_t now = RR->node->now();
+		for(std::vector<Address>::const_iterator a(_upstreamAddresses.begin());a!=_upstreamAddresses.end();++a) {
+			if (std::find(previousUpstreams.begin(),previousUpstreams.end(),*a) == previousUpstreams.end()) {
+				_upstreamContactHoldoff.set(*a,now + (int64_t)(RR->node->prng() % ZT_TOPOLOGY_UPSTREAM_CONTACT_STAGGER));
+			}
+		}
+	}
+	for(std::vector<Address>::const_iterator a(previousUpstreams.begin());a!=previousUpstreams.end();++a) {
+		if (std::find(_upstreamAddresses.begin(),_upstreamAddresses.end(),*a) == _upstreamAddresses.end()) {
+			_upstreamContactHoldoff.erase(*a);
+		}
+	}
+
+	// The upstream set changed, so any memoized best upstream may be stale
+	{
+		Mutex::Lock _l(_bestUpstream_m);
+		_bestUpstream.zero();
+	}
 }
 
 void Topology::_savePeer(void *tPtr,const SharedPtr<Peer> &peer)
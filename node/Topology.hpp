@@ -32,8 +32,37 @@
 #include "Mutex.hpp"
 #include "InetAddress.hpp"
 #include "Hashtable.hpp"
+#include "FlatHashtable.hpp"
 #include "World.hpp"
 
+/**
+ * Number of shards in the peer table (must be a power of two)
+ *
+ * Each shard has its own lock, so hot-path peer lookups contend only with
+ * other lookups of addresses in the same shard rather than with every
+ * packet on the node.
+ */
+#define ZT_TOPOLOGY_PEER_SHARDS 16
+
+/**
+ * Maximum number of entries in the verified identity fingerprint cache
+ */
+#define ZT_TOPOLOGY_VERIFIED_IDENTITY_CACHE_SIZE 4096
+
+/**
+ * How long a cached best upstream choice remains valid before rescoring (ms)
+ */
+#define ZT_TOPOLOGY_UPSTREAM_RESCORE_PERIOD 1000
+
+/**
+ * Maximum random delay before first contact with a newly added upstream (ms)
+ *
+ * When a world update adds roots, every node in a fleet learns about them at
+ * nearly the same time. Spreading the first HELLO over this window keeps the
+ * new roots from being hit by a synchronized connection storm.
+ */
+#define ZT_TOPOLOGY_UPSTREAM_CONTACT_STAGGER 30000
+
 namespace ZeroTier {
 
 class RuntimeEnvironment;
@@ -75,6 +104,49 @@ public:
 	 */
 	Identity getIdentity(void *tPtr,const Address &zta);
 
+	/**
+	 * Append an address's public identity in wire form to a WHOIS OK response
+	 *
+	 * During fleet-wide reconnects a root answers the same few thousand
+	 * identities millions of times, so this serves from the serialized blob
+	 * cached with each peer instead of re-serializing the Identity per query.
+	 *
+	 * @param tPtr Thread pointer to be handed through to any callbacks called as a result of this call
+	 * @param zta Queried ZeroTier address
+	 * @param b Response packet under construction
+	 * @return True if the identity was known and appended
+	 */
+	template<unsigned int C>
+	inline bool appendWhoisIdentity(void *tPtr,const Address &zta,Buffer<C> &b)
+	{
+		if (zta == RR->identity.address()) {
+			RR->identity.serialize(b,false);
+			return true;
+		}
+		PeerShard &ps = _peerShard(zta);
+		AdaptiveMutex::Lock _l(ps.lock);
+		const SharedPtr<Peer> *const ap = ps.peers.get(zta);
+		if (ap) {
+			b.append((*ap)->serializedIdentityForWhois(),ZT_PEER_WHOIS_IDENTITY_LENGTH);
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	 * Validate an identity, short-circuiting via a cache of known good ones
+	 *
+	 * Identity::locallyValidate() runs a memory-hard computation costing
+	 * multiple milliseconds, and reconnect storms present the same identities
+	 * over and over. Identities that have already passed are remembered by a
+	 * SHA-512 fingerprint of their serialized form so re-validation is just a
+	 * hash compare. The cache is bounded and flushed wholesale when full.
+	 *
+	 * @param id Identity to validate
+	 * @return True if identity is valid per Identity::locallyValidate()
+	 */
+	bool validateIdentity(const Identity &id);
+
 	/**
 	 * Get a peer only if it is presently in memory (no disk cache)
 	 *
@@ -87,8 +159,9 @@ public:
 	 */
 	inline SharedPtr<Peer> getPeerNoCache(const Address &zta)
 	{
-		Mutex::Lock _l(_peers_m);
-		const SharedPtr<Peer> *const ap = _peers.get(zta);
+		PeerShard &ps = _peerShard(zta);
+		AdaptiveMutex::Lock _l(ps.lock);
+		const SharedPtr<Peer> *const ap = ps.peers.get(zta);
 		if (ap) {
 			return *ap;
 		}
@@ -156,13 +229,18 @@ public:
 	/**
 	 * Gets upstreams to contact and their stable endpoints (if known)
 	 *
+	 * Upstreams added by a recent world update and still within their contact
+	 * stagger window are omitted so freshly published roots are approached
+	 * gradually across the fleet rather than all at once.
+	 *
 	 * @param eps Hash table to fill with addresses and their stable endpoints
+	 * @param now Current time
 	 */
-	inline void getUpstreamsToContact(Hashtable< Address,std::vector<InetAddress> > &eps) const
+	inline void getUpstreamsToContact(Hashtable< Address,std::vector<InetAddress> > &eps,const int64_t now) const
 	{
 		Mutex::Lock _l(_upstreams_m);
 		for(std::vector<World::Root>::const_iterator i(_planet.roots().begin());i!=_planet.roots().end();++i) {
-			if (i->identity != RR->identity) {
+			if ((i->identity != RR->identity)&&(!_upstreamContactHeldOff(i->identity.address(),now))) {
 				std::vector<InetAddress> &ips = eps[i->identity.address()];
 				for(std::vector<InetAddress>::const_iterator j(i->stableEndpoints.begin());j!=i->stableEndpoints.end();++j) {
 					if (std::find(ips.begin(),ips.end(),*j) == ips.end()) {
@@ -173,7 +251,7 @@ public:
 		}
 		for(std::vector<World>::const_iterator m(_moons.begin());m!=_moons.end();++m) {
 			for(std::vector<World::Root>::const_iterator i(m->roots().begin());i!=m->roots().end();++i) {
-				if (i->identity != RR->identity) {
+				if ((i->identity != RR->identity)&&(!_upstreamContactHeldOff(i->identity.address(),now))) {
 					std::vector<InetAddress> &ips = eps[i->identity.address()];
 					for(std::vector<InetAddress>::const_iterator j(i->stableEndpoints.begin());j!=i->stableEndpoints.end();++j) {
 						if (std::find(ips.begin(),ips.end(),*j) == ips.end()) {
@@ -287,14 +365,17 @@ public:
 	inline unsigned long countActive(int64_t now) const
 	{
 		unsigned long cnt = 0;
-		Mutex::Lock _l(_peers_m);
-		Hashtable< Address,SharedPtr<Peer> >::Iterator i(const_cast<Topology *>(this)->_peers);
-		Address *a = (Address *)0;
-		SharedPtr<Peer> *p = (SharedPtr<Peer> *)0;
-		while (i.next(a,p)) {
-			const SharedPtr<Path> pp((*p)->getAppropriatePath(now,false));
-			if (pp) {
-				++cnt;
+		for(unsigned long s=0;s<ZT_TOPOLOGY_PEER_SHARDS;++s) {
+			PeerShard &ps = const_cast<Topology *>(this)->_peerShards[s];
+			AdaptiveMutex::Lock _l(ps.lock);
+			FlatHashtable< Address,SharedPtr<Peer> >::Iterator i(ps.peers);
+			Address *a = (Address *)0;
+			SharedPtr<Peer> *p = (SharedPtr<Peer> *)0;
+			while (i.next(a,p)) {
+				const SharedPtr<Path> pp((*p)->getAppropriatePath(now,false));
+				if (pp) {
+					++cnt;
+				}
 			}
 		}
 		return cnt;
@@ -309,8 +390,36 @@ public:
 	template<typename F>
 	inline void eachPeer(F f)
 	{
-		Mutex::Lock _l(_peers_m);
-		Hashtable< Address,SharedPtr<Peer> >::Iterator i(_peers);
+		for(unsigned long s=0;s<ZT_TOPOLOGY_PEER_SHARDS;++s) {
+			PeerShard &ps = _peerShards[s];
+			AdaptiveMutex::Lock _l(ps.lock);
+			FlatHashtable< Address,SharedPtr<Peer> >::Iterator i(ps.peers);
+			Address *a = (Address *)0;
+			SharedPtr<Peer> *p = (SharedPtr<Peer> *)0;
+			while (i.next(a,p)) {
+				f(*this,*((const SharedPtr<Peer> *)p));
+			}
+		}
+	}
+
+	/**
+	 * Apply a function or function object to all peers in one shard of the peer table
+	 *
+	 * This lets periodic maintenance spread a full-table scan across several
+	 * timer ticks instead of stalling on one pass: call it with an
+	 * incrementing shard counter and every peer is visited once per
+	 * ZT_TOPOLOGY_PEER_SHARDS calls.
+	 *
+	 * @param f Function to apply
+	 * @param shard Shard counter (wrapped modulo the shard count internally)
+	 * @tparam F Function or function object type
+	 */
+	template<typename F>
+	inline void eachPeerInShard(F f,const unsigned long shard)
+	{
+		PeerShard &ps = _peerShards[shard & (ZT_TOPOLOGY_PEER_SHARDS - 1)];
+		AdaptiveMutex::Lock _l(ps.lock);
+		FlatHashtable< Address,SharedPtr<Peer> >::Iterator i(ps.peers);
 		Address *a = (Address *)0;
 		SharedPtr<Peer> *p = (SharedPtr<Peer> *)0;
 		while (i.next(a,p)) {
@@ -323,8 +432,14 @@ public:
 	 */
 	inline std::vector< std::pair< Address,SharedPtr<Peer> > > allPeers() const
 	{
-		Mutex::Lock _l(_peers_m);
-		return _peers.entries();
+		std::vector< std::pair< Address,SharedPtr<Peer> > > all;
+		for(unsigned long s=0;s<ZT_TOPOLOGY_PEER_SHARDS;++s) {
+			PeerShard &ps = const_cast<Topology *>(this)->_peerShards[s];
+			AdaptiveMutex::Lock _l(ps.lock);
+			const std::vector< std::pair< Address,SharedPtr<Peer> > > e(ps.peers.entries());
+			all.insert(all.end(),e.begin(),e.end());
+		}
+		return all;
 	}
 
 	/**
@@ -384,6 +499,51 @@ public:
 		return 0;
 	}
 
+	/**
+	 * Get the network-designated trusted path matching an outbound physical address
+	 *
+	 * Unlike local.conf trusted paths these are honored per peer, not
+	 * globally: the caller must verify that the destination peer is an
+	 * authorized member of the designating network (Network::gate()) before
+	 * sending in the clear with the returned ID.
+	 *
+	 * @param physicalAddress Physical address to which we are sending the packet
+	 * @param nwid Set to the designating network's ID on a match
+	 * @return Trusted path ID or 0 if no designation matches
+	 */
+	inline uint64_t getNetworkTrustedPath(const InetAddress &physicalAddress,uint64_t &nwid)
+	{
+		for(unsigned int i=0,j=_numNetworkTrustedPaths;i<j;++i) {
+			if (_networkTrustedPaths[i].network.containsAddress(physicalAddress)) {
+				nwid = _networkTrustedPaths[i].nwid;
+				return _networkTrustedPaths[i].trustedPathId;
+			}
+		}
+		return 0;
+	}
+
+	/**
+	 * Get the network that designated a trusted path matching an inbound packet
+	 *
+	 * As with getNetworkTrustedPath() the match alone does not authorize
+	 * anything: the caller must verify that the claimed source is an
+	 * authorized member of the returned network before treating the packet
+	 * as authenticated.
+	 *
+	 * @param physicalAddress Originating physical address
+	 * @param trustedPathId Trusted path ID from packet (from MAC field)
+	 * @return Designating network ID or 0 if no designation matches
+	 */
+	inline uint64_t networkTrustedPathNetworkId(const InetAddress &physicalAddress,const uint64_t trustedPathId)
+	{
+		for(unsigned int i=0,j=_numNetworkTrustedPaths;i<j;++i) {
+			if ((_networkTrustedPaths[i].trustedPathId == trustedPathId)&&(_networkTrustedPaths[i].network.containsAddress(physicalAddress))) {
+				return _networkTrustedPaths[i].nwid;
+			}
+		}
+		return 0;
+	}
+
 	/**
 	 * Check whether in incoming trusted path marked packet is valid
 	 *
@@ -400,6 +560,48 @@ public:
 		return false;
 	}
 
+	/**
+	 * Set the trusted physical path subnets designated by a network's controller
+	 *
+	 * Replaces any previous designations from the same network; a zero count
+	 * (as on network destroy) just removes them. Unlike local.conf trusted
+	 * paths these never apply globally: a designation is only honored for
+	 * packets to or from peers verified (Network::gate()) as authorized
+	 * members of the designating network, so a third-party controller cannot
+	 * disable transport security for unrelated traffic. Entries outside
+	 * private/shared IP scope are refused here as well as controller-side,
+	 * so a controller can never disable encryption toward globally routable
+	 * addresses.
+	 *
+	 * @param nwid Network that pushed these designations
+	 * @param networks Designated subnets (may be null if count is 0)
+	 * @param trustedPathIds Corresponding trusted path IDs (may be null if count is 0)
+	 * @param count Number of designations
+	 */
+	inline void setNetworkTrustedPaths(const uint64_t nwid,const InetAddress *networks,const uint64_t *trustedPathIds,const unsigned int count)
+	{
+		Mutex::Lock _l(_networkTrustedPaths_m);
+		unsigned int cnt = 0;
+		for(unsigned int i=0,j=_numNetworkTrustedPaths;i<j;++i) {
+			if (_networkTrustedPaths[i].nwid != nwid) {
+				if (cnt != i) {
+					_networkTrustedPaths[cnt] = _networkTrustedPaths[i];
+				}
+				++cnt;
+			}
+		}
+		for(unsigned int i=0;((i<count)&&(cnt<ZT_MAX_CONFIGURABLE_PATHS));++i) {
+			const InetAddress::IpScope sc = networks[i].ipScope();
+			if ( ((networks[i].ss_family == AF_INET)||(networks[i].ss_family == AF_INET6)) && (trustedPathIds[i] != 0) && ((sc == InetAddress::IP_SCOPE_PRIVATE)||(sc == InetAddress::IP_SCOPE_SHARED)) ) {
+				_networkTrustedPaths[cnt].nwid = nwid;
+				_networkTrustedPaths[cnt].trustedPathId = trustedPathIds[i];
+				_networkTrustedPaths[cnt].network = networks[i];
+				++cnt;
+			}
+		}
+		_numNetworkTrustedPaths = cnt;
+	}
+
 	/**
 	 * Set or clear physical path configuration (called via Node::setPhysicalPathConfiguration)
 	 */
@@ -444,21 +646,73 @@ private:
 	void _memoizeUpstreams(void *tPtr);
 	void _savePeer(void *tPtr,const SharedPtr<Peer> &peer);
 
+	// Check (and expire) the contact hold-off for a newly added upstream.
+	// Assumes _upstreams_m is locked.
+	inline bool _upstreamContactHeldOff(const Address &a,const int64_t now) const
+	{
+		const int64_t *const h = _upstreamContactHoldoff.get(a);
+		if (h) {
+			if (*h > now) {
+				return true;
+			}
+			_upstreamContactHoldoff.erase(a);
+		}
+		return false;
+	}
+
 	const RuntimeEnvironment *const RR;
 
 	std::pair<InetAddress,ZT_PhysicalPathConfiguration> _physicalPathConfig[ZT_MAX_CONFIGURABLE_PATHS];
 	volatile unsigned int _numConfiguredPhysicalPaths;
 
-	Hashtable< Address,SharedPtr<Peer> > _peers;
-	Mutex _peers_m;
+	// Trusted path designations pushed by network controllers, applied and
+	// cleared via setNetworkTrustedPaths(). Read unlocked on the per-packet
+	// path like _physicalPathConfig above; the mutex only serializes writers.
+	struct _NetworkTrustedPath
+	{
+		uint64_t nwid;
+		uint64_t trustedPathId;
+		InetAddress network;
+	};
+	_NetworkTrustedPath _networkTrustedPaths[ZT_MAX_CONFIGURABLE_PATHS];
+	volatile unsigned int _numNetworkTrustedPaths;
+	Mutex _networkTrustedPaths_m;
+
+	// The peer table is split into independently locked shards keyed on the
+	// low bits of the ZeroTier address (which are effectively random), so
+	// concurrent getPeer() calls on the hot path almost never contend.
+	struct PeerShard
+	{
+		PeerShard() : peers(ZT_TOPOLOGY_PEER_SHARD_INITIAL_CAPACITY) {}
+		FlatHashtable< Address,SharedPtr<Peer> > peers;
+		AdaptiveMutex lock;
+	};
+	PeerShard _peerShards[ZT_TOPOLOGY_PEER_SHARDS];
+	inline PeerShard &_peerShard(const Address &zta) { return _peerShards[(unsigned long)(zta.toInt() & (ZT_TOPOLOGY_PEER_SHARDS - 1))]; }
 
 	Hashtable< Path::HashKey,SharedPtr<Path> > _paths;
 	Mutex _paths_m;
 
+	// Fingerprints (two halves of a SHA-512) of identities that have passed
+	// locallyValidate(), so repeat verification is a hash compare.
+	Hashtable< uint64_t,uint64_t > _verifiedIdentities;
+	Mutex _verifiedIdentities_m;
+
+	// Memoized winner of upstream scoring, so the relay path does not walk
+	// and score every root per packet. Refreshed with hysteresis in
+	// getUpstreamPeer() and cleared when the upstream set changes.
+	SharedPtr<Peer> _bestUpstream;
+	int64_t _bestUpstreamRescore;
+	Mutex _bestUpstream_m;
+
 	World _planet;
 	std::vector<World> _moons;
 	std::vector< std::pair<uint64_t,Address> > _moonSeeds;
 	std::vector<Address> _upstreamAddresses;
+	// Earliest permitted first-contact time for upstreams added by a world
+	// update, keyed by address; mutable so the const contact-list getter can
+	// expire entries. Guarded by _upstreams_m.
+	mutable Hashtable< Address,int64_t > _upstreamContactHoldoff;
 	bool _amUpstream;
 	Mutex _upstreams_m; // locks worlds, upstream info, moon info, etc.
 };
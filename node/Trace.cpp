@@ -587,10 +587,53 @@ void Trace::updateMemoizedSettings()
 	}
 }
 
+void Trace::flushTraceBuffers(void *const tPtr,const int64_t now)
+{
+	std::vector< std::pair<Address,std::string> > due;
+	{
+		Mutex::Lock l(_batches_m);
+		Hashtable< Address,_TraceBatch >::Iterator i(_batches);
+		Address *a = (Address *)0;
+		_TraceBatch *b = (_TraceBatch *)0;
+		while (i.next(a,b)) {
+			if ((!b->buf.empty())&&((now - b->firstEventTime) >= ZT_TRACE_BATCH_FLUSH_INTERVAL)) {
+				due.push_back(std::pair<Address,std::string>(*a,std::string()));
+				due.back().second.swap(b->buf);
+			}
+		}
+	}
+	for(std::vector< std::pair<Address,std::string> >::const_iterator s(due.begin());s!=due.end();++s) {
+		_sendNow(tPtr,s->second,s->first);
+	}
+}
+
 void Trace::_send(void *const tPtr,const Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> &d,const Address &dest)
+{
+	const unsigned int len = (unsigned int)strlen(d.data()) + 1; // include terminating null, which delimits events in a batch
+	std::string toSend;
+	{
+		Mutex::Lock l(_batches_m);
+		_TraceBatch &b = _batches[dest];
+		if ((b.buf.length() + len) > ZT_TRACE_BATCH_MAX_BUFFERED) {
+			return; // overloaded; remote trace is best effort, so shed rather than amplify
+		}
+		if ((!b.buf.empty())&&((b.buf.length() + len) >= ZT_TRACE_BATCH_FLUSH_SIZE)) {
+			toSend.swap(b.buf);
+		}
+		if (b.buf.empty()) {
+			b.firstEventTime = RR->node->now();
+		}
+		b.buf.append(d.data(),len);
+	}
+	if (!toSend.empty()) {
+		_sendNow(tPtr,toSend,dest);
+	}
+}
+
+void Trace::_sendNow(void *const tPtr,const std::string &batch,const Address &dest)
 {
 	Packet outp(dest,RR->identity.address(),Packet::VERB_REMOTE_TRACE);
-	outp.appendCString(d.data());
+	outp.append(batch.data(),(unsigned int)batch.length());
 	outp.compress();
 	RR->sw->send(tPtr,outp,true);
 }
@@ -30,6 +30,28 @@
 #include "Mutex.hpp"
 #include "Hashtable.hpp"
 
+#include <string>
+#include <utility>
+
+/**
+ * Flush a remote trace batch once it has accumulated this many bytes
+ */
+#define ZT_TRACE_BATCH_FLUSH_SIZE 4096
+
+/**
+ * Maximum bytes buffered per trace destination; further events are dropped
+ *
+ * This bounds how much tracing can cost during an event storm. Remote trace
+ * delivery is best effort (unacknowledged) anyway, so dropping under
+ * overload is preferable to amplifying the incident being traced.
+ */
+#define ZT_TRACE_BATCH_MAX_BUFFERED 16384
+
+/**
+ * Flush partially filled trace batches after this long (ms)
+ */
+#define ZT_TRACE_BATCH_FLUSH_INTERVAL 1000
+
 namespace ZeroTier {
 
 class RuntimeEnvironment;
@@ -101,7 +123,8 @@ public:
 
 	Trace(const RuntimeEnvironment *renv) :
 		RR(renv),
-		_byNet(8)
+		_byNet(8),
+		_batches(8)
 	{
 	}
 
@@ -149,16 +172,41 @@ public:
 
 	void updateMemoizedSettings();
 
+	/**
+	 * Send any buffered remote trace batches that are due
+	 *
+	 * Called from the core's periodic background tasks. Batches are also
+	 * flushed inline when they fill, so this only handles stragglers.
+	 *
+	 * @param tPtr Thread pointer to be handed through to any callbacks
+	 * @param now Current time
+	 */
+	void flushTraceBuffers(void *const tPtr,const int64_t now);
+
 private:
 	const RuntimeEnvironment *const RR;
 
 	void _send(void *const tPtr,const Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> &d,const Address &dest);
+	void _sendNow(void *const tPtr,const std::string &batch,const Address &dest);
 	void _spamToAllNetworks(void *const tPtr,const Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> &d,const Level level);
 
 	Address _globalTarget;
 	Trace::Level _globalLevel;
 	Hashtable< uint64_t,std::pair< Address,Trace::Level > > _byNet;
 	Mutex _byNet_m;
+
+	// Per-destination batches of serialized (null-terminated) trace
+	// dictionaries awaiting transmission. The REMOTE_TRACE payload format
+	// has always been a sequence of such strings, so receivers need no
+	// changes to accept batched packets.
+	struct _TraceBatch
+	{
+		_TraceBatch() : firstEventTime(0) {}
+		std::string buf;
+		int64_t firstEventTime;
+	};
+	Hashtable< Address,_TraceBatch > _batches;
+	Mutex _batches_m;
 };
 
 } // namespace ZeroTier
@@ -177,6 +177,7 @@ Utils::CPUIDRegisters::CPUIDRegisters() noexcept
 	vpclmulqdq = aes && avx && ((ecx & (1U << 10U)) != 0);
 	avx2 = avx && ((ebx & (1U << 5U)) != 0);
 	avx512f = avx && ((ebx & (1U << 16U)) != 0);
+	bmi2 = ((ebx & (1U << 3U)) != 0) && ((ebx & (1U << 8U)) != 0);
 	sha = ((ebx & (1U << 29U)) != 0);
 	fsrm = ((edx & (1U << 4U)) != 0);
 }
@@ -218,7 +219,7 @@ char *Utils::decimal(unsigned long n,char s[24])
 	return s;
 }
 
-void Utils::getSecureRandom(void *buf,unsigned int bytes)
+static void _getSecureRandomGlobal(void *buf,unsigned int bytes)
 {
 	static Mutex globalLock;
 	static Salsa20 s20;
@@ -306,4 +307,37 @@ void Utils::getSecureRandom(void *buf,unsigned int bytes)
 #endif // __WINDOWS__ or not
 }
 
+void Utils::getSecureRandom(void *buf,unsigned int bytes)
+{
+	/* Every outbound Packet draws eight IV bytes from here, so with the
+	 * global source alone its lock serializes packet construction across
+	 * RX workers, tap readers, and bond monitor threads. Each thread
+	 * instead refills a small pool from the locked global source and then
+	 * draws from it lock-free. The pool holds future random bytes in
+	 * thread-local storage, which is no more exposure than the global
+	 * source's own static buffer of them. */
+	static thread_local uint8_t tlPool[4096];
+	static thread_local unsigned int tlPtr = sizeof(tlPool);
+
+	if (bytes >= sizeof(tlPool)) { // large requests (e.g. key generation) go straight to the source
+		_getSecureRandomGlobal(buf,bytes);
+		return;
+	}
+
+	uint8_t *out = reinterpret_cast<uint8_t *>(buf);
+	while (bytes > 0) {
+		if (tlPtr >= sizeof(tlPool)) {
+			_getSecureRandomGlobal(tlPool,sizeof(tlPool));
+			tlPtr = 0;
+		}
+		unsigned int n = (unsigned int)sizeof(tlPool) - tlPtr;
+		if (n > bytes)
+			n = bytes;
+		memcpy(out,tlPool + tlPtr,n);
+		tlPtr += n;
+		out += n;
+		bytes -= n;
+	}
+}
+
 } // namespace ZeroTier
@@ -88,6 +88,7 @@ public:
 		bool vpclmulqdq; // implies AVX
 		bool avx2;
 		bool avx512f;
+		bool bmi2; // implies BMI1
 		bool sha;
 		bool fsrm;
 	};
@@ -321,7 +322,9 @@ public:
 	 * Generate secure random bytes
 	 *
 	 * This will try to use whatever OS sources of entropy are available. It's
-	 * guarded by an internal mutex so it's thread-safe.
+	 * thread-safe, and small requests (packet IVs etc.) are served from a
+	 * lock-free per-thread pool so concurrent packet construction does not
+	 * serialize on a global lock.
 	 *
 	 * @param buf Buffer to fill
 	 * @param bytes Number of random bytes to generate
@@ -20,10 +20,13 @@ CORE_OBJS=\
 	node/Path.o \
 	node/Peer.o \
 	node/Poly1305.o \
+	node/Poly1305_avx2.o \
 	node/Revocation.o \
 	node/Salsa20.o \
+	node/Salsa20_avx2.o \
 	node/SelfAwareness.o \
 	node/SHA512.o \
+	node/SHA512_bmi2.o \
 	node/Switch.o \
 	node/Tag.o \
 	node/Topology.o \
@@ -69,6 +69,8 @@
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <vector>
+#include <thread>
 
 #include "version.h"
 #include "include/ZeroTierOne.h"
@@ -132,13 +134,14 @@ static void cliPrintHelp(const char *pn,FILE *out)
 	fprintf(out,"  -D<path>                - ZeroTier home path for parameter auto-detect" ZT_EOL_S);
 	fprintf(out,"  -p<port>                - HTTP port (default: auto)" ZT_EOL_S);
 	fprintf(out,"  -T<token>               - Authentication token (default: auto)" ZT_EOL_S);
+	fprintf(out,"  --parallel              - Issue batch requests concurrently" ZT_EOL_S);
 	fprintf(out,ZT_EOL_S"Available commands:" ZT_EOL_S);
 	fprintf(out,"  info                    - Display status info" ZT_EOL_S);
 	fprintf(out,"  listpeers               - List all peers" ZT_EOL_S);
 	fprintf(out,"  peers                   - List all peers (prettier)" ZT_EOL_S);
 	fprintf(out,"  listnetworks            - List all networks" ZT_EOL_S);
-	fprintf(out,"  join <network ID>          - Join a network" ZT_EOL_S);
-	fprintf(out,"  leave <network ID>         - Leave a network" ZT_EOL_S);
+	fprintf(out,"  join <network ID> [...]    - Join one or more networks" ZT_EOL_S);
+	fprintf(out,"  leave <network ID> [...]   - Leave one or more networks" ZT_EOL_S);
 	fprintf(out,"  set <network ID> <setting> - Set a network setting" ZT_EOL_S);
 	fprintf(out,"  get <network ID> <setting> - Get a network setting" ZT_EOL_S);
 	fprintf(out,"  listmoons               - List moons (federated root sets)" ZT_EOL_S);
@@ -172,10 +175,16 @@ static int cli(int argc,char **argv)
 {
 	unsigned int port = 0;
 	std::string homeDir,command,arg1,arg2,authToken;
+	std::vector<std::string> posArgs; // all positional arguments including the command
 	std::string ip("127.0.0.1");
 	bool json = false;
+	bool parallel = false;
 	for(int i=1;i<argc;++i) {
 		if (argv[i][0] == '-') {
+			if (!strcmp(argv[i],"--parallel")) {
+				parallel = true;
+				continue;
+			}
 			switch(argv[i][1]) {
 
 				case 'q': // ignore -q used to invoke this personality
@@ -243,6 +252,7 @@ static int cli(int argc,char **argv)
 					return 0;
 			}
 		} else {
+			posArgs.push_back(argv[i]);
 			if (arg1.length())
 				arg2 = argv[i];
 			else if (command.length())
@@ -807,58 +817,81 @@ static int cli(int argc,char **argv)
 			printf("%u %s %s" ZT_EOL_S,scode,command.c_str(),responseBody.c_str());
 			return 1;
 		}
-	} else if (command == "join") {
-		if (arg1.length() != 16) {
+	} else if ((command == "join")||(command == "leave")) {
+		// One or more network IDs may be given. Sequential requests reuse a
+		// single kept-alive control plane connection; --parallel issues them
+		// from concurrent threads instead.
+		const std::vector<std::string> nwids(posArgs.begin() + 1,posArgs.end());
+		if (nwids.empty()) {
 			printf("invalid network id" ZT_EOL_S);
 			return 2;
 		}
-		requestHeaders["Content-Type"] = "application/json";
-		requestHeaders["Content-Length"] = "2";
-		unsigned int scode = Http::POST(
-			1024 * 1024 * 16,
-			60000,
-			(const struct sockaddr *)&addr,
-			(std::string("/network/") + arg1).c_str(),
-			requestHeaders,
-			"{}",
-			2,
-			responseHeaders,
-			responseBody);
-		if (scode == 200) {
-			if (json) {
-				printf("%s",cliFixJsonCRs(responseBody).c_str());
+		for(std::vector<std::string>::const_iterator n(nwids.begin());n!=nwids.end();++n) {
+			if (n->length() != 16) {
+				printf("invalid network id" ZT_EOL_S);
+				return 2;
+			}
+		}
+
+		std::vector<unsigned int> scodes(nwids.size(),0);
+		std::vector<std::string> bodies(nwids.size());
+		const bool join = (command == "join");
+		auto doOne = [&](unsigned long k) {
+			std::map<std::string,std::string> rqh(requestHeaders),rsh;
+			if (join) {
+				rqh["Content-Type"] = "application/json";
+				rqh["Content-Length"] = "2";
+				scodes[k] = Http::POST(
+					1024 * 1024 * 16,
+					60000,
+					(const struct sockaddr *)&addr,
+					(std::string("/network/") + nwids[k]).c_str(),
+					rqh,
+					"{}",
+					2,
+					rsh,
+					bodies[k]);
 			} else {
-				printf("200 join OK" ZT_EOL_S);
+				scodes[k] = Http::DEL(
+					1024 * 1024 * 16,
+					60000,
+					(const struct sockaddr *)&addr,
+					(std::string("/network/") + nwids[k]).c_str(),
+					rqh,
+					rsh,
+					bodies[k]);
 			}
-			return 0;
+		};
+
+		if ((parallel)&&(nwids.size() > 1)) {
+			std::vector<std::thread> workers;
+			for(unsigned long k=0;k<nwids.size();++k)
+				workers.push_back(std::thread(doOne,k));
+			for(std::vector<std::thread>::iterator w(workers.begin());w!=workers.end();++w)
+				w->join();
 		} else {
-			printf("%u %s %s" ZT_EOL_S,scode,command.c_str(),responseBody.c_str());
-			return 1;
-		}
-	} else if (command == "leave") {
-		if (arg1.length() != 16) {
-			printf("invalid network id" ZT_EOL_S);
-			return 2;
+			for(unsigned long k=0;k<nwids.size();++k)
+				doOne(k);
 		}
-		unsigned int scode = Http::DEL(
-			1024 * 1024 * 16,
-			60000,
-			(const struct sockaddr *)&addr,
-			(std::string("/network/") + arg1).c_str(),
-			requestHeaders,
-			responseHeaders,
-			responseBody);
-		if (scode == 200) {
-			if (json) {
-				printf("%s",cliFixJsonCRs(responseBody).c_str());
+
+		int ec = 0;
+		for(unsigned long k=0;k<nwids.size();++k) {
+			if (scodes[k] == 200) {
+				if (json) {
+					printf("%s",cliFixJsonCRs(bodies[k]).c_str());
+				} else if (nwids.size() > 1) {
+					printf("200 %s %s OK" ZT_EOL_S,command.c_str(),nwids[k].c_str());
+				} else {
+					printf("200 %s OK" ZT_EOL_S,command.c_str());
+				}
 			} else {
-				printf("200 leave OK" ZT_EOL_S);
+				if (nwids.size() > 1)
+					printf("%u %s %s %s" ZT_EOL_S,scodes[k],command.c_str(),nwids[k].c_str(),bodies[k].c_str());
+				else printf("%u %s %s" ZT_EOL_S,scodes[k],command.c_str(),bodies[k].c_str());
+				ec = 1;
 			}
-			return 0;
-		} else {
-			printf("%u %s %s" ZT_EOL_S,scode,command.c_str(),responseBody.c_str());
-			return 1;
 		}
+		return ec;
 	} else if (command == "listmoons") {
 		const unsigned int scode = Http::GET(1024 * 1024 * 16,60000,(const struct sockaddr *)&addr,"/moon",requestHeaders,responseHeaders,responseBody);
 
@@ -1447,7 +1480,7 @@ static int idtool(int argc,char **argv)
 
 		Identity id;
 		for(;;) {
-			id.generate();
+			id.generate(0); // use all hardware cores for the hashcash search
 			if ((id.address().toInt() >> (40 - vanityBits)) == vanity) {
 				if (vanityBits > 0) {
 					fprintf(stderr,"vanity address: found %.10llx !\n",(unsigned long long)id.address().toInt());
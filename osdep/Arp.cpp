@@ -24,23 +24,45 @@ static const uint8_t ARP_REQUEST_HEADER[8] = { 0x00,0x01,0x08,0x00,0x06,0x04,0x0
 static const uint8_t ARP_RESPONSE_HEADER[8] = { 0x00,0x01,0x08,0x00,0x06,0x04,0x00,0x02 };
 
 Arp::Arp() :
-	_cache(256),
-	_lastCleaned(OSUtils::now())
+	_cache(std::make_shared<_ArpTable>(256))
 {
 }
 
+std::shared_ptr<Arp::_ArpTable> Arp::_cloneAndEvict(uint64_t now) const
+{
+	const std::shared_ptr<_ArpTable> cur(std::atomic_load(&_cache));
+	std::shared_ptr<_ArpTable> next(std::make_shared<_ArpTable>(256));
+	_ArpTable::Iterator i(*cur);
+	uint32_t *k = (uint32_t *)0;
+	_ArpEntry *v = (_ArpEntry *)0;
+	while (i.next(k,v)) {
+		// Keep local entries, entries with a live response, and entries with a query still in flight
+		if ( (v->local) ||
+		     ((now - v->lastResponseReceived) < ZT_ARP_EXPIRE) ||
+		     ((now - v->lastQuerySent) <= ZT_ARP_QUERY_MAX_TTL) )
+			(*next)[*k] = *v;
+	}
+	return next;
+}
+
 void Arp::addLocal(uint32_t ip,const MAC &mac)
 {
-	_ArpEntry &e = _cache[ip];
+	Mutex::Lock l(_writeLock);
+	std::shared_ptr<_ArpTable> next(_cloneAndEvict(OSUtils::now()));
+	_ArpEntry &e = (*next)[ip];
 	e.lastQuerySent = 0; // local IP
 	e.lastResponseReceived = 0; // local IP
 	e.mac = mac;
 	e.local = true;
+	std::atomic_store(&_cache,next);
 }
 
 void Arp::remove(uint32_t ip)
 {
-	_cache.erase(ip);
+	Mutex::Lock l(_writeLock);
+	std::shared_ptr<_ArpTable> next(_cloneAndEvict(OSUtils::now()));
+	next->erase(ip);
+	std::atomic_store(&_cache,next);
 }
 
 uint32_t Arp::processIncomingArp(const void *arp,unsigned int len,void *response,unsigned int &responseLen,MAC &responseDest)
@@ -53,8 +75,10 @@ uint32_t Arp::processIncomingArp(const void *arp,unsigned int len,void *response
 
 	if (len >= 28) {
 		if (!memcmp(arp,ARP_REQUEST_HEADER,8)) {
-			// Respond to ARP requests for locally-known IPs
-			_ArpEntry *targetEntry = _cache.get(reinterpret_cast<const uint32_t *>(arp)[6]);
+			// Respond to ARP requests for locally-known IPs -- this is the
+			// per-frame hot path on bridges and reads the snapshot lock-free
+			const std::shared_ptr<_ArpTable> cache(std::atomic_load(&_cache));
+			const _ArpEntry *targetEntry = cache->get(reinterpret_cast<const uint32_t *>(arp)[6]);
 			if ((targetEntry)&&(targetEntry->local)) {
 				memcpy(response,ARP_RESPONSE_HEADER,8);
 				targetEntry->mac.copyTo(reinterpret_cast<uint8_t *>(response) + 8,6);
@@ -64,26 +88,29 @@ uint32_t Arp::processIncomingArp(const void *arp,unsigned int len,void *response
 				responseDest.setTo(reinterpret_cast<const uint8_t *>(arp) + 8,6);
 			}
 		} else if (!memcmp(arp,ARP_RESPONSE_HEADER,8)) {
-			// Learn cache entries for remote IPs from relevant ARP replies
 			uint32_t responseIp = 0;
 			memcpy(&responseIp,reinterpret_cast<const uint8_t *>(arp) + 14,4);
-			_ArpEntry *queryEntry = _cache.get(responseIp);
+
+			// Check the snapshot first so irrelevant, unsolicited, or stale
+			// responses are discarded without ever taking the write lock
+			{
+				const std::shared_ptr<_ArpTable> cache(std::atomic_load(&_cache));
+				const _ArpEntry *queryEntry = cache->get(responseIp);
+				if ((!queryEntry)||(queryEntry->local)||((now - queryEntry->lastQuerySent) > ZT_ARP_QUERY_MAX_TTL))
+					return 0;
+			}
+
+			// Learn cache entries for remote IPs from relevant ARP replies;
+			// expired entries are evicted as part of the same rebuild
+			Mutex::Lock l(_writeLock);
+			std::shared_ptr<_ArpTable> next(_cloneAndEvict(now));
+			_ArpEntry *queryEntry = next->get(responseIp);
 			if ((queryEntry)&&(!queryEntry->local)&&((now - queryEntry->lastQuerySent) <= ZT_ARP_QUERY_MAX_TTL)) {
 				queryEntry->lastResponseReceived = now;
 				queryEntry->mac.setTo(reinterpret_cast<const uint8_t *>(arp) + 8,6);
 				ip = responseIp;
 			}
-		}
-	}
-
-	if ((now - _lastCleaned) >= ZT_ARP_EXPIRE) {
-		_lastCleaned = now;
-		Hashtable< uint32_t,_ArpEntry >::Iterator i(_cache);
-		uint32_t *k = (uint32_t *)0;
-		_ArpEntry *v = (_ArpEntry *)0;
-		while (i.next(k,v)) {
-			if ((!v->local)&&((now - v->lastResponseReceived) >= ZT_ARP_EXPIRE))
-				_cache.erase(*k);
+			std::atomic_store(&_cache,next);
 		}
 	}
 
@@ -94,7 +121,25 @@ MAC Arp::query(const MAC &localMac,uint32_t localIp,uint32_t targetIp,void *quer
 {
 	const uint64_t now = OSUtils::now();
 
-	_ArpEntry &e = _cache[targetIp];
+	// Lock-free fast path: local entries and entries not yet due for a query or refresh
+	{
+		const std::shared_ptr<_ArpTable> cache(std::atomic_load(&_cache));
+		const _ArpEntry *e = cache->get(targetIp);
+		if (e) {
+			if ( (e->local) ||
+			     (!( ((e->mac)&&((now - e->lastResponseReceived) >= (ZT_ARP_EXPIRE / 3))) ||
+			         ((!e->mac)&&((now - e->lastQuerySent) >= ZT_ARP_QUERY_INTERVAL)) )) ) {
+				queryLen = 0;
+				queryDest.zero();
+				return e->mac;
+			}
+		}
+	}
+
+	Mutex::Lock l(_writeLock);
+	std::shared_ptr<_ArpTable> next(_cloneAndEvict(now));
+	_ArpEntry &e = (*next)[targetIp];
+	const MAC mac(e.mac);
 
 	if ( ((e.mac)&&((now - e.lastResponseReceived) >= (ZT_ARP_EXPIRE / 3))) ||
 	     ((!e.mac)&&((now - e.lastQuerySent) >= ZT_ARP_QUERY_INTERVAL)) ) {
@@ -115,7 +160,8 @@ MAC Arp::query(const MAC &localMac,uint32_t localIp,uint32_t targetIp,void *quer
 		queryDest.zero();
 	}
 
-	return e.mac;
+	std::atomic_store(&_cache,next);
+	return mac;
 }
 
 } // namespace ZeroTier
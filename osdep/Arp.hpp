@@ -17,10 +17,13 @@
 #include <stdint.h>
 
 #include <utility>
+#include <memory>
+#include <atomic>
 
 #include "../node/Constants.hpp"
 #include "../node/Hashtable.hpp"
 #include "../node/MAC.hpp"
+#include "../node/Mutex.hpp"
 
 /**
  * Maximum possible ARP length
@@ -64,8 +67,12 @@ namespace ZeroTier {
  * a query at any time, so their result parameters for sending ARPs should
  * always be checked.
  *
- * This class is not thread-safe and must be guarded if used in multi-threaded
- * code.
+ * This class is thread-safe. Lookups (the per-frame hot path) read an
+ * immutable atomically-published snapshot of the cache and take no lock.
+ * Mutations (learning from responses, generating queries, local entry
+ * changes) clone the snapshot under an internal lock and publish the
+ * replacement; expired entries are evicted during these response-driven
+ * rebuilds instead of by periodic sweeps.
  */
 class Arp
 {
@@ -134,8 +141,13 @@ private:
 		bool local; // True if this is a local ARP entry
 	};
 
-	Hashtable< uint32_t,_ArpEntry > _cache;
-	uint64_t _lastCleaned;
+	typedef Hashtable< uint32_t,_ArpEntry > _ArpTable;
+
+	// Clone the current snapshot, dropping expired non-local entries (caller must hold _writeLock)
+	std::shared_ptr<_ArpTable> _cloneAndEvict(uint64_t now) const;
+
+	std::shared_ptr<_ArpTable> _cache; // read via std::atomic_load, replaced whole under _writeLock
+	Mutex _writeLock;
 };
 
 } // namespace ZeroTier
@@ -31,6 +31,8 @@
 #include <sys/param.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/event.h>
+#include <sys/time.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <net/if.h>
@@ -59,6 +61,83 @@ static const ZeroTier::MulticastGroup _blindWildcardMulticastGroup(ZeroTier::MAC
 
 namespace ZeroTier {
 
+/**
+ * Shared kqueue poller servicing every tap fd with one thread
+ *
+ * Each tap used to run its own blocking-read thread, so a gateway joined to
+ * N networks burned N threads doing single-frame reads. All taps register
+ * their fds here instead and one thread dispatches readable events, cutting
+ * per-frame context switches on multi-network nodes.
+ */
+class _BSDTapPoller
+{
+public:
+	static _BSDTapPoller *instance()
+	{
+		// Created on first tap and lives for the rest of the process.
+		static _BSDTapPoller poller;
+		return &poller;
+	}
+
+	void registerTap(BSDEthernetTap *tap,int fd)
+	{
+		Mutex::Lock _l(_taps_m);
+		struct kevent ev;
+		EV_SET(&ev,fd,EVFILT_READ,EV_ADD,0,0,(void *)tap);
+		::kevent(_kq,&ev,1,(struct kevent *)0,0,(const struct timespec *)0);
+		_taps.insert(tap);
+	}
+
+	void unregisterTap(BSDEthernetTap *tap,int fd)
+	{
+		// Taking _taps_m after EV_DELETE guarantees the poller thread is not
+		// dispatching into this tap when its destructor proceeds, and the
+		// membership check below keeps already-fetched events from reaching
+		// a dead tap.
+		Mutex::Lock _l(_taps_m);
+		struct kevent ev;
+		EV_SET(&ev,fd,EVFILT_READ,EV_DELETE,0,0,(void *)0);
+		::kevent(_kq,&ev,1,(struct kevent *)0,0,(const struct timespec *)0);
+		_taps.erase(tap);
+	}
+
+	void threadMain()
+		throw()
+	{
+		// Wait for a moment after startup -- wait for Network to finish
+		// constructing itself.
+		Thread::sleep(500);
+
+		struct kevent evs[16];
+		for(;;) {
+			const int n = ::kevent(_kq,(const struct kevent *)0,0,evs,16,(const struct timespec *)0);
+			if (n < 0) {
+				if ((errno == EINTR)||(errno == EAGAIN))
+					continue;
+				break;
+			}
+			Mutex::Lock _l(_taps_m);
+			for(int i=0;i<n;++i) {
+				BSDEthernetTap *const tap = (BSDEthernetTap *)evs[i].udata;
+				if (_taps.count(tap) != 0)
+					tap->readEvent();
+			}
+		}
+	}
+
+private:
+	_BSDTapPoller() :
+		_kq(::kqueue())
+	{
+		_thread = Thread::start(this);
+	}
+
+	int _kq;
+	Thread _thread;
+	std::set<BSDEthernetTap *> _taps;
+	Mutex _taps_m;
+};
+
 BSDEthernetTap::BSDEthernetTap(
 	const char *homePath,
 	const MAC &mac,
@@ -74,6 +153,7 @@ BSDEthernetTap::BSDEthernetTap(
 	_mtu(mtu),
 	_metric(metric),
 	_fd(0),
+	_rxFill(0),
 	_enabled(true),
 	_lastIfAddrsUpdate(0)
 {
@@ -159,7 +239,8 @@ BSDEthernetTap::BSDEthernetTap(
 	if (_fd <= 0)
 		throw std::runtime_error("unable to open TAP device or no more devices available");
 
-	if (fcntl(_fd,F_SETFL,fcntl(_fd,F_GETFL) & ~O_NONBLOCK) == -1) {
+	// Non-blocking so the shared poller can drain a burst of frames per wakeup
+	if (fcntl(_fd,F_SETFL,fcntl(_fd,F_GETFL) | O_NONBLOCK) == -1) {
 		::close(_fd);
 		throw std::runtime_error("unable to set flags on file descriptor for TAP device");
 	}
@@ -187,18 +268,13 @@ BSDEthernetTap::BSDEthernetTap(
 	// Set close-on-exec so that devices cannot persist if we fork/exec for update
 	fcntl(_fd,F_SETFD,fcntl(_fd,F_GETFD) | FD_CLOEXEC);
 
-	::pipe(_shutdownSignalPipe);
-
-	_thread = Thread::start(this);
+	_BSDTapPoller::instance()->registerTap(this,_fd);
 }
 
 BSDEthernetTap::~BSDEthernetTap()
 {
-	::write(_shutdownSignalPipe[1],"\0",1); // causes thread to exit
-	Thread::join(_thread);
+	_BSDTapPoller::instance()->unregisterTap(this,_fd);
 	::close(_fd);
-	::close(_shutdownSignalPipe[0]);
-	::close(_shutdownSignalPipe[1]);
 
 	long cpid = (long)vfork();
 	if (cpid == 0) {
@@ -415,55 +491,33 @@ void BSDEthernetTap::setMtu(unsigned int mtu)
 	}
 }
 
-void BSDEthernetTap::threadMain()
+void BSDEthernetTap::readEvent()
 	throw()
 {
-	fd_set readfds,nullfds;
+	// The fd is non-blocking, so one wakeup drains the whole burst: keep
+	// reading until EAGAIN and the poller will call again when readable.
 	MAC to,from;
-	int n,nfds,r;
-	char getBuf[ZT_MAX_MTU + 64];
-
-	// Wait for a moment after startup -- wait for Network to finish
-	// constructing itself.
-	Thread::sleep(500);
-
-	FD_ZERO(&readfds);
-	FD_ZERO(&nullfds);
-	nfds = (int)std::max(_shutdownSignalPipe[0],_fd) + 1;
-
-	r = 0;
 	for(;;) {
-		FD_SET(_shutdownSignalPipe[0],&readfds);
-		FD_SET(_fd,&readfds);
-		select(nfds,&readfds,&nullfds,&nullfds,(struct timeval *)0);
-
-		if (FD_ISSET(_shutdownSignalPipe[0],&readfds)) // writes to shutdown pipe terminate thread
+		const int n = (int)::read(_fd,_rxBuf + _rxFill,sizeof(_rxBuf) - _rxFill);
+		if (n <= 0)
 			break;
 
-		if (FD_ISSET(_fd,&readfds)) {
-			n = (int)::read(_fd,getBuf + r,sizeof(getBuf) - r);
-			if (n < 0) {
-				if ((errno != EINTR)&&(errno != ETIMEDOUT))
-					break;
-			} else {
-				// Some tap drivers like to send the ethernet frame and the
-				// payload in two chunks, so handle that by accumulating
-				// data until we have at least a frame.
-				r += n;
-				if (r > 14) {
-					if (r > ((int)_mtu + 14)) // sanity check for weird TAP behavior on some platforms
-						r = _mtu + 14;
-
-					if (_enabled) {
-						to.setTo(getBuf,6);
-						from.setTo(getBuf + 6,6);
-						unsigned int etherType = ntohs(((const uint16_t *)getBuf)[6]);
-						_handler(_arg,(void *)0,_nwid,from,to,etherType,0,(const void *)(getBuf + 14),r - 14);
-					}
-
-					r = 0;
-				}
+		// Some tap drivers like to send the ethernet frame and the
+		// payload in two chunks, so handle that by accumulating
+		// data until we have at least a frame.
+		_rxFill += n;
+		if (_rxFill > 14) {
+			if (_rxFill > ((int)_mtu + 14)) // sanity check for weird TAP behavior on some platforms
+				_rxFill = _mtu + 14;
+
+			if (_enabled) {
+				to.setTo(_rxBuf,6);
+				from.setTo(_rxBuf + 6,6);
+				unsigned int etherType = ntohs(((const uint16_t *)_rxBuf)[6]);
+				_handler(_arg,(void *)0,_nwid,from,to,etherType,0,(const void *)(_rxBuf + 14),_rxFill - 14);
 			}
+
+			_rxFill = 0;
 		}
 	}
 }
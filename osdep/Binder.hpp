@@ -54,6 +54,10 @@
 #include "OSUtils.hpp"
 #include "Phy.hpp"
 
+#if defined(__LINUX__) && !defined(ZT_SDK)
+#include "LinuxNetLink.hpp"
+#endif
+
 #include <algorithm>
 #include <atomic>
 #include <map>
@@ -71,6 +75,13 @@
 // Maximum physical interface name length. This number is gigantic because of Windows.
 #define ZT_MAX_PHYSIFNAME 256
 
+// Max number of additional SO_REUSEPORT receive shard sockets per binding
+#define ZT_BINDER_MAX_UDP_SHARDS 15
+
+// Size of the valid-socket snapshot hash (power of two, >= 2x the maximum
+// possible socket count of ZT_BINDER_MAX_BINDINGS * (1 + ZT_BINDER_MAX_UDP_SHARDS))
+#define ZT_BINDER_SOCK_HASH_SIZE 8192
+
 namespace ZeroTier {
 
 /**
@@ -87,33 +98,77 @@ namespace ZeroTier {
 class Binder {
   private:
 	struct _Binding {
-		_Binding() : udpSock((PhySocket*)0), tcpListenSock((PhySocket*)0)
+		_Binding() : udpSock((PhySocket*)0), tcpListenSock((PhySocket*)0), udpShardCount(0)
 		{
+			memset(udpShardSocks, 0, sizeof(udpShardSocks));
 		}
 		PhySocket* udpSock;
 		PhySocket* tcpListenSock;
+		PhySocket* udpShardSocks[ZT_BINDER_MAX_UDP_SHARDS];   // extra SO_REUSEPORT sockets, each owned by a worker Phy
+		unsigned int udpShardCount;
 		InetAddress address;
 		char ifname[256] = {};
 	};
 
+	static inline unsigned int _sockHashSlot(const PhySocket* const s)
+	{
+		return (unsigned int)((((uintptr_t)s) >> 4) * (uintptr_t)2654435761UL) & (ZT_BINDER_SOCK_HASH_SIZE - 1);
+	}
+
+	static inline void _sockHashInsert(PhySocket** t, PhySocket* const s)
+	{
+		if (! s)
+			return;
+		unsigned int slot = _sockHashSlot(s);
+		while (t[slot])
+			slot = (slot + 1) & (ZT_BINDER_SOCK_HASH_SIZE - 1);
+		t[slot] = s;
+	}
+
+	/* Rebuild the inactive snapshot hash from _bindings and swap it live.
+	 * Must be called with _lock held after any change to the binding table.
+	 * The send path probes the active snapshot without locking; a sender
+	 * overlapping two back-to-back rebuilds could see a mixed view, but
+	 * rebuilds are ZT_BINDER_REFRESH_PERIOD apart while a probe takes
+	 * nanoseconds, and the worst case is the same brief staleness the
+	 * snapshot already implies. */
+	inline void _publishSockSnapshot()
+	{
+		const unsigned int next = _sockSnapshotCur.load(std::memory_order_relaxed) ^ 1;
+		PhySocket** const t = _sockSnapshot[next];
+		memset(t, 0, sizeof(_sockSnapshot[next]));
+		for (unsigned int b = 0, c = _bindingCount; b < c; ++b) {
+			_sockHashInsert(t, _bindings[b].udpSock);
+			for (unsigned int i = 0, sc = _bindings[b].udpShardCount; i < sc; ++i)
+				_sockHashInsert(t, _bindings[b].udpShardSocks[i]);
+		}
+		_sockSnapshotCur.store(next, std::memory_order_release);
+	}
+
   public:
-	Binder() : _bindingCount(0)
+	Binder() : _bindingCount(0), _sockSnapshotCur(0)
 	{
+		memset(_sockSnapshot, 0, sizeof(_sockSnapshot));
 	}
 
 	/**
 	 * Close all bound ports, should be called on shutdown
 	 *
 	 * @param phy Physical interface
+	 * @param shardPhys Worker Phy instances owning any SO_REUSEPORT shard sockets (must match what was passed to refresh())
 	 */
-	template <typename PHY_HANDLER_TYPE> void closeAll(Phy<PHY_HANDLER_TYPE>& phy)
+	template <typename PHY_HANDLER_TYPE> void closeAll(Phy<PHY_HANDLER_TYPE>& phy, const std::vector<Phy<PHY_HANDLER_TYPE>*>& shardPhys = std::vector<Phy<PHY_HANDLER_TYPE>*>())
 	{
 		Mutex::Lock _l(_lock);
 		for (unsigned int b = 0, c = _bindingCount; b < c; ++b) {
 			phy.close(_bindings[b].udpSock, false);
 			phy.close(_bindings[b].tcpListenSock, false);
+			for (unsigned int i = 0; (i < _bindings[b].udpShardCount) && (i < (unsigned int)shardPhys.size()); ++i)
+				shardPhys[i]->close(_bindings[b].udpShardSocks[i], false);
+			_bindings[b].udpShardCount = 0;
 		}
 		_bindingCount = 0;
+		_publishSockSnapshot();
 	}
 
 	/**
@@ -127,16 +182,26 @@ class Binder {
 	 * @param portCount Number of ports
 	 * @param explicitBind If present, override interface IP detection and bind to these (if possible)
 	 * @param ifChecker Interface checker function to see if an interface should be used
+	 * @param shardPhys If non-empty, open one extra SO_REUSEPORT socket per worker Phy for each UDP binding so the kernel spreads inbound flows across them (Linux)
 	 * @tparam PHY_HANDLER_TYPE Type for Phy<> template
 	 * @tparam INTERFACE_CHECKER Type for class containing shouldBindInterface() method
 	 */
-	template <typename PHY_HANDLER_TYPE, typename INTERFACE_CHECKER> void refresh(Phy<PHY_HANDLER_TYPE>& phy, unsigned int* ports, unsigned int portCount, const std::vector<InetAddress> explicitBind, INTERFACE_CHECKER& ifChecker)
+	template <typename PHY_HANDLER_TYPE, typename INTERFACE_CHECKER> void refresh(Phy<PHY_HANDLER_TYPE>& phy, unsigned int* ports, unsigned int portCount, const std::vector<InetAddress> explicitBind, INTERFACE_CHECKER& ifChecker, const std::vector<Phy<PHY_HANDLER_TYPE>*>& shardPhys = std::vector<Phy<PHY_HANDLER_TYPE>*>())
 	{
 		std::map<InetAddress, std::string> localIfAddrs;
 		PhySocket *udps, *tcps;
-		Mutex::Lock _l(_lock);
 		bool interfacesEnumerated = true;
 
+#if defined(__LINUX__) && !defined(ZT_SDK)
+		/* This is called on a timer, but the netlink event counter tells us
+		 * whether any link or address has actually changed since the last
+		 * complete scan. If nothing has moved there is nothing to rebind, so
+		 * skip enumeration and diffing entirely. */
+		const uint64_t ifEvents = LinuxNetLink::getInstance().interfaceEventCounter();
+		if ((explicitBind.empty()) && (ifEvents == _lastIfEvents) && (_bindingCount > 0))
+			return;
+#endif
+
 		if (explicitBind.empty()) {
 #ifdef __WINDOWS__
 
@@ -185,6 +250,36 @@ class Binder {
 			 * embedded systems, so revert to getifaddrs() there. */
 
 #ifdef __LINUX__
+#ifndef ZT_SDK
+			/* Prefer the netlink address cache when it has been populated. It
+			 * is kept current by kernel multicast events, so consulting it is
+			 * pure memory access with no /proc reads or ioctls per refresh. */
+			{
+				std::vector< std::pair<InetAddress,std::string> > nlAddrs;
+				if (LinuxNetLink::getInstance().getIfAddrs(nlAddrs)) {
+					for(std::vector< std::pair<InetAddress,std::string> >::const_iterator a(nlAddrs.begin());a!=nlAddrs.end();++a) {
+						InetAddress ip(a->first);
+						if (ifChecker.shouldBindInterface(a->second.c_str(), ip)) {
+							switch (ip.ipScope()) {
+								default:
+									break;
+								case InetAddress::IP_SCOPE_PSEUDOPRIVATE:
+								case InetAddress::IP_SCOPE_GLOBAL:
+								case InetAddress::IP_SCOPE_SHARED:
+								case InetAddress::IP_SCOPE_PRIVATE:
+									for (int x = 0; x < (int)portCount; ++x) {
+										ip.setPort(ports[x]);
+										localIfAddrs.insert(std::pair<InetAddress, std::string>(ip, a->second));
+									}
+									break;
+							}
+						}
+					}
+				}
+			}
+#endif	 // not ZT_SDK
+
+			if (localIfAddrs.empty()) {
 			char fn[256], tmp[256];
 			std::set<std::string> ifnames;
 			const unsigned long pid = (unsigned long)getpid();
@@ -308,6 +403,7 @@ class Binder {
 				if (controlfd > 0)
 					close(controlfd);
 			}
+			}	// localIfAddrs.empty() (netlink cache fallback)
 
 			const bool gotViaProc = (! localIfAddrs.empty());
 #else
@@ -407,6 +503,11 @@ class Binder {
 			}
 		}
 
+		/* Only the delta application below needs the lock; enumeration above
+		 * works entirely on locals, so senders and receivers are not stalled
+		 * while devices are being scanned. */
+		Mutex::Lock _l(_lock);
+
 		const unsigned int oldBindingCount = _bindingCount;
 		_bindingCount = 0;
 
@@ -422,6 +523,12 @@ class Binder {
 				PhySocket* const tcps = _bindings[b].tcpListenSock;
 				_bindings[b].udpSock = (PhySocket*)0;
 				_bindings[b].tcpListenSock = (PhySocket*)0;
+				for (unsigned int i = 0; (i < _bindings[b].udpShardCount) && (i < (unsigned int)shardPhys.size()); ++i) {
+					PhySocket* const ss = _bindings[b].udpShardSocks[i];
+					_bindings[b].udpShardSocks[i] = (PhySocket*)0;
+					shardPhys[i]->close(ss, false);
+				}
+				_bindings[b].udpShardCount = 0;
 				phy.close(udps, false);
 				phy.close(tcps, false);
 			}
@@ -436,9 +543,23 @@ class Binder {
 				++bi;
 			}
 			if (bi == _bindingCount) {
-				udps = phy.udpBind(reinterpret_cast<const struct sockaddr*>(&(ii->first)), (void*)0, ZT_UDP_DESIRED_BUF_SIZE);
+				const bool shard = (! shardPhys.empty());
+				udps = phy.udpBind(reinterpret_cast<const struct sockaddr*>(&(ii->first)), (void*)&phy, ZT_UDP_DESIRED_BUF_SIZE, shard);
 				tcps = phy.tcpListen(reinterpret_cast<const struct sockaddr*>(&(ii->first)), (void*)0);
 				if ((udps) && (tcps)) {
+					// Open one extra SO_REUSEPORT socket per worker Phy so the kernel
+					// spreads inbound flows for this address across their threads.
+					// Failures here are non-fatal; we just shard less widely.
+					PhySocket* shardSocks[ZT_BINDER_MAX_UDP_SHARDS];
+					unsigned int shardCount = 0;
+					if (shard) {
+						for (unsigned int i = 0; (i < (unsigned int)shardPhys.size()) && (i < ZT_BINDER_MAX_UDP_SHARDS); ++i) {
+							PhySocket* const ss = shardPhys[i]->udpBind(reinterpret_cast<const struct sockaddr*>(&(ii->first)), (void*)shardPhys[i], ZT_UDP_DESIRED_BUF_SIZE, true);
+							if (! ss)
+								break;
+							shardSocks[shardCount++] = ss;
+						}
+					}
 #ifdef __LINUX__
 					// Bind Linux sockets to their device so routes that we manage do not override physical routes (wish all platforms had this!)
 					if (ii->second.length() > 0) {
@@ -450,15 +571,27 @@ class Binder {
 						fd = (int)Phy<PHY_HANDLER_TYPE>::getDescriptor(tcps);
 						if (fd >= 0)
 							setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, tmp, strlen(tmp));
+						for (unsigned int i = 0; i < shardCount; ++i) {
+							fd = (int)Phy<PHY_HANDLER_TYPE>::getDescriptor(shardSocks[i]);
+							if (fd >= 0)
+								setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, tmp, strlen(tmp));
+						}
 					}
 #endif	 // __LINUX__
 					if (_bindingCount < ZT_BINDER_MAX_BINDINGS) {
 						_bindings[_bindingCount].udpSock = udps;
 						_bindings[_bindingCount].tcpListenSock = tcps;
+						for (unsigned int i = 0; i < shardCount; ++i)
+							_bindings[_bindingCount].udpShardSocks[i] = shardSocks[i];
+						_bindings[_bindingCount].udpShardCount = shardCount;
 						_bindings[_bindingCount].address = ii->first;
 						memcpy(_bindings[_bindingCount].ifname, (char*)ii->second.c_str(), (int)ii->second.length());
 						++_bindingCount;
 					}
+					else {
+						for (unsigned int i = 0; i < shardCount; ++i)
+							shardPhys[i]->close(shardSocks[i], false);
+					}
 				}
 				else {
 					phy.close(udps, false);
@@ -466,6 +599,15 @@ class Binder {
 				}
 			}
 		}
+
+		_publishSockSnapshot();
+
+#if defined(__LINUX__) && !defined(ZT_SDK)
+		// Only arm the fast path after a complete scan so a failed enumeration
+		// is always retried on the next refresh.
+		if ((interfacesEnumerated) && (explicitBind.empty()))
+			_lastIfEvents = ifEvents;
+#endif
 	}
 
 	/**
@@ -480,6 +622,18 @@ class Binder {
 		return aa;
 	}
 
+	/**
+	 * @return All currently bound UDP sockets
+	 */
+	inline std::vector<PhySocket*> allBoundUdpSockets() const
+	{
+		std::vector<PhySocket*> ss;
+		Mutex::Lock _l(_lock);
+		for (unsigned int b = 0, c = _bindingCount; b < c; ++b)
+			ss.push_back(_bindings[b].udpSock);
+		return ss;
+	}
+
 	/**
 	 * Send from all bound UDP sockets
 	 */
@@ -515,14 +669,19 @@ class Binder {
 	/**
 	 * Quickly check that a UDP socket is valid
 	 *
+	 * This is called for every transmitted packet, so rather than scanning
+	 * the binding table it probes an immutable snapshot hash that refresh()
+	 * republishes whenever bindings change: lock-free and O(1).
+	 *
 	 * @param udpSock UDP socket to check
 	 * @return True if socket is currently bound/allocated
 	 */
-	inline bool isUdpSocketValid(PhySocket* const udpSock)
+	inline bool isUdpSocketValid(PhySocket* const udpSock) const
 	{
-		for (unsigned int b = 0, c = _bindingCount; b < c; ++b) {
-			if (_bindings[b].udpSock == udpSock)
-				return (b < _bindingCount);	  // double check atomic which may have changed
+		PhySocket* const* const t = _sockSnapshot[_sockSnapshotCur.load(std::memory_order_acquire)];
+		for (unsigned int slot = _sockHashSlot(udpSock); t[slot]; slot = (slot + 1) & (ZT_BINDER_SOCK_HASH_SIZE - 1)) {
+			if (t[slot] == udpSock)
+				return true;
 		}
 		return false;
 	}
@@ -536,7 +695,10 @@ class Binder {
 	{
 		Mutex::Lock _l(_lock);
 		for (unsigned int b = 0, c = _bindingCount; b < c; ++b) {
-			if (_bindings[b].udpSock == s) {
+			bool match = (_bindings[b].udpSock == s);
+			for (unsigned int i = 0, sc = _bindings[b].udpShardCount; (! match) && (i < sc); ++i)
+				match = (_bindings[b].udpShardSocks[i] == s);
+			if (match) {
 				memcpy(nameBuf, _bindings[b].ifname, buflen);
 				break;
 			}
@@ -546,7 +708,16 @@ class Binder {
   private:
 	_Binding _bindings[ZT_BINDER_MAX_BINDINGS];
 	std::atomic<unsigned int> _bindingCount;
+	// Double-buffered open addressing hash sets of all currently bound UDP
+	// sockets; the buffer indexed by _sockSnapshotCur is immutable and read
+	// without locking by isUdpSocketValid(), the other is rebuilt and
+	// swapped in by _publishSockSnapshot() under _lock
+	PhySocket* _sockSnapshot[2][ZT_BINDER_SOCK_HASH_SIZE];
+	std::atomic<unsigned int> _sockSnapshotCur;
 	Mutex _lock;
+#if defined(__LINUX__) && !defined(ZT_SDK)
+	uint64_t _lastIfEvents = ~0ULL;	  // never matches a real counter value until the first complete scan
+#endif
 };
 
 }	// namespace ZeroTier
@@ -26,19 +26,72 @@ namespace ZeroTier {
 /**
  * Simple C++11 thread-safe queue
  *
+ * This takes a mutex and condition variable per operation, so it is only
+ * appropriate for low-rate work like the controller's request queues. The
+ * frame ingest path does not use it: tap backends invoke their handler
+ * directly from the reader thread.
+ *
  * Do not use in node/ since we have not gone C++11 there yet.
  */
 template <class T>
 class BlockingQueue
 {
 public:
-	BlockingQueue(void) : r(true) {}
+	enum OverflowPolicy
+	{
+		UNBOUNDED,
+		BLOCK,
+		DROP_OLDEST
+	};
+
+	BlockingQueue(void) : r(true),l(0),p(UNBOUNDED) {}
 
-	inline void post(T t)
+	/**
+	 * Bound the queue (limit 0 restores unbounded growth)
+	 *
+	 * BLOCK makes posters wait for space, pushing backpressure upstream;
+	 * DROP_OLDEST evicts the head so the freshest work survives overload.
+	 * For pointer payloads use the post() overload with a dropped
+	 * out-parameter so evicted items can be freed.
+	 */
+	inline void setLimit(const unsigned long limit,const OverflowPolicy policy)
 	{
 		std::lock_guard<std::mutex> lock(m);
+		l = limit;
+		p = policy;
+	}
+
+	inline bool post(T t)
+	{
+		T dropped;
+		return post(t,dropped);
+	}
+
+	/**
+	 * @param dropped Set to the evicted item if DROP_OLDEST evicts one
+	 * @return True if queued without eviction; false if stopped or an item was evicted
+	 */
+	inline bool post(T t,T &dropped)
+	{
+		std::unique_lock<std::mutex> lock(m);
+		if (l > 0) {
+			if (p == BLOCK) {
+				while (q.size() >= l) {
+					if (!r)
+						return false;
+					gc.wait(lock);
+				}
+			} else if ((p == DROP_OLDEST)&&(q.size() >= l)) {
+				dropped = q.front();
+				q.pop();
+				q.push(t);
+				c.notify_one();
+				return false;
+			}
+		}
 		q.push(t);
 		c.notify_one();
+		return true;
 	}
 
 	inline void postLimit(T t,const unsigned long limit)
@@ -84,6 +137,7 @@ public:
 
 	inline std::vector<T> drain()
 	{
+		std::lock_guard<std::mutex> lock(m);
 		std::vector<T> v;
 		while (!q.empty()) {
 			v.push_back(q.front());
@@ -113,6 +167,59 @@ public:
 		}
 		value = q.front();
 		q.pop();
+		gc.notify_all();
+		return OK;
+	}
+
+	/**
+	 * Dequeue up to max items in one lock cycle
+	 *
+	 * Blocks until at least one item is available, then moves everything
+	 * queued (up to max) into values, so a consumer pays one mutex/condvar
+	 * round per batch instead of per item.
+	 *
+	 * @return False if the queue has been stopped
+	 */
+	inline bool get(std::vector<T> &values,const unsigned long max)
+	{
+		std::unique_lock<std::mutex> lock(m);
+		if (!r)
+			return false;
+		while (q.empty()) {
+			c.wait(lock);
+			if (!r) {
+				gc.notify_all();
+				return false;
+			}
+		}
+		while ((!q.empty())&&(values.size() < max)) {
+			values.push_back(q.front());
+			q.pop();
+		}
+		gc.notify_all();
+		return true;
+	}
+
+	/**
+	 * Timed variant of the batch dequeue above
+	 */
+	inline TimedWaitResult get(std::vector<T> &values,const unsigned long max,const unsigned long ms)
+	{
+		const std::chrono::milliseconds ms2{ms};
+		std::unique_lock<std::mutex> lock(m);
+		if (!r)
+			return STOP;
+		while (q.empty()) {
+			if (c.wait_for(lock,ms2) == std::cv_status::timeout)
+				return ((r) ? TIMED_OUT : STOP);
+			else if (!r)
+				return STOP;
+		}
+		while ((!q.empty())&&(values.size() < max)) {
+			values.push_back(q.front());
+			q.pop();
+		}
+		gc.notify_all();
 		return OK;
 	}
 
@@ -125,6 +232,8 @@ private:
 	mutable std::mutex m;
 	mutable std::condition_variable c,gc;
 	std::atomic_bool r;
+	unsigned long l; // capacity limit, 0 = unbounded
+	OverflowPolicy p;
 };
 
 } // namespace ZeroTier
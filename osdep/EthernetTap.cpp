@@ -64,7 +64,10 @@ std::shared_ptr<EthernetTap> EthernetTap::newInstance(
 	uint64_t nwid,
 	const char *friendlyName,
 	void (*handler)(void *,void *,uint64_t,const MAC &,const MAC &,unsigned int,unsigned int,const void *,unsigned int),
-	void *arg)
+	void *arg,
+	unsigned int tapQueues,
+	const unsigned int *tapReaderCpus,
+	unsigned int tapReaderCpuCount)
 {
 
 #ifdef ZT_SDK
@@ -92,7 +95,7 @@ std::shared_ptr<EthernetTap> EthernetTap::newInstance(
 #endif // __APPLE__
 
 #ifdef __LINUX__
-	return std::shared_ptr<EthernetTap>(new LinuxEthernetTap(homePath,mac,mtu,metric,nwid,friendlyName,handler,arg));
+	return std::shared_ptr<EthernetTap>(new LinuxEthernetTap(homePath,mac,mtu,metric,nwid,friendlyName,handler,arg,tapQueues,tapReaderCpus,tapReaderCpuCount));
 #endif // __LINUX__
 
 #ifdef __WINDOWS__
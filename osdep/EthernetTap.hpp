@@ -39,7 +39,10 @@ public:
 		uint64_t nwid,
 		const char *friendlyName,
 		void (*handler)(void *,void *,uint64_t,const MAC &,const MAC &,unsigned int,unsigned int,const void *,unsigned int),
-		void *arg);
+		void *arg,
+		unsigned int tapQueues = 0, // number of tap I/O queues and reader threads, 0 for default (Linux only)
+		const unsigned int *tapReaderCpus = (const unsigned int *)0, // CPU indexes to pin reader threads to round-robin, NULL for no pinning (Linux only)
+		unsigned int tapReaderCpuCount = 0); // number of entries in tapReaderCpus
 
 	EthernetTap();
 	virtual ~EthernetTap();
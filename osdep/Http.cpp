@@ -20,6 +20,10 @@
 #include "OSUtils.hpp"
 #include "../node/Constants.hpp"
 #include "../node/Utils.hpp"
+#include "../node/InetAddress.hpp"
+
+#include <mutex>
+#include <vector>
 
 #ifdef ZT_USE_SYSTEM_HTTP_PARSER
 #include <http_parser.h>
@@ -27,6 +31,16 @@
 #include "../ext/http-parser/http_parser.h"
 #endif
 
+/**
+ * How long an idle keep-alive connection may sit in the pool before being closed (ms)
+ */
+#define ZT_HTTP_KEEPALIVE_TIMEOUT 30000
+
+/**
+ * Maximum number of idle keep-alive connections retained across all destinations
+ */
+#define ZT_HTTP_KEEPALIVE_MAX_IDLE 8
+
 namespace ZeroTier {
 
 namespace {
@@ -67,10 +81,59 @@ static const struct http_parser_settings HTTP_PARSER_SETTINGS = {
 };
 #endif
 
+/**
+ * A TCP connection left open by a keep-alive HTTP exchange, waiting for reuse
+ */
+struct HttpKeepAliveConn
+{
+	ZT_PHY_SOCKFD_TYPE fd;
+	int64_t lastUse;
+	InetAddress remote;
+};
+static std::vector<HttpKeepAliveConn> s_httpKeepAlivePool;
+static std::mutex s_httpKeepAlivePool_l;
+
+// Take a pooled connection to this remote if one exists, expiring idle entries along the way
+static ZT_PHY_SOCKFD_TYPE _httpKeepAliveTake(const struct sockaddr *remoteAddress)
+{
+	const InetAddress remote(remoteAddress);
+	const int64_t now = OSUtils::now();
+	ZT_PHY_SOCKFD_TYPE fd = ZT_PHY_SOCKFD_NULL;
+	std::lock_guard<std::mutex> l(s_httpKeepAlivePool_l);
+	for(std::vector<HttpKeepAliveConn>::iterator c(s_httpKeepAlivePool.begin());c!=s_httpKeepAlivePool.end();) {
+		if ((now - c->lastUse) > (int64_t)ZT_HTTP_KEEPALIVE_TIMEOUT) {
+			ZT_PHY_CLOSE_SOCKET(c->fd);
+			c = s_httpKeepAlivePool.erase(c);
+		} else if ((!ZT_PHY_SOCKFD_VALID(fd))&&(c->remote == remote)) {
+			fd = c->fd;
+			c = s_httpKeepAlivePool.erase(c);
+		} else ++c;
+	}
+	return fd;
+}
+
+// Return a connection to the pool after a completed keep-alive exchange
+static void _httpKeepAliveReturn(const struct sockaddr *remoteAddress,ZT_PHY_SOCKFD_TYPE fd)
+{
+	if (!ZT_PHY_SOCKFD_VALID(fd))
+		return;
+	std::lock_guard<std::mutex> l(s_httpKeepAlivePool_l);
+	if (s_httpKeepAlivePool.size() >= ZT_HTTP_KEEPALIVE_MAX_IDLE) {
+		ZT_PHY_CLOSE_SOCKET(fd);
+		return;
+	}
+	HttpKeepAliveConn c;
+	c.fd = fd;
+	c.lastUse = OSUtils::now();
+	c.remote = InetAddress(remoteAddress);
+	s_httpKeepAlivePool.push_back(c);
+}
+
 struct HttpPhyHandler
 {
 	// not used
 	inline void phyOnDatagram(PhySocket *sock,void **uptr,const struct sockaddr *localAddr,const struct sockaddr *from,void *data,unsigned long len) {}
+	inline void phyOnDatagramWritable(PhySocket *sock,void **uptr) {}
 	inline void phyOnTcpAccept(PhySocket *sockL,PhySocket *sockN,void **uptrL,void **uptrN,const struct sockaddr *from) {}
 
 	inline void phyOnTcpConnect(PhySocket *sock,void **uptr,bool success)
@@ -92,6 +155,7 @@ struct HttpPhyHandler
 	inline void phyOnTcpData(PhySocket *sock,void **uptr,void *data,unsigned long len)
 	{
 		lastActivity = OSUtils::now();
+		gotData = true;
 		http_parser_execute(&parser,&HTTP_PARSER_SETTINGS,(const char *)data,len);
 		if ((parser.upgrade)||(parser.http_errno != HPE_OK))
 			phy->close(sock);
@@ -129,7 +193,9 @@ struct HttpPhyHandler
 	std::string *responseBody;
 	bool error;
 	bool done;
+	bool gotData;
 
+	const struct sockaddr *remoteAddress;
 	Phy<HttpPhyHandler *> *phy;
 	PhySocket *sock;
 };
@@ -199,7 +265,14 @@ static int ShttpOnBody(http_parser *parser,const char *ptr,size_t length)
 static int ShttpOnMessageComplete(http_parser *parser)
 {
 	HttpPhyHandler *hh = reinterpret_cast<HttpPhyHandler *>(parser->data);
-	hh->phy->close(hh->sock);
+	hh->done = true;
+	if ((!hh->error)&&(http_should_keep_alive(parser))) {
+		// The server will hold this connection open, so pool it instead of
+		// paying connection setup again on the next request to this host.
+		_httpKeepAliveReturn(hh->remoteAddress,hh->phy->tcpRelease(hh->sock));
+	} else {
+		hh->phy->close(hh->sock);
+	}
 	return 0;
 }
 
@@ -218,63 +291,92 @@ unsigned int Http::_do(
 	std::string &responseBody)
 {
 	try {
-		responseHeaders.clear();
-		responseBody = "";
-
-		HttpPhyHandler handler;
-
-		http_parser_init(&(handler.parser),HTTP_RESPONSE);
-		handler.parser.data = (void *)&handler;
-		handler.messageSize = 0;
-		handler.writePtr = 0;
-		handler.lastActivity = OSUtils::now();
-
-		try {
-			char tmp[1024];
-			OSUtils::ztsnprintf(tmp,sizeof(tmp),"%s %s HTTP/1.1\r\n",method,path);
-			handler.writeBuf.append(tmp);
-			for(std::map<std::string,std::string>::const_iterator h(requestHeaders.begin());h!=requestHeaders.end();++h) {
-				OSUtils::ztsnprintf(tmp,sizeof(tmp),"%s: %s\r\n",h->first.c_str(),h->second.c_str());
+		bool tryReuse = true;
+		for(;;) {
+			responseHeaders.clear();
+			responseBody = "";
+
+			HttpPhyHandler handler;
+
+			http_parser_init(&(handler.parser),HTTP_RESPONSE);
+			handler.parser.data = (void *)&handler;
+			handler.messageSize = 0;
+			handler.writePtr = 0;
+			handler.lastActivity = OSUtils::now();
+
+			try {
+				char tmp[1024];
+				OSUtils::ztsnprintf(tmp,sizeof(tmp),"%s %s HTTP/1.1\r\n",method,path);
 				handler.writeBuf.append(tmp);
+				for(std::map<std::string,std::string>::const_iterator h(requestHeaders.begin());h!=requestHeaders.end();++h) {
+					OSUtils::ztsnprintf(tmp,sizeof(tmp),"%s: %s\r\n",h->first.c_str(),h->second.c_str());
+					handler.writeBuf.append(tmp);
+				}
+				handler.writeBuf.append("\r\n");
+				if ((requestBody)&&(requestBodyLength))
+					handler.writeBuf.append((const char *)requestBody,requestBodyLength);
+			} catch ( ... ) {
+				responseBody = "request too large";
+				return 0;
 			}
-			handler.writeBuf.append("\r\n");
-			if ((requestBody)&&(requestBodyLength))
-				handler.writeBuf.append((const char *)requestBody,requestBodyLength);
-		} catch ( ... ) {
-			responseBody = "request too large";
-			return 0;
-		}
 
-		if (maxResponseSize) {
-			handler.maxResponseSize = maxResponseSize;
-		} else {
-			handler.maxResponseSize = 2147483647;
-		}
-		handler.responseHeaders = &responseHeaders;
-		handler.responseBody = &responseBody;
-		handler.error = false;
-		handler.done = false;
-
-		Phy<HttpPhyHandler *> phy(&handler,true,true);
-
-		bool instantConnect = false;
-		handler.phy = &phy;
-		handler.sock = phy.tcpConnect((const struct sockaddr *)remoteAddress,instantConnect,(void *)0,true);
-		if (!handler.sock) {
-			responseBody = "connection failed (2)";
-			return 0;
-		}
+			if (maxResponseSize) {
+				handler.maxResponseSize = maxResponseSize;
+			} else {
+				handler.maxResponseSize = 2147483647;
+			}
+			handler.responseHeaders = &responseHeaders;
+			handler.responseBody = &responseBody;
+			handler.error = false;
+			handler.done = false;
+			handler.gotData = false;
+			handler.remoteAddress = remoteAddress;
 
-		while (!handler.done) {
-			phy.poll(timeout / 2);
-			if ((timeout)&&((unsigned long)(OSUtils::now() - handler.lastActivity) > timeout)) {
-				phy.close(handler.sock);
-				responseBody = "timed out";
-				return 0;
+			Phy<HttpPhyHandler *> phy(&handler,true,true);
+			handler.phy = &phy;
+			handler.sock = (PhySocket *)0;
+
+			bool reused = false;
+			if (tryReuse) {
+				ZT_PHY_SOCKFD_TYPE kfd = _httpKeepAliveTake(remoteAddress);
+				if (ZT_PHY_SOCKFD_VALID(kfd)) {
+					handler.sock = phy.tcpAdopt(kfd,remoteAddress,(void *)0);
+					if (handler.sock) {
+						reused = true;
+						phy.setNotifyWritable(handler.sock,true);
+					} else {
+						ZT_PHY_CLOSE_SOCKET(kfd);
+					}
+				}
+			}
+			if (!handler.sock) {
+				bool instantConnect = false;
+				handler.sock = phy.tcpConnect((const struct sockaddr *)remoteAddress,instantConnect,(void *)0,true);
+				if (!handler.sock) {
+					responseBody = "connection failed (2)";
+					return 0;
+				}
 			}
-		}
 
-		return ((handler.error) ? 0 : ((handler.parser.http_errno != HPE_OK) ? 0 : handler.parser.status_code));
+			while (!handler.done) {
+				phy.poll(timeout / 2);
+				if ((timeout)&&((unsigned long)(OSUtils::now() - handler.lastActivity) > timeout)) {
+					phy.close(handler.sock);
+					responseBody = "timed out";
+					return 0;
+				}
+			}
+
+			// A pooled connection may have been closed by the server while it
+			// sat idle; if it produced nothing at all, retry once on a fresh
+			// connection before reporting failure.
+			if ((reused)&&(!handler.gotData)) {
+				tryReuse = false;
+				continue;
+			}
+
+			return ((handler.error) ? 0 : ((handler.parser.http_errno != HPE_OK) ? 0 : handler.parser.status_code));
+		}
 	} catch (std::exception &exc) {
 		responseBody = exc.what();
 		return 0;
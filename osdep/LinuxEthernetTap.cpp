@@ -39,6 +39,7 @@
 #include <sys/ioctl.h>
 #include <sys/wait.h>
 #include <sys/select.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <net/if_arp.h>
 #include <arpa/inet.h>
@@ -47,6 +48,8 @@
 #include <linux/if_addr.h>
 #include <linux/if_ether.h>
 #include <ifaddrs.h>
+#include <sched.h>
+#include <pthread.h>
 
 #include <algorithm>
 #include <utility>
@@ -109,6 +112,17 @@ static void _base32_5_to_8(const uint8_t *in,char *out)
 	out[7] = _base32_chars[(in[4] & 0x1f)];
 }
 
+static void ___pinCurrentThreadToCpu(unsigned int cpu)
+{
+	// The kernel hashes each flow to one IFF_MULTI_QUEUE queue, so pinning
+	// each queue's reader to its own CPU keeps a flow's frames being read
+	// and handled on the same core, RSS style.
+	cpu_set_t cs;
+	CPU_ZERO(&cs);
+	CPU_SET(cpu,&cs);
+	pthread_setaffinity_np(pthread_self(),sizeof(cs),&cs);
+}
+
 LinuxEthernetTap::LinuxEthernetTap(
 	const char *homePath,
 	const MAC &mac,
@@ -117,7 +131,10 @@ LinuxEthernetTap::LinuxEthernetTap(
 	uint64_t nwid,
 	const char *friendlyName,
 	void (*handler)(void *,void *,uint64_t,const MAC &,const MAC &,unsigned int,unsigned int,const void *,unsigned int),
-	void *arg) :
+	void *arg,
+	unsigned int queueCount,
+	const unsigned int *readerCpus,
+	unsigned int readerCpuCount) :
 	_handler(handler),
 	_arg(arg),
 	_nwid(nwid),
@@ -133,6 +150,9 @@ LinuxEthernetTap::LinuxEthernetTap(
 	char procpath[128],nwids[32];
 	struct stat sbuf;
 
+	for(unsigned int i=0;i<readerCpuCount;++i)
+		_readerCpus.push_back(readerCpus[i]);
+
 
 	// Create only one tap at a time globally.
 	std::lock_guard<std::mutex> tapCreateLock(s_tapCreateLock);
@@ -208,23 +228,63 @@ LinuxEthernetTap::LinuxEthernetTap(
 #endif
 	}
 
+	// Multiple tap queues spread kernel-side frame delivery and our read
+	// syscalls across that many reader threads. The count comes from
+	// local.conf ("tapQueues") via the constructor, or failing that from
+	// the ZT_TAP_QUEUES environment variable; the default is one queue.
+	unsigned int queues = 1;
+	if (queueCount > 0) {
+		queues = std::min(queueCount,(unsigned int)16);
+	} else {
+		const char *const tq = getenv("ZT_TAP_QUEUES");
+		if (tq) {
+			const int q = atoi(tq);
+			if (q > 1)
+				queues = (unsigned int)std::min(q,16);
+		}
+	}
+
 	ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+	if (queues > 1)
+		ifr.ifr_flags |= IFF_MULTI_QUEUE;
 	if (ioctl(_fd,TUNSETIFF,(void *)&ifr) < 0) {
-		::close(_fd);
-		throw std::runtime_error("unable to configure TUN/TAP device for TAP operation");
+		bool ok = false;
+		if (queues > 1) {
+			// Kernel may not support multi-queue tap -- fall back to one queue
+			queues = 1;
+			ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+			ok = (ioctl(_fd,TUNSETIFF,(void *)&ifr) >= 0);
+		}
+		if (!ok) {
+			::close(_fd);
+			throw std::runtime_error("unable to configure TUN/TAP device for TAP operation");
+		}
 	}
 
 	::ioctl(_fd,TUNSETPERSIST,0); // valgrind may generate a false alarm here
 	_dev = ifr.ifr_name;
 	::fcntl(_fd,F_SETFD,fcntl(_fd,F_GETFD) | FD_CLOEXEC);
 
+	for(unsigned int q=1;q<queues;++q) {
+		const int qfd = ::open("/dev/net/tun",O_RDWR);
+		if (qfd <= 0)
+			break;
+		struct ifreq qifr;
+		memset(&qifr,0,sizeof(qifr));
+		Utils::scopy(qifr.ifr_name,sizeof(qifr.ifr_name),_dev.c_str());
+		qifr.ifr_flags = IFF_TAP | IFF_NO_PI | IFF_MULTI_QUEUE;
+		if (ioctl(qfd,TUNSETIFF,(void *)&qifr) < 0) {
+			::close(qfd);
+			break;
+		}
+		::fcntl(qfd,F_SETFD,fcntl(qfd,F_GETFD) | FD_CLOEXEC);
+		::fcntl(qfd,F_SETFL,O_NONBLOCK);
+		_extraFds.push_back(qfd);
+	}
+
 	(void)::pipe(_shutdownSignalPipe);
 
 	_tapReaderThread = std::thread([this]{
-		uint8_t b[ZT_TAP_BUF_SIZE];
-		fd_set readfds,nullfds;
-		int n,nfds,r;
-		std::vector<void *> buffers;
 		struct ifreq ifr;
 
 		memset(&ifr,0,sizeof(ifr));
@@ -296,57 +356,81 @@ LinuxEthernetTap::LinuxEthernetTap(
 		if (!_run)
 			return;
 
-		FD_ZERO(&readfds);
-		FD_ZERO(&nullfds);
-		nfds = (int)std::max(_shutdownSignalPipe[0],_fd) + 1;
-
-		r = 0;
-		for(;;) {
-			FD_SET(_shutdownSignalPipe[0],&readfds);
-			FD_SET(_fd,&readfds);
-			select(nfds,&readfds,&nullfds,&nullfds,(struct timeval *)0);
-
-			if (FD_ISSET(_shutdownSignalPipe[0],&readfds))
-				break;
-
-			if (FD_ISSET(_fd,&readfds)) {
-				for(;;) { // read until there are no more packets, then return to outer select() loop
-					n = (int)::read(_fd,b + r,ZT_TAP_BUF_SIZE - r);
-					if (n > 0) {
-						// Some tap drivers like to send the ethernet frame and the
-						// payload in two chunks, so handle that by accumulating
-						// data until we have at least a frame.
-						r += n;
-						if (r > 14) {
-							if (r > ((int)_mtu + 14)) // sanity check for weird TAP behavior on some platforms
-								r = _mtu + 14;
-
-							if (_enabled) {
-								//_tapq.post(std::pair<void *,int>(buf,r));
-								//buf = nullptr;
-								MAC to(b, 6),from(b + 6, 6);
-								unsigned int etherType = Utils::ntoh(((const uint16_t *)b)[6]);
-								_handler(_arg, nullptr, _nwid, from, to, etherType, 0, (const void *)(b + 14),(unsigned int)(r - 14));
-							}
-
-							r = 0;
+		if (!_readerCpus.empty())
+			___pinCurrentThreadToCpu(_readerCpus[0]);
+		_tapReadLoop(_fd);
+	});
+
+	// Additional queue readers need no interface setup; reads on their fds
+	// simply return EAGAIN until the first thread brings the interface up.
+	for(unsigned int q=0;q<(unsigned int)_extraFds.size();++q) {
+		const int fd = _extraFds[q];
+		_extraReaderThreads.push_back(std::thread([this,fd,q]{
+			if (!_readerCpus.empty())
+				___pinCurrentThreadToCpu(_readerCpus[(q + 1) % (unsigned int)_readerCpus.size()]);
+			_tapReadLoop(fd);
+		}));
+	}
+}
+
+void LinuxEthernetTap::_tapReadLoop(int fd)
+{
+	uint8_t b[ZT_TAP_BUF_SIZE];
+	fd_set readfds,nullfds;
+	int n,nfds,r;
+
+	FD_ZERO(&readfds);
+	FD_ZERO(&nullfds);
+	nfds = (int)std::max(_shutdownSignalPipe[0],fd) + 1;
+
+	r = 0;
+	for(;;) {
+		FD_SET(_shutdownSignalPipe[0],&readfds);
+		FD_SET(fd,&readfds);
+		select(nfds,&readfds,&nullfds,&nullfds,(struct timeval *)0);
+
+		if (FD_ISSET(_shutdownSignalPipe[0],&readfds))
+			break;
+
+		if (FD_ISSET(fd,&readfds)) {
+			for(;;) { // read until there are no more packets, then return to outer select() loop
+				n = (int)::read(fd,b + r,ZT_TAP_BUF_SIZE - r);
+				if (n > 0) {
+					// Some tap drivers like to send the ethernet frame and the
+					// payload in two chunks, so handle that by accumulating
+					// data until we have at least a frame.
+					r += n;
+					if (r > 14) {
+						if (r > ((int)_mtu + 14)) // sanity check for weird TAP behavior on some platforms
+							r = _mtu + 14;
+
+						if (_enabled) {
+							MAC to(b, 6),from(b + 6, 6);
+							unsigned int etherType = Utils::ntoh(((const uint16_t *)b)[6]);
+							_handler(_arg, nullptr, _nwid, from, to, etherType, 0, (const void *)(b + 14),(unsigned int)(r - 14));
 						}
-					} else {
+
 						r = 0;
-						break;
 					}
+				} else {
+					r = 0;
+					break;
 				}
 			}
 		}
-	});
+	}
 }
 
 LinuxEthernetTap::~LinuxEthernetTap()
 {
 	_run = false;
-	(void)::write(_shutdownSignalPipe[1],"\0",1);
+	(void)::write(_shutdownSignalPipe[1],"\0",1); // stays readable, so it wakes every reader thread
 	_tapReaderThread.join();
+	for(std::vector<std::thread>::iterator t(_extraReaderThreads.begin());t!=_extraReaderThreads.end();++t)
+		t->join();
 	::close(_fd);
+	for(std::vector<int>::const_iterator qfd(_extraFds.begin());qfd!=_extraFds.end();++qfd)
+		::close(*qfd);
 	::close(_shutdownSignalPipe[0]);
 	::close(_shutdownSignalPipe[1]);
 }
@@ -488,14 +572,19 @@ std::vector<InetAddress> LinuxEthernetTap::ips() const
 
 void LinuxEthernetTap::put(const MAC &from,const MAC &to,unsigned int etherType,const void *data,unsigned int len)
 {
-	char putBuf[ZT_MAX_MTU + 64];
+	// The 14-byte Ethernet header is prepended via scatter/gather so the
+	// payload is handed to the kernel where it sits, with no copy here.
+	char hdr[14];
 	if ((_fd > 0)&&(len <= _mtu)&&(_enabled)) {
-		to.copyTo(putBuf,6);
-		from.copyTo(putBuf + 6,6);
-		*((uint16_t *)(putBuf + 12)) = htons((uint16_t)etherType);
-		memcpy(putBuf + 14,data,len);
-		len += 14;
-		(void)::write(_fd,putBuf,len);
+		to.copyTo(hdr,6);
+		from.copyTo(hdr + 6,6);
+		*((uint16_t *)(hdr + 12)) = htons((uint16_t)etherType);
+		struct iovec iov[2];
+		iov[0].iov_base = (void *)hdr;
+		iov[0].iov_len = 14;
+		iov[1].iov_base = const_cast<void *>(data);
+		iov[1].iov_len = len;
+		(void)::writev(_fd,iov,2);
 	}
 }
 
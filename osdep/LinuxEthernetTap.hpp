@@ -40,7 +40,10 @@ public:
 		uint64_t nwid,
 		const char *friendlyName,
 		void (*handler)(void *,void *,uint64_t,const MAC &,const MAC &,unsigned int,unsigned int,const void *,unsigned int),
-		void *arg);
+		void *arg,
+		unsigned int queueCount = 0,
+		const unsigned int *readerCpus = (const unsigned int *)0,
+		unsigned int readerCpuCount = 0);
 
 	virtual ~LinuxEthernetTap();
 
@@ -61,6 +64,8 @@ public:
 
 
 private:
+	void _tapReadLoop(int fd);
+
 	void (*_handler)(void *,void *,uint64_t,const MAC &,const MAC &,unsigned int,unsigned int,const void *,unsigned int);
 	void *_arg;
 	uint64_t _nwid;
@@ -70,10 +75,13 @@ private:
 	std::vector<MulticastGroup> _multicastGroups;
 	unsigned int _mtu;
 	int _fd;
+	std::vector<int> _extraFds; // additional IFF_MULTI_QUEUE queues, if enabled
+	std::vector<unsigned int> _readerCpus; // reader thread CPU pin list (round-robin), empty for no pinning
 	int _shutdownSignalPipe[2];
 	std::atomic_bool _enabled;
 	std::atomic_bool _run;
 	std::thread _tapReaderThread;
+	std::vector<std::thread> _extraReaderThreads;
 	mutable std::vector<InetAddress> _ifaddrs;
 	mutable uint64_t _lastIfAddrsUpdate;
 };
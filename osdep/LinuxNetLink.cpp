@@ -55,6 +55,8 @@ LinuxNetLink::LinuxNetLink()
 	, _seq(0)
 	, _interfaces()
 	, _if_m()
+	, _ifEvents(0)
+	, _routeBatchActive(false)
 	, _fd(socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE))
 	, _la({0})
 {
@@ -72,6 +74,7 @@ LinuxNetLink::LinuxNetLink()
 	_requestIPv4Routes();
 	_requestIPv6Routes();
 	_requestInterfaceList();
+	_requestIPAddresses();
 
 	_running = true;
 	_t = Thread::start(this);
@@ -217,71 +220,91 @@ void LinuxNetLink::_processMessage(struct nlmsghdr *nlp, int nll)
 	}
 }
 
-void LinuxNetLink::_ipAddressAdded(struct nlmsghdr *nlp)
+// Parse an RTM_NEWADDR/RTM_DELADDR message into the assigned address, or an
+// unset InetAddress if the message is for an address family we don't track
+// or for a temporary (privacy) IPv6 address.
+static InetAddress _parseIpAddressMessage(struct nlmsghdr *nlp,int &ifidx)
 {
-#ifdef ZT_NETLINK_TRACE
 	struct ifaddrmsg *ifap = (struct ifaddrmsg *)NLMSG_DATA(nlp);
 	struct rtattr *rtap = (struct rtattr *)IFA_RTA(ifap);
 	int ifal = IFA_PAYLOAD(nlp);
 
-	char addr[40] = {0};
-	char local[40] = {0};
-	char label[40] = {0};
-	char bcast[40] = {0};
+	InetAddress addr;
+	InetAddress local;
+	unsigned int flags = (unsigned int)ifap->ifa_flags;
+	ifidx = (int)ifap->ifa_index;
+
+	if ((ifap->ifa_family != AF_INET)&&(ifap->ifa_family != AF_INET6))
+		return InetAddress();
 
 	for(;RTA_OK(rtap, ifal); rtap=RTA_NEXT(rtap,ifal))
 	{
 		switch(rtap->rta_type) {
 		case IFA_ADDRESS:
-			inet_ntop(ifap->ifa_family, RTA_DATA(rtap), addr, 40);
+			addr.set(RTA_DATA(rtap), (ifap->ifa_family == AF_INET) ? 4 : 16, 0);
 			break;
 		case IFA_LOCAL:
-			inet_ntop(ifap->ifa_family, RTA_DATA(rtap), local, 40);
+			local.set(RTA_DATA(rtap), (ifap->ifa_family == AF_INET) ? 4 : 16, 0);
 			break;
-		case IFA_LABEL:
-			memcpy(label, RTA_DATA(rtap), 40);
-			break;
-		case IFA_BROADCAST:
-			inet_ntop(ifap->ifa_family, RTA_DATA(rtap), bcast, 40);
+#ifdef IFA_FLAGS
+		case IFA_FLAGS:
+			memcpy(&flags, RTA_DATA(rtap), sizeof(flags));
 			break;
+#endif
 		}
 	}
 
-	fprintf(stderr,"Added IP Address %s local: %s label: %s broadcast: %s\n", addr, local, label, bcast);
-#endif
+	// For IPv4 point-to-point interfaces IFA_ADDRESS is the peer; IFA_LOCAL
+	// is always the address actually assigned to the interface when present.
+	if (local)
+		addr = local;
+
+	if ((flags & IFA_F_TEMPORARY) != 0)
+		return InetAddress();
+
+	return addr;
 }
 
-void LinuxNetLink::_ipAddressDeleted(struct nlmsghdr *nlp)
+void LinuxNetLink::_ipAddressAdded(struct nlmsghdr *nlp)
 {
+	int ifidx = -1;
+	const InetAddress addr(_parseIpAddressMessage(nlp,ifidx));
+	if (!addr)
+		return;
+
+	{
+		Mutex::Lock al(_addr_m);
+		_addresses[ifidx].insert(addr);
+	}
+	_ifEvents.fetch_add(1,std::memory_order_relaxed);
+
 #ifdef ZT_NETLINK_TRACE
-	struct ifaddrmsg *ifap = (struct ifaddrmsg *)NLMSG_DATA(nlp);
-	struct rtattr *rtap = (struct rtattr *)IFA_RTA(ifap);
-	int ifal = IFA_PAYLOAD(nlp);
+	char tmp[64];
+	fprintf(stderr,"Added IP Address %s if %d\n", addr.toIpString(tmp), ifidx);
+#endif
+}
 
-	char addr[40] = {0};
-	char local[40] = {0};
-	char label[40] = {0};
-	char bcast[40] = {0};
+void LinuxNetLink::_ipAddressDeleted(struct nlmsghdr *nlp)
+{
+	int ifidx = -1;
+	const InetAddress addr(_parseIpAddressMessage(nlp,ifidx));
+	if (!addr)
+		return;
 
-	for(;RTA_OK(rtap, ifal); rtap=RTA_NEXT(rtap,ifal))
 	{
-		switch(rtap->rta_type) {
-		case IFA_ADDRESS:
-			inet_ntop(ifap->ifa_family, RTA_DATA(rtap), addr, 40);
-			break;
-		case IFA_LOCAL:
-			inet_ntop(ifap->ifa_family, RTA_DATA(rtap), local, 40);
-			break;
-		case IFA_LABEL:
-			memcpy(label, RTA_DATA(rtap), 40);
-			break;
-		case IFA_BROADCAST:
-			inet_ntop(ifap->ifa_family, RTA_DATA(rtap), bcast, 40);
-			break;
+		Mutex::Lock al(_addr_m);
+		std::map< int,std::set<InetAddress> >::iterator a(_addresses.find(ifidx));
+		if (a != _addresses.end()) {
+			a->second.erase(addr);
+			if (a->second.empty())
+				_addresses.erase(a);
 		}
 	}
+	_ifEvents.fetch_add(1,std::memory_order_relaxed);
 
-	fprintf(stderr, "Removed IP Address %s local: %s label: %s broadcast: %s\n", addr, local, label, bcast);
+#ifdef ZT_NETLINK_TRACE
+	char tmp[64];
+	fprintf(stderr, "Removed IP Address %s if %d\n", addr.toIpString(tmp), ifidx);
 #endif
 }
 
@@ -492,12 +515,16 @@ void LinuxNetLink::_linkAdded(struct nlmsghdr *nlp)
 	{
 		Mutex::Lock l(_if_m);
 		struct iface_entry &entry = _interfaces[ifip->ifi_index];
+		if (entry.ifacename[0])
+			_ifNameIndex.erase(entry.ifacename); // renamed interface
 		entry.index = ifip->ifi_index;
 		memcpy(entry.ifacename, ifname, sizeof(ifname));
 		snprintf(entry.mac,sizeof(entry.mac),"%.02x:%.02x:%.02x:%.02x:%.02x:%.02x",(unsigned int)mac_bin[0],(unsigned int)mac_bin[1],(unsigned int)mac_bin[2],(unsigned int)mac_bin[3],(unsigned int)mac_bin[4],(unsigned int)mac_bin[5]);
 		memcpy(entry.mac_bin, mac_bin, 6);
 		entry.mtu = mtu;
+		_ifNameIndex[entry.ifacename] = ifip->ifi_index;
 	}
+	_ifEvents.fetch_add(1,std::memory_order_relaxed);
 }
 
 void LinuxNetLink::_linkDeleted(struct nlmsghdr *nlp)
@@ -525,10 +552,18 @@ void LinuxNetLink::_linkDeleted(struct nlmsghdr *nlp)
 
 	{
 		Mutex::Lock l(_if_m);
-		if(_interfaces.contains(ifip->ifi_index)) {
+		const iface_entry *ife = _interfaces.get(ifip->ifi_index);
+		if (ife) {
+			_ifNameIndex.erase(ife->ifacename);
 			_interfaces.erase(ifip->ifi_index);
 		}
 	}
+
+	{
+		Mutex::Lock al(_addr_m);
+		_addresses.erase(ifip->ifi_index);
+	}
+	_ifEvents.fetch_add(1,std::memory_order_relaxed);
 }
 
 void LinuxNetLink::_requestIPv4Routes()
@@ -688,6 +723,57 @@ void LinuxNetLink::_requestInterfaceList()
 	close(fd);
 }
 
+void LinuxNetLink::_requestIPAddresses()
+{
+	int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+	if (fd == -1) {
+		fprintf(stderr, "Error opening RTNETLINK socket: %s\n", strerror(errno));
+		return;
+	}
+
+	_setSocketTimeout(fd);
+
+	struct sockaddr_nl la;
+	la.nl_family = AF_NETLINK;
+	la.nl_pid = 0; //getpid();
+	la.nl_groups = RTMGRP_IPV4_IFADDR|RTMGRP_IPV6_IFADDR;
+	if(bind(fd, (struct sockaddr*)&la, sizeof(struct sockaddr_nl))) {
+		fprintf(stderr, "Error binding RTNETLINK (_requestIPAddresses #1): %s\n", strerror(errno));
+		close(fd);
+		return;
+	}
+
+	struct nl_adr_req req;
+	bzero(&req, sizeof(req));
+	req.nl.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+	req.nl.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.nl.nlmsg_type = RTM_GETADDR;
+	req.nl.nlmsg_pid = 0;
+	req.nl.nlmsg_seq = ++_seq;
+	req.ifa.ifa_family = AF_UNSPEC;
+
+	struct sockaddr_nl pa;
+	bzero(&pa, sizeof(pa));
+	pa.nl_family = AF_NETLINK;
+
+	struct msghdr msg;
+	bzero(&msg, sizeof(msg));
+	msg.msg_name = (void*)&pa;
+	msg.msg_namelen = sizeof(pa);
+
+	struct iovec iov;
+	bzero(&iov, sizeof(iov));
+	iov.iov_base = (void*)&req.nl;
+	iov.iov_len = req.nl.nlmsg_len;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	sendmsg(fd, &msg, 0);
+
+	_doRecv(fd);
+
+	close(fd);
+}
+
 void LinuxNetLink::addRoute(const InetAddress &target, const InetAddress &via, const InetAddress &src, const char *ifaceName)
 {
 	if (!target) return;
@@ -799,6 +885,15 @@ void LinuxNetLink::addRoute(const InetAddress &target, const InetAddress &via, c
 	req.rt.rtm_dst_len = target.netmaskBits();
 	req.rt.rtm_flags = 0;
 
+	{
+		Mutex::Lock bl(_routeBatch_m);
+		if (_routeBatchActive) {
+			_appendRouteBatch(&req.nl);
+			close(fd);
+			return;
+		}
+	}
+
 	struct sockaddr_nl pa;
 	bzero(&pa, sizeof(pa));
 	pa.nl_family = AF_NETLINK;
@@ -914,6 +1009,15 @@ void LinuxNetLink::delRoute(const InetAddress &target, const InetAddress &via, c
 	req.rt.rtm_dst_len = target.netmaskBits();
 	req.rt.rtm_flags = 0;
 
+	{
+		Mutex::Lock bl(_routeBatch_m);
+		if (_routeBatchActive) {
+			_appendRouteBatch(&req.nl);
+			close(fd);
+			return;
+		}
+	}
+
 	struct sockaddr_nl pa;
 	bzero(&pa, sizeof(pa));
 	pa.nl_family = AF_NETLINK;
@@ -936,6 +1040,80 @@ void LinuxNetLink::delRoute(const InetAddress &target, const InetAddress &via, c
 	close(fd);
 }
 
+void LinuxNetLink::_appendRouteBatch(const struct nlmsghdr *nl)
+{
+	// assumes _routeBatch_m is locked
+	const unsigned int len = nl->nlmsg_len;
+	const unsigned int alignedLen = NLMSG_ALIGN(len);
+	if ((_routeBatch.empty())||((_routeBatch.back().length() + alignedLen) > (unsigned long)(ZT_NL_BUF_SIZE / 2))) {
+		_routeBatch.push_back(std::string());
+	}
+	std::string &b = _routeBatch.back();
+	b.append(reinterpret_cast<const char *>(nl),len);
+	b.append(alignedLen - len,(char)0);
+}
+
+void LinuxNetLink::beginRouteBatch()
+{
+	Mutex::Lock bl(_routeBatch_m);
+	_routeBatch.clear();
+	_routeBatchActive = true;
+}
+
+void LinuxNetLink::commitRouteBatch()
+{
+	std::vector<std::string> batch;
+	{
+		Mutex::Lock bl(_routeBatch_m);
+		_routeBatchActive = false;
+		batch.swap(_routeBatch);
+	}
+	if (batch.empty())
+		return;
+
+	int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+	if (fd == -1) {
+		fprintf(stderr, "Error opening RTNETLINK socket: %s\n", strerror(errno));
+		return;
+	}
+
+	_setSocketTimeout(fd);
+
+	struct sockaddr_nl la;
+	bzero(&la, sizeof(la));
+	la.nl_family = AF_NETLINK;
+	la.nl_pid = 0;
+
+	if(bind(fd, (struct sockaddr*)&la, sizeof(struct sockaddr_nl))) {
+		fprintf(stderr, "Error binding RTNETLINK (commitRouteBatch): %s\n", strerror(errno));
+		close(fd);
+		return;
+	}
+
+	struct sockaddr_nl pa;
+	bzero(&pa, sizeof(pa));
+	pa.nl_family = AF_NETLINK;
+
+	for(std::vector<std::string>::const_iterator b(batch.begin());b!=batch.end();++b) {
+		struct msghdr msg;
+		bzero(&msg, sizeof(msg));
+		msg.msg_name = (void*)&pa;
+		msg.msg_namelen = sizeof(pa);
+
+		struct iovec iov;
+		bzero(&iov, sizeof(iov));
+		iov.iov_base = (void*)b->data();
+		iov.iov_len = b->length();
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		sendmsg(fd, &msg, 0);
+
+		_doRecv(fd);
+	}
+
+	close(fd);
+}
+
 void LinuxNetLink::addAddress(const InetAddress &addr, const char *iface)
 {
 	int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
@@ -1166,10 +1344,28 @@ void LinuxNetLink::removeAddress(const InetAddress &addr, const char *iface)
 	close(fd);
 }
 
+bool LinuxNetLink::getIfAddrs(std::vector< std::pair<InetAddress,std::string> > &addrs)
+{
+	const unsigned long before = (unsigned long)addrs.size();
+	Mutex::Lock al(_addr_m);
+	Mutex::Lock ifl(_if_m);
+	for(std::map< int,std::set<InetAddress> >::const_iterator a(_addresses.begin());a!=_addresses.end();++a) {
+		const iface_entry *ife = _interfaces.get(a->first);
+		if (!ife)
+			continue;
+		for(std::set<InetAddress>::const_iterator ip(a->second.begin());ip!=a->second.end();++ip)
+			addrs.push_back(std::pair<InetAddress,std::string>(*ip,std::string(ife->ifacename)));
+	}
+	return ((unsigned long)addrs.size() > before);
+}
+
 bool LinuxNetLink::routeIsSet(const InetAddress &target, const InetAddress &via, const InetAddress &src, const char *ifname)
 {
 	Mutex::Lock rl(_routes_m);
-	const std::set<LinuxNetLink::Route> &rs = _routes[target];
+	std::map< InetAddress,std::set<LinuxNetLink::Route> >::const_iterator rt(_routes.find(target));
+	if (rt == _routes.end())
+		return false;
+	const std::set<LinuxNetLink::Route> &rs = rt->second;
 	for(std::set<LinuxNetLink::Route>::const_iterator ri(rs.begin());ri!=rs.end();++ri) {
 		if ((ri->via == via)&&(ri->src == src)) {
 			if (ifname) {
@@ -1188,17 +1384,8 @@ bool LinuxNetLink::routeIsSet(const InetAddress &target, const InetAddress &via,
 int LinuxNetLink::_indexForInterface(const char *iface)
 {
 	Mutex::Lock l(_if_m);
-	int interface_index = -1;
-	Hashtable<int, iface_entry>::Iterator iter(_interfaces);
-	int *k = NULL;
-	iface_entry *v = NULL;
-	while(iter.next(k,v)) {
-		if(strcmp(iface, v->ifacename) == 0) {
-			interface_index = v->index;
-			break;
-		}
-	}
-	return interface_index;
+	std::map<std::string,int>::const_iterator idx(_ifNameIndex.find(iface));
+	return ((idx == _ifNameIndex.end()) ? -1 : idx->second);
 }
 
 } // namespace ZeroTier
@@ -21,6 +21,9 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <string>
+#include <utility>
+#include <atomic>
 
 #include <sys/socket.h>
 #include <asm/types.h>
@@ -94,11 +97,48 @@ public:
 	void addRoute(const InetAddress &target, const InetAddress &via, const InetAddress &src, const char *ifaceName);
 	void delRoute(const InetAddress &target, const InetAddress &via, const InetAddress &src, const char *ifaceName);
 
+	/**
+	 * Begin collecting route add/del requests into a batch
+	 *
+	 * While a batch is open, addRoute() and delRoute() queue their netlink
+	 * messages instead of each opening a socket and waiting for an ack.
+	 * commitRouteBatch() sends everything queued as multi-message netlink
+	 * datagrams over a single socket, which makes applying hundreds of
+	 * managed routes (network join/leave) near-instant instead of one
+	 * round trip per route.
+	 */
+	void beginRouteBatch();
+
+	/**
+	 * Send all batched route requests and close the batch
+	 */
+	void commitRouteBatch();
+
 	void addAddress(const InetAddress &addr, const char *iface);
 	void removeAddress(const InetAddress &addr, const char *iface);
 
 	bool routeIsSet(const InetAddress &target, const InetAddress &via, const InetAddress &src, const char *ifname);
 
+	/**
+	 * Copy all cached interface addresses as (address, interface name) pairs
+	 *
+	 * The cache is populated by an RTM_GETADDR dump at startup and kept
+	 * current by the netlink multicast subscription, so this never touches
+	 * the kernel. Temporary (privacy) IPv6 addresses are excluded.
+	 *
+	 * @param addrs Vector to which addresses are appended
+	 * @return True if anything was appended (false means caller should fall back to another enumeration method)
+	 */
+	bool getIfAddrs(std::vector< std::pair<InetAddress,std::string> > &addrs);
+
+	/**
+	 * Monotonic counter incremented on every link or address change event
+	 *
+	 * Pollers can compare this against a previously observed value to learn
+	 * cheaply whether interfaces or addresses have changed at all since then.
+	 */
+	inline uint64_t interfaceEventCounter() const { return _ifEvents.load(std::memory_order_relaxed); }
+
 	void threadMain() throw();
 
 private:
@@ -112,7 +152,10 @@ private:
 	void _ipAddressAdded(struct nlmsghdr *nlp);
 	void _ipAddressDeleted(struct nlmsghdr *nlp);
 
+	void _appendRouteBatch(const struct nlmsghdr *nl);
+
 	void _requestInterfaceList();
+	void _requestIPAddresses();
 	void _requestIPv4Routes();
 	void _requestIPv6Routes();
 
@@ -128,6 +171,16 @@ private:
 	std::map< InetAddress,std::set<LinuxNetLink::Route> > _routes;
 	Mutex _routes_m;
 
+	// Netlink route messages queued while a batch is open, pre-chunked so
+	// each element fits in one datagram
+	std::vector<std::string> _routeBatch;
+	bool _routeBatchActive;
+	Mutex _routeBatch_m;
+
+	std::map< int,std::set<InetAddress> > _addresses; // interface index -> assigned addresses
+	Mutex _addr_m;
+	std::atomic<uint64_t> _ifEvents;
+
 	struct iface_entry {
 		iface_entry()
 		{ memset(this,0,sizeof(iface_entry)); }
@@ -138,6 +191,7 @@ private:
 		unsigned int mtu;
 	};
 	Hashtable<int, iface_entry> _interfaces;
+	std::map<std::string,int> _ifNameIndex; // interface name -> index, kept in sync with _interfaces
 	Mutex _if_m;
 
 	// socket communication vars;
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c)2013-2020 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2025-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+#ifndef ZT_LINUXURINGENGINE_HPP
+#define ZT_LINUXURINGENGINE_HPP
+
+#include "../node/Constants.hpp"
+
+#if defined(__LINUX__) && defined(ZT_USE_IO_URING)
+
+#include <errno.h>
+#include <liburing.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "../node/Mutex.hpp"
+#include "Phy.hpp"
+
+#include <vector>
+
+// Number of outstanding receive operations kept queued on the ring
+#define ZT_URING_RX_SLOTS 256
+
+// Receive buffer size per slot -- must hold a full ZeroTier wire packet
+#define ZT_URING_RX_BUF_SIZE 4096
+
+namespace ZeroTier {
+
+/**
+ * io_uring based receive engine for the UDP wire sockets (opt-in)
+ *
+ * When enabled this takes over readability notification for the UDP sockets
+ * Binder creates. A fixed set of receive slots with preallocated buffers is
+ * kept submitted to the kernel, so completed datagrams arrive in batches and
+ * are handed to the handler without a per-packet recvfrom() syscall. TCP
+ * fallback, HTTP control plane, and all other sockets stay on Phy<>.
+ *
+ * The handler must implement phyOnDatagram() with the same signature Phy<>
+ * expects. Completions are processed on whatever thread calls poll(), which
+ * may be (and in OneService is) a thread other than the Phy<> loop; the core
+ * Node is safe to call from multiple I/O threads.
+ */
+template <typename HANDLER_TYPE> class LinuxUringEngine
+{
+  private:
+	struct _RxSlot
+	{
+		PhySocket* sock;
+		int fd;
+		struct sockaddr_storage from;
+		struct msghdr msg;
+		struct iovec iov;
+		unsigned char buf[ZT_URING_RX_BUF_SIZE];
+	};
+
+  public:
+	LinuxUringEngine(HANDLER_TYPE* handler) : _handler(handler), _ok(false), _socketsDirty(false)
+	{
+		memset(&_ring, 0, sizeof(_ring));
+		if (io_uring_queue_init(ZT_URING_RX_SLOTS * 2, &_ring, 0) == 0)
+			_ok = true;
+		for (unsigned int i = 0; i < ZT_URING_RX_SLOTS; ++i) {
+			_slots[i].sock = (PhySocket*)0;
+			_slots[i].fd = -1;
+		}
+	}
+
+	~LinuxUringEngine()
+	{
+		if (_ok)
+			io_uring_queue_exit(&_ring);
+	}
+
+	/**
+	 * @return True if the ring was successfully created (kernel support present)
+	 */
+	inline bool ok() const
+	{
+		return _ok;
+	}
+
+	/**
+	 * Set or update the UDP sockets this engine receives from
+	 *
+	 * Safe to call from another thread (e.g. after Binder::refresh()); the
+	 * new socket set is picked up on the next poll() pass. Receive slots are
+	 * spread evenly across all supplied sockets.
+	 *
+	 * @param socks Bound UDP sockets (descriptors obtained via Phy::getDescriptor())
+	 */
+	inline void setSockets(const std::vector<PhySocket*>& socks)
+	{
+		Mutex::Lock _l(_sockets_m);
+		_sockets = socks;
+		_socketsDirty = true;
+	}
+
+	/**
+	 * Submit pending receives and process a batch of completions
+	 *
+	 * @param timeoutMs Maximum time to block waiting for completions
+	 */
+	inline void poll(unsigned long timeoutMs)
+	{
+		if (! _ok)
+			return;
+
+		if (_socketsDirty)
+			_rearmAll();
+
+		io_uring_submit(&_ring);
+
+		struct __kernel_timespec ts;
+		ts.tv_sec = timeoutMs / 1000;
+		ts.tv_nsec = (long long)(timeoutMs % 1000) * 1000000LL;
+		struct io_uring_cqe* cqe = (struct io_uring_cqe*)0;
+		if (io_uring_wait_cqe_timeout(&_ring, &cqe, &ts) < 0)
+			return;
+
+		// Drain everything that has completed, not just the one we waited for
+		while (cqe) {
+			_RxSlot* const slot = reinterpret_cast<_RxSlot*>(io_uring_cqe_get_data(cqe));
+			const int n = cqe->res;
+			io_uring_cqe_seen(&_ring, cqe);
+			if (slot) {
+				if (n > 0) {
+					try {
+						_handler->phyOnDatagram(slot->sock, (void**)0, (const struct sockaddr*)0, (const struct sockaddr*)&(slot->from), (void*)slot->buf, (unsigned long)n);
+					}
+					catch (...) {
+					}
+				}
+				if (! _socketsDirty)
+					_arm(slot, slot->sock, slot->fd);
+			}
+			cqe = (struct io_uring_cqe*)0;
+			if (io_uring_peek_cqe(&_ring, &cqe) < 0)
+				break;
+		}
+	}
+
+  private:
+	inline void _arm(_RxSlot* slot, PhySocket* sock, int fd)
+	{
+		struct io_uring_sqe* const sqe = io_uring_get_sqe(&_ring);
+		if (! sqe)
+			return;
+		slot->sock = sock;
+		slot->fd = fd;
+		slot->iov.iov_base = slot->buf;
+		slot->iov.iov_len = sizeof(slot->buf);
+		memset(&slot->msg, 0, sizeof(slot->msg));
+		slot->msg.msg_name = &slot->from;
+		slot->msg.msg_namelen = sizeof(slot->from);
+		slot->msg.msg_iov = &slot->iov;
+		slot->msg.msg_iovlen = 1;
+		io_uring_prep_recvmsg(sqe, fd, &slot->msg, 0);
+		io_uring_sqe_set_data(sqe, (void*)slot);
+	}
+
+	inline void _rearmAll()
+	{
+		std::vector<PhySocket*> socks;
+		{
+			Mutex::Lock _l(_sockets_m);
+			socks = _sockets;
+			_socketsDirty = false;
+		}
+
+		// Cancel anything outstanding, then reassign all slots round-robin
+		// across the current socket set. Completions for canceled operations
+		// come back with -ECANCELED and are ignored by poll().
+		struct io_uring_sqe* sqe;
+		for (unsigned int i = 0; i < ZT_URING_RX_SLOTS; ++i) {
+			if (_slots[i].fd >= 0) {
+				sqe = io_uring_get_sqe(&_ring);
+				if (sqe) {
+					io_uring_prep_cancel(sqe, (void*)&(_slots[i]), 0);
+					io_uring_sqe_set_data(sqe, (void*)0);
+				}
+				_slots[i].sock = (PhySocket*)0;
+				_slots[i].fd = -1;
+			}
+		}
+		io_uring_submit(&_ring);
+		struct io_uring_cqe* cqe = (struct io_uring_cqe*)0;
+		while (io_uring_peek_cqe(&_ring, &cqe) == 0) {
+			io_uring_cqe_seen(&_ring, cqe);
+			cqe = (struct io_uring_cqe*)0;
+		}
+
+		if (socks.empty())
+			return;
+		unsigned int si = 0;
+		for (unsigned int i = 0; i < ZT_URING_RX_SLOTS; ++i) {
+			PhySocket* const s = socks[si];
+			_arm(&(_slots[i]), s, (int)Phy<HANDLER_TYPE*>::getDescriptor(s));
+			if (++si >= (unsigned int)socks.size())
+				si = 0;
+		}
+	}
+
+	HANDLER_TYPE* const _handler;
+	struct io_uring _ring;
+	_RxSlot _slots[ZT_URING_RX_SLOTS];
+	std::vector<PhySocket*> _sockets;
+	Mutex _sockets_m;
+	bool _ok;
+	volatile bool _socketsDirty;
+};
+
+}	// namespace ZeroTier
+
+#endif	 // __LINUX__ && ZT_USE_IO_URING
+
+#endif
@@ -0,0 +1,403 @@
+/*
+ * Copyright (c)2013-2020 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2025-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+#ifndef ZT_LINUXXDPENGINE_HPP
+#define ZT_LINUXXDPENGINE_HPP
+
+#include "../node/Constants.hpp"
+
+#if defined(__LINUX__) && defined(ZT_USE_AF_XDP)
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/if_xdp.h>
+#include <linux/bpf.h>
+#include <netinet/in.h>
+
+#include "../node/Mutex.hpp"
+#include "Phy.hpp"
+
+// UMEM geometry: frame count must be a power of two, frame size must hold a
+// full Ethernet frame carrying a ZeroTier wire packet
+#define ZT_XDP_NUM_FRAMES 4096
+#define ZT_XDP_FRAME_SIZE 2048
+
+// RX descriptor ring size (power of two, <= ZT_XDP_NUM_FRAMES)
+#define ZT_XDP_RX_RING_SIZE 2048
+
+#ifndef XDP_USE_NEED_WAKEUP
+#define XDP_USE_NEED_WAKEUP (1 << 3)
+#endif
+
+namespace ZeroTier {
+
+/**
+ * AF_XDP based receive engine for dedicated relay/root deployments (opt-in)
+ *
+ * This maps one NIC queue's RX ring into userspace and hands the UDP
+ * payloads of ZeroTier wire packets to the handler straight out of UMEM
+ * frames, skipping the kernel UDP stack entirely. It deliberately avoids a
+ * libbpf dependency: the operator attaches a redirect program to the
+ * interface with standard tooling (e.g. xdp-tools' xsk redirect sample) and
+ * pins its XSKMAP under /sys/fs/bpf; this engine opens the pinned map with
+ * raw bpf(2) calls and inserts its socket at the queue index. The attached
+ * program should redirect only ZeroTier's UDP port -- frames that reach us
+ * but don't parse as UDP to that port are dropped, since the kernel stack
+ * never sees redirected traffic.
+ *
+ * Receive only: replies and all other traffic stay on the standard UDP
+ * sockets, which remain the default path everywhere this engine is not
+ * explicitly configured. The handler must implement phyOnDatagram() with
+ * the signature Phy<> expects; the PhySocket passed to it is a designated
+ * reply socket (see setReplySocket()) so the core's response path works
+ * unchanged.
+ */
+template <typename HANDLER_TYPE> class LinuxXdpEngine
+{
+  private:
+	struct _Ring
+	{
+		uint32_t* producer;
+		uint32_t* consumer;
+		void* desc;
+		void* map;
+		size_t mapSize;
+	};
+
+  public:
+	/**
+	 * @param handler Handler to receive datagrams
+	 * @param ifname Interface to attach to
+	 * @param queue NIC queue index (also the XSKMAP key)
+	 * @param udpPort Only UDP datagrams to this destination port are delivered (0 to accept any)
+	 * @param xskMapPath Path to the pinned XSKMAP of the attached redirect program
+	 */
+	LinuxXdpEngine(HANDLER_TYPE* handler, const char* ifname, unsigned int queue, unsigned int udpPort, const char* xskMapPath)
+		: _handler(handler)
+		, _replySock((PhySocket*)0)
+		, _fd(-1)
+		, _umem(MAP_FAILED)
+		, _umemSize((size_t)ZT_XDP_NUM_FRAMES * (size_t)ZT_XDP_FRAME_SIZE)
+		, _udpPort(udpPort)
+		, _ok(false)
+	{
+		memset(&_fill, 0, sizeof(_fill));
+		memset(&_rx, 0, sizeof(_rx));
+
+		const unsigned int ifIndex = if_nametoindex(ifname);
+		if (! ifIndex)
+			return;
+
+		_fd = socket(AF_XDP, SOCK_RAW, 0);
+		if (_fd < 0)
+			return;
+
+		_umem = mmap((void*)0, _umemSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (_umem == MAP_FAILED) {
+			_cleanup();
+			return;
+		}
+
+		struct xdp_umem_reg ur;
+		memset(&ur, 0, sizeof(ur));
+		ur.addr = (uint64_t)((uintptr_t)_umem);
+		ur.len = (uint64_t)_umemSize;
+		ur.chunk_size = ZT_XDP_FRAME_SIZE;
+		ur.headroom = 0;
+		if (setsockopt(_fd, SOL_XDP, XDP_UMEM_REG, &ur, sizeof(ur)) != 0) {
+			_cleanup();
+			return;
+		}
+
+		int sz = ZT_XDP_NUM_FRAMES;
+		if (setsockopt(_fd, SOL_XDP, XDP_UMEM_FILL_RING, &sz, sizeof(sz)) != 0) {
+			_cleanup();
+			return;
+		}
+		sz = ZT_XDP_NUM_FRAMES;
+		if (setsockopt(_fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &sz, sizeof(sz)) != 0) {
+			_cleanup();
+			return;
+		}
+		sz = ZT_XDP_RX_RING_SIZE;
+		if (setsockopt(_fd, SOL_XDP, XDP_RX_RING, &sz, sizeof(sz)) != 0) {
+			_cleanup();
+			return;
+		}
+
+		struct xdp_mmap_offsets off;
+		memset(&off, 0, sizeof(off));
+		socklen_t optlen = sizeof(off);
+		if (getsockopt(_fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) != 0) {
+			_cleanup();
+			return;
+		}
+
+		_fill.mapSize = (size_t)off.fr.desc + ((size_t)ZT_XDP_NUM_FRAMES * sizeof(uint64_t));
+		_fill.map = mmap((void*)0, _fill.mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, XDP_UMEM_PGOFF_FILL_RING);
+		if (_fill.map == MAP_FAILED) {
+			_fill.map = (void*)0;
+			_cleanup();
+			return;
+		}
+		_fill.producer = (uint32_t*)((uint8_t*)_fill.map + off.fr.producer);
+		_fill.consumer = (uint32_t*)((uint8_t*)_fill.map + off.fr.consumer);
+		_fill.desc = (void*)((uint8_t*)_fill.map + off.fr.desc);
+
+		_rx.mapSize = (size_t)off.rx.desc + ((size_t)ZT_XDP_RX_RING_SIZE * sizeof(struct xdp_desc));
+		_rx.map = mmap((void*)0, _rx.mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, XDP_PGOFF_RX_RING);
+		if (_rx.map == MAP_FAILED) {
+			_rx.map = (void*)0;
+			_cleanup();
+			return;
+		}
+		_rx.producer = (uint32_t*)((uint8_t*)_rx.map + off.rx.producer);
+		_rx.consumer = (uint32_t*)((uint8_t*)_rx.map + off.rx.consumer);
+		_rx.desc = (void*)((uint8_t*)_rx.map + off.rx.desc);
+
+		struct sockaddr_xdp sxdp;
+		memset(&sxdp, 0, sizeof(sxdp));
+		sxdp.sxdp_family = AF_XDP;
+		sxdp.sxdp_ifindex = ifIndex;
+		sxdp.sxdp_queue_id = queue;
+		sxdp.sxdp_flags = XDP_USE_NEED_WAKEUP;
+		if (bind(_fd, (const struct sockaddr*)&sxdp, sizeof(sxdp)) != 0) {
+			// Older kernels reject the wakeup flag; the engine works without it
+			sxdp.sxdp_flags = 0;
+			if (bind(_fd, (const struct sockaddr*)&sxdp, sizeof(sxdp)) != 0) {
+				_cleanup();
+				return;
+			}
+		}
+
+		// Hand the kernel every frame to receive into
+		uint64_t* const fillDescs = (uint64_t*)_fill.desc;
+		for (unsigned int i = 0; i < ZT_XDP_NUM_FRAMES; ++i)
+			fillDescs[i] = (uint64_t)i * ZT_XDP_FRAME_SIZE;
+		__atomic_store_n(_fill.producer, (uint32_t)ZT_XDP_NUM_FRAMES, __ATOMIC_RELEASE);
+
+		// Insert our socket into the pinned XSKMAP so the attached redirect
+		// program starts steering this queue's matching frames to us
+		union bpf_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.pathname = (uint64_t)((uintptr_t)xskMapPath);
+		const int mapFd = (int)syscall(__NR_bpf, BPF_OBJ_GET, &attr, sizeof(attr));
+		if (mapFd < 0) {
+			_cleanup();
+			return;
+		}
+		memset(&attr, 0, sizeof(attr));
+		attr.map_fd = (uint32_t)mapFd;
+		attr.key = (uint64_t)((uintptr_t)&queue);
+		attr.value = (uint64_t)((uintptr_t)&_fd);
+		attr.flags = 0; // BPF_ANY
+		const int mr = (int)syscall(__NR_bpf, BPF_MAP_UPDATE_ELEM, &attr, sizeof(attr));
+		close(mapFd);
+		if (mr != 0) {
+			_cleanup();
+			return;
+		}
+
+		_ok = true;
+	}
+
+	~LinuxXdpEngine()
+	{
+		_cleanup();
+	}
+
+	/**
+	 * @return True if the socket was created, bound, and inserted into the XSKMAP
+	 */
+	inline bool ok() const
+	{
+		return _ok;
+	}
+
+	/**
+	 * Set the PhySocket passed to the handler as the local socket for received datagrams
+	 *
+	 * Replies the core generates are sent through this socket via the normal
+	 * UDP path. Safe to call from another thread (e.g. after Binder::refresh()
+	 * replaces the bound socket set).
+	 *
+	 * @param sock Bound UDP socket to attribute received datagrams to
+	 */
+	inline void setReplySocket(PhySocket* sock)
+	{
+		Mutex::Lock _l(_replySock_m);
+		_replySock = sock;
+	}
+
+	/**
+	 * Wait for and process a batch of received frames
+	 *
+	 * @param timeoutMs Maximum time to block waiting for traffic
+	 */
+	inline void poll(unsigned long timeoutMs)
+	{
+		if (! _ok)
+			return;
+
+		struct pollfd pfd;
+		pfd.fd = _fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (::poll(&pfd, 1, (int)timeoutMs) <= 0)
+			return;
+
+		PhySocket* replySock;
+		{
+			Mutex::Lock _l(_replySock_m);
+			replySock = _replySock;
+		}
+
+		const uint32_t prod = __atomic_load_n(_rx.producer, __ATOMIC_ACQUIRE);
+		uint32_t cons = *_rx.consumer;
+		if (cons == prod)
+			return;
+		const struct xdp_desc* const descs = (const struct xdp_desc*)_rx.desc;
+		while (cons != prod) {
+			const struct xdp_desc* const d = &(descs[cons & (ZT_XDP_RX_RING_SIZE - 1)]);
+			_deliver(replySock, (const uint8_t*)_umem + d->addr, (unsigned int)d->len);
+			_refill(d->addr & ~((uint64_t)ZT_XDP_FRAME_SIZE - 1));
+			++cons;
+		}
+		__atomic_store_n(_rx.consumer, cons, __ATOMIC_RELEASE);
+
+		// Kick the kernel in case the fill ring ran dry while we were busy
+		recvfrom(_fd, (void*)0, 0, MSG_DONTWAIT, (struct sockaddr*)0, (socklen_t*)0);
+	}
+
+  private:
+	// Parse a raw Ethernet frame and hand its UDP payload to the handler
+	inline void _deliver(PhySocket* replySock, const uint8_t* frame, unsigned int len)
+	{
+		if (len < 14)
+			return;
+		unsigned int etherType = ((unsigned int)frame[12] << 8) | (unsigned int)frame[13];
+		const uint8_t* p = frame + 14;
+		unsigned int rem = len - 14;
+		if (etherType == 0x8100) { // 802.1Q
+			if (rem < 4)
+				return;
+			etherType = ((unsigned int)p[2] << 8) | (unsigned int)p[3];
+			p += 4;
+			rem -= 4;
+		}
+
+		struct sockaddr_storage from;
+		memset(&from, 0, sizeof(from));
+		const uint8_t* udp = (const uint8_t*)0;
+		unsigned int udpRem = 0;
+
+		if (etherType == 0x0800) { // IPv4
+			if (rem < 20)
+				return;
+			const unsigned int ihl = ((unsigned int)p[0] & 0x0f) * 4;
+			if ((((p[0] >> 4) & 0x0f) != 4) || (ihl < 20) || (rem < (ihl + 8)) || (p[9] != 17))
+				return;
+			if ((p[6] & 0x3f) || (p[7])) // fragments never carry a full wire packet
+				return;
+			struct sockaddr_in* const s4 = (struct sockaddr_in*)&from;
+			s4->sin_family = AF_INET;
+			memcpy(&(s4->sin_addr.s_addr), p + 12, 4);
+			udp = p + ihl;
+			udpRem = rem - ihl;
+			memcpy(&(s4->sin_port), udp, 2);
+		}
+		else if (etherType == 0x86dd) { // IPv6
+			if ((rem < 48) || (((p[0] >> 4) & 0x0f) != 6) || (p[6] != 17)) // no extension header walking
+				return;
+			struct sockaddr_in6* const s6 = (struct sockaddr_in6*)&from;
+			s6->sin6_family = AF_INET6;
+			memcpy(s6->sin6_addr.s6_addr, p + 8, 16);
+			udp = p + 40;
+			udpRem = rem - 40;
+			memcpy(&(s6->sin6_port), udp, 2);
+		}
+		else {
+			return;
+		}
+
+		if (udpRem < 8)
+			return;
+		const unsigned int dport = ((unsigned int)udp[2] << 8) | (unsigned int)udp[3];
+		if ((_udpPort) && (dport != _udpPort))
+			return;
+		unsigned int payloadLen = (((unsigned int)udp[4] << 8) | (unsigned int)udp[5]);
+		if ((payloadLen < 8) || (payloadLen > udpRem))
+			return;
+		payloadLen -= 8;
+
+		try {
+			_handler->phyOnDatagram(replySock, (void**)0, (const struct sockaddr*)0, (const struct sockaddr*)&from, (void*)(udp + 8), (unsigned long)payloadLen);
+		}
+		catch (...) {
+		}
+	}
+
+	// Return a consumed frame to the fill ring
+	inline void _refill(uint64_t frameAddr)
+	{
+		uint64_t* const fillDescs = (uint64_t*)_fill.desc;
+		const uint32_t prod = *_fill.producer;
+		fillDescs[prod & (ZT_XDP_NUM_FRAMES - 1)] = frameAddr;
+		__atomic_store_n(_fill.producer, prod + 1, __ATOMIC_RELEASE);
+	}
+
+	inline void _cleanup()
+	{
+		if (_rx.map) {
+			munmap(_rx.map, _rx.mapSize);
+			_rx.map = (void*)0;
+		}
+		if (_fill.map) {
+			munmap(_fill.map, _fill.mapSize);
+			_fill.map = (void*)0;
+		}
+		if (_umem != MAP_FAILED) {
+			munmap(_umem, _umemSize);
+			_umem = MAP_FAILED;
+		}
+		if (_fd >= 0) {
+			close(_fd);
+			_fd = -1;
+		}
+		_ok = false;
+	}
+
+	HANDLER_TYPE* const _handler;
+	PhySocket* _replySock;
+	Mutex _replySock_m;
+	int _fd;
+	void* _umem;
+	const size_t _umemSize;
+	_Ring _fill;
+	_Ring _rx;
+	const unsigned int _udpPort;
+	bool _ok;
+};
+
+}	// namespace ZeroTier
+
+#endif	 // __LINUX__ && ZT_USE_AF_XDP
+
+#endif
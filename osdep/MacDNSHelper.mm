@@ -2,6 +2,12 @@
 
 #include <stdio.h>
 
+#include <map>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
 #include <SystemConfiguration/SystemConfiguration.h>
 
 namespace ZeroTier {
@@ -11,10 +17,23 @@ static void printKeys (const void* key, const void* value, void* context) {
   CFShow(value);
 }
 
-void MacDNSHelper::setDNS(uint64_t nwid, const char *domain, const std::vector<InetAddress> &servers)
+// Pending DNS changes keyed by network ID. The newest change for a network
+// replaces any older queued one, so a burst of config callbacks at boot
+// collapses into one configd commit per network, applied off the callback path.
+struct _PendingDNSChange
 {
-    SCDynamicStoreRef ds = SCDynamicStoreCreate(NULL, CFSTR("zerotier"), NULL, NULL);
+    std::string domain;
+    std::vector<InetAddress> servers;
+};
 
+static std::mutex s_dnsPending_l;
+static std::condition_variable s_dnsPending_c;
+static std::map<uint64_t, _PendingDNSChange> s_dnsPending;
+static std::mutex s_dnsApply_l; // held while talking to the dynamic store
+static bool s_dnsWorkerStarted = false;
+
+static void _applyDNS(SCDynamicStoreRef ds, uint64_t nwid, const char *domain, const std::vector<InetAddress> &servers)
+{
     CFStringRef *s = new CFStringRef[4];
     for (unsigned int i = 0; i < servers.size(); ++i) {
         char buf[64];
@@ -75,11 +94,58 @@ void MacDNSHelper::setDNS(uint64_t nwid, const char *domain, const std::vector<I
         CFRelease(s[i]);
     }
     delete[] s;
-    CFRelease(ds);
+}
+
+static void _dnsWorker()
+{
+    // Lives for the rest of the process once the first DNS change is queued.
+    std::unique_lock<std::mutex> l(s_dnsPending_l);
+    for (;;) {
+        while (s_dnsPending.empty()) {
+            s_dnsPending_c.wait(l);
+        }
+        std::map<uint64_t, _PendingDNSChange> batch;
+        batch.swap(s_dnsPending);
+        l.unlock();
+        {
+            std::lock_guard<std::mutex> al(s_dnsApply_l);
+            // One dynamic store session commits the whole batch so configd
+            // sees a single writer instead of one connection per network.
+            SCDynamicStoreRef ds = SCDynamicStoreCreate(NULL, CFSTR("zerotier"), NULL, NULL);
+            for (std::map<uint64_t, _PendingDNSChange>::iterator it(batch.begin()); it != batch.end(); ++it) {
+                _applyDNS(ds, it->first, it->second.domain.c_str(), it->second.servers);
+            }
+            CFRelease(ds);
+        }
+        l.lock();
+    }
+}
+
+void MacDNSHelper::setDNS(uint64_t nwid, const char *domain, const std::vector<InetAddress> &servers)
+{
+    // Queue the change for the worker so the network config callback returns
+    // immediately instead of serializing joins on configd round trips.
+    std::lock_guard<std::mutex> l(s_dnsPending_l);
+    _PendingDNSChange& c = s_dnsPending[nwid];
+    c.domain = domain;
+    c.servers = servers;
+    if (!s_dnsWorkerStarted) {
+        s_dnsWorkerStarted = true;
+        std::thread(&_dnsWorker).detach();
+    }
+    s_dnsPending_c.notify_one();
 }
 
 void MacDNSHelper::removeDNS(uint64_t nwid)
 {
+    // Removals happen on network leave and service shutdown, where we must not
+    // exit before the entry is gone, so they run synchronously. Drop any
+    // queued set for this network first so the worker cannot re-add it.
+    {
+        std::lock_guard<std::mutex> l(s_dnsPending_l);
+        s_dnsPending.erase(nwid);
+    }
+    std::lock_guard<std::mutex> al(s_dnsApply_l);
     SCDynamicStoreRef ds = SCDynamicStoreCreate(NULL, CFSTR("zerotier"), NULL, NULL);
 
     char buf[256] = {0};
@@ -61,6 +61,9 @@ static const ZeroTier::MulticastGroup _blindWildcardMulticastGroup(ZeroTier::MAC
 
 #define MACOS_FETH_MAX_MTU_SYSCTL "net.link.fake.max_mtu"
 
+// Maximum bytes of framed packets buffered for the agent before put() sheds load
+#define ZT_MACETHERNETTAP_PUT_BUF_MAX (1024 * 1024)
+
 namespace ZeroTier {
 
 static Mutex globalTapCreateLock;
@@ -80,6 +83,7 @@ MacEthernetTap::MacEthernetTap(
 	_arg(arg),
 	_nwid(nwid),
 	_homePath(homePath),
+	_putRun(true),
 	_mtu(mtu),
 	_metric(metric),
 	_devNo(0),
@@ -236,6 +240,7 @@ MacEthernetTap::MacEthernetTap(
 	}
 
 	_thread = Thread::start(this);
+	_putThread = std::thread([this]() { this->_flushThreadMain(); });
 }
 
 MacEthernetTap::~MacEthernetTap()
@@ -247,6 +252,13 @@ MacEthernetTap::~MacEthernetTap()
 	MacDNSHelper::removeDNS(_nwid);
 	MacDNSHelper::removeIps(_nwid);
 
+	{
+		std::lock_guard<std::mutex> pl(_putBuf_m);
+		_putRun = false;
+		_putBuf_c.notify_all();
+	}
+	_putThread.join();
+
 	Mutex::Lock _gl(globalTapCreateLock);
 	::write(_shutdownSignalPipe[1],"\0",1); // causes thread to exit
 
@@ -385,7 +397,6 @@ std::vector<InetAddress> MacEthernetTap::ips() const
 
 void MacEthernetTap::put(const MAC &from,const MAC &to,unsigned int etherType,const void *data,unsigned int len)
 {
-	struct iovec iov[3];
 	unsigned char hdr[15];
 	uint16_t l;
 	if ((_agentStdin > 0)&&(len <= _mtu)&&(_enabled)) {
@@ -395,15 +406,53 @@ void MacEthernetTap::put(const MAC &from,const MAC &to,unsigned int etherType,co
 		hdr[13] = (unsigned char)((etherType >> 8) & 0xff);
 		hdr[14] = (unsigned char)(etherType & 0xff);
 		l = (uint16_t)(len + 15);
-		iov[0].iov_base = &l;
-		iov[0].iov_len = 2;
-		iov[1].iov_base = hdr;
-		iov[1].iov_len = 15;
-		iov[2].iov_base = const_cast<void *>(data);
-		iov[2].iov_len = len;
+
+		// Append the framed packet to the pending buffer; the flush thread
+		// writes everything queued in one syscall. If the agent has stalled
+		// and a megabyte has piled up, shed load here rather than buffering
+		// without bound.
+		std::lock_guard<std::mutex> pl(_putBuf_m);
+		if (_putBuf.size() >= ZT_MACETHERNETTAP_PUT_BUF_MAX)
+			return;
+		const uint8_t *const lp = reinterpret_cast<const uint8_t *>(&l);
+		_putBuf.insert(_putBuf.end(),lp,lp + 2);
+		_putBuf.insert(_putBuf.end(),hdr,hdr + 15);
+		_putBuf.insert(_putBuf.end(),reinterpret_cast<const uint8_t *>(data),reinterpret_cast<const uint8_t *>(data) + len);
+		_putBuf_c.notify_one();
+	}
+}
+
+void MacEthernetTap::_flushThreadMain()
+{
+	std::vector<uint8_t> batch;
+	batch.reserve(16384);
+	for(;;) {
+		{
+			std::unique_lock<std::mutex> pl(_putBuf_m);
+			while ((_putBuf.empty())&&(_putRun))
+				_putBuf_c.wait(pl);
+			if (!_putRun)
+				break;
+			batch.swap(_putBuf);
+		}
+
+		// _putLock serializes with control commands written to the same pipe
 		_putLock.lock();
-		writev(_agentStdin,iov,3);
+		const uint8_t *p = batch.data();
+		unsigned long remaining = (unsigned long)batch.size();
+		while (remaining > 0) {
+			const long n = (long)::write(_agentStdin,p,remaining);
+			if (n < 0) {
+				if ((errno == EINTR)||(errno == EAGAIN))
+					continue;
+				break; // agent pipe is broken; drop the rest of the batch
+			}
+			p += n;
+			remaining -= (unsigned long)n;
+		}
 		_putLock.unlock();
+
+		batch.clear();
 	}
 }
 
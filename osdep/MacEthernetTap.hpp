@@ -28,6 +28,9 @@
 #include <stdexcept>
 #include <string>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace ZeroTier {
 
@@ -62,6 +65,8 @@ public:
 		throw();
 
 private:
+	void _flushThreadMain();
+
 	void (*_handler)(void *,void *,uint64_t,const MAC &,const MAC &,unsigned int,unsigned int,const void *,unsigned int);
 	void *_arg;
 	uint64_t _nwid;
@@ -70,6 +75,14 @@ private:
 	std::string _dev;
 	std::vector<MulticastGroup> _multicastGroups;
 	Mutex _putLock;
+
+	// Frames queued by put() are flushed to the agent pipe by a dedicated
+	// writer thread, so many frames amortize into one syscall under load
+	std::vector<uint8_t> _putBuf;
+	std::thread _putThread;
+	std::mutex _putBuf_m;
+	std::condition_variable _putBuf_c;
+	bool _putRun;
 	unsigned int _mtu;
 	unsigned int _metric;
 	unsigned int _devNo;
@@ -554,6 +554,20 @@ bool ManagedRoute::sync()
 }
 #endif
 
+void ManagedRoute::beginRouteUpdates()
+{
+#ifdef __LINUX__
+	LinuxNetLink::getInstance().beginRouteBatch();
+#endif
+}
+
+void ManagedRoute::commitRouteUpdates()
+{
+#ifdef __LINUX__
+	LinuxNetLink::getInstance().commitRouteBatch();
+#endif
+}
+
 void ManagedRoute::remove()
 {
 #ifdef __WINDOWS__
@@ -58,6 +58,21 @@ public:
 	 */
 	void remove();
 
+	/**
+	 * Begin batching route table changes made by sync()/remove()
+	 *
+	 * On platforms with a batching route interface (currently Linux) changes
+	 * made between this call and commitRouteUpdates() are applied in one
+	 * transaction. A no-op elsewhere, so callers can always bracket bulk
+	 * route application with these.
+	 */
+	static void beginRouteUpdates();
+
+	/**
+	 * Apply any batched route table changes
+	 */
+	static void commitRouteUpdates();
+
 	inline const InetAddress &target() const { return _target; }
 	inline const InetAddress &via() const { return _via; }
 	inline const InetAddress &src() const { return _src; }
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c)2019 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2025-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+#ifndef ZT_NEIGHBORRESPONDER_HPP
+#define ZT_NEIGHBORRESPONDER_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+#include <thread>
+
+#include "../node/Constants.hpp"
+#include "../node/Hashtable.hpp"
+#include "../node/MAC.hpp"
+#include "../node/Mutex.hpp"
+
+#include "Arp.hpp"
+#include "NeighborDiscovery.hpp"
+#include "BlockingQueue.hpp"
+#include "OSUtils.hpp"
+
+/**
+ * Maximum number of ARP/ND frames queued for the responder thread
+ */
+#define ZT_NEIGHBOR_RESPONDER_MAX_QUEUE 1024
+
+/**
+ * Maximum number of queued frames answered in one batch before checking for shutdown
+ */
+#define ZT_NEIGHBOR_RESPONDER_BATCH_MAX 64
+
+/**
+ * Per-source rate limit window (ms)
+ */
+#define ZT_NEIGHBOR_RESPONDER_RATE_WINDOW 1000
+
+/**
+ * Maximum ARP/ND frames accepted per source MAC per window
+ */
+#define ZT_NEIGHBOR_RESPONDER_RATE_LIMIT 64
+
+namespace ZeroTier {
+
+/**
+ * Asynchronous ARP / IPv6 neighbor discovery responder
+ *
+ * On bridges an ND or ARP storm (e.g. an ff02::1 scan) would otherwise
+ * synthesize every reply inline in the tap frame callback, serializing
+ * unicast forwarding behind responder work. This offloads that work: the
+ * frame path calls post(), which copies the frame and returns immediately,
+ * and a dedicated thread drains the queue in batches and hands generated
+ * replies to a sink callback for injection.
+ *
+ * Frames from sources exceeding a per-source rate limit and frames that
+ * arrive while the queue is full are dropped at post() time; ARP and ND
+ * are idempotent query/response protocols, so peers simply retry.
+ *
+ * The responder thread is the only caller of the wrapped
+ * NeighborDiscovery's processIncomingND(), whose cache is not itself
+ * thread-safe; other users of that instance (e.g. query()) must
+ * synchronize on ndLock().
+ */
+class NeighborResponder
+{
+public:
+	/**
+	 * Sink invoked on the responder thread for every generated reply
+	 *
+	 * @param arg Sink argument supplied at construction
+	 * @param reply Reply frame payload (ARP or ICMPv6 ND, no Ethernet header)
+	 * @param len Length of reply in bytes
+	 * @param dest Destination MAC for reply
+	 * @param ipv6 True if reply is an IPv6 neighbor advertisement, false if ARP
+	 */
+	typedef void (*ReplySink)(void *arg,const void *reply,unsigned int len,const MAC &dest,bool ipv6);
+
+	/**
+	 * @param arp ARP cache/responder (must outlive this object, is internally thread-safe)
+	 * @param nd IPv6 ND cache/responder (must outlive this object, see ndLock())
+	 * @param sink Callback for generated replies
+	 * @param sinkArg Argument passed to sink
+	 */
+	NeighborResponder(Arp *arp,NeighborDiscovery *nd,ReplySink sink,void *sinkArg) :
+		_arp(arp),
+		_nd(nd),
+		_sink(sink),
+		_sinkArg(sinkArg),
+		_sources(128)
+	{
+		_thread = std::thread([this]() { this->_threadMain(); });
+	}
+
+	~NeighborResponder()
+	{
+		_queue.stop();
+		_thread.join();
+	}
+
+	/**
+	 * Queue an inbound ARP or ND frame for asynchronous handling
+	 *
+	 * Called from the tap frame path; copies the frame and returns without
+	 * blocking on responder work.
+	 *
+	 * @param sourceMac Source MAC of frame (rate limit key)
+	 * @param localIp Local IP of receiving interface (used for ND checksums, ignored for ARP)
+	 * @param frame Frame payload (ARP or ICMPv6 ND, no Ethernet header)
+	 * @param len Length of frame
+	 * @param ipv6 True if frame is ICMPv6 ND, false if ARP
+	 * @return True if queued, false if dropped (queue full or source over rate limit)
+	 */
+	bool post(const MAC &sourceMac,const struct sockaddr_storage &localIp,const void *frame,unsigned int len,bool ipv6)
+	{
+		if ((len == 0)||(len > ZT_ARP_BUF_LENGTH))
+			return false;
+		if (_queue.size() >= ZT_NEIGHBOR_RESPONDER_MAX_QUEUE)
+			return false;
+		if (!_allowSource(sourceMac))
+			return false;
+
+		_WorkItem item;
+		item.ipv6 = ipv6;
+		item.sourceMac = sourceMac;
+		memcpy(&item.localIp,&localIp,sizeof(struct sockaddr_storage));
+		item.frame.assign(reinterpret_cast<const uint8_t *>(frame),reinterpret_cast<const uint8_t *>(frame) + len);
+		_queue.post(item);
+		return true;
+	}
+
+	/**
+	 * @return Lock guarding the wrapped NeighborDiscovery instance
+	 */
+	inline Mutex &ndLock() { return _nd_m; }
+
+private:
+	struct _WorkItem
+	{
+		_WorkItem() : ipv6(false),sourceMac(),localIp(),frame() {}
+		bool ipv6;
+		MAC sourceMac;
+		struct sockaddr_storage localIp;
+		std::vector<uint8_t> frame;
+	};
+
+	struct _SourceRate
+	{
+		_SourceRate() : windowStart(0),count(0) {}
+		uint64_t windowStart;
+		unsigned int count;
+	};
+
+	bool _allowSource(const MAC &sourceMac)
+	{
+		const uint64_t now = OSUtils::now();
+		Mutex::Lock l(_sources_m);
+		if (_sources.size() > (ZT_NEIGHBOR_RESPONDER_MAX_QUEUE * 4)) {
+			// Storms of spoofed source MACs could otherwise grow this without bound
+			Hashtable< MAC,_SourceRate >::Iterator i(_sources);
+			MAC *k = (MAC *)0;
+			_SourceRate *v = (_SourceRate *)0;
+			while (i.next(k,v)) {
+				if ((now - v->windowStart) >= ZT_NEIGHBOR_RESPONDER_RATE_WINDOW)
+					_sources.erase(*k);
+			}
+		}
+		_SourceRate &sr = _sources[sourceMac];
+		if ((now - sr.windowStart) >= ZT_NEIGHBOR_RESPONDER_RATE_WINDOW) {
+			sr.windowStart = now;
+			sr.count = 0;
+		}
+		if (sr.count >= ZT_NEIGHBOR_RESPONDER_RATE_LIMIT)
+			return false;
+		++sr.count;
+		return true;
+	}
+
+	void _threadMain()
+	{
+		std::vector<_WorkItem> batch;
+		batch.reserve(ZT_NEIGHBOR_RESPONDER_BATCH_MAX);
+		uint8_t response[ZT_ARP_BUF_LENGTH];
+
+		for(;;) {
+			_WorkItem item;
+			if (!_queue.get(item))
+				break;
+			batch.clear();
+			batch.push_back(item);
+			while ((batch.size() < ZT_NEIGHBOR_RESPONDER_BATCH_MAX)&&(_queue.size() > 0)) {
+				if (_queue.get(item,0) != BlockingQueue<_WorkItem>::OK)
+					break;
+				batch.push_back(item);
+			}
+
+			for(std::vector<_WorkItem>::iterator w(batch.begin());w!=batch.end();++w) {
+				unsigned int responseLen = 0;
+				MAC responseDest;
+				if (w->ipv6) {
+					Mutex::Lock l(_nd_m);
+					_nd->processIncomingND(w->frame.data(),(unsigned int)w->frame.size(),w->localIp,response,responseLen,responseDest);
+				} else {
+					_arp->processIncomingArp(w->frame.data(),(unsigned int)w->frame.size(),response,responseLen,responseDest);
+				}
+				if (responseLen > 0)
+					_sink(_sinkArg,response,responseLen,responseDest,w->ipv6);
+			}
+		}
+	}
+
+	Arp *const _arp;
+	NeighborDiscovery *const _nd;
+	Mutex _nd_m;
+	const ReplySink _sink;
+	void *const _sinkArg;
+
+	Hashtable< MAC,_SourceRate > _sources;
+	Mutex _sources_m;
+
+	BlockingQueue<_WorkItem> _queue;
+	std::thread _thread;
+};
+
+} // namespace ZeroTier
+
+#endif
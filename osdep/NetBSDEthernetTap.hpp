@@ -55,20 +55,23 @@ public:
 	virtual void scanMulticastGroups(std::vector<MulticastGroup> &added,std::vector<MulticastGroup> &removed);
 	virtual void setDns(const char *domain, const std::vector<InetAddress> &servers) {}
 
-	void threadMain()
+	/**
+	 * Drain readable frames; called from the shared kqueue poller thread
+	 */
+	void readEvent()
 		throw();
 
 private:
 	void (*_handler)(void *,uint64_t,const MAC &,const MAC &,unsigned int,unsigned int,const void *,unsigned int);
 	void *_arg;
 	uint64_t _nwid;
-	Thread _thread;
 	std::string _dev;
 	std::vector<MulticastGroup> _multicastGroups;
 	unsigned int _mtu;
 	unsigned int _metric;
 	int _fd;
-	int _shutdownSignalPipe[2];
+	char _rxBuf[8194];
+	int _rxFill;
 	volatile bool _enabled;
 };
 
@@ -103,38 +103,59 @@ bool OSUtils::redirectUnixOutputs(const char *stdoutPath,const char *stderrPath)
 }
 #endif // __UNIX_LIKE__
 
-std::vector<std::string> OSUtils::listDirectory(const char *path,bool includeDirectories)
+bool OSUtils::eachFileInDirectory(const char *path,const std::function<bool(const char *,bool)> &handler)
 {
-	std::vector<std::string> r;
-
 #ifdef __WINDOWS__
 	HANDLE hFind;
 	WIN32_FIND_DATAA ffd;
-	if ((hFind = FindFirstFileA((std::string(path) + "\\*").c_str(),&ffd)) != INVALID_HANDLE_VALUE) {
-		do {
-			if ( (strcmp(ffd.cFileName,".")) && (strcmp(ffd.cFileName,"..")) && (((ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)||(((ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)&&(includeDirectories))) )
-				r.push_back(std::string(ffd.cFileName));
-		} while (FindNextFileA(hFind,&ffd));
-		FindClose(hFind);
-	}
+	if ((hFind = FindFirstFileA((std::string(path) + "\\*").c_str(),&ffd)) == INVALID_HANDLE_VALUE)
+		return false;
+	do {
+		if ((strcmp(ffd.cFileName,"."))&&(strcmp(ffd.cFileName,".."))) {
+			if (!handler(ffd.cFileName,((ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)))
+				break;
+		}
+	} while (FindNextFileA(hFind,&ffd));
+	FindClose(hFind);
 #else
 	struct dirent de;
 	struct dirent *dptr;
 	DIR *d = opendir(path);
 	if (!d)
-		return r;
+		return false;
 	dptr = (struct dirent *)0;
 	for(;;) {
 		if (readdir_r(d,&de,&dptr))
 			break;
-		if (dptr) {
-			if ((strcmp(dptr->d_name,"."))&&(strcmp(dptr->d_name,".."))&&((dptr->d_type != DT_DIR)||(includeDirectories)))
-				r.push_back(std::string(dptr->d_name));
-		} else break;
+		if (!dptr)
+			break;
+		if ((strcmp(dptr->d_name,"."))&&(strcmp(dptr->d_name,".."))) {
+			bool isDir = (dptr->d_type == DT_DIR);
+			if (dptr->d_type == DT_UNKNOWN) {
+				// Some filesystems don't report d_type; fall back to stat
+				char tmp[4096];
+				struct stat st;
+				ztsnprintf(tmp,sizeof(tmp),"%s" ZT_PATH_SEPARATOR_S "%s",path,dptr->d_name);
+				isDir = ((stat(tmp,&st) == 0)&&(S_ISDIR(st.st_mode)));
+			}
+			if (!handler(dptr->d_name,isDir))
+				break;
+		}
 	}
 	closedir(d);
 #endif
 
+	return true;
+}
+
+std::vector<std::string> OSUtils::listDirectory(const char *path,bool includeDirectories)
+{
+	std::vector<std::string> r;
+	eachFileInDirectory(path,[&r,includeDirectories](const char *name,bool isDirectory) {
+		if ((!isDirectory)||(includeDirectories))
+			r.push_back(std::string(name));
+		return true;
+	});
 	return r;
 }
 
@@ -319,6 +340,7 @@ int64_t OSUtils::getFileSize(const char *path)
 
 bool OSUtils::readFile(const char *path,std::string &buf)
 {
+#ifdef __WINDOWS__
 	char tmp[16384];
 	FILE *f = fopen(path,"rb");
 	if (f) {
@@ -332,6 +354,54 @@ bool OSUtils::readFile(const char *path,std::string &buf)
 		return true;
 	}
 	return false;
+#else
+	// Size the buffer from st_size and read the whole file in as few
+	// syscalls as possible; startup paths read many small files in a row
+	// and the old stdio loop cost several calls per file.
+	const int fd = ::open(path,O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd,&st) != 0) {
+		::close(fd);
+		return false;
+	}
+	const unsigned long oldSize = (unsigned long)buf.length();
+	if (st.st_size > 0) {
+		buf.resize(oldSize + (unsigned long)st.st_size);
+		unsigned long got = 0;
+		while (got < (unsigned long)st.st_size) {
+			const long n = (long)::pread(fd,&(buf[oldSize + got]),(size_t)((unsigned long)st.st_size - got),(off_t)got);
+			if (n < 0) {
+				if (errno == EINTR)
+					continue;
+				buf.resize(oldSize);
+				::close(fd);
+				return false;
+			}
+			if (n == 0)
+				break; // truncated while reading
+			got += (unsigned long)n;
+		}
+		if (got < (unsigned long)st.st_size)
+			buf.resize(oldSize + got);
+	} else {
+		// Zero st_size can still mean content on special filesystems
+		char tmp[16384];
+		for(;;) {
+			const long n = (long)::read(fd,tmp,sizeof(tmp));
+			if (n > 0) {
+				buf.append(tmp,n);
+			} else if ((n < 0)&&(errno == EINTR)) {
+				continue;
+			} else {
+				break;
+			}
+		}
+	}
+	::close(fd);
+	return true;
+#endif
 }
 
 bool OSUtils::writeFile(const char *path,const void *buf,unsigned int len)
@@ -19,6 +19,7 @@
 #include <string.h>
 
 #include <list>
+#include <vector>
 #include <stdexcept>
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -35,6 +36,19 @@
 #define ZT_PHY_MAX_INTERCEPTS ZT_PHY_MAX_SOCKETS
 #define ZT_PHY_SOCKADDR_STORAGE_TYPE struct sockaddr_storage
 
+// Use WSAPoll() instead of select() on Windows: no FD_SETSIZE (64 socket)
+// ceiling and no per-call fd_set rebuilds. Define ZT_PHY_FORCE_SELECT to
+// fall back to the old select() backend. Note that very old Windows builds
+// (pre-19H1) fail to report outbound TCP connect errors through WSAPoll;
+// outbound TCP here is only the fallback relay tunnel, whose stalled
+// connection is torn down by its own inactivity timeout anyway.
+#ifndef ZT_PHY_FORCE_SELECT
+#define ZT_PHY_USE_WSAPOLL
+#endif
+
+// Maximum number of kernel events handled per poll() pass (epoll/kqueue backends)
+#define ZT_PHY_MAX_KERNEL_EVENTS 128
+
 #else // not Windows
 
 #include <errno.h>
@@ -66,8 +80,57 @@
 #define ZT_PHY_MAX_INTERCEPTS ZT_PHY_MAX_SOCKETS
 #define ZT_PHY_SOCKADDR_STORAGE_TYPE struct sockaddr_storage
 
+// Use a native kernel event queue instead of select() where available.
+// Define ZT_PHY_FORCE_SELECT to fall back to the old select() backend.
+#ifndef ZT_PHY_FORCE_SELECT
+#if defined(__linux__) || defined(linux) || defined(__LINUX__) || defined(__linux)
+#define ZT_PHY_USE_EPOLL
+#include <sys/epoll.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+#define ZT_PHY_USE_KQUEUE
+#include <sys/event.h>
+#endif
+#endif
+
+// Drain multiple UDP datagrams per syscall where the kernel supports it.
+#if defined(__linux__) || defined(linux) || defined(__LINUX__) || defined(__linux)
+#define ZT_PHY_USE_RECVMMSG
+#define ZT_PHY_RECVMMSG_BATCH 8
+
+// UDP segmentation/receive offload (Linux). A GSO send hands the kernel one
+// large buffer plus a segment size and costs one syscall and one trip down
+// the stack; GRO delivers bursts of same-size datagrams coalesced into one
+// buffer with the segment size attached as a cmsg. Option values are defined
+// here for older libc headers; unsupported kernels just fail the setsockopt
+// or sendmsg and we fall back to plain per-datagram I/O.
+#include <netinet/udp.h>
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#define ZT_PHY_USE_UDP_GSO
+#endif
+
+// Use accept4() so accepted sockets arrive already non-blocking,
+// skipping the per-connection fcntl() round trip (Linux)
+#if defined(__linux__) || defined(linux) || defined(__LINUX__) || defined(__linux)
+#define ZT_PHY_USE_ACCEPT4
+#endif
+
+// Maximum number of kernel events handled per poll() pass (epoll/kqueue backends)
+#define ZT_PHY_MAX_KERNEL_EVENTS 128
+
 #endif // Windows or not
 
+// Maximum TCP connections accepted from one listener per poll() wakeup; a
+// connect flood drains in large batches without starving other sockets
+#define ZT_PHY_ACCEPT_MAX_PER_WAKEUP 64
+
 namespace ZeroTier {
 
 /**
@@ -87,6 +150,7 @@ typedef void PhySocket;
  * For all platforms:
  *
  * phyOnDatagram(PhySocket *sock,void **uptr,const struct sockaddr *localAddr,const struct sockaddr *from,void *data,unsigned long len)
+ * phyOnDatagramWritable(PhySocket *sock,void **uptr)
  * phyOnTcpConnect(PhySocket *sock,void **uptr,bool success)
  * phyOnTcpAccept(PhySocket *sockL,PhySocket *sockN,void **uptrL,void **uptrN,const struct sockaddr *from)
  * phyOnTcpClose(PhySocket *sock,void **uptr)
@@ -142,10 +206,12 @@ private:
 	};
 
 	struct PhySocketImpl {
-		PhySocketImpl() {}
+		PhySocketImpl() : wantRead(false),wantWrite(false) {}
 		PhySocketType type;
 		ZT_PHY_SOCKFD_TYPE sock;
 		void *uptr; // user-settable pointer
+		bool wantRead; // currently monitored for readability?
+		bool wantWrite; // currently monitored for writability?
 		ZT_PHY_SOCKADDR_STORAGE_TYPE saddr; // remote for TCP_OUT and TCP_IN, local for TCP_LISTEN, RAW, and UDP
 	};
 
@@ -156,10 +222,24 @@ private:
 	fd_set _exceptfds;
 #endif
 	long _nfds;
+#if defined(ZT_PHY_USE_EPOLL) || defined(ZT_PHY_USE_KQUEUE)
+	int _kfd; // epoll instance or kqueue
+	bool _sweepNeeded; // one or more sockets were closed during the last event batch
+#endif
+#if defined(ZT_PHY_USE_WSAPOLL)
+	std::vector<WSAPOLLFD> _pollfds; // rebuilt only when membership or interest changes
+	std::vector<PhySocketImpl *> _pollsocks; // parallel to _pollfds; null entry is the whack pipe
+	bool _pollfdsDirty;
+#endif
 
 	ZT_PHY_SOCKFD_TYPE _whackReceiveSocket;
 	ZT_PHY_SOCKFD_TYPE _whackSendSocket;
 
+#ifdef ZT_PHY_USE_RECVMMSG
+	// Each slot must hold a full GRO-coalesced receive, which can approach 64K
+	char _mmsgBuf[ZT_PHY_RECVMMSG_BATCH * 65536];
+#endif
+
 	bool _noDelay;
 	bool _noCheck;
 
@@ -214,6 +294,32 @@ public:
 		_whackSendSocket = pipes[1];
 		_noDelay = noDelay;
 		_noCheck = noCheck;
+
+#if defined(ZT_PHY_USE_EPOLL)
+		_kfd = ::epoll_create1(0);
+		if (_kfd < 0)
+			throw std::runtime_error("unable to create epoll instance");
+		{
+			struct epoll_event ev;
+			memset(&ev,0,sizeof(ev));
+			ev.events = EPOLLIN;
+			ev.data.ptr = (void *)0; // the whack pipe is the only event carrying a null pointer
+			::epoll_ctl(_kfd,EPOLL_CTL_ADD,_whackReceiveSocket,&ev);
+		}
+		_sweepNeeded = false;
+#elif defined(ZT_PHY_USE_WSAPOLL)
+		_pollfdsDirty = true;
+#elif defined(ZT_PHY_USE_KQUEUE)
+		_kfd = ::kqueue();
+		if (_kfd < 0)
+			throw std::runtime_error("unable to create kqueue");
+		{
+			struct kevent ev;
+			EV_SET(&ev,_whackReceiveSocket,EVFILT_READ,EV_ADD,0,0,(void *)0); // the whack pipe is the only event carrying a null pointer
+			::kevent(_kfd,&ev,1,(struct kevent *)0,0,(const struct timespec *)0);
+		}
+		_sweepNeeded = false;
+#endif
 	}
 
 	~Phy()
@@ -224,6 +330,9 @@ public:
 		}
 		ZT_PHY_CLOSE_SOCKET(_whackReceiveSocket);
 		ZT_PHY_CLOSE_SOCKET(_whackSendSocket);
+#if defined(ZT_PHY_USE_EPOLL) || defined(ZT_PHY_USE_KQUEUE)
+		::close(_kfd);
+#endif
 	}
 
 	/**
@@ -308,12 +417,12 @@ public:
 		PhySocketImpl &sws = _socks.back();
 		if ((long)fd > _nfds)
 			_nfds = (long)fd;
-		FD_SET(fd,&_readfds);
 		sws.type = ZT_PHY_SOCKET_UNIX_IN; /* TODO: Type was changed to allow for CBs with new RPC model */
 		sws.sock = fd;
 		sws.uptr = uptr;
 		memset(&(sws.saddr),0,sizeof(struct sockaddr_storage));
 		// no sockaddr for this socket type, leave saddr null
+		_updateInterest(sws,true,false);
 		return (PhySocket *)&sws;
 	}
 
@@ -323,9 +432,10 @@ public:
 	 * @param localAddress Local endpoint address and port
 	 * @param uptr Initial value of user pointer associated with this socket (default: NULL)
 	 * @param bufferSize Desired socket receive/send buffer size -- will set as close to this as possible (default: 0, leave alone)
+	 * @param reusePort If true, set SO_REUSEPORT (where supported) so multiple sockets can share this address for kernel receive load balancing (default: false)
 	 * @return Socket or NULL on failure to bind
 	 */
-	inline PhySocket *udpBind(const struct sockaddr *localAddress,void *uptr = (void *)0,int bufferSize = 0)
+	inline PhySocket *udpBind(const struct sockaddr *localAddress,void *uptr = (void *)0,int bufferSize = 0,bool reusePort = false)
 	{
 		if (_socks.size() >= ZT_PHY_MAX_SOCKETS)
 			return (PhySocket *)0;
@@ -374,6 +484,16 @@ public:
 #endif
 			}
 			f = 0; setsockopt(s,SOL_SOCKET,SO_REUSEADDR,(void *)&f,sizeof(f));
+#ifdef SO_REUSEPORT
+			if (reusePort) {
+				f = 1; setsockopt(s,SOL_SOCKET,SO_REUSEPORT,(void *)&f,sizeof(f));
+			}
+#endif
+#ifdef ZT_PHY_USE_UDP_GSO
+			// Accept GRO-coalesced bursts; poll() splits them back into
+			// individual datagrams using the segment size cmsg.
+			f = 1; setsockopt(s,SOL_UDP,UDP_GRO,(void *)&f,sizeof(f));
+#endif
 			f = 1; setsockopt(s,SOL_SOCKET,SO_BROADCAST,(void *)&f,sizeof(f));
 #ifdef IP_DONTFRAG
 			f = 0; setsockopt(s,IPPROTO_IP,IP_DONTFRAG,&f,sizeof(f));
@@ -413,12 +533,12 @@ public:
 
 		if ((long)s > _nfds)
 			_nfds = (long)s;
-		FD_SET(s,&_readfds);
 		sws.type = ZT_PHY_SOCKET_UDP;
 		sws.sock = s;
 		sws.uptr = uptr;
 		memset(&(sws.saddr),0,sizeof(struct sockaddr_storage));
 		memcpy(&(sws.saddr),localAddress,(localAddress->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+		_updateInterest(sws,true,false);
 
 		return (PhySocket *)&sws;
 	}
@@ -441,6 +561,26 @@ public:
 #endif
 	}
 
+	/**
+	 * Set the DSCP marking for subsequent packets sent on a UDP socket
+	 *
+	 * @param sock UDP socket
+	 * @param dscp DSCP value (0-63), written to the ToS/traffic class field
+	 * @return True on success
+	 */
+	inline bool setUdpTos(PhySocket *sock,unsigned int dscp)
+	{
+		PhySocketImpl &sws = *(reinterpret_cast<PhySocketImpl *>(sock));
+		const int tmp = (int)((dscp & 0x3f) << 2);
+#if defined(_WIN32) || defined(_WIN64)
+		return (::setsockopt(sws.sock,IPPROTO_IP,IP_TOS,(const char *)&tmp,sizeof(tmp)) == 0);
+#else
+		if (reinterpret_cast<const struct sockaddr *>(&(sws.saddr))->sa_family == AF_INET6)
+			return (::setsockopt(sws.sock,IPPROTO_IPV6,IPV6_TCLASS,(void *)&tmp,sizeof(tmp)) == 0);
+		return (::setsockopt(sws.sock,IPPROTO_IP,IP_TOS,(void *)&tmp,sizeof(tmp)) == 0);
+#endif
+	}
+
 	/**
 	 * Send a UDP packet
 	 *
@@ -482,6 +622,62 @@ public:
 		return sent;
 	}
 
+	/**
+	 * Send a buffer of several equal-size datagrams in one segmented (GSO) send
+	 *
+	 * The buffer is split on segmentSize boundaries; the final segment may be
+	 * shorter. On Linux with UDP segmentation offload this costs a single
+	 * sendmsg(); elsewhere (or if the kernel rejects the segmented send) it
+	 * degrades to one plain send per segment.
+	 *
+	 * @param sock UDP socket
+	 * @param remoteAddress Destination address (common to all segments)
+	 * @param data Concatenated datagram payloads
+	 * @param len Total length of data
+	 * @param segmentSize Length of each individual datagram
+	 * @return True if data was sent
+	 */
+	inline bool udpSendSegmented(PhySocket *sock,const struct sockaddr *remoteAddress,const void *data,unsigned long len,unsigned int segmentSize)
+	{
+		if ((segmentSize == 0)||(len <= (unsigned long)segmentSize))
+			return udpSend(sock,remoteAddress,data,len);
+#ifdef ZT_PHY_USE_UDP_GSO
+		{
+			PhySocketImpl &sws = *(reinterpret_cast<PhySocketImpl *>(sock));
+			struct iovec iov;
+			iov.iov_base = const_cast<void *>(data);
+			iov.iov_len = len;
+			char cbuf[CMSG_SPACE(sizeof(uint16_t))];
+			memset(cbuf,0,sizeof(cbuf));
+			struct msghdr mh;
+			memset(&mh,0,sizeof(mh));
+			mh.msg_name = const_cast<struct sockaddr *>(remoteAddress);
+			mh.msg_namelen = (remoteAddress->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+			mh.msg_iov = &iov;
+			mh.msg_iovlen = 1;
+			mh.msg_control = cbuf;
+			mh.msg_controllen = sizeof(cbuf);
+			struct cmsghdr *const cm = CMSG_FIRSTHDR(&mh);
+			cm->cmsg_level = SOL_UDP;
+			cm->cmsg_type = UDP_SEGMENT;
+			cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+			*(reinterpret_cast<uint16_t *>(CMSG_DATA(cm))) = (uint16_t)segmentSize;
+			if ((long)::sendmsg(sws.sock,&mh,0) == (long)len) {
+				Metrics::udp_send += len;
+				return true;
+			}
+			// EIO/EINVAL here usually means no kernel GSO support; fall through
+		}
+#endif
+		bool sent = false;
+		for(unsigned long p=0;p<len;p+=(unsigned long)segmentSize) {
+			const unsigned long sl = ((len - p) > (unsigned long)segmentSize) ? (unsigned long)segmentSize : (len - p);
+			if (udpSend(sock,remoteAddress,reinterpret_cast<const char *>(data) + p,sl))
+				sent = true;
+		}
+		return sent;
+	}
+
 #ifdef __UNIX_LIKE__
 	/**
 	 * Listen for connections on a Unix domain socket
@@ -529,12 +725,12 @@ public:
 
 		if ((long)s > _nfds)
 			_nfds = (long)s;
-		FD_SET(s,&_readfds);
 		sws.type = ZT_PHY_SOCKET_UNIX_LISTEN;
 		sws.sock = s;
 		sws.uptr = uptr;
 		memset(&(sws.saddr),0,sizeof(struct sockaddr_storage));
 		memcpy(&(sws.saddr),&sun,sizeof(struct sockaddr_un));
+		_updateInterest(sws,true,false);
 
 		return (PhySocket *)&sws;
 	}
@@ -545,9 +741,10 @@ public:
 	 *
 	 * @param localAddress Local address and port
 	 * @param uptr Initial value of uptr for new socket (default: NULL)
+	 * @param reusePort If true, set SO_REUSEPORT (where supported) so multiple listeners can share this address for kernel accept load balancing (default: false)
 	 * @return Socket or NULL on failure to bind
 	 */
-	inline PhySocket *tcpListen(const struct sockaddr *localAddress,void *uptr = (void *)0)
+	inline PhySocket *tcpListen(const struct sockaddr *localAddress,void *uptr = (void *)0,bool reusePort = false)
 	{
 		if (_socks.size() >= ZT_PHY_MAX_SOCKETS)
 			return (PhySocket *)0;
@@ -570,6 +767,11 @@ public:
 			int f;
 			f = 1; ::setsockopt(s,IPPROTO_IPV6,IPV6_V6ONLY,(void *)&f,sizeof(f));
 			f = 1; ::setsockopt(s,SOL_SOCKET,SO_REUSEADDR,(void *)&f,sizeof(f));
+#ifdef SO_REUSEPORT
+			if (reusePort) {
+				f = 1; ::setsockopt(s,SOL_SOCKET,SO_REUSEPORT,(void *)&f,sizeof(f));
+			}
+#endif
 			f = (_noDelay ? 1 : 0); setsockopt(s,IPPROTO_TCP,TCP_NODELAY,(char *)&f,sizeof(f));
 			fcntl(s,F_SETFL,O_NONBLOCK);
 		}
@@ -595,12 +797,12 @@ public:
 
 		if ((long)s > _nfds)
 			_nfds = (long)s;
-		FD_SET(s,&_readfds);
 		sws.type = ZT_PHY_SOCKET_TCP_LISTEN;
 		sws.sock = s;
 		sws.uptr = uptr;
 		memset(&(sws.saddr),0,sizeof(struct sockaddr_storage));
 		memcpy(&(sws.saddr),localAddress,(localAddress->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+		_updateInterest(sws,true,false);
 
 		return (PhySocket *)&sws;
 	}
@@ -681,10 +883,8 @@ public:
 		if ((long)s > _nfds)
 			_nfds = (long)s;
 		if (connected) {
-			FD_SET(s,&_readfds);
 			sws.type = ZT_PHY_SOCKET_TCP_OUT_CONNECTED;
 		} else {
-			FD_SET(s,&_writefds);
 #if defined(_WIN32) || defined(_WIN64)
 			FD_SET(s,&_exceptfds);
 #endif
@@ -694,6 +894,11 @@ public:
 		sws.uptr = uptr;
 		memset(&(sws.saddr),0,sizeof(struct sockaddr_storage));
 		memcpy(&(sws.saddr),remoteAddress,(remoteAddress->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+		if (connected) {
+			_updateInterest(sws,true,false);
+		} else {
+			_updateInterest(sws,false,true);
+		}
 
 		if ((callConnectHandler)&&(connected)) {
 			try {
@@ -704,6 +909,90 @@ public:
 		return (PhySocket *)&sws;
 	}
 
+	/**
+	 * Adopt an already-connected stream socket as an outbound TCP connection
+	 *
+	 * The fd must be non-blocking and connected. No connect handler is called
+	 * since the connection already exists; the caller should enable writability
+	 * notification itself if it has data to send. This pairs with tcpRelease()
+	 * to allow connections to outlive a single Phy instance (e.g. HTTP
+	 * keep-alive).
+	 *
+	 * @param s Connected stream socket
+	 * @param remoteAddress Remote endpoint address
+	 * @param uptr Initial value of user pointer associated with this socket (default: NULL)
+	 * @return Socket or NULL on failure (socket is not closed on failure)
+	 */
+	inline PhySocket *tcpAdopt(ZT_PHY_SOCKFD_TYPE s,const struct sockaddr *remoteAddress,void *uptr = (void *)0)
+	{
+		if (_socks.size() >= ZT_PHY_MAX_SOCKETS)
+			return (PhySocket *)0;
+		if (!ZT_PHY_SOCKFD_VALID(s))
+			return (PhySocket *)0;
+
+		try {
+			_socks.push_back(PhySocketImpl());
+		} catch ( ... ) {
+			return (PhySocket *)0;
+		}
+		PhySocketImpl &sws = _socks.back();
+
+		if ((long)s > _nfds)
+			_nfds = (long)s;
+		sws.type = ZT_PHY_SOCKET_TCP_OUT_CONNECTED;
+		sws.sock = s;
+		sws.uptr = uptr;
+		memset(&(sws.saddr),0,sizeof(struct sockaddr_storage));
+		memcpy(&(sws.saddr),remoteAddress,(remoteAddress->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+		_updateInterest(sws,true,false);
+
+		return (PhySocket *)&sws;
+	}
+
+	/**
+	 * Remove a TCP socket from this Phy instance without closing the underlying fd
+	 *
+	 * No handlers are called. Ownership of the fd passes back to the caller,
+	 * which must eventually close it.
+	 *
+	 * @param sock Socket to release
+	 * @return Underlying fd, or ZT_PHY_SOCKFD_NULL if the socket was already closed
+	 */
+	inline ZT_PHY_SOCKFD_TYPE tcpRelease(PhySocket *sock)
+	{
+		if (!sock)
+			return ZT_PHY_SOCKFD_NULL;
+		PhySocketImpl &sws = *(reinterpret_cast<PhySocketImpl *>(sock));
+		if (sws.type == ZT_PHY_SOCKET_CLOSED)
+			return ZT_PHY_SOCKFD_NULL;
+
+		_updateInterest(sws,false,false);
+#if defined(_WIN32) || defined(_WIN64)
+		FD_CLR(sws.sock,&_exceptfds);
+#endif
+
+		ZT_PHY_SOCKFD_TYPE s = sws.sock;
+
+		// Causes entry to be deleted from list in poll(), ignored elsewhere
+		sws.type = ZT_PHY_SOCKET_CLOSED;
+#if defined(ZT_PHY_USE_EPOLL) || defined(ZT_PHY_USE_KQUEUE)
+		_sweepNeeded = true;
+#endif
+
+		if ((long)s >= (long)_nfds) {
+			long nfds = (long)_whackSendSocket;
+			if ((long)_whackReceiveSocket > nfds)
+				nfds = (long)_whackReceiveSocket;
+			for(typename std::list<PhySocketImpl>::iterator si(_socks.begin());si!=_socks.end();++si) {
+				if ((si->type != ZT_PHY_SOCKET_CLOSED)&&((long)si->sock > nfds))
+					nfds = (long)si->sock;
+			}
+			_nfds = nfds;
+		}
+
+		return s;
+	}
+
 	/**
 	 * Try to set buffer sizes as close to the given value as possible
 	 *
@@ -842,11 +1131,28 @@ public:
 	inline void setNotifyWritable(PhySocket *sock,bool notifyWritable)
 	{
 		PhySocketImpl &sws = *(reinterpret_cast<PhySocketImpl *>(sock));
-		if (notifyWritable) {
-			FD_SET(sws.sock,&_writefds);
-		} else {
-			FD_CLR(sws.sock,&_writefds);
-		}
+		_updateInterest(sws,sws.wantRead,notifyWritable);
+	}
+
+	/**
+	 * Enable or disable TCP_NODELAY on a stream connection socket
+	 *
+	 * Sockets inherit the Phy-wide noDelay setting when they are created;
+	 * this overrides it for one socket, e.g. for a connection whose writes
+	 * are already batched at the application level and should not be held
+	 * back by Nagle's algorithm.
+	 *
+	 * @param sock Stream connection socket
+	 * @param noDelay If true, disable Nagle's algorithm
+	 */
+	inline void setNoDelay(PhySocket *sock,bool noDelay)
+	{
+		PhySocketImpl &sws = *(reinterpret_cast<PhySocketImpl *>(sock));
+#if defined(_WIN32) || defined(_WIN64)
+		BOOL f = (noDelay ? TRUE : FALSE); ::setsockopt(sws.sock,IPPROTO_TCP,TCP_NODELAY,(char *)&f,sizeof(f));
+#else
+		int f = (noDelay ? 1 : 0); ::setsockopt(sws.sock,IPPROTO_TCP,TCP_NODELAY,(void *)&f,sizeof(f));
+#endif
 	}
 
 	/**
@@ -862,11 +1168,7 @@ public:
 	inline void setNotifyReadable(PhySocket *sock,bool notifyReadable)
 	{
 		PhySocketImpl &sws = *(reinterpret_cast<PhySocketImpl *>(sock));
-		if (notifyReadable) {
-			FD_SET(sws.sock,&_readfds);
-		} else {
-			FD_CLR(sws.sock,&_readfds);
-		}
+		_updateInterest(sws,notifyReadable,sws.wantWrite);
 	}
 
 	/**
@@ -882,6 +1184,108 @@ public:
 	{
 		char buf[131072];
 		struct sockaddr_storage ss;
+
+#if defined(ZT_PHY_USE_EPOLL)
+
+		struct epoll_event events[ZT_PHY_MAX_KERNEL_EVENTS];
+		const int n = ::epoll_wait(_kfd,events,ZT_PHY_MAX_KERNEL_EVENTS,(timeout > 0) ? (int)timeout : -1);
+		if (n <= 0)
+			return;
+
+		for(int i=0;i<n;++i) {
+			PhySocketImpl *const s = reinterpret_cast<PhySocketImpl *>(events[i].data.ptr);
+			if (!s) { // whack pipe
+				char tmp[16];
+				(void)(::read(_whackReceiveSocket,tmp,16));
+				continue;
+			}
+			if (s->type == ZT_PHY_SOCKET_CLOSED)
+				continue; // closed earlier in this batch
+			const uint32_t e = events[i].events;
+			_processSocketEvent(*s,((e & (EPOLLIN|EPOLLERR|EPOLLHUP)) != 0),((e & (EPOLLOUT|EPOLLERR|EPOLLHUP)) != 0),false,buf,ss);
+		}
+
+		if (_sweepNeeded)
+			_sweepClosed();
+
+#elif defined(ZT_PHY_USE_KQUEUE)
+
+		struct kevent events[ZT_PHY_MAX_KERNEL_EVENTS];
+		struct timespec ts;
+		ts.tv_sec = (time_t)(timeout / 1000);
+		ts.tv_nsec = (long)((timeout % 1000) * 1000000);
+		const int n = ::kevent(_kfd,(struct kevent *)0,0,events,ZT_PHY_MAX_KERNEL_EVENTS,(timeout > 0) ? &ts : (const struct timespec *)0);
+		if (n <= 0)
+			return;
+
+		for(int i=0;i<n;++i) {
+			PhySocketImpl *const s = reinterpret_cast<PhySocketImpl *>(events[i].udata);
+			if (!s) { // whack pipe
+				char tmp[16];
+				(void)(::read(_whackReceiveSocket,tmp,16));
+				continue;
+			}
+			if (s->type == ZT_PHY_SOCKET_CLOSED)
+				continue; // closed earlier in this batch
+			_processSocketEvent(*s,(events[i].filter == EVFILT_READ),(events[i].filter == EVFILT_WRITE),false,buf,ss);
+		}
+
+		if (_sweepNeeded)
+			_sweepClosed();
+
+#elif defined(ZT_PHY_USE_WSAPOLL)
+
+		if (_pollfdsDirty) {
+			_pollfds.clear();
+			_pollsocks.clear();
+			WSAPOLLFD w;
+			w.fd = _whackReceiveSocket;
+			w.events = POLLRDNORM;
+			w.revents = 0;
+			_pollfds.push_back(w);
+			_pollsocks.push_back((PhySocketImpl *)0);
+			for(typename std::list<PhySocketImpl>::iterator s(_socks.begin());s!=_socks.end();++s) {
+				if ((s->type != ZT_PHY_SOCKET_CLOSED)&&((s->wantRead)||(s->wantWrite))) {
+					w.fd = s->sock;
+					w.events = (SHORT)((s->wantRead ? POLLRDNORM : 0) | (s->wantWrite ? POLLWRNORM : 0));
+					w.revents = 0;
+					_pollfds.push_back(w);
+					_pollsocks.push_back(&(*s)); // stable: _socks is a std::list
+				}
+			}
+			_pollfdsDirty = false;
+		}
+
+		const int n = ::WSAPoll(_pollfds.data(),(ULONG)_pollfds.size(),(timeout > 0) ? (INT)timeout : -1);
+		if (n <= 0)
+			return;
+
+		for(unsigned long i=0;i<(unsigned long)_pollfds.size();++i) {
+			const SHORT re = _pollfds[i].revents;
+			_pollfds[i].revents = 0;
+			if (!re)
+				continue;
+			PhySocketImpl *const s = _pollsocks[i];
+			if (!s) { // whack pipe
+				char tmp[16];
+				::recv(_whackReceiveSocket,tmp,16,0);
+				continue;
+			}
+			if (s->type == ZT_PHY_SOCKET_CLOSED)
+				continue; // closed earlier in this batch
+			_processSocketEvent(*s,((re & (POLLRDNORM|POLLERR|POLLHUP)) != 0),((re & POLLWRNORM) != 0),((re & (POLLERR|POLLNVAL)) != 0),buf,ss);
+		}
+
+		// Drop sockets closed during this batch; the pollfd array was already
+		// marked dirty by the interest change in close()
+		for(typename std::list<PhySocketImpl>::iterator s(_socks.begin());s!=_socks.end();) {
+			if (s->type == ZT_PHY_SOCKET_CLOSED)
+				_socks.erase(s++);
+			else ++s;
+		}
+
+#else // select() backend
+
 		struct timeval tv;
 		fd_set rfds,wfds,efds;
 
@@ -903,176 +1307,27 @@ public:
 #if defined(_WIN32) || defined(_WIN64)
 			::recv(_whackReceiveSocket,tmp,16,0);
 #else
-			::read(_whackReceiveSocket,tmp,16);
+			(void)(::read(_whackReceiveSocket,tmp,16));
 #endif
 		}
 
 		for(typename std::list<PhySocketImpl>::iterator s(_socks.begin());s!=_socks.end();) {
-			switch (s->type) {
-
-				case ZT_PHY_SOCKET_TCP_OUT_PENDING:
+			const bool readable = (FD_ISSET(s->sock,&rfds) != 0);
+			const bool writable = (FD_ISSET(s->sock,&wfds) != 0);
 #if defined(_WIN32) || defined(_WIN64)
-					if (FD_ISSET(s->sock,&efds)) {
-						this->close((PhySocket *)&(*s),true);
-					} else // ... if
-#endif
-					if (FD_ISSET(s->sock,&wfds)) {
-						socklen_t slen = sizeof(ss);
-						if (::getpeername(s->sock,(struct sockaddr *)&ss,&slen) != 0) {
-							this->close((PhySocket *)&(*s),true);
-						} else {
-							s->type = ZT_PHY_SOCKET_TCP_OUT_CONNECTED;
-							FD_SET(s->sock,&_readfds);
-							FD_CLR(s->sock,&_writefds);
-#if defined(_WIN32) || defined(_WIN64)
-							FD_CLR(s->sock,&_exceptfds);
-#endif
-							try {
-								_handler->phyOnTcpConnect((PhySocket *)&(*s),&(s->uptr),true);
-							} catch ( ... ) {}
-						}
-					}
-					break;
-
-				case ZT_PHY_SOCKET_TCP_OUT_CONNECTED:
-				case ZT_PHY_SOCKET_TCP_IN: {
-					ZT_PHY_SOCKFD_TYPE sock = s->sock; // if closed, s->sock becomes invalid as s is no longer dereferencable
-					if (FD_ISSET(sock,&rfds)) {
-						long n = (long)::recv(sock,buf,sizeof(buf),0);
-						if (n <= 0) {
-							this->close((PhySocket *)&(*s),true);
-						} else {
-							try {
-								_handler->phyOnTcpData((PhySocket *)&(*s),&(s->uptr),(void *)buf,(unsigned long)n);
-							} catch ( ... ) {}
-						}
-					}
-					if ((FD_ISSET(sock,&wfds))&&(FD_ISSET(sock,&_writefds))) {
-						try {
-							_handler->phyOnTcpWritable((PhySocket *)&(*s),&(s->uptr));
-						} catch ( ... ) {}
-					}
-				}	break;
-
-				case ZT_PHY_SOCKET_TCP_LISTEN:
-					if (FD_ISSET(s->sock,&rfds)) {
-						memset(&ss,0,sizeof(ss));
-						socklen_t slen = sizeof(ss);
-						ZT_PHY_SOCKFD_TYPE newSock = ::accept(s->sock,(struct sockaddr *)&ss,&slen);
-						if (ZT_PHY_SOCKFD_VALID(newSock)) {
-							if (_socks.size() >= ZT_PHY_MAX_SOCKETS) {
-								ZT_PHY_CLOSE_SOCKET(newSock);
-							} else {
-#if defined(_WIN32) || defined(_WIN64)
-								{ BOOL f = (_noDelay ? TRUE : FALSE); setsockopt(newSock,IPPROTO_TCP,TCP_NODELAY,(char *)&f,sizeof(f)); }
-								{ u_long iMode=1; ioctlsocket(newSock,FIONBIO,&iMode); }
+			const bool exceptional = (FD_ISSET(s->sock,&efds) != 0);
 #else
-								{ int f = (_noDelay ? 1 : 0); setsockopt(newSock,IPPROTO_TCP,TCP_NODELAY,(char *)&f,sizeof(f)); }
-								fcntl(newSock,F_SETFL,O_NONBLOCK);
+			const bool exceptional = false;
 #endif
-								_socks.push_back(PhySocketImpl());
-								PhySocketImpl &sws = _socks.back();
-								FD_SET(newSock,&_readfds);
-								if ((long)newSock > _nfds)
-									_nfds = (long)newSock;
-								sws.type = ZT_PHY_SOCKET_TCP_IN;
-								sws.sock = newSock;
-								sws.uptr = (void *)0;
-								memcpy(&(sws.saddr),&ss,sizeof(struct sockaddr_storage));
-								try {
-									_handler->phyOnTcpAccept((PhySocket *)&(*s),(PhySocket *)&(_socks.back()),&(s->uptr),&(sws.uptr),(const struct sockaddr *)&(sws.saddr));
-								} catch ( ... ) {}
-							}
-						}
-					}
-					break;
-
-				case ZT_PHY_SOCKET_UDP:
-					if (FD_ISSET(s->sock,&rfds)) {
-						for(int k=0;k<1024;++k) {
-							memset(&ss,0,sizeof(ss));
-							socklen_t slen = sizeof(ss);
-							long n = (long)::recvfrom(s->sock,buf,sizeof(buf),0,(struct sockaddr *)&ss,&slen);
-							if (n > 0) {
-								try {
-									_handler->phyOnDatagram((PhySocket *)&(*s),&(s->uptr),(const struct sockaddr *)&(s->saddr),(const struct sockaddr *)&ss,(void *)buf,(unsigned long)n);
-								} catch ( ... ) {}
-							} else if (n < 0)
-								break;
-						}
-					}
-					break;
-
-				case ZT_PHY_SOCKET_UNIX_IN: {
-#ifdef __UNIX_LIKE__
-					ZT_PHY_SOCKFD_TYPE sock = s->sock; // if closed, s->sock becomes invalid as s is no longer dereferencable
-					if ((FD_ISSET(sock,&wfds))&&(FD_ISSET(sock,&_writefds))) {
-						try {
-							_handler->phyOnUnixWritable((PhySocket *)&(*s),&(s->uptr));
-						} catch ( ... ) {}
-					}
-					if (FD_ISSET(sock,&rfds)) {
-						long n = (long)::read(sock,buf,sizeof(buf));
-						if (n <= 0) {
-							this->close((PhySocket *)&(*s),true);
-						} else {
-							try {
-								_handler->phyOnUnixData((PhySocket *)&(*s),&(s->uptr),(void *)buf,(unsigned long)n);
-							} catch ( ... ) {}
-						}
-					}
-#endif // __UNIX_LIKE__
-				}	break;
-
-				case ZT_PHY_SOCKET_UNIX_LISTEN:
-#ifdef __UNIX_LIKE__
-					if (FD_ISSET(s->sock,&rfds)) {
-						memset(&ss,0,sizeof(ss));
-						socklen_t slen = sizeof(ss);
-						ZT_PHY_SOCKFD_TYPE newSock = ::accept(s->sock,(struct sockaddr *)&ss,&slen);
-						if (ZT_PHY_SOCKFD_VALID(newSock)) {
-							if (_socks.size() >= ZT_PHY_MAX_SOCKETS) {
-								ZT_PHY_CLOSE_SOCKET(newSock);
-							} else {
-								fcntl(newSock,F_SETFL,O_NONBLOCK);
-								_socks.push_back(PhySocketImpl());
-								PhySocketImpl &sws = _socks.back();
-								FD_SET(newSock,&_readfds);
-								if ((long)newSock > _nfds)
-									_nfds = (long)newSock;
-								sws.type = ZT_PHY_SOCKET_UNIX_IN;
-								sws.sock = newSock;
-								sws.uptr = (void *)0;
-								memcpy(&(sws.saddr),&ss,sizeof(struct sockaddr_storage));
-								try {
-									//_handler->phyOnUnixAccept((PhySocket *)&(*s),(PhySocket *)&(_socks.back()),&(s->uptr),&(sws.uptr));
-								} catch ( ... ) {}
-							}
-						}
-					}
-#endif // __UNIX_LIKE__
-					break;
-
-				case ZT_PHY_SOCKET_FD: {
-					ZT_PHY_SOCKFD_TYPE sock = s->sock;
-					const bool readable = ((FD_ISSET(sock,&rfds))&&(FD_ISSET(sock,&_readfds)));
-					const bool writable = ((FD_ISSET(sock,&wfds))&&(FD_ISSET(sock,&_writefds)));
-					if ((readable)||(writable)) {
-						try {
-							//_handler->phyOnFileDescriptorActivity((PhySocket *)&(*s),&(s->uptr),readable,writable);
-						} catch ( ... ) {}
-					}
-				}	break;
-
-				default:
-					break;
-
-			}
+			if ((readable)||(writable)||(exceptional))
+				_processSocketEvent(*s,readable,writable,exceptional,buf,ss);
 
 			if (s->type == ZT_PHY_SOCKET_CLOSED)
 				_socks.erase(s++);
 			else ++s;
 		}
+
+#endif // backend
 	}
 
 	/**
@@ -1087,8 +1342,7 @@ public:
 		if (sws.type == ZT_PHY_SOCKET_CLOSED)
 			return;
 
-		FD_CLR(sws.sock,&_readfds);
-		FD_CLR(sws.sock,&_writefds);
+		_updateInterest(sws,false,false);
 #if defined(_WIN32) || defined(_WIN64)
 		FD_CLR(sws.sock,&_exceptfds);
 #endif
@@ -1128,6 +1382,9 @@ public:
 
 		// Causes entry to be deleted from list in poll(), ignored elsewhere
 		sws.type = ZT_PHY_SOCKET_CLOSED;
+#if defined(ZT_PHY_USE_EPOLL) || defined(ZT_PHY_USE_KQUEUE)
+		_sweepNeeded = true;
+#endif
 
 		if ((long)sws.sock >= (long)_nfds) {
 			long nfds = (long)_whackSendSocket;
@@ -1140,6 +1397,301 @@ public:
 			_nfds = nfds;
 		}
 	}
+
+private:
+#if defined(ZT_PHY_USE_EPOLL) || defined(ZT_PHY_USE_KQUEUE)
+	// Remove closed sockets from _socks -- deferred until after an event batch
+	// since kernel events delivered in the same batch may still reference them.
+	inline void _sweepClosed()
+	{
+		for(typename std::list<PhySocketImpl>::iterator s(_socks.begin());s!=_socks.end();) {
+			if (s->type == ZT_PHY_SOCKET_CLOSED)
+				_socks.erase(s++);
+			else ++s;
+		}
+		_sweepNeeded = false;
+	}
+#endif
+
+	// Single funnel for all read/write interest changes: updates the kernel
+	// event queue (or fd_set's for the select() backend) and the per-socket
+	// wantRead/wantWrite flags together so they can never disagree.
+	inline void _updateInterest(PhySocketImpl &sws,const bool wantRead,const bool wantWrite)
+	{
+		sws.wantRead = wantRead;
+		sws.wantWrite = wantWrite;
+#if defined(ZT_PHY_USE_EPOLL)
+		if ((wantRead)||(wantWrite)) {
+			struct epoll_event ev;
+			memset(&ev,0,sizeof(ev));
+			ev.events = (wantRead ? EPOLLIN : 0) | (wantWrite ? EPOLLOUT : 0);
+			ev.data.ptr = (void *)&sws; // stable: _socks is a std::list
+			if (::epoll_ctl(_kfd,EPOLL_CTL_MOD,sws.sock,&ev) != 0)
+				::epoll_ctl(_kfd,EPOLL_CTL_ADD,sws.sock,&ev);
+		} else {
+			struct epoll_event ev; // ignored by EPOLL_CTL_DEL but required pre-2.6.9
+			memset(&ev,0,sizeof(ev));
+			::epoll_ctl(_kfd,EPOLL_CTL_DEL,sws.sock,&ev);
+		}
+#elif defined(ZT_PHY_USE_KQUEUE)
+		struct kevent ev;
+		EV_SET(&ev,sws.sock,EVFILT_READ,(wantRead ? (EV_ADD|EV_ENABLE) : EV_DELETE),0,0,(void *)&sws);
+		::kevent(_kfd,&ev,1,(struct kevent *)0,0,(const struct timespec *)0);
+		EV_SET(&ev,sws.sock,EVFILT_WRITE,(wantWrite ? (EV_ADD|EV_ENABLE) : EV_DELETE),0,0,(void *)&sws);
+		::kevent(_kfd,&ev,1,(struct kevent *)0,0,(const struct timespec *)0);
+#elif defined(ZT_PHY_USE_WSAPOLL)
+		_pollfdsDirty = true; // pollfd array is regenerated lazily at the top of poll()
+#else
+		if (wantRead) {
+			FD_SET(sws.sock,&_readfds);
+		} else {
+			FD_CLR(sws.sock,&_readfds);
+		}
+		if (wantWrite) {
+			FD_SET(sws.sock,&_writefds);
+		} else {
+			FD_CLR(sws.sock,&_writefds);
+		}
+#endif
+	}
+
+	// Dispatch one socket's worth of readiness to the appropriate handler(s).
+	// This is backend-agnostic: poll() translates whatever the kernel reported
+	// into readable/writable(/exceptional, Windows only) booleans.
+	inline void _processSocketEvent(PhySocketImpl &s,const bool readable,const bool writable,const bool exceptional,char *buf,struct sockaddr_storage &ss)
+	{
+		switch (s.type) {
+
+			case ZT_PHY_SOCKET_TCP_OUT_PENDING:
+#if defined(_WIN32) || defined(_WIN64)
+				if (exceptional) {
+					this->close((PhySocket *)&s,true);
+				} else // ... if
+#endif
+				if (writable) {
+					socklen_t slen = sizeof(ss);
+					if (::getpeername(s.sock,(struct sockaddr *)&ss,&slen) != 0) {
+						this->close((PhySocket *)&s,true);
+					} else {
+						s.type = ZT_PHY_SOCKET_TCP_OUT_CONNECTED;
+						_updateInterest(s,true,false);
+#if defined(_WIN32) || defined(_WIN64)
+						FD_CLR(s.sock,&_exceptfds);
+#endif
+						try {
+							_handler->phyOnTcpConnect((PhySocket *)&s,&(s.uptr),true);
+						} catch ( ... ) {}
+					}
+				}
+				break;
+
+			case ZT_PHY_SOCKET_TCP_OUT_CONNECTED:
+			case ZT_PHY_SOCKET_TCP_IN: {
+				if (readable) {
+					long n = (long)::recv(s.sock,buf,131072,0);
+					if (n <= 0) {
+						this->close((PhySocket *)&s,true);
+					} else {
+						try {
+							_handler->phyOnTcpData((PhySocket *)&s,&(s.uptr),(void *)buf,(unsigned long)n);
+						} catch ( ... ) {}
+					}
+				}
+				if ((writable)&&(s.wantWrite)) { // wantWrite is cleared if the read path closed the socket
+					try {
+						_handler->phyOnTcpWritable((PhySocket *)&s,&(s.uptr));
+					} catch ( ... ) {}
+				}
+			}	break;
+
+			case ZT_PHY_SOCKET_TCP_LISTEN:
+				if (readable) {
+					// Drain the accept backlog in one wakeup instead of taking a
+					// single connection per poll pass, which under a connect
+					// flood (e.g. a fallback relay during an ISP outage) left
+					// the backlog growing by all but one connection per pass
+					for(int k=0;k<ZT_PHY_ACCEPT_MAX_PER_WAKEUP;++k) {
+						memset(&ss,0,sizeof(ss));
+						socklen_t slen = sizeof(ss);
+#ifdef ZT_PHY_USE_ACCEPT4
+						ZT_PHY_SOCKFD_TYPE newSock = ::accept4(s.sock,(struct sockaddr *)&ss,&slen,SOCK_NONBLOCK);
+#else
+						ZT_PHY_SOCKFD_TYPE newSock = ::accept(s.sock,(struct sockaddr *)&ss,&slen);
+#endif
+						if (!ZT_PHY_SOCKFD_VALID(newSock))
+							break; // backlog drained (or transient error; retry next pass)
+						if (_socks.size() >= ZT_PHY_MAX_SOCKETS) {
+							ZT_PHY_CLOSE_SOCKET(newSock);
+							break;
+						}
+#if defined(_WIN32) || defined(_WIN64)
+						{ BOOL f = (_noDelay ? TRUE : FALSE); setsockopt(newSock,IPPROTO_TCP,TCP_NODELAY,(char *)&f,sizeof(f)); }
+						{ u_long iMode=1; ioctlsocket(newSock,FIONBIO,&iMode); }
+#else
+						{ int f = (_noDelay ? 1 : 0); setsockopt(newSock,IPPROTO_TCP,TCP_NODELAY,(char *)&f,sizeof(f)); }
+#ifndef ZT_PHY_USE_ACCEPT4
+						fcntl(newSock,F_SETFL,O_NONBLOCK);
+#endif
+#endif
+						_socks.push_back(PhySocketImpl());
+						PhySocketImpl &sws = _socks.back();
+						if ((long)newSock > _nfds)
+							_nfds = (long)newSock;
+						sws.type = ZT_PHY_SOCKET_TCP_IN;
+						sws.sock = newSock;
+						sws.uptr = (void *)0;
+						memcpy(&(sws.saddr),&ss,sizeof(struct sockaddr_storage));
+						_updateInterest(sws,true,false);
+						try {
+							_handler->phyOnTcpAccept((PhySocket *)&s,(PhySocket *)&(_socks.back()),&(s.uptr),&(sws.uptr),(const struct sockaddr *)&(sws.saddr));
+						} catch ( ... ) {}
+					}
+				}
+				break;
+
+			case ZT_PHY_SOCKET_UDP:
+				if ((writable)&&(s.wantWrite)) {
+					try {
+						_handler->phyOnDatagramWritable((PhySocket *)&s,&(s.uptr));
+					} catch ( ... ) {}
+				}
+				if (readable) {
+#if defined(ZT_PHY_USE_RECVMMSG)
+					// Batch receive: one syscall pulls up to ZT_PHY_RECVMMSG_BATCH
+					// datagrams, cutting per-packet syscall overhead at high rates.
+					// The handler is still called once per datagram.
+					struct mmsghdr msgs[ZT_PHY_RECVMMSG_BATCH];
+					struct iovec iovs[ZT_PHY_RECVMMSG_BATCH];
+					struct sockaddr_storage saddrs[ZT_PHY_RECVMMSG_BATCH];
+#ifdef ZT_PHY_USE_UDP_GSO
+					char cbufs[ZT_PHY_RECVMMSG_BATCH][CMSG_SPACE(sizeof(int))];
+#endif
+					for(int k=0;k<(1024 / ZT_PHY_RECVMMSG_BATCH);++k) {
+						memset(msgs,0,sizeof(msgs));
+						memset(saddrs,0,sizeof(saddrs));
+						for(int m=0;m<ZT_PHY_RECVMMSG_BATCH;++m) {
+							iovs[m].iov_base = (void *)(_mmsgBuf + ((unsigned long)m * 65536));
+							iovs[m].iov_len = 65536;
+							msgs[m].msg_hdr.msg_iov = &(iovs[m]);
+							msgs[m].msg_hdr.msg_iovlen = 1;
+							msgs[m].msg_hdr.msg_name = (void *)&(saddrs[m]);
+							msgs[m].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+#ifdef ZT_PHY_USE_UDP_GSO
+							msgs[m].msg_hdr.msg_control = (void *)cbufs[m];
+							msgs[m].msg_hdr.msg_controllen = sizeof(cbufs[m]);
+#endif
+						}
+						const int nr = (int)::recvmmsg(s.sock,msgs,ZT_PHY_RECVMMSG_BATCH,MSG_DONTWAIT,(struct timespec *)0);
+						if (nr <= 0)
+							break;
+						for(int m=0;m<nr;++m) {
+							if (msgs[m].msg_len > 0) {
+								unsigned long seg = (unsigned long)msgs[m].msg_len;
+#ifdef ZT_PHY_USE_UDP_GSO
+								// A GRO-coalesced receive packs a burst of same-size
+								// datagrams into one buffer with the segment size in
+								// a cmsg; split it back into individual packets.
+								for(struct cmsghdr *cm=CMSG_FIRSTHDR(&(msgs[m].msg_hdr));(cm);cm=CMSG_NXTHDR(&(msgs[m].msg_hdr),cm)) {
+									if ((cm->cmsg_level == SOL_UDP)&&(cm->cmsg_type == UDP_GRO)) {
+										const int gso = *(reinterpret_cast<const int *>(CMSG_DATA(cm)));
+										if (gso > 0)
+											seg = (unsigned long)gso;
+										break;
+									}
+								}
+#endif
+								const char *const mb = reinterpret_cast<const char *>(iovs[m].iov_base);
+								for(unsigned long off=0;off<(unsigned long)msgs[m].msg_len;off+=seg) {
+									const unsigned long sl = (((unsigned long)msgs[m].msg_len - off) > seg) ? seg : ((unsigned long)msgs[m].msg_len - off);
+									try {
+										_handler->phyOnDatagram((PhySocket *)&s,&(s.uptr),(const struct sockaddr *)&(s.saddr),(const struct sockaddr *)&(saddrs[m]),(void *)(mb + off),sl);
+									} catch ( ... ) {}
+								}
+							}
+						}
+						if (nr < ZT_PHY_RECVMMSG_BATCH)
+							break; // socket drained
+					}
+#else
+					for(int k=0;k<1024;++k) {
+						memset(&ss,0,sizeof(ss));
+						socklen_t slen = sizeof(ss);
+						long n = (long)::recvfrom(s.sock,buf,131072,0,(struct sockaddr *)&ss,&slen);
+						if (n > 0) {
+							try {
+								_handler->phyOnDatagram((PhySocket *)&s,&(s.uptr),(const struct sockaddr *)&(s.saddr),(const struct sockaddr *)&ss,(void *)buf,(unsigned long)n);
+							} catch ( ... ) {}
+						} else if (n < 0)
+							break;
+					}
+#endif
+				}
+				break;
+
+			case ZT_PHY_SOCKET_UNIX_IN: {
+#ifdef __UNIX_LIKE__
+				if ((writable)&&(s.wantWrite)) {
+					try {
+						_handler->phyOnUnixWritable((PhySocket *)&s,&(s.uptr));
+					} catch ( ... ) {}
+				}
+				if (readable) {
+					long n = (long)::read(s.sock,buf,131072);
+					if (n <= 0) {
+						this->close((PhySocket *)&s,true);
+					} else {
+						try {
+							_handler->phyOnUnixData((PhySocket *)&s,&(s.uptr),(void *)buf,(unsigned long)n);
+						} catch ( ... ) {}
+					}
+				}
+#endif // __UNIX_LIKE__
+			}	break;
+
+			case ZT_PHY_SOCKET_UNIX_LISTEN:
+#ifdef __UNIX_LIKE__
+				if (readable) {
+					memset(&ss,0,sizeof(ss));
+					socklen_t slen = sizeof(ss);
+					ZT_PHY_SOCKFD_TYPE newSock = ::accept(s.sock,(struct sockaddr *)&ss,&slen);
+					if (ZT_PHY_SOCKFD_VALID(newSock)) {
+						if (_socks.size() >= ZT_PHY_MAX_SOCKETS) {
+							ZT_PHY_CLOSE_SOCKET(newSock);
+						} else {
+							fcntl(newSock,F_SETFL,O_NONBLOCK);
+							_socks.push_back(PhySocketImpl());
+							PhySocketImpl &sws = _socks.back();
+							if ((long)newSock > _nfds)
+								_nfds = (long)newSock;
+							sws.type = ZT_PHY_SOCKET_UNIX_IN;
+							sws.sock = newSock;
+							sws.uptr = (void *)0;
+							memcpy(&(sws.saddr),&ss,sizeof(struct sockaddr_storage));
+							_updateInterest(sws,true,false);
+							try {
+								//_handler->phyOnUnixAccept((PhySocket *)&s,(PhySocket *)&(_socks.back()),&(s.uptr),&(sws.uptr));
+							} catch ( ... ) {}
+						}
+					}
+				}
+#endif // __UNIX_LIKE__
+				break;
+
+			case ZT_PHY_SOCKET_FD: {
+				const bool r = ((readable)&&(s.wantRead));
+				const bool w = ((writable)&&(s.wantWrite));
+				if ((r)||(w)) {
+					try {
+						//_handler->phyOnFileDescriptorActivity((PhySocket *)&s,&(s.uptr),r,w);
+					} catch ( ... ) {}
+				}
+			}	break;
+
+			default:
+				break;
+
+		}
+	}
 };
 
 } // namespace ZeroTier
@@ -68,6 +68,7 @@ class PortMapperImpl
 public:
 	PortMapperImpl(int localUdpPortToMap,const char *un) :
 		run(true),
+		refreshRequested(false),
 		localPort(localUdpPortToMap),
 		uniqueName(un)
 	{
@@ -297,13 +298,27 @@ public:
 #ifdef ZT_PORTMAPPER_TRACE
             PM_TRACE("UPNPClient: rescanning in %d ms" ZT_EOL_S,ZT_PORTMAPPER_REFRESH_DELAY);
 #endif
-			Thread::sleep(ZT_PORTMAPPER_REFRESH_DELAY);
+			// Sleep in short increments so an externally requested refresh (e.g.
+			// triggered by an interface change) starts a new NAT-PMP/UPnP pass
+			// within about a second instead of after the full refresh delay.
+			for(unsigned long slept=0;(slept<ZT_PORTMAPPER_REFRESH_DELAY)&&(run);slept+=1000) {
+				if (refreshRequested) {
+					refreshRequested = false;
+					mode = 0; // start over with the preferred protocol; a failure falls through to UPnP in the same pass
+#ifdef ZT_PORTMAPPER_TRACE
+                    PM_TRACE("PortMapper: refresh requested, rescanning now" ZT_EOL_S);
+#endif
+					break;
+				}
+				Thread::sleep(1000);
+			}
 		}
 
 		delete this;
 	}
 
 	volatile bool run;
+	volatile bool refreshRequested;
 	int localPort;
 	std::string uniqueName;
 
@@ -328,6 +343,11 @@ std::vector<InetAddress> PortMapper::get() const
 	return _impl->surface;
 }
 
+void PortMapper::refresh()
+{
+	_impl->refreshRequested = true;
+}
+
 } // namespace ZeroTier
 
 #endif // ZT_USE_MINIUPNPC
@@ -55,6 +55,15 @@ public:
 	 */
 	std::vector<InetAddress> get() const;
 
+	/**
+	 * Request an immediate re-query of NAT-PMP/UPnP
+	 *
+	 * Called when the set of local interface addresses changes (e.g. after a
+	 * router reboot or network move) so mappings are re-established within
+	 * seconds instead of waiting out the periodic refresh delay.
+	 */
+	void refresh();
+
 private:
 	PortMapperImpl *_impl;
 };
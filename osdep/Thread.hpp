@@ -1,192 +1,340 @@
-/*
- * Copyright (c)2019 ZeroTier, Inc.
- *
- * Use of this software is governed by the Business Source License included
- * in the LICENSE.TXT file in the project's root directory.
- *
- * Change Date: 2025-01-01
- *
- * On the date above, in accordance with the Business Source License, use
- * of this software will be governed by version 2.0 of the Apache License.
- */
-/****/
-
-#ifndef ZT_THREAD_HPP
-#define ZT_THREAD_HPP
-
-#include <stdexcept>
-
-#include "../node/Constants.hpp"
-
-#ifdef __WINDOWS__
-
-#include <winsock2.h>
-#include <windows.h>
-#include <string.h>
-
-#include "../node/Mutex.hpp"
-
-namespace ZeroTier {
-
-template<typename C>
-static DWORD WINAPI ___zt_threadMain(LPVOID lpParam)
-{
-	try {
-		((C *)lpParam)->threadMain();
-	} catch ( ... ) {}
-	return 0;
-}
-
-class Thread
-{
-public:
-	Thread()
-	{
-		_th = NULL;
-		_tid = 0;
-	}
-
-	template<typename C>
-	static inline Thread start(C *instance)
-	{
-		Thread t;
-		t._th = CreateThread(NULL,0,&___zt_threadMain<C>,(LPVOID)instance,0,&t._tid);
-		if (t._th == NULL)
-			throw std::runtime_error("CreateThread() failed");
-		return t;
-	}
-
-	static inline void join(const Thread &t)
-	{
-		if (t._th != NULL) {
-			for(;;) {
-				DWORD ec = STILL_ACTIVE;
-				GetExitCodeThread(t._th,&ec);
-				if (ec == STILL_ACTIVE)
-					WaitForSingleObject(t._th,1000);
-				else break;
-			}
-		}
-	}
-
-	static inline void sleep(unsigned long ms)
-	{
-		Sleep((DWORD)ms);
-	}
-
-	// Not available on *nix platforms
-	static inline void cancelIO(const Thread &t)
-	{
-#if !defined(__MINGW32__) && !defined(__MINGW64__) // CancelSynchronousIo not available in MSYS2
-		if (t._th != NULL)
-			CancelSynchronousIo(t._th);
-#endif
-	}
-
-	inline operator bool() const { return (_th != NULL); }
-
-private:
-	HANDLE _th;
-	DWORD _tid;
-};
-
-} // namespace ZeroTier
-
-#else
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <pthread.h>
-#include <unistd.h>
-
-namespace ZeroTier {
-
-template<typename C>
-static void *___zt_threadMain(void *instance)
-{
-	try {
-		((C *)instance)->threadMain();
-	} catch ( ... ) {}
-	return (void *)0;
-}
-
-/**
- * A thread identifier, and static methods to start and join threads
- */
-class Thread
-{
-public:
-	Thread()
-	{
-		memset(this,0,sizeof(Thread));
-	}
-
-	Thread(const Thread &t)
-	{
-		memcpy(this,&t,sizeof(Thread));
-	}
-
-	inline Thread &operator=(const Thread &t)
-	{
-		memcpy(this,&t,sizeof(Thread));
-		return *this;
-	}
-
-	/**
-	 * Start a new thread
-	 *
-	 * @param instance Instance whose threadMain() method gets called by new thread
-	 * @return Thread identifier
-	 * @throws std::runtime_error Unable to create thread
-	 * @tparam C Class containing threadMain()
-	 */
-	template<typename C>
-	static inline Thread start(C *instance)
-	{
-		Thread t;
-		pthread_attr_t tattr;
-		pthread_attr_init(&tattr);
-		// This corrects for systems with abnormally small defaults (musl) and also
-		// shrinks the stack on systems with large defaults to save a bit of memory.
-		pthread_attr_setstacksize(&tattr,ZT_THREAD_MIN_STACK_SIZE);
-		if (pthread_create(&t._tid,&tattr,&___zt_threadMain<C>,instance)) {
-			pthread_attr_destroy(&tattr);
-			throw std::runtime_error("pthread_create() failed, unable to create thread");
-		} else {
-			t._started = true;
-			pthread_attr_destroy(&tattr);
-		}
-		return t;
-	}
-
-	/**
-	 * Join to a thread, waiting for it to terminate (does nothing on null Thread values)
-	 *
-	 * @param t Thread to join
-	 */
-	static inline void join(const Thread &t)
-	{
-		if (t._started)
-			pthread_join(t._tid,(void **)0);
-	}
-
-	/**
-	 * Sleep the current thread
-	 *
-	 * @param ms Number of milliseconds to sleep
-	 */
-	static inline void sleep(unsigned long ms) { usleep(ms * 1000); }
-
-	inline operator bool() const { return (_started); }
-
-private:
-	pthread_t _tid;
-	volatile bool _started;
-};
-
-} // namespace ZeroTier
-
-#endif // __WINDOWS__ / !__WINDOWS__
-
-#endif
+/*
+ * Copyright (c)2019 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2025-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+#ifndef ZT_THREAD_HPP
+#define ZT_THREAD_HPP
+
+#include <stdexcept>
+#include <vector>
+
+#include "../node/Constants.hpp"
+
+#ifdef __WINDOWS__
+
+#include <winsock2.h>
+#include <windows.h>
+#include <string.h>
+
+#include "../node/Mutex.hpp"
+
+namespace ZeroTier {
+
+template<typename C>
+static DWORD WINAPI ___zt_threadMain(LPVOID lpParam)
+{
+	try {
+		((C *)lpParam)->threadMain();
+	} catch ( ... ) {}
+	return 0;
+}
+
+class Thread
+{
+public:
+	Thread()
+	{
+		_th = NULL;
+		_tid = 0;
+	}
+
+	template<typename C>
+	static inline Thread start(C *instance)
+	{
+		Thread t;
+		t._th = CreateThread(NULL,0,&___zt_threadMain<C>,(LPVOID)instance,0,&t._tid);
+		if (t._th == NULL)
+			throw std::runtime_error("CreateThread() failed");
+		return t;
+	}
+
+	static inline void join(const Thread &t)
+	{
+		if (t._th != NULL) {
+			for(;;) {
+				DWORD ec = STILL_ACTIVE;
+				GetExitCodeThread(t._th,&ec);
+				if (ec == STILL_ACTIVE)
+					WaitForSingleObject(t._th,1000);
+				else break;
+			}
+		}
+	}
+
+	static inline void sleep(unsigned long ms)
+	{
+		Sleep((DWORD)ms);
+	}
+
+	/**
+	 * Pin the calling thread to a set of CPUs
+	 *
+	 * @param cpus Zero-based CPU indexes the thread may run on
+	 * @return True on success
+	 */
+	static inline bool setCurrentThreadAffinity(const std::vector<unsigned int> &cpus)
+	{
+		DWORD_PTR mask = 0;
+		for(std::vector<unsigned int>::const_iterator c(cpus.begin());c!=cpus.end();++c) {
+			if (*c < (sizeof(DWORD_PTR) * 8))
+				mask |= (((DWORD_PTR)1) << *c);
+		}
+		if (!mask)
+			return false;
+		return (SetThreadAffinityMask(GetCurrentThread(),mask) != 0);
+	}
+
+	/**
+	 * Pin the calling thread to the CPUs of one NUMA node
+	 *
+	 * With first-touch allocation this also keeps the thread's memory on the
+	 * same socket, avoiding cross-node traffic on multi-socket machines.
+	 *
+	 * @param node NUMA node number
+	 * @return True on success
+	 */
+	static inline bool setCurrentThreadToNumaNode(unsigned int node)
+	{
+		ULONGLONG mask = 0;
+		if (!GetNumaNodeProcessorMask((UCHAR)node,&mask))
+			return false;
+		if (!mask)
+			return false;
+		return (SetThreadAffinityMask(GetCurrentThread(),(DWORD_PTR)mask) != 0);
+	}
+
+	/**
+	 * Raise the calling thread's scheduling priority a notch
+	 *
+	 * For latency-sensitive datapath threads; this is not a realtime class.
+	 *
+	 * @return True on success
+	 */
+	static inline bool setCurrentThreadHighPriority()
+	{
+		return (SetThreadPriority(GetCurrentThread(),THREAD_PRIORITY_ABOVE_NORMAL) != 0);
+	}
+
+	// Not available on *nix platforms
+	static inline void cancelIO(const Thread &t)
+	{
+#if !defined(__MINGW32__) && !defined(__MINGW64__) // CancelSynchronousIo not available in MSYS2
+		if (t._th != NULL)
+			CancelSynchronousIo(t._th);
+#endif
+	}
+
+	inline operator bool() const { return (_th != NULL); }
+
+private:
+	HANDLE _th;
+	DWORD _tid;
+};
+
+} // namespace ZeroTier
+
+#else
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef __LINUX__
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+#ifdef __FreeBSD__
+#include <pthread_np.h>
+#endif
+
+namespace ZeroTier {
+
+template<typename C>
+static void *___zt_threadMain(void *instance)
+{
+	try {
+		((C *)instance)->threadMain();
+	} catch ( ... ) {}
+	return (void *)0;
+}
+
+/**
+ * A thread identifier, and static methods to start and join threads
+ */
+class Thread
+{
+public:
+	Thread()
+	{
+		memset(this,0,sizeof(Thread));
+	}
+
+	Thread(const Thread &t)
+	{
+		memcpy(this,&t,sizeof(Thread));
+	}
+
+	inline Thread &operator=(const Thread &t)
+	{
+		memcpy(this,&t,sizeof(Thread));
+		return *this;
+	}
+
+	/**
+	 * Start a new thread
+	 *
+	 * @param instance Instance whose threadMain() method gets called by new thread
+	 * @return Thread identifier
+	 * @throws std::runtime_error Unable to create thread
+	 * @tparam C Class containing threadMain()
+	 */
+	template<typename C>
+	static inline Thread start(C *instance)
+	{
+		Thread t;
+		pthread_attr_t tattr;
+		pthread_attr_init(&tattr);
+		// This corrects for systems with abnormally small defaults (musl) and also
+		// shrinks the stack on systems with large defaults to save a bit of memory.
+		pthread_attr_setstacksize(&tattr,ZT_THREAD_MIN_STACK_SIZE);
+		if (pthread_create(&t._tid,&tattr,&___zt_threadMain<C>,instance)) {
+			pthread_attr_destroy(&tattr);
+			throw std::runtime_error("pthread_create() failed, unable to create thread");
+		} else {
+			t._started = true;
+			pthread_attr_destroy(&tattr);
+		}
+		return t;
+	}
+
+	/**
+	 * Join to a thread, waiting for it to terminate (does nothing on null Thread values)
+	 *
+	 * @param t Thread to join
+	 */
+	static inline void join(const Thread &t)
+	{
+		if (t._started)
+			pthread_join(t._tid,(void **)0);
+	}
+
+	/**
+	 * Sleep the current thread
+	 *
+	 * @param ms Number of milliseconds to sleep
+	 */
+	static inline void sleep(unsigned long ms) { usleep(ms * 1000); }
+
+	/**
+	 * Pin the calling thread to a set of CPUs
+	 *
+	 * @param cpus Zero-based CPU indexes the thread may run on
+	 * @return True on success (false on platforms without affinity support)
+	 */
+	static inline bool setCurrentThreadAffinity(const std::vector<unsigned int> &cpus)
+	{
+#if defined(__LINUX__) || defined(__FreeBSD__)
+		if (cpus.empty())
+			return false;
+#ifdef __LINUX__
+		cpu_set_t cs;
+#else
+		cpuset_t cs;
+#endif
+		CPU_ZERO(&cs);
+		for(std::vector<unsigned int>::const_iterator c(cpus.begin());c!=cpus.end();++c)
+			CPU_SET(*c,&cs);
+		return (pthread_setaffinity_np(pthread_self(),sizeof(cs),&cs) == 0);
+#else
+		return false;
+#endif
+	}
+
+	/**
+	 * Pin the calling thread to the CPUs of one NUMA node
+	 *
+	 * This only constrains scheduling, but with first-touch allocation that
+	 * also keeps the thread's memory on the same socket, avoiding cross-node
+	 * traffic on multi-socket machines. Applied to the main thread before
+	 * workers spawn it is inherited by every child thread.
+	 *
+	 * @param node NUMA node number (as in /sys/devices/system/node)
+	 * @return True on success (false on platforms without NUMA support)
+	 */
+	static inline bool setCurrentThreadToNumaNode(unsigned int node)
+	{
+#ifdef __LINUX__
+		char tmp[256];
+		snprintf(tmp,sizeof(tmp),"/sys/devices/system/node/node%u/cpulist",node);
+		FILE *f = fopen(tmp,"r");
+		if (!f)
+			return false;
+		std::vector<unsigned int> cpus;
+		if (fgets(tmp,sizeof(tmp),f)) {
+			// cpulist is comma-separated ranges, e.g. "0-15,32-47"
+			char *saveptr = (char *)0;
+			for(char *tok=strtok_r(tmp,",\n",&saveptr);(tok);tok=strtok_r((char *)0,",\n",&saveptr)) {
+				unsigned long start,end;
+				char *const dash = strchr(tok,'-');
+				if (dash) {
+					*dash = (char)0;
+					start = strtoul(tok,(char **)0,10);
+					end = strtoul(dash + 1,(char **)0,10);
+				} else {
+					start = end = strtoul(tok,(char **)0,10);
+				}
+				for(unsigned long c=start;c<=end;++c)
+					cpus.push_back((unsigned int)c);
+			}
+		}
+		fclose(f);
+		if (cpus.empty())
+			return false;
+		return setCurrentThreadAffinity(cpus);
+#else
+		return false;
+#endif
+	}
+
+	/**
+	 * Raise the calling thread's scheduling priority a notch
+	 *
+	 * For latency-sensitive datapath threads; this is not a realtime class
+	 * and silently does nothing where elevated priority needs privileges we
+	 * don't have.
+	 *
+	 * @return True on success
+	 */
+	static inline bool setCurrentThreadHighPriority()
+	{
+#ifdef __LINUX__
+		return (::setpriority(PRIO_PROCESS,(id_t)syscall(SYS_gettid),-10) == 0);
+#else
+		return false;
+#endif
+	}
+
+	inline operator bool() const { return (_started); }
+
+private:
+	pthread_t _tid;
+	volatile bool _started;
+};
+
+} // namespace ZeroTier
+
+#endif // __WINDOWS__ / !__WINDOWS__
+
+#endif
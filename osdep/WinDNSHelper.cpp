@@ -6,6 +6,10 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <strsafe.h>
 
 #define MAX_KEY_LENGTH 255
@@ -240,6 +244,21 @@ std::vector<std::string> getValueList(const char* key) {
 	return values;
 }
 
+// Pending DNS changes keyed by network ID. The newest change for a network
+// replaces any older queued one, so a burst of config callbacks at boot
+// collapses into one registry pass per network, applied off the callback path.
+struct PendingDNSChange
+{
+	std::string domain;
+	std::vector<InetAddress> servers;
+};
+
+static std::mutex s_dnsPending_l;
+static std::condition_variable s_dnsPending_c;
+static std::map<uint64_t, PendingDNSChange> s_dnsPending;
+static std::mutex s_dnsApply_l; // held while touching DnsPolicyConfig
+static bool s_dnsWorkerStarted = false;
+
 std::pair<bool, std::string> WinDNSHelper::hasDNSConfig(uint64_t nwid)
 {
 	char networkStr[20] = { 0 };
@@ -288,7 +307,7 @@ std::pair<bool, std::string> WinDNSHelper::hasDNSConfig(uint64_t nwid)
 	return std::make_pair(false, std::string());
 }
 
-void WinDNSHelper::setDNS(uint64_t nwid, const char* domain, const std::vector<InetAddress>& servers)
+void WinDNSHelper::applyDNS(uint64_t nwid, const std::string& domain, const std::vector<InetAddress>& servers)
 {
 	auto hasConfig = hasDNSConfig(nwid);
 
@@ -334,7 +353,7 @@ void WinDNSHelper::setDNS(uint64_t nwid, const char* domain, const std::vector<I
 			RegSetKeyValueA(dnsKey, NULL, "DisplayName", REG_SZ, "", 0);
 			RegSetKeyValueA(dnsKey, NULL, "GenericDNSServers", REG_SZ, serverValue.data(), serverValue.length());
 			RegSetKeyValueA(dnsKey, NULL, "IPSECCARestriction", REG_SZ, "", 0);
-			std::string d = "." + std::string(domain);
+			std::string d = "." + domain;
 			RegSetKeyValueA(dnsKey, NULL, "Name", REG_MULTI_SZ, d.data(), d.length());
 			DWORD version = 2;
 			RegSetKeyValueA(dnsKey, NULL, "Version", REG_DWORD, &version, sizeof(DWORD));
@@ -342,8 +361,52 @@ void WinDNSHelper::setDNS(uint64_t nwid, const char* domain, const std::vector<I
 	}
 }
 
+void WinDNSHelper::dnsWorker()
+{
+	// Lives for the rest of the process once the first DNS change is queued.
+	std::unique_lock<std::mutex> l(s_dnsPending_l);
+	for (;;) {
+		while (s_dnsPending.empty()) {
+			s_dnsPending_c.wait(l);
+		}
+		std::map<uint64_t, PendingDNSChange> batch;
+		batch.swap(s_dnsPending);
+		l.unlock();
+		{
+			std::lock_guard<std::mutex> al(s_dnsApply_l);
+			for (auto it = batch.begin(); it != batch.end(); ++it) {
+				applyDNS(it->first, it->second.domain, it->second.servers);
+			}
+		}
+		l.lock();
+	}
+}
+
+void WinDNSHelper::setDNS(uint64_t nwid, const char* domain, const std::vector<InetAddress>& servers)
+{
+	// Queue the change for the worker so the network config callback returns
+	// immediately instead of serializing joins on registry writes.
+	std::lock_guard<std::mutex> l(s_dnsPending_l);
+	PendingDNSChange& c = s_dnsPending[nwid];
+	c.domain = domain;
+	c.servers = servers;
+	if (!s_dnsWorkerStarted) {
+		s_dnsWorkerStarted = true;
+		std::thread(&WinDNSHelper::dnsWorker).detach();
+	}
+	s_dnsPending_c.notify_one();
+}
+
 void WinDNSHelper::removeDNS(uint64_t nwid)
 {
+	// Removals happen on network leave and service shutdown, where we must not
+	// exit before the policy is gone, so they run synchronously. Drop any
+	// queued set for this network first so the worker cannot re-add it.
+	{
+		std::lock_guard<std::mutex> l(s_dnsPending_l);
+		s_dnsPending.erase(nwid);
+	}
+	std::lock_guard<std::mutex> al(s_dnsApply_l);
 	auto hasConfig = hasDNSConfig(nwid);
 	if (hasConfig.first) {
 		RegDelnode(HKEY_LOCAL_MACHINE, hasConfig.second.c_str());
@@ -2,6 +2,7 @@
 #define WIN_DNS_HELPER_H_
 
 #include <vector>
+#include <string>
 #include <cstdint>
 #include "../node/InetAddress.hpp"
 
@@ -17,6 +18,8 @@ public:
 
 private:
 	static std::pair<bool, std::string> hasDNSConfig(uint64_t nwid);
+	static void applyDNS(uint64_t nwid, const std::string& domain, const std::vector<InetAddress>& servers);
+	static void dnsWorker();
 };
 
 }
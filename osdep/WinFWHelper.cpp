@@ -1,18 +1,189 @@
 #include "WinFWHelper.hpp"
 
+#include "../node/Mutex.hpp"
+
+#include <windows.h>
+#include <netfw.h>
+#include <oleauto.h>
+
+#include <string>
+#include <vector>
 
 namespace ZeroTier {
 
+namespace {
 
+// One cached COM session to the local firewall policy, shared by all calls.
+// Joining a network applies several rules back to back; activating
+// NetFwPolicy2 once and holding the rule collection keeps each additional
+// rule to a single in-process COM call instead of a process spawn, which is
+// what made network joins take seconds.
+static Mutex s_fwRules_l;
+static INetFwRules *s_fwRules = (INetFwRules *)0;
 
-void ZeroTier::WinFWHelper::newICMPRule(const InetAddress& ip, uint64_t nwid)
+static BSTR _toBSTR(const std::string &s)
+{
+	const int len = MultiByteToWideChar(CP_UTF8,0,s.c_str(),-1,(LPWSTR)0,0);
+	BSTR b = SysAllocStringLen((const OLECHAR *)0,(len > 0) ? (UINT)(len - 1) : 0);
+	if ((b)&&(len > 0)) {
+		MultiByteToWideChar(CP_UTF8,0,s.c_str(),-1,b,len);
+	}
+	return b;
+}
+
+static std::wstring _toWide(const std::string &s)
+{
+	std::wstring w;
+	const int len = MultiByteToWideChar(CP_UTF8,0,s.c_str(),-1,(LPWSTR)0,0);
+	if (len > 1) {
+		w.resize(len - 1);
+		MultiByteToWideChar(CP_UTF8,0,s.c_str(),-1,&w[0],len);
+	}
+	return w;
+}
+
+static std::string _nwidToString(uint64_t nwid)
 {
 	char nwString[32] = { 0 };
-	char ipbuf[64];
+	sprintf(nwString, "%.16llx", (unsigned long long)nwid);
+	return std::string(nwString);
+}
+
+// assumes s_fwRules_l is held
+static INetFwRules *_fwRules()
+{
+	if (s_fwRules) {
+		return s_fwRules;
+	}
+
+	const HRESULT hrInit = CoInitializeEx((LPVOID)0, COINIT_MULTITHREADED);
+	if ((FAILED(hrInit))&&(hrInit != RPC_E_CHANGED_MODE)) {
+		return (INetFwRules *)0;
+	}
+
+	INetFwPolicy2 *policy = (INetFwPolicy2 *)0;
+	if (FAILED(CoCreateInstance(__uuidof(NetFwPolicy2), (LPUNKNOWN)0, CLSCTX_INPROC_SERVER, __uuidof(INetFwPolicy2), (void **)&policy))) {
+		return (INetFwRules *)0;
+	}
+	INetFwRules *rules = (INetFwRules *)0;
+	if (FAILED(policy->get_Rules(&rules))) {
+		rules = (INetFwRules *)0;
+	}
+	policy->Release();
 
-	sprintf(nwString, "%.16llx", nwid);
-	std::string nwString2 = { nwString };
-	
+	s_fwRules = rules;
+	return s_fwRules;
+}
+
+static void _addIcmpRule(const std::string &name, long protocol, const std::string &address, uint64_t nwid)
+{
+	Mutex::Lock _l(s_fwRules_l);
+	INetFwRules *const rules = _fwRules();
+	if (!rules) {
+		return;
+	}
+
+	INetFwRule *rule = (INetFwRule *)0;
+	if (FAILED(CoCreateInstance(__uuidof(NetFwRule), (LPUNKNOWN)0, CLSCTX_INPROC_SERVER, __uuidof(INetFwRule), (void **)&rule))) {
+		return;
+	}
+
+	BSTR bName = _toBSTR(name);
+	BSTR bAddr = _toBSTR(address);
+	rule->put_Name(bName);
+	rule->put_Protocol(protocol);
+	rule->put_LocalAddresses(bAddr);
+	rule->put_Direction(NET_FW_RULE_DIR_IN);
+	rule->put_Action(NET_FW_ACTION_ALLOW);
+	rule->put_Profiles(NET_FW_PROFILE2_ALL);
+	rule->put_Enabled(VARIANT_TRUE);
+	SysFreeString(bName);
+	SysFreeString(bAddr);
+
+	// scope the rule to this network's interface ("ZeroTier One [<nwid>]")
+	SAFEARRAY *ifArray = SafeArrayCreateVector(VT_VARIANT, 0, 1);
+	if (ifArray) {
+		VARIANT ifName;
+		VariantInit(&ifName);
+		ifName.vt = VT_BSTR;
+		ifName.bstrVal = _toBSTR(std::string("ZeroTier One [") + _nwidToString(nwid) + "]");
+		LONG idx = 0;
+		SafeArrayPutElement(ifArray, &idx, &ifName); // copies the element
+		VariantClear(&ifName);
+
+		VARIANT ifs;
+		VariantInit(&ifs);
+		ifs.vt = VT_ARRAY | VT_VARIANT;
+		ifs.parray = ifArray;
+		rule->put_Interfaces(ifs);
+		VariantClear(&ifs); // frees the array
+	}
+
+	rules->Add(rule);
+	rule->Release();
+}
+
+// Removes every rule whose name matches (exactly, or by prefix). Matching is
+// done on the display name, which is also what the PowerShell-created rules
+// of older versions carried, so upgrades clean up after them too.
+static void _removeRules(const std::string &match, bool prefixMatch)
+{
+	Mutex::Lock _l(s_fwRules_l);
+	INetFwRules *const rules = _fwRules();
+	if (!rules) {
+		return;
+	}
+
+	IUnknown *enumUnknown = (IUnknown *)0;
+	if ((FAILED(rules->get__NewEnum(&enumUnknown)))||(!enumUnknown)) {
+		return;
+	}
+	IEnumVARIANT *enumVariant = (IEnumVARIANT *)0;
+	enumUnknown->QueryInterface(__uuidof(IEnumVARIANT), (void **)&enumVariant);
+	enumUnknown->Release();
+	if (!enumVariant) {
+		return;
+	}
+
+	const std::wstring wmatch(_toWide(match));
+	std::vector<std::wstring> toRemove;
+
+	VARIANT v;
+	VariantInit(&v);
+	ULONG fetched = 0;
+	while ((enumVariant->Next(1, &v, &fetched) == S_OK)&&(fetched > 0)) {
+		if (v.vt == VT_DISPATCH) {
+			INetFwRule *rule = (INetFwRule *)0;
+			if (SUCCEEDED(v.pdispVal->QueryInterface(__uuidof(INetFwRule), (void **)&rule))) {
+				BSTR name = (BSTR)0;
+				if ((SUCCEEDED(rule->get_Name(&name)))&&(name)) {
+					const bool matches = prefixMatch ? (wcsncmp(name, wmatch.c_str(), wmatch.length()) == 0) : (wcscmp(name, wmatch.c_str()) == 0);
+					if (matches) {
+						toRemove.push_back(std::wstring(name));
+					}
+					SysFreeString(name);
+				}
+				rule->Release();
+			}
+		}
+		VariantClear(&v);
+	}
+	enumVariant->Release();
+
+	for(std::vector<std::wstring>::const_iterator r(toRemove.begin());r!=toRemove.end();++r) {
+		BSTR bName = SysAllocStringLen(r->c_str(), (UINT)r->length());
+		if (bName) {
+			rules->Remove(bName);
+			SysFreeString(bName);
+		}
+	}
+}
+
+} // anonymous namespace
+
+void ZeroTier::WinFWHelper::newICMPRule(const InetAddress& ip, uint64_t nwid)
+{
+	char ipbuf[64];
 	ip.toString(ipbuf);
 
 	if (ip.isV4()) {
@@ -25,12 +196,7 @@ void ZeroTier::WinFWHelper::newICMPRule(const InetAddress& ip, uint64_t nwid)
 
 void ZeroTier::WinFWHelper::removeICMPRule(const InetAddress& ip, uint64_t nwid)
 {
-	char nwString[32] = { 0 };
 	char ipbuf[64];
-
-	sprintf(nwString, "%.16llx", nwid);
-	std::string nwString2 = { nwString };
-
 	ip.toString(ipbuf);
 
 	if (ip.isV4()) {
@@ -45,128 +211,50 @@ void ZeroTier::WinFWHelper::removeICMPRule(const InetAddress& ip, uint64_t nwid)
 void WinFWHelper::newICMPv4Rule(std::string address, uint64_t nwid)
 {
 	// allows icmp, scoped to a specific ip address and interface name
-
-	char nwString[32] = { 0 };
-	sprintf(nwString, "%.16llx", nwid);
-	std::string nwString2 = { nwString };
-
-		std::string cmd = R"(C:\Windows\System32\WindowsPowershell\v1.0\powershell.exe "New-NetFirewallRule -DisplayName zerotier-icmpv4-)" + nwString2 + address +
-			R"( -InterfaceAlias 'ZeroTier One `[)" + nwString2 + R"(`]')" + 
-			" -Protocol ICMPv4 -Action Allow" + 
-			" -LocalAddress " + address + "\"\r\n";
-		
-		_run(cmd);
+	_addIcmpRule("zerotier-icmpv4-" + _nwidToString(nwid) + address, 1, address, nwid);
 }
 
 void WinFWHelper::newICMPv6Rule(std::string address, uint64_t nwid)
 {
-		// allows icmp, scoped to a specific ip address and interface name
-
-		char nwString[32] = { 0 };
-		sprintf(nwString, "%.16llx", nwid);
-		std::string nwString2 = { nwString };
-
-		std::string cmd = R"(C:\Windows\System32\WindowsPowershell\v1.0\powershell.exe "New-NetFirewallRule -DisplayName zerotier-icmpv6-)" + nwString2 + address +
-			R"( -InterfaceAlias 'ZeroTier One `[)" + nwString2 + R"(`]')" + 
-			" -Protocol ICMPv6 -Action Allow" + 
-			" -LocalAddress " + address + "\"\r\n";
-
-		_run(cmd);
+	// allows icmp, scoped to a specific ip address and interface name
+	_addIcmpRule("zerotier-icmpv6-" + _nwidToString(nwid) + address, 58, address, nwid);
 }
 
 void WinFWHelper::removeICMPv4Rule(std::string addr, uint64_t nwid)
 {
-		// removes 1 icmp firewall rule
-
-		char nwString[32] = { 0 };
-		sprintf(nwString, "%.16llx", nwid);
-		std::string nwString2 = { nwString };
-
-		std::string cmd = R"(C:\Windows\System32\WindowsPowershell\v1.0\powershell.exe "Remove-NetFirewallRule -DisplayName zerotier-icmpv4-)" + nwString2 + addr +
-		 "\"\r\n";
-
-		_run(cmd);
+	// removes 1 icmp firewall rule
+	_removeRules("zerotier-icmpv4-" + _nwidToString(nwid) + addr, false);
 }
 
 void WinFWHelper::removeICMPv6Rule(std::string addr, uint64_t nwid)
 {
-		// removes 1 icmp firewall rule
-
-		char nwString[32] = { 0 };
-		sprintf(nwString, "%.16llx", nwid);
-		std::string nwString2 = { nwString };
-
-		std::string cmd = R"(C:\Windows\System32\WindowsPowershell\v1.0\powershell.exe "Remove-NetFirewallRule -DisplayName zerotier-icmpv6-)" + nwString2 + addr +
-		 "\"\r\n";
-
-		_run(cmd);
+	// removes 1 icmp firewall rule
+	_removeRules("zerotier-icmpv6-" + _nwidToString(nwid) + addr, false);
 }
 
 void WinFWHelper::removeICMPv4Rules(uint64_t nwid)
 {
-		// removes all icmp firewall rules for this network id
-
-		char nwString[32] = { 0 };
-		sprintf(nwString, "%.16llx", nwid);
-		std::string nwString2 = { nwString };
-
-		std::string cmd = R"(C:\Windows\System32\WindowsPowershell\v1.0\powershell.exe "Remove-NetFirewallRule -DisplayName zerotier-icmpv4-)" + nwString2 + "*\" \r\n";
-		
-		_run(cmd);
+	// removes all icmp firewall rules for this network id
+	_removeRules("zerotier-icmpv4-" + _nwidToString(nwid), true);
 }
 
 void WinFWHelper::removeICMPv6Rules(uint64_t nwid)
 {
-		// removes all icmp firewall rules for this network id
-
-		char nwString[32] = { 0 };
-		sprintf(nwString, "%.16llx", nwid);
-		std::string nwString2 = { nwString };
-
-		std::string cmd = R"(C:\Windows\System32\WindowsPowershell\v1.0\powershell.exe "Remove-NetFirewallRule -DisplayName zerotier-icmpv6-)" + nwString2 + "*\" \r\n";
-
-		_run(cmd);
+	// removes all icmp firewall rules for this network id
+	_removeRules("zerotier-icmpv6-" + _nwidToString(nwid), true);
 }
 
 void WinFWHelper::removeICMPRules()
 {
-		// removes all icmp firewall rules for all networks
-
-		std::string cmd = R"(C:\Windows\System32\WindowsPowershell\v1.0\powershell.exe "Remove-NetFirewallRule -DisplayName zerotier-icmp*)" + std::string("\r\n");
-
-		_run(cmd);
+	// removes all icmp firewall rules for all networks
+	_removeRules("zerotier-icmp", true);
 }
 
 void WinFWHelper::removeICMPRules(uint64_t nwid)
 {
-		// removes all icmp firewall rules for this network
-		WinFWHelper::removeICMPv4Rules(nwid);
-		WinFWHelper::removeICMPv6Rules(nwid);
-}
-
-
-
-void WinFWHelper::_run(std::string cmd)
-{
-		
-		#ifdef ZT_DEBUG
-				fprintf(stderr, cmd.c_str());
-		#endif
-
-		STARTUPINFOA startupInfo;
-		PROCESS_INFORMATION processInfo;
-		startupInfo.cb = sizeof(startupInfo);
-		memset(&startupInfo, 0, sizeof(STARTUPINFOA));
-		memset(&processInfo, 0, sizeof(PROCESS_INFORMATION));
-
-		if (CreateProcessA(NULL, (LPSTR)cmd.c_str(), NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, NULL, &startupInfo, &processInfo)) {
-			WaitForSingleObject(processInfo.hProcess, INFINITE);
-
-			CloseHandle(processInfo.hProcess);
-			CloseHandle(processInfo.hThread);
-		}
+	// removes all icmp firewall rules for this network
+	WinFWHelper::removeICMPv4Rules(nwid);
+	WinFWHelper::removeICMPv6Rules(nwid);
 }
 
-
-
-}	// namespace ZeroTier
\ No newline at end of file
+}	// namespace ZeroTier
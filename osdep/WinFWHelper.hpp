@@ -17,7 +17,6 @@ class WinFWHelper {
 
 
   private:
-	static void _run(std::string cmd);
 	static void newICMPv4Rule(std::string address, uint64_t nwid);
 	static void newICMPv6Rule(std::string address, uint64_t nwid);
 	static void removeICMPv4Rule(std::string address, uint64_t nwid);
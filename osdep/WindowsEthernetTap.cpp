@@ -51,6 +51,12 @@
 // Create a fake unused default route to force detection of network type on networks without gateways
 #define ZT_WINDOWS_CREATE_FAKE_DEFAULT_ROUTE
 
+// Number of overlapped reads kept outstanding against the NDIS device
+#define ZT_WINDOWS_TAP_CONCURRENT_READS 4
+
+// Maximum number of recycled inject frames kept around for reuse by put()
+#define ZT_WINDOWS_TAP_FRAME_POOL_MAX 256
+
 // Function signatures of dynamically loaded functions, from newdev.h, setupapi.h, and cfgmgr32.h
 typedef BOOL (WINAPI *UpdateDriverForPlugAndPlayDevicesA_t)(_In_opt_ HWND hwndParent,_In_ LPCSTR HardwareId,_In_ LPCSTR FullInfPath,_In_ DWORD InstallFlags,_Out_opt_ PBOOL bRebootRequired);
 typedef BOOL (WINAPI *SetupDiGetINFClassA_t)(_In_ PCSTR InfName,_Out_ LPGUID ClassGuid,_Out_writes_(ClassNameSize) PSTR ClassName,_In_ DWORD ClassNameSize,_Out_opt_ PDWORD RequiredSize);
@@ -653,6 +659,17 @@ WindowsEthernetTap::~WindowsEthernetTap()
 	ReleaseSemaphore(_injectSemaphore,1,NULL);
 	Thread::join(_thread);
 	CloseHandle(_injectSemaphore);
+	{
+		Mutex::Lock _l(_injectPending_m);
+		while (!_injectPending.empty()) {
+			delete _injectPending.front();
+			_injectPending.pop_front();
+		}
+		while (!_framePool.empty()) {
+			delete _framePool.back();
+			_framePool.pop_back();
+		}
+	}
 	setPersistentTapDeviceState(_deviceInstanceId.c_str(),false);
 }
 
@@ -797,14 +814,21 @@ void WindowsEthernetTap::put(const MAC &from,const MAC &to,unsigned int etherTyp
 		return;
 
 	Mutex::Lock _l(_injectPending_m);
-	_injectPending.emplace();
-	_injectPending.back().len = len + 14;
-	char *const d = _injectPending.back().data;
+	_InjectPending *f;
+	if (_framePool.empty()) {
+		f = new _InjectPending;
+	} else {
+		f = _framePool.back();
+		_framePool.pop_back();
+	}
+	f->len = len + 14;
+	char *const d = f->data;
 	to.copyTo(d,6);
 	from.copyTo(d + 6,6);
 	d[12] = (char)((etherType >> 8) & 0xff);
 	d[13] = (char)(etherType & 0xff);
 	memcpy(d + 14,data,len);
+	_injectPending.push_back(f);
 
 	ReleaseSemaphore(_injectSemaphore,1,NULL);
 }
@@ -970,10 +994,10 @@ void WindowsEthernetTap::threadMain()
 		return;
 	}
 
-	char tapReadBuf[ZT_MAX_MTU + 32];
+	char tapReadBuf[ZT_WINDOWS_TAP_CONCURRENT_READS][ZT_MAX_MTU + 32];
 	char tapPath[128];
-	HANDLE wait4[3];
-	OVERLAPPED tapOvlRead,tapOvlWrite;
+	HANDLE wait4[ZT_WINDOWS_TAP_CONCURRENT_READS + 2];
+	OVERLAPPED tapOvlRead[ZT_WINDOWS_TAP_CONCURRENT_READS],tapOvlWrite;
 
 	OSUtils::ztsnprintf(tapPath,sizeof(tapPath),"\\\\.\\Global\\%s.tap",_netCfgInstanceId.c_str());
 
@@ -1087,16 +1111,19 @@ void WindowsEthernetTap::threadMain()
 				_syncIps();
 			}
 
-			memset(&tapOvlRead,0,sizeof(tapOvlRead));
-			tapOvlRead.hEvent = CreateEvent(NULL,TRUE,FALSE,NULL);
+			memset(tapOvlRead,0,sizeof(tapOvlRead));
 			memset(&tapOvlWrite,0,sizeof(tapOvlWrite));
 			tapOvlWrite.hEvent = CreateEvent(NULL,TRUE,FALSE,NULL);
 
 			wait4[0] = _injectSemaphore;
-			wait4[1] = tapOvlRead.hEvent;
-			wait4[2] = tapOvlWrite.hEvent; // only included if writeInProgress is true
+			for(int r=0;r<ZT_WINDOWS_TAP_CONCURRENT_READS;++r) {
+				tapOvlRead[r].hEvent = CreateEvent(NULL,TRUE,FALSE,NULL);
+				wait4[1 + r] = tapOvlRead[r].hEvent;
+			}
+			wait4[1 + ZT_WINDOWS_TAP_CONCURRENT_READS] = tapOvlWrite.hEvent; // only included if writeInProgress is true
 
-			ReadFile(_tap,tapReadBuf,sizeof(tapReadBuf),NULL,&tapOvlRead);
+			for(int r=0;r<ZT_WINDOWS_TAP_CONCURRENT_READS;++r)
+				ReadFile(_tap,tapReadBuf[r],sizeof(tapReadBuf[r]),NULL,&tapOvlRead[r]);
 			bool writeInProgress = false;
 			ULONGLONG timeOfLastBorkCheck = GetTickCount64();
 			_initialized = true;
@@ -1105,7 +1132,7 @@ void WindowsEthernetTap::threadMain()
 			setFriendlyName(_friendlyName.c_str());
 
 			while (_run) {
-				DWORD waitResult = WaitForMultipleObjectsEx(writeInProgress ? 3 : 2,wait4,FALSE,2500,TRUE);
+				DWORD waitResult = WaitForMultipleObjectsEx(writeInProgress ? (ZT_WINDOWS_TAP_CONCURRENT_READS + 2) : (ZT_WINDOWS_TAP_CONCURRENT_READS + 1),wait4,FALSE,2500,TRUE);
 				if (!_run) break; // will also break outer while(_run) since _run is false
 
 				// Check for changes in MTU and break to restart tap device to reconfigure in this case
@@ -1147,40 +1174,61 @@ void WindowsEthernetTap::threadMain()
 					continue;
 				}
 
-				if (HasOverlappedIoCompleted(&tapOvlRead)) {
-					DWORD bytesRead = 0;
-					if (GetOverlappedResult(_tap,&tapOvlRead,&bytesRead,FALSE)) {
-						if ((bytesRead > 14)&&(_enabled)) {
-							MAC to(tapReadBuf,6);
-							MAC from(tapReadBuf + 6,6);
-							unsigned int etherType = ((((unsigned int)tapReadBuf[12]) & 0xff) << 8) | (((unsigned int)tapReadBuf[13]) & 0xff);
-							try {
-								_handler(_arg,(void *)0,_nwid,from,to,etherType,0,tapReadBuf + 14,bytesRead - 14);
-							} catch ( ... ) {} // handlers should not throw
+				for(int r=0;r<ZT_WINDOWS_TAP_CONCURRENT_READS;++r) {
+					if (HasOverlappedIoCompleted(&tapOvlRead[r])) {
+						DWORD bytesRead = 0;
+						if (GetOverlappedResult(_tap,&tapOvlRead[r],&bytesRead,FALSE)) {
+							if ((bytesRead > 14)&&(_enabled)) {
+								MAC to(tapReadBuf[r],6);
+								MAC from(tapReadBuf[r] + 6,6);
+								unsigned int etherType = ((((unsigned int)tapReadBuf[r][12]) & 0xff) << 8) | (((unsigned int)tapReadBuf[r][13]) & 0xff);
+								try {
+									_handler(_arg,(void *)0,_nwid,from,to,etherType,0,tapReadBuf[r] + 14,bytesRead - 14);
+								} catch ( ... ) {} // handlers should not throw
+							}
 						}
+						ReadFile(_tap,tapReadBuf[r],sizeof(tapReadBuf[r]),NULL,&tapOvlRead[r]);
 					}
-					ReadFile(_tap,tapReadBuf,ZT_MAX_MTU + 32,NULL,&tapOvlRead);
 				}
 
+				_injectPending_m.lock();
 				if (writeInProgress) {
 					if (HasOverlappedIoCompleted(&tapOvlWrite)) {
 						writeInProgress = false;
-						_injectPending_m.lock();
-						_injectPending.pop();
-					} else continue; // still writing, so skip code below and wait
-				} else _injectPending_m.lock();
-
-				if (!_injectPending.empty()) {
-					WriteFile(_tap,_injectPending.front().data,_injectPending.front().len,NULL,&tapOvlWrite);
-					writeInProgress = true;
+						_InjectPending *const f = _injectPending.front();
+						_injectPending.pop_front();
+						if (_framePool.size() < ZT_WINDOWS_TAP_FRAME_POOL_MAX)
+							_framePool.push_back(f);
+						else delete f;
+					}
+				}
+				// Drain as much of the queue as completes synchronously so a burst
+				// of queued frames goes out in one wakeup rather than one frame
+				// per semaphore/event cycle.
+				while ((!writeInProgress)&&(!_injectPending.empty())) {
+					_InjectPending *const f = _injectPending.front();
+					if (WriteFile(_tap,f->data,f->len,NULL,&tapOvlWrite)) {
+						_injectPending.pop_front();
+						if (_framePool.size() < ZT_WINDOWS_TAP_FRAME_POOL_MAX)
+							_framePool.push_back(f);
+						else delete f;
+					} else if (GetLastError() == ERROR_IO_PENDING) {
+						writeInProgress = true;
+					} else {
+						// Write error: drop the frame rather than spinning on it
+						_injectPending.pop_front();
+						if (_framePool.size() < ZT_WINDOWS_TAP_FRAME_POOL_MAX)
+							_framePool.push_back(f);
+						else delete f;
+					}
 				}
-
 				_injectPending_m.unlock();
 			}
 
 			CancelIo(_tap);
 
-			CloseHandle(tapOvlRead.hEvent);
+			for(int r=0;r<ZT_WINDOWS_TAP_CONCURRENT_READS;++r)
+				CloseHandle(tapOvlRead[r].hEvent);
 			CloseHandle(tapOvlWrite.hEvent);
 			CloseHandle(_tap);
 			_tap = INVALID_HANDLE_VALUE;
@@ -20,7 +20,7 @@
 #include <ifdef.h>
 
 #include <string>
-#include <queue>
+#include <deque>
 #include <stdexcept>
 
 #include "../node/Constants.hpp"
@@ -144,7 +144,8 @@ private:
 		unsigned int len;
 		char data[ZT_MAX_MTU + 32];
 	};
-	std::queue<_InjectPending> _injectPending;
+	std::deque<_InjectPending *> _injectPending;
+	std::vector<_InjectPending *> _framePool; // recycled frames so put() does not allocate per frame
 	Mutex _injectPending_m;
 
 	std::string _pathToHelpers;
@@ -24,7 +24,10 @@
 #include <list>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
+#include <deque>
+#include <future>
 
 #include "../version.h"
 #include "../include/ZeroTierOne.h"
@@ -44,12 +47,14 @@
 #include "../node/Peer.hpp"
 
 #include "../osdep/Phy.hpp"
+#include "../osdep/Thread.hpp"
 #include "../osdep/OSUtils.hpp"
 #include "../osdep/Http.hpp"
 #include "../osdep/PortMapper.hpp"
 #include "../osdep/Binder.hpp"
 #include "../osdep/ManagedRoute.hpp"
-#include "../osdep/BlockingQueue.hpp"
+#include "../osdep/LinuxUringEngine.hpp"
+#include "../osdep/LinuxXdpEngine.hpp"
 
 #include "OneService.hpp"
 #include "SoftwareUpdater.hpp"
@@ -137,6 +142,10 @@ using json = nlohmann::json;
 // Attempt to engage TCP fallback after this many ms of no reply to packets sent to global-scope IPs
 #define ZT_TCP_FALLBACK_AFTER 60000
 
+// How long to wait for any direct global traffic after start/wake before
+// racing a TCP fallback connection alongside the continuing UDP attempts
+#define ZT_TCP_FALLBACK_RACE_AFTER 2000
+
 // How often to check for local interface addresses
 #define ZT_LOCAL_INTERFACE_CHECK_INTERVAL 60000
 
@@ -146,6 +155,12 @@ using json = nlohmann::json;
 // TCP activity timeout
 #define ZT_TCP_ACTIVITY_TIMEOUT 60000
 
+// How often the write-behind state writer flushes coalesced state objects to disk
+#define ZT_STATE_WRITE_FLUSH_PERIOD 1000
+
+// Maximum payload bytes queued per UDP socket when the kernel send buffer is full
+#define ZT_UDP_MAX_EGRESS_QUEUE_BYTES 262144
+
 #if ZT_VAULT_SUPPORT
 size_t curlResponseWrite(void *ptr, size_t size, size_t nmemb, std::string *data)
 {
@@ -626,6 +641,8 @@ static void _peerToJson(nlohmann::json &pj,const ZT_Peer *peer, SharedPtr<Bond>
 		j["expired"] = (bool)(peer->paths[i].expired != 0);
 		j["preferred"] = (bool)(peer->paths[i].preferred != 0);
 		j["localSocket"] = peer->paths[i].localSocket;
+		j["rateIn"] = peer->paths[i].rateIn;
+		j["rateOut"] = peer->paths[i].rateOut;
 		if (bond && peer->isBonded) {
 			uint64_t now = OSUtils::now();
 			j["ifname"] = std::string(peer->paths[i].ifname);
@@ -669,6 +686,39 @@ static void _moonToJson(nlohmann::json &mj,const World &world)
 
 class OneServiceImpl;
 
+#ifdef ZT_PHY_USE_UDP_GSO
+// Pending segmented (GSO) wire send. Consecutive equal-size UDP sends to the
+// same destination are coalesced into one buffer and handed to the kernel as
+// a single segmented send, so a burst of fragments costs one syscall. The
+// batch is per-thread and is only accumulated inside an explicit burst window
+// (a single packet or frame processing call) so a flush point always exists.
+struct UdpGsoBatch
+{
+	UdpGsoBatch() : open(false),sock((PhySocket *)0),segSize(0),len(0) {}
+	bool open;
+	PhySocket *sock;
+	InetAddress dest;
+	unsigned int segSize;
+	unsigned int len;
+	char buf[65507]; // max UDP payload; also the kernel's GSO send limit
+};
+static thread_local UdpGsoBatch s_udpGsoBatch;
+#endif
+
+#ifdef ZT_TCP_FALLBACK_RELAY
+// While a cork window is open (spanning a processWirePacket or
+// processVirtualNetworkFrame call that may emit several wire packets) TCP
+// fallback messages accumulate in the tunnel's write queue and are pushed
+// with one send() when the window closes, instead of one send() per message.
+struct TcpFallbackCork
+{
+	TcpFallbackCork() : open(false),pending(false) {}
+	bool open;
+	bool pending;
+};
+static thread_local TcpFallbackCork s_tcpFallbackCork;
+#endif
+
 static int SnodeVirtualNetworkConfigFunction(ZT_Node *node,void *uptr,void *tptr,uint64_t nwid,void **nuptr,enum ZT_VirtualNetworkConfigOperation op,const ZT_VirtualNetworkConfig *nwconf);
 static void SnodeEventCallback(ZT_Node *node,void *uptr,void *tptr,enum ZT_Event event,const void *metaData);
 static void SnodeStatePutFunction(ZT_Node *node,void *uptr,void *tptr,enum ZT_StateObjectType type,const uint64_t id[2],const void *data,int len);
@@ -755,9 +805,236 @@ struct OneServiceIncomingPacket
 	uint8_t data[ZT_MAX_MTU];
 };
 
+// Worker pool for the HTTP control plane with a bounded pending queue
+// (local.conf "controlPlaneThreads" / "controlPlaneMaxQueuedConnections").
+// When the queue is full a new connection is served inline on the accept
+// thread, so overflow becomes backpressure on accept() and excess
+// connections wait in the kernel listen backlog instead of piling up in
+// process memory.
+class ControlPlaneTaskQueue : public httplib::TaskQueue
+{
+public:
+	ControlPlaneTaskQueue(unsigned int threadCount,unsigned int maxPending) :
+		_maxPending(maxPending),
+		_shutdown(false)
+	{
+		for(unsigned int t=0;t<threadCount;++t) {
+			_workers.emplace_back([this]() {
+				for(;;) {
+					std::function<void()> fn;
+					{
+						std::unique_lock<std::mutex> l(_lock);
+						_notEmpty.wait(l,[this]() { return ((!_jobs.empty())||(_shutdown)); });
+						if ((_shutdown)&&(_jobs.empty()))
+							break;
+						fn = std::move(_jobs.front());
+						_jobs.pop_front();
+					}
+					fn();
+				}
+			});
+		}
+	}
+
+	virtual void enqueue(std::function<void()> fn)
+	{
+		{
+			std::unique_lock<std::mutex> l(_lock);
+			if ((!_shutdown)&&(_jobs.size() >= _maxPending)) {
+				l.unlock();
+				fn(); // queue full: serve inline on the accept thread (backpressure)
+				return;
+			}
+			if (_shutdown)
+				return;
+			_jobs.push_back(std::move(fn));
+		}
+		_notEmpty.notify_one();
+	}
+
+	virtual void shutdown()
+	{
+		{
+			std::unique_lock<std::mutex> l(_lock);
+			_shutdown = true;
+		}
+		_notEmpty.notify_all();
+		for(std::vector<std::thread>::iterator t(_workers.begin());t!=_workers.end();++t)
+			t->join();
+	}
+
+private:
+	std::vector<std::thread> _workers;
+	std::deque< std::function<void()> > _jobs;
+	std::mutex _lock;
+	std::condition_variable _notEmpty;
+	const unsigned long _maxPending;
+	bool _shutdown;
+};
+
+// Control plane HTTP server with a priority lane for loopback clients.
+// Remote (non-loopback) connections may occupy at most all but one worker
+// thread; beyond that they are parked in a bounded deferred list and picked
+// up as remote slots free, so a monitoring scrape storm can never occupy
+// every handler thread and starve zerotier-cli, which connects via loopback.
+class ControlPlaneServer : public httplib::Server
+{
+public:
+	ControlPlaneServer() :
+		_maxRemote(7),
+		_maxDeferred(128),
+		_remoteActive(0) {}
+
+	// Must be called before listen_after_bind()
+	inline void setConcurrencyLimits(unsigned int maxRemote,unsigned int maxDeferred)
+	{
+		_maxRemote = (maxRemote > 0) ? maxRemote : 1;
+		_maxDeferred = maxDeferred;
+	}
+
+private:
+	virtual bool process_and_close_socket(socket_t sock)
+	{
+		struct sockaddr_storage sa;
+		socklen_t salen = (socklen_t)sizeof(sa);
+		memset(&sa,0,sizeof(sa));
+		bool loopback = false;
+		if (getpeername(sock,(struct sockaddr *)&sa,&salen) == 0) {
+			loopback = (InetAddress(sa).ipScope() == InetAddress::IP_SCOPE_LOOPBACK);
+		}
+		if (loopback)
+			return httplib::Server::process_and_close_socket(sock);
+
+		{
+			std::lock_guard<std::mutex> l(_remote_l);
+			if (_remoteActive >= _maxRemote) {
+				if (_deferred.size() < _maxDeferred) {
+					// parked; an active remote worker will pick this up before
+					// releasing its slot, so the list can never strand a socket
+					_deferred.push_back(sock);
+					return true;
+				}
+				// over capacity: refuse quickly rather than queue for minutes
+				httplib::detail::shutdown_socket(sock);
+				httplib::detail::close_socket(sock);
+				return false;
+			}
+			++_remoteActive;
+		}
+
+		bool ok = true;
+		for(;;) {
+			ok = httplib::Server::process_and_close_socket(sock);
+			std::lock_guard<std::mutex> l(_remote_l);
+			if (_deferred.empty()) {
+				--_remoteActive;
+				break;
+			}
+			sock = _deferred.front();
+			_deferred.pop_front();
+		}
+		return ok;
+	}
+
+	unsigned int _maxRemote;
+	unsigned long _maxDeferred;
+	unsigned int _remoteActive;
+	std::deque<socket_t> _deferred;
+	std::mutex _remote_l;
+};
+
 class OneServiceImpl : public OneService
 {
 public:
+	// Compile _allowManagementFrom into sorted, merged address ranges
+	inline void _compileMgmtAcl()
+	{
+		std::vector<_MgmtAclRangeV4> v4;
+		std::vector<_MgmtAclRangeV6> v6;
+		for(std::vector<InetAddress>::const_iterator nw(_allowManagementFrom.begin());nw!=_allowManagementFrom.end();++nw) {
+			if (nw->ss_family == AF_INET) {
+				unsigned int bits = nw->netmaskBits();
+				if (bits > 32) bits = 32;
+				const uint32_t base = Utils::ntoh((uint32_t)reinterpret_cast<const struct sockaddr_in *>(&(*nw))->sin_addr.s_addr);
+				const uint32_t hostMask = (bits == 0) ? 0xffffffffU : ((bits == 32) ? 0 : ((1U << (32 - bits)) - 1));
+				_MgmtAclRangeV4 r;
+				r.start = base & ~hostMask;
+				r.end = base | hostMask;
+				v4.push_back(r);
+			} else if (nw->ss_family == AF_INET6) {
+				unsigned int bits = nw->netmaskBits();
+				if (bits > 128) bits = 128;
+				const uint8_t *const a = reinterpret_cast<const uint8_t *>(reinterpret_cast<const struct sockaddr_in6 *>(&(*nw))->sin6_addr.s6_addr);
+				uint64_t baseHi = 0,baseLo = 0;
+				for(int i=0;i<8;++i) baseHi = (baseHi << 8) | (uint64_t)a[i];
+				for(int i=8;i<16;++i) baseLo = (baseLo << 8) | (uint64_t)a[i];
+				const unsigned int hostBits = 128 - bits;
+				const uint64_t hmHi = (hostBits >= 128) ? 0xffffffffffffffffULL : ((hostBits > 64) ? ((1ULL << (hostBits - 64)) - 1) : 0ULL);
+				const uint64_t hmLo = (hostBits >= 64) ? 0xffffffffffffffffULL : ((hostBits == 0) ? 0ULL : ((1ULL << hostBits) - 1));
+				if (((baseHi & hmHi)|(baseLo & hmLo)) != 0) {
+					continue; // host bits set beyond the netmask: containsAddress() could never match this entry either
+				}
+				_MgmtAclRangeV6 r;
+				r.startHi = baseHi;
+				r.startLo = baseLo;
+				r.endHi = baseHi | hmHi;
+				r.endLo = baseLo | hmLo;
+				v6.push_back(r);
+			}
+		}
+
+		std::sort(v4.begin(),v4.end(),[](const _MgmtAclRangeV4 &a,const _MgmtAclRangeV4 &b) { return (a.start < b.start); });
+		std::vector<_MgmtAclRangeV4> m4;
+		for(std::vector<_MgmtAclRangeV4>::const_iterator r(v4.begin());r!=v4.end();++r) {
+			if ((!m4.empty())&&(r->start <= m4.back().end)) {
+				if (r->end > m4.back().end) m4.back().end = r->end;
+			} else {
+				m4.push_back(*r);
+			}
+		}
+
+		std::sort(v6.begin(),v6.end(),[](const _MgmtAclRangeV6 &a,const _MgmtAclRangeV6 &b) { return ((a.startHi < b.startHi)||((a.startHi == b.startHi)&&(a.startLo < b.startLo))); });
+		std::vector<_MgmtAclRangeV6> m6;
+		for(std::vector<_MgmtAclRangeV6>::const_iterator r(v6.begin());r!=v6.end();++r) {
+			if ((!m6.empty())&&((r->startHi < m6.back().endHi)||((r->startHi == m6.back().endHi)&&(r->startLo <= m6.back().endLo)))) {
+				if ((r->endHi > m6.back().endHi)||((r->endHi == m6.back().endHi)&&(r->endLo > m6.back().endLo))) {
+					m6.back().endHi = r->endHi;
+					m6.back().endLo = r->endLo;
+				}
+			} else {
+				m6.push_back(*r);
+			}
+		}
+
+		_mgmtAclV4.swap(m4);
+		_mgmtAclV6.swap(m6);
+		_mgmtAclGen.fetch_add(1,std::memory_order_release);
+	}
+
+	// Binary search the compiled management ACL (loopback is handled by the caller)
+	inline bool _mgmtAclAllows(const InetAddress &remoteAddr) const
+	{
+		if (remoteAddr.ss_family == AF_INET) {
+			const uint32_t key = Utils::ntoh((uint32_t)reinterpret_cast<const struct sockaddr_in *>(&remoteAddr)->sin_addr.s_addr);
+			std::vector<_MgmtAclRangeV4>::const_iterator r(std::upper_bound(_mgmtAclV4.begin(),_mgmtAclV4.end(),key,[](const uint32_t k,const _MgmtAclRangeV4 &a) { return (k < a.start); }));
+			if (r != _mgmtAclV4.begin()) {
+				--r;
+				return (key <= r->end);
+			}
+		} else if (remoteAddr.ss_family == AF_INET6) {
+			const uint8_t *const a = reinterpret_cast<const uint8_t *>(reinterpret_cast<const struct sockaddr_in6 *>(&remoteAddr)->sin6_addr.s6_addr);
+			uint64_t keyHi = 0,keyLo = 0;
+			for(int i=0;i<8;++i) keyHi = (keyHi << 8) | (uint64_t)a[i];
+			for(int i=8;i<16;++i) keyLo = (keyLo << 8) | (uint64_t)a[i];
+			std::vector<_MgmtAclRangeV6>::const_iterator r(std::upper_bound(_mgmtAclV6.begin(),_mgmtAclV6.end(),std::pair<uint64_t,uint64_t>(keyHi,keyLo),[](const std::pair<uint64_t,uint64_t> &k,const _MgmtAclRangeV6 &b) { return ((k.first < b.startHi)||((k.first == b.startHi)&&(k.second < b.startLo))); }));
+			if (r != _mgmtAclV6.begin()) {
+				--r;
+				return ((keyHi < r->endHi)||((keyHi == r->endHi)&&(keyLo <= r->endLo)));
+			}
+		}
+		return false;
+	}
+
 	// begin member variables --------------------------------------------------
 
 	const std::string _homePath;
@@ -772,7 +1049,7 @@ public:
 	SoftwareUpdater *_updater;
 	bool _updateAutoApply;
 
-    httplib::Server _controlPlane;
+    ControlPlaneServer _controlPlane;
     std::thread _serverThread;
 
     bool _allowTcpFallbackRelay;
@@ -794,6 +1071,18 @@ public:
 	std::vector< InetAddress > _globalV6Blacklist;
 	std::vector< InetAddress > _allowManagementFrom;
 	std::vector< std::string > _interfacePrefixBlacklist;
+
+	// _allowManagementFrom compiled into sorted, merged [start,end] address
+	// ranges that are binary searched per control plane request instead of
+	// calling containsAddress() on every entry. Rebuilt whenever local.conf
+	// settings load; the generation counter invalidates per-thread verdict
+	// caches in the request handlers.
+	struct _MgmtAclRangeV4 { uint32_t start,end; };
+	struct _MgmtAclRangeV6 { uint64_t startHi,startLo,endHi,endLo; };
+	std::vector<_MgmtAclRangeV4> _mgmtAclV4;
+	std::vector<_MgmtAclRangeV6> _mgmtAclV6;
+	std::atomic<uint64_t> _mgmtAclGen;
+
 	Mutex _localConfig_m;
 
 	std::vector<InetAddress> explicitBind;
@@ -817,6 +1106,7 @@ public:
 #ifdef ZT_TCP_FALLBACK_RELAY
 	InetAddress _fallbackRelayAddress;
 	uint64_t _lastSendToGlobalV4;
+	uint64_t _lastTcpFallbackDial;
 #endif
 
 	// Last potential sleep/wake event
@@ -840,8 +1130,108 @@ public:
 	std::string _fatalErrorMessage;
 	Mutex _termReason_m;
 
+	// io_uring UDP receive engine if enabled (local.conf "ioUring", Linux only)
+#if defined(__LINUX__) && defined(ZT_USE_IO_URING)
+	bool _ioUringEnabled;
+	LinuxUringEngine<OneServiceImpl> *_uring;
+	std::thread _uringThread;
+#endif
+
+	// AF_XDP kernel-bypass receive engine for dedicated relay/root boxes
+	// (local.conf "afXdp" object, Linux only, requires an operator-attached
+	// redirect program with a pinned XSKMAP)
+#if defined(__LINUX__) && defined(ZT_USE_AF_XDP)
+	LinuxXdpEngine<OneServiceImpl> *_xdp;
+	std::thread _xdpThread;
+	std::string _xdpInterface;
+	unsigned int _xdpQueue;
+	std::string _xdpXskMapPath;
+#endif
+
+	// Incoming packet worker threads (local.conf "rxWorkerThreads", 0 = single-threaded)
+	unsigned int _rxWorkerThreads;
+
+	// Memory budget in bytes for the RX reassembly/decode queue (local.conf
+	// "rxQueueMemoryBudget", 0 = compile-time default size)
+	uint64_t _rxQueueMemoryBudget;
+
+	// Datapath CPU placement policy (local.conf "numaNode", "rxWorkerCpus",
+	// "udpShardCpus"). The NUMA node pins the whole process to one socket's
+	// CPUs; the CPU lists pin individual datapath threads round-robin. On
+	// multi-socket hosts, leave numaNode unset and spread rxWorkerCpus
+	// across sockets instead: each pinned worker pre-faults its packet pool
+	// on its own node, so both sockets run on local memory.
+	// Like the thread counts these are applied at startup only.
+	int _numaNode;
+	std::vector<unsigned int> _rxWorkerCpus;
+	std::vector<unsigned int> _udpShardCpus;
+
+	// Tap device I/O parallelism (local.conf "tapQueues", Linux only,
+	// 0/1 = single queue): number of IFF_MULTI_QUEUE tap queues, each with
+	// its own reader thread so one busy member network can use several
+	// cores. "tapReaderCpus" pins those readers round-robin.
+	unsigned int _tapQueues;
+	std::vector<unsigned int> _tapReaderCpus;
+
+	// SO_REUSEPORT receive sharding (local.conf "udpShards", Linux only, 0/1 = off).
+	// Each bound UDP port gets this many sockets, the extras serviced by worker
+	// Phy instances on their own threads so the kernel spreads inbound flows.
+	unsigned int _udpShards;
+
+	// Control plane worker pool sizing (local.conf "controlPlaneThreads",
+	// 0 = auto) and pending connection bound ("controlPlaneMaxQueuedConnections",
+	// 0 = default); applied when the control plane starts
+	unsigned int _controlPlaneThreads;
+	unsigned int _controlPlaneMaxQueuedConnections;
+	std::vector<Phy<OneServiceImpl *> *> _udpShardPhys;
+	std::vector<std::thread> _udpShardThreads;
+
+	// Per-socket UDP egress overflow queues: packets whose send failed only
+	// because the kernel buffer was full wait here (up to a byte cap) and are
+	// flushed from phyOnDatagramWritable() when the socket drains.
+	// _udpEgressQueuedSockets lets the send hot path skip the lock entirely
+	// while nothing is queued anywhere.
+	struct _UdpEgressPacket
+	{
+		InetAddress dest;
+		unsigned int ttl;
+		unsigned int dscp;
+		std::string data;
+	};
+	struct _UdpEgressQueue
+	{
+		_UdpEgressQueue() : bytes(0) {}
+		std::list<_UdpEgressPacket> q;
+		unsigned long bytes;
+	};
+	std::map<PhySocket *,_UdpEgressQueue> _udpEgressQueues;
+	std::atomic<unsigned long> _udpEgressQueuedSockets;
+	Mutex _udpEgressQueues_m;
+
+	// Write-behind state object writer: puts coalesce per target path and a
+	// background thread flushes them periodically as atomic rename-into-place
+	// writes, with the fsyncs batched into the flush pass
+	struct _PendingStateWrite
+	{
+		_PendingStateWrite() : remove(false),secure(false) {}
+		std::string dirname;
+		std::vector<uint8_t> data;
+		bool remove;
+		bool secure;
+	};
+	std::map<std::string,_PendingStateWrite> _statePending;
+	std::mutex _statePending_m;
+	std::condition_variable _statePending_c;
+	std::thread _stateWriterThread;
+	volatile bool _stateWriterRun;
+
 	// uPnP/NAT-PMP port mapper if enabled
 	bool _portMappingEnabled; // local.conf settings
+
+	// Raised when POST /config/settings changes runtime-settable keys; the
+	// run thread applies them (port rebinds, port mapper toggle) so those
+	// changes never race the binder
+	volatile bool _runtimeSettingsChanged;
 #ifdef ZT_USE_MINIUPNPC
 	PortMapper *_portMapper;
 #endif
@@ -878,16 +1268,36 @@ public:
 		,_forceTcpRelay(false)
 		,_primaryPort(port)
 		,_udpPortPickerCounter(0)
+		,_mgmtAclGen(0)
 		,_lastDirectReceiveFromGlobal(0)
 #ifdef ZT_TCP_FALLBACK_RELAY
 		, _fallbackRelayAddress(ZT_TCP_FALLBACK_RELAY)
 		,_lastSendToGlobalV4(0)
+		,_lastTcpFallbackDial(0)
 #endif
 		,_lastRestart(0)
 		,_nextBackgroundTaskDeadline(0)
 		,_tcpFallbackTunnel((TcpConnection *)0)
 		,_termReason(ONE_STILL_RUNNING)
+#if defined(__LINUX__) && defined(ZT_USE_IO_URING)
+		,_ioUringEnabled(false)
+		,_uring((LinuxUringEngine<OneServiceImpl> *)0)
+#endif
+#if defined(__LINUX__) && defined(ZT_USE_AF_XDP)
+		,_xdp((LinuxXdpEngine<OneServiceImpl> *)0)
+		,_xdpQueue(0)
+#endif
+		,_rxWorkerThreads(0)
+		,_rxQueueMemoryBudget(0)
+		,_numaNode(-1)
+		,_tapQueues(0)
+		,_udpShards(0)
+		,_controlPlaneThreads(0)
+		,_controlPlaneMaxQueuedConnections(0)
+		,_udpEgressQueuedSockets(0)
+		,_stateWriterRun(true)
 		,_portMappingEnabled(true)
+		,_runtimeSettingsChanged(false)
 #ifdef ZT_USE_MINIUPNPC
 		,_portMapper((PortMapper *)0)
 #endif
@@ -912,11 +1322,22 @@ public:
 #if ZT_VAULT_SUPPORT
 		curl_global_init(CURL_GLOBAL_DEFAULT);
 #endif
+
+		_stateWriterThread = std::thread([this]() { this->_stateWriterMain(); });
 	}
 
 	virtual ~OneServiceImpl()
 	{
-#ifdef __WINDOWS__ 
+		// Stop the state writer first; it drains any still-pending writes on exit
+		{
+			std::lock_guard<std::mutex> l(_statePending_m);
+			_stateWriterRun = false;
+			_statePending_c.notify_all();
+		}
+		if (_stateWriterThread.joinable())
+			_stateWriterThread.join();
+
+#ifdef __WINDOWS__
 		WinFWHelper::removeICMPRules();
 #endif
 		_binder.closeAll(_phy);
@@ -939,7 +1360,12 @@ public:
 	virtual ReasonForTermination run()
 	{
 		try {
-			{
+			// The auth token and legacy-state cleanup only touch the
+			// filesystem, so they run alongside Node construction below,
+			// which can spend seconds loading (or, on first run, generating)
+			// and validating the identity. std::async's future joins even if
+			// the Node constructor throws; the result is checked right after.
+			std::future<std::string> earlyInit(std::async(std::launch::async,[this]() -> std::string {
 				const std::string authTokenPath(_homePath + ZT_PATH_SEPARATOR_S "authtoken.secret");
 				if (!OSUtils::readFile(authTokenPath.c_str(),_authToken)) {
 					unsigned char foo[24];
@@ -947,17 +1373,17 @@ public:
 					_authToken = "";
 					for(unsigned int i=0;i<sizeof(foo);++i)
 						_authToken.push_back("abcdefghijklmnopqrstuvwxyz0123456789"[(unsigned long)foo[i] % 36]);
-					if (!OSUtils::writeFile(authTokenPath.c_str(),_authToken)) {
-						Mutex::Lock _l(_termReason_m);
-						_termReason = ONE_UNRECOVERABLE_ERROR;
-						_fatalErrorMessage = "authtoken.secret could not be written";
-						return _termReason;
-					} else {
-						OSUtils::lockDownFile(authTokenPath.c_str(),false);
-					}
+					if (!OSUtils::writeFile(authTokenPath.c_str(),_authToken))
+						return std::string("authtoken.secret could not be written");
+					OSUtils::lockDownFile(authTokenPath.c_str(),false);
 				}
 				_authToken = _trimString(_authToken);
-			}
+
+				// Delete legacy iddb.d if present (cleanup)
+				OSUtils::rmDashRf((_homePath + ZT_PATH_SEPARATOR_S "iddb.d").c_str());
+
+				return std::string();
+			}));
 
 			{
 				struct ZT_Node_Callbacks cb;
@@ -973,11 +1399,64 @@ public:
 				_node = new Node(this,(void *)0,&cb,OSUtils::now());
 			}
 
+			{
+				const std::string earlyInitError(earlyInit.get());
+				if (earlyInitError.length() > 0) {
+					Mutex::Lock _l(_termReason_m);
+					_termReason = ONE_UNRECOVERABLE_ERROR;
+					_fatalErrorMessage = earlyInitError;
+					return _termReason;
+				}
+			}
+
 
 			// local.conf
 			readLocalSettings();
 			applyLocalConfig();
 
+			// The NUMA mask goes on the main thread before anything below
+			// spawns so every child thread inherits it and first-touch
+			// allocations stay on the chosen socket.
+			if (_numaNode >= 0) {
+				if (!Thread::setCurrentThreadToNumaNode((unsigned int)_numaNode))
+					fprintf(stderr,"WARNING: local.conf numaNode %d could not be applied" ZT_EOL_S,_numaNode);
+			}
+
+			// Worker threads and the RX queue size can only be configured
+			// before packet I/O begins, so these settings are not reapplied
+			// on local.conf changes.
+			if (_rxQueueMemoryBudget > 0) {
+				_node->setRxQueueMemoryBudget(_rxQueueMemoryBudget);
+			}
+			if (_rxWorkerThreads > 0) {
+				_node->setRxWorkerThreads(_rxWorkerThreads,(_rxWorkerCpus.empty()) ? (const unsigned int *)0 : &(_rxWorkerCpus[0]),(unsigned int)_rxWorkerCpus.size());
+			}
+
+#ifdef __LINUX__
+			// SO_REUSEPORT receive sharding: start one worker Phy per extra
+			// shard before the first bind refresh. The main Phy services shard
+			// zero along with all TCP and tap I/O. Like rxWorkerThreads this is
+			// applied at startup only.
+			if (_udpShards > 1) {
+				const unsigned int extra = std::min(_udpShards - 1,(unsigned int)ZT_BINDER_MAX_UDP_SHARDS);
+				for(unsigned int t=0;t<extra;++t)
+					_udpShardPhys.push_back(new Phy<OneServiceImpl *>(this,false,true));
+				unsigned int shardNo = 0;
+				for(std::vector<Phy<OneServiceImpl *> *>::iterator p(_udpShardPhys.begin());p!=_udpShardPhys.end();++p) {
+					Phy<OneServiceImpl *> *const sp = *p;
+					const unsigned int sn = shardNo++;
+					_udpShardThreads.push_back(std::thread([this,sp,sn]() {
+						// Pin each shard to its own core when udpShardCpus is
+						// set so inbound flows don't migrate across sockets.
+						if (!_udpShardCpus.empty())
+							Thread::setCurrentThreadAffinity(std::vector<unsigned int>(1,_udpShardCpus[sn % _udpShardCpus.size()]));
+						while (_run)
+							sp->poll(100);
+					}));
+				}
+			}
+#endif
+
 			// Save original port number to show it if bind error
 			const int _configuredPort = _primaryPort;
 
@@ -1044,9 +1523,6 @@ public:
 			}
 #endif
 
-			// Delete legacy iddb.d if present (cleanup)
-			OSUtils::rmDashRf((_homePath + ZT_PATH_SEPARATOR_S "iddb.d").c_str());
-
 			// Network controller is now enabled by default for desktop and server
 			_controller = new EmbeddedNetworkController(_node,_homePath.c_str(),_controllerDbPath.c_str(),_ports[0], _rc);
 			if (!_ssoRedirectURL.empty()) {
@@ -1056,25 +1532,49 @@ public:
 
 			startHTTPControlPlane();
 
+			// Warm-start connectivity from the peer cache in peers.d so we
+			// attempt last known direct paths immediately instead of waiting
+			// for traffic to each peer. Stale entries are harmless; contact
+			// attempts to dead addresses just go unanswered and the cache is
+			// cleaned of old files periodically below. This runs alongside
+			// the network joins below, which serialize on tap device creation
+			// and dominate container cold starts; Node is safe to call from
+			// both threads here.
+			std::future<void> peerPrefetch(std::async(std::launch::async,[this]() {
+				OSUtils::eachFileInDirectory((_homePath + ZT_PATH_SEPARATOR_S "peers.d").c_str(),[this](const char *name,bool isDirectory) {
+					if (!isDirectory) {
+						const std::string f(name);
+						const std::size_t dot = f.find_last_of('.');
+						if ((dot == 10)&&(f.substr(10) == ".peer"))
+							_node->prefetchPeer((void *)0,Address(Utils::hexStrToU64(f.substr(0,dot).c_str())));
+					}
+					return true;
+				});
+			}));
+
 			// Join existing networks in networks.d
-			{
-				std::vector<std::string> networksDotD(OSUtils::listDirectory((_homePath + ZT_PATH_SEPARATOR_S "networks.d").c_str()));
-				for(std::vector<std::string>::iterator f(networksDotD.begin());f!=networksDotD.end();++f) {
-					std::size_t dot = f->find_last_of('.');
-					if ((dot == 16)&&(f->substr(16) == ".conf"))
-						_node->join(Utils::hexStrToU64(f->substr(0,dot).c_str()),(void *)0,(void *)0);
+			OSUtils::eachFileInDirectory((_homePath + ZT_PATH_SEPARATOR_S "networks.d").c_str(),[this](const char *name,bool isDirectory) {
+				if (!isDirectory) {
+					const std::string f(name);
+					const std::size_t dot = f.find_last_of('.');
+					if ((dot == 16)&&(f.substr(16) == ".conf"))
+						_node->join(Utils::hexStrToU64(f.substr(0,dot).c_str()),(void *)0,(void *)0);
 				}
-			}
+				return true;
+			});
+
+			peerPrefetch.get();
 
 			// Orbit existing moons in moons.d
-			{
-				std::vector<std::string> moonsDotD(OSUtils::listDirectory((_homePath + ZT_PATH_SEPARATOR_S "moons.d").c_str()));
-				for(std::vector<std::string>::iterator f(moonsDotD.begin());f!=moonsDotD.end();++f) {
-					std::size_t dot = f->find_last_of('.');
-					if ((dot == 16)&&(f->substr(16) == ".moon"))
-						_node->orbit((void *)0,Utils::hexStrToU64(f->substr(0,dot).c_str()),0);
+			OSUtils::eachFileInDirectory((_homePath + ZT_PATH_SEPARATOR_S "moons.d").c_str(),[this](const char *name,bool isDirectory) {
+				if (!isDirectory) {
+					const std::string f(name);
+					const std::size_t dot = f.find_last_of('.');
+					if ((dot == 16)&&(f.substr(16) == ".moon"))
+						_node->orbit((void *)0,Utils::hexStrToU64(f.substr(0,dot).c_str()),0);
 				}
-			}
+				return true;
+			});
 
 			// Main I/O loop
 			_nextBackgroundTaskDeadline = 0;
@@ -1100,6 +1600,7 @@ public:
 				}
 
 				const int64_t now = OSUtils::now();
+				const std::chrono::steady_clock::time_point loopStart(std::chrono::steady_clock::now());
 
 				// Attempt to detect sleep/wake events by detecting delay overruns
 				bool restarted = false;
@@ -1115,6 +1616,16 @@ public:
 						_updater->apply();
 				}
 
+				// Apply settings changed at runtime via POST /config/settings.
+				// The handler only updates _localConfig and raises the flag; the
+				// new values take effect here so nothing races the binder.
+				if (_runtimeSettingsChanged) {
+					_runtimeSettingsChanged = false;
+					applyLocalConfig();
+					if (_applyRuntimeSettings())
+						lastBindRefresh = 0;
+				}
+
 				// Reload local.conf if anything changed recently
 				if ((now - lastLocalConfFileCheck) >= ZT_LOCAL_CONF_FILE_CHECK_INTERVAL) {
 					lastLocalConfFileCheck = now;
@@ -1124,6 +1635,8 @@ public:
 						if ((now - mod_time) <= ZT_LOCAL_CONF_FILE_CHECK_INTERVAL) {
 							readLocalSettings();
 							applyLocalConfig();
+							if (_applyRuntimeSettings())
+								lastBindRefresh = 0;
 						}
 					}
 				}
@@ -1149,7 +1662,76 @@ public:
 					}
 					if (!_forceTcpRelay) {
 						// Only bother binding UDP ports if we aren't forcing TCP-relay mode
-						_binder.refresh(_phy,p,pc,explicitBind,*this);
+						std::vector<InetAddress> boundBeforeRefresh(_binder.allBoundLocalInterfaceAddresses());
+						_binder.refresh(_phy,p,pc,explicitBind,*this,_udpShardPhys);
+						// Drop any egress backlog held for sockets the refresh just closed
+						if (_udpEgressQueuedSockets.load(std::memory_order_relaxed) != 0) {
+							Mutex::Lock _l(_udpEgressQueues_m);
+							for(std::map<PhySocket *,_UdpEgressQueue>::iterator eq(_udpEgressQueues.begin());eq!=_udpEgressQueues.end();) {
+								if (_binder.isUdpSocketValid(eq->first)) {
+									++eq;
+								} else {
+									Metrics::udp_egress_queue_drop += (uint64_t)eq->second.q.size();
+									_udpEgressQueues.erase(eq++);
+									--_udpEgressQueuedSockets;
+								}
+							}
+						}
+#ifdef ZT_USE_MINIUPNPC
+						// If the set of local addresses changed (router reboot, network
+						// move, etc.) re-establish port mappings right away instead of
+						// waiting out the mapper's own refresh delay.
+						if ((_portMapper)&&(_binder.allBoundLocalInterfaceAddresses() != boundBeforeRefresh)) {
+							_portMapper->refresh();
+						}
+#endif
+#if defined(__LINUX__) && defined(ZT_USE_IO_URING)
+						if (_ioUringEnabled) {
+							if (!_uring) {
+								_uring = new LinuxUringEngine<OneServiceImpl>(this);
+								if (_uring->ok()) {
+									_uringThread = std::thread([this]() {
+										while (_run)
+											_uring->poll(100);
+									});
+								} else {
+									fprintf(stderr,"WARNING: io_uring datapath requested but ring setup failed, falling back to poll" ZT_EOL_S);
+									delete _uring;
+									_uring = (LinuxUringEngine<OneServiceImpl> *)0;
+									_ioUringEnabled = false;
+								}
+							}
+							if (_uring) {
+								// Receive for the wire sockets moves to the ring; Phy<> keeps everything else
+								std::vector<PhySocket *> us(_binder.allBoundUdpSockets());
+								for(std::vector<PhySocket *>::const_iterator s(us.begin());s!=us.end();++s)
+									_phy.setNotifyReadable(*s,false);
+								_uring->setSockets(us);
+							}
+						}
+#endif
+#if defined(__LINUX__) && defined(ZT_USE_AF_XDP)
+						if ((!_xdp)&&(_xdpInterface.length() > 0)&&(_xdpXskMapPath.length() > 0)) {
+							_xdp = new LinuxXdpEngine<OneServiceImpl>(this,_xdpInterface.c_str(),_xdpQueue,_ports[0],_xdpXskMapPath.c_str());
+							if (_xdp->ok()) {
+								_xdpThread = std::thread([this]() {
+									while (_run)
+										_xdp->poll(100);
+								});
+							} else {
+								fprintf(stderr,"WARNING: AF_XDP datapath requested but socket setup failed, staying on UDP sockets" ZT_EOL_S);
+								delete _xdp;
+								_xdp = (LinuxXdpEngine<OneServiceImpl> *)0;
+							}
+						}
+						if (_xdp) {
+							// Replies to XDP-received packets ride the normal UDP sockets;
+							// re-pick after every refresh since the socket set may change
+							std::vector<PhySocket *> us(_binder.allBoundUdpSockets());
+							if (!us.empty())
+								_xdp->setReplySocket(us.front());
+						}
+#endif
 					}
 					{
 						Mutex::Lock _l(_nets_m);
@@ -1163,7 +1745,20 @@ public:
 				// Run background task processor in core if it's time to do so
 				int64_t dl = _nextBackgroundTaskDeadline;
 				if (dl <= now) {
+					// Lateness of the tick is a direct signal of event loop
+					// health: anything stalling the loop shows up here before
+					// users notice datapath degradation
+					if (dl > 0)
+						Metrics::tick_overrun_us.Observe((uint64_t)(now - dl) * 1000ULL);
+					const std::chrono::steady_clock::time_point tickStart(std::chrono::steady_clock::now());
+#ifdef ZT_TCP_FALLBACK_RELAY
+					s_tcpFallbackCork.open = true; // periodic pings fan out to many peers; batch them over the tunnel
+#endif
 					_node->processBackgroundTasks((void *)0,now,&_nextBackgroundTaskDeadline);
+#ifdef ZT_TCP_FALLBACK_RELAY
+					_tcpFallbackUncork();
+#endif
+					Metrics::tick_us.Observe((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tickStart).count());
 					dl = _nextBackgroundTaskDeadline;
 				}
 
@@ -1214,14 +1809,18 @@ public:
 					}
 				}
 
-				// Clean peers.d periodically
+				// Clean peers.d and membership.d periodically
 				if ((now - lastCleanedPeersDb) >= 3600000) {
 					lastCleanedPeersDb = now;
 					OSUtils::cleanDirectory((_homePath + ZT_PATH_SEPARATOR_S "peers.d").c_str(),now - 2592000000LL); // delete older than 30 days
+					OSUtils::cleanDirectory((_homePath + ZT_PATH_SEPARATOR_S "membership.d").c_str(),now - 2592000000LL);
 				}
 
 				const unsigned long delay = (dl > now) ? (unsigned long)(dl - now) : 500;
 				clockShouldBe = now + (int64_t)delay;
+				// Time spent working this iteration (poll wait excluded); a
+				// slow callback anywhere in the loop widens this
+				Metrics::loop_iteration_us.Observe((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - loopStart).count());
 				_phy.poll(delay);
 			}
 		} catch (std::exception &e) {
@@ -1234,6 +1833,47 @@ public:
 			_fatalErrorMessage = "unexpected exception in main thread: unknown exception";
 		}
 
+#if defined(__LINUX__) && defined(ZT_USE_IO_URING)
+		if (_uring) {
+			_run_m.lock();
+			_run = false;
+			_run_m.unlock();
+			if (_uringThread.joinable())
+				_uringThread.join();
+			delete _uring;
+			_uring = (LinuxUringEngine<OneServiceImpl> *)0;
+		}
+#endif
+
+#if defined(__LINUX__) && defined(ZT_USE_AF_XDP)
+		if (_xdp) {
+			_run_m.lock();
+			_run = false;
+			_run_m.unlock();
+			if (_xdpThread.joinable())
+				_xdpThread.join();
+			delete _xdp;
+			_xdp = (LinuxXdpEngine<OneServiceImpl> *)0;
+		}
+#endif
+
+		if (!_udpShardPhys.empty()) {
+			_run_m.lock();
+			_run = false;
+			_run_m.unlock();
+			for(std::vector<Phy<OneServiceImpl *> *>::iterator p(_udpShardPhys.begin());p!=_udpShardPhys.end();++p)
+				(*p)->whack();
+			for(std::vector<std::thread>::iterator t(_udpShardThreads.begin());t!=_udpShardThreads.end();++t) {
+				if (t->joinable())
+					t->join();
+			}
+			_binder.closeAll(_phy,_udpShardPhys);
+			for(std::vector<Phy<OneServiceImpl *> *>::iterator p(_udpShardPhys.begin());p!=_udpShardPhys.end();++p)
+				delete *p;
+			_udpShardPhys.clear();
+			_udpShardThreads.clear();
+		}
+
 		try {
 			Mutex::Lock _l(_tcpConnections_m);
 			while (!_tcpConnections.empty())
@@ -1466,6 +2106,46 @@ public:
 		};
 
 
+		// Optional ?page=N&limit=M pagination for list endpoints: computes the
+		// half-open index range [begin,end) of the requested page, or the whole
+		// list if no usable limit is given.
+		auto parsePageLimits = [](const httplib::Request &req, unsigned long long count, unsigned long long &begin, unsigned long long &end) {
+			begin = 0;
+			end = count;
+			if (req.has_param("limit")) {
+				const unsigned long long limit = strtoull(req.get_param_value("limit").c_str(),(char **)0,10);
+				if (limit > 0) {
+					const unsigned long long page = req.has_param("page") ? strtoull(req.get_param_value("page").c_str(),(char **)0,10) : 0ULL;
+					begin = (page > (count / limit)) ? count : (page * limit);
+					end = std::min(begin + limit,count);
+				}
+			}
+		};
+
+		// Optional ?select=field,field filtering: strips a serialized object down
+		// to the requested top-level fields so monitoring scrapes only pay for
+		// what they read.
+		auto selectedFields = [](const httplib::Request &req) {
+			std::vector<std::string> sel;
+			if (req.has_param("select")) {
+				sel = OSUtils::split(req.get_param_value("select").c_str(),",","","");
+			}
+			return sel;
+		};
+		auto filterFields = [](nlohmann::json &j, const std::vector<std::string> &sel) {
+			if (sel.empty()) {
+				return;
+			}
+			nlohmann::json f(nlohmann::json::object());
+			for(std::vector<std::string>::const_iterator k(sel.begin());k!=sel.end();++k) {
+				nlohmann::json::iterator v(j.find(*k));
+				if (v != j.end()) {
+					f[*k] = *v;
+				}
+			}
+			j = f;
+		};
+
         auto authCheck = [=] (const httplib::Request &req, httplib::Response &res) {
             std::string r = req.remote_addr;
             InetAddress remoteAddr(r.c_str());
@@ -1478,11 +2158,20 @@ public:
             }
 
             if (!ipAllowed) {
-                for (auto i = _allowManagementFrom.begin(); i != _allowManagementFrom.end(); ++i) {
-                    if (i->containsAddress(remoteAddr)) {
-                        ipAllowed  = true;
-                        break;
-                    }
+                // Per-thread verdict cache: keep-alive connections are served
+                // by the same worker thread, so repeated requests from one
+                // monitoring source skip even the range search. The generation
+                // counter invalidates it when local.conf settings reload.
+                struct MgmtAclCacheEntry { uint64_t gen; InetAddress addr; bool allowed; };
+                static thread_local MgmtAclCacheEntry aclCache = { 0, InetAddress(), false };
+                const uint64_t gen = _mgmtAclGen.load(std::memory_order_acquire);
+                if ((aclCache.gen == gen)&&(aclCache.addr.ipsEqual(remoteAddr))) {
+                    ipAllowed = aclCache.allowed;
+                } else {
+                    ipAllowed = _mgmtAclAllows(remoteAddr);
+                    aclCache.gen = gen;
+                    aclCache.addr = remoteAddr;
+                    aclCache.allowed = ipAllowed;
                 }
             }
 
@@ -1597,6 +2286,7 @@ public:
 				std::string lcStr = OSUtils::jsonDump(lc, 4);
 				if (OSUtils::writeFile((_homePath + ZT_PATH_SEPARATOR_S "local.conf").c_str(), lcStr)) {
 					_localConfig = lc;
+					_runtimeSettingsChanged = true;
 				}
 			}
 			setContent(req, res, "{}");
@@ -1699,17 +2389,33 @@ public:
 			setContent(req, res, out.dump());
 		});
 
-		_controlPlane.Get("/network", [&, setContent](const httplib::Request &req, httplib::Response &res) {
-            Mutex::Lock _l(_nets_m);
-            auto out = json::array();
+		_controlPlane.Get("/network", [&, setContent, parsePageLimits, selectedFields, filterFields](const httplib::Request &req, httplib::Response &res) {
+			const std::vector<std::string> select(selectedFields(req));
 
-            for (auto it = _nets.begin(); it != _nets.end(); ++it) {
-                NetworkState &ns = it->second;
-                json nj;
-                _networkToJson(nj, ns);
-                out.push_back(nj);
-            }
-			setContent(req, res, out.dump());
+			// Serialize each network as it is visited instead of building one
+			// big DOM for the whole list
+			std::string out;
+			out.push_back('[');
+			{
+				Mutex::Lock _l(_nets_m);
+				unsigned long long begin,end,i = 0;
+				parsePageLimits(req,(unsigned long long)_nets.size(),begin,end);
+				for (auto it = _nets.begin(); it != _nets.end(); ++it, ++i) {
+					if ((i < begin)||(i >= end)) {
+						continue;
+					}
+					NetworkState &ns = it->second;
+					json nj;
+					_networkToJson(nj, ns);
+					filterFields(nj,select);
+					if (out.length() > 1) {
+						out.push_back(',');
+					}
+					out.append(nj.dump());
+				}
+			}
+			out.push_back(']');
+			setContent(req, res, out);
         });
 
         _controlPlane.Get("/network/([0-9a-fA-F]{16})", [&, setContent](const httplib::Request &req, httplib::Response &res) {
@@ -1785,22 +2491,74 @@ public:
 			setContent(req, res, out.dump());
 		});
 
-		_controlPlane.Get("/peer", [&, setContent](const httplib::Request &req, httplib::Response &res) {
-			ZT_PeerList *pl = _node->peers();
-			auto out = nlohmann::json::array();
+		_controlPlane.Get("/peer", [&, parsePageLimits, selectedFields, filterFields](const httplib::Request &req, httplib::Response &res) {
+			ZT_PeerList *const pl = _node->peers();
 
-			for(unsigned long i=0;i<pl->peerCount;++i) {
-				nlohmann::json pj;
-				SharedPtr<Bond> bond = SharedPtr<Bond>();
-				if (pl->peers[i].isBonded) {
-					const uint64_t id = pl->peers[i].address;
-					bond = _node->bondController()->getBondByPeerId(id);
-				}
-				_peerToJson(pj,&(pl->peers[i]),bond,(_tcpFallbackTunnel != (TcpConnection *)0));
-				out.push_back(pj);
+			// This list can be tens of thousands of entries on a busy node, so
+			// it is serialized a few peers at a time straight into the chunked
+			// response instead of being built as one huge DOM in memory. The
+			// peer list snapshot is freed by the resource releaser when the
+			// response completes (or the client goes away).
+			struct PeerStreamState
+			{
+				ZT_PeerList *pl;
+				unsigned long long idx,end;
+				std::vector<std::string> select;
+				std::string jsonp;
+				bool tunneled;
+				bool first = true;
+			};
+			auto state = std::make_shared<PeerStreamState>();
+			state->pl = pl;
+			parsePageLimits(req,(unsigned long long)pl->peerCount,state->idx,state->end);
+			state->select = selectedFields(req);
+			if (req.has_param("jsonp")) {
+				state->jsonp = req.get_param_value("jsonp");
 			}
-			_node->freeQueryResult((void*)pl);
-			setContent(req, res, out.dump());
+			state->tunneled = (_tcpFallbackTunnel != (TcpConnection *)0);
+
+			res.set_chunked_content_provider(
+				(state->jsonp.length() > 0) ? "application/javascript" : "application/json",
+				[this, state, filterFields](size_t offset, httplib::DataSink &sink) {
+					std::string out;
+					if (offset == 0) {
+						if (state->jsonp.length() > 0) {
+							out.append(state->jsonp);
+							out.push_back('(');
+						}
+						out.push_back('[');
+					}
+					for(unsigned int n=0;(state->idx < state->end)&&(n < 16);++n,++(state->idx)) {
+						const ZT_Peer *const peer = &(state->pl->peers[state->idx]);
+						nlohmann::json pj;
+						SharedPtr<Bond> bond = SharedPtr<Bond>();
+						if (peer->isBonded) {
+							bond = _node->bondController()->getBondByPeerId(peer->address);
+						}
+						_peerToJson(pj,peer,bond,state->tunneled);
+						filterFields(pj,state->select);
+						if (state->first) {
+							state->first = false;
+						} else {
+							out.push_back(',');
+						}
+						out.append(pj.dump());
+					}
+					if (state->idx >= state->end) {
+						out.push_back(']');
+						if (state->jsonp.length() > 0) {
+							out.append(");");
+						}
+						sink.write(out.data(),out.length());
+						sink.done();
+					} else {
+						sink.write(out.data(),out.length());
+					}
+					return true;
+				},
+				[this, state](bool) {
+					_node->freeQueryResult((void *)(state->pl));
+				});
 		});
 
 		_controlPlane.Get("/peer/([0-9a-fA-F]{10})", [&, setContent](const httplib::Request &req, httplib::Response &res) {
@@ -1999,6 +2757,20 @@ public:
 			exit(-1);
 		}
 
+		// Worker pool sizing and queue bounds, overridable via local.conf.
+		// One worker is always reserved for loopback (zerotier-cli)
+		// connections so scrape load cannot starve operator commands.
+		unsigned int cpThreads = _controlPlaneThreads;
+		if (cpThreads == 0) {
+			const unsigned int hw = std::thread::hardware_concurrency();
+			cpThreads = std::max(8u,(hw > 0) ? (hw - 1) : 8u);
+		}
+		if (cpThreads > 256)
+			cpThreads = 256;
+		const unsigned int cpMaxQueued = (_controlPlaneMaxQueuedConnections > 0) ? _controlPlaneMaxQueuedConnections : 128;
+		_controlPlane.setConcurrencyLimits((cpThreads > 1) ? (cpThreads - 1) : 1,cpMaxQueued);
+		_controlPlane.new_task_queue = [cpThreads,cpMaxQueued]() { return new ControlPlaneTaskQueue(cpThreads,cpMaxQueued); };
+
 		if(!_controlPlane.bind_to_port("0.0.0.0", _primaryPort)) {
 			fprintf(stderr, "Error binding control plane to port %d\n", _primaryPort);
 			exit(-1);
@@ -2215,6 +2987,48 @@ public:
 		}
 		_portMappingEnabled = OSUtils::jsonBool(settings["portMappingEnabled"],true);
 		_node->setLowBandwidthMode(OSUtils::jsonBool(settings["lowBandwidthMode"],false));
+		_rxWorkerThreads = (unsigned int)OSUtils::jsonInt(settings["rxWorkerThreads"],0);
+		_rxQueueMemoryBudget = (uint64_t)OSUtils::jsonInt(settings["rxQueueMemoryBudget"],0);
+		_udpShards = (unsigned int)OSUtils::jsonInt(settings["udpShards"],0);
+		_numaNode = (int)OSUtils::jsonInt(settings["numaNode"],-1);
+		_rxWorkerCpus.clear();
+		if (settings["rxWorkerCpus"].is_array()) {
+			for(unsigned long i=0;i<settings["rxWorkerCpus"].size();++i) {
+				const int64_t c = OSUtils::jsonInt(settings["rxWorkerCpus"][i],-1);
+				if (c >= 0)
+					_rxWorkerCpus.push_back((unsigned int)c);
+			}
+		}
+		_udpShardCpus.clear();
+		if (settings["udpShardCpus"].is_array()) {
+			for(unsigned long i=0;i<settings["udpShardCpus"].size();++i) {
+				const int64_t c = OSUtils::jsonInt(settings["udpShardCpus"][i],-1);
+				if (c >= 0)
+					_udpShardCpus.push_back((unsigned int)c);
+			}
+		}
+		_tapQueues = (unsigned int)OSUtils::jsonInt(settings["tapQueues"],0);
+		_tapReaderCpus.clear();
+		if (settings["tapReaderCpus"].is_array()) {
+			for(unsigned long i=0;i<settings["tapReaderCpus"].size();++i) {
+				const int64_t c = OSUtils::jsonInt(settings["tapReaderCpus"][i],-1);
+				if (c >= 0)
+					_tapReaderCpus.push_back((unsigned int)c);
+			}
+		}
+		_controlPlaneThreads = (unsigned int)OSUtils::jsonInt(settings["controlPlaneThreads"],0);
+		_controlPlaneMaxQueuedConnections = (unsigned int)OSUtils::jsonInt(settings["controlPlaneMaxQueuedConnections"],0);
+#if defined(__LINUX__) && defined(ZT_USE_IO_URING)
+		_ioUringEnabled = OSUtils::jsonBool(settings["ioUring"],false);
+#endif
+#if defined(__LINUX__) && defined(ZT_USE_AF_XDP)
+		json &axj = settings["afXdp"];
+		if (axj.is_object()) {
+			_xdpInterface = OSUtils::jsonString(axj["interface"],"");
+			_xdpQueue = (unsigned int)OSUtils::jsonInt(axj["queue"],0);
+			_xdpXskMapPath = OSUtils::jsonString(axj["xskMap"],"");
+		}
+#endif
 
 #ifndef ZT_SDK
 		const std::string up(OSUtils::jsonString(settings["softwareUpdate"],ZT_SOFTWARE_UPDATE_DEFAULT));
@@ -2249,6 +3063,66 @@ public:
 					_allowManagementFrom.push_back(nw);
 			}
 		}
+		_compileMgmtAcl();
+	}
+
+	/**
+	 * Apply runtime-settable local.conf keys to a live node (1.10.7+)
+	 *
+	 * Called on the run thread after applyLocalConfig() when settings change
+	 * on a running service, so primaryPort, secondaryPort, portMappingEnabled
+	 * and allowManagementFrom changes no longer require a restart. Structural
+	 * settings (worker threads, queue sizes, shard counts) are still only
+	 * read at startup.
+	 *
+	 * @return True if the binder should refresh its bindings immediately
+	 */
+	bool _applyRuntimeSettings()
+	{
+		bool rebind = false;
+
+		// Primary port change: trial-bind the new port first so a bad value
+		// cannot take the datapath down, then let the binder refresh close
+		// the old sockets and open the new ones.
+		if ((_primaryPort)&&(_primaryPort != _ports[0])) {
+			if (_trialBind(_primaryPort)) {
+				_ports[0] = _primaryPort;
+				char portstr[64];
+				OSUtils::ztsnprintf(portstr,sizeof(portstr),"%u",_ports[0]);
+				OSUtils::writeFile((_homePath + ZT_PATH_SEPARATOR_S "zerotier-one.port").c_str(),std::string(portstr));
+				rebind = true;
+			} else {
+				fprintf(stderr,"WARNING: cannot bind new primaryPort %u, keeping %u" ZT_EOL_S,_primaryPort,_ports[0]);
+				_primaryPort = _ports[0];
+			}
+		}
+
+		if ((_allowSecondaryPort)&&(_secondaryPort != 0)&&(_secondaryPort != _ports[1])) {
+			_ports[1] = _secondaryPort;
+			rebind = true;
+		}
+
+#ifdef ZT_USE_MINIUPNPC
+		// Port mapping can be toggled live: start a mapper on the tertiary
+		// port when enabled, tear it down when disabled.
+		if ((_portMappingEnabled)&&(!_portMapper)) {
+			if (!_ports[2])
+				_ports[2] = (_tertiaryPort) ? _tertiaryPort : _getRandomPort();
+			if (_ports[2]) {
+				char uniqueName[64];
+				OSUtils::ztsnprintf(uniqueName,sizeof(uniqueName),"ZeroTier/%.10llx@%u",_node->address(),_ports[2]);
+				_portMapper = new PortMapper(_ports[2],uniqueName);
+				rebind = true;
+			}
+		} else if ((!_portMappingEnabled)&&(_portMapper)) {
+			delete _portMapper;
+			_portMapper = (PortMapper *)0;
+			_ports[2] = 0;
+			rebind = true;
+		}
+#endif
+
+		return rebind;
 	}
 
 #if ZT_VAULT_SUPPORT
@@ -2485,7 +3359,9 @@ public:
 
 			// Sync device-local managed routes first, then indirect results. That way
 			// we don't get destination unreachable for routes that are via things
-			// that do not yet have routes in the system.
+			// that do not yet have routes in the system. Batching collapses the
+			// whole pass into one route table transaction where supported.
+			ManagedRoute::beginRouteUpdates();
 			for(std::map< InetAddress, SharedPtr<ManagedRoute> >::iterator r(n.managedRoutes().begin());r!=n.managedRoutes().end();++r) {
 				if (!r->second->via())
 					r->second->sync();
@@ -2494,6 +3370,7 @@ public:
 				if (r->second->via())
 					r->second->sync();
 			}
+			ManagedRoute::commitRouteUpdates();
 		}
 
 		if (syncDns) {
@@ -2533,7 +3410,20 @@ public:
 		if ((len >= 16)&&(reinterpret_cast<const InetAddress *>(from)->ipScope() == InetAddress::IP_SCOPE_GLOBAL)) {
 			_lastDirectReceiveFromGlobal = now;
         }
+#ifdef ZT_PHY_USE_UDP_GSO
+		s_udpGsoBatch.open = true;
+#endif
+#ifdef ZT_TCP_FALLBACK_RELAY
+		s_tcpFallbackCork.open = true;
+#endif
 		const ZT_ResultCode rc = _node->processWirePacket(nullptr,now,reinterpret_cast<int64_t>(sock),reinterpret_cast<const struct sockaddr_storage *>(from),data,len,&_nextBackgroundTaskDeadline);
+#ifdef ZT_PHY_USE_UDP_GSO
+		_udpGsoFlush();
+		s_udpGsoBatch.open = false;
+#endif
+#ifdef ZT_TCP_FALLBACK_RELAY
+		_tcpFallbackUncork();
+#endif
 		if (ZT_ResultCode_isFatal(rc)) {
 			char tmp[256];
 			OSUtils::ztsnprintf(tmp,sizeof(tmp),"fatal error code from processWirePacket: %d",(int)rc);
@@ -2544,6 +3434,40 @@ public:
 		}
 	}
 
+	inline void phyOnDatagramWritable(PhySocket *sock,void **uptr)
+	{
+		Phy<OneServiceImpl *> *const owner = (*uptr) ? reinterpret_cast<Phy<OneServiceImpl *> *>(*uptr) : &_phy;
+		Mutex::Lock _l(_udpEgressQueues_m);
+		std::map<PhySocket *,_UdpEgressQueue>::iterator eq(_udpEgressQueues.find(sock));
+		if (eq != _udpEgressQueues.end()) {
+			while (!eq->second.q.empty()) {
+				_UdpEgressPacket &pkt = eq->second.q.front();
+				if (pkt.dscp) {
+					_phy.setUdpTos(sock,pkt.dscp);
+				}
+				if ((pkt.ttl)&&(pkt.dest.ss_family == AF_INET)) {
+					_phy.setIp4UdpTtl(sock,pkt.ttl);
+				}
+				const bool sent = _phy.udpSend(sock,reinterpret_cast<const struct sockaddr *>(&(pkt.dest)),pkt.data.data(),(unsigned long)pkt.data.length());
+				if ((pkt.ttl)&&(pkt.dest.ss_family == AF_INET)) {
+					_phy.setIp4UdpTtl(sock,255);
+				}
+				if (pkt.dscp) {
+					_phy.setUdpTos(sock,0);
+				}
+				if ((!sent)&&(_udpSendWouldBlock())) {
+					return; // still backed up; keep watching for writability
+				}
+				// Sent, or failed for a reason queueing cannot fix
+				eq->second.bytes -= (unsigned long)pkt.data.length();
+				eq->second.q.pop_front();
+			}
+			_udpEgressQueues.erase(eq);
+			--_udpEgressQueuedSockets;
+		}
+		owner->setNotifyWritable(sock,false);
+	}
+
 	inline void phyOnTcpConnect(PhySocket *sock,void **uptr,bool success)
 	{
 		if (!success) {
@@ -2562,6 +3486,8 @@ public:
 			if (_tcpFallbackTunnel)
 				_phy.close(_tcpFallbackTunnel->sock);
 			_tcpFallbackTunnel = tc;
+			// Tunnel writes are whole batches of messages; don't let Nagle hold them back
+			_phy.setNoDelay(sock,true);
 			_phy.streamSend(sock,ZT_TCP_TUNNEL_HELLO,sizeof(ZT_TCP_TUNNEL_HELLO));
 		} else {
 			_phy.close(sock,true);
@@ -2671,12 +3597,16 @@ public:
 						_phy.close(sock);
 					return;
 
-				case TcpConnection::TCP_TUNNEL_OUTGOING:
+				case TcpConnection::TCP_TUNNEL_OUTGOING: {
 					tc->readq.append((const char *)data,len);
-					while (tc->readq.length() >= 5) {
-						const char *data = tc->readq.data();
+					// Parse in place with a read offset and compact the queue once
+					// after the loop; erasing the front per message is quadratic
+					// when a TCP segment carries many coalesced messages
+					unsigned long rptr = 0;
+					while ((tc->readq.length() - rptr) >= 5) {
+						const char *data = tc->readq.data() + rptr;
 						const unsigned long mlen = ( ((((unsigned long)data[3]) & 0xff) << 8) | (((unsigned long)data[4]) & 0xff) );
-						if (tc->readq.length() >= (mlen + 5)) {
+						if ((tc->readq.length() - rptr) >= (mlen + 5)) {
 							InetAddress from;
 
 						unsigned long plen = mlen; // payload length, modified if there's an IP header
@@ -2717,6 +3647,9 @@ public:
 
 								if (from) {
 									InetAddress fakeTcpLocalInterfaceAddress((uint32_t)0xffffffff,0xffff);
+#ifdef ZT_TCP_FALLBACK_RELAY
+									s_tcpFallbackCork.open = true; // replies leave over the same tunnel; batch them
+#endif
 									const ZT_ResultCode rc = _node->processWirePacket(
 										(void *)0,
 										OSUtils::now(),
@@ -2725,6 +3658,9 @@ public:
 										data,
 										plen,
 										&_nextBackgroundTaskDeadline);
+#ifdef ZT_TCP_FALLBACK_RELAY
+									_tcpFallbackUncork();
+#endif
 									if (ZT_ResultCode_isFatal(rc)) {
 										char tmp[256];
 										OSUtils::ztsnprintf(tmp,sizeof(tmp),"fatal error code from processWirePacket: %d",(int)rc);
@@ -2738,12 +3674,15 @@ public:
 								}
 							}
 
-							if (tc->readq.length() > (mlen + 5))
-								tc->readq.erase(tc->readq.begin(),tc->readq.begin() + (mlen + 5));
-							else tc->readq.clear();
+							rptr += mlen + 5;
 						} else break;
 					}
+					if (rptr >= tc->readq.length())
+						tc->readq.clear();
+					else if (rptr)
+						tc->readq.erase(0,rptr);
 					return;
+				}
 
 			}
 		} catch ( ... ) {
@@ -2807,7 +3746,10 @@ public:
 							nwid,
 							friendlyName,
 							StapFrameHandler,
-							(void *)this));
+							(void *)this,
+							_tapQueues,
+							(_tapReaderCpus.empty()) ? (const unsigned int *)0 : &(_tapReaderCpus[0]),
+							(unsigned int)_tapReaderCpus.size()));
 						*nuptr = (void *)&n;
 
 						char nlcpath[256];
@@ -3030,7 +3972,6 @@ public:
 		}
 #endif
 		char p[1024];
-		FILE *f;
 		bool secure = false;
 		char dirname[1024];
 		dirname[0] = 0;
@@ -3043,6 +3984,10 @@ public:
 				OSUtils::ztsnprintf(p,sizeof(p),"%s" ZT_PATH_SEPARATOR_S "identity.secret",_homePath.c_str());
 				secure = true;
 				break;
+			case ZT_STATE_OBJECT_IDENTITY_VALIDATION:
+				OSUtils::ztsnprintf(p,sizeof(p),"%s" ZT_PATH_SEPARATOR_S "identity.validated",_homePath.c_str());
+				secure = true;
+				break;
 			case ZT_STATE_OBJECT_PLANET:
 				OSUtils::ztsnprintf(p,sizeof(p),"%s" ZT_PATH_SEPARATOR_S "planet",_homePath.c_str());
 				break;
@@ -3058,44 +4003,110 @@ public:
 				OSUtils::ztsnprintf(dirname,sizeof(dirname),"%s" ZT_PATH_SEPARATOR_S "peers.d",_homePath.c_str());
 				OSUtils::ztsnprintf(p,sizeof(p),"%s" ZT_PATH_SEPARATOR_S "%.10llx.peer",dirname,(unsigned long long)id[0]);
 				break;
+			case ZT_STATE_OBJECT_MEMBERSHIP:
+				OSUtils::ztsnprintf(dirname,sizeof(dirname),"%s" ZT_PATH_SEPARATOR_S "membership.d",_homePath.c_str());
+				OSUtils::ztsnprintf(p,sizeof(p),"%s" ZT_PATH_SEPARATOR_S "%.16llx-%.10llx.mem",dirname,(unsigned long long)id[0],(unsigned long long)id[1]);
+				break;
 			default:
 				return;
 		}
 
+		// Leaving a network orphans its cached membership credential state,
+		// so delete it along with the config; revoked or expired credentials
+		// should not linger on disk after the network is gone.
+		if ((type == ZT_STATE_OBJECT_NETWORK_CONFIG)&&((!data)||(len < 0))) {
+			char memPrefix[64];
+			OSUtils::ztsnprintf(memPrefix,sizeof(memPrefix),"%.16llx-",(unsigned long long)id[0]);
+			const std::string memDir(_homePath + ZT_PATH_SEPARATOR_S "membership.d");
+			OSUtils::eachFileInDirectory(memDir.c_str(),[&memDir,&memPrefix](const char *name,bool isDirectory) {
+				if ((!isDirectory)&&(strncmp(name,memPrefix,17) == 0)) {
+					OSUtils::rm((memDir + ZT_PATH_SEPARATOR_S + name).c_str());
+				}
+				return true;
+			});
+		}
+
+		// Queue for the write-behind thread rather than writing synchronously:
+		// repeated changes to the same object within a flush period coalesce
+		// into one atomic rename-into-place write, keeping bursts of small
+		// synchronous writes off this thread and the storage device.
+		std::lock_guard<std::mutex> l(_statePending_m);
+		_PendingStateWrite &ps = _statePending[std::string(p)];
+		ps.dirname = dirname;
+		ps.secure = secure;
 		if ((len >= 0)&&(data)) {
-			// Check to see if we've already written this first. This reduces
-			// redundant writes and I/O overhead on most platforms and has
-			// little effect on others.
-			f = fopen(p,"rb");
-			if (f) {
-				char *const buf = (char *)malloc(len*4);
-				if (buf) {
-					long l = (long)fread(buf,1,(size_t)(len*4),f);
+			ps.remove = false;
+			ps.data.assign(reinterpret_cast<const uint8_t *>(data),reinterpret_cast<const uint8_t *>(data) + len);
+		} else {
+			ps.remove = true;
+			ps.data.clear();
+		}
+	}
+
+	void _stateWriterMain()
+	{
+		std::map<std::string,_PendingStateWrite> batch;
+		for(;;) {
+			{
+				std::unique_lock<std::mutex> l(_statePending_m);
+				if (_stateWriterRun)
+					_statePending_c.wait_for(l,std::chrono::milliseconds(ZT_STATE_WRITE_FLUSH_PERIOD));
+				batch.swap(_statePending);
+				if ((!_stateWriterRun)&&(batch.empty()))
+					return;
+			}
+
+			for(std::map<std::string,_PendingStateWrite>::iterator w(batch.begin());w!=batch.end();++w) {
+				const std::string &p = w->first;
+				_PendingStateWrite &ps = w->second;
+
+				if (ps.remove) {
+					OSUtils::rm(p.c_str());
+					continue;
+				}
+
+				// Skip objects whose on-disk content already matches. This
+				// reduces redundant writes and I/O overhead on most platforms
+				// and has little effect on others.
+				{
+					std::string cur;
+					if ((OSUtils::readFile(p.c_str(),cur))&&(cur.length() == ps.data.size())&&((ps.data.empty())||(memcmp(cur.data(),ps.data.data(),ps.data.size()) == 0)))
+						continue;
+				}
+
+				// Write to a temporary alongside the target and rename into
+				// place so a crash mid-flush never leaves a torn state file.
+				// The fsyncs all land here, batched once per flush pass.
+				const std::string tmp(p + ".tmp");
+				FILE *f = fopen(tmp.c_str(),"wb");
+				if ((!f)&&(ps.dirname.length() > 0)) { // create subdirectory if it does not exist
+					OSUtils::mkdir(ps.dirname);
+					f = fopen(tmp.c_str(),"wb");
+				}
+				if (f) {
+					const bool ok = ((ps.data.empty())||(fwrite(ps.data.data(),ps.data.size(),1,f) == 1));
+					if (!ok)
+						fprintf(stderr,"WARNING: unable to write to file: %s (I/O error)" ZT_EOL_S,tmp.c_str());
+					fflush(f);
+#ifndef __WINDOWS__
+					fsync(fileno(f));
+#endif
 					fclose(f);
-					if ((l == (long)len)&&(memcmp(data,buf,l) == 0)) {
-						free(buf);
-						return;
+					if (ok) {
+						if (ps.secure)
+							OSUtils::lockDownFile(tmp.c_str(),false);
+						if (!OSUtils::rename(tmp.c_str(),p.c_str())) {
+							fprintf(stderr,"WARNING: unable to write to file: %s (rename failed)" ZT_EOL_S,p.c_str());
+							OSUtils::rm(tmp.c_str());
+						}
+					} else {
+						OSUtils::rm(tmp.c_str());
 					}
-					free(buf);
+				} else {
+					fprintf(stderr,"WARNING: unable to write to file: %s (unable to open)" ZT_EOL_S,tmp.c_str());
 				}
 			}
-
-			f = fopen(p,"wb");
-			if ((!f)&&(dirname[0])) { // create subdirectory if it does not exist
-				OSUtils::mkdir(dirname);
-				f = fopen(p,"wb");
-			}
-			if (f) {
-				if (fwrite(data,len,1,f) != 1)
-					fprintf(stderr,"WARNING: unable to write to file: %s (I/O error)" ZT_EOL_S,p);
-				fclose(f);
-				if (secure)
-					OSUtils::lockDownFile(p,false);
-			} else {
-				fprintf(stderr,"WARNING: unable to write to file: %s (unable to open)" ZT_EOL_S,p);
-			}
-		} else {
-			OSUtils::rm(p);
+			batch.clear();
 		}
 	}
 
@@ -3194,6 +4205,9 @@ public:
 			case ZT_STATE_OBJECT_IDENTITY_SECRET:
 				OSUtils::ztsnprintf(p,sizeof(p),"%s" ZT_PATH_SEPARATOR_S "identity.secret",_homePath.c_str());
 				break;
+			case ZT_STATE_OBJECT_IDENTITY_VALIDATION:
+				OSUtils::ztsnprintf(p,sizeof(p),"%s" ZT_PATH_SEPARATOR_S "identity.validated",_homePath.c_str());
+				break;
 			case ZT_STATE_OBJECT_PLANET:
 				OSUtils::ztsnprintf(p,sizeof(p),"%s" ZT_PATH_SEPARATOR_S "planet",_homePath.c_str());
 				break;
@@ -3206,9 +4220,28 @@ public:
 			case ZT_STATE_OBJECT_PEER:
 				OSUtils::ztsnprintf(p,sizeof(p),"%s" ZT_PATH_SEPARATOR_S "peers.d" ZT_PATH_SEPARATOR_S "%.10llx.peer",_homePath.c_str(),(unsigned long long)id[0]);
 				break;
+			case ZT_STATE_OBJECT_MEMBERSHIP:
+				OSUtils::ztsnprintf(p,sizeof(p),"%s" ZT_PATH_SEPARATOR_S "membership.d" ZT_PATH_SEPARATOR_S "%.16llx-%.10llx.mem",_homePath.c_str(),(unsigned long long)id[0],(unsigned long long)id[1]);
+				break;
 			default:
 				return -1;
 		}
+
+		// Serve pending write-behind content first so reads always see the
+		// latest state even before it has been flushed to disk
+		{
+			std::lock_guard<std::mutex> l(_statePending_m);
+			std::map<std::string,_PendingStateWrite>::const_iterator w(_statePending.find(std::string(p)));
+			if (w != _statePending.end()) {
+				if (w->second.remove)
+					return -1;
+				const unsigned int n = (w->second.data.size() > (size_t)maxlen) ? maxlen : (unsigned int)w->second.data.size();
+				if (n > 0)
+					memcpy(data,w->second.data.data(),n);
+				return (int)n;
+			}
+		}
+
 		FILE *f = fopen(p,"rb");
 		if (f) {
 			int n = (int)fread(data,1,maxlen,f);
@@ -3230,6 +4263,77 @@ public:
 		return -1;
 	}
 
+#ifdef ZT_PHY_USE_UDP_GSO
+	inline void _udpGsoFlush()
+	{
+		UdpGsoBatch &batch = s_udpGsoBatch;
+		if (batch.len > 0) {
+			_phy.udpSendSegmented(batch.sock,reinterpret_cast<const struct sockaddr *>(&(batch.dest)),batch.buf,batch.len,batch.segSize);
+			batch.len = 0;
+			batch.segSize = 0;
+			batch.sock = (PhySocket *)0;
+		}
+	}
+#endif
+
+#ifdef ZT_TCP_FALLBACK_RELAY
+	// Close a TCP fallback cork window, pushing everything queued during it
+	// to the tunnel in a single write
+	inline void _tcpFallbackUncork()
+	{
+		s_tcpFallbackCork.open = false;
+		if (s_tcpFallbackCork.pending) {
+			s_tcpFallbackCork.pending = false;
+			TcpConnection *const tc = _tcpFallbackTunnel;
+			if (tc) {
+				void *tmpptr = (void *)tc;
+				phyOnTcpWritable(tc->sock,&tmpptr);
+			}
+		}
+	}
+#endif
+
+	// True when the last sendto() failed only because the kernel send buffer
+	// was full, as opposed to a routing or interface error
+	static inline bool _udpSendWouldBlock()
+	{
+#ifdef __WINDOWS__
+		return (WSAGetLastError() == WSAEWOULDBLOCK);
+#else
+		return ((errno == EAGAIN)||(errno == EWOULDBLOCK)||(errno == ENOBUFS));
+#endif
+	}
+
+	// Queue a packet whose send failed on a full kernel buffer; it will be
+	// flushed by phyOnDatagramWritable() when the socket drains. Returns false
+	// (and counts a drop) if the socket's byte cap is already spent.
+	inline bool _udpEgressEnqueue(PhySocket *sock,const struct sockaddr_storage *addr,const void *data,unsigned int len,unsigned int ttl,unsigned int dscp)
+	{
+		Mutex::Lock _l(_udpEgressQueues_m);
+		_UdpEgressQueue &eq = _udpEgressQueues[sock];
+		if ((eq.bytes + (unsigned long)len) > ZT_UDP_MAX_EGRESS_QUEUE_BYTES) {
+			Metrics::udp_egress_queue_drop++;
+			return false;
+		}
+		if (eq.q.empty()) {
+			++_udpEgressQueuedSockets;
+			// The socket may belong to a UDP shard worker's Phy; its owner is
+			// stashed in the socket uptr at bind time
+			void **const up = Phy<OneServiceImpl *>::getuptr(sock);
+			Phy<OneServiceImpl *> *const owner = (*up) ? reinterpret_cast<Phy<OneServiceImpl *> *>(*up) : &_phy;
+			owner->setNotifyWritable(sock,true);
+		}
+		eq.q.push_back(_UdpEgressPacket());
+		_UdpEgressPacket &pkt = eq.q.back();
+		pkt.dest = *(reinterpret_cast<const InetAddress *>(addr));
+		pkt.ttl = ttl;
+		pkt.dscp = dscp;
+		pkt.data.assign(reinterpret_cast<const char *>(data),len);
+		eq.bytes += (unsigned long)len;
+		Metrics::udp_egress_queued++;
+		return true;
+	}
+
 	inline int nodeWirePacketSendFunction(const int64_t localSocket,const struct sockaddr_storage *addr,const void *data,unsigned int len,unsigned int ttl)
 	{
 #ifdef ZT_TCP_FALLBACK_RELAY
@@ -3241,7 +4345,14 @@ public:
 					// IP address in ZT_TCP_FALLBACK_AFTER milliseconds. If we do start getting
 					// valid direct traffic we'll stop using it and close the socket after a while.
 					const int64_t now = OSUtils::now();
-					if (_forceTcpRelay || (((now - _lastDirectReceiveFromGlobal) > ZT_TCP_FALLBACK_AFTER)&&((now - _lastRestart) > ZT_TCP_FALLBACK_AFTER))) {
+					// Race the fallback early when nothing direct has come back since
+					// start/wake: a couple of seconds of unanswered HELLOs behind a
+					// UDP-blocking firewall is already conclusive, UDP attempts keep
+					// going regardless, and the tunnel is torn down as soon as direct
+					// traffic starts flowing. The long trigger still governs the case
+					// where a previously working UDP path dies later.
+					const bool tcpFallbackRace = ((_lastDirectReceiveFromGlobal <= _lastRestart)&&((now - (int64_t)_lastRestart) > ZT_TCP_FALLBACK_RACE_AFTER));
+					if (_forceTcpRelay || tcpFallbackRace || (((now - _lastDirectReceiveFromGlobal) > ZT_TCP_FALLBACK_AFTER)&&((now - _lastRestart) > ZT_TCP_FALLBACK_AFTER))) {
 						if (_tcpFallbackTunnel) {
 							bool flushNow = false;
 							{
@@ -3264,10 +4375,15 @@ public:
 								}
 							}
 							if (flushNow) {
-								void *tmpptr = (void *)_tcpFallbackTunnel;
-								phyOnTcpWritable(_tcpFallbackTunnel->sock,&tmpptr);
+								if (s_tcpFallbackCork.open) {
+									s_tcpFallbackCork.pending = true; // pushed once when the cork window closes
+								} else {
+									void *tmpptr = (void *)_tcpFallbackTunnel;
+									phyOnTcpWritable(_tcpFallbackTunnel->sock,&tmpptr);
+								}
 							}
-						} else if (_forceTcpRelay || (((now - _lastSendToGlobalV4) < ZT_TCP_FALLBACK_AFTER)&&((now - _lastSendToGlobalV4) > (ZT_PING_CHECK_INVERVAL / 2)))) {
+						} else if (_forceTcpRelay || (tcpFallbackRace&&((now - (int64_t)_lastTcpFallbackDial) > ZT_TCP_FALLBACK_RACE_AFTER)) || (((now - _lastSendToGlobalV4) < ZT_TCP_FALLBACK_AFTER)&&((now - _lastSendToGlobalV4) > (ZT_PING_CHECK_INVERVAL / 2)))) {
+							_lastTcpFallbackDial = (uint64_t)now;
 							const InetAddress addr(_fallbackRelayAddress);
 							TcpConnection *tc = new TcpConnection();
 							{
@@ -3298,6 +4414,44 @@ public:
 		// working we can instantly "fail forward" to it and stop using TCP
 		// proxy fallback, which is slow.
 		if ((localSocket != -1)&&(localSocket != 0)&&(_binder.isUdpSocketValid((PhySocket *)((uintptr_t)localSocket)))) {
+			// If this socket already has an egress backlog, queue behind it so
+			// packets drain in order when the socket becomes writable again
+			if (_udpEgressQueuedSockets.load(std::memory_order_relaxed) != 0) {
+				PhySocket *const s = (PhySocket *)((uintptr_t)localSocket);
+				bool backlogged;
+				{
+					Mutex::Lock _l(_udpEgressQueues_m);
+					backlogged = (_udpEgressQueues.find(s) != _udpEgressQueues.end());
+				}
+				if (backlogged) {
+					return ((_udpEgressEnqueue(s,addr,data,len,ttl,Node::txWireDscp())) ? 0 : -1);
+				}
+			}
+#ifdef ZT_PHY_USE_UDP_GSO
+			UdpGsoBatch &batch = s_udpGsoBatch;
+			if ((batch.open)&&(ttl == 0)&&(len > 0)&&(len <= 0xffff)) {
+				PhySocket *const s = (PhySocket *)((uintptr_t)localSocket);
+				const InetAddress &dest = *(reinterpret_cast<const InetAddress *>(addr));
+				if ((batch.len > 0)&&((batch.sock != s)||(len > batch.segSize)||(!(batch.dest == dest))||((batch.len + len) > (unsigned int)sizeof(batch.buf))))
+					_udpGsoFlush();
+				if (batch.len == 0) {
+					batch.sock = s;
+					batch.dest = dest;
+					batch.segSize = len;
+				}
+				memcpy(batch.buf + batch.len,data,len);
+				batch.len += len;
+				if (len < batch.segSize)
+					_udpGsoFlush(); // a shorter tail segment ends the burst
+				return 0;
+			}
+#endif
+			// Mark the outer packet with the DSCP the datapath classified from
+			// the inner frame (zero when unset; handled like the TTL override)
+			const unsigned int dscp = Node::txWireDscp();
+			if (dscp) {
+				_phy.setUdpTos((PhySocket *)((uintptr_t)localSocket),dscp);
+			}
 			if ((ttl)&&(addr->ss_family == AF_INET)) {
                 _phy.setIp4UdpTtl((PhySocket *)((uintptr_t)localSocket),ttl);
             }
@@ -3305,7 +4459,19 @@ public:
 			if ((ttl)&&(addr->ss_family == AF_INET)) {
                 _phy.setIp4UdpTtl((PhySocket *)((uintptr_t)localSocket),255);
             }
-			return ((r) ? 0 : -1);
+			if (dscp) {
+				_phy.setUdpTos((PhySocket *)((uintptr_t)localSocket),0);
+			}
+			if (r) {
+				return 0;
+			}
+			if (_udpSendWouldBlock()) {
+				// Kernel send buffer full: absorb the burst in the egress
+				// queue and flush it on writability instead of dropping, which
+				// the upper layers would repair with far costlier retransmits
+				return ((_udpEgressEnqueue((PhySocket *)((uintptr_t)localSocket),addr,data,len,ttl,dscp)) ? 0 : -1);
+			}
+			return -1;
 		} else {
 			return ((_binder.udpSendAll(_phy,addr,data,len,ttl)) ? 0 : -1);
 		}
@@ -3391,7 +4557,22 @@ public:
 
 	inline void tapFrameHandler(uint64_t nwid, const MAC& from, const MAC& to, unsigned int etherType, unsigned int vlanId, const void* data, unsigned int len)
 	{
+#ifdef ZT_PHY_USE_UDP_GSO
+		// Large frames fragment into bursts of equal-size wire packets; open a
+		// GSO window so those fragments leave the kernel as one segmented send.
+		s_udpGsoBatch.open = true;
+#endif
+#ifdef ZT_TCP_FALLBACK_RELAY
+		s_tcpFallbackCork.open = true;
+#endif
 		_node->processVirtualNetworkFrame((void*)0, OSUtils::now(), nwid, from.toInt(), to.toInt(), etherType, vlanId, data, len, &_nextBackgroundTaskDeadline);
+#ifdef ZT_PHY_USE_UDP_GSO
+		_udpGsoFlush();
+		s_udpGsoBatch.open = false;
+#endif
+#ifdef ZT_TCP_FALLBACK_RELAY
+		_tcpFallbackUncork();
+#endif
 	}
 
 	inline void onHttpResponseFromClient(TcpConnection* tc)
@@ -29,6 +29,9 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <ifaddrs.h>
 #endif
@@ -80,20 +83,35 @@ SoftwareUpdater::SoftwareUpdater(Node &node,const std::string &homePath) :
 	_channel(ZT_SOFTWARE_UPDATE_DEFAULT_CHANNEL),
 	_distLog((FILE *)0),
 	_latestValid(false),
-	_downloadLength(0)
+	_downloadLength(0),
+	_downloadHaveBytes(0),
+	_downloadRequestPtr(0)
 {
 	OSUtils::rm((_homePath + ZT_PATH_SEPARATOR_S ZT_SOFTWARE_UPDATE_BIN_FILENAME).c_str());
 }
 
 SoftwareUpdater::~SoftwareUpdater()
 {
+	_clearDist();
 	if (_distLog)
 		fclose(_distLog);
 }
 
-void SoftwareUpdater::setUpdateDistribution(bool distribute)
+void SoftwareUpdater::_clearDist()
 {
+#ifndef __WINDOWS__
+	for(std::map< std::array<uint8_t,16>,_D >::iterator d(_dist.begin());d!=_dist.end();++d) {
+		if (d->second.mappedData) {
+			munmap(const_cast<uint8_t *>(d->second.mappedData),(size_t)d->second.mappedLength);
+		}
+	}
+#endif
 	_dist.clear();
+}
+
+void SoftwareUpdater::setUpdateDistribution(bool distribute)
+{
+	_clearDist();
 	if (distribute) {
 		_distLog = fopen((_homePath + ZT_PATH_SEPARATOR_S "update-dist.log").c_str(),"a");
 
@@ -112,17 +130,40 @@ void SoftwareUpdater::setUpdateDistribution(bool distribute)
 						// If update meta is called e.g. foo.exe.json, then foo.exe is the update itself
 						const std::string binPath(udd + ZT_PATH_SEPARATOR_S + u->substr(0,u->length() - 5));
 						const std::string metaHash(OSUtils::jsonBinFromHex(d.meta[ZT_SOFTWARE_UPDATE_JSON_UPDATE_HASH]));
-						if ((metaHash.length() == 64)&&(OSUtils::readFile(binPath.c_str(),d.bin))) {
-							std::array<uint8_t,64> sha512;
-							SHA512(sha512.data(),d.bin.data(),(unsigned int)d.bin.length());
-							if (!memcmp(sha512.data(),metaHash.data(),64)) { // double check that hash in JSON is correct
-								d.meta[ZT_SOFTWARE_UPDATE_JSON_UPDATE_SIZE] = d.bin.length(); // override with correct value -- setting this in meta json is optional
-								std::array<uint8_t,16> shakey;
-								memcpy(shakey.data(),sha512.data(),16);
-								_dist[shakey] = d;
-								if (_distLog) {
-									fprintf(_distLog,".......... INIT: DISTRIBUTING %s (%u bytes)" ZT_EOL_S,binPath.c_str(),(unsigned int)d.bin.length());
-									fflush(_distLog);
+						if (metaHash.length() == 64) {
+#ifndef __WINDOWS__
+							// Map the image read-only and serve chunks straight out of the
+							// mapping so a distributor hosting many large images does not
+							// hold a heap copy of each one for the life of the process.
+							const int fd = ::open(binPath.c_str(),O_RDONLY);
+							if (fd >= 0) {
+								struct stat ms;
+								if ((fstat(fd,&ms) == 0)&&(ms.st_size > 0)) {
+									void *const m = mmap((void *)0,(size_t)ms.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+									if (m != MAP_FAILED) {
+										d.mappedData = reinterpret_cast<const uint8_t *>(m);
+										d.mappedLength = (unsigned long)ms.st_size;
+									}
+								}
+								::close(fd);
+							}
+#endif
+							if ((d.mappedData)||(OSUtils::readFile(binPath.c_str(),d.bin))) {
+								std::array<uint8_t,64> sha512;
+								SHA512(sha512.data(),d.data(),(unsigned int)d.length());
+								if (!memcmp(sha512.data(),metaHash.data(),64)) { // double check that hash in JSON is correct
+									d.meta[ZT_SOFTWARE_UPDATE_JSON_UPDATE_SIZE] = d.length(); // override with correct value -- setting this in meta json is optional
+									std::array<uint8_t,16> shakey;
+									memcpy(shakey.data(),sha512.data(),16);
+									_dist[shakey] = d;
+									if (_distLog) {
+										fprintf(_distLog,".......... INIT: DISTRIBUTING %s (%u bytes)%s" ZT_EOL_S,binPath.c_str(),(unsigned int)d.length(),(d.mappedData) ? " (memory-mapped)" : "");
+										fflush(_distLog);
+									}
+								} else if (d.mappedData) {
+#ifndef __WINDOWS__
+									munmap(const_cast<uint8_t *>(d.mappedData),(size_t)d.mappedLength);
+#endif
 								}
 							}
 						}
@@ -221,17 +262,16 @@ void SoftwareUpdater::handleSoftwareUpdateUserMessage(uint64_t origin,const void
 									_latestMeta = req;
 									_latestValid = false;
 									OSUtils::rm((_homePath + ZT_PATH_SEPARATOR_S ZT_SOFTWARE_UPDATE_BIN_FILENAME).c_str());
-									_download = std::string();
 									memcpy(_downloadHashPrefix.data(),hash.data(),16);
 									_downloadLength = len;
+									_download.assign(len,(char)0); // chunks arrive out of order and are written in place
+									_downloadHaveBytes = 0;
+									_downloadRequestPtr = 0;
+									_downloadHaveChunk.assign((len + ZT_SOFTWARE_UPDATE_CHUNK_SIZE - 1) / ZT_SOFTWARE_UPDATE_CHUNK_SIZE,false);
 								}
 
-								if ((_downloadLength > 0)&&(_download.length() < _downloadLength)) {
-									Buffer<128> gd;
-									gd.append((uint8_t)VERB_GET_DATA);
-									gd.append(_downloadHashPrefix.data(),16);
-									gd.append((uint32_t)_download.length());
-									_node.sendUserMessage((void *)0,ZT_SOFTWARE_UPDATE_SERVICE,ZT_SOFTWARE_UPDATE_USER_MESSAGE_TYPE,gd.data(),gd.size());
+								if ((_downloadLength > 0)&&(_downloadHaveBytes < _downloadLength)) {
+									_requestChunks(ZT_SOFTWARE_UPDATE_MAX_OUTSTANDING_REQUESTS);
 								}
 							}
 						}
@@ -249,12 +289,12 @@ void SoftwareUpdater::handleSoftwareUpdateUserMessage(uint64_t origin,const void
 					std::array<uint8_t,16> shakey;
 					memcpy(shakey.data(),reinterpret_cast<const uint8_t *>(data) + 1,16);
 					std::map< std::array<uint8_t,16>,_D >::iterator d(_dist.find(shakey));
-					if ((d != _dist.end())&&(idx < (unsigned long)d->second.bin.length())) {
+					if ((d != _dist.end())&&(idx < d->second.length())) {
 						Buffer<ZT_SOFTWARE_UPDATE_CHUNK_SIZE + 128> buf;
 						buf.append((uint8_t)VERB_DATA);
 						buf.append(reinterpret_cast<const uint8_t *>(data) + 1,16);
 						buf.append((uint32_t)idx);
-						buf.append(d->second.bin.data() + idx,std::min((unsigned long)ZT_SOFTWARE_UPDATE_CHUNK_SIZE,(unsigned long)(d->second.bin.length() - idx)));
+						buf.append(d->second.data() + idx,std::min((unsigned long)ZT_SOFTWARE_UPDATE_CHUNK_SIZE,d->second.length() - idx));
 						_node.sendUserMessage((void *)0,origin,ZT_SOFTWARE_UPDATE_USER_MESSAGE_TYPE,buf.data(),buf.size());
 					}
 				}
@@ -266,14 +306,18 @@ void SoftwareUpdater::handleSoftwareUpdateUserMessage(uint64_t origin,const void
 					idx |= (unsigned long)*(reinterpret_cast<const uint8_t *>(data) + 18) << 16;
 					idx |= (unsigned long)*(reinterpret_cast<const uint8_t *>(data) + 19) << 8;
 					idx |= (unsigned long)*(reinterpret_cast<const uint8_t *>(data) + 20);
-					if (idx == (unsigned long)_download.length()) {
-						_download.append(reinterpret_cast<const char *>(data) + 21,len - 21);
-						if (_download.length() < _downloadLength) {
-							Buffer<128> gd;
-							gd.append((uint8_t)VERB_GET_DATA);
-							gd.append(_downloadHashPrefix.data(),16);
-							gd.append((uint32_t)_download.length());
-							_node.sendUserMessage((void *)0,ZT_SOFTWARE_UPDATE_SERVICE,ZT_SOFTWARE_UPDATE_USER_MESSAGE_TYPE,gd.data(),gd.size());
+					// We only ever request chunk-aligned offsets, and chunks may
+					// arrive in any order. Duplicates (e.g. from re-requests after
+					// presumed loss) are simply ignored.
+					if (((idx % ZT_SOFTWARE_UPDATE_CHUNK_SIZE) == 0)&&((idx + (unsigned long)(len - 21)) <= _downloadLength)) {
+						const unsigned long chunkNo = idx / ZT_SOFTWARE_UPDATE_CHUNK_SIZE;
+						if ((chunkNo < (unsigned long)_downloadHaveChunk.size())&&(!_downloadHaveChunk[chunkNo])) {
+							_download.replace(idx,len - 21,reinterpret_cast<const char *>(data) + 21,len - 21);
+							_downloadHaveChunk[chunkNo] = true;
+							_downloadHaveBytes += (unsigned long)(len - 21);
+							if (_downloadHaveBytes < _downloadLength) {
+								_requestChunks(1); // keep the request window full
+							}
 						}
 					}
 				}
@@ -326,7 +370,7 @@ bool SoftwareUpdater::check(const int64_t now)
 		return true;
 
 	if (_downloadLength > 0) {
-		if (_download.length() >= _downloadLength) {
+		if (_downloadHaveBytes >= _downloadLength) {
 			// This is the very important security validation part that makes sure
 			// this software update doesn't have cooties.
 
@@ -347,6 +391,8 @@ bool SoftwareUpdater::check(const int64_t now)
 							_latestValid = true;
 							_download = std::string();
 							_downloadLength = 0;
+							_downloadHaveBytes = 0;
+							_downloadHaveChunk = std::vector<bool>();
 							return true;
 						}
 					}
@@ -359,16 +405,37 @@ bool SoftwareUpdater::check(const int64_t now)
 			_latestValid = false;
 			_download = std::string();
 			_downloadLength = 0;
+			_downloadHaveBytes = 0;
+			_downloadHaveChunk = std::vector<bool>();
 		} else {
+			// Re-request anything still missing; this also serves as the
+			// retransmit timer for chunks lost in flight.
+			_requestChunks(ZT_SOFTWARE_UPDATE_MAX_OUTSTANDING_REQUESTS);
+		}
+	}
+
+	return false;
+}
+
+void SoftwareUpdater::_requestChunks(unsigned int n)
+{
+	const unsigned long chunkCount = (unsigned long)_downloadHaveChunk.size();
+	if (!chunkCount) {
+		return;
+	}
+	unsigned long c = _downloadRequestPtr % chunkCount;
+	for(unsigned long scanned=0;(scanned<chunkCount)&&(n>0);++scanned) {
+		if (!_downloadHaveChunk[c]) {
 			Buffer<128> gd;
 			gd.append((uint8_t)VERB_GET_DATA);
 			gd.append(_downloadHashPrefix.data(),16);
-			gd.append((uint32_t)_download.length());
+			gd.append((uint32_t)(c * ZT_SOFTWARE_UPDATE_CHUNK_SIZE));
 			_node.sendUserMessage((void *)0,ZT_SOFTWARE_UPDATE_SERVICE,ZT_SOFTWARE_UPDATE_USER_MESSAGE_TYPE,gd.data(),gd.size());
+			--n;
 		}
+		c = (c + 1) % chunkCount;
 	}
-
-	return false;
+	_downloadRequestPtr = c;
 }
 
 void SoftwareUpdater::apply()
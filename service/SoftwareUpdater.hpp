@@ -56,6 +56,16 @@
  */
 #define ZT_SOFTWARE_UPDATE_MAX_SIZE (1024 * 1024 * 256)
 
+/**
+ * Maximum number of chunk requests kept in flight while downloading
+ *
+ * The download used to be strict request/response lockstep, which limits
+ * throughput to one chunk per round trip and makes full images take hours
+ * over long fat links. Keeping a window of outstanding requests overlaps
+ * the round trips; lost chunks are re-requested by the periodic check.
+ */
+#define ZT_SOFTWARE_UPDATE_MAX_OUTSTANDING_REQUESTS 16
+
 /**
  * How often (ms) do we check?
  */
@@ -177,6 +187,13 @@ public:
 	inline void setChannel(const std::string &channel) { _channel = channel; }
 
 private:
+	// Send GET_DATA for up to n chunks we have not yet received, scanning
+	// forward (with wrap) from the last request position
+	void _requestChunks(unsigned int n);
+
+	// Unmap any memory-mapped update images and clear the distribution set
+	void _clearDist();
+
 	Node &_node;
 	uint64_t _lastCheckTime;
 	std::string _homePath;
@@ -186,8 +203,20 @@ private:
 	// Offered software updates if we are an update host (we have update-dist.d and update hosting is enabled)
 	struct _D
 	{
+		_D() : mappedData((const uint8_t *)0),mappedLength(0) {}
+
 		nlohmann::json meta;
-		std::string bin;
+		std::string bin; // heap copy of the image, used only if the file could not be mapped
+
+		// Read-only mapping of the image file. Chunks are served straight out
+		// of the mapping, so the kernel page cache acts as the (shared,
+		// memory-pressure-aware) hot chunk cache instead of a permanent heap
+		// copy per image. Unmapped by _clearDist().
+		const uint8_t *mappedData;
+		unsigned long mappedLength;
+
+		inline const uint8_t *data() const { return (mappedData) ? mappedData : reinterpret_cast<const uint8_t *>(bin.data()); }
+		inline unsigned long length() const { return (mappedData) ? mappedLength : (unsigned long)bin.length(); }
 	};
 	std::map< std::array<uint8_t,16>,_D > _dist; // key is first 16 bytes of hash
 
@@ -197,6 +226,9 @@ private:
 	std::string _download;
 	std::array<uint8_t,16> _downloadHashPrefix;
 	unsigned long _downloadLength;
+	unsigned long _downloadHaveBytes;
+	unsigned long _downloadRequestPtr; // chunk index scan cursor for _requestChunks()
+	std::vector<bool> _downloadHaveChunk;
 };
 
 } // namespace ZeroTier
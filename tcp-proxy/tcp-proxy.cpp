@@ -16,8 +16,11 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-// HACK! Will eventually use epoll() or something in Phy<> instead of select().
-// Also be sure to change ulimit -n and fs.file-max in /etc/sysctl.conf on relays.
+// The proxy runs one worker thread per core (override with the first command
+// line argument), each with its own Phy<> loop and its own SO_REUSEPORT
+// listener so the kernel shards accepted connections across workers and no
+// state is shared between them. Be sure to change ulimit -n and fs.file-max
+// in /etc/sysctl.conf on relays.
 #if defined(__linux__) || defined(__LINUX__) || defined(__LINUX) || defined(LINUX)
 #include <linux/posix_types.h>
 #include <bits/types.h>
@@ -40,11 +43,17 @@
 #include <string>
 #include <algorithm>
 #include <vector>
+#include <thread>
 
 #include "../osdep/Phy.hpp"
 
 #define ZT_TCP_PROXY_CONNECTION_TIMEOUT_SECONDS 300
 #define ZT_TCP_PROXY_TCP_PORT 443
+#define ZT_TCP_PROXY_MAX_WORKER_THREADS 64
+
+// Bumped by SIGUSR1; workers dump per-client byte accounting when it changes
+static volatile sig_atomic_t s_dumpStatsRequests = 0;
+static void _sigUsr1Handler(int sig) { ++s_dumpStatsRequests; }
 
 using namespace ZeroTier;
 
@@ -89,17 +98,23 @@ struct TcpProxyService;
 struct TcpProxyService
 {
 	Phy<TcpProxyService *> *phy;
+	unsigned int workerId;
 	int udpPortCounter;
 	struct Client
 	{
 		char tcpReadBuf[131072];
 		char tcpWriteBuf[131072];
 		unsigned long tcpWritePtr;
+		unsigned long tcpWriteStart; // first unsent byte in tcpWriteBuf (avoids memmove per partial send)
 		unsigned long tcpReadPtr;
 		PhySocket *tcp;
 		PhySocket *udp;
 		time_t lastActivity;
+		time_t connectedAt;
 		bool newVersion;
+		struct sockaddr_in remote;
+		uint64_t tcpBytesIn,tcpBytesOut; // bytes on the TCP side (from/to the client)
+		uint64_t udpBytesIn,udpBytesOut; // bytes on the UDP side (from/to the network)
 	};
 	std::map< PhySocket *,Client > clients;
 
@@ -120,6 +135,8 @@ struct TcpProxyService
 		return (PhySocket *)0;
 	}
 
+	void phyOnDatagramWritable(PhySocket *sock,void **uptr) {}
+
 	void phyOnDatagram(PhySocket *sock,void **uptr,const struct sockaddr *localAddr,const struct sockaddr *from,void *data,unsigned long len)
 	{
 		if (!*uptr)
@@ -127,13 +144,22 @@ struct TcpProxyService
 		if ((from->sa_family == AF_INET)&&(len >= 16)&&(len < 2048)) {
 			Client &c = *((Client *)*uptr);
 			c.lastActivity = time((time_t *)0);
+			c.udpBytesIn += (uint64_t)len;
 
 			unsigned long mlen = len;
 			if (c.newVersion)
 				mlen += 7; // new clients get IP info
 
+			// If the tail of the buffer is full but a sent prefix exists,
+			// compact once to reclaim it rather than dropping the datagram
+			if (((c.tcpWritePtr + 5 + mlen) > sizeof(c.tcpWriteBuf))&&(c.tcpWriteStart)) {
+				memmove(c.tcpWriteBuf,c.tcpWriteBuf + c.tcpWriteStart,c.tcpWritePtr - c.tcpWriteStart);
+				c.tcpWritePtr -= c.tcpWriteStart;
+				c.tcpWriteStart = 0;
+			}
+
 			if ((c.tcpWritePtr + 5 + mlen) <= sizeof(c.tcpWriteBuf)) {
-				if (!c.tcpWritePtr)
+				if (c.tcpWritePtr == c.tcpWriteStart)
 					phy->setNotifyWritable(c.tcp,true);
 
 				c.tcpWriteBuf[c.tcpWritePtr++] = 0x17; // look like TLS data
@@ -151,8 +177,8 @@ struct TcpProxyService
 					c.tcpWritePtr += 2;
 				}
 
-				for(unsigned long i=0;i<len;++i)
-					c.tcpWriteBuf[c.tcpWritePtr++] = ((const char *)data)[i];
+				memcpy(c.tcpWriteBuf + c.tcpWritePtr,data,len);
+				c.tcpWritePtr += len;
 			}
 
 			printf("<< UDP %s:%d -> %.16llx\n",inet_ntoa(reinterpret_cast<const struct sockaddr_in *>(from)->sin_addr),(int)ntohs(reinterpret_cast<const struct sockaddr_in *>(from)->sin_port),(unsigned long long)&c);
@@ -175,11 +201,20 @@ struct TcpProxyService
 			return;
 		}
 		c.tcpWritePtr = 0;
+		c.tcpWriteStart = 0;
 		c.tcpReadPtr = 0;
 		c.tcp = sockN;
 		c.udp = udp;
 		c.lastActivity = time((time_t *)0);
+		c.connectedAt = c.lastActivity;
 		c.newVersion = false;
+		memset(&c.remote,0,sizeof(c.remote));
+		if (from->sa_family == AF_INET)
+			memcpy(&c.remote,from,sizeof(struct sockaddr_in));
+		c.tcpBytesIn = 0;
+		c.tcpBytesOut = 0;
+		c.udpBytesIn = 0;
+		c.udpBytesOut = 0;
 		*uptrN = (void *)&c;
 		printf("<< TCP from %s -> %.16llx\n",inet_ntoa(reinterpret_cast<const struct sockaddr_in *>(from)->sin_addr),(unsigned long long)&c);
 	}
@@ -198,57 +233,77 @@ struct TcpProxyService
 	{
 		Client &c = *((Client *)*uptr);
 		c.lastActivity = time((time_t *)0);
-
-		for(unsigned long i=0;i<len;++i) {
-			if (c.tcpReadPtr >= sizeof(c.tcpReadBuf)) {
-				phy->close(sock);
-				return;
-			}
-			c.tcpReadBuf[c.tcpReadPtr++] = ((const char *)data)[i];
-
-			if (c.tcpReadPtr >= 5) {
-				unsigned long mlen = ( ((((unsigned long)c.tcpReadBuf[3]) & 0xff) << 8) | (((unsigned long)c.tcpReadBuf[4]) & 0xff) );
-				if (c.tcpReadPtr >= (mlen + 5)) {
-					if (mlen == 4) {
-						// Right now just sending this means the client is 'new enough' for the IP header
-						c.newVersion = true;
-						printf("<< TCP %.16llx HELLO\n",(unsigned long long)*uptr);
-					} else if (mlen >= 7) {
-						char *payload = c.tcpReadBuf + 5;
-						unsigned long payloadLen = mlen;
-
-						struct sockaddr_in dest;
-						memset(&dest,0,sizeof(dest));
-						if (c.newVersion) {
-							if (*payload == (char)4) {
-								// New clients tell us where their packets go.
-								++payload;
-								dest.sin_family = AF_INET;
-								dest.sin_addr.s_addr = *((uint32_t *)payload);
-								payload += 4;
-								dest.sin_port = *((uint16_t *)payload); // will be in network byte order already
-								payload += 2;
-								payloadLen -= 7;
-							}
-						} else {
-							// For old clients we will just proxy everything to a local ZT instance. The
-							// fact that this will come from 127.0.0.1 will in turn prevent that instance
-							// from doing unite() with us. It'll just forward. There will not be many of
-							// these.
+		c.tcpBytesIn += (uint64_t)len;
+
+		unsigned long inPtr = 0;
+		while (inPtr < len) {
+			// Bulk-copy as much input as fits after whatever partial message is pending
+			const unsigned long avail = (unsigned long)sizeof(c.tcpReadBuf) - c.tcpReadPtr;
+			const unsigned long chunk = std::min(avail,len - inPtr);
+			memcpy(c.tcpReadBuf + c.tcpReadPtr,((const char *)data) + inPtr,chunk);
+			c.tcpReadPtr += chunk;
+			inPtr += chunk;
+
+			// Parse complete messages in place, compacting the buffer only once
+			// per data event rather than once per message
+			unsigned long rptr = 0;
+			while ((c.tcpReadPtr - rptr) >= 5) {
+				const char *const hdr = c.tcpReadBuf + rptr;
+				unsigned long mlen = ( ((((unsigned long)hdr[3]) & 0xff) << 8) | (((unsigned long)hdr[4]) & 0xff) );
+				if ((c.tcpReadPtr - rptr) < (mlen + 5))
+					break;
+
+				if (mlen == 4) {
+					// Right now just sending this means the client is 'new enough' for the IP header
+					c.newVersion = true;
+					printf("<< TCP %.16llx HELLO\n",(unsigned long long)*uptr);
+				} else if (mlen >= 7) {
+					char *payload = c.tcpReadBuf + rptr + 5;
+					unsigned long payloadLen = mlen;
+
+					struct sockaddr_in dest;
+					memset(&dest,0,sizeof(dest));
+					if (c.newVersion) {
+						if (*payload == (char)4) {
+							// New clients tell us where their packets go.
+							++payload;
 							dest.sin_family = AF_INET;
-							dest.sin_addr.s_addr = htonl(0x7f000001); // 127.0.0.1
-							dest.sin_port = htons(9993);
-						}
-
-						// Note: we do not relay to privileged ports... just an abuse prevention rule.
-						if ((ntohs(dest.sin_port) > 1024)&&(payloadLen >= 16)) {
-							phy->udpSend(c.udp,(const struct sockaddr *)&dest,payload,payloadLen);
-							printf(">> TCP %.16llx to %s:%d\n",(unsigned long long)*uptr,inet_ntoa(dest.sin_addr),(int)ntohs(dest.sin_port));
+							dest.sin_addr.s_addr = *((uint32_t *)payload);
+							payload += 4;
+							dest.sin_port = *((uint16_t *)payload); // will be in network byte order already
+							payload += 2;
+							payloadLen -= 7;
 						}
+					} else {
+						// For old clients we will just proxy everything to a local ZT instance. The
+						// fact that this will come from 127.0.0.1 will in turn prevent that instance
+						// from doing unite() with us. It'll just forward. There will not be many of
+						// these.
+						dest.sin_family = AF_INET;
+						dest.sin_addr.s_addr = htonl(0x7f000001); // 127.0.0.1
+						dest.sin_port = htons(9993);
 					}
 
-					memmove(c.tcpReadBuf,c.tcpReadBuf + (mlen + 5),c.tcpReadPtr -= (mlen + 5));
+					// Note: we do not relay to privileged ports... just an abuse prevention rule.
+					if ((ntohs(dest.sin_port) > 1024)&&(payloadLen >= 16)) {
+						phy->udpSend(c.udp,(const struct sockaddr *)&dest,payload,payloadLen);
+						c.udpBytesOut += (uint64_t)payloadLen;
+						printf(">> TCP %.16llx to %s:%d\n",(unsigned long long)*uptr,inet_ntoa(dest.sin_addr),(int)ntohs(dest.sin_port));
+					}
 				}
+
+				rptr += mlen + 5;
+			}
+
+			if (rptr) {
+				if (rptr < c.tcpReadPtr)
+					memmove(c.tcpReadBuf,c.tcpReadBuf + rptr,c.tcpReadPtr - rptr);
+				c.tcpReadPtr -= rptr;
+			} else if (c.tcpReadPtr >= sizeof(c.tcpReadBuf)) {
+				// Buffer full with no parseable message: stream is garbage
+				// (the largest legal message is 65540 bytes)
+				phy->close(sock);
+				return;
 			}
 		}
 	}
@@ -256,16 +311,40 @@ struct TcpProxyService
 	void phyOnTcpWritable(PhySocket *sock,void **uptr)
 	{
 		Client &c = *((Client *)*uptr);
-		if (c.tcpWritePtr) {
-			long n = phy->streamSend(sock,c.tcpWriteBuf,c.tcpWritePtr);
+		if (c.tcpWritePtr > c.tcpWriteStart) {
+			// All queued messages are contiguous, so one send flushes the batch;
+			// partial sends just advance the start offset instead of shifting
+			// the whole buffer
+			long n = phy->streamSend(sock,c.tcpWriteBuf + c.tcpWriteStart,c.tcpWritePtr - c.tcpWriteStart);
 			if (n > 0) {
-				memmove(c.tcpWriteBuf,c.tcpWriteBuf + n,c.tcpWritePtr -= (unsigned long)n);
-				if (!c.tcpWritePtr)
+				c.tcpBytesOut += (uint64_t)n;
+				c.tcpWriteStart += (unsigned long)n;
+				if (c.tcpWriteStart == c.tcpWritePtr) {
+					c.tcpWriteStart = 0;
+					c.tcpWritePtr = 0;
 					phy->setNotifyWritable(sock,false);
+				}
 			}
 		} else phy->setNotifyWritable(sock,false);
 	}
 
+	void dumpStats()
+	{
+		const time_t now = time((time_t *)0);
+		printf("== worker %u: %lu client(s)\n",workerId,(unsigned long)clients.size());
+		for(std::map< PhySocket *,Client >::iterator c(clients.begin());c!=clients.end();++c) {
+			printf("==   %s:%d age=%lds idle=%lds tcpIn=%llu tcpOut=%llu udpIn=%llu udpOut=%llu\n",
+				inet_ntoa(c->second.remote.sin_addr),
+				(int)ntohs(c->second.remote.sin_port),
+				(long)(now - c->second.connectedAt),
+				(long)(now - c->second.lastActivity),
+				(unsigned long long)c->second.tcpBytesIn,
+				(unsigned long long)c->second.tcpBytesOut,
+				(unsigned long long)c->second.udpBytesIn,
+				(unsigned long long)c->second.udpBytesOut);
+		}
+	}
+
 	void doHousekeeping()
 	{
 		std::vector<PhySocket *> toClose;
@@ -281,29 +360,29 @@ struct TcpProxyService
 	}
 };
 
-int main(int argc,char **argv)
+static void runWorker(unsigned int workerId,unsigned int workerCount,const char *progName)
 {
-	signal(SIGPIPE,SIG_IGN);
-	signal(SIGHUP,SIG_IGN);
-	srand(time((time_t *)0));
-
 	TcpProxyService svc;
 	Phy<TcpProxyService *> phy(&svc,false,true);
 	svc.phy = &phy;
-	svc.udpPortCounter = 1023;
+	svc.workerId = workerId;
+	// Stagger each worker's UDP port search so workers don't all walk the
+	// same range and contend on failed binds
+	svc.udpPortCounter = 1023 + (int)((workerId * 64511) / workerCount);
 
 	{
 		struct sockaddr_in laddr;
 		memset(&laddr,0,sizeof(laddr));
 		laddr.sin_family = AF_INET;
 		laddr.sin_port = htons(ZT_TCP_PROXY_TCP_PORT);
-		if (!phy.tcpListen((const struct sockaddr *)&laddr)) {
-			fprintf(stderr,"%s: fatal error: unable to bind TCP port %d\n",argv[0],ZT_TCP_PROXY_TCP_PORT);
-			return 1;
+		if (!phy.tcpListen((const struct sockaddr *)&laddr,(void *)0,(workerCount > 1))) {
+			fprintf(stderr,"%s: fatal error: unable to bind TCP port %d (worker %u)\n",progName,ZT_TCP_PROXY_TCP_PORT,workerId);
+			exit(1);
 		}
 	}
 
 	time_t lastDidHousekeeping = time((time_t *)0);
+	sig_atomic_t lastStatsDump = 0;
 	for(;;) {
 		phy.poll(120000);
 		time_t now = time((time_t *)0);
@@ -311,7 +390,38 @@ int main(int argc,char **argv)
 			lastDidHousekeeping = now;
 			svc.doHousekeeping();
 		}
+		if (s_dumpStatsRequests != lastStatsDump) {
+			lastStatsDump = s_dumpStatsRequests;
+			svc.dumpStats();
+		}
 	}
+}
+
+int main(int argc,char **argv)
+{
+	signal(SIGPIPE,SIG_IGN);
+	signal(SIGHUP,SIG_IGN);
+	signal(SIGUSR1,_sigUsr1Handler);
+	srand(time((time_t *)0));
 
+	unsigned int workerCount = 0;
+	if (argc > 1)
+		workerCount = (unsigned int)strtoul(argv[1],(char **)0,10);
+	if (workerCount == 0)
+		workerCount = std::thread::hardware_concurrency();
+	if (workerCount == 0)
+		workerCount = 1;
+	if (workerCount > ZT_TCP_PROXY_MAX_WORKER_THREADS)
+		workerCount = ZT_TCP_PROXY_MAX_WORKER_THREADS;
+
+	printf("starting %u worker thread(s) on TCP port %d\n",workerCount,ZT_TCP_PROXY_TCP_PORT);
+
+	std::vector<std::thread> workers;
+	for(unsigned int w=1;w<workerCount;++w)
+		workers.push_back(std::thread(runWorker,w,workerCount,argv[0]));
+	runWorker(0,workerCount,argv[0]);
+
+	for(std::vector<std::thread>::iterator t(workers.begin());t!=workers.end();++t)
+		t->join();
 	return 0;
 }